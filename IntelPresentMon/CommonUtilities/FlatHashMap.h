@@ -0,0 +1,413 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace pmon::util
+{
+	// open-addressing hash map (linear probing, power-of-two capacity) intended for the small,
+	// churn-heavy index tables on hot event paths where std::unordered_map pays a node allocation
+	// per insert and a pointer chase per lookup
+	//
+	// keys and values are stored inline in a single slot array, with a parallel array of control
+	// bytes (empty, or a 7-bit fragment of the hash) so that most probe mismatches are rejected
+	// without touching the slot itself; erase uses backward-shift deletion, so there are no
+	// tombstones and lookups never degrade as entries churn
+	//
+	// mirrors the subset of the std::unordered_map interface that is used by the consumers, with
+	// these differences:
+	//  - insertion that causes growth invalidates all iterators, references and pointers
+	//  - erase may relocate other elements, so it invalidates references and iterators to every
+	//    element other than the returned iterator; end() is never invalidated by erase
+	//  - erasing while iterating (it = erase(it)) never skips an element, but may visit an
+	//    element twice when a probe chain wraps past the end of the slot array
+	template<typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+	class FlatHashMap
+	{
+		template<bool IsConst>
+		class Iterator_;
+	public:
+		using key_type = K;
+		using mapped_type = V;
+		using value_type = std::pair<const K, V>;
+		using size_type = size_t;
+		using hasher = Hash;
+		using key_equal = KeyEqual;
+		using iterator = Iterator_<false>;
+		using const_iterator = Iterator_<true>;
+
+		FlatHashMap() = default;
+		explicit FlatHashMap(size_t expectedSize)
+		{
+			reserve(expectedSize);
+		}
+		FlatHashMap(const FlatHashMap& other)
+			:
+			hash_{ other.hash_ },
+			equal_{ other.equal_ }
+		{
+			reserve(other.size_);
+			for (auto& kv : other) {
+				try_emplace(kv.first, kv.second);
+			}
+		}
+		FlatHashMap(FlatHashMap&& other) noexcept
+			:
+			hash_{ std::move(other.hash_) },
+			equal_{ std::move(other.equal_) },
+			pSlots_{ std::exchange(other.pSlots_, nullptr) },
+			pControl_{ std::exchange(other.pControl_, nullptr) },
+			capacity_{ std::exchange(other.capacity_, 0) },
+			size_{ std::exchange(other.size_, 0) },
+			shift_{ std::exchange(other.shift_, 64) }
+		{}
+		FlatHashMap& operator=(const FlatHashMap& rhs)
+		{
+			if (this != &rhs) {
+				FlatHashMap copy{ rhs };
+				*this = std::move(copy);
+			}
+			return *this;
+		}
+		FlatHashMap& operator=(FlatHashMap&& rhs) noexcept
+		{
+			if (this != &rhs) {
+				Release_();
+				hash_ = std::move(rhs.hash_);
+				equal_ = std::move(rhs.equal_);
+				pSlots_ = std::exchange(rhs.pSlots_, nullptr);
+				pControl_ = std::exchange(rhs.pControl_, nullptr);
+				capacity_ = std::exchange(rhs.capacity_, 0);
+				size_ = std::exchange(rhs.size_, 0);
+				shift_ = std::exchange(rhs.shift_, 64);
+			}
+			return *this;
+		}
+		~FlatHashMap()
+		{
+			Release_();
+		}
+
+		iterator begin() noexcept { return { this, NextOccupied_(0) }; }
+		iterator end() noexcept { return { this, capacity_ }; }
+		const_iterator begin() const noexcept { return { this, NextOccupied_(0) }; }
+		const_iterator end() const noexcept { return { this, capacity_ }; }
+		const_iterator cbegin() const noexcept { return begin(); }
+		const_iterator cend() const noexcept { return end(); }
+
+		size_t size() const noexcept { return size_; }
+		bool empty() const noexcept { return size_ == 0; }
+		size_t bucket_count() const noexcept { return capacity_; }
+
+		// clear keeps the slot array so that a table that is repeatedly refilled does not reallocate
+		void clear() noexcept
+		{
+			for (size_t i = 0; i < capacity_ && size_ > 0; i++) {
+				if (pControl_[i] != emptyControl_) {
+					std::destroy_at(&pSlots_[i]);
+					pControl_[i] = emptyControl_;
+					--size_;
+				}
+			}
+		}
+		void reserve(size_t count)
+		{
+			size_t capacity = minCapacity_;
+			while (!FitsLoad_(count, capacity)) {
+				capacity *= 2;
+			}
+			if (capacity > capacity_) {
+				Rehash_(capacity);
+			}
+		}
+
+		iterator find(const K& key) noexcept
+		{
+			return { this, Find_(key) };
+		}
+		const_iterator find(const K& key) const noexcept
+		{
+			return { this, Find_(key) };
+		}
+		bool contains(const K& key) const noexcept
+		{
+			return Find_(key) != capacity_;
+		}
+		size_t count(const K& key) const noexcept
+		{
+			return contains(key) ? 1 : 0;
+		}
+		V& at(const K& key)
+		{
+			const auto i = Find_(key);
+			if (i == capacity_) {
+				throw std::out_of_range{ "FlatHashMap::at key not found" };
+			}
+			return pSlots_[i].second;
+		}
+		const V& at(const K& key) const
+		{
+			return const_cast<FlatHashMap*>(this)->at(key);
+		}
+
+		// like std::unordered_map::try_emplace, the value is only constructed if key is absent
+		template<typename...A>
+		std::pair<iterator, bool> try_emplace(const K& key, A&&...args)
+		{
+			auto [i, inserted] = Insert_(key);
+			if (inserted) {
+				Construct_(i, key, std::forward<A>(args)...);
+			}
+			return { iterator{ this, i }, inserted };
+		}
+		template<typename...A>
+		std::pair<iterator, bool> emplace(const K& key, A&&...args)
+		{
+			return try_emplace(key, std::forward<A>(args)...);
+		}
+		std::pair<iterator, bool> insert(const value_type& kv)
+		{
+			return try_emplace(kv.first, kv.second);
+		}
+		template<typename M>
+		std::pair<iterator, bool> insert_or_assign(const K& key, M&& value)
+		{
+			auto result = try_emplace(key, std::forward<M>(value));
+			if (!result.second) {
+				result.first->second = std::forward<M>(value);
+			}
+			return result;
+		}
+		V& operator[](const K& key)
+		{
+			return try_emplace(key).first->second;
+		}
+
+		iterator erase(const_iterator pos) noexcept
+		{
+			assert(pos.pMap_ == this && pos.index_ < capacity_ && pControl_[pos.index_] != emptyControl_);
+			EraseAt_(pos.index_);
+			// an element may have been shifted back into the vacated slot
+			return { this, NextOccupied_(pos.index_) };
+		}
+		iterator erase(iterator pos) noexcept
+		{
+			return erase(const_iterator{ pos });
+		}
+		size_t erase(const K& key) noexcept
+		{
+			const auto i = Find_(key);
+			if (i == capacity_) {
+				return 0;
+			}
+			EraseAt_(i);
+			return 1;
+		}
+	private:
+		// types
+		template<bool IsConst>
+		class Iterator_
+		{
+			friend class FlatHashMap;
+			using MapPtr = std::conditional_t<IsConst, const FlatHashMap*, FlatHashMap*>;
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = FlatHashMap::value_type;
+			using difference_type = ptrdiff_t;
+			using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+			using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+
+			Iterator_() = default;
+			Iterator_(MapPtr pMap, size_t index) noexcept : pMap_{ pMap }, index_{ index } {}
+			// allow iterator -> const_iterator
+			template<bool C = IsConst, typename = std::enable_if_t<C>>
+			Iterator_(const Iterator_<false>& other) noexcept : pMap_{ other.pMap_ }, index_{ other.index_ } {}
+
+			reference operator*() const noexcept { return pMap_->pSlots_[index_]; }
+			pointer operator->() const noexcept { return &pMap_->pSlots_[index_]; }
+			Iterator_& operator++() noexcept
+			{
+				index_ = pMap_->NextOccupied_(index_ + 1);
+				return *this;
+			}
+			Iterator_ operator++(int) noexcept
+			{
+				auto old = *this;
+				++*this;
+				return old;
+			}
+			friend bool operator==(const Iterator_& lhs, const Iterator_& rhs) noexcept
+			{
+				return lhs.index_ == rhs.index_ && lhs.pMap_ == rhs.pMap_;
+			}
+			friend bool operator!=(const Iterator_& lhs, const Iterator_& rhs) noexcept
+			{
+				return !(lhs == rhs);
+			}
+		private:
+			friend class Iterator_<!IsConst>;
+			MapPtr pMap_ = nullptr;
+			size_t index_ = 0;
+		};
+		// functions
+		static bool FitsLoad_(size_t count, size_t capacity) noexcept
+		{
+			// the tables this is used for are small, so trade memory for a max load factor of 1/2;
+			// with FIFO-like churn, linear probing at higher loads suffers from clustering and the
+			// resulting unpredictable probe lengths cost more than the extra slots
+			return count * 2 <= capacity;
+		}
+		// fibonacci hashing spreads identity-like std::hash results (thread ids, aligned pointers)
+		// over the high bits, which select the home slot
+		uint64_t Mix_(const K& key) const noexcept
+		{
+			return uint64_t(hash_(key)) * 0x9E3779B97F4A7C15ull;
+		}
+		size_t Home_(uint64_t mixed) const noexcept
+		{
+			return size_t(mixed >> shift_);
+		}
+		uint8_t Fragment_(uint64_t mixed) const noexcept
+		{
+			// take the 7 bits just below the home slot bits
+			return uint8_t(0x80 | ((mixed >> (shift_ - 7)) & 0x7F));
+		}
+		size_t Find_(const K& key) const noexcept
+		{
+			if (size_ == 0) {
+				return capacity_;
+			}
+			const auto mixed = Mix_(key);
+			const auto fragment = Fragment_(mixed);
+			const auto mask = capacity_ - 1;
+			for (auto i = Home_(mixed);; i = (i + 1) & mask) {
+				const auto control = pControl_[i];
+				if (control == emptyControl_) {
+					return capacity_;
+				}
+				if (control == fragment && equal_(pSlots_[i].first, key)) {
+					return i;
+				}
+			}
+		}
+		// returns the slot for key and whether it is vacant; the caller constructs into a vacant slot
+		std::pair<size_t, bool> Insert_(const K& key)
+		{
+			if (auto i = Find_(key); i != capacity_) {
+				return { i, false };
+			}
+			if (capacity_ == 0 || !FitsLoad_(size_ + 1, capacity_)) {
+				Rehash_(capacity_ == 0 ? minCapacity_ : capacity_ * 2);
+			}
+			const auto mixed = Mix_(key);
+			const auto mask = capacity_ - 1;
+			auto i = Home_(mixed);
+			while (pControl_[i] != emptyControl_) {
+				i = (i + 1) & mask;
+			}
+			pControl_[i] = Fragment_(mixed);
+			return { i, true };
+		}
+		template<typename...A>
+		void Construct_(size_t i, const K& key, A&&...args)
+		{
+			try {
+				std::construct_at(&pSlots_[i], std::piecewise_construct,
+					std::forward_as_tuple(key), std::forward_as_tuple(std::forward<A>(args)...));
+			}
+			catch (...) {
+				pControl_[i] = emptyControl_;
+				throw;
+			}
+			++size_;
+		}
+		void EraseAt_(size_t hole) noexcept
+		{
+			std::destroy_at(&pSlots_[hole]);
+			pControl_[hole] = emptyControl_;
+			--size_;
+			// backward-shift: pull later members of the probe chain into the hole as long as that
+			// does not move them in front of their home slot
+			const auto mask = capacity_ - 1;
+			for (auto i = (hole + 1) & mask; pControl_[i] != emptyControl_; i = (i + 1) & mask) {
+				const auto home = Home_(Mix_(pSlots_[i].first));
+				if (((i - home) & mask) >= ((i - hole) & mask)) {
+					std::construct_at(&pSlots_[hole], std::move(pSlots_[i]));
+					pControl_[hole] = pControl_[i];
+					std::destroy_at(&pSlots_[i]);
+					pControl_[i] = emptyControl_;
+					hole = i;
+				}
+			}
+		}
+		size_t NextOccupied_(size_t i) const noexcept
+		{
+			while (i < capacity_ && pControl_[i] == emptyControl_) {
+				i++;
+			}
+			return i;
+		}
+		void Rehash_(size_t capacity)
+		{
+			assert((capacity & (capacity - 1)) == 0);
+			auto pOldSlots = std::exchange(pSlots_, std::allocator<value_type>{}.allocate(capacity));
+			auto pOldControl = std::exchange(pControl_, new uint8_t[capacity]);
+			const auto oldCapacity = std::exchange(capacity_, capacity);
+			std::fill_n(pControl_, capacity_, emptyControl_);
+			shift_ = 64;
+			for (auto c = capacity_; c > 1; c >>= 1) {
+				--shift_;
+			}
+			const auto mask = capacity_ - 1;
+			for (size_t j = 0; j < oldCapacity; j++) {
+				if (pOldControl[j] != emptyControl_) {
+					const auto mixed = Mix_(pOldSlots[j].first);
+					auto i = Home_(mixed);
+					while (pControl_[i] != emptyControl_) {
+						i = (i + 1) & mask;
+					}
+					pControl_[i] = Fragment_(mixed);
+					std::construct_at(&pSlots_[i], std::move(pOldSlots[j]));
+					std::destroy_at(&pOldSlots[j]);
+				}
+			}
+			if (pOldSlots) {
+				std::allocator<value_type>{}.deallocate(pOldSlots, oldCapacity);
+			}
+			delete[] pOldControl;
+		}
+		void Release_() noexcept
+		{
+			if (pSlots_) {
+				clear();
+				std::allocator<value_type>{}.deallocate(pSlots_, capacity_);
+				delete[] pControl_;
+				pSlots_ = nullptr;
+				pControl_ = nullptr;
+				capacity_ = 0;
+				shift_ = 64;
+			}
+		}
+		// data
+		static constexpr uint8_t emptyControl_ = 0;
+		static constexpr size_t minCapacity_ = 16;
+		[[no_unique_address]] Hash hash_;
+		[[no_unique_address]] KeyEqual equal_;
+		value_type* pSlots_ = nullptr;
+		uint8_t* pControl_ = nullptr;
+		size_t capacity_ = 0;
+		size_t size_ = 0;
+		// 64 - log2(capacity_)
+		uint32_t shift_ = 64;
+	};
+}
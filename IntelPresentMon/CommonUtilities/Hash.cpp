@@ -1,23 +1,27 @@
 // Copyright (C) 2022 Intel Corporation
 // SPDX-License-Identifier: MIT
 #include "Hash.h"
+#ifdef _WIN32
 #include "win/WinAPI.h"
+#endif
 
 
 namespace pmon::util::hash
 {
-#if defined(_WIN64)
+#if defined(_WIN64) || defined(__LP64__)
     // 64-bit version
     size_t HashCombine(size_t lhs, size_t rhs) noexcept
     {
         constexpr size_t kHashConstant = 0x517c'c1b7'2722'0a95ull;
         return lhs ^ (rhs + kHashConstant + (lhs << 6) + (lhs >> 2));
     }
+#ifdef _WIN32
     size_t HashGuid(const _GUID& guid) noexcept
     {
         return HashCombine(reinterpret_cast<const uint64_t&>(guid.Data1),
             reinterpret_cast<const size_t&>(guid.Data4));
     }
+#endif
 #else
     // 32-bit version
     size_t HashCombine(size_t lhs, size_t rhs) noexcept
@@ -25,6 +29,7 @@ namespace pmon::util::hash
         constexpr size_t kHashConstant = 0x9e37'79b9u;
         return lhs ^ (rhs + kHashConstant + (lhs << 6) + (lhs >> 2));
     }
+#ifdef _WIN32
     size_t HashGuid(const _GUID& guid) noexcept
     {
         return HashCombine(
@@ -33,5 +38,6 @@ namespace pmon::util::hash
         );
     }
 #endif
+#endif
 
 }
\ No newline at end of file
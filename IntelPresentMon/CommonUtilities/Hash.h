@@ -1,6 +1,8 @@
 // Copyright (C) 2022 Intel Corporation
 // SPDX-License-Identifier: MIT
 #pragma once
+#include <cstddef>
+#include <functional>
 #include <utility>
 
 struct _GUID;
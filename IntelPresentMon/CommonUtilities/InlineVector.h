@@ -0,0 +1,279 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace pmon::util
+{
+	// vector-like container that stores up to N elements inline and only touches the heap when
+	// that capacity is exceeded
+	template<typename T, size_t N>
+	class InlineVector
+	{
+		static_assert(N > 0, "InlineVector requires a nonzero inline capacity");
+	public:
+		using value_type = T;
+		using size_type = size_t;
+		using reference = T&;
+		using const_reference = const T&;
+		using iterator = T*;
+		using const_iterator = const T*;
+		using reverse_iterator = std::reverse_iterator<iterator>;
+		using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+		InlineVector() noexcept = default;
+		InlineVector(const InlineVector& other)
+		{
+			Assign_(other.data(), other.size_);
+		}
+		InlineVector(InlineVector&& other) noexcept
+		{
+			Steal_(other);
+		}
+		InlineVector& operator=(const InlineVector& rhs)
+		{
+			if (this != &rhs) {
+				clear();
+				Assign_(rhs.data(), rhs.size_);
+			}
+			return *this;
+		}
+		InlineVector& operator=(InlineVector&& rhs) noexcept
+		{
+			if (this != &rhs) {
+				clear();
+				Release_();
+				Steal_(rhs);
+			}
+			return *this;
+		}
+		~InlineVector()
+		{
+			clear();
+			Release_();
+		}
+
+		T* data() noexcept { return pHeap_ ? pHeap_ : reinterpret_cast<T*>(inline_); }
+		const T* data() const noexcept { return pHeap_ ? pHeap_ : reinterpret_cast<const T*>(inline_); }
+		size_t size() const noexcept { return size_; }
+		size_t capacity() const noexcept { return capacity_; }
+		bool empty() const noexcept { return size_ == 0; }
+		// true while the contents live in the inline buffer (no heap allocation made)
+		bool is_inline() const noexcept { return pHeap_ == nullptr; }
+
+		iterator begin() noexcept { return data(); }
+		iterator end() noexcept { return data() + size_; }
+		const_iterator begin() const noexcept { return data(); }
+		const_iterator end() const noexcept { return data() + size_; }
+		reverse_iterator rbegin() noexcept { return reverse_iterator{ end() }; }
+		reverse_iterator rend() noexcept { return reverse_iterator{ begin() }; }
+		const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator{ end() }; }
+		const_reverse_iterator rend() const noexcept { return const_reverse_iterator{ begin() }; }
+
+		T& operator[](size_t i) noexcept { assert(i < size_); return data()[i]; }
+		const T& operator[](size_t i) const noexcept { assert(i < size_); return data()[i]; }
+		T& front() noexcept { assert(size_ > 0); return data()[0]; }
+		const T& front() const noexcept { assert(size_ > 0); return data()[0]; }
+		T& back() noexcept { assert(size_ > 0); return data()[size_ - 1]; }
+		const T& back() const noexcept { assert(size_ > 0); return data()[size_ - 1]; }
+
+		void reserve(size_t capacity)
+		{
+			if (capacity > capacity_) {
+				Grow_(capacity);
+			}
+		}
+		void push_back(const T& value)
+		{
+			emplace_back(value);
+		}
+		template<typename...A>
+		T& emplace_back(A&&...args)
+		{
+			// construct before growing in case args alias an element of this container
+			T value{ std::forward<A>(args)... };
+			if (size_ == capacity_) {
+				Grow_(capacity_ * 2);
+			}
+			return *new (data() + size_++) T{ std::move(value) };
+		}
+		void pop_back() noexcept
+		{
+			assert(size_ > 0);
+			std::destroy_at(data() + --size_);
+		}
+		iterator erase(const_iterator pos) noexcept
+		{
+			return erase(pos, pos + 1);
+		}
+		iterator erase(const_iterator first, const_iterator last) noexcept
+		{
+			const auto iFirst = size_t(first - data());
+			const auto iLast = size_t(last - data());
+			assert(iFirst <= iLast && iLast <= size_);
+			auto pNewEnd = std::move(data() + iLast, data() + size_, data() + iFirst);
+			std::destroy(pNewEnd, data() + size_);
+			size_ -= iLast - iFirst;
+			return data() + iFirst;
+		}
+		// clear keeps any heap allocation so that recycled owners do not reallocate
+		void clear() noexcept
+		{
+			std::destroy_n(data(), size_);
+			size_ = 0;
+		}
+		void shrink_to_fit()
+		{
+			if (pHeap_ && size_ <= N) {
+				auto pOld = std::exchange(pHeap_, nullptr);
+				std::uninitialized_move_n(pOld, size_, reinterpret_cast<T*>(inline_));
+				std::destroy_n(pOld, size_);
+				std::allocator<T>{}.deallocate(pOld, std::exchange(heapCapacity_, 0));
+				capacity_ = N;
+			}
+		}
+
+		friend bool operator==(const InlineVector& lhs, const InlineVector& rhs)
+		{
+			return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+		}
+		friend bool operator!=(const InlineVector& lhs, const InlineVector& rhs)
+		{
+			return !(lhs == rhs);
+		}
+	private:
+		// functions
+		void Grow_(size_t capacity)
+		{
+			auto pNew = std::allocator<T>{}.allocate(capacity);
+			std::uninitialized_move_n(data(), size_, pNew);
+			std::destroy_n(data(), size_);
+			Release_();
+			pHeap_ = pNew;
+			heapCapacity_ = capacity;
+			capacity_ = capacity;
+		}
+		void Assign_(const T* pSrc, size_t count)
+		{
+			reserve(count);
+			std::uninitialized_copy_n(pSrc, count, data());
+			size_ = count;
+		}
+		void Steal_(InlineVector& other) noexcept
+		{
+			if (other.pHeap_) {
+				pHeap_ = std::exchange(other.pHeap_, nullptr);
+				heapCapacity_ = std::exchange(other.heapCapacity_, 0);
+				capacity_ = std::exchange(other.capacity_, N);
+			}
+			else {
+				std::uninitialized_move_n(other.data(), other.size_, reinterpret_cast<T*>(inline_));
+				std::destroy_n(other.data(), other.size_);
+				capacity_ = N;
+			}
+			size_ = std::exchange(other.size_, 0);
+		}
+		void Release_() noexcept
+		{
+			if (pHeap_) {
+				std::allocator<T>{}.deallocate(pHeap_, heapCapacity_);
+				pHeap_ = nullptr;
+				heapCapacity_ = 0;
+				capacity_ = N;
+			}
+		}
+		// data
+		alignas(T) std::byte inline_[sizeof(T) * N];
+		T* pHeap_ = nullptr;
+		size_t heapCapacity_ = 0;
+		size_t capacity_ = N;
+		size_t size_ = 0;
+	};
+
+	// associative wrapper over InlineVector for tiny key sets (linear search); mirrors the subset
+	// of the std::unordered_map interface needed for drop-in use in hot tracking structures
+	template<typename K, typename V, size_t N>
+	class InlineMap
+	{
+	public:
+		using value_type = std::pair<K, V>;
+		using iterator = typename InlineVector<value_type, N>::iterator;
+		using const_iterator = typename InlineVector<value_type, N>::const_iterator;
+
+		iterator begin() noexcept { return items_.begin(); }
+		iterator end() noexcept { return items_.end(); }
+		const_iterator begin() const noexcept { return items_.begin(); }
+		const_iterator end() const noexcept { return items_.end(); }
+		size_t size() const noexcept { return items_.size(); }
+		bool empty() const noexcept { return items_.empty(); }
+		void clear() noexcept { items_.clear(); }
+
+		iterator find(const K& key) noexcept
+		{
+			return std::find_if(begin(), end(), [&](const value_type& kv) { return kv.first == key; });
+		}
+		const_iterator find(const K& key) const noexcept
+		{
+			return std::find_if(begin(), end(), [&](const value_type& kv) { return kv.first == key; });
+		}
+		bool contains(const K& key) const noexcept
+		{
+			return find(key) != end();
+		}
+		// like std::unordered_map::emplace, does not overwrite an existing entry
+		std::pair<iterator, bool> emplace(const K& key, const V& value)
+		{
+			if (auto i = find(key); i != end()) {
+				return { i, false };
+			}
+			items_.emplace_back(key, value);
+			return { end() - 1, true };
+		}
+		std::pair<iterator, bool> insert_or_assign(const K& key, const V& value)
+		{
+			auto result = emplace(key, value);
+			if (!result.second) {
+				result.first->second = value;
+			}
+			return result;
+		}
+		iterator erase(const_iterator pos) noexcept
+		{
+			return items_.erase(pos);
+		}
+		size_t erase(const K& key) noexcept
+		{
+			if (auto i = find(key); i != end()) {
+				items_.erase(i);
+				return 1;
+			}
+			return 0;
+		}
+
+		friend bool operator==(const InlineMap& lhs, const InlineMap& rhs)
+		{
+			if (lhs.size() != rhs.size()) {
+				return false;
+			}
+			for (auto& kv : lhs) {
+				auto i = rhs.find(kv.first);
+				if (i == rhs.end() || i->second != kv.second) {
+					return false;
+				}
+			}
+			return true;
+		}
+		friend bool operator!=(const InlineMap& lhs, const InlineMap& rhs)
+		{
+			return !(lhs == rhs);
+		}
+	private:
+		InlineVector<value_type, N> items_;
+	};
+}
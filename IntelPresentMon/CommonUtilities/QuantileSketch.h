@@ -0,0 +1,432 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace pmon::util
+{
+	// bounded-memory quantile sketch with relative error guarantees (DDSketch)
+	//
+	// values are counted in logarithmically sized buckets so that any quantile is returned within
+	// relativeAccuracy of the true value (of the sample at that rank), independent of how many
+	// samples were added; memory depends only on the dynamic range of the values, and is capped at
+	// maxBuckets per sign by collapsing the buckets nearest zero (trading accuracy for the smallest
+	// magnitudes only).  sketches with the same accuracy can be merged losslessly, so per swap chain
+	// or per process sketches can be combined into a system-wide distribution without raw samples.
+	class QuantileSketch
+	{
+	public:
+		explicit QuantileSketch(double relativeAccuracy = 0.01, size_t maxBuckets = 2048)
+			:
+			relativeAccuracy_{ relativeAccuracy },
+			maxBuckets_{ std::max<size_t>(maxBuckets, 1) }
+		{
+			if (!(relativeAccuracy > 0. && relativeAccuracy < 1.)) {
+				throw std::invalid_argument{ "QuantileSketch relative accuracy must be in (0, 1)" };
+			}
+			gamma_ = (1. + relativeAccuracy) / (1. - relativeAccuracy);
+			inverseLogGamma_ = 1. / std::log(gamma_);
+		}
+
+		void Add(double value, uint64_t count = 1)
+		{
+			if (value > kMinIndexable_) {
+				positive_.Add(Index_(value), count, maxBuckets_);
+			}
+			else if (value < -kMinIndexable_) {
+				negative_.Add(Index_(-value), count, maxBuckets_);
+			}
+			else {
+				zeroCount_ += count;
+			}
+			count_ += count;
+		}
+		// remove a value previously added (removing a value that was never added corrupts the counts)
+		void Remove(double value, uint64_t count = 1)
+		{
+			if (value > kMinIndexable_) {
+				positive_.Remove(Index_(value), count);
+			}
+			else if (value < -kMinIndexable_) {
+				negative_.Remove(Index_(-value), count);
+			}
+			else {
+				assert(zeroCount_ >= count);
+				zeroCount_ -= std::min(zeroCount_, count);
+			}
+			count_ -= std::min(count_, count);
+		}
+		// add all samples of another sketch, which must have been created with the same accuracy
+		void Merge(const QuantileSketch& other)
+		{
+			if (other.gamma_ != gamma_) {
+				throw std::invalid_argument{ "Cannot merge QuantileSketch instances of differing accuracy" };
+			}
+			positive_.Merge(other.positive_, maxBuckets_);
+			negative_.Merge(other.negative_, maxBuckets_);
+			zeroCount_ += other.zeroCount_;
+			count_ += other.count_;
+		}
+		// remove all samples but keep bucket storage for reuse
+		void Clear()
+		{
+			positive_.Clear();
+			negative_.Clear();
+			zeroCount_ = 0;
+			count_ = 0;
+		}
+
+		uint64_t Count() const { return count_; }
+		bool Empty() const { return count_ == 0; }
+		double GetRelativeAccuracy() const { return relativeAccuracy_; }
+
+		// value at quantile q in [0, 1] (rank q * (count - 1)), within relative accuracy of the
+		// sample at that rank
+		double Quantile(double q) const
+		{
+			assert(count_ != 0);
+			q = std::clamp(q, 0., 1.);
+			const auto rank = uint64_t(q * double(count_ - 1));
+			// negatives ascend in value as their magnitude index descends
+			const auto negativeCount = negative_.Total();
+			if (rank < negativeCount) {
+				return -Value_(negative_.IndexAtRank(negativeCount - 1 - rank));
+			}
+			if (rank < negativeCount + zeroCount_) {
+				return 0.;
+			}
+			return Value_(positive_.IndexAtRank(rank - negativeCount - zeroCount_));
+		}
+
+	private:
+		// types
+		// contiguous bucket counts covering indices [offset, offset + counts.size())
+		class Store_
+		{
+		public:
+			void Add(int32_t index, uint64_t count, size_t maxBuckets)
+			{
+				Extend_(index, maxBuckets);
+				counts_[size_t(std::max(index, offset_) - offset_)] += count;
+				total_ += count;
+			}
+			void Remove(int32_t index, uint64_t count)
+			{
+				assert(!counts_.empty() && index < offset_ + int32_t(counts_.size()));
+				// indices below the offset were collapsed into the lowest bucket
+				auto& bucket = counts_[size_t(std::max(index, offset_) - offset_)];
+				assert(bucket >= count);
+				const auto removed = std::min(bucket, count);
+				bucket -= removed;
+				total_ -= removed;
+			}
+			void Merge(const Store_& other, size_t maxBuckets)
+			{
+				if (other.total_ == 0) {
+					return;
+				}
+				Extend_(other.offset_, maxBuckets);
+				Extend_(other.offset_ + int32_t(other.counts_.size()) - 1, maxBuckets);
+				for (size_t i = 0; i < other.counts_.size(); i++) {
+					const auto index = std::max(other.offset_ + int32_t(i), offset_);
+					counts_[size_t(index - offset_)] += other.counts_[i];
+				}
+				total_ += other.total_;
+			}
+			void Clear()
+			{
+				std::fill(counts_.begin(), counts_.end(), uint64_t(0));
+				total_ = 0;
+			}
+			uint64_t Total() const { return total_; }
+			// bucket index holding the sample at rank (0 is the lowest index)
+			int32_t IndexAtRank(uint64_t rank) const
+			{
+				uint64_t seen = 0;
+				for (size_t i = 0; i < counts_.size(); i++) {
+					seen += counts_[i];
+					if (seen > rank) {
+						return offset_ + int32_t(i);
+					}
+				}
+				assert(false);
+				return offset_ + int32_t(counts_.size()) - 1;
+			}
+		private:
+			// grow the covered range to include index, collapsing the lowest buckets when the range
+			// would exceed maxBuckets
+			void Extend_(int32_t index, size_t maxBuckets)
+			{
+				if (counts_.empty()) {
+					counts_.assign(1, 0);
+					offset_ = index;
+					return;
+				}
+				const auto top = offset_ + int32_t(counts_.size()) - 1;
+				if (index > top) {
+					counts_.resize(counts_.size() + size_t(index - top), 0);
+				}
+				else if (index < offset_) {
+					// never grow downward past the cap, those samples land in the lowest bucket
+					const auto grow = std::min(size_t(offset_ - index),
+						maxBuckets > counts_.size() ? maxBuckets - counts_.size() : size_t(0));
+					counts_.insert(counts_.begin(), grow, 0);
+					offset_ -= int32_t(grow);
+				}
+				if (counts_.size() > maxBuckets) {
+					const auto excess = counts_.size() - maxBuckets;
+					uint64_t collapsed = 0;
+					for (size_t i = 0; i <= excess; i++) {
+						collapsed += counts_[i];
+					}
+					counts_.erase(counts_.begin(), counts_.begin() + excess);
+					counts_.front() = collapsed;
+					offset_ += int32_t(excess);
+				}
+			}
+			std::vector<uint64_t> counts_;
+			int32_t offset_ = 0;
+			uint64_t total_ = 0;
+		};
+		// functions
+		int32_t Index_(double magnitude) const
+		{
+			return int32_t(std::ceil(std::log(magnitude) * inverseLogGamma_));
+		}
+		// representative of bucket index, within relativeAccuracy of every value in (gamma^(i-1), gamma^i]
+		double Value_(int32_t index) const
+		{
+			return 2. * std::pow(gamma_, double(index)) / (gamma_ + 1.);
+		}
+		// data
+		// magnitudes at or below this are counted as zero
+		static constexpr double kMinIndexable_ = 1e-9;
+		double relativeAccuracy_;
+		double gamma_;
+		double inverseLogGamma_;
+		size_t maxBuckets_;
+		Store_ positive_;
+		Store_ negative_;
+		uint64_t zeroCount_ = 0;
+		uint64_t count_ = 0;
+	};
+
+	// sliding window of timestamped samples summarized by quantile sketches instead of raw samples
+	//
+	// the window is divided into blocks of blockDuration timestamp units, each summarized by its own
+	// sketch plus sum/count/min/max; eviction drops whole blocks once every sample in them is at or
+	// before the cutoff, so the window can hold up to one block more than requested.  memory is
+	// bounded by the number of live blocks times the sketch size, regardless of the sample rate.
+	// statistics that depend on arrival order (the middle sample) are resolved to the first sample
+	// of the block at the middle of the window.
+	class WindowedQuantileSketch
+	{
+	public:
+		struct Sample
+		{
+			uint64_t timestamp;
+			double value;
+		};
+
+		WindowedQuantileSketch(double relativeAccuracy, uint64_t blockDuration)
+			:
+			merged_{ relativeAccuracy },
+			relativeAccuracy_{ relativeAccuracy },
+			blockDuration_{ std::max<uint64_t>(blockDuration, 1) }
+		{}
+
+		void Push(uint64_t timestamp, double value)
+		{
+			const auto id = timestamp / blockDuration_;
+			if (blocks_.empty() || blocks_.back().id < id) {
+				blocks_.push_back(MakeBlock_(id, { timestamp, value }));
+			}
+			auto& block = blocks_.back();
+			block.sketch.Add(value);
+			block.sum += value;
+			block.nonZeroCount += value != 0. ? 1 : 0;
+			block.min = std::min(block.min, value);
+			block.max = std::max(block.max, value);
+			block.lastTimestamp = std::max(block.lastTimestamp, timestamp);
+			newest_ = { timestamp, value };
+			size_++;
+		}
+		// adjust the value of the newest sample, for metrics that accumulate into the last sample
+		void AddToNewest(double delta)
+		{
+			assert(!blocks_.empty());
+			auto& block = blocks_.back();
+			block.sketch.Remove(newest_.value);
+			block.sum -= newest_.value;
+			block.nonZeroCount -= newest_.value != 0. ? 1 : 0;
+			newest_.value += delta;
+			block.sketch.Add(newest_.value);
+			block.sum += newest_.value;
+			block.nonZeroCount += newest_.value != 0. ? 1 : 0;
+			// min/max only widen, the previous extreme may be stale by at most delta
+			block.min = std::min(block.min, newest_.value);
+			block.max = std::max(block.max, newest_.value);
+			if (block.first.timestamp == newest_.timestamp && block.sketch.Count() == 1) {
+				block.first.value = newest_.value;
+			}
+		}
+		// remove all blocks whose samples all have timestamp <= cutoff
+		void EvictThrough(uint64_t cutoff)
+		{
+			while (!blocks_.empty() && blocks_.front().lastTimestamp <= cutoff) {
+				size_ -= size_t(blocks_.front().sketch.Count());
+				RecycleBlock_(std::move(blocks_.front()));
+				blocks_.pop_front();
+			}
+		}
+		void Clear()
+		{
+			EvictThrough(std::numeric_limits<uint64_t>::max());
+		}
+
+		size_t Size() const { return size_; }
+		bool Empty() const { return size_ == 0; }
+		double GetRelativeAccuracy() const { return relativeAccuracy_; }
+
+		const Sample& Oldest() const { return blocks_.front().first; }
+		const Sample& Newest() const { return newest_; }
+
+		double Min() const
+		{
+			assert(!blocks_.empty());
+			double min = blocks_.front().min;
+			for (auto& b : blocks_) {
+				min = std::min(min, b.min);
+			}
+			return min;
+		}
+		double Max() const
+		{
+			assert(!blocks_.empty());
+			double max = blocks_.front().max;
+			for (auto& b : blocks_) {
+				max = std::max(max, b.max);
+			}
+			return max;
+		}
+		double Mean() const
+		{
+			return size_ == 0 ? 0. : Sum_() / double(size_);
+		}
+		// mean of the samples that are not exactly zero
+		double NonZeroMean() const
+		{
+			size_t nonZero = 0;
+			for (auto& b : blocks_) {
+				nonZero += b.nonZeroCount;
+			}
+			return nonZero == 0 ? 0. : Sum_() / double(nonZero);
+		}
+		// percentile in [0, 1], within relative accuracy of the sample at rank p * (n - 1)
+		double Percentile(double p) const
+		{
+			assert(!blocks_.empty());
+			merged_.Clear();
+			AccumulateInto(merged_);
+			return merged_.Quantile(p);
+		}
+		// first sample of the block at the middle of the window
+		double MidPoint() const
+		{
+			return blocks_[MidBlock_()].first.value;
+		}
+		// linear interpolation (by timestamp) between the first samples of the blocks around the
+		// middle of the window
+		double MidLerp() const
+		{
+			const auto i = MidBlock_();
+			const auto& lo = blocks_[i].first;
+			const auto& hi = i + 1 < blocks_.size() ? blocks_[i + 1].first : newest_;
+			const auto mid = Midpoint_();
+			if (hi.timestamp <= lo.timestamp || mid <= lo.timestamp) {
+				return lo.value;
+			}
+			const double fract = std::min(double(mid - lo.timestamp) / double(hi.timestamp - lo.timestamp), 1.);
+			return lo.value + fract * (hi.value - lo.value);
+		}
+		// merge the distribution of the whole window into another sketch (of the same accuracy)
+		void AccumulateInto(QuantileSketch& sketch) const
+		{
+			for (auto& b : blocks_) {
+				sketch.Merge(b.sketch);
+			}
+		}
+
+	private:
+		// types
+		struct Block_
+		{
+			uint64_t id;
+			uint64_t lastTimestamp;
+			Sample first;
+			QuantileSketch sketch;
+			double sum;
+			size_t nonZeroCount;
+			double min;
+			double max;
+		};
+		// functions
+		Block_ MakeBlock_(uint64_t id, Sample first)
+		{
+			Block_ block{ .id = id, .lastTimestamp = first.timestamp, .first = first,
+				.sketch = QuantileSketch{ relativeAccuracy_ }, .sum = 0., .nonZeroCount = 0,
+				.min = first.value, .max = first.value };
+			if (!spareSketches_.empty()) {
+				block.sketch = std::move(spareSketches_.back());
+				spareSketches_.pop_back();
+			}
+			return block;
+		}
+		void RecycleBlock_(Block_&& block)
+		{
+			block.sketch.Clear();
+			spareSketches_.push_back(std::move(block.sketch));
+		}
+		double Sum_() const
+		{
+			double sum = 0.;
+			for (auto& b : blocks_) {
+				sum += b.sum;
+			}
+			return sum;
+		}
+		uint64_t Midpoint_() const
+		{
+			const auto first = blocks_.front().first.timestamp;
+			return first + (newest_.timestamp - first) / 2;
+		}
+		size_t MidBlock_() const
+		{
+			assert(!blocks_.empty());
+			const auto id = Midpoint_() / blockDuration_;
+			size_t i = 0;
+			while (i + 1 < blocks_.size() && blocks_[i + 1].id <= id) {
+				i++;
+			}
+			return i;
+		}
+		// data
+		std::deque<Block_> blocks_;
+		// cleared sketches of evicted blocks, reused so that steady state does not allocate
+		std::vector<QuantileSketch> spareSketches_;
+		// scratch for merging blocks at query time
+		mutable QuantileSketch merged_;
+		double relativeAccuracy_;
+		uint64_t blockDuration_;
+		Sample newest_{};
+		size_t size_ = 0;
+	};
+}
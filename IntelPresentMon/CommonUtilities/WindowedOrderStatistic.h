@@ -0,0 +1,322 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <vector>
+
+namespace pmon::util
+{
+	// sliding window of timestamped samples that supports order statistics (rank selection,
+	// interpolated percentiles, min/max) in O(log n) and mean in O(1), so that a window which
+	// advances incrementally does not have to be re-gathered and re-sorted for every statistic
+	//
+	// samples are kept twice: in arrival order (for eviction and the point statistics) and in an
+	// indexable skiplist ordered by value (for rank selection); skiplist nodes and links live in
+	// index-addressed pools so the container is copyable/movable by value and does not allocate
+	// once the pools have grown to the window's steady-state size
+	//
+	// timestamps are expected to be pushed in non-decreasing order; eviction pops from the oldest
+	// end while the timestamp is at or before the cutoff.  NaN samples are not supported.
+	class WindowedOrderStatistic
+	{
+	public:
+		struct Sample
+		{
+			uint64_t timestamp;
+			double value;
+		};
+
+		WindowedOrderStatistic()
+		{
+			nodes_.push_back(Node_{ .value = 0., .seq = 0, .links = 0, .height = kMaxHeight_ });
+			links_.resize(kMaxHeight_, Link_{ .next = kNil_, .width = 1 });
+		}
+
+		void Push(uint64_t timestamp, double value)
+		{
+			const auto seq = nextSeq_++;
+			SkipInsert_(value, seq, AllocateNode_(value, seq));
+			samples_.push_back(Entry_{ { timestamp, value }, seq });
+			AddToSums_(value);
+		}
+		// adjust the value of the newest sample, for metrics that accumulate into the last sample
+		void AddToNewest(double delta)
+		{
+			assert(!samples_.empty());
+			auto& e = samples_.back();
+			const auto node = SkipRemove_(e.sample.value, e.seq);
+			RemoveFromSums_(e.sample.value);
+			e.sample.value += delta;
+			nodes_[node].value = e.sample.value;
+			SkipInsert_(e.sample.value, e.seq, node);
+			AddToSums_(e.sample.value);
+		}
+		// remove all samples with timestamp <= cutoff (from the oldest end)
+		void EvictThrough(uint64_t cutoff)
+		{
+			while (!samples_.empty() && samples_.front().sample.timestamp <= cutoff) {
+				PopOldest();
+			}
+		}
+		void PopOldest()
+		{
+			assert(!samples_.empty());
+			const auto& e = samples_.front();
+			FreeNode_(SkipRemove_(e.sample.value, e.seq));
+			RemoveFromSums_(e.sample.value);
+			samples_.pop_front();
+			if (samples_.empty()) {
+				// drop accumulated rounding error whenever the window drains
+				sum_ = 0.;
+				nonZeroCount_ = 0;
+			}
+		}
+		void Clear()
+		{
+			while (!samples_.empty()) {
+				PopOldest();
+			}
+		}
+
+		size_t Size() const { return samples_.size(); }
+		bool Empty() const { return samples_.empty(); }
+
+		// arrival-order access (0 is the oldest sample)
+		const Sample& operator[](size_t i) const { return samples_[i].sample; }
+		const Sample& Oldest() const { return samples_.front().sample; }
+		const Sample& Newest() const { return samples_.back().sample; }
+
+		// value of rank i in ascending value order (0 is the minimum)
+		double Select(size_t rank) const
+		{
+			assert(rank < samples_.size());
+			// widths count bottom-level steps, the head being position 0
+			size_t remaining = rank + 1;
+			uint32_t node = 0;
+			for (int level = kMaxHeight_ - 1; level >= 0; level--) {
+				while (GetLink_(node, level).width <= remaining) {
+					remaining -= GetLink_(node, level).width;
+					node = GetLink_(node, level).next;
+				}
+			}
+			return nodes_[node].value;
+		}
+		double Min() const
+		{
+			assert(!samples_.empty());
+			return nodes_[GetLink_(0, 0).next].value;
+		}
+		double Max() const
+		{
+			return Select(samples_.size() - 1);
+		}
+		double Mean() const
+		{
+			return samples_.empty() ? 0. : sum_ / double(samples_.size());
+		}
+		// mean of the samples that are not exactly zero
+		double NonZeroMean() const
+		{
+			return nonZeroCount_ == 0 ? 0. : sum_ / double(nonZeroCount_);
+		}
+		// percentile in [0, 1] using linear interpolation between the closest ranks (rank is
+		// floor(p * n)), returning the maximum when the rank falls on or past the last sample
+		double Percentile(double p) const
+		{
+			assert(!samples_.empty());
+			p = std::clamp(p, 0., 1.);
+			double integral;
+			const double fract = std::modf(p * double(samples_.size()), &integral);
+			const auto idx = size_t(integral);
+			if (idx >= samples_.size() - 1) {
+				return Max();
+			}
+			const auto lo = Select(idx);
+			return lo + fract * (Select(idx + 1) - lo);
+		}
+		// sample at the middle of the window in arrival order (the later of the two for an even count)
+		double MidPoint() const
+		{
+			assert(!samples_.empty());
+			return samples_[samples_.size() / 2].sample.value;
+		}
+		// linear interpolation between the two samples nearest the middle of the window, in
+		// arrival order (for an odd count this is the middle sample itself)
+		double MidLerp() const
+		{
+			assert(!samples_.empty());
+			const double mid = double(samples_.size() - 1) / 2.;
+			const auto lo = size_t(mid);
+			const auto hi = std::min(lo + 1, samples_.size() - 1);
+			const double fract = mid - double(lo);
+			return samples_[lo].sample.value + fract * (samples_[hi].sample.value - samples_[lo].sample.value);
+		}
+
+	private:
+		// types
+		struct Entry_
+		{
+			Sample sample;
+			uint64_t seq;
+		};
+		struct Node_
+		{
+			double value;
+			// insertion sequence number, breaks ties between equal values so that a specific
+			// sample can be located for removal
+			uint64_t seq;
+			// index of this node's first link in links_, the node owns height consecutive links
+			uint32_t links;
+			uint8_t height;
+		};
+		struct Link_
+		{
+			uint32_t next;
+			// number of bottom-level steps to next (to one past the end for kNil_)
+			uint32_t width;
+		};
+		// functions
+		Link_& GetLink_(uint32_t node, int level)
+		{
+			return links_[nodes_[node].links + level];
+		}
+		const Link_& GetLink_(uint32_t node, int level) const
+		{
+			return links_[nodes_[node].links + level];
+		}
+		// strict ordering of (value, seq) keys, kNil_ compares greater than everything
+		bool NextLess_(uint32_t node, int level, double value, uint64_t seq) const
+		{
+			const auto next = GetLink_(node, level).next;
+			if (next == kNil_) {
+				return false;
+			}
+			const auto& n = nodes_[next];
+			return n.value < value || (n.value == value && n.seq < seq);
+		}
+		uint8_t RandomHeight_()
+		{
+			// xorshift64, p = 1/4 per level
+			rng_ ^= rng_ << 13;
+			rng_ ^= rng_ >> 7;
+			rng_ ^= rng_ << 17;
+			uint64_t bits = rng_;
+			uint8_t height = 1;
+			while (height < kMaxHeight_ && (bits & 0x3) == 0) {
+				height++;
+				bits >>= 2;
+			}
+			return height;
+		}
+		uint32_t AllocateNode_(double value, uint64_t seq)
+		{
+			const auto height = RandomHeight_();
+			uint32_t links;
+			auto& freeLinks = freeLinks_[height - 1];
+			if (!freeLinks.empty()) {
+				links = freeLinks.back();
+				freeLinks.pop_back();
+			}
+			else {
+				links = uint32_t(links_.size());
+				links_.resize(links_.size() + height);
+			}
+			const Node_ node{ .value = value, .seq = seq, .links = links, .height = height };
+			if (!freeNodes_.empty()) {
+				const auto index = freeNodes_.back();
+				freeNodes_.pop_back();
+				nodes_[index] = node;
+				return index;
+			}
+			nodes_.push_back(node);
+			return uint32_t(nodes_.size() - 1);
+		}
+		void FreeNode_(uint32_t node)
+		{
+			freeLinks_[nodes_[node].height - 1].push_back(nodes_[node].links);
+			freeNodes_.push_back(node);
+		}
+		void SkipInsert_(double value, uint64_t seq, uint32_t newNode)
+		{
+			std::array<uint32_t, kMaxHeight_> chain;
+			std::array<uint32_t, kMaxHeight_> stepsAtLevel{};
+			uint32_t node = 0;
+			for (int level = kMaxHeight_ - 1; level >= 0; level--) {
+				while (NextLess_(node, level, value, seq)) {
+					stepsAtLevel[level] += GetLink_(node, level).width;
+					node = GetLink_(node, level).next;
+				}
+				chain[level] = node;
+			}
+			const int height = nodes_[newNode].height;
+			uint32_t steps = 0;
+			for (int level = 0; level < height; level++) {
+				auto& prev = GetLink_(chain[level], level);
+				auto& link = GetLink_(newNode, level);
+				link.next = prev.next;
+				link.width = prev.width - steps;
+				prev.next = newNode;
+				prev.width = steps + 1;
+				steps += stepsAtLevel[level];
+			}
+			for (int level = height; level < kMaxHeight_; level++) {
+				GetLink_(chain[level], level).width++;
+			}
+		}
+		// unlinks the node holding (value, seq) and returns its index
+		uint32_t SkipRemove_(double value, uint64_t seq)
+		{
+			std::array<uint32_t, kMaxHeight_> chain;
+			uint32_t node = 0;
+			for (int level = kMaxHeight_ - 1; level >= 0; level--) {
+				while (NextLess_(node, level, value, seq)) {
+					node = GetLink_(node, level).next;
+				}
+				chain[level] = node;
+			}
+			const auto target = GetLink_(chain[0], 0).next;
+			assert(target != kNil_ && nodes_[target].seq == seq);
+			const int height = nodes_[target].height;
+			for (int level = 0; level < height; level++) {
+				auto& prev = GetLink_(chain[level], level);
+				const auto& link = GetLink_(target, level);
+				prev.width += link.width - 1;
+				prev.next = link.next;
+			}
+			for (int level = height; level < kMaxHeight_; level++) {
+				GetLink_(chain[level], level).width--;
+			}
+			return target;
+		}
+		void AddToSums_(double value)
+		{
+			sum_ += value;
+			nonZeroCount_ += value != 0. ? 1 : 0;
+		}
+		void RemoveFromSums_(double value)
+		{
+			sum_ -= value;
+			nonZeroCount_ -= value != 0. ? 1 : 0;
+		}
+		// data
+		static constexpr uint8_t kMaxHeight_ = 12; // 4^12 samples before levels saturate
+		static constexpr uint32_t kNil_ = std::numeric_limits<uint32_t>::max();
+		// node 0 is the head, owning links [0, kMaxHeight_)
+		std::vector<Node_> nodes_;
+		std::vector<Link_> links_;
+		std::vector<uint32_t> freeNodes_;
+		std::array<std::vector<uint32_t>, kMaxHeight_> freeLinks_;
+		std::deque<Entry_> samples_;
+		uint64_t nextSeq_ = 0;
+		uint64_t rng_ = 0x9E3779B97F4A7C15ull;
+		double sum_ = 0.;
+		size_t nonZeroCount_ = 0;
+	};
+}
@@ -155,7 +155,6 @@ bool AmdPowerTelemetryAdapter::Sample() noexcept {
   }
 
   // Insert telemetry into history
-  std::lock_guard lock{history_mutex_};
   history_.Push(info);
 
   return sample_return;
@@ -463,10 +462,25 @@ bool AmdPowerTelemetryAdapter::Overdrive8Sample(
 
 std::optional<PresentMonPowerTelemetryInfo> AmdPowerTelemetryAdapter::GetClosest(
     uint64_t qpc) const noexcept {
-  std::lock_guard<std::mutex> lock(history_mutex_);
   return history_.GetNearest(qpc);
 }
 
+std::optional<PresentMonPowerTelemetryInfo> AmdPowerTelemetryAdapter::GetInterpolated(
+    uint64_t qpc) const noexcept {
+  return history_.GetInterpolated(qpc);
+}
+
+void AmdPowerTelemetryAdapter::GetTelemetry(
+    std::span<const uint64_t> qpcs,
+    std::span<PresentMonPowerTelemetryInfo> infos,
+    bool interpolate) const noexcept {
+  if (interpolate) {
+    history_.GetInterpolated(qpcs, infos);
+  } else {
+    history_.GetNearest(qpcs, infos);
+  }
+}
+
 PM_DEVICE_VENDOR AmdPowerTelemetryAdapter::GetVendor() const noexcept {
   return PM_DEVICE_VENDOR::PM_DEVICE_VENDOR_AMD;
 }
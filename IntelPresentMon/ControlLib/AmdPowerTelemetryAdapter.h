@@ -1,10 +1,9 @@
 // Copyright (C) 2022 Intel Corporation
 // SPDX-License-Identifier: MIT
 #pragma once
-#include <mutex>
 #include <source_location>
 #include "PowerTelemetryAdapter.h"
-#include "TelemetryHistory.h"
+#include "ConcurrentTelemetryHistory.h"
 #include "Adl2Wrapper.h"
 
 namespace pwr::amd {
@@ -25,6 +24,11 @@ class AmdPowerTelemetryAdapter : public PowerTelemetryAdapter {
   bool Sample() noexcept override;
   std::optional<PresentMonPowerTelemetryInfo> GetClosest(
       uint64_t qpc) const noexcept override;
+  std::optional<PresentMonPowerTelemetryInfo> GetInterpolated(
+      uint64_t qpc) const noexcept override;
+  void GetTelemetry(std::span<const uint64_t> qpcs,
+                    std::span<PresentMonPowerTelemetryInfo> infos,
+                    bool interpolate) const noexcept override;
   PM_DEVICE_VENDOR GetVendor() const noexcept override;
   std::string GetName() const noexcept override;
   uint64_t GetDedicatedVideoMemory() const noexcept override;
@@ -43,8 +47,7 @@ class AmdPowerTelemetryAdapter : public PowerTelemetryAdapter {
   int adl_adapter_index_ = 0;
   int overdrive_version_ = 0;
   std::string name_ = "Unknown Adapter Name";
-  mutable std::mutex history_mutex_;
-  TelemetryHistory<PresentMonPowerTelemetryInfo> history_{
+  ConcurrentTelemetryHistory<PresentMonPowerTelemetryInfo> history_{
       PowerTelemetryAdapter::defaultHistorySize};
 };
 }
\ No newline at end of file
@@ -0,0 +1,352 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include "PresentMonPowerTelemetry.h"
+#include "CpuTelemetryInfo.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+namespace pwr
+{
+    // History of telemetry samples written by a single sampling thread and read by any number of
+    // threads without locking, so that the sampling thread never waits on readers. The size is
+    // rounded up to a power of two, and sample n is held in slot n & mask, guarded by a sequence
+    // number that is 2n + 1 while the sample is being written and 2n + 2 once it is complete.
+    // Readers copy a sample and check its sequence number before and after; a lookup that raced
+    // with the writer coming around is retried. The qpc of every slot is also kept in an array of
+    // its own, so that lookups search without copying samples, and only copy the samples they
+    // return or interpolate.
+    template<class T>
+    class ConcurrentTelemetryHistory
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+    public:
+        ConcurrentTelemetryHistory(size_t size);
+        // only to be called from the sampling thread
+        void Push(const T& info) noexcept;
+        // sample nearest to qpc, or the oldest/newest one if qpc is outside of the history
+        std::optional<T> GetNearest(uint64_t qpc) const noexcept;
+        // sample interpolated at qpc between the two samples bracketing it (see InterpolateTelemetry),
+        // or the oldest/newest one if qpc is outside of the history
+        std::optional<T> GetInterpolated(uint64_t qpc) const noexcept;
+        // the same for each of qpcs, which must be in ascending order, in a single sweep of the history;
+        // infos are left untouched if the history is empty
+        void GetNearest(std::span<const uint64_t> qpcs, std::span<T> infos) const noexcept;
+        void GetInterpolated(std::span<const uint64_t> qpcs, std::span<T> infos) const noexcept;
+    private:
+        // types
+        // samples on either side of a qpc, the same sample twice when the qpc is outside of the history
+        struct Bracket_
+        {
+            uint64_t lower;
+            uint64_t lowerQpc;
+            uint64_t upper;
+            uint64_t upperQpc;
+        };
+        // functions
+        bool Copy_(uint64_t sample, T& info) const noexcept;
+        bool LoadQpc_(uint64_t sample, uint64_t& qpc) const noexcept;
+        // first sample in [first, last) after qpc
+        uint64_t UpperBound_(uint64_t first, uint64_t last, uint64_t qpc) const noexcept;
+        // bracket of qpc given the first sample after it among the samples [oldest, n)
+        std::optional<Bracket_> CheckBracket_(uint64_t first, uint64_t oldest, uint64_t n,
+            uint64_t qpc) const noexcept;
+        std::optional<Bracket_> FindBracket_(uint64_t qpc) const noexcept;
+        bool CopyNearest_(const Bracket_& bracket, uint64_t qpc, T& info) const noexcept;
+        bool CopyInterpolated_(const Bracket_& bracket, uint64_t qpc, T& info) const noexcept;
+        template<class F, class G>
+        void Sweep_(std::span<const uint64_t> qpcs, std::span<T> infos, F&& copy, G&& lookup) const noexcept;
+        // data
+        // a lookup that keeps losing the race with the writer gives up
+        static constexpr int maxLookupAttempts = 4;
+        size_t size;
+        uint64_t mask;
+        std::unique_ptr<std::atomic<uint64_t>[]> seqs;
+        std::unique_ptr<std::atomic<uint64_t>[]> qpcs;
+        std::unique_ptr<T[]> samples;
+        std::atomic<uint64_t> count = 0;
+    };
+
+    // Linear interpolation of the measured quantities of two samples at qpc, lower.qpc <= qpc < upper.qpc.
+    // Sizes, limits, types and flags are not interpolated and are taken from the nearer sample.
+    inline PresentMonPowerTelemetryInfo InterpolateTelemetry(const PresentMonPowerTelemetryInfo& lower,
+        const PresentMonPowerTelemetryInfo& upper, uint64_t qpc) noexcept;
+    inline CpuTelemetryInfo InterpolateTelemetry(const CpuTelemetryInfo& lower, const CpuTelemetryInfo& upper,
+        uint64_t qpc) noexcept;
+
+    template<class T>
+    ConcurrentTelemetryHistory<T>::ConcurrentTelemetryHistory(size_t size_)
+        :
+        // the oldest slot is the one being overwritten, so at least two are needed to hold a sample
+        size{ std::bit_ceil(std::max<size_t>(size_, 2)) },
+        mask{ size - 1 },
+        seqs{ std::make_unique<std::atomic<uint64_t>[]>(size) },
+        qpcs{ std::make_unique<std::atomic<uint64_t>[]>(size) },
+        samples{ std::make_unique<T[]>(size) }
+    {}
+
+    template<class T>
+    void ConcurrentTelemetryHistory<T>::Push(const T& info) noexcept
+    {
+        const auto sample = count.load(std::memory_order_relaxed);
+        const auto slot = sample & mask;
+        // mark the slot as being written before touching it, so that readers of the sample that was
+        // in it see that it changed
+        seqs[slot].store(2 * sample + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&samples[slot], &info, sizeof(T));
+        qpcs[slot].store(info.qpc, std::memory_order_relaxed);
+        seqs[slot].store(2 * sample + 2, std::memory_order_release);
+        count.store(sample + 1, std::memory_order_release);
+    }
+
+    template<class T>
+    bool ConcurrentTelemetryHistory<T>::Copy_(uint64_t sample, T& info) const noexcept
+    {
+        const auto& seq = seqs[sample & mask];
+        if (seq.load(std::memory_order_acquire) != 2 * sample + 2) {
+            return false;
+        }
+        std::memcpy(&info, &samples[sample & mask], sizeof(T));
+        // order the copy before the second look at the sequence number
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return seq.load(std::memory_order_relaxed) == 2 * sample + 2;
+    }
+
+    template<class T>
+    bool ConcurrentTelemetryHistory<T>::LoadQpc_(uint64_t sample, uint64_t& qpc) const noexcept
+    {
+        const auto& seq = seqs[sample & mask];
+        if (seq.load(std::memory_order_acquire) != 2 * sample + 2) {
+            return false;
+        }
+        qpc = qpcs[sample & mask].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return seq.load(std::memory_order_relaxed) == 2 * sample + 2;
+    }
+
+    template<class T>
+    uint64_t ConcurrentTelemetryHistory<T>::UpperBound_(uint64_t first, uint64_t last, uint64_t qpc) const noexcept
+    {
+        while (first < last) {
+            const auto middle = first + (last - first) / 2;
+            if (qpcs[middle & mask].load(std::memory_order_relaxed) <= qpc) {
+                first = middle + 1;
+            }
+            else {
+                last = middle;
+            }
+        }
+        return first;
+    }
+
+    template<class T>
+    std::optional<typename ConcurrentTelemetryHistory<T>::Bracket_>
+        ConcurrentTelemetryHistory<T>::CheckBracket_(uint64_t first, uint64_t oldest, uint64_t n,
+            uint64_t qpc) const noexcept
+    {
+        // the qpcs searched may have been overwritten meanwhile, but two intact neighboring
+        // samples that bracket qpc are the right ones
+        const bool hasLower = first > oldest;
+        const bool hasUpper = first < n;
+        Bracket_ bracket{ first - 1, 0, first, 0 };
+        if ((hasLower && (!LoadQpc_(bracket.lower, bracket.lowerQpc) || bracket.lowerQpc > qpc)) ||
+            (hasUpper && (!LoadQpc_(bracket.upper, bracket.upperQpc) || bracket.upperQpc <= qpc))) {
+            return {};
+        }
+        // if outside the qpc history range return the closest values
+        if (!hasLower) {
+            bracket.lower = bracket.upper;
+            bracket.lowerQpc = bracket.upperQpc;
+        }
+        if (!hasUpper) {
+            bracket.upper = bracket.lower;
+            bracket.upperQpc = bracket.lowerQpc;
+        }
+        return bracket;
+    }
+
+    template<class T>
+    std::optional<typename ConcurrentTelemetryHistory<T>::Bracket_>
+        ConcurrentTelemetryHistory<T>::FindBracket_(uint64_t qpc) const noexcept
+    {
+        for (int attempt = 0; attempt < maxLookupAttempts; attempt++) {
+            const auto n = count.load(std::memory_order_acquire);
+            // return nothing if history empty
+            if (n == 0) return {};
+            // the oldest slot may be being overwritten by the next sample
+            const auto oldest = n >= size ? n - size + 1 : 0;
+            if (auto bracket = CheckBracket_(UpperBound_(oldest, n, qpc), oldest, n, qpc)) {
+                return bracket;
+            }
+        }
+        return {};
+    }
+
+    template<class T>
+    bool ConcurrentTelemetryHistory<T>::CopyNearest_(const Bracket_& bracket, uint64_t qpc, T& info) const noexcept
+    {
+        // only the nearest sample is copied
+        return Copy_(bracket.upperQpc - qpc <= qpc - bracket.lowerQpc ? bracket.upper : bracket.lower, info);
+    }
+
+    template<class T>
+    bool ConcurrentTelemetryHistory<T>::CopyInterpolated_(const Bracket_& bracket, uint64_t qpc, T& info) const noexcept
+    {
+        if (bracket.lower == bracket.upper) {
+            return Copy_(bracket.lower, info);
+        }
+        T lower;
+        T upper;
+        if (!Copy_(bracket.lower, lower) || !Copy_(bracket.upper, upper)) {
+            return false;
+        }
+        info = InterpolateTelemetry(lower, upper, qpc);
+        return true;
+    }
+
+    template<class T>
+    std::optional<T> ConcurrentTelemetryHistory<T>::GetNearest(uint64_t qpc) const noexcept
+    {
+        for (int attempt = 0; attempt < maxLookupAttempts; attempt++) {
+            const auto bracket = FindBracket_(qpc);
+            if (!bracket) return {};
+            T info;
+            if (CopyNearest_(*bracket, qpc, info)) {
+                return info;
+            }
+        }
+        return {};
+    }
+
+    template<class T>
+    std::optional<T> ConcurrentTelemetryHistory<T>::GetInterpolated(uint64_t qpc) const noexcept
+    {
+        for (int attempt = 0; attempt < maxLookupAttempts; attempt++) {
+            const auto bracket = FindBracket_(qpc);
+            if (!bracket) return {};
+            T info;
+            if (CopyInterpolated_(*bracket, qpc, info)) {
+                return info;
+            }
+        }
+        return {};
+    }
+
+    template<class T>
+    template<class F, class G>
+    void ConcurrentTelemetryHistory<T>::Sweep_(std::span<const uint64_t> qpcs_, std::span<T> infos, F&& copy,
+        G&& lookup) const noexcept
+    {
+        if (qpcs_.empty()) return;
+        const auto n = count.load(std::memory_order_acquire);
+        if (n == 0) return;
+        const auto oldest = n >= size ? n - size + 1 : 0;
+        // merge the qpcs with the samples: search for the first one only, then walk forward
+        auto first = UpperBound_(oldest, n, qpcs_.front());
+        for (size_t i = 0; i < qpcs_.size(); i++) {
+            const auto qpc = qpcs_[i];
+            while (first < n && qpcs[first & mask].load(std::memory_order_relaxed) <= qpc) {
+                first++;
+            }
+            const auto bracket = CheckBracket_(first, oldest, n, qpc);
+            // samples of the snapshot that the writer came around to are looked up afresh
+            if (!bracket || !copy(*bracket, qpc, infos[i])) {
+                // a failed copy may have left a torn sample behind
+                auto info = lookup(qpc);
+                infos[i] = info ? *info : T{};
+            }
+        }
+    }
+
+    template<class T>
+    void ConcurrentTelemetryHistory<T>::GetNearest(std::span<const uint64_t> qpcs_, std::span<T> infos) const noexcept
+    {
+        Sweep_(qpcs_, infos,
+            [this](const Bracket_& bracket, uint64_t qpc, T& info) { return CopyNearest_(bracket, qpc, info); },
+            [this](uint64_t qpc) { return GetNearest(qpc); });
+    }
+
+    template<class T>
+    void ConcurrentTelemetryHistory<T>::GetInterpolated(std::span<const uint64_t> qpcs_, std::span<T> infos) const noexcept
+    {
+        Sweep_(qpcs_, infos,
+            [this](const Bracket_& bracket, uint64_t qpc, T& info) { return CopyInterpolated_(bracket, qpc, info); },
+            [this](uint64_t qpc) { return GetInterpolated(qpc); });
+    }
+
+    namespace impl
+    {
+        inline double GetInterpolationFactor(uint64_t lowerQpc, uint64_t upperQpc, uint64_t qpc) noexcept
+        {
+            return double(qpc - lowerQpc) / double(upperQpc - lowerQpc);
+        }
+        inline double Lerp(double lower, double upper, double t) noexcept
+        {
+            return lower + (upper - lower) * t;
+        }
+    }
+
+    inline PresentMonPowerTelemetryInfo InterpolateTelemetry(const PresentMonPowerTelemetryInfo& lower,
+        const PresentMonPowerTelemetryInfo& upper, uint64_t qpc) noexcept
+    {
+        using Info = PresentMonPowerTelemetryInfo;
+        static constexpr double Info::* measured[] = {
+            &Info::time_stamp,
+            &Info::gpu_power_w,
+            &Info::gpu_voltage_v,
+            &Info::gpu_frequency_mhz,
+            &Info::gpu_temperature_c,
+            &Info::gpu_utilization,
+            &Info::gpu_render_compute_utilization,
+            &Info::gpu_media_utilization,
+            &Info::gpu_effective_frequency_mhz,
+            &Info::gpu_voltage_regulator_temperature_c,
+            &Info::gpu_mem_effective_bandwidth_gbps,
+            &Info::gpu_overvoltage_percent,
+            &Info::gpu_temperature_percent,
+            &Info::gpu_power_percent,
+            &Info::gpu_card_power_w,
+            &Info::vram_power_w,
+            &Info::vram_voltage_v,
+            &Info::vram_frequency_mhz,
+            &Info::vram_effective_frequency_gbps,
+            &Info::vram_temperature_c,
+            &Info::gpu_mem_write_bandwidth_bps,
+            &Info::gpu_mem_read_bandwidth_bps,
+        };
+        const auto t = impl::GetInterpolationFactor(lower.qpc, upper.qpc, qpc);
+        auto info = t < 0.5 ? lower : upper;
+        info.qpc = qpc;
+        for (auto member : measured) {
+            info.*member = impl::Lerp(lower.*member, upper.*member, t);
+        }
+        for (size_t i = 0; i < info.fan_speed_rpm.size(); i++) {
+            info.fan_speed_rpm[i] = impl::Lerp(lower.fan_speed_rpm[i], upper.fan_speed_rpm[i], t);
+        }
+        for (size_t i = 0; i < info.psu.size(); i++) {
+            info.psu[i].psu_power = impl::Lerp(lower.psu[i].psu_power, upper.psu[i].psu_power, t);
+            info.psu[i].psu_voltage = impl::Lerp(lower.psu[i].psu_voltage, upper.psu[i].psu_voltage, t);
+        }
+        return info;
+    }
+
+    inline CpuTelemetryInfo InterpolateTelemetry(const CpuTelemetryInfo& lower, const CpuTelemetryInfo& upper,
+        uint64_t qpc) noexcept
+    {
+        const auto t = impl::GetInterpolationFactor(lower.qpc, upper.qpc, qpc);
+        auto info = t < 0.5 ? lower : upper;
+        info.qpc = qpc;
+        info.cpu_utilization = impl::Lerp(lower.cpu_utilization, upper.cpu_utilization, t);
+        info.cpu_power_w = impl::Lerp(lower.cpu_power_w, upper.cpu_power_w, t);
+        info.cpu_temperature = impl::Lerp(lower.cpu_temperature, upper.cpu_temperature, t);
+        info.cpu_frequency = impl::Lerp(lower.cpu_frequency, upper.cpu_frequency, t);
+        return info;
+    }
+}
@@ -10,6 +10,16 @@
 namespace pwr::cpu {
     using namespace pmon::util;
 
+void CpuTelemetry::GetTelemetry(std::span<const uint64_t> qpcs,
+                                std::span<CpuTelemetryInfo> infos,
+                                bool interpolate) const noexcept {
+  for (size_t i = 0; i < qpcs.size(); i++) {
+    if (auto info = interpolate ? GetInterpolated(qpcs[i]) : GetClosest(qpcs[i])) {
+      infos[i] = *info;
+    }
+  }
+}
+
 std::string CpuTelemetry::GetCpuName() {
   if (cpu_name_.size() == 0) {
     std::wstring local_cpu_name{};
@@ -3,6 +3,7 @@
 #pragma once
 
 #include <optional>
+#include <span>
 #include <bitset>
 #include <vector>
 #include <Wbemidl.h>
@@ -19,6 +20,14 @@ class CpuTelemetry {
   virtual bool Sample() noexcept = 0;
   virtual std::optional<CpuTelemetryInfo> GetClosest(
       uint64_t qpc) const noexcept = 0;
+  // telemetry interpolated between the samples before and after qpc
+  virtual std::optional<CpuTelemetryInfo> GetInterpolated(
+      uint64_t qpc) const noexcept = 0;
+  // telemetry for each of qpcs, which must be in ascending order; infos are
+  // left untouched when there is no telemetry
+  virtual void GetTelemetry(std::span<const uint64_t> qpcs,
+                            std::span<CpuTelemetryInfo> infos,
+                            bool interpolate) const noexcept;
   void SetTelemetryCapBit(CpuTelemetryCapBits telemetryCapBit) noexcept
   {
       cpuTelemetryCapBits_.set(static_cast<size_t>(telemetryCapBit));
@@ -28,7 +37,7 @@ class CpuTelemetry {
       return cpuTelemetryCapBits_;
   }
 
-  std::string GetCpuName();
+  virtual std::string GetCpuName();
   double GetCpuPowerLimit() { return 0.; }
   
   // constants
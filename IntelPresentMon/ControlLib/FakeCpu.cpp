@@ -0,0 +1,71 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#include "FakeCpu.h"
+#include "../CommonUtilities/Qpc.h"
+#include <array>
+
+namespace pwr::cpu::fake {
+
+using namespace pmon::util;
+using ::pwr::fake::FakeTelemetryConfig;
+using Shape = ::pwr::fake::Waveform::Shape;
+using Cap = CpuTelemetryCapBits;
+
+namespace {
+// the telemetry that is generated, and its default waveforms
+const std::array<CpuTelemetryGenerator::Field, 5> cpuFields{{
+    {Cap::cpu_utilization, "cpu_utilization", {Shape::Sine, 40., 30., 0.5, 3.},
+     [](CpuTelemetryInfo& i, double v) { i.cpu_utilization = v; }, 100.},
+    {Cap::cpu_power, "cpu_power", {Shape::Sine, 45., 20., 0.5, 1.},
+     [](CpuTelemetryInfo& i, double v) { i.cpu_power_w = v; }},
+    {Cap::cpu_power_limit, "cpu_power_limit", {Shape::Constant, 125.},
+     [](CpuTelemetryInfo& i, double v) { i.cpu_power_limit_w = v; }},
+    {Cap::cpu_temperature, "cpu_temperature", {Shape::Sine, 60., 8., 0.05, 0.3},
+     [](CpuTelemetryInfo& i, double v) { i.cpu_temperature = v; }},
+    {Cap::cpu_frequency, "cpu_frequency", {Shape::Square, 4200., 600., 0.25},
+     [](CpuTelemetryInfo& i, double v) { i.cpu_frequency = v; }},
+}};
+}  // namespace
+
+// the cpu takes the device index after the adapters, so that its noise is
+// drawn apart from theirs
+FakeCpu::FakeCpu(const FakeTelemetryConfig& config)
+    : generator_{cpuFields, config, config.adapterCount},
+      start_qpc_{uint64_t(GetCurrentTimestamp())},
+      qpc_period_{GetTimestampPeriodSeconds()} {}
+
+bool FakeCpu::Sample() noexcept {
+  const auto qpc = uint64_t(GetCurrentTimestamp());
+  CpuTelemetryInfo info{.qpc = qpc};
+  const auto caps =
+      generator_.Generate(info, double(qpc - start_qpc_) * qpc_period_);
+  for (size_t i = 0; i < caps.size(); i++) {
+    if (caps[i]) {
+      SetTelemetryCapBit(CpuTelemetryCapBits(i));
+    }
+  }
+  history_.Push(info);
+  return true;
+}
+
+std::optional<CpuTelemetryInfo> FakeCpu::GetClosest(uint64_t qpc)
+      const noexcept {
+  return history_.GetNearest(qpc);
+}
+
+std::optional<CpuTelemetryInfo> FakeCpu::GetInterpolated(uint64_t qpc)
+      const noexcept {
+  return history_.GetInterpolated(qpc);
+}
+
+void FakeCpu::GetTelemetry(std::span<const uint64_t> qpcs,
+                           std::span<CpuTelemetryInfo> infos,
+                           bool interpolate) const noexcept {
+  if (interpolate) {
+    history_.GetInterpolated(qpcs, infos);
+  } else {
+    history_.GetNearest(qpcs, infos);
+  }
+}
+
+}  // namespace pwr::cpu::fake
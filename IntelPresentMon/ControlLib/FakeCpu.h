@@ -0,0 +1,38 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include "CpuTelemetry.h"
+#include "ConcurrentTelemetryHistory.h"
+#include "FakeTelemetrySource.h"
+#include <optional>
+
+namespace pwr::cpu::fake {
+
+using CpuTelemetryGenerator = ::pwr::fake::FakeTelemetryGenerator<
+    CpuTelemetryInfo, CpuTelemetryCapBits,
+    static_cast<size_t>(CpuTelemetryCapBits::cpu_telemetry_count)>;
+
+// Cpu whose telemetry is generated from waveforms or replayed from a recorded
+// trace instead of read from the system
+class FakeCpu : public CpuTelemetry {
+ public:
+  FakeCpu(const ::pwr::fake::FakeTelemetryConfig& config);
+  bool Sample() noexcept override;
+  std::optional<CpuTelemetryInfo> GetClosest(
+      uint64_t qpc) const noexcept override;
+  std::optional<CpuTelemetryInfo> GetInterpolated(
+      uint64_t qpc) const noexcept override;
+  void GetTelemetry(std::span<const uint64_t> qpcs,
+                    std::span<CpuTelemetryInfo> infos,
+                    bool interpolate) const noexcept override;
+  std::string GetCpuName() override { return "Fake CPU"; }
+
+ private:
+  // data
+  CpuTelemetryGenerator generator_;
+  uint64_t start_qpc_;
+  double qpc_period_;
+  ConcurrentTelemetryHistory<CpuTelemetryInfo> history_{CpuTelemetry::defaultHistorySize};
+};
+
+}  // namespace pwr::cpu::fake
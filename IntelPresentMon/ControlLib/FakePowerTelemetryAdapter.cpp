@@ -0,0 +1,150 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#include "FakePowerTelemetryAdapter.h"
+#include "../CommonUtilities/Qpc.h"
+#include <array>
+#include <format>
+
+namespace pwr::fake
+{
+    using namespace pmon::util;
+    using Shape = Waveform::Shape;
+    using Cap = GpuTelemetryCapBits;
+    using Info = PresentMonPowerTelemetryInfo;
+
+    namespace
+    {
+        // the telemetry that is generated, and its default waveforms
+        const std::array<GpuTelemetryGenerator::Field, 20> gpuFields{ {
+            { Cap::gpu_power, "gpu_power", { Shape::Sine, 150., 50., 0.5, 2. },
+                [](Info& i, double v) { i.gpu_power_w = v; } },
+            { Cap::gpu_card_power, "gpu_card_power", { Shape::Sine, 175., 55., 0.5, 2. },
+                [](Info& i, double v) { i.gpu_card_power_w = v; } },
+            { Cap::gpu_sustained_power_limit, "gpu_sustained_power_limit",
+                { Shape::Constant, FakePowerTelemetryAdapter::sustainedPowerLimitW },
+                [](Info& i, double v) { i.gpu_sustained_power_limit_w = v; } },
+            { Cap::gpu_power_percent, "gpu_power_percent", { Shape::Sine, 75., 25., 0.5, 1. },
+                [](Info& i, double v) { i.gpu_power_percent = v; }, 100. },
+            { Cap::gpu_voltage, "gpu_voltage", { Shape::Sine, 0.9, 0.1, 0.5, 0.005 },
+                [](Info& i, double v) { i.gpu_voltage_v = v; } },
+            { Cap::gpu_frequency, "gpu_frequency", { Shape::Square, 1750., 250., 0.25 },
+                [](Info& i, double v) { i.gpu_frequency_mhz = v; } },
+            { Cap::gpu_effective_frequency, "gpu_effective_frequency", { Shape::Square, 1700., 250., 0.25, 10. },
+                [](Info& i, double v) { i.gpu_effective_frequency_mhz = v; } },
+            { Cap::gpu_temperature, "gpu_temperature", { Shape::Sine, 65., 5., 0.05, 0.2 },
+                [](Info& i, double v) { i.gpu_temperature_c = v; } },
+            { Cap::gpu_utilization, "gpu_utilization", { Shape::Sine, 70., 25., 1., 3. },
+                [](Info& i, double v) { i.gpu_utilization = v; }, 100. },
+            { Cap::gpu_render_compute_utilization, "gpu_render_compute_utilization", { Shape::Sine, 65., 25., 1., 3. },
+                [](Info& i, double v) { i.gpu_render_compute_utilization = v; }, 100. },
+            { Cap::gpu_media_utilization, "gpu_media_utilization", { Shape::Square, 10., 10., 0.1, 1. },
+                [](Info& i, double v) { i.gpu_media_utilization = v; }, 100. },
+            { Cap::vram_power, "vram_power", { Shape::Sine, 20., 5., 0.5, 0.5 },
+                [](Info& i, double v) { i.vram_power_w = v; } },
+            { Cap::vram_voltage, "vram_voltage", { Shape::Constant, 1.35 },
+                [](Info& i, double v) { i.vram_voltage_v = v; } },
+            { Cap::vram_frequency, "vram_frequency", { Shape::Constant, 1000. },
+                [](Info& i, double v) { i.vram_frequency_mhz = v; } },
+            { Cap::vram_temperature, "vram_temperature", { Shape::Sine, 70., 3., 0.05, 0.2 },
+                [](Info& i, double v) { i.vram_temperature_c = v; } },
+            { Cap::fan_speed_0, "fan_speed_0", { Shape::Sine, 1500., 300., 0.02, 10. },
+                [](Info& i, double v) { i.fan_speed_rpm[0] = v; } },
+            { Cap::gpu_mem_size, "gpu_mem_size", { Shape::Constant, double(FakePowerTelemetryAdapter::dedicatedVideoMemory) },
+                [](Info& i, double v) { i.gpu_mem_total_size_b = uint64_t(v); } },
+            { Cap::gpu_mem_used, "gpu_mem_used", { Shape::Sine, 4e9, 1e9, 0.1, 1e6 },
+                [](Info& i, double v) { i.gpu_mem_used_b = uint64_t(v); } },
+            { Cap::gpu_mem_write_bandwidth, "gpu_mem_write_bandwidth", { Shape::Sine, 60e9, 20e9, 1., 1e9 },
+                [](Info& i, double v) { i.gpu_mem_write_bandwidth_bps = v; } },
+            { Cap::gpu_mem_read_bandwidth, "gpu_mem_read_bandwidth", { Shape::Sine, 120e9, 40e9, 1., 2e9 },
+                [](Info& i, double v) { i.gpu_mem_read_bandwidth_bps = v; } },
+        } };
+    }
+
+    FakePowerTelemetryAdapter::FakePowerTelemetryAdapter(const FakeTelemetryConfig& config, uint32_t index)
+        :
+        name{ std::format("Fake Adapter {}", index) },
+        generator{ gpuFields, config, index },
+        fastPowerRng{ config.seed + index },
+        startQpc{ uint64_t(GetCurrentTimestamp()) },
+        qpcPeriod{ GetTimestampPeriodSeconds() }
+    {}
+
+    bool FakePowerTelemetryAdapter::Sample() noexcept
+    {
+        const auto qpc = uint64_t(GetCurrentTimestamp());
+        PresentMonPowerTelemetryInfo info{
+            .qpc = qpc,
+            .gpu_mem_max_bandwidth_bps = videoMemoryMaxBandwidth,
+        };
+        auto caps = generator.Generate(info, GetSeconds_(qpc));
+        caps.set(size_t(Cap::gpu_mem_max_bandwidth));
+        for (size_t i = 0; i < caps.size(); i++) {
+            if (caps[i]) {
+                SetTelemetryCapBit(GpuTelemetryCapBits(i));
+            }
+        }
+        history.Push(info);
+        return true;
+    }
+
+    std::optional<PresentMonPowerTelemetryInfo> FakePowerTelemetryAdapter::GetClosest(uint64_t qpc) const noexcept
+    {
+        return history.GetNearest(qpc);
+    }
+
+    std::optional<PresentMonPowerTelemetryInfo> FakePowerTelemetryAdapter::GetInterpolated(uint64_t qpc) const noexcept
+    {
+        return history.GetInterpolated(qpc);
+    }
+
+    void FakePowerTelemetryAdapter::GetTelemetry(std::span<const uint64_t> qpcs,
+        std::span<PresentMonPowerTelemetryInfo> infos, bool interpolate) const noexcept
+    {
+        if (interpolate) {
+            history.GetInterpolated(qpcs, infos);
+        }
+        else {
+            history.GetNearest(qpcs, infos);
+        }
+    }
+
+    PM_DEVICE_VENDOR FakePowerTelemetryAdapter::GetVendor() const noexcept
+    {
+        return PM_DEVICE_VENDOR_UNKNOWN;
+    }
+
+    std::string FakePowerTelemetryAdapter::GetName() const noexcept
+    {
+        return name;
+    }
+
+    uint64_t FakePowerTelemetryAdapter::GetDedicatedVideoMemory() const noexcept
+    {
+        return dedicatedVideoMemory;
+    }
+
+    uint64_t FakePowerTelemetryAdapter::GetVideoMemoryMaxBandwidth() const noexcept
+    {
+        return videoMemoryMaxBandwidth;
+    }
+
+    double FakePowerTelemetryAdapter::GetSustainedPowerLimit() const noexcept
+    {
+        return sustainedPowerLimitW;
+    }
+
+    std::optional<FastPowerReading> FakePowerTelemetryAdapter::ReadFastPower() noexcept
+    {
+        const auto power = generator.GetValue(Cap::gpu_power, GetSeconds_(uint64_t(GetCurrentTimestamp())),
+            fastPowerRng);
+        if (!power) {
+            return {};
+        }
+        return FastPowerReading{ .power_w = *power };
+    }
+
+    double FakePowerTelemetryAdapter::GetSeconds_(uint64_t qpc) const noexcept
+    {
+        return double(qpc - startQpc) * qpcPeriod;
+    }
+}
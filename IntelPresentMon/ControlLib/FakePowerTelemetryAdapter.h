@@ -0,0 +1,49 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include "PowerTelemetryAdapter.h"
+#include "ConcurrentTelemetryHistory.h"
+#include "FakeTelemetrySource.h"
+#include <optional>
+#include <random>
+
+namespace pwr::fake
+{
+    using GpuTelemetryGenerator = FakeTelemetryGenerator<PresentMonPowerTelemetryInfo, GpuTelemetryCapBits,
+        static_cast<size_t>(GpuTelemetryCapBits::gpu_telemetry_count)>;
+
+    // Adapter whose telemetry is generated from waveforms or replayed from a recorded trace instead of read
+    // from a device, so that the telemetry path can be benchmarked without one
+    class FakePowerTelemetryAdapter : public PowerTelemetryAdapter
+    {
+    public:
+        FakePowerTelemetryAdapter(const FakeTelemetryConfig& config, uint32_t index);
+        bool Sample() noexcept override;
+        std::optional<PresentMonPowerTelemetryInfo> GetClosest(uint64_t qpc) const noexcept override;
+        std::optional<PresentMonPowerTelemetryInfo> GetInterpolated(uint64_t qpc) const noexcept override;
+        void GetTelemetry(std::span<const uint64_t> qpcs, std::span<PresentMonPowerTelemetryInfo> infos,
+            bool interpolate) const noexcept override;
+        PM_DEVICE_VENDOR GetVendor() const noexcept override;
+        std::string GetName() const noexcept override;
+        uint64_t GetDedicatedVideoMemory() const noexcept override;
+        uint64_t GetVideoMemoryMaxBandwidth() const noexcept override;
+        double GetSustainedPowerLimit() const noexcept override;
+        std::optional<FastPowerReading> ReadFastPower() noexcept override;
+        // constants
+        static constexpr uint64_t dedicatedVideoMemory = 8ull << 30;
+        static constexpr uint64_t videoMemoryMaxBandwidth = 512'000'000'000ull;
+        static constexpr double sustainedPowerLimitW = 200.;
+
+    private:
+        // functions
+        double GetSeconds_(uint64_t qpc) const noexcept;
+        // data
+        std::string name;
+        GpuTelemetryGenerator generator;
+        // noise of the fast power readings, which are taken on a thread of their own
+        std::mt19937 fastPowerRng;
+        uint64_t startQpc;
+        double qpcPeriod;
+        ConcurrentTelemetryHistory<PresentMonPowerTelemetryInfo> history{ PowerTelemetryAdapter::defaultHistorySize };
+    };
+}
@@ -0,0 +1,24 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#include "FakePowerTelemetryProvider.h"
+#include "FakePowerTelemetryAdapter.h"
+
+namespace pwr::fake
+{
+    FakePowerTelemetryProvider::FakePowerTelemetryProvider(const FakeTelemetryConfig& config)
+    {
+        for (uint32_t i = 0; i < config.adapterCount; i++) {
+            adapterPtrs.push_back(std::make_shared<FakePowerTelemetryAdapter>(config, i));
+        }
+    }
+
+    const std::vector<std::shared_ptr<PowerTelemetryAdapter>>& FakePowerTelemetryProvider::GetAdapters() noexcept
+    {
+        return adapterPtrs;
+    }
+
+    uint32_t FakePowerTelemetryProvider::GetAdapterCount() const noexcept
+    {
+        return uint32_t(adapterPtrs.size());
+    }
+}
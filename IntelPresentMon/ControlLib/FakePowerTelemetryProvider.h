@@ -0,0 +1,22 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <vector>
+#include <memory>
+#include "PowerTelemetryProvider.h"
+#include "FakeTelemetrySource.h"
+
+namespace pwr::fake
+{
+    // provides config.adapterCount adapters of synthetic telemetry
+    class FakePowerTelemetryProvider : public PowerTelemetryProvider
+    {
+    public:
+        FakePowerTelemetryProvider(const FakeTelemetryConfig& config);
+        const std::vector<std::shared_ptr<PowerTelemetryAdapter>>& GetAdapters() noexcept override;
+        uint32_t GetAdapterCount() const noexcept override;
+
+    private:
+        std::vector<std::shared_ptr<PowerTelemetryAdapter>> adapterPtrs;
+    };
+}
@@ -0,0 +1,348 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <algorithm>
+#include <bitset>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <numbers>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace pwr::fake
+{
+    namespace impl
+    {
+        inline std::string_view Trim(std::string_view s) noexcept
+        {
+            const auto first = s.find_first_not_of(" \t\r\n");
+            if (first == std::string_view::npos) {
+                return {};
+            }
+            return s.substr(first, s.find_last_not_of(" \t\r\n") - first + 1);
+        }
+
+        inline std::optional<double> ParseNumber(std::string_view s) noexcept
+        {
+            s = Trim(s);
+            double value = 0.;
+            const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+            if (s.empty() || ec != std::errc{} || end != s.data() + s.size()) {
+                return {};
+            }
+            return value;
+        }
+
+        inline std::vector<std::string_view> Split(std::string_view s, char delimiter)
+        {
+            std::vector<std::string_view> parts;
+            while (true) {
+                const auto split = s.find(delimiter);
+                parts.push_back(s.substr(0, split));
+                if (split == std::string_view::npos) {
+                    return parts;
+                }
+                s.remove_prefix(split + 1);
+            }
+        }
+    }
+
+    // Waveform of a kind of synthetic telemetry after the fake metrics of the overlay: a sine (as in
+    // NoisySineFakeMetric) or square wave (as in SquareWaveMetric) of amplitude about offset, with gaussian
+    // noise of standard deviation noise on top
+    struct Waveform
+    {
+        // types
+        enum class Shape
+        {
+            Constant,
+            Sine,
+            Square,
+        };
+        // functions
+        // value at t seconds, drawing the noise from rng
+        double Evaluate(double t, std::mt19937& rng) const;
+        // from shape:offset,amplitude,frequency,noise with shape one of const, sine or square (for example
+        // sine:150,50,0.5,2); numbers left out at the end are 0
+        static std::optional<Waveform> Parse(std::string_view spec);
+        // data
+        Shape shape = Shape::Constant;
+        double offset = 0.;
+        double amplitude = 0.;
+        // in Hz
+        double frequency = 0.;
+        double noise = 0.;
+    };
+
+    // Recorded telemetry replayed in place of waveforms, from a CSV with a header row whose first column is
+    // the time in seconds and whose other columns are named by the telemetry cap they hold (for example
+    // time,gpu_power,gpu_temperature). The trace loops once its end is reached.
+    class TelemetryTrace
+    {
+    public:
+        // empty if the CSV is malformed or holds no rows
+        static std::optional<TelemetryTrace> Load(std::istream& csv);
+        // column holding cap, or empty if the trace does not hold it
+        std::optional<size_t> FindColumn(std::string_view cap) const noexcept;
+        // value of column at t seconds into the replay, interpolated between the rows around it
+        double GetValue(size_t column, double t) const noexcept;
+        double GetDuration() const noexcept;
+    private:
+        // data
+        std::vector<std::string> names;
+        // times relative to the first row
+        std::vector<double> times;
+        std::vector<std::vector<double>> columns;
+    };
+
+    // Synthetic telemetry generated in place of that of the devices, to benchmark the telemetry path without
+    // them
+    struct FakeTelemetryConfig
+    {
+        // number of synthetic graphics adapters
+        uint32_t adapterCount = 1;
+        // waveforms by cap name, in place of the default waveforms of those caps
+        std::vector<std::pair<std::string, Waveform>> waveforms;
+        // recorded telemetry replayed for the caps it holds, in place of their waveforms
+        std::shared_ptr<const TelemetryTrace> trace;
+        // speed at which the trace is replayed
+        double replaySpeed = 1.;
+        // seed of the noise, so that runs are repeatable; each device adds its index to it
+        uint32_t seed = 0;
+    };
+
+    // Generates telemetry of type I, whose kinds are the caps C (N of them), from a table of the fields that
+    // are generated, giving each of them the cap it is, its name and default waveform, and how it is set in I
+    template<class I, class C, size_t N>
+    class FakeTelemetryGenerator
+    {
+    public:
+        // types
+        struct Field
+        {
+            C cap;
+            const char* name;
+            Waveform waveform;
+            void(*set)(I& info, double value);
+            // values are clamped to [0, max]
+            double max = std::numeric_limits<double>::max();
+        };
+        // functions
+        FakeTelemetryGenerator(std::span<const Field> fields, const FakeTelemetryConfig& config, uint32_t device);
+        // sets the telemetry at t seconds into the generation in info, and returns the caps that were set;
+        // only to be called from one thread at a time
+        std::bitset<N> Generate(I& info, double t);
+        // value of cap alone at t, or empty if it is not generated; noise is drawn from noiseRng so that this can
+        // be called from another thread than Generate
+        std::optional<double> GetValue(C cap, double t, std::mt19937& noiseRng) const;
+    private:
+        // types
+        struct Source_
+        {
+            Field field;
+            std::optional<size_t> traceColumn;
+        };
+        // functions
+        double Evaluate_(const Source_& source, double t, std::mt19937& noiseRng) const;
+        // data
+        std::vector<Source_> sources;
+        std::shared_ptr<const TelemetryTrace> trace;
+        double replaySpeed;
+        std::mt19937 rng;
+    };
+
+    inline double Waveform::Evaluate(double t, std::mt19937& rng) const
+    {
+        auto value = offset;
+        switch (shape) {
+        case Shape::Sine:
+            value += amplitude * std::sin(2. * std::numbers::pi * frequency * t);
+            break;
+        case Shape::Square:
+            // the high half of the cycle comes first
+            if (frequency > 0.) {
+                value += std::fmod(t * frequency, 1.) < 0.5 ? amplitude : -amplitude;
+            }
+            break;
+        default:
+            break;
+        }
+        if (noise > 0.) {
+            value += std::normal_distribution<double>{ 0., noise }(rng);
+        }
+        return value;
+    }
+
+    inline std::optional<Waveform> Waveform::Parse(std::string_view spec)
+    {
+        const auto split = spec.find(':');
+        const auto shapeName = impl::Trim(spec.substr(0, split));
+        Waveform waveform;
+        if (shapeName == "const") {
+            waveform.shape = Shape::Constant;
+        }
+        else if (shapeName == "sine") {
+            waveform.shape = Shape::Sine;
+        }
+        else if (shapeName == "square") {
+            waveform.shape = Shape::Square;
+        }
+        else {
+            return {};
+        }
+        if (split == std::string_view::npos) {
+            return waveform;
+        }
+        const auto numbers = impl::Split(spec.substr(split + 1), ',');
+        double* const params[]{ &waveform.offset, &waveform.amplitude, &waveform.frequency, &waveform.noise };
+        if (numbers.size() > std::size(params)) {
+            return {};
+        }
+        for (size_t i = 0; i < numbers.size(); i++) {
+            const auto number = impl::ParseNumber(numbers[i]);
+            if (!number) {
+                return {};
+            }
+            *params[i] = *number;
+        }
+        return waveform;
+    }
+
+    inline std::optional<TelemetryTrace> TelemetryTrace::Load(std::istream& csv)
+    {
+        TelemetryTrace trace;
+        std::string line;
+        // header
+        while (std::getline(csv, line) && impl::Trim(line).empty()) {}
+        const auto header = impl::Split(impl::Trim(line), ',');
+        if (header.size() < 2) {
+            return {};
+        }
+        for (size_t i = 1; i < header.size(); i++) {
+            trace.names.emplace_back(impl::Trim(header[i]));
+        }
+        trace.columns.resize(trace.names.size());
+        // rows
+        while (std::getline(csv, line)) {
+            if (impl::Trim(line).empty()) {
+                continue;
+            }
+            const auto cells = impl::Split(impl::Trim(line), ',');
+            if (cells.size() != header.size()) {
+                return {};
+            }
+            const auto time = impl::ParseNumber(cells[0]);
+            if (!time || (!trace.times.empty() && *time < trace.times.back())) {
+                return {};
+            }
+            trace.times.push_back(*time);
+            for (size_t i = 1; i < cells.size(); i++) {
+                const auto value = impl::ParseNumber(cells[i]);
+                if (!value) {
+                    return {};
+                }
+                trace.columns[i - 1].push_back(*value);
+            }
+        }
+        if (trace.times.empty()) {
+            return {};
+        }
+        const auto start = trace.times.front();
+        for (auto& time : trace.times) {
+            time -= start;
+        }
+        return trace;
+    }
+
+    inline std::optional<size_t> TelemetryTrace::FindColumn(std::string_view cap) const noexcept
+    {
+        const auto i = std::ranges::find(names, cap);
+        if (i == names.end()) {
+            return {};
+        }
+        return size_t(i - names.begin());
+    }
+
+    inline double TelemetryTrace::GetValue(size_t column, double t) const noexcept
+    {
+        const auto& values = columns[column];
+        const auto duration = GetDuration();
+        if (duration <= 0.) {
+            return values.front();
+        }
+        t = std::fmod(std::max(t, 0.), duration);
+        // first row after t, of which there is always one as t is short of the duration
+        const auto upper = size_t(std::ranges::upper_bound(times, t) - times.begin());
+        const auto lower = upper - 1;
+        const auto span = times[upper] - times[lower];
+        const auto factor = span > 0. ? (t - times[lower]) / span : 0.;
+        return values[lower] + (values[upper] - values[lower]) * factor;
+    }
+
+    inline double TelemetryTrace::GetDuration() const noexcept
+    {
+        return times.back();
+    }
+
+    template<class I, class C, size_t N>
+    FakeTelemetryGenerator<I, C, N>::FakeTelemetryGenerator(std::span<const Field> fields,
+        const FakeTelemetryConfig& config, uint32_t device)
+        :
+        trace{ config.trace },
+        replaySpeed{ config.replaySpeed },
+        rng{ config.seed + device }
+    {
+        for (const auto& field : fields) {
+            Source_ source{ .field = field };
+            for (const auto& [name, waveform] : config.waveforms) {
+                if (name == field.name) {
+                    source.field.waveform = waveform;
+                }
+            }
+            if (trace) {
+                source.traceColumn = trace->FindColumn(field.name);
+            }
+            sources.push_back(source);
+        }
+    }
+
+    template<class I, class C, size_t N>
+    std::bitset<N> FakeTelemetryGenerator<I, C, N>::Generate(I& info, double t)
+    {
+        std::bitset<N> caps;
+        for (const auto& source : sources) {
+            source.field.set(info, Evaluate_(source, t, rng));
+            caps.set(size_t(source.field.cap));
+        }
+        return caps;
+    }
+
+    template<class I, class C, size_t N>
+    std::optional<double> FakeTelemetryGenerator<I, C, N>::GetValue(C cap, double t, std::mt19937& noiseRng) const
+    {
+        for (const auto& source : sources) {
+            if (source.field.cap == cap) {
+                return Evaluate_(source, t, noiseRng);
+            }
+        }
+        return {};
+    }
+
+    template<class I, class C, size_t N>
+    double FakeTelemetryGenerator<I, C, N>::Evaluate_(const Source_& source, double t, std::mt19937& noiseRng) const
+    {
+        const auto value = source.traceColumn ?
+            trace->GetValue(*source.traceColumn, t * replaySpeed) :
+            source.field.waveform.Evaluate(t, noiseRng);
+        return std::clamp(value, 0., source.field.max);
+    }
+}
@@ -0,0 +1,166 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include "ConcurrentTelemetryHistory.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+namespace pwr
+{
+    // cheap reading of gpu power, taken at a high rate apart from the other telemetry
+    struct FastPowerReading
+    {
+        // monotonic energy counter of the device in joules, empty if the device only reports power
+        std::optional<double> energy_j;
+        // power in watts, only used if there is no energy counter
+        double power_w = 0.;
+    };
+
+    // gpu energy used over a frame, and the average power over it
+    struct FrameEnergy
+    {
+        double energy_j;
+        double power_w;
+    };
+
+    // sample of the fast power history, kept in fixed point so that several seconds of it at 1 kHz stay small
+    struct FastPowerSample
+    {
+        uint64_t qpc;
+        // energy used since the first sample, in microjoules
+        uint64_t energy_uj;
+        // power at qpc, in milliwatts
+        uint32_t power_mw;
+    };
+
+    // History of gpu power sampled at a high rate (1 kHz and up) by a thread of its own, from which the energy
+    // of each frame is integrated. Energy is accumulated from the energy counter of the device where it has
+    // one, and otherwise from the power readings by the trapezoidal rule; the energy between two qpcs is then
+    // the difference of the accumulated energy interpolated at each of them.
+    class FastPowerHistory
+    {
+    public:
+        // qpcPeriod is the length of a qpc tick in seconds
+        FastPowerHistory(size_t size, double qpcPeriod);
+        // only to be called from the fast power sampling thread
+        void Push(uint64_t qpc, const FastPowerReading& reading) noexcept;
+        // energy used from startQpc to endQpc, or empty if the history does not cover that span. Frames
+        // often end just after the newest sample, so the power of the newest sample is held for up to
+        // maxHeldIntervals sampling intervals past it.
+        std::optional<FrameEnergy> GetFrameEnergy(uint64_t startQpc, uint64_t endQpc) const noexcept;
+        // constants
+        static constexpr uint64_t maxHeldIntervals = 2;
+    private:
+        // functions
+        std::optional<double> GetEnergy_(uint64_t qpc) const noexcept;
+        // data
+        ConcurrentTelemetryHistory<FastPowerSample> history;
+        double qpcPeriod;
+        // qpc ticks between the two newest samples
+        std::atomic<uint64_t> intervalQpc = 0;
+        // state of the sampling thread
+        std::optional<uint64_t> lastQpc;
+        std::optional<double> lastCounterJ;
+        double lastPowerW = 0.;
+        double energyJ = 0.;
+    };
+
+    // Linear interpolation of the energy and power of two fast power samples at qpc, lower.qpc <= qpc < upper.qpc
+    inline FastPowerSample InterpolateTelemetry(const FastPowerSample& lower, const FastPowerSample& upper,
+        uint64_t qpc) noexcept
+    {
+        const auto t = impl::GetInterpolationFactor(lower.qpc, upper.qpc, qpc);
+        return FastPowerSample{
+            .qpc = qpc,
+            .energy_uj = lower.energy_uj + uint64_t(std::llround(double(upper.energy_uj - lower.energy_uj) * t)),
+            .power_mw = uint32_t(std::lround(impl::Lerp(double(lower.power_mw), double(upper.power_mw), t))),
+        };
+    }
+
+    inline FastPowerHistory::FastPowerHistory(size_t size, double qpcPeriod_)
+        :
+        history{ size },
+        qpcPeriod{ qpcPeriod_ }
+    {}
+
+    inline void FastPowerHistory::Push(uint64_t qpc, const FastPowerReading& reading) noexcept
+    {
+        // samples must be in qpc order
+        if (lastQpc && qpc <= *lastQpc) {
+            return;
+        }
+        auto power = reading.power_w;
+        if (lastQpc) {
+            const auto dt = double(qpc - *lastQpc) * qpcPeriod;
+            if (reading.energy_j && lastCounterJ) {
+                // counters that wrap or are reset step back, which is taken as no energy used
+                const auto energy = std::max(*reading.energy_j - *lastCounterJ, 0.);
+                energyJ += energy;
+                power = energy / dt;
+            }
+            else {
+                energyJ += (lastPowerW + power) * 0.5 * dt;
+            }
+            intervalQpc.store(qpc - *lastQpc, std::memory_order_relaxed);
+        }
+        else if (reading.energy_j) {
+            // the power is not known until there is a counter delta
+            power = 0.;
+        }
+        lastQpc = qpc;
+        lastCounterJ = reading.energy_j;
+        lastPowerW = power;
+        history.Push(FastPowerSample{
+            .qpc = qpc,
+            .energy_uj = uint64_t(std::llround(energyJ * 1'000'000.)),
+            .power_mw = uint32_t(std::clamp(std::round(power * 1'000.), 0.,
+                double(std::numeric_limits<uint32_t>::max()))),
+        });
+    }
+
+    inline std::optional<double> FastPowerHistory::GetEnergy_(uint64_t qpc) const noexcept
+    {
+        const auto sample = history.GetInterpolated(qpc);
+        if (!sample) {
+            return {};
+        }
+        const auto energy = double(sample->energy_uj) / 1'000'000.;
+        if (sample->qpc == qpc) {
+            return energy;
+        }
+        // before the oldest sample there is nothing to go by
+        if (qpc < sample->qpc) {
+            return {};
+        }
+        // past the newest sample
+        const auto held = qpc - sample->qpc;
+        if (held > maxHeldIntervals * intervalQpc.load(std::memory_order_relaxed)) {
+            return {};
+        }
+        return energy + double(sample->power_mw) / 1'000. * double(held) * qpcPeriod;
+    }
+
+    inline std::optional<FrameEnergy> FastPowerHistory::GetFrameEnergy(uint64_t startQpc, uint64_t endQpc) const noexcept
+    {
+        if (startQpc == 0 || endQpc <= startQpc) {
+            return {};
+        }
+        const auto start = GetEnergy_(startQpc);
+        if (!start) {
+            return {};
+        }
+        const auto end = GetEnergy_(endQpc);
+        if (!end) {
+            return {};
+        }
+        const auto energy = std::max(*end - *start, 0.);
+        return FrameEnergy{
+            .energy_j = energy,
+            .power_w = energy / (double(endQpc - startQpc) * qpcPeriod),
+        };
+    }
+}
@@ -272,7 +272,6 @@ namespace pwr::intel
 
     std::optional<PresentMonPowerTelemetryInfo> IntelPowerTelemetryAdapter::GetClosest(uint64_t qpc) const noexcept
     {
-        std::lock_guard<std::mutex> lock(historyMutex);
         const auto nearest = history.GetNearest(qpc);
         if constexpr (PMLOG_BUILD_LEVEL_ >= pmon::util::log::Level::Verbose) {
             if (!nearest) {
@@ -285,6 +284,22 @@ namespace pwr::intel
         return nearest;
     }
 
+    std::optional<PresentMonPowerTelemetryInfo> IntelPowerTelemetryAdapter::GetInterpolated(uint64_t qpc) const noexcept
+    {
+        return history.GetInterpolated(qpc);
+    }
+
+    void IntelPowerTelemetryAdapter::GetTelemetry(std::span<const uint64_t> qpcs,
+        std::span<PresentMonPowerTelemetryInfo> infos, bool interpolate) const noexcept
+    {
+        if (interpolate) {
+            history.GetInterpolated(qpcs, infos);
+        }
+        else {
+            history.GetNearest(qpcs, infos);
+        }
+    }
+
     PM_DEVICE_VENDOR IntelPowerTelemetryAdapter::GetVendor() const noexcept
     {
         return PM_DEVICE_VENDOR::PM_DEVICE_VENDOR_INTEL;
@@ -353,6 +368,25 @@ namespace pwr::intel
         return gpuSustainedPowerLimit / 1000.;
     }
 
+    std::optional<FastPowerReading> IntelPowerTelemetryAdapter::ReadFastPower() noexcept
+    {
+        if (powerDomains.empty()) {
+            return {};
+        }
+        // the energy counter of the package domain is a single lock-free read
+        ctl_power_energy_counter_t counter{
+            .Size = sizeof(ctl_power_energy_counter_t),
+        };
+        if (const auto result = ctlPowerGetEnergyCounter(powerDomains[0], &counter);
+            result != CTL_RESULT_SUCCESS) {
+            // called at a high rate, so failures are not logged at error level
+            pmlog_verb(v::tele_gpu)("ctlPowerGetEnergyCounter failed").code(result).pmwatch(GetName());
+            return {};
+        }
+        // Control lib returns back in microjoules
+        return FastPowerReading{ .energy_j = double(counter.energy) / 1'000'000. };
+    }
+
     // private implementation functions
 
     ctl_result_t IntelPowerTelemetryAdapter::EnumerateMemoryModules()
@@ -980,7 +1014,6 @@ namespace pwr::intel
     void IntelPowerTelemetryAdapter::SavePmPowerTelemetryData(PresentMonPowerTelemetryInfo& info)
     {
         pmlog_verb(v::tele_gpu)("Saving gathered telemetry info to history").pmwatch(GetName()).pmwatch(ref::DumpStatic(info));
-        std::lock_guard<std::mutex> lock(historyMutex);
         history.Push(info);
     }
 
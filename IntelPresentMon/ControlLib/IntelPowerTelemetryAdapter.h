@@ -5,9 +5,8 @@
 #include <Windows.h>
 #include "igcl_api.h"
 #include "PowerTelemetryAdapter.h"
-#include "TelemetryHistory.h"
+#include "ConcurrentTelemetryHistory.h"
 #include "ctlpvttemp_api.h"
-#include <mutex>
 #include <optional>
 #include <variant>
 
@@ -19,11 +18,15 @@ namespace pwr::intel
 		IntelPowerTelemetryAdapter(ctl_device_adapter_handle_t handle);
 		bool Sample() noexcept override;
 		std::optional<PresentMonPowerTelemetryInfo> GetClosest(uint64_t qpc) const noexcept override;
+		std::optional<PresentMonPowerTelemetryInfo> GetInterpolated(uint64_t qpc) const noexcept override;
+		void GetTelemetry(std::span<const uint64_t> qpcs, std::span<PresentMonPowerTelemetryInfo> infos,
+		    bool interpolate) const noexcept override;
 		PM_DEVICE_VENDOR GetVendor() const noexcept override;
 		std::string GetName() const noexcept override;
         uint64_t GetDedicatedVideoMemory() const noexcept override;
 		uint64_t GetVideoMemoryMaxBandwidth() const noexcept override;
 		double GetSustainedPowerLimit() const noexcept override;
+		std::optional<FastPowerReading> ReadFastPower() noexcept override;
 
 		// types
 		class NonGraphicsDeviceException : public std::exception {};
@@ -96,8 +99,7 @@ namespace pwr::intel
 		ctl_device_adapter_properties_t properties{};
 		std::vector<ctl_mem_handle_t> memoryModules;
 		std::vector<ctl_pwr_handle_t> powerDomains;
-		mutable std::mutex historyMutex;
-		TelemetryHistory<PresentMonPowerTelemetryInfo> history{ PowerTelemetryAdapter::defaultHistorySize };
+		ConcurrentTelemetryHistory<PresentMonPowerTelemetryInfo> history{ PowerTelemetryAdapter::defaultHistorySize };
 		SampleVariantType previousSampleVariant;
 		bool useV1PowerTelemetry = true;
 		bool useNewBandwidthTelemetry = true;
@@ -48,6 +48,15 @@ namespace pwr::nv
         return 0.f;
     }
 
+    std::optional<FastPowerReading> NvidiaPowerTelemetryAdapter::ReadFastPower() noexcept
+    {
+        unsigned int powerMw = 0;
+        if (!hNvml || !nvml->Ok(nvml->DeviceGetPowerUsage(*hNvml, &powerMw))) {
+            return {};
+        }
+        return FastPowerReading{ .power_w = double(powerMw) / 1000. };
+    }
+
     bool NvidiaPowerTelemetryAdapter::Sample() noexcept
     {
         LARGE_INTEGER qpc;
@@ -58,6 +67,8 @@ namespace pwr::nv
         };
         
         // nvapi-sourced telemetry
+        // each call is skipped unless the telemetry it reads is being sampled
+        if (IsSampling(GpuTelemetryCapBits::gpu_temperature) || IsSampling(GpuTelemetryCapBits::vram_temperature))
         {// gpu and vram temperatures
             NV_GPU_THERMAL_SETTINGS thermals = {
                 .version = NV_GPU_THERMAL_SETTINGS_VER_2
@@ -82,7 +93,12 @@ namespace pwr::nv
             }
             // TODO: consider logging failure (lower logging level perhaps)
         }
+        else {
+            info.gpu_temperature_c = lastSample.gpu_temperature_c;
+            info.vram_temperature_c = lastSample.vram_temperature_c;
+        }
 
+        if (IsSampling(GpuTelemetryCapBits::gpu_frequency) || IsSampling(GpuTelemetryCapBits::vram_frequency))
         {// gpu and vram clock frequencies
             NV_GPU_CLOCK_FREQUENCIES freqs{
                 .version = NV_GPU_CLOCK_FREQUENCIES_VER_3
@@ -104,7 +120,12 @@ namespace pwr::nv
             }
             // TODO: consider logging failure (lower logging level perhaps)
         }
+        else {
+            info.gpu_frequency_mhz = lastSample.gpu_frequency_mhz;
+            info.vram_frequency_mhz = lastSample.vram_frequency_mhz;
+        }
 
+        if (IsSampling(GpuTelemetryCapBits::fan_speed_0) || IsSampling(GpuTelemetryCapBits::max_fan_speed_0))
         {// fan speed
             NvU32 tach = 0;
             if (nvapi->Ok(nvapi->GPU_GetTachReading(hNvapi, &tach)))
@@ -114,7 +135,11 @@ namespace pwr::nv
             }
             // TODO: consider logging failure (lower logging level perhaps)
         }
+        else {
+            info.fan_speed_rpm[0] = lastSample.fan_speed_rpm[0];
+        }
 
+        if (IsSampling(GpuTelemetryCapBits::gpu_utilization) || IsSampling(GpuTelemetryCapBits::gpu_media_utilization))
         {// gpu utilization
             NV_GPU_DYNAMIC_PSTATES_INFO_EX pstates{
                 .version = NV_GPU_DYNAMIC_PSTATES_INFO_EX_VER
@@ -136,11 +161,16 @@ namespace pwr::nv
             }
             // TODO: consider logging failure (lower logging level perhaps)
         }
+        else {
+            info.gpu_utilization = lastSample.gpu_utilization;
+            info.gpu_media_utilization = lastSample.gpu_media_utilization;
+        }
 
 
         // nvml-sourced telemetry (if we have a valid nvml handle)
         if (*hNvml)
         {
+            if (IsSampling(GpuTelemetryCapBits::gpu_power))
             {// gpu power
                 unsigned int powerMw = 0;
                 if (nvml->Ok(nvml->DeviceGetPowerUsage(*hNvml, &powerMw)))
@@ -150,7 +180,11 @@ namespace pwr::nv
                 }
                 // TODO: consider logging failure (lower logging level perhaps)
             }
+            else {
+                info.gpu_power_w = lastSample.gpu_power_w;
+            }
 
+            if (IsSampling(GpuTelemetryCapBits::gpu_sustained_power_limit))
             {// power limit
                 unsigned int limitMw = 0;
                 if (nvml->Ok(nvml->DeviceGetPowerManagementLimit(*hNvml, &limitMw)))
@@ -160,7 +194,11 @@ namespace pwr::nv
                 }
                 // TODO: consider logging failure (lower logging level perhaps)
             }
+            else {
+                info.gpu_sustained_power_limit_w = lastSample.gpu_sustained_power_limit_w;
+            }
 
+            if (IsSampling(GpuTelemetryCapBits::gpu_mem_size) || IsSampling(GpuTelemetryCapBits::gpu_mem_used))
             {// memory usage
                 nvmlMemory_t mem{};
                 if (nvml->Ok(nvml->DeviceGetMemoryInfo(*hNvml, &mem)))
@@ -173,7 +211,12 @@ namespace pwr::nv
                 }
                 // TODO: consider logging failure (lower logging level perhaps)
             }
+            else {
+                info.gpu_mem_total_size_b = lastSample.gpu_mem_total_size_b;
+                info.gpu_mem_used_b = lastSample.gpu_mem_used_b;
+            }
 
+            if (IsSampling(GpuTelemetryCapBits::gpu_temperature))
             {// temperature
                 if (!GetPowerTelemetryCapBits().test(static_cast<size_t>(GpuTelemetryCapBits::gpu_temperature))||
                     (useNvmlTemperature))
@@ -191,18 +234,33 @@ namespace pwr::nv
         }
 
         // insert telemetry into history
-        std::lock_guard lock{ historyMutex };
         history.Push(info);
+        lastSample = info;
 
         return true;
     }
 
     std::optional<PresentMonPowerTelemetryInfo> NvidiaPowerTelemetryAdapter::GetClosest(uint64_t qpc) const noexcept
     {
-        std::lock_guard lock{ historyMutex };
         return history.GetNearest(qpc);
     }
 
+    std::optional<PresentMonPowerTelemetryInfo> NvidiaPowerTelemetryAdapter::GetInterpolated(uint64_t qpc) const noexcept
+    {
+        return history.GetInterpolated(qpc);
+    }
+
+    void NvidiaPowerTelemetryAdapter::GetTelemetry(std::span<const uint64_t> qpcs,
+        std::span<PresentMonPowerTelemetryInfo> infos, bool interpolate) const noexcept
+    {
+        if (interpolate) {
+            history.GetInterpolated(qpcs, infos);
+        }
+        else {
+            history.GetNearest(qpcs, infos);
+        }
+    }
+
     PM_DEVICE_VENDOR NvidiaPowerTelemetryAdapter::GetVendor() const noexcept
     {
         return PM_DEVICE_VENDOR::PM_DEVICE_VENDOR_NVIDIA;
@@ -2,8 +2,7 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 #include "PowerTelemetryAdapter.h"
-#include "TelemetryHistory.h"
-#include <mutex>
+#include "ConcurrentTelemetryHistory.h"
 #include <optional>
 #include "NvapiWrapper.h"
 #include "NvmlWrapper.h"
@@ -20,11 +19,15 @@ namespace pwr::nv
 			std::optional<nvmlDevice_t> hGpuNvml);
 		bool Sample() noexcept override;
 		std::optional<PresentMonPowerTelemetryInfo> GetClosest(uint64_t qpc) const noexcept override;
+		std::optional<PresentMonPowerTelemetryInfo> GetInterpolated(uint64_t qpc) const noexcept override;
+		void GetTelemetry(std::span<const uint64_t> qpcs, std::span<PresentMonPowerTelemetryInfo> infos,
+		    bool interpolate) const noexcept override;
 		PM_DEVICE_VENDOR GetVendor() const noexcept override;
 		std::string GetName() const noexcept override;
         uint64_t GetDedicatedVideoMemory() const noexcept override;
 		uint64_t GetVideoMemoryMaxBandwidth() const noexcept override { return 0; }
 		double GetSustainedPowerLimit() const noexcept override;
+		std::optional<FastPowerReading> ReadFastPower() noexcept override;
 
 	private:
 		// data
@@ -33,8 +36,9 @@ namespace pwr::nv
 		NvPhysicalGpuHandle hNvapi;
 		std::optional<nvmlDevice_t> hNvml;
 		std::string name = "Unknown Adapter Name";
-		mutable std::mutex historyMutex;
-		TelemetryHistory<PresentMonPowerTelemetryInfo> history{ PowerTelemetryAdapter::defaultHistorySize };
+		ConcurrentTelemetryHistory<PresentMonPowerTelemetryInfo> history{ PowerTelemetryAdapter::defaultHistorySize };
 		bool useNvmlTemperature = false;
+		// telemetry that samples skipping some of the driver calls carry over
+		PresentMonPowerTelemetryInfo lastSample{};
 	};
 }
\ No newline at end of file
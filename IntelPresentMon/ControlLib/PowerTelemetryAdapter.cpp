@@ -2,6 +2,7 @@
 #include "Logging.h"
 #include "../CommonUtilities/ref/WrapReflect.h"
 #include "../CommonUtilities/ref/StaticReflection.h"
+#include "../CommonUtilities/Qpc.h"
 #include <format>
 
 
@@ -12,6 +13,10 @@ namespace pwr
     using v = ::pmon::util::log::V;
     using ::pmon::util::log::GlobalPolicy;
 
+    PowerTelemetryAdapter::PowerTelemetryAdapter()
+        :
+        fastPowerHistory_{ fastPowerHistorySize, GetTimestampPeriodSeconds() }
+    {}
     void PowerTelemetryAdapter::SetTelemetryCapBit(GpuTelemetryCapBits telemetryCapBit) noexcept
     {
         if (GlobalPolicy::VCheck(v::tele_gpu)) {
@@ -22,6 +27,45 @@ namespace pwr
         }
         gpuTelemetryCapBits_.set(static_cast<size_t>(telemetryCapBit));
     }
+    bool PowerTelemetryAdapter::SampleDemanded(const SetTelemetryCapBitset& caps) noexcept
+    {
+        samplingCapBits_ = caps;
+        const auto result = Sample();
+        samplingCapBits_.set();
+        return result;
+    }
+    std::optional<FastPowerReading> PowerTelemetryAdapter::ReadFastPower() noexcept
+    {
+        return {};
+    }
+    bool PowerTelemetryAdapter::SampleFastPower() noexcept
+    {
+        const auto qpc = uint64_t(GetCurrentTimestamp());
+        const auto reading = ReadFastPower();
+        if (!reading) {
+            return false;
+        }
+        fastPowerHistory_.Push(qpc, *reading);
+        SetTelemetryCapBit(GpuTelemetryCapBits::gpu_frame_energy);
+        return true;
+    }
+    std::optional<FrameEnergy> PowerTelemetryAdapter::GetFrameEnergy(uint64_t startQpc, uint64_t endQpc) const noexcept
+    {
+        return fastPowerHistory_.GetFrameEnergy(startQpc, endQpc);
+    }
+    bool PowerTelemetryAdapter::IsSampling(GpuTelemetryCapBits bit) const noexcept
+    {
+        return samplingCapBits_.test(size_t(bit));
+    }
+    void PowerTelemetryAdapter::GetTelemetry(std::span<const uint64_t> qpcs,
+        std::span<PresentMonPowerTelemetryInfo> infos, bool interpolate) const noexcept
+    {
+        for (size_t i = 0; i < qpcs.size(); i++) {
+            if (auto info = interpolate ? GetInterpolated(qpcs[i]) : GetClosest(qpcs[i])) {
+                infos[i] = *info;
+            }
+        }
+    }
     PowerTelemetryAdapter::SetTelemetryCapBitset PowerTelemetryAdapter::GetPowerTelemetryCapBits()
     {
         pmlog_verb(v::tele_gpu)("Telemetry cap bits being retrieved").pmwatch(GetName())
@@ -5,8 +5,10 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <span>
 #include <bitset>
 #include "PresentMonPowerTelemetry.h"
+#include "FastPowerHistory.h"
 #include "../PresentMonAPI2/PresentMonAPI.h"
 
 namespace pwr
@@ -17,22 +19,46 @@ namespace pwr
         // types
         using SetTelemetryCapBitset = std::bitset<static_cast<size_t>(GpuTelemetryCapBits::gpu_telemetry_count)>;
         // functions
+        PowerTelemetryAdapter();
         virtual ~PowerTelemetryAdapter() = default;
         virtual bool Sample() noexcept = 0;
+        // sample only the telemetry of caps, as far as the adapter reads it in separate driver calls;
+        // telemetry read by calls that are skipped is carried over from the previous sample
+        bool SampleDemanded(const SetTelemetryCapBitset& caps) noexcept;
         virtual std::optional<PresentMonPowerTelemetryInfo> GetClosest(uint64_t qpc) const noexcept = 0;
+        // telemetry interpolated between the samples before and after qpc
+        virtual std::optional<PresentMonPowerTelemetryInfo> GetInterpolated(uint64_t qpc) const noexcept = 0;
+        // telemetry for each of qpcs, which must be in ascending order; infos are left untouched when
+        // there is no telemetry
+        virtual void GetTelemetry(std::span<const uint64_t> qpcs, std::span<PresentMonPowerTelemetryInfo> infos,
+            bool interpolate) const noexcept;
         virtual PM_DEVICE_VENDOR GetVendor() const noexcept = 0;
         virtual std::string GetName() const noexcept = 0;
         virtual uint64_t GetDedicatedVideoMemory() const noexcept = 0;
         virtual uint64_t GetVideoMemoryMaxBandwidth() const noexcept = 0;
         virtual double GetSustainedPowerLimit() const noexcept = 0;        
+        // cheap reading of gpu power for high rate sampling, empty if the adapter has none
+        virtual std::optional<FastPowerReading> ReadFastPower() noexcept;
+        // reads gpu power into the fast power history, only to be called from the fast power sampling thread
+        bool SampleFastPower() noexcept;
+        // gpu energy used from startQpc to endQpc according to the fast power history
+        std::optional<FrameEnergy> GetFrameEnergy(uint64_t startQpc, uint64_t endQpc) const noexcept;
         void SetTelemetryCapBit(GpuTelemetryCapBits telemetryCapBit) noexcept;
         SetTelemetryCapBitset GetPowerTelemetryCapBits();
         bool HasTelemetryCapBit(GpuTelemetryCapBits bit) const;
         // constants
         static constexpr size_t defaultHistorySize = 300;
+        // about 4 seconds of fast power samples at 1 kHz
+        static constexpr size_t fastPowerHistorySize = 4096;
+
+    protected:
+        // whether the sample being taken is to read the telemetry of bit
+        bool IsSampling(GpuTelemetryCapBits bit) const noexcept;
 
        private:
         // data
         SetTelemetryCapBitset gpuTelemetryCapBits_{};
+        SetTelemetryCapBitset samplingCapBits_ = SetTelemetryCapBitset{}.set();
+        FastPowerHistory fastPowerHistory_;
     };
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "IntelPowerTelemetryProvider.h"
 #include "NvidiaPowerTelemetryProvider.h"
 #include "AmdPowerTelemetryProvider.h"
+#include "FakePowerTelemetryProvider.h"
 
 namespace pwr
 {
@@ -16,4 +17,9 @@ namespace pwr
 		}
 		return {};
 	}
+
+	std::unique_ptr<PowerTelemetryProvider> PowerTelemetryProviderFactory::MakeFake(const fake::FakeTelemetryConfig& config)
+	{
+		return std::make_unique<fake::FakePowerTelemetryProvider>(config);
+	}
 }
\ No newline at end of file
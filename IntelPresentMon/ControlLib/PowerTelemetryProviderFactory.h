@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 #include "PowerTelemetryProvider.h"
+#include "FakeTelemetrySource.h"
 #include "../PresentMonAPI2/PresentMonAPI.h"
 #include <memory>
 
@@ -11,5 +12,7 @@ namespace pwr
 	{
 	public:
 		static std::unique_ptr<PowerTelemetryProvider> Make(PM_DEVICE_VENDOR vendor);
+		// provider of synthetic telemetry, for benchmarking without the devices
+		static std::unique_ptr<PowerTelemetryProvider> MakeFake(const fake::FakeTelemetryConfig& config);
 	};
 }
\ No newline at end of file
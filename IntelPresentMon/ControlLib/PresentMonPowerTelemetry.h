@@ -39,6 +39,10 @@ struct PresentMonPowerTelemetryInfo {
     double gpu_temperature_percent;
     double gpu_power_percent;
     double gpu_card_power_w;
+    // gpu energy used from the previous present of the swap chain to this one, integrated from the
+    // fast power history, and its average power over that frame (not sampled, set per frame)
+    double gpu_frame_energy_j;
+    double gpu_frame_power_w;
 
     double vram_power_w;
     double vram_voltage_v;
@@ -125,6 +129,7 @@ enum class GpuTelemetryCapBits {
     max_fan_speed_3,
     max_fan_speed_4,
     gpu_card_power,
+    gpu_frame_energy,
     gpu_telemetry_count,
 };
 
@@ -0,0 +1,163 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include "PresentMonPowerTelemetry.h"
+#include "CpuTelemetryInfo.h"
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <limits>
+#include <mutex>
+#include <optional>
+
+namespace pwr
+{
+    // Decides when each kind of telemetry (capability C, of which there are N) is sampled. A capability
+    // is sampled only while it is demanded, that is while some client has a query calculated from it,
+    // and then at a period of its own: the period it was given, or else the base period (the telemetry
+    // period requested by the clients) but no faster than its minimum period, which keeps slowly
+    // changing telemetry such as fan speeds from costing a driver call every few ms. Adapters read
+    // several capabilities per driver call, so a capability due within a quarter of its period of
+    // another one is taken along with it.
+    template<class C, size_t N>
+    class TelemetryScheduler
+    {
+    public:
+        // types
+        using CapBitset = std::bitset<N>;
+        // functions
+        TelemetryScheduler(double basePeriod);
+        void SetBasePeriod(double seconds);
+        // empty period to go back to the base period
+        void SetPeriod(C cap, std::optional<double> seconds);
+        void SetMinimumPeriod(C cap, double seconds);
+        double GetPeriod(C cap) const;
+        // empty demand when what is used is not known, which demands every capability
+        void SetDemand(const std::optional<CapBitset>& demand);
+        CapBitset GetDemand() const;
+        // capabilities due at time now (seconds, on the clock of the caller), which are then considered
+        // sampled; a capability overdue by more than its period starts its cadence over from now
+        CapBitset TakeDue(double now);
+        // time at which the next demanded capability falls due, or empty if nothing is demanded
+        std::optional<double> GetNextDue() const;
+    private:
+        // functions
+        double GetPeriod_(size_t i) const;
+        // constants
+        static constexpr double coalesceFraction_ = 0.25;
+        static constexpr double never_ = -std::numeric_limits<double>::infinity();
+        // data
+        mutable std::mutex mtx_;
+        double basePeriod_;
+        std::array<std::optional<double>, N> periods_{};
+        std::array<double, N> minimumPeriods_{};
+        // time each capability was last due, which its next due time is a period on from
+        std::array<double, N> lastDue_;
+        CapBitset demand_;
+    };
+
+    using GpuTelemetryScheduler = TelemetryScheduler<GpuTelemetryCapBits,
+        static_cast<size_t>(GpuTelemetryCapBits::gpu_telemetry_count)>;
+    using CpuTelemetryScheduler = TelemetryScheduler<CpuTelemetryCapBits,
+        static_cast<size_t>(CpuTelemetryCapBits::cpu_telemetry_count)>;
+
+    template<class C, size_t N>
+    TelemetryScheduler<C, N>::TelemetryScheduler(double basePeriod)
+        :
+        basePeriod_{ basePeriod }
+    {
+        lastDue_.fill(never_);
+        demand_.set();
+    }
+
+    template<class C, size_t N>
+    void TelemetryScheduler<C, N>::SetBasePeriod(double seconds)
+    {
+        std::lock_guard lk{ mtx_ };
+        basePeriod_ = seconds;
+    }
+
+    template<class C, size_t N>
+    void TelemetryScheduler<C, N>::SetPeriod(C cap, std::optional<double> seconds)
+    {
+        std::lock_guard lk{ mtx_ };
+        periods_[size_t(cap)] = seconds;
+    }
+
+    template<class C, size_t N>
+    void TelemetryScheduler<C, N>::SetMinimumPeriod(C cap, double seconds)
+    {
+        std::lock_guard lk{ mtx_ };
+        minimumPeriods_[size_t(cap)] = seconds;
+    }
+
+    template<class C, size_t N>
+    double TelemetryScheduler<C, N>::GetPeriod(C cap) const
+    {
+        std::lock_guard lk{ mtx_ };
+        return GetPeriod_(size_t(cap));
+    }
+
+    template<class C, size_t N>
+    void TelemetryScheduler<C, N>::SetDemand(const std::optional<CapBitset>& demand)
+    {
+        std::lock_guard lk{ mtx_ };
+        const auto newDemand = demand.value_or(CapBitset{}.set());
+        // capabilities that were not demanded until now are due right away
+        for (size_t i = 0; i < N; i++) {
+            if (newDemand[i] && !demand_[i]) {
+                lastDue_[i] = never_;
+            }
+        }
+        demand_ = newDemand;
+    }
+
+    template<class C, size_t N>
+    typename TelemetryScheduler<C, N>::CapBitset TelemetryScheduler<C, N>::GetDemand() const
+    {
+        std::lock_guard lk{ mtx_ };
+        return demand_;
+    }
+
+    template<class C, size_t N>
+    typename TelemetryScheduler<C, N>::CapBitset TelemetryScheduler<C, N>::TakeDue(double now)
+    {
+        std::lock_guard lk{ mtx_ };
+        CapBitset due;
+        for (size_t i = 0; i < N; i++) {
+            if (!demand_[i]) {
+                continue;
+            }
+            const auto period = GetPeriod_(i);
+            const auto dueTime = lastDue_[i] + period;
+            if (dueTime - now <= period * coalesceFraction_) {
+                due.set(i);
+                lastDue_[i] = now - dueTime > period ? now : dueTime;
+            }
+        }
+        return due;
+    }
+
+    template<class C, size_t N>
+    std::optional<double> TelemetryScheduler<C, N>::GetNextDue() const
+    {
+        std::lock_guard lk{ mtx_ };
+        std::optional<double> next;
+        for (size_t i = 0; i < N; i++) {
+            if (demand_[i]) {
+                const auto dueTime = lastDue_[i] + GetPeriod_(i);
+                next = next ? std::min(*next, dueTime) : dueTime;
+            }
+        }
+        return next;
+    }
+
+    template<class C, size_t N>
+    double TelemetryScheduler<C, N>::GetPeriod_(size_t i) const
+    {
+        if (periods_[i]) {
+            return *periods_[i];
+        }
+        return std::max(basePeriod_, minimumPeriods_[i]);
+    }
+}
@@ -134,7 +134,6 @@ bool WmiCpu::Sample() noexcept {
   }
 
   // insert telemetry into history
-  std::lock_guard lock{history_mutex_};
   history_.Push(info);
 
   // Update the next sample qpc based on the current sample qpc
@@ -146,8 +145,22 @@ bool WmiCpu::Sample() noexcept {
 
 std::optional<CpuTelemetryInfo> WmiCpu::GetClosest(uint64_t qpc)
       const noexcept {
-  std::lock_guard lock{history_mutex_};
   return history_.GetNearest(qpc);
 }
 
+std::optional<CpuTelemetryInfo> WmiCpu::GetInterpolated(uint64_t qpc)
+      const noexcept {
+  return history_.GetInterpolated(qpc);
+}
+
+void WmiCpu::GetTelemetry(std::span<const uint64_t> qpcs,
+                          std::span<CpuTelemetryInfo> infos,
+                          bool interpolate) const noexcept {
+  if (interpolate) {
+    history_.GetInterpolated(qpcs, infos);
+  } else {
+    history_.GetNearest(qpcs, infos);
+  }
+}
+
 }
\ No newline at end of file
@@ -5,8 +5,7 @@
 #include <Windows.h>
 #include <pdh.h>
 #include "CpuTelemetry.h"
-#include "TelemetryHistory.h"
-#include <mutex>
+#include "ConcurrentTelemetryHistory.h"
 #include <optional>
 
 namespace pwr::cpu::wmi {
@@ -21,6 +20,11 @@ class WmiCpu : public CpuTelemetry {
   bool Sample() noexcept override;
   std::optional<CpuTelemetryInfo> GetClosest(
       uint64_t qpc) const noexcept override;
+  std::optional<CpuTelemetryInfo> GetInterpolated(
+      uint64_t qpc) const noexcept override;
+  void GetTelemetry(std::span<const uint64_t> qpcs,
+                    std::span<CpuTelemetryInfo> infos,
+                    bool interpolate) const noexcept override;
   // types
   class NonGraphicsDeviceException : public std::exception {};
 
@@ -35,8 +39,7 @@ class WmiCpu : public CpuTelemetry {
   LARGE_INTEGER frequency_ = {};
   std::string cpu_name_;
 
-  mutable std::mutex history_mutex_;
-  TelemetryHistory<CpuTelemetryInfo> history_{CpuTelemetry::defaultHistorySize};
+  ConcurrentTelemetryHistory<CpuTelemetryInfo> history_{CpuTelemetry::defaultHistorySize};
 };
 
 }  // namespace pwr::cpu::wmi
\ No newline at end of file
@@ -18,6 +18,7 @@ namespace p2c::cli
 		Flag allowTearing{ this, "--allow-tearing", "Allow tearing presents for overlay (optional, might affect VRR)" };
 		Flag disableAlpha{ this, "--disable-alpha", "Disable alpha blend composition of overlay" };
 		Flag enableTimestampColumn{ this, "--enable-timestamp-column", "Enable timestamp column in capture CSV" };
+		Option<double> statsSketchAccuracy{ this, "--stats-sketch-accuracy", {}, "Compute capture summary statistics with a bounded-memory quantile sketch of this relative accuracy (e.g. 0.01) instead of retaining every frame", CLI::Range(0.0001, 0.5) };
 
 	private: Group gd_{ this, "Debugging", "Aids in debugging this tool" }; public:
 		Option<std::string> controlPipe{ this, "--control-pipe", R"(\\.\pipe\pm-ctrl)", "Named pipe to connect to the service with" };
@@ -395,8 +395,8 @@ namespace p2c::pmon
         procTracker{ procTrackerIn },
         procName{ ToNarrow(processName) },
         frameStatsPath{ std::move(frameStatsPathIn) },
-        pStatsTracker{ frameStatsPath ? std::make_unique<StatisticsTracker>() : nullptr },
-        pAnimationErrorTracker{ frameStatsPath ? std::make_unique<StatisticsTracker>() : nullptr },
+        pStatsTracker{ frameStatsPath ? std::make_unique<StatisticsTracker>(cli::Options::Get().statsSketchAccuracy.AsOptional()) : nullptr },
+        pAnimationErrorTracker{ frameStatsPath ? std::make_unique<StatisticsTracker>(cli::Options::Get().statsSketchAccuracy.AsOptional()) : nullptr },
         file{ path }
     {
         const auto& opt = cli::Options::Get();
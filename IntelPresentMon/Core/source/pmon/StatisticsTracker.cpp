@@ -11,13 +11,38 @@ namespace vi = rn::views;
 
 namespace p2c::pmon
 {
+	StatisticsTracker::StatisticsTracker(std::optional<double> sketchRelativeAccuracy)
+	{
+		if (sketchRelativeAccuracy) {
+			sketch.emplace(*sketchRelativeAccuracy);
+		}
+	}
 	void StatisticsTracker::Push(double value)
 	{
+		if (sketch) {
+			sketchMin = sketch->Empty() ? value : std::min(sketchMin, value);
+			sketchMax = sketch->Empty() ? value : std::max(sketchMax, value);
+			sketchSum += value;
+			sketch->Add(value);
+			return;
+		}
 		values.push_back(value);
 		sorted = false;
 	}
 	double StatisticsTracker::GetPercentile(double percentile)
 	{
+		if (sketch) {
+			if (sketch->Empty()) {
+				return -1.;
+			}
+			if (sketch->Count() == 1 || percentile <= 0.) {
+				return sketchMin;
+			}
+			if (percentile >= 1.) {
+				return sketchMax;
+			}
+			return sketch->Quantile(percentile) / 1000.;
+		}
 		Sort_();
 		if (values.empty()) {
 			return -1.;
@@ -42,6 +67,9 @@ namespace p2c::pmon
 	}
 	double StatisticsTracker::GetMin()
 	{
+		if (sketch) {
+			return sketch->Empty() ? -1. : sketchMin / 1000.;
+		}
 		Sort_();
 		if (values.empty()) {
 			return -1.;
@@ -50,6 +78,9 @@ namespace p2c::pmon
 	}
 	double StatisticsTracker::GetMax()
 	{
+		if (sketch) {
+			return sketch->Empty() ? -1. : sketchMax / 1000.;
+		}
 		Sort_();
 		if (values.empty()) {
 			return -1.;
@@ -58,6 +89,9 @@ namespace p2c::pmon
 	}
 	double StatisticsTracker::GetMean() const
 	{
+		if (sketch) {
+			return sketch->Empty() ? -1. : sketchSum / double(GetCount()) / 1000.;
+		}
 		if (values.empty()) {
 			return -1.;
 		}
@@ -66,6 +100,9 @@ namespace p2c::pmon
 	}
 	double StatisticsTracker::GetSum() const
 	{
+		if (sketch) {
+			return sketch->Empty() ? -1. : sketchSum;
+		}
 		if (values.empty()) {
 			return -1.;
 		}
@@ -74,6 +111,9 @@ namespace p2c::pmon
 	}
 	size_t StatisticsTracker::GetCount() const
 	{
+		if (sketch) {
+			return size_t(sketch->Count());
+		}
 		return values.size();
 	}
 	void StatisticsTracker::Sort_()
@@ -2,12 +2,18 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 #include <vector>
+#include <optional>
+#include <CommonUtilities/QuantileSketch.h>
 
 namespace p2c::pmon
 {
 	class StatisticsTracker
 	{
 	public:
+		StatisticsTracker() = default;
+		// when sketchRelativeAccuracy is set, values are summarized in a bounded-memory quantile
+		// sketch instead of being retained, and percentiles are within that relative accuracy
+		explicit StatisticsTracker(std::optional<double> sketchRelativeAccuracy);
 		void Push(double value);
 		double GetPercentile(double percentile);
 		double GetMin();
@@ -19,5 +25,10 @@ namespace p2c::pmon
 		void Sort_();
 		bool sorted = false;
 		std::vector<double> values;
+		// sketch mode tracks the exact aggregates alongside the sketch
+		std::optional<::pmon::util::QuantileSketch> sketch;
+		double sketchSum = 0.;
+		double sketchMin = 0.;
+		double sketchMax = 0.;
 	};
 }
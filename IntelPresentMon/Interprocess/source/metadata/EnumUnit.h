@@ -33,4 +33,5 @@
 		X_(UNIT, KILOBYTES, "Kilobytes", "kB", "Data volume in kilobytes") \
 		X_(UNIT, MEGABYTES, "Megabytes", "MB", "Data volume in megabytes") \
 		X_(UNIT, GIGABYTES, "Gigabytes", "GB", "Data volume in gigabytes") \
-		X_(UNIT, QPC, "High-performance timestamp", "qpc", "Timestamp obtained via QueryPerformanceCounter (or compatible)")
+		X_(UNIT, QPC, "High-performance timestamp", "qpc", "Timestamp obtained via QueryPerformanceCounter (or compatible)") \
+		X_(UNIT, JOULES, "Joules", "J", "Energy in joules (watt seconds)")
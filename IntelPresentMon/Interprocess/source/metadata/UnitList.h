@@ -33,5 +33,6 @@
 	X_(PM_UNIT_KILOBYTES, PM_UNIT_BYTES, 1'024.) \
 	X_(PM_UNIT_MEGABYTES, PM_UNIT_BYTES, 1'048'576.) \
 	X_(PM_UNIT_GIGABYTES, PM_UNIT_BYTES, 1'073'741'824.) \
-	X_(PM_UNIT_QPC, PM_UNIT_QPC, 1.)
+	X_(PM_UNIT_QPC, PM_UNIT_QPC, 1.) \
+	X_(PM_UNIT_JOULES, PM_UNIT_JOULES, 1.)
 	
\ No newline at end of file
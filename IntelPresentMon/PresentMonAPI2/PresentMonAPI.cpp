@@ -249,6 +249,13 @@ PRESENTMON_API2_EXPORT PM_STATUS pmSetEtwFlushPeriod(PM_SESSION_HANDLE handle, u
 
 PRESENTMON_API2_EXPORT PM_STATUS pmRegisterDynamicQuery(PM_SESSION_HANDLE sessionHandle, PM_DYNAMIC_QUERY_HANDLE* pQueryHandle,
 	PM_QUERY_ELEMENT* pElements, uint64_t numElements, double windowSizeMs, double metricOffsetMs)
+{
+	return pmRegisterDynamicQueryWithOptions(sessionHandle, pQueryHandle, pElements, numElements,
+		windowSizeMs, metricOffsetMs, nullptr);
+}
+
+PRESENTMON_API2_EXPORT PM_STATUS pmRegisterDynamicQueryWithOptions(PM_SESSION_HANDLE sessionHandle, PM_DYNAMIC_QUERY_HANDLE* pQueryHandle,
+	PM_QUERY_ELEMENT* pElements, uint64_t numElements, double windowSizeMs, double metricOffsetMs, const PM_DYNAMIC_QUERY_OPTIONS* pOptions)
 {
 	try {
 		if (!pElements) {
@@ -259,8 +266,13 @@ PRESENTMON_API2_EXPORT PM_STATUS pmRegisterDynamicQuery(PM_SESSION_HANDLE sessio
 			pmlog_error("zero length query element array").diag();
 			return PM_STATUS_BAD_ARGUMENT;
 		}
+		if (pOptions && pOptions->statBackend == PM_DYNAMIC_QUERY_STAT_BACKEND_SKETCH &&
+			!(pOptions->sketchRelativeAccuracy > 0. && pOptions->sketchRelativeAccuracy < 1.)) {
+			pmlog_error("sketch relative accuracy must be in (0, 1)").pmwatch(pOptions->sketchRelativeAccuracy).diag();
+			return PM_STATUS_BAD_ARGUMENT;
+		}
 		const auto queryHandle = LookupMiddleware_(sessionHandle).RegisterDynamicQuery(
-			{pElements, numElements}, windowSizeMs, metricOffsetMs);
+			{pElements, numElements}, windowSizeMs, metricOffsetMs, pOptions);
 		AddHandleMapping_(sessionHandle, queryHandle);
 		*pQueryHandle = queryHandle;
 		return PM_STATUS_SUCCESS;
@@ -316,6 +328,35 @@ PRESENTMON_API2_EXPORT PM_STATUS pmPollDynamicQuery(PM_DYNAMIC_QUERY_HANDLE hand
 	}
 }
 
+PRESENTMON_API2_EXPORT PM_STATUS pmPollDynamicQueryProcesses(PM_DYNAMIC_QUERY_HANDLE handle, const uint32_t* pProcessIds, uint32_t* pNumProcesses, uint8_t* pBlobs, uint32_t numSwapChains, PM_DYNAMIC_QUERY_PROCESS_RESULT* pResults, uint8_t* pCombinedBlob)
+{
+	try {
+		if (!pNumProcesses) {
+			pmlog_error("null process count inoutptr").diag();
+			return PM_STATUS_BAD_ARGUMENT;
+		}
+		if (!pBlobs || !pResults) {
+			pmlog_error("null blob or result ptr").diag();
+			return PM_STATUS_BAD_ARGUMENT;
+		}
+		if (!numSwapChains) {
+			pmlog_error("swap chain count is zero").diag();
+			return PM_STATUS_BAD_ARGUMENT;
+		}
+		const auto maxProcesses = *pNumProcesses;
+		*pNumProcesses = 0;
+		*pNumProcesses = LookupMiddleware_(handle).PollDynamicQueryProcesses(handle,
+			pProcessIds ? std::optional{ std::span{ pProcessIds, maxProcesses } } : std::nullopt,
+			maxProcesses, pBlobs, numSwapChains, pResults, pCombinedBlob);
+		return PM_STATUS_SUCCESS;
+	}
+	catch (...) {
+		const auto code = util::GeneratePmStatus();
+		pmlog_error(util::ReportException()).code(code);
+		return code;
+	}
+}
+
 PRESENTMON_API2_EXPORT PM_STATUS pmPollStaticQuery(PM_SESSION_HANDLE sessionHandle, const PM_QUERY_ELEMENT* pElement, uint32_t processId, uint8_t* pBlob)
 {
 	try {
@@ -338,6 +379,12 @@ PRESENTMON_API2_EXPORT PM_STATUS pmPollStaticQuery(PM_SESSION_HANDLE sessionHand
 }
 
 PRESENTMON_API2_EXPORT PM_STATUS pmRegisterFrameQuery(PM_SESSION_HANDLE sessionHandle, PM_FRAME_QUERY_HANDLE* pQueryHandle, PM_QUERY_ELEMENT* pElements, uint64_t numElements, uint32_t* pBlobSize)
+{
+	return pmRegisterFrameQueryWithOptions(sessionHandle, pQueryHandle, pElements, numElements, pBlobSize, nullptr);
+}
+
+PRESENTMON_API2_EXPORT PM_STATUS pmRegisterFrameQueryWithOptions(PM_SESSION_HANDLE sessionHandle, PM_FRAME_QUERY_HANDLE* pQueryHandle,
+	PM_QUERY_ELEMENT* pElements, uint64_t numElements, uint32_t* pBlobSize, const PM_FRAME_QUERY_OPTIONS* pOptions)
 {
 	try {
 		if (!pQueryHandle) {
@@ -356,7 +403,11 @@ PRESENTMON_API2_EXPORT PM_STATUS pmRegisterFrameQuery(PM_SESSION_HANDLE sessionH
 			pmlog_error("zero blob size").diag();
 			return PM_STATUS_BAD_ARGUMENT;
 		}
-		const auto queryHandle = LookupMiddleware_(sessionHandle).RegisterFrameEventQuery({ pElements, numElements }, *pBlobSize);
+		if (pOptions && pOptions->layout == PM_FRAME_QUERY_LAYOUT_COLUMNS && !pOptions->columnFrameCapacity) {
+			pmlog_error("zero column frame capacity").diag();
+			return PM_STATUS_BAD_ARGUMENT;
+		}
+		const auto queryHandle = LookupMiddleware_(sessionHandle).RegisterFrameEventQuery({ pElements, numElements }, *pBlobSize, pOptions);
 		AddHandleMapping_(sessionHandle, queryHandle);
 		*pQueryHandle = queryHandle;
 		return PM_STATUS_SUCCESS;
@@ -395,6 +446,30 @@ PRESENTMON_API2_EXPORT PM_STATUS pmConsumeFrames(PM_FRAME_QUERY_HANDLE handle, u
 	}
 }
 
+PRESENTMON_API2_EXPORT PM_STATUS pmWaitForFrames(PM_SESSION_HANDLE handle, uint32_t processId, uint32_t minFrames, uint32_t timeoutMs, uint32_t* pNumFramesReady)
+{
+	try {
+		if (!pNumFramesReady) {
+			pmlog_error("null frame count outptr").diag();
+			return PM_STATUS_BAD_ARGUMENT;
+		}
+		*pNumFramesReady = 0;
+		*pNumFramesReady = LookupMiddleware_(handle).WaitForFrames(processId, minFrames, timeoutMs);
+		return PM_STATUS_SUCCESS;
+	}
+	catch (...) {
+		const auto code = util::GeneratePmStatus();
+		if (code == PM_STATUS_INVALID_PID) {
+			// invalid pid is an exception that happens at the end of a normal workflow, so don't flag as error
+			pmlog_info(util::ReportException()).code(code);
+		}
+		else {
+			pmlog_error(util::ReportException()).code(code);
+		}
+		return code;
+	}
+}
+
 PRESENTMON_API2_EXPORT PM_STATUS pmFreeFrameQuery(PM_FRAME_QUERY_HANDLE handle)
 {
 	try {
@@ -10,7 +10,7 @@
 #include <cstdint>
 
 #define PM_API_VERSION_MAJOR 3
-#define PM_API_VERSION_MINOR 2
+#define PM_API_VERSION_MINOR 6
 
 #ifdef __cplusplus
 extern "C" {
@@ -133,6 +133,8 @@ extern "C" {
 		PM_METRIC_BETWEEN_APP_START,
 		PM_METRIC_PRESENTED_FRAME_TIME,
 		PM_METRIC_FLIP_DELAY,
+		PM_METRIC_GPU_FRAME_ENERGY,
+		PM_METRIC_GPU_FRAME_POWER,
 	};
 
 	enum PM_METRIC_TYPE
@@ -196,6 +198,7 @@ extern "C" {
 		PM_UNIT_MEGABYTES,
 		PM_UNIT_GIGABYTES,
 		PM_UNIT_QPC,
+		PM_UNIT_JOULES,
 	};
 
 	enum PM_STAT
@@ -259,6 +262,18 @@ extern "C" {
 		PM_METRIC_AVAILABILITY_UNAVAILABLE,
 	};
 
+	enum PM_DYNAMIC_QUERY_STAT_BACKEND
+	{
+		PM_DYNAMIC_QUERY_STAT_BACKEND_EXACT,
+		PM_DYNAMIC_QUERY_STAT_BACKEND_SKETCH,
+	};
+
+	enum PM_FRAME_QUERY_LAYOUT
+	{
+		PM_FRAME_QUERY_LAYOUT_BLOBS,
+		PM_FRAME_QUERY_LAYOUT_COLUMNS,
+	};
+
 	// this is required but has no external use
 	enum PM_NULL_ENUM {};
 
@@ -381,6 +396,35 @@ extern "C" {
 		char config[4];
 	};
 
+	struct PM_DYNAMIC_QUERY_OPTIONS
+	{
+		// EXACT keeps every sample in the window, SKETCH keeps bounded-memory quantile sketches
+		PM_DYNAMIC_QUERY_STAT_BACKEND statBackend;
+		// relative error bound of percentiles computed with the SKETCH backend, in (0, 1)
+		double sketchRelativeAccuracy;
+	};
+
+	struct PM_FRAME_QUERY_OPTIONS
+	{
+		// BLOBS writes one blob per frame with the query elements interleaved
+		// COLUMNS writes one array per query element, each element's dataOffset being the offset of its array in the
+		// output and its values being dataSize bytes apart; arrays start at multiples of PM_FRAME_QUERY_COLUMN_ALIGNMENT
+		PM_FRAME_QUERY_LAYOUT layout;
+		// length of the arrays with the COLUMNS layout, which is the most frames consumed per call
+		uint32_t columnFrameCapacity;
+	};
+#define PM_FRAME_QUERY_COLUMN_ALIGNMENT 64
+
+	struct PM_DYNAMIC_QUERY_PROCESS_RESULT
+	{
+		uint32_t processId;
+		// SUCCESS, INVALID_PID if the process is not being tracked or has exited, or the error the poll of the process
+		// failed with; the blobs of the process hold no results unless it is SUCCESS
+		PM_STATUS status;
+		// number of swap chain blobs written for the process
+		uint32_t numSwapChains;
+	};
+
 	typedef struct PM_DYNAMIC_QUERY* PM_DYNAMIC_QUERY_HANDLE;
 	typedef struct PM_FRAME_QUERY* PM_FRAME_QUERY_HANDLE;
 	typedef struct PM_SESSION* PM_SESSION_HANDLE;
@@ -409,16 +453,30 @@ extern "C" {
 #define PM_ETW_FLUSH_PERIOD_MAX 1000
 	// register a dynamic query used for polling metric data with (optional) statistic processing such as average or percentile
 	PRESENTMON_API2_EXPORT PM_STATUS pmRegisterDynamicQuery(PM_SESSION_HANDLE sessionHandle, PM_DYNAMIC_QUERY_HANDLE* pHandle, PM_QUERY_ELEMENT* pElements, uint64_t numElements, double windowSizeMs, double metricOffsetMs);
+	// register a dynamic query with options selecting how window statistics are computed (pOptions may be null for defaults)
+	PRESENTMON_API2_EXPORT PM_STATUS pmRegisterDynamicQueryWithOptions(PM_SESSION_HANDLE sessionHandle, PM_DYNAMIC_QUERY_HANDLE* pHandle, PM_QUERY_ELEMENT* pElements, uint64_t numElements, double windowSizeMs, double metricOffsetMs, const PM_DYNAMIC_QUERY_OPTIONS* pOptions);
 	// free the resources associated with a registered dynamic query
 	PRESENTMON_API2_EXPORT PM_STATUS pmFreeDynamicQuery(PM_DYNAMIC_QUERY_HANDLE handle);
 	// poll a dynamic query, writing the query poll results into the specified memory blob (byte buffer)
 	PRESENTMON_API2_EXPORT PM_STATUS pmPollDynamicQuery(PM_DYNAMIC_QUERY_HANDLE handle, uint32_t processId, uint8_t* pBlob, uint32_t* numSwapChains);
+	// poll a dynamic query for several processes at the same time point, writing one result per process polled into pResults
+	// pProcessIds lists *pNumProcesses processes, or is null to poll every tracked process (up to *pNumProcesses of them)
+	// pBlobs holds numSwapChains blobs per process, packed in the order polled; *pNumProcesses receives the number polled
+	// pCombinedBlob (may be null) receives one more blob with the frame metric statistics taken over every swap chain of every
+	// process polled successfully (its other metrics are those of the first of them, and its swap chain address is 0)
+	PRESENTMON_API2_EXPORT PM_STATUS pmPollDynamicQueryProcesses(PM_DYNAMIC_QUERY_HANDLE handle, const uint32_t* pProcessIds, uint32_t* pNumProcesses, uint8_t* pBlobs, uint32_t numSwapChains, PM_DYNAMIC_QUERY_PROCESS_RESULT* pResults, uint8_t* pCombinedBlob);
 	// query a static metric immediately, writing the result into the specified memory blob (byte buffer)
 	PRESENTMON_API2_EXPORT PM_STATUS pmPollStaticQuery(PM_SESSION_HANDLE sessionHandle, const PM_QUERY_ELEMENT* pElement, uint32_t processId, uint8_t* pBlob);
 	// register a frame query used for consuming desired metrics from a queue of frame events
 	PRESENTMON_API2_EXPORT PM_STATUS pmRegisterFrameQuery(PM_SESSION_HANDLE sessionHandle, PM_FRAME_QUERY_HANDLE* pHandle, PM_QUERY_ELEMENT* pElements, uint64_t numElements, uint32_t* pBlobSize);
+	// register a frame query with options selecting the output layout (pOptions may be null for defaults)
+	// with the COLUMNS layout, pBlobSize receives the size of the whole output of a consume call
+	PRESENTMON_API2_EXPORT PM_STATUS pmRegisterFrameQueryWithOptions(PM_SESSION_HANDLE sessionHandle, PM_FRAME_QUERY_HANDLE* pHandle, PM_QUERY_ELEMENT* pElements, uint64_t numElements, uint32_t* pBlobSize, const PM_FRAME_QUERY_OPTIONS* pOptions);
 	// consume frame event metric data based on the filter registered with pmRegisterFrameQuery
 	PRESENTMON_API2_EXPORT PM_STATUS pmConsumeFrames(PM_FRAME_QUERY_HANDLE handle, uint32_t processId, uint8_t* pBlobs, uint32_t* pNumFramesToRead);
+	// block until at least minFrames new frames are available for the process or timeoutMs elapses, writing the number available
+	// frames are counted from those not yet consumed with pmConsumeFrames, or else from the previous wait on this session
+	PRESENTMON_API2_EXPORT PM_STATUS pmWaitForFrames(PM_SESSION_HANDLE handle, uint32_t processId, uint32_t minFrames, uint32_t timeoutMs, uint32_t* pNumFramesReady);
 	// free the resources associated with a frame event query
 	PRESENTMON_API2_EXPORT PM_STATUS pmFreeFrameQuery(PM_FRAME_QUERY_HANDLE handle);
 	// retrieve the API version of the PresentMon service / middleware DLL
@@ -33,11 +33,15 @@ PM_STATUS(*pFunc_pmFreeIntrospectionRoot_)(const PM_INTROSPECTION_ROOT*) = nullp
 PM_STATUS(*pFunc_pmSetTelemetryPollingPeriod_)(PM_SESSION_HANDLE, uint32_t, uint32_t) = nullptr;
 PM_STATUS(*pFunc_pmSetEtwFlushPeriod_)(PM_SESSION_HANDLE, uint32_t) = nullptr;
 PM_STATUS(*pFunc_pmRegisterDynamicQuery_)(PM_SESSION_HANDLE, PM_DYNAMIC_QUERY_HANDLE*, PM_QUERY_ELEMENT*, uint64_t, double, double) = nullptr;
+PM_STATUS(*pFunc_pmRegisterDynamicQueryWithOptions_)(PM_SESSION_HANDLE, PM_DYNAMIC_QUERY_HANDLE*, PM_QUERY_ELEMENT*, uint64_t, double, double, const PM_DYNAMIC_QUERY_OPTIONS*) = nullptr;
 PM_STATUS(*pFunc_pmFreeDynamicQuery_)(PM_DYNAMIC_QUERY_HANDLE) = nullptr;
 PM_STATUS(*pFunc_pmPollDynamicQuery_)(PM_DYNAMIC_QUERY_HANDLE, uint32_t, uint8_t*, uint32_t*) = nullptr;
+PM_STATUS(*pFunc_pmPollDynamicQueryProcesses_)(PM_DYNAMIC_QUERY_HANDLE, const uint32_t*, uint32_t*, uint8_t*, uint32_t, PM_DYNAMIC_QUERY_PROCESS_RESULT*, uint8_t*) = nullptr;
 PM_STATUS(*pFunc_pmPollStaticQuery_)(PM_SESSION_HANDLE, const PM_QUERY_ELEMENT*, uint32_t, uint8_t*) = nullptr;
 PM_STATUS(*pFunc_pmRegisterFrameQuery_)(PM_SESSION_HANDLE, PM_FRAME_QUERY_HANDLE*, PM_QUERY_ELEMENT*, uint64_t, uint32_t*) = nullptr;
+PM_STATUS(*pFunc_pmRegisterFrameQueryWithOptions_)(PM_SESSION_HANDLE, PM_FRAME_QUERY_HANDLE*, PM_QUERY_ELEMENT*, uint64_t, uint32_t*, const PM_FRAME_QUERY_OPTIONS*) = nullptr;
 PM_STATUS(*pFunc_pmConsumeFrames_)(PM_FRAME_QUERY_HANDLE, uint32_t, uint8_t*, uint32_t*) = nullptr;
+PM_STATUS(*pFunc_pmWaitForFrames_)(PM_SESSION_HANDLE, uint32_t, uint32_t, uint32_t, uint32_t*) = nullptr;
 PM_STATUS(*pFunc_pmFreeFrameQuery_)(PM_FRAME_QUERY_HANDLE) = nullptr;
 PM_STATUS(*pFunc_pmGetApiVersion_)(PM_VERSION*) = nullptr;
 // pointers to runtime-resolved diagnostic functions
@@ -160,11 +164,15 @@ PRESENTMON_API2_EXPORT PM_STATUS LoadLibrary_(bool versionOnly = false)
 		RESOLVE(pmSetTelemetryPollingPeriod);
 		RESOLVE(pmSetEtwFlushPeriod);
 		RESOLVE(pmRegisterDynamicQuery);
+		RESOLVE(pmRegisterDynamicQueryWithOptions);
 		RESOLVE(pmFreeDynamicQuery);
 		RESOLVE(pmPollDynamicQuery);
+		RESOLVE(pmPollDynamicQueryProcesses);
 		RESOLVE(pmPollStaticQuery);
 		RESOLVE(pmRegisterFrameQuery);
+		RESOLVE(pmRegisterFrameQueryWithOptions);
 		RESOLVE(pmConsumeFrames);
+		RESOLVE(pmWaitForFrames);
 		RESOLVE(pmFreeFrameQuery);
 		// diagnostics
 		RESOLVE(pmDiagnosticSetup);
@@ -254,6 +262,11 @@ PRESENTMON_API2_EXPORT PM_STATUS pmRegisterDynamicQuery(PM_SESSION_HANDLE sessio
 	LoadEndpointsIfEmpty_();
 	return pFunc_pmRegisterDynamicQuery_(sessionHandle, pHandle, pElements, numElements, windowSizeMs, metricOffsetMs);
 }
+PRESENTMON_API2_EXPORT PM_STATUS pmRegisterDynamicQueryWithOptions(PM_SESSION_HANDLE sessionHandle, PM_DYNAMIC_QUERY_HANDLE* pHandle, PM_QUERY_ELEMENT* pElements, uint64_t numElements, double windowSizeMs, double metricOffsetMs, const PM_DYNAMIC_QUERY_OPTIONS* pOptions)
+{
+	LoadEndpointsIfEmpty_();
+	return pFunc_pmRegisterDynamicQueryWithOptions_(sessionHandle, pHandle, pElements, numElements, windowSizeMs, metricOffsetMs, pOptions);
+}
 PRESENTMON_API2_EXPORT PM_STATUS pmFreeDynamicQuery(PM_DYNAMIC_QUERY_HANDLE handle)
 {
 	LoadEndpointsIfEmpty_();
@@ -264,6 +277,11 @@ PRESENTMON_API2_EXPORT PM_STATUS pmPollDynamicQuery(PM_DYNAMIC_QUERY_HANDLE hand
 	LoadEndpointsIfEmpty_();
 	return pFunc_pmPollDynamicQuery_(handle, processId, pBlob, numSwapChains);
 }
+PRESENTMON_API2_EXPORT PM_STATUS pmPollDynamicQueryProcesses(PM_DYNAMIC_QUERY_HANDLE handle, const uint32_t* pProcessIds, uint32_t* pNumProcesses, uint8_t* pBlobs, uint32_t numSwapChains, PM_DYNAMIC_QUERY_PROCESS_RESULT* pResults, uint8_t* pCombinedBlob)
+{
+	LoadEndpointsIfEmpty_();
+	return pFunc_pmPollDynamicQueryProcesses_(handle, pProcessIds, pNumProcesses, pBlobs, numSwapChains, pResults, pCombinedBlob);
+}
 PRESENTMON_API2_EXPORT PM_STATUS pmPollStaticQuery(PM_SESSION_HANDLE sessionHandle, const PM_QUERY_ELEMENT* pElement, uint32_t processId, uint8_t* pBlob)
 {
 	LoadEndpointsIfEmpty_();
@@ -274,11 +292,21 @@ PRESENTMON_API2_EXPORT PM_STATUS pmRegisterFrameQuery(PM_SESSION_HANDLE sessionH
 	LoadEndpointsIfEmpty_();
 	return pFunc_pmRegisterFrameQuery_(sessionHandle, pHandle, pElements, numElements, pBlobSize);
 }
+PRESENTMON_API2_EXPORT PM_STATUS pmRegisterFrameQueryWithOptions(PM_SESSION_HANDLE sessionHandle, PM_FRAME_QUERY_HANDLE* pHandle, PM_QUERY_ELEMENT* pElements, uint64_t numElements, uint32_t* pBlobSize, const PM_FRAME_QUERY_OPTIONS* pOptions)
+{
+	LoadEndpointsIfEmpty_();
+	return pFunc_pmRegisterFrameQueryWithOptions_(sessionHandle, pHandle, pElements, numElements, pBlobSize, pOptions);
+}
 PRESENTMON_API2_EXPORT PM_STATUS pmConsumeFrames(PM_FRAME_QUERY_HANDLE handle, uint32_t processId, uint8_t* pBlobs, uint32_t* pNumFramesToRead)
 {
 	LoadEndpointsIfEmpty_();
 	return pFunc_pmConsumeFrames_(handle, processId, pBlobs, pNumFramesToRead);
 }
+PRESENTMON_API2_EXPORT PM_STATUS pmWaitForFrames(PM_SESSION_HANDLE handle, uint32_t processId, uint32_t minFrames, uint32_t timeoutMs, uint32_t* pNumFramesReady)
+{
+	LoadEndpointsIfEmpty_();
+	return pFunc_pmWaitForFrames_(handle, processId, minFrames, timeoutMs, pNumFramesReady);
+}
 PRESENTMON_API2_EXPORT PM_STATUS pmFreeFrameQuery(PM_FRAME_QUERY_HANDLE handle)
 {
 	LoadEndpointsIfEmpty_();
@@ -0,0 +1,73 @@
+#pragma once
+#include "ColumnContainer.h"
+#include <new>
+
+namespace pmapi
+{
+    ColumnContainer::ColumnContainer(const void* handle, size_t totalSize, uint32_t frameCapacity)
+        :
+        handle_{ handle },
+        totalSize_{ totalSize },
+        frameCapacity_{ frameCapacity }
+    {
+        pBytes_.reset(static_cast<uint8_t*>(::operator new[](totalSize_,
+            std::align_val_t{ PM_FRAME_QUERY_COLUMN_ALIGNMENT })));
+    }
+
+    ColumnContainer::ColumnContainer(ColumnContainer&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    ColumnContainer& ColumnContainer::operator=(ColumnContainer&& rhs) noexcept
+    {
+        if (&rhs != this)
+        {
+            handle_ = rhs.handle_;
+            totalSize_ = rhs.totalSize_;
+            frameCapacity_ = rhs.frameCapacity_;
+            nFramesFilledInOut_ = rhs.nFramesFilledInOut_;
+            pBytes_ = std::move(rhs.pBytes_);
+            rhs.Reset();
+        }
+        return *this;
+    }
+
+    size_t ColumnContainer::GetTotalSize() const { return totalSize_; }
+
+    uint32_t ColumnContainer::GetFrameCapacity() const { return frameCapacity_; }
+
+    uint32_t ColumnContainer::GetNumFramesPopulated() const { return nFramesFilledInOut_; }
+
+    bool ColumnContainer::AllFramesPopulated() const { return nFramesFilledInOut_ == frameCapacity_; }
+
+    const uint8_t* ColumnContainer::GetFirst() const { return pBytes_.get(); }
+
+    void ColumnContainer::Reset()
+    {
+        handle_ = nullptr;
+        totalSize_ = 0;
+        frameCapacity_ = 0;
+        nFramesFilledInOut_ = 0;
+        pBytes_.reset();
+    }
+
+    bool ColumnContainer::Empty() const
+    {
+        return !pBytes_;
+    }
+
+    ColumnContainer::operator bool() const { return !Empty(); }
+
+    void ColumnContainer::AlignedDelete_::operator()(uint8_t* p) const
+    {
+        ::operator delete[](p, std::align_val_t{ PM_FRAME_QUERY_COLUMN_ALIGNMENT });
+    }
+
+    uint8_t* ColumnContainer::GetFirst_() { return pBytes_.get(); }
+
+    uint32_t& ColumnContainer::AcquireNumFramesInRef_()
+    {
+        return nFramesFilledInOut_ = frameCapacity_;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <IntelPresentMon/PresentMonAPI2/PresentMonAPI.h>
+#include <memory>
+#include <span>
+#include <cstdint>
+#include <cassert>
+
+namespace pmapi
+{
+    // ColumnContainer holds the output of a frame query registered with the COLUMNS layout: an array per query
+    // element, each starting PM_FRAME_QUERY_COLUMN_ALIGNMENT-aligned, so that the values of a metric over the
+    // frames consumed can be reduced directly (vectorized etc.) without transposing blobs
+    // typically, should not be contructed directly, but rather from a FrameQuery
+    class ColumnContainer
+    {
+        friend class FrameQuery;
+    public:
+        // create empty column container
+        ColumnContainer() = default;
+        // create column container for a specific query, totalSize bytes holding frameCapacity frames
+        ColumnContainer(const void* handle, size_t totalSize, uint32_t frameCapacity);
+        // move ctor
+        ColumnContainer(ColumnContainer&& other) noexcept;
+        // move assign
+        ColumnContainer& operator=(ColumnContainer&& rhs) noexcept;
+        ColumnContainer(const ColumnContainer&) = delete;
+        ColumnContainer& operator=(const ColumnContainer&) = delete;
+        // size of all columns in bytes
+        size_t GetTotalSize() const;
+        // get number of frames each column has room for (max # of frames consumed at once)
+        uint32_t GetFrameCapacity() const;
+        // get the number of frames that were actually populated the last time this container was used in query call
+        uint32_t GetNumFramesPopulated() const;
+        // check if all frames were populated, useful when consuming frames to see if there might be frames left in the queue yet
+        bool AllFramesPopulated() const;
+        // get the values of a query element (as filled in by the query registration) for the frames populated
+        template<typename T>
+        std::span<const T> GetColumn(const PM_QUERY_ELEMENT& element) const
+        {
+            assert(sizeof(T) == element.dataSize);
+            return { reinterpret_cast<const T*>(pBytes_.get() + element.dataOffset), nFramesFilledInOut_ };
+        }
+        // get a pointer to the first byte of the first column
+        const uint8_t* GetFirst() const;
+        // check if this container is associated with query having handle
+        template<typename T>
+        bool CheckHandle(T handle) const
+        {
+            return static_cast<const void*>(handle) == handle_;
+        }
+        // clear out this container (free owned resources)
+        void Reset();
+        // check if empty
+        bool Empty() const;
+        // aliases Empty()
+        operator bool() const;
+    private:
+        // types
+        struct AlignedDelete_
+        {
+            void operator()(uint8_t* p) const;
+        };
+        // functions
+        uint8_t* GetFirst_();
+        uint32_t& AcquireNumFramesInRef_();
+        // data
+        const void* handle_ = nullptr;
+        size_t totalSize_ = 0;
+        uint32_t frameCapacity_ = 0;
+        uint32_t nFramesFilledInOut_ = 0;
+        std::unique_ptr<uint8_t[], AlignedDelete_> pBytes_;
+    };
+}
@@ -38,6 +38,18 @@ namespace pmapi
         }
     }
 
+    uint32_t DynamicQuery::PollProcesses(std::span<const uint32_t> processIds, uint8_t* pBlobs, uint32_t numSwapChains,
+        std::span<PM_DYNAMIC_QUERY_PROCESS_RESULT> results, uint8_t* pCombinedBlob) const
+    {
+        assert(processIds.empty() || processIds.size() <= results.size());
+        auto numProcesses = uint32_t(processIds.empty() ? results.size() : processIds.size());
+        if (auto sta = pmPollDynamicQueryProcesses(hQuery_, processIds.empty() ? nullptr : processIds.data(),
+            &numProcesses, pBlobs, numSwapChains, results.data(), pCombinedBlob); sta != PM_STATUS_SUCCESS) {
+            throw ApiErrorException{ sta, "multi-process dynamic poll call failed" };
+        }
+        return numProcesses;
+    }
+
     void DynamicQuery::Poll(const ProcessTracker& tracker, BlobContainer& blobs) const
     {
         assert(!Empty());
@@ -67,10 +79,11 @@ namespace pmapi
 
     DynamicQuery::operator bool() const { return !Empty(); }
 
-    DynamicQuery::DynamicQuery(PM_SESSION_HANDLE hSession, std::span<PM_QUERY_ELEMENT> elements, double winSizeMs, double metricOffsetMs)
+    DynamicQuery::DynamicQuery(PM_SESSION_HANDLE hSession, std::span<PM_QUERY_ELEMENT> elements, double winSizeMs, double metricOffsetMs,
+        const PM_DYNAMIC_QUERY_OPTIONS* pOptions)
     {
-        if (auto sta = pmRegisterDynamicQuery(hSession, &hQuery_, elements.data(),
-            elements.size(), winSizeMs, metricOffsetMs); sta != PM_STATUS_SUCCESS) {
+        if (auto sta = pmRegisterDynamicQueryWithOptions(hSession, &hQuery_, elements.data(),
+            elements.size(), winSizeMs, metricOffsetMs, pOptions); sta != PM_STATUS_SUCCESS) {
             throw ApiErrorException{ sta, "dynamic query register call failed" };
         }
         if (elements.size() > 0) {
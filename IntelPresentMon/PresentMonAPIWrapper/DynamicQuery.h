@@ -33,6 +33,13 @@ namespace pmapi
         // numSwapChains: input indicates to API how many blobs available, output indicates how many were written
         // if the target process has multiple swap chains, will poll data for as many swaps as there are blobs available
         void Poll(const ProcessTracker& tracker, uint8_t* pBlob, uint32_t& numSwapChains) const;
+        // poll several processes at the same time point using this query, writing a result for each one polled
+        // empty processIds polls every tracked process, as many as there are results
+        // pBlobs holds numSwapChains blobs for each process, packed in the order they are polled
+        // pCombinedBlob (optional) receives a blob of frame statistics over every swap chain of the processes polled
+        // returns the number of processes polled
+        uint32_t PollProcesses(std::span<const uint32_t> processIds, uint8_t* pBlobs, uint32_t numSwapChains,
+            std::span<PM_DYNAMIC_QUERY_PROCESS_RESULT> results, uint8_t* pCombinedBlob = nullptr) const;
         // create a blob container sized suited for this query
         // nBlobs parameter will control how many swaps can be polled maximum using the container
         BlobContainer MakeBlobContainer(uint32_t nBlobs) const;
@@ -44,7 +51,8 @@ namespace pmapi
         operator bool() const;
     private:
         // function
-        DynamicQuery(PM_SESSION_HANDLE hSession, std::span<PM_QUERY_ELEMENT> elements, double winSizeMs, double metricOffsetMs);
+        DynamicQuery(PM_SESSION_HANDLE hSession, std::span<PM_QUERY_ELEMENT> elements, double winSizeMs, double metricOffsetMs,
+            const PM_DYNAMIC_QUERY_OPTIONS* pOptions = nullptr);
         // zero out members, useful after emptying via move or reset
         void Clear_() noexcept;
         // data
@@ -21,6 +21,7 @@ namespace pmapi
         {
             hQuery_ = rhs.hQuery_;
             blobSize_ = rhs.blobSize_;
+            columnFrameCapacity_ = rhs.columnFrameCapacity_;
             rhs.Clear_();;
         }
         return *this;
@@ -31,6 +32,11 @@ namespace pmapi
         return blobSize_;
     }
 
+    bool FrameQuery::IsColumnar() const
+    {
+        return columnFrameCapacity_ != 0;
+    }
+
     void FrameQuery::Consume(const ProcessTracker& tracker, uint8_t* pBlobs, uint32_t& numBlobsInOut)
     {
         if (auto sta = pmConsumeFrames(hQuery_, tracker.GetPid(), pBlobs, &numBlobsInOut);
@@ -42,10 +48,19 @@ namespace pmapi
     void FrameQuery::Consume(const ProcessTracker& tracker, BlobContainer& blobs)
     {
         assert(!Empty());
+        assert(!IsColumnar());
         assert(blobs.CheckHandle(hQuery_));
         Consume(tracker, blobs.GetFirst(), blobs.AcquireNumBlobsInRef_());
     }
 
+    void FrameQuery::Consume(const ProcessTracker& tracker, ColumnContainer& columns)
+    {
+        assert(!Empty());
+        assert(IsColumnar());
+        assert(columns.CheckHandle(hQuery_));
+        Consume(tracker, columns.GetFirst_(), columns.AcquireNumFramesInRef_());
+    }
+
     size_t FrameQuery::ForEachConsume(ProcessTracker& tracker, BlobContainer& blobs, std::function<void(const uint8_t*)> frameHandler)
     {
         size_t nFramesProcessed = 0;
@@ -63,9 +78,17 @@ namespace pmapi
     BlobContainer FrameQuery::MakeBlobContainer(uint32_t nBlobs) const
     {
         assert(!Empty());
+        assert(!IsColumnar());
         return { hQuery_, blobSize_, nBlobs };
     }
 
+    ColumnContainer FrameQuery::MakeColumnContainer() const
+    {
+        assert(!Empty());
+        assert(IsColumnar());
+        return { hQuery_, blobSize_, columnFrameCapacity_ };
+    }
+
     void FrameQuery::Reset() noexcept
     {
         if (!Empty()) {
@@ -82,17 +105,21 @@ namespace pmapi
 
     FrameQuery::operator bool() const { return !Empty(); }
 
-    FrameQuery::FrameQuery(PM_SESSION_HANDLE hSession, std::span<PM_QUERY_ELEMENT> elements)
+    FrameQuery::FrameQuery(PM_SESSION_HANDLE hSession, std::span<PM_QUERY_ELEMENT> elements, const PM_FRAME_QUERY_OPTIONS* pOptions)
     {
-        if (auto sta = pmRegisterFrameQuery(hSession, &hQuery_, elements.data(), elements.size(), &blobSize_);
+        if (auto sta = pmRegisterFrameQueryWithOptions(hSession, &hQuery_, elements.data(), elements.size(), &blobSize_, pOptions);
             sta != PM_STATUS_SUCCESS) {
             throw ApiErrorException{ sta, "register frame query call failed" };
         }
+        if (pOptions && pOptions->layout == PM_FRAME_QUERY_LAYOUT_COLUMNS) {
+            columnFrameCapacity_ = pOptions->columnFrameCapacity;
+        }
     }
 
     void FrameQuery::Clear_() noexcept
     {
         hQuery_ = nullptr;
         blobSize_ = 0ull;
+        columnFrameCapacity_ = 0;
     }
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include <IntelPresentMon/PresentMonAPI2/PresentMonAPI.h>
 #include "BlobContainer.h"
+#include "ColumnContainer.h"
 #include "ProcessTracker.h"
 #include <span>
 #include <functional>
@@ -22,8 +23,10 @@ namespace pmapi
         FrameQuery(FrameQuery&& other) noexcept;
         // move assign
         FrameQuery& operator=(FrameQuery&& rhs) noexcept;
-        // get the size of blob memory required per frame of data consumed
+        // get the size of blob memory required per frame of data consumed (or for all frames consumed, if columnar)
         size_t GetBlobSize() const;
+        // check if this query was registered with the COLUMNS layout (consumed into a ColumnContainer)
+        bool IsColumnar() const;
         // consume frames of present data from a process using this query object and a managed blob container
         // number of frames consumed is minimum between capacity of container and # of frames pending in queue)
         void Consume(const ProcessTracker& tracker, BlobContainer& blobs);
@@ -35,9 +38,14 @@ namespace pmapi
         // consume frame events and invoke frameHandler for each frame consumed, setting active blob each time
         // will continue to call consume until all frames have been consumed from the queue
         size_t ForEachConsume(ProcessTracker& tracker, BlobContainer& blobs, std::function<void(const uint8_t*)> frameHandler);
+        // consume frames of present data from a process using this columnar query object into a column container
+        // number of frames consumed is minimum between frame capacity of the query and # of frames pending in queue
+        void Consume(const ProcessTracker& tracker, ColumnContainer& columns);
         // create a blob container whose size is suited to fit this query
         // nBlobs: number of frames worth of data that the container can contain
         BlobContainer MakeBlobContainer(uint32_t nBlobs) const;
+        // create a column container suited to fit this columnar query
+        ColumnContainer MakeColumnContainer() const;
         // empty this query object (frees resources)
         void Reset() noexcept;
         // check if this query object is empty
@@ -46,11 +54,13 @@ namespace pmapi
         operator bool() const;
     private:
         // functions
-        FrameQuery(PM_SESSION_HANDLE hSession, std::span<PM_QUERY_ELEMENT> elements);
+        FrameQuery(PM_SESSION_HANDLE hSession, std::span<PM_QUERY_ELEMENT> elements, const PM_FRAME_QUERY_OPTIONS* pOptions = nullptr);
         // zero out members, useful after emptying via move or reset
         void Clear_() noexcept;
         // data
         PM_FRAME_QUERY_HANDLE hQuery_ = nullptr;
         uint32_t blobSize_ = 0ull;
+        // frames per column if registered with the COLUMNS layout, otherwise zero
+        uint32_t columnFrameCapacity_ = 0;
     };
 }
@@ -31,6 +31,16 @@ namespace pmapi
         return pid_;
     }
 
+    uint32_t ProcessTracker::WaitForFrames(uint32_t minFrames, uint32_t timeoutMs) const
+    {
+        assert(!Empty());
+        uint32_t numFramesReady = 0;
+        if (auto sta = pmWaitForFrames(hSession_, pid_, minFrames, timeoutMs, &numFramesReady); sta != PM_STATUS_SUCCESS) {
+            throw ApiErrorException{ sta, "wait for frames call failed" };
+        }
+        return numFramesReady;
+    }
+
     void ProcessTracker::Reset() noexcept
     {
         if (!Empty()) {
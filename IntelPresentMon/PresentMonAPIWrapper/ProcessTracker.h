@@ -20,6 +20,9 @@ namespace pmapi
         ProcessTracker& operator=(ProcessTracker&& rhs) noexcept;
         // get the id of process being tracked
         uint32_t GetPid() const;
+        // block until at least minFrames new frames of the process are available or timeoutMs elapses
+        // returns the number of frames available
+        uint32_t WaitForFrames(uint32_t minFrames, uint32_t timeoutMs) const;
         // empty this tracker (stop tracking process if any)
         void Reset() noexcept;
         // check if tracker is empty
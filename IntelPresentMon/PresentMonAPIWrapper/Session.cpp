@@ -89,12 +89,25 @@ namespace pmapi
         return { handle_, elements, winSizeMs, metricOffsetMs };
     }
 
+    DynamicQuery Session::RegisterDyanamicQuery(std::span<PM_QUERY_ELEMENT> elements, const PM_DYNAMIC_QUERY_OPTIONS& options,
+        double winSizeMs, double metricOffsetMs)
+    {
+        assert(handle_);
+        return { handle_, elements, winSizeMs, metricOffsetMs, &options };
+    }
+
     FrameQuery Session::RegisterFrameQuery(std::span<PM_QUERY_ELEMENT> elements)
     {
         assert(handle_);
         return { handle_, elements };
     }
 
+    FrameQuery Session::RegisterFrameQuery(std::span<PM_QUERY_ELEMENT> elements, const PM_FRAME_QUERY_OPTIONS& options)
+    {
+        assert(handle_);
+        return { handle_, elements, &options };
+    }
+
     void Session::SetTelemetryPollingPeriod(uint32_t deviceId, uint32_t milliseconds)
     {
         assert(handle_);
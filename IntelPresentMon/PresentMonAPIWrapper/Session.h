@@ -53,8 +53,13 @@ namespace pmapi
         ProcessTracker TrackProcess(uint32_t pid);
         // register (build/compile) a dynamic query used to poll metrics
         DynamicQuery RegisterDyanamicQuery(std::span<PM_QUERY_ELEMENT> elements, double winSizeMs = 1000, double metricOffsetMs = 1020);
+        // register a dynamic query with options selecting the statistic backend (e.g. bounded-memory quantile sketches)
+        DynamicQuery RegisterDyanamicQuery(std::span<PM_QUERY_ELEMENT> elements, const PM_DYNAMIC_QUERY_OPTIONS& options,
+            double winSizeMs = 1000, double metricOffsetMs = 1020);
         // register (build/compile) a frame query used to consume frame events
         FrameQuery RegisterFrameQuery(std::span<PM_QUERY_ELEMENT> elements);
+        // register a frame query with options selecting the output layout (e.g. one array per element)
+        FrameQuery RegisterFrameQuery(std::span<PM_QUERY_ELEMENT> elements, const PM_FRAME_QUERY_OPTIONS& options);
         // set the rate at which the service polls device telemetry data
         // NOTE: this is independent/distinct from the rate at which a client app polls dynamic queries
         void SetTelemetryPollingPeriod(uint32_t deviceId, uint32_t milliseconds);
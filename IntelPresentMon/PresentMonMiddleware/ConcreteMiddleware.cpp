@@ -10,6 +10,7 @@
 #include <Shlwapi.h>
 #include <numeric>
 #include <algorithm>
+#include <bit>
 #include "../PresentMonUtils/QPCUtils.h"
 #include "../PresentMonAPI2/Internal.h"
 #include "../PresentMonAPIWrapperCommon/Introspection.h"
@@ -21,6 +22,7 @@
 #include "../Interprocess/source/PmStatusError.h"
 //#include "MockCommon.h"
 #include "DynamicQuery.h"
+#include "DynamicQueryPoll.h"
 #include "../ControlLib/PresentMonPowerTelemetry.h"
 #include "../ControlLib/CpuTelemetryInfo.h"
 #include "../PresentMonService/GlobalIdentifiers.h"
@@ -28,6 +30,7 @@
 #include "../CommonUtilities/mt/Thread.h"
 #include "../CommonUtilities/log/Log.h"
 #include "../CommonUtilities/Qpc.h"
+#include "../Streamer/TelemetryMetrics.h"
 
 #include "../CommonUtilities/log/GlogShim.h"
 
@@ -42,6 +45,183 @@ namespace pmon::mid
 
     static const uint32_t kMaxRespBufferSize = 4096;
 	static const uint64_t kClientFrameDeltaQPCThreshold = 50000000;
+    // number of eviction blocks a sketch-backed dynamic query window is divided into
+    static const uint32_t kSketchBlocksPerWindow = 16;
+    // relative accuracy of the percentiles combined over several windows of a query that keeps exact samples
+    static const double kCombinedSketchRelativeAccuracy = 0.01;
+
+    // Set the bits of the telemetry that metric (at arrayIndex) is calculated from; returns false if metric
+    // is not calculated from telemetry
+    static bool AddTelemetryCapBits(PM_METRIC metric, uint32_t arrayIndex, GpuTelemetryBitset& gpuBits,
+        CpuTelemetryBitset& cpuBits)
+    {
+        switch (metric) {
+        case PM_METRIC_GPU_POWER:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_power));
+            break;
+        case PM_METRIC_GPU_VOLTAGE:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_voltage));
+            break;
+        case PM_METRIC_GPU_FREQUENCY:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_frequency));
+            break;
+        case PM_METRIC_GPU_TEMPERATURE:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_temperature));
+            break;
+        case PM_METRIC_GPU_UTILIZATION:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_utilization));
+            break;
+        case PM_METRIC_GPU_RENDER_COMPUTE_UTILIZATION:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_render_compute_utilization));
+            break;
+        case PM_METRIC_GPU_MEDIA_UTILIZATION:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_media_utilization));
+            break;
+        case PM_METRIC_GPU_MEM_POWER:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_power));
+            break;
+        case PM_METRIC_GPU_MEM_VOLTAGE:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_voltage));
+            break;
+        case PM_METRIC_GPU_MEM_FREQUENCY:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_frequency));
+            break;
+        case PM_METRIC_GPU_MEM_EFFECTIVE_FREQUENCY:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_effective_frequency));
+            break;
+        case PM_METRIC_GPU_MEM_TEMPERATURE:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_temperature));
+            break;
+        case PM_METRIC_GPU_MEM_USED:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_used));
+            break;
+        case PM_METRIC_GPU_MEM_UTILIZATION:
+            // Gpu mem utilization is derived from mem size and mem used.
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_used));
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_size));
+            break;
+        case PM_METRIC_GPU_MEM_WRITE_BANDWIDTH:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_write_bandwidth));
+            break;
+        case PM_METRIC_GPU_MEM_READ_BANDWIDTH:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_read_bandwidth));
+            break;
+        case PM_METRIC_GPU_POWER_LIMITED:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_power_limited));
+            break;
+        case PM_METRIC_GPU_TEMPERATURE_LIMITED:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_temperature_limited));
+            break;
+        case PM_METRIC_GPU_CURRENT_LIMITED:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_current_limited));
+            break;
+        case PM_METRIC_GPU_VOLTAGE_LIMITED:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_voltage_limited));
+            break;
+        case PM_METRIC_GPU_UTILIZATION_LIMITED:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_utilization_limited));
+            break;
+        case PM_METRIC_GPU_MEM_POWER_LIMITED:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_power_limited));
+            break;
+        case PM_METRIC_GPU_MEM_TEMPERATURE_LIMITED:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_temperature_limited));
+            break;
+        case PM_METRIC_GPU_MEM_CURRENT_LIMITED:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_current_limited));
+            break;
+        case PM_METRIC_GPU_MEM_VOLTAGE_LIMITED:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_voltage_limited));
+            break;
+        case PM_METRIC_GPU_MEM_UTILIZATION_LIMITED:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_utilization_limited));
+            break;
+        case PM_METRIC_GPU_FAN_SPEED:
+            switch (arrayIndex)
+            {
+            case 0:
+                gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::fan_speed_0));
+                break;
+            case 1:
+                gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::fan_speed_1));
+                break;
+            case 2:
+                gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::fan_speed_2));
+                break;
+            case 3:
+                gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::fan_speed_3));
+                break;
+            case 4:
+                gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::fan_speed_4));
+                break;
+            }
+            break;
+        case PM_METRIC_GPU_FAN_SPEED_PERCENT:
+            switch (arrayIndex)
+            {
+            case 0:
+                gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::max_fan_speed_0));
+                break;
+            case 1:
+                gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::max_fan_speed_1));
+                break;
+            case 2:
+                gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::max_fan_speed_2));
+                break;
+            case 3:
+                gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::max_fan_speed_3));
+                break;
+            case 4:
+                gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::max_fan_speed_4));
+                break;
+            }
+            break;
+        case PM_METRIC_GPU_EFFECTIVE_FREQUENCY:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_effective_frequency));
+            break;
+        case PM_METRIC_GPU_VOLTAGE_REGULATOR_TEMPERATURE:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_voltage_regulator_temperature));
+            break;
+        case PM_METRIC_GPU_MEM_EFFECTIVE_BANDWIDTH:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_effective_bandwidth));
+            break;
+        case PM_METRIC_GPU_OVERVOLTAGE_PERCENT:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_overvoltage_percent));
+            break;
+        case PM_METRIC_GPU_TEMPERATURE_PERCENT:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_temperature_percent));
+            break;
+        case PM_METRIC_GPU_POWER_PERCENT:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_power_percent));
+            break;
+        case PM_METRIC_GPU_CARD_POWER:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_card_power));
+            break;
+        case PM_METRIC_GPU_FRAME_ENERGY:
+        case PM_METRIC_GPU_FRAME_POWER:
+            gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_frame_energy));
+            break;
+        case PM_METRIC_CPU_UTILIZATION:
+            cpuBits.set(static_cast<size_t>(CpuTelemetryCapBits::cpu_utilization));
+            break;
+        case PM_METRIC_CPU_POWER:
+            cpuBits.set(static_cast<size_t>(CpuTelemetryCapBits::cpu_power));
+            break;
+        case PM_METRIC_CPU_TEMPERATURE:
+            cpuBits.set(static_cast<size_t>(CpuTelemetryCapBits::cpu_temperature));
+            break;
+        case PM_METRIC_CPU_FREQUENCY:
+            cpuBits.set(static_cast<size_t>(CpuTelemetryCapBits::cpu_frequency));
+            break;
+        case PM_METRIC_CPU_CORE_UTILITY:
+            //cpuBits.set(static_cast<size_t>(CpuTelemetryCapBits::cpu_power));
+            break;
+        default:
+            return false;
+        }
+        return true;
+    }
+
 	ConcreteMiddleware::ConcreteMiddleware(std::optional<std::string> pipeNameOverride)
 	{
         const auto pipeName = pipeNameOverride.transform(&std::string::c_str)
@@ -89,6 +269,9 @@ namespace pmon::mid
         // Update the static GPU metric data from the service
         GetStaticGpuMetrics();
         GetStaticCpuMetrics();
+
+        // No telemetry is used until queries are registered
+        UpdateTelemetryDemand();
 	}
     
     ConcreteMiddleware::~ConcreteMiddleware() = default;
@@ -135,6 +318,8 @@ namespace pmon::mid
             }
             // Remove the input to frame start data for this process.
             mPclI2FsManager.RemoveProcess(targetPid);
+            // Remove any dynamic query windows accumulated for this process.
+            std::erase_if(queryWindows, [targetPid](const auto& entry) { return entry.first.second == targetPid; });
         }
         catch (...) {
             const auto code = util::GeneratePmStatus();
@@ -214,6 +399,29 @@ namespace pmon::mid
         return PM_STATUS_SUCCESS;
     }
 
+    void ConcreteMiddleware::UpdateTelemetryDemand()
+    {
+        static_assert(size_t(GpuTelemetryCapBits::gpu_telemetry_count) <= 64 &&
+            size_t(CpuTelemetryCapBits::cpu_telemetry_count) <= 64);
+        std::pair<GpuTelemetryBitset, CpuTelemetryBitset> demand;
+        for (auto& [pQuery, caps] : queryTelemetryDemands) {
+            demand.first |= caps.first;
+            demand.second |= caps.second;
+        }
+        if (demand == sentTelemetryDemand) {
+            return;
+        }
+        try {
+            pActionClient->DispatchSync(SetTelemetryDemand::Params{
+                demand.first.to_ullong(), demand.second.to_ullong() });
+            sentTelemetryDemand = demand;
+        }
+        catch (...) {
+            // a service that does not take demand samples all telemetry anyway
+            pmlog_warn(util::ReportException("Failed to set telemetry demand")).diag();
+        }
+    }
+
     PM_STATUS ConcreteMiddleware::SetEtwFlushPeriod(std::optional<uint32_t> periodMs)
     {
         try {
@@ -227,7 +435,7 @@ namespace pmon::mid
         return PM_STATUS_SUCCESS;
     }
 
-    PM_DYNAMIC_QUERY* ConcreteMiddleware::RegisterDynamicQuery(std::span<PM_QUERY_ELEMENT> queryElements, double windowSizeMs, double metricOffsetMs)
+    PM_DYNAMIC_QUERY* ConcreteMiddleware::RegisterDynamicQuery(std::span<PM_QUERY_ELEMENT> queryElements, double windowSizeMs, double metricOffsetMs, const PM_DYNAMIC_QUERY_OPTIONS* pOptions)
     { 
         // get introspection data for reference
         // TODO: cache this data so it's not required to be generated every time
@@ -307,164 +515,9 @@ namespace pmon::mid
             //case PM_METRIC_INSTRUMENTED_RENDER_DISPLAY_LATENCY:
                 pQuery->accumFpsData = true;
                 break;
-            case PM_METRIC_GPU_POWER:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_power));
-                break;
-            case PM_METRIC_GPU_VOLTAGE:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_voltage));
-                break;
-            case PM_METRIC_GPU_FREQUENCY:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_frequency));
-                break;
-            case PM_METRIC_GPU_TEMPERATURE:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_temperature));
-                break;
-            case PM_METRIC_GPU_UTILIZATION:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_utilization));
-                break;
-            case PM_METRIC_GPU_RENDER_COMPUTE_UTILIZATION:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_render_compute_utilization));
-                break;
-            case PM_METRIC_GPU_MEDIA_UTILIZATION:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_media_utilization));
-                break;
-            case PM_METRIC_GPU_MEM_POWER:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_power));
-                break;
-            case PM_METRIC_GPU_MEM_VOLTAGE:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_voltage));
-                break;
-            case PM_METRIC_GPU_MEM_FREQUENCY:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_frequency));
-                break;
-            case PM_METRIC_GPU_MEM_EFFECTIVE_FREQUENCY:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_effective_frequency));
-                break;
-            case PM_METRIC_GPU_MEM_TEMPERATURE:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_temperature));
-                break;
-            case PM_METRIC_GPU_MEM_USED:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_used));
-                break;
-            case PM_METRIC_GPU_MEM_UTILIZATION:
-                // Gpu mem utilization is derived from mem size and mem used.
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_used));
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_size));
-                break;
-            case PM_METRIC_GPU_MEM_WRITE_BANDWIDTH:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_write_bandwidth));
-                break;
-            case PM_METRIC_GPU_MEM_READ_BANDWIDTH:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_read_bandwidth));
-                break;
-            case PM_METRIC_GPU_POWER_LIMITED:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_power_limited));
-                break;
-            case PM_METRIC_GPU_TEMPERATURE_LIMITED:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_temperature_limited));
-                break;
-            case PM_METRIC_GPU_CURRENT_LIMITED:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_current_limited));
-                break;
-            case PM_METRIC_GPU_VOLTAGE_LIMITED:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_voltage_limited));
-                break;
-            case PM_METRIC_GPU_UTILIZATION_LIMITED:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_utilization_limited));
-                break;
-            case PM_METRIC_GPU_MEM_POWER_LIMITED:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_power_limited));
-                break;
-            case PM_METRIC_GPU_MEM_TEMPERATURE_LIMITED:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_temperature_limited));
-                break;
-            case PM_METRIC_GPU_MEM_CURRENT_LIMITED:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_current_limited));
-                break;
-            case PM_METRIC_GPU_MEM_VOLTAGE_LIMITED:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_voltage_limited));
-                break;
-            case PM_METRIC_GPU_MEM_UTILIZATION_LIMITED:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::vram_utilization_limited));
-                break;
-            case PM_METRIC_GPU_FAN_SPEED:
-                switch (qe.arrayIndex)
-                {
-                case 0:
-                    pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::fan_speed_0));
-                    break;
-                case 1:
-                    pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::fan_speed_1));
-                    break;
-                case 2:
-                    pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::fan_speed_2));
-                    break;
-                case 3:
-                    pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::fan_speed_3));
-                    break;
-                case 4:
-                    pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::fan_speed_4));
-                    break;
-                }
-                break;
-            case PM_METRIC_GPU_FAN_SPEED_PERCENT:
-                switch (qe.arrayIndex)
-                {
-                case 0:
-                    pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::max_fan_speed_0));
-                    break;
-                case 1:
-                    pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::max_fan_speed_1));
-                    break;
-                case 2:
-                    pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::max_fan_speed_2));
-                    break;
-                case 3:
-                    pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::max_fan_speed_3));
-                    break;
-                case 4:
-                    pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::max_fan_speed_4));
-                    break;
-                }
-                break;
-            case PM_METRIC_GPU_EFFECTIVE_FREQUENCY:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_effective_frequency));
-                break;
-            case PM_METRIC_GPU_VOLTAGE_REGULATOR_TEMPERATURE:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_voltage_regulator_temperature));
-                break;
-            case PM_METRIC_GPU_MEM_EFFECTIVE_BANDWIDTH:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_effective_bandwidth));
-                break;
-            case PM_METRIC_GPU_OVERVOLTAGE_PERCENT:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_overvoltage_percent));
-                break;
-            case PM_METRIC_GPU_TEMPERATURE_PERCENT:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_temperature_percent));
-                break;
-            case PM_METRIC_GPU_POWER_PERCENT:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_power_percent));
-                break;
-            case PM_METRIC_GPU_CARD_POWER:
-                pQuery->accumGpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_card_power));
-                break;
-            case PM_METRIC_CPU_UTILIZATION:
-                pQuery->accumCpuBits.set(static_cast<size_t>(CpuTelemetryCapBits::cpu_utilization));
-                break;
-            case PM_METRIC_CPU_POWER:
-                pQuery->accumCpuBits.set(static_cast<size_t>(CpuTelemetryCapBits::cpu_power));
-                break;
-            case PM_METRIC_CPU_TEMPERATURE:
-                pQuery->accumCpuBits.set(static_cast<size_t>(CpuTelemetryCapBits::cpu_temperature));
-                break;
-            case PM_METRIC_CPU_FREQUENCY:
-                pQuery->accumCpuBits.set(static_cast<size_t>(CpuTelemetryCapBits::cpu_frequency));
-                break;
-            case PM_METRIC_CPU_CORE_UTILITY:
-                //pQuery->accumCpuBits.set(static_cast<size_t>(CpuTelemetryCapBits::cpu_power));
-                break;
             default:
-                if (metricView.GetType() == PM_METRIC_TYPE_FRAME_EVENT) {
+                if (!AddTelemetryCapBits(qe.metric, qe.arrayIndex, pQuery->accumGpuBits, pQuery->accumCpuBits) &&
+                    metricView.GetType() == PM_METRIC_TYPE_FRAME_EVENT) {
                     pmlog_warn(std::format("ignoring frame event metric [{}] while building dynamic query",
                         metricView.Introspect().GetSymbol())).diag();
                 }
@@ -478,6 +531,9 @@ namespace pmon::mid
 
         pQuery->metricOffsetMs = metricOffsetMs;
         pQuery->windowSizeMs = windowSizeMs;
+        if (pOptions && pOptions->statBackend == PM_DYNAMIC_QUERY_STAT_BACKEND_SKETCH) {
+            pQuery->sketchRelativeAccuracy = pOptions->sketchRelativeAccuracy;
+        }
         pQuery->elements = std::vector<PM_QUERY_ELEMENT>{ queryElements.begin(), queryElements.end() };
         pQuery->queryCacheSize = pQuery->elements[std::size(pQuery->elements) - 1].dataOffset + pQuery->elements[std::size(pQuery->elements) - 1].dataSize;
         if (cachedGpuInfoIndex.has_value())
@@ -485,9 +541,20 @@ namespace pmon::mid
             pQuery->cachedGpuInfoIndex = cachedGpuInfoIndex.value();
         }
 
+        queryTelemetryDemands[pQuery.get()] = { pQuery->accumGpuBits, pQuery->accumCpuBits };
+        UpdateTelemetryDemand();
+
         return pQuery.release();
     }
 
+    void ConcreteMiddleware::FreeDynamicQuery(const PM_DYNAMIC_QUERY* pQuery)
+    {
+        // Release the sliding windows accumulated by polls of this query
+        std::erase_if(queryWindows, [pQuery](const auto& entry) { return entry.first.first == pQuery; });
+        queryTelemetryDemands.erase(pQuery);
+        UpdateTelemetryDemand();
+    }
+
 namespace {
 
 struct FakePMTraceSession {
@@ -596,6 +663,7 @@ void UpdateChain(
         }
         chain->mLastDisplayedScreenTime = lastDisplayedScreenTime;
         chain->display_count += 1;
+        chain->mPresentedTimes.push_back(p.PresentStartTime);
     }
 
     if (p.DisplayedCount > 0) {
@@ -886,7 +954,7 @@ static void ReportMetricsHelper(
                     if (simStartTime > chain->mLastDisplayedSimStartTime) {
                         metrics.mAnimationError = pmSession.TimestampDeltaToMilliSeconds(screenTime - chain->mLastDisplayedAppScreenTime,
                             simStartTime - chain->mLastDisplayedSimStartTime);
-                        chain->mAnimationError.push_back(std::abs(metrics.mAnimationError));
+                        chain->mAnimationError.Push(p->PresentStartTime, std::abs(metrics.mAnimationError));
                     }
                 }
             }
@@ -908,67 +976,70 @@ static void ReportMetricsHelper(
 
         // Push back all Present() information regardless of the source and if
         // the present was displayed
-        chain->mMsBetweenPresents.push_back(metrics.mMsBetweenPresents);
-        chain->mMsInPresentApi.push_back(metrics.mMsInPresentApi);
-        chain->mMsUntilRenderComplete.push_back(metrics.mMsUntilRenderComplete);
+        chain->mMsBetweenPresents.Push(p->PresentStartTime, metrics.mMsBetweenPresents);
+        chain->mMsInPresentApi.Push(p->PresentStartTime, metrics.mMsInPresentApi);
+        chain->mMsUntilRenderComplete.Push(p->PresentStartTime, metrics.mMsUntilRenderComplete);
 
         // Push back application based metrics regardless if the present was displayed
         if (displayIndex == appIndex) {
-            chain->mCPUBusy               .push_back(metrics.mCPUBusy);
-            chain->mCPUWait               .push_back(metrics.mCPUWait);
-            chain->mGPULatency            .push_back(metrics.mGPULatency);
-            chain->mGPUBusy               .push_back(metrics.mGPUBusy);
-            chain->mVideoBusy             .push_back(metrics.mVideoBusy);
-            chain->mGPUWait               .push_back(metrics.mGPUWait);
-            chain->mInstrumentedSleep     .push_back(metrics.mInstrumentedSleep);
-            chain->mInstrumentedGpuLatency.push_back(metrics.mInstrumentedGpuLatency);
+            chain->mCPUBusy               .Push(p->PresentStartTime, metrics.mCPUBusy);
+            chain->mCPUWait               .Push(p->PresentStartTime, metrics.mCPUWait);
+            chain->mGPULatency            .Push(p->PresentStartTime, metrics.mGPULatency);
+            chain->mGPUBusy               .Push(p->PresentStartTime, metrics.mGPUBusy);
+            chain->mVideoBusy             .Push(p->PresentStartTime, metrics.mVideoBusy);
+            chain->mGPUWait               .Push(p->PresentStartTime, metrics.mGPUWait);
+            chain->mInstrumentedSleep     .Push(p->PresentStartTime, metrics.mInstrumentedSleep);
+            chain->mInstrumentedGpuLatency.Push(p->PresentStartTime, metrics.mInstrumentedGpuLatency);
+            // IntelPresentMon specifics: derived series are windowed alongside their inputs
+            chain->mCPUFrameTime          .Push(p->PresentStartTime, metrics.mCPUBusy + metrics.mCPUWait);
+            chain->mGPUTime               .Push(p->PresentStartTime, metrics.mGPUBusy + metrics.mGPUWait);
         }
 
         // Push back all Display() information regardless of the source
         if (displayed) {
-            chain->mDisplayLatency                       .push_back(metrics.mDisplayLatency);
-            chain->mDisplayedTime                        .push_back(metrics.mDisplayedTime);
-            chain->mMsUntilDisplayed                     .push_back(metrics.mMsUntilDisplayed);
-            chain->mDropped                              .push_back(0.0);
+            chain->mDisplayLatency                       .Push(p->PresentStartTime, metrics.mDisplayLatency);
+            chain->mDisplayedTime                        .Push(p->PresentStartTime, metrics.mDisplayedTime);
+            chain->mMsUntilDisplayed                     .Push(p->PresentStartTime, metrics.mMsUntilDisplayed);
+            chain->mDropped                              .Push(p->PresentStartTime, 0.0);
             if (metrics.mMsBetweenDisplayChange != 0) {
                 // Only push back the mMsBetweenDisplayChange if it is non-zero. 
                 // mMsBetweenDisplayChange will be zero on the first use of the incoming 
                 // swap chain parameter.
-                chain->mMsBetweenDisplayChange.push_back(metrics.mMsBetweenDisplayChange);
+                chain->mMsBetweenDisplayChange.Push(p->PresentStartTime, metrics.mMsBetweenDisplayChange);
             }
         } else {
-            chain->mDropped       .push_back(1.0);
+            chain->mDropped       .Push(p->PresentStartTime, 1.0);
         }
 
         if (displayed) {
-            if (chain->mAppDisplayedTime.empty() || displayIndex == appIndex) {
-                chain->mAppDisplayedTime.push_back(metrics.mDisplayedTime);
+            if (chain->mAppDisplayedTime.Empty() || displayIndex == appIndex) {
+                chain->mAppDisplayedTime.Push(p->PresentStartTime, metrics.mDisplayedTime);
             }
             else {
-                chain->mAppDisplayedTime.back() += metrics.mDisplayedTime;
+                chain->mAppDisplayedTime.AddToNewest(metrics.mDisplayedTime);
             }
         } else {
-            chain->mDropped       .push_back(1.0);
+            chain->mDropped       .Push(p->PresentStartTime, 1.0);
         }
 
         if (displayed && displayIndex == appIndex) {
             if (metrics.mAllInputPhotonLatency != 0) {
-                chain->mAllInputToPhotonLatency.push_back(metrics.mAllInputPhotonLatency);
+                chain->mAllInputToPhotonLatency.Push(p->PresentStartTime, metrics.mAllInputPhotonLatency);
             }
             if (metrics.mClickToPhotonLatency != 0) {
-                chain->mClickToPhotonLatency.push_back(metrics.mClickToPhotonLatency);
+                chain->mClickToPhotonLatency.Push(p->PresentStartTime, metrics.mClickToPhotonLatency);
             }
             if (metrics.mInstrumentedRenderLatency != 0) {
-                chain->mInstrumentedRenderLatency.push_back(metrics.mInstrumentedRenderLatency);
+                chain->mInstrumentedRenderLatency.Push(p->PresentStartTime, metrics.mInstrumentedRenderLatency);
             }
             if (metrics.mInstrumentedDisplayLatency != 0) {
-                chain->mInstrumentedDisplayLatency.push_back(metrics.mInstrumentedDisplayLatency);
+                chain->mInstrumentedDisplayLatency.Push(p->PresentStartTime, metrics.mInstrumentedDisplayLatency);
             }
             if (metrics.mInstrumentedReadyTimeToDisplayLatency != 0) {
-                chain->mInstrumentedReadyTimeToDisplayLatency.push_back(metrics.mInstrumentedReadyTimeToDisplayLatency);
+                chain->mInstrumentedReadyTimeToDisplayLatency.Push(p->PresentStartTime, metrics.mInstrumentedReadyTimeToDisplayLatency);
             }
             if (metrics.mPcLatency != 0) {
-                chain->mMsPcLatency.push_back(metrics.mPcLatency);
+                chain->mMsPcLatency.Push(p->PresentStartTime, metrics.mPcLatency);
             }
         }
 
@@ -1018,33 +1089,151 @@ static void ReportMetrics(
     }
 }
 
+// Metrics that CalculateMetrics copies from the cached device info rather than computing from frames
+bool IsStaticMetric(PM_METRIC metric)
+{
+    switch (metric) {
+    case PM_METRIC_CPU_VENDOR:
+    case PM_METRIC_CPU_POWER_LIMIT:
+    case PM_METRIC_GPU_VENDOR:
+    case PM_METRIC_GPU_MEM_MAX_BANDWIDTH:
+    case PM_METRIC_GPU_MEM_SIZE:
+    case PM_METRIC_GPU_SUSTAINED_POWER_LIMIT:
+    case PM_METRIC_CPU_NAME:
+    case PM_METRIC_GPU_NAME:
+        return true;
+    default:
+        return false;
+    }
 }
 
-    void ConcreteMiddleware::PollDynamicQuery(const PM_DYNAMIC_QUERY* pQuery, uint32_t processId, uint8_t* pBlob, uint32_t* numSwapChains)
+// Key of the statistic the service publishes for an element of a poll whose window ends at frameQpc
+MetricCacheKey MakeMetricCacheKey(const PM_QUERY_ELEMENT& element, uint64_t frameQpc, double windowSizeMs)
+{
+    return MetricCacheKey{
+        .frame_qpc = frameQpc,
+        .window_size = std::bit_cast<uint64_t>(windowSizeMs),
+        .metric = uint32_t(element.metric),
+        .stat = uint32_t(element.stat),
+        .array_index = element.arrayIndex,
+    };
+}
+
+}
+
+    fpsSwapChainData::fpsSwapChainData(const MetricWindowOptions& options)
     {
-        std::unordered_map<uint64_t, fpsSwapChainData> swapChainData;
-        std::unordered_map<PM_METRIC, MetricInfo> metricInfo;
-        bool allMetricsCalculated = false;
-        bool fpsMetricsCalculated = false;
+        for (auto pWindow : GetMetricWindows_()) {
+            *pWindow = MetricWindow{ options };
+        }
+    }
 
+    void fpsSwapChainData::EvictThrough(uint64_t qpc)
+    {
+        for (auto pWindow : GetMetricWindows_()) {
+            pWindow->EvictThrough(qpc);
+        }
+        while (!mPresentedTimes.empty() && mPresentedTimes.front() <= qpc) {
+            mPresentedTimes.pop_front();
+        }
+    }
+
+    std::array<MetricWindow*, 27> fpsSwapChainData::GetMetricWindows_()
+    {
+        return {
+            &mCPUBusy, &mCPUWait, &mCPUFrameTime, &mGPULatency, &mGPUBusy, &mVideoBusy, &mGPUWait,
+            &mGPUTime, &mDisplayLatency, &mDisplayedTime, &mAppDisplayedTime, &mAnimationError,
+            &mClickToPhotonLatency, &mAllInputToPhotonLatency, &mDropped, &mInstrumentedDisplayLatency,
+            &mMsBetweenPresents, &mMsInPresentApi, &mMsUntilDisplayed, &mMsBetweenDisplayChange,
+            &mMsUntilRenderComplete, &mMsBetweenSimStarts, &mMsPcLatency, &mInstrumentedSleep,
+            &mInstrumentedRenderLatency, &mInstrumentedGpuLatency, &mInstrumentedReadyTimeToDisplayLatency,
+        };
+    }
+
+    void ConcreteMiddleware::SelectQueryAdapter(const PM_DYNAMIC_QUERY* pQuery)
+    {
+        if (auto adapterIndex = GetQueryAdapterSwitch(pQuery->cachedGpuInfoIndex, currentGpuInfoIndex))
+        {
+            // Set the adapter id
+            SetActiveGraphicsAdapter(cachedGpuInfo[*adapterIndex].deviceId);
+            // Set the current index to the queried one
+            currentGpuInfoIndex = *adapterIndex;
+        }
+    }
+
+    void ConcreteMiddleware::PollDynamicQuery(const PM_DYNAMIC_QUERY* pQuery, uint32_t processId, uint8_t* pBlob, uint32_t* numSwapChains)
+    {
         if (*numSwapChains == 0) {
             return;
         }
 
-        if (pQuery->cachedGpuInfoIndex.has_value())
-        {
-            if (pQuery->cachedGpuInfoIndex.value() != currentGpuInfoIndex)
-            {
-                // Set the adapter id 
-                SetActiveGraphicsAdapter(cachedGpuInfo[pQuery->cachedGpuInfoIndex.value()].deviceId);
-                // Set the current index to the queried one
-                currentGpuInfoIndex = pQuery->cachedGpuInfoIndex.value();
+        SelectQueryAdapter(pQuery);
+
+        LARGE_INTEGER client_qpc = {};
+        QueryPerformanceCounter(&client_qpc);
+        PollProcessDynamicQuery(pQuery, processId, client_qpc.QuadPart, pBlob, numSwapChains);
+    }
+
+    uint32_t ConcreteMiddleware::PollDynamicQueryProcesses(const PM_DYNAMIC_QUERY* pQuery, std::optional<std::span<const uint32_t>> processIds,
+        uint32_t maxProcesses, uint8_t* pBlobs, uint32_t numSwapChains, PM_DYNAMIC_QUERY_PROCESS_RESULT* pResults, uint8_t* pCombinedBlob)
+    {
+        if (numSwapChains == 0) {
+            return 0;
+        }
+
+        // the adapter and the time point are the same for every process, so that their windows line up
+        SelectQueryAdapter(pQuery);
+        LARGE_INTEGER client_qpc = {};
+        QueryPerformanceCounter(&client_qpc);
+
+        std::vector<uint32_t> trackedProcessIds;
+        if (!processIds) {
+            for (auto& [processId, client] : presentMonStreamClients) {
+                if (trackedProcessIds.size() == maxProcesses) {
+                    break;
+                }
+                trackedProcessIds.push_back(processId);
             }
+            processIds = trackedProcessIds;
         }
 
+        // a process that fails to poll (for example because its stream went away mid-poll) gets an error
+        // status of its own, and the others are still polled
+        const auto blobSize = pQuery->GetBlobSize();
+        const auto numPolled = PollDynamicQueryEachProcess(*processIds, numSwapChains, blobSize, pBlobs, pResults,
+            [&](uint32_t processId, uint8_t* pBlob, uint32_t* pNumSwapChains) {
+                return PollProcessDynamicQuery(pQuery, processId, client_qpc.QuadPart, pBlob, pNumSwapChains);
+            });
+
+        if (pCombinedBlob) {
+            std::vector<uint32_t> polledProcessIds;
+            for (uint32_t i = 0; i < numPolled; i++) {
+                if (pResults[i].status != PM_STATUS_SUCCESS || pResults[i].numSwapChains == 0) {
+                    continue;
+                }
+                // the metrics that are not frame statistics (telemetry, static and last present values) are
+                // those of the first process polled
+                if (polledProcessIds.empty()) {
+                    std::memcpy(pCombinedBlob, pBlobs + i * size_t(numSwapChains) * blobSize, blobSize);
+                }
+                polledProcessIds.push_back(pResults[i].processId);
+            }
+            if (polledProcessIds.empty()) {
+                std::memset(pCombinedBlob, 0, blobSize);
+            }
+            else {
+                CalculateCombinedFpsMetrics(pQuery, polledProcessIds, pCombinedBlob);
+            }
+        }
+
+        return numPolled;
+    }
+
+    PM_STATUS ConcreteMiddleware::PollProcessDynamicQuery(const PM_DYNAMIC_QUERY* pQuery, uint32_t processId, uint64_t clientQpc, uint8_t* pBlob, uint32_t* numSwapChains)
+    {
         auto iter = presentMonStreamClients.find(processId);
         if (iter == presentMonStreamClients.end()) {
-            return;
+            return PM_STATUS_INVALID_PID;
         }
 
         // Get the named shared memory associated with the stream client
@@ -1058,43 +1247,78 @@ static void ReportMetrics(
             // mapped view from client side.
             //StopStreamProcess(process_id);
             //return PM_STATUS::PM_STATUS_PROCESS_NOT_EXIST;
-            return;
+            return PM_STATUS_INVALID_PID;
         }
 
-        uint64_t index = 0;
+        uint64_t frame_num = 0;
         double adjusted_window_size_in_ms = pQuery->windowSizeMs;
         auto result = queryFrameDataDeltas.emplace(std::pair(std::pair(pQuery, processId), uint64_t()));
         auto queryToFrameDataDelta = &result.first->second;
         
-        PmNsmFrameData* frame_data = GetFrameDataStart(client, index, SecondsDeltaToQpc(pQuery->metricOffsetMs/1000., client->GetQpcFrequency()), *queryToFrameDataDelta, adjusted_window_size_in_ms);
+        PmNsmFrameData startFrame;
+        PmNsmFrameData* frame_data = GetFrameDataStart(client, frame_num, SecondsDeltaToQpc(pQuery->metricOffsetMs/1000., client->GetQpcFrequency()), clientQpc, *queryToFrameDataDelta, adjusted_window_size_in_ms,
+            startFrame);
         if (frame_data == nullptr) {
             pmlog_warn("Filling cached data in dynamic metric poll due to nullptr from GetFrameDataStart").diag();
             CopyMetricCacheToBlob(pQuery, processId, pBlob);
-            return;
+            return PM_STATUS_SUCCESS;
+        }
+
+        // The service may have published the statistics of this poll's window. It only publishes ones
+        // that depend on nothing but the frames of the window (see SharedMetricCache.h), so queries with
+        // frame metrics, which depend on the swap chain state and PC latency estimate kept here, and
+        // sketched queries are always computed here. The metric offset and the frame data delta have
+        // been applied by now, and select the frame looked up. A hit leaves the query's window behind:
+        // the next poll computed here feeds it the frames it missed, or rebuilds it if they are gone.
+        auto metricCache = nsm_view->GetMetricCache();
+        if (metricCache != nullptr && !pQuery->accumFpsData && !pQuery->sketchRelativeAccuracy &&
+            ReadSharedMetricCache(*metricCache, pQuery, frame_data->present_event.PresentStartTime,
+                adjusted_window_size_in_ms, pBlob)) {
+            SaveMetricCache(pQuery, processId, pBlob);
+            return PM_STATUS_SUCCESS;
         }
 
         // Calculate the end qpc based on the current frame's qpc and
         // requested window size coverted to a qpc
-        // then loop from the most recent frame data until we either run out of data or
-        // we meet the window size requirements sent in by the client
         uint64_t end_qpc =
             frame_data->present_event.PresentStartTime -
             SecondsDeltaToQpc(adjusted_window_size_in_ms/1000., client->GetQpcFrequency());
 
-        std::vector<PmNsmFrameData*> frames;
-        while (frame_data->present_event.PresentStartTime > end_qpc) {
-            frames.push_back(frame_data);
+        // The window persists across polls: only frames newer than the last one fed into it need
+        // to be processed. If the window moved backwards, or the frames between the previous poll
+        // and this one are no longer all available, rebuild it from the frames in the window.
+        auto& window = queryWindows[std::pair(pQuery, processId)];
+        if (frame_data->present_event.PresentStartTime < window.lastFrameQpc) {
+            window.Reset();
+        }
+        if (pQuery->sketchRelativeAccuracy) {
+            // sketch windows are evicted in whole blocks, so the window overshoots by at most one block
+            window.options.sketchRelativeAccuracy = pQuery->sketchRelativeAccuracy;
+            window.options.sketchBlockDuration = std::max<uint64_t>(1, SecondsDeltaToQpc(
+                pQuery->windowSizeMs / 1000. / double(kSketchBlocksPerWindow), client->GetQpcFrequency()));
+        }
 
-            // Get the index of the next frame
-            if (DecrementIndex(nsm_view, index) == false) {
-                // We have run out of data to process, time to go
-                break;
+        // Walk back from the most recent frame data until we either run out of data, meet the window
+        // size requirements sent in by the client, or reach the frames already in the window
+        std::vector<PmNsmFrameData*> frames;
+        // Frames copied out of the ring or decoded from the history; they back pointers in frames,
+        // so the containers must not move them
+        std::deque<PmNsmFrameData> frameCopies;
+        std::deque<std::shared_ptr<const std::vector<PmNsmFrameData>>> historyBlocks;
+        bool reachedWindow = false;
+        if (frame_data->present_event.PresentStartTime > end_qpc) {
+            if (frame_data->present_event.PresentStartTime <= window.lastFrameQpc) {
+                reachedWindow = true;
             }
-            frame_data = client->ReadFrameByIdx(index, true);
-            if (frame_data == nullptr) {
-                break;
+            else {
+                frames.push_back(frame_data);
+                ReadFramesBefore(client, frame_num, end_qpc, window.lastFrameQpc, frames,
+                    frameCopies, historyBlocks, reachedWindow);
             }
         }
+        if (!reachedWindow && window.lastFrameQpc != 0) {
+            window.Reset();
+        }
 
         FakePMTraceSession pmSession;
         pmSession.mMilliSecondsPerTimestamp = 1000.0 / client->GetQpcFrequency().QuadPart;
@@ -1102,8 +1326,8 @@ static void ReportMetrics(
         for (const auto& frame_data : frames | std::views::reverse) {
             if (pQuery->accumFpsData)
             {
-                auto result = swapChainData.emplace(
-                    frame_data->present_event.SwapChainAddress, fpsSwapChainData());
+                auto result = window.swapChainData.try_emplace(
+                    frame_data->present_event.SwapChainAddress, window.options);
                 auto swap_chain = &result.first->second;
 
                 auto presentEvent = &frame_data->present_event;
@@ -1118,22 +1342,74 @@ static void ReportMetrics(
                 // end
             }
 
+            const auto frameQpc = frame_data->present_event.PresentStartTime;
             for (size_t i = 0; i < pQuery->accumGpuBits.size(); ++i) {
                 if (pQuery->accumGpuBits[i])
                 {
-                    GetGpuMetricData(i, frame_data->power_telemetry, metricInfo);
+                    GetGpuMetricData(i, frame_data->power_telemetry, frameQpc, window);
                 }
             }
 
             for (size_t i = 0; i < pQuery->accumCpuBits.size(); ++i) {
                 if (pQuery->accumCpuBits[i])
                 {
-                    GetCpuMetricData(i, frame_data->cpu_telemetry, metricInfo);
+                    GetCpuMetricData(i, frame_data->cpu_telemetry, frameQpc, window);
                 }
             }
+
+            window.lastFrameQpc = frameQpc;
+        }
+
+        // Drop everything that has slid out of the window. Swap chains without a present in the
+        // window are forgotten, as they would not have been seen by a fresh walk of the window.
+        for (auto it = window.swapChainData.begin(); it != window.swapChainData.end();) {
+            if (it->second.mLastPresent.PresentStartTime <= end_qpc) {
+                it = window.swapChainData.erase(it);
+            }
+            else {
+                it->second.EvictThrough(end_qpc);
+                ++it;
+            }
+        }
+        for (auto& [metric, info] : window.metricInfo) {
+            for (auto& [arrayIndex, data] : info.data) {
+                data.EvictThrough(end_qpc);
+            }
         }
 
-        CalculateMetrics(pQuery, processId, pBlob, numSwapChains, client->GetQpcFrequency(), swapChainData, metricInfo);
+        CalculateMetrics(pQuery, processId, pBlob, numSwapChains, client->GetQpcFrequency(), window.swapChainData, window.metricInfo);
+        return PM_STATUS_SUCCESS;
+    }
+
+    bool ConcreteMiddleware::ReadSharedMetricCache(const SharedMetricCache& cache, const PM_DYNAMIC_QUERY* pQuery, uint64_t frameQpc,
+        double windowSizeMs, uint8_t* pBlob)
+    {
+        // look everything up before touching the blob, so that a miss leaves it as it was
+        std::vector<uint64_t> values(pQuery->elements.size());
+        for (size_t i = 0; i < pQuery->elements.size(); i++) {
+            auto& qe = pQuery->elements[i];
+            if (IsStaticMetric(qe.metric)) {
+                continue;
+            }
+            if (qe.dataSize != sizeof(double) ||
+                !cache.Lookup(MakeMetricCacheKey(qe, frameQpc, windowSizeMs), values[i])) {
+                return false;
+            }
+        }
+
+        for (size_t i = 0; i < pQuery->elements.size(); i++) {
+            auto& qe = pQuery->elements[i];
+            if (qe.metric == PM_METRIC_CPU_NAME || qe.metric == PM_METRIC_GPU_NAME) {
+                CopyStaticMetricData(qe.metric, qe.deviceId, pBlob, qe.dataOffset, 260);
+            }
+            else if (IsStaticMetric(qe.metric)) {
+                CopyStaticMetricData(qe.metric, qe.deviceId, pBlob, qe.dataOffset);
+            }
+            else {
+                std::memcpy(&pBlob[qe.dataOffset], &values[i], size_t(qe.dataSize));
+            }
+        }
+        return true;
     }
 
     std::optional<size_t> ConcreteMiddleware::GetCachedGpuInfoIndex(uint32_t deviceId)
@@ -1257,23 +1533,69 @@ static void ReportMetrics(
         return;
     }
 
-    PM_FRAME_QUERY* mid::ConcreteMiddleware::RegisterFrameEventQuery(std::span<PM_QUERY_ELEMENT> queryElements, uint32_t& blobSize)
+    PM_FRAME_QUERY* mid::ConcreteMiddleware::RegisterFrameEventQuery(std::span<PM_QUERY_ELEMENT> queryElements, uint32_t& blobSize, const PM_FRAME_QUERY_OPTIONS* pOptions)
     {
-        const auto pQuery = new PM_FRAME_QUERY{ queryElements };
+        const auto columnFrameCapacity = pOptions && pOptions->layout == PM_FRAME_QUERY_LAYOUT_COLUMNS ?
+            pOptions->columnFrameCapacity : 0u;
+        const auto pQuery = new PM_FRAME_QUERY{ queryElements, columnFrameCapacity };
         blobSize = (uint32_t)pQuery->GetBlobSize();
+
+        // frames carry the telemetry of every metric, including those that dynamic queries get statically
+        auto& [gpuBits, cpuBits] = queryTelemetryDemands[pQuery];
+        for (auto& qe : queryElements) {
+            if (qe.metric == PM_METRIC_GPU_MEM_SIZE) {
+                gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_size));
+            }
+            else if (qe.metric == PM_METRIC_GPU_MEM_MAX_BANDWIDTH) {
+                gpuBits.set(static_cast<size_t>(GpuTelemetryCapBits::gpu_mem_max_bandwidth));
+            }
+            else {
+                AddTelemetryCapBits(qe.metric, qe.arrayIndex, gpuBits, cpuBits);
+            }
+        }
+        UpdateTelemetryDemand();
+
         return pQuery;
     }
 
     void mid::ConcreteMiddleware::FreeFrameEventQuery(const PM_FRAME_QUERY* pQuery)
     {
+        queryTelemetryDemands.erase(pQuery);
+        UpdateTelemetryDemand();
         delete const_cast<PM_FRAME_QUERY*>(pQuery);
     }
 
+    uint32_t mid::ConcreteMiddleware::WaitForFrames(uint32_t processId, uint32_t minFrames, uint32_t timeoutMs)
+    {
+        StreamClient* pShmClient = nullptr;
+        try {
+            pShmClient = presentMonStreamClients.at(processId).get();
+        }
+        catch (...) {
+            pmlog_error("Stream client for process {} doesn't exist. Please call pmStartStream to initialize the client.").diag();
+            throw Except<util::Exception>(std::format("Failed to find stream for pid {} in WaitForFrames", processId));
+        }
+
+        // the wait returns early when the process goes away, so that is checked after it as well as before
+        const auto nsm_hdr = pShmClient->GetNamedSharedMemView()->GetHeader();
+        if (nsm_hdr->process_active) {
+            const auto numFramesReady = pShmClient->WaitForFrames(minFrames, timeoutMs);
+            if (nsm_hdr->process_active || numFramesReady > 0) {
+                return (uint32_t)std::min<uint64_t>(numFramesReady, UINT32_MAX);
+            }
+        }
+        StopStreaming(processId);
+        pmlog_dbg("Process death detected while waiting for frames").diag();
+        throw Except<ipc::PmStatusError>(PM_STATUS_INVALID_PID, "Process died cannot wait for frames");
+    }
+
     void mid::ConcreteMiddleware::ConsumeFrameEvents(const PM_FRAME_QUERY* pQuery, uint32_t processId, uint8_t* pBlob, uint32_t& numFrames)
     {
         PM_STATUS status = PM_STATUS::PM_STATUS_SUCCESS;
 
-        const auto frames_to_copy = numFrames;
+        // a columnar output has room for a fixed number of frames
+        const auto frames_to_copy = pQuery->IsColumnar() ?
+            std::min(numFrames, pQuery->GetColumnFrameCapacity()) : numFrames;
         // We have saved off the number of frames to copy, now set
         // to zero in case we error out along the way BEFORE we
         // copy frames into the buffer. If a successful copy occurs
@@ -1328,85 +1650,111 @@ static void ReportMetrics(
             pShmClient->GetQpcFrequency().QuadPart,
             currentFrameTimingData };
 
-        while (frames_copied < frames_to_copy) {
-            const PmNsmFrameData* pCurrentFrameData = nullptr;
-            const PmNsmFrameData* pNextFrameData = nullptr;
-            const PmNsmFrameData* pFrameDataOfLastPresented = nullptr;
-            const PmNsmFrameData* pFrameDataOfLastAppPresented = nullptr;
-            const PmNsmFrameData* pFrameDataOfNextDisplayed = nullptr;
-            const PmNsmFrameData* pFrameDataOfLastDisplayed = nullptr;
-            const PmNsmFrameData* pFrameDataOfLastAppDisplayed = nullptr;
-            const PmNsmFrameData* pFrameDataOfPreviousAppFrameOfLastAppDisplayed = nullptr;
-            const auto status = pShmClient->ConsumePtrToNextNsmFrameData(&pCurrentFrameData, &pNextFrameData,
-                &pFrameDataOfNextDisplayed, &pFrameDataOfLastPresented, &pFrameDataOfLastAppPresented,
-                &pFrameDataOfLastDisplayed, &pFrameDataOfLastAppDisplayed, &pFrameDataOfPreviousAppFrameOfLastAppDisplayed);
+        // frames are resolved one at a time as they are consumed, but gathered into the blobs in
+        // batches so that the query's ops each run over several frames at once
+        std::vector<PM_FRAME_QUERY::FrameRow> rows;
+        rows.reserve(PM_FRAME_QUERY::gatherBatchSize * 2);
+        uint32_t frames_gathered = 0;
+        const auto gatherRows = [&] {
+            pQuery->GatherRowsToBlobs(ctx, rows, pBlob, frames_gathered);
+            frames_gathered += (uint32_t)rows.size();
+            rows.clear();
+        };
+
+        // read frames in from the columnar stream when the service publishes one, so that of the
+        // telemetry only the fields this query copies out are touched
+        pShmClient->OpenColumnarView(pQuery->GetSourceOffsets());
+
+        // frames are peeked from the ring a batch at a time, with the neighbors of every frame in
+        // the batch resolved in a single pass, and then only the frames that were used are dequeued
+        std::vector<StreamClient::NsmFrameNeighbors> batch;
+        bool blobFull = false;
+        while (!blobFull && frames_copied < frames_to_copy) {
+            const auto status = pShmClient->PeekNsmFrameBatch(batch, frames_to_copy - frames_copied);
             if (status != PM_STATUS::PM_STATUS_SUCCESS) {
                 pmlog_error("Error while trying to get frame data from shared memory").diag();
                 throw Except<util::Exception>("Error while trying to get frame data from shared memory");
             }
-            if (!pCurrentFrameData) {
+            if (batch.empty()) {
                 break;
             }
-            if (pFrameDataOfLastPresented && pFrameDataOfLastAppPresented && pFrameDataOfNextDisplayed) {
-                ctx.UpdateSourceData(pCurrentFrameData,
-                    pFrameDataOfNextDisplayed,
-                    pFrameDataOfLastPresented,
-                    pFrameDataOfLastAppPresented,
-                    pFrameDataOfLastDisplayed,
-                    pFrameDataOfLastAppDisplayed,
-                    pFrameDataOfPreviousAppFrameOfLastAppDisplayed);
-
-                if (ctx.dropped && ctx.pSourceFrameData->present_event.DisplayedCount == 0) {
-                        pQuery->GatherToBlob(ctx, pBlob);
-                        pBlob += pQuery->GetBlobSize();
-                        frames_copied++;
-                } else {
-                    while (ctx.sourceFrameDisplayIndex < ctx.pSourceFrameData->present_event.DisplayedCount) {
-                        if (ctx.pSourceFrameData->present_event.PclSimStartTime != 0) {
-                            // If we are calculating PC Latency then we need to update the input to frame start
-                            // time.
-                            if (ctx.pSourceFrameData->present_event.PclInputPingTime == 0) {
-                                if (ctx.mAccumulatedInput2FrameStartTime != 0) {
-                                    // This frame was displayed but we don't have a pc latency input time. However, there is accumulated time
-                                    // so there is a pending input that will now hit the screen. Add in the time from the last not
-                                    // displayed pc simulation start to this frame's pc simulation start.
-                                    ctx.mAccumulatedInput2FrameStartTime +=
-                                        pmSession.TimestampDeltaToUnsignedMilliSeconds(
-                                            ctx.mLastReceivedNotDisplayedPclSimStart,
-                                            ctx.pSourceFrameData->present_event.PclSimStartTime);
-                                    // Add all of the accumlated time to the average input to frame start time.
+            size_t framesConsumed = 0;
+            for (const auto& frame : batch) {
+                framesConsumed++;
+                const auto pCurrentFrameData = frame.pFrameData;
+                const auto pNextFrameData = frame.pNextFrame;
+                const auto pFrameDataOfNextDisplayed = frame.pFrameDataOfNextDisplayed;
+                const auto pFrameDataOfLastPresented = frame.pFrameDataOfLastPresented;
+                const auto pFrameDataOfLastAppPresented = frame.pFrameDataOfLastAppPresented;
+                const auto pFrameDataOfLastDisplayed = frame.pFrameDataOfLastDisplayed;
+                const auto pFrameDataOfLastAppDisplayed = frame.pFrameDataOfLastAppDisplayed;
+                const auto pFrameDataOfPreviousAppFrameOfLastAppDisplayed = frame.pFrameDataOfPreviousAppFrameOfLastAppDisplayed;
+                if (pFrameDataOfLastPresented && pFrameDataOfLastAppPresented && pFrameDataOfNextDisplayed) {
+                    ctx.UpdateSourceData(pCurrentFrameData,
+                        pFrameDataOfNextDisplayed,
+                        pFrameDataOfLastPresented,
+                        pFrameDataOfLastAppPresented,
+                        pFrameDataOfLastDisplayed,
+                        pFrameDataOfLastAppDisplayed,
+                        pFrameDataOfPreviousAppFrameOfLastAppDisplayed);
+
+                    if (ctx.dropped && ctx.pSourceFrameData->present_event.DisplayedCount == 0) {
+                            pQuery->ResolveRow(ctx, rows.emplace_back());
+                            frames_copied++;
+                    } else {
+                        while (ctx.sourceFrameDisplayIndex < ctx.pSourceFrameData->present_event.DisplayedCount) {
+                            if (ctx.pSourceFrameData->present_event.PclSimStartTime != 0) {
+                                // If we are calculating PC Latency then we need to update the input to frame start
+                                // time.
+                                if (ctx.pSourceFrameData->present_event.PclInputPingTime == 0) {
+                                    if (ctx.mAccumulatedInput2FrameStartTime != 0) {
+                                        // This frame was displayed but we don't have a pc latency input time. However, there is accumulated time
+                                        // so there is a pending input that will now hit the screen. Add in the time from the last not
+                                        // displayed pc simulation start to this frame's pc simulation start.
+                                        ctx.mAccumulatedInput2FrameStartTime +=
+                                            pmSession.TimestampDeltaToUnsignedMilliSeconds(
+                                                ctx.mLastReceivedNotDisplayedPclSimStart,
+                                                ctx.pSourceFrameData->present_event.PclSimStartTime);
+                                        // Add all of the accumlated time to the average input to frame start time.
+                                        mPclI2FsManager.AddI2FsValueForProcess(
+                                            ctx.pSourceFrameData->present_event.ProcessId,
+                                            ctx.mLastReceivedNotDisplayedPclInputTime,
+                                            ctx.mAccumulatedInput2FrameStartTime);
+                                        // Reset the tracking variables for when we have a dropped frame with a pc latency input
+                                        ctx.mAccumulatedInput2FrameStartTime = 0.f;
+                                        ctx.mLastReceivedNotDisplayedPclSimStart = 0;
+                                        ctx.mLastReceivedNotDisplayedPclInputTime = 0;
+                                    }
+                                } else {
                                     mPclI2FsManager.AddI2FsValueForProcess(
                                         ctx.pSourceFrameData->present_event.ProcessId,
-                                        ctx.mLastReceivedNotDisplayedPclInputTime,
-                                        ctx.mAccumulatedInput2FrameStartTime);
-                                    // Reset the tracking variables for when we have a dropped frame with a pc latency input
-                                    ctx.mAccumulatedInput2FrameStartTime = 0.f;
-                                    ctx.mLastReceivedNotDisplayedPclSimStart = 0;
-                                    ctx.mLastReceivedNotDisplayedPclInputTime = 0;
-                                }
-                            } else {
-                                mPclI2FsManager.AddI2FsValueForProcess(
-                                    ctx.pSourceFrameData->present_event.ProcessId,
-                                    ctx.pSourceFrameData->present_event.PclInputPingTime,
-                                    pmSession.TimestampDeltaToUnsignedMilliSeconds(
                                         ctx.pSourceFrameData->present_event.PclInputPingTime,
-                                        ctx.pSourceFrameData->present_event.PclSimStartTime));
+                                        pmSession.TimestampDeltaToUnsignedMilliSeconds(
+                                            ctx.pSourceFrameData->present_event.PclInputPingTime,
+                                            ctx.pSourceFrameData->present_event.PclSimStartTime));
+                                }
                             }
+                            ctx.avgInput2Fs = mPclI2FsManager.GetI2FsForProcess(ctx.pSourceFrameData->present_event.ProcessId);
+                            pQuery->ResolveRow(ctx, rows.emplace_back());
+                            frames_copied++;
+                            ctx.sourceFrameDisplayIndex++;
                         }
-                        ctx.avgInput2Fs = mPclI2FsManager.GetI2FsForProcess(ctx.pSourceFrameData->present_event.ProcessId);
-                        pQuery->GatherToBlob(ctx, pBlob);
-                        pBlob += pQuery->GetBlobSize();
-                        frames_copied++;
-                        ctx.sourceFrameDisplayIndex++;
                     }
-                }
 
+                }
+                if (rows.size() >= PM_FRAME_QUERY::gatherBatchSize) {
+                    gatherRows();
+                }
+                // Check to see if the next frame produces more frames than we can store in the
+                // the blob.
+                if (frames_copied + pNextFrameData->present_event.DisplayedCount >= frames_to_copy) {
+                    blobFull = true;
+                    break;
+                }
             }
-            // Check to see if the next frame produces more frames than we can store in the
-            // the blob.
-            if (frames_copied + pNextFrameData->present_event.DisplayedCount >= frames_to_copy) {
-                break;
-            }
+            // rows point into the copies of the peeked frames, so gather them before the next peek
+            gatherRows();
+            pShmClient->CommitNsmFrameBatch(framesConsumed);
         }
         // Set to the actual number of frames copied
         numFrames = frames_copied;
@@ -1427,6 +1775,76 @@ static void ReportMetrics(
         pActionClient->DispatchSync(StopPlayback::Params{});
     }
 
+    // Window of a frame metric's samples, whether its statistics are taken in inverted order (rates from
+    // intervals) and whether they are converted from ms to fps; null for metrics that are not statistics
+    static const MetricWindow* GetFpsMetricWindow(const fpsSwapChainData& swapChain, PM_METRIC metric, bool& invert, bool& toFps)
+    {
+        invert = false;
+        toFps = false;
+        switch (metric)
+        {
+        case PM_METRIC_CPU_BUSY:
+            return &swapChain.mCPUBusy;
+        case PM_METRIC_CPU_WAIT:
+            return &swapChain.mCPUWait;
+        case PM_METRIC_CPU_FRAME_TIME:
+            return &swapChain.mCPUFrameTime;
+        case PM_METRIC_GPU_LATENCY:
+            return &swapChain.mGPULatency;
+        case PM_METRIC_GPU_BUSY:
+            return &swapChain.mGPUBusy;
+        case PM_METRIC_GPU_WAIT:
+            return &swapChain.mGPUWait;
+        case PM_METRIC_GPU_TIME:
+            return &swapChain.mGPUTime;
+        case PM_METRIC_DISPLAY_LATENCY:
+            return &swapChain.mDisplayLatency;
+        case PM_METRIC_DISPLAYED_TIME:
+            return &swapChain.mDisplayedTime;
+        case PM_METRIC_ANIMATION_ERROR:
+            return &swapChain.mAnimationError;
+        case PM_METRIC_PRESENTED_FPS:
+            invert = true;
+            toFps = true;
+            return &swapChain.mMsBetweenPresents;
+        case PM_METRIC_APPLICATION_FPS:
+            toFps = true;
+            return &swapChain.mCPUFrameTime;
+        case PM_METRIC_DISPLAYED_FPS:
+            invert = true;
+            toFps = true;
+            return &swapChain.mMsBetweenDisplayChange;
+        case PM_METRIC_DROPPED_FRAMES:
+            return &swapChain.mDropped;
+        case PM_METRIC_CLICK_TO_PHOTON_LATENCY:
+            return &swapChain.mClickToPhotonLatency;
+        case PM_METRIC_ALL_INPUT_TO_PHOTON_LATENCY:
+            return &swapChain.mAllInputToPhotonLatency;
+        case PM_METRIC_INSTRUMENTED_LATENCY:
+            return &swapChain.mInstrumentedDisplayLatency;
+        case PM_METRIC_BETWEEN_PRESENTS:
+            return &swapChain.mMsBetweenPresents;
+        case PM_METRIC_IN_PRESENT_API:
+            return &swapChain.mMsInPresentApi;
+        case PM_METRIC_UNTIL_DISPLAYED:
+            return &swapChain.mMsUntilDisplayed;
+        case PM_METRIC_BETWEEN_DISPLAY_CHANGE:
+            return &swapChain.mMsBetweenDisplayChange;
+        case PM_METRIC_RENDER_PRESENT_LATENCY:
+            return &swapChain.mMsUntilRenderComplete;
+        case PM_METRIC_BETWEEN_SIMULATION_START:
+            return &swapChain.mMsBetweenSimStarts;
+        case PM_METRIC_PC_LATENCY:
+            return &swapChain.mMsPcLatency;
+        case PM_METRIC_PRESENTED_FRAME_TIME:
+            return &swapChain.mMsBetweenPresents;
+        case PM_METRIC_DISPLAYED_FRAME_TIME:
+            return &swapChain.mMsBetweenDisplayChange;
+        default:
+            return nullptr;
+        }
+    }
+
     void ConcreteMiddleware::CalculateFpsMetric(fpsSwapChainData& swapChain, const PM_QUERY_ELEMENT& element, uint8_t* pBlob, LARGE_INTEGER qpcFrequency)
     {
         auto& output = reinterpret_cast<double&>(pBlob[element.dataOffset]);
@@ -1454,112 +1872,58 @@ static void ReportMetrics(
         case PM_METRIC_FRAME_TYPE:
             reinterpret_cast<PM_FRAME_TYPE&>(pBlob[element.dataOffset]) = (PM_FRAME_TYPE)(swapChain.mLastPresent.DisplayedCount == 0 ? FrameType::NotSet : swapChain.mLastPresent.Displayed_FrameType[0]);
             break;
-        case PM_METRIC_CPU_BUSY:
-            output = CalculateStatistic(swapChain.mCPUBusy, element.stat);
-            break;
-        case PM_METRIC_CPU_WAIT:
-            output = CalculateStatistic(swapChain.mCPUWait, element.stat);
-            break;
-        case PM_METRIC_CPU_FRAME_TIME:
+        default:
         {
-            std::vector<double> frame_times(swapChain.mCPUBusy.size());
-            for (size_t i = 0; i < swapChain.mCPUBusy.size(); ++i) {
-                frame_times[i] = swapChain.mCPUBusy[i] + swapChain.mCPUWait[i];
+            bool invert = false;
+            bool toFps = false;
+            if (auto pWindow = GetFpsMetricWindow(swapChain, element.metric, invert, toFps)) {
+                output = CalculateStatistic(*pWindow, element.stat, invert);
+                if (toFps) {
+                    output = output == 0 ? 0 : 1000.0 / output;
+                }
             }
-            output = CalculateStatistic(frame_times, element.stat);
-            break;
-        }
-        case PM_METRIC_GPU_LATENCY:
-            output = CalculateStatistic(swapChain.mGPULatency, element.stat);
-            break;
-        case PM_METRIC_GPU_BUSY:
-            output = CalculateStatistic(swapChain.mGPUBusy, element.stat);
-            break;
-        case PM_METRIC_GPU_WAIT:
-            output = CalculateStatistic(swapChain.mGPUWait, element.stat);
-            break;
-        case PM_METRIC_GPU_TIME:
-        {
-            std::vector<double> gpu_duration(swapChain.mGPUBusy.size());
-            for (size_t i = 0; i < swapChain.mGPUBusy.size(); ++i) {
-                gpu_duration[i] = swapChain.mGPUBusy[i] + swapChain.mGPUWait[i];
+            else {
+                output = 0.;
             }
-            output = CalculateStatistic(gpu_duration, element.stat);
             break;
         }
-        case PM_METRIC_DISPLAY_LATENCY:
-            output = CalculateStatistic(swapChain.mDisplayLatency, element.stat);
-            break;
-        case PM_METRIC_DISPLAYED_TIME:
-            output = CalculateStatistic(swapChain.mDisplayedTime, element.stat);
-            break;
-        case PM_METRIC_ANIMATION_ERROR:
-            output = CalculateStatistic(swapChain.mAnimationError, element.stat);
-            break;
-        case PM_METRIC_PRESENTED_FPS:
-        {
-            output = CalculateStatistic(swapChain.mMsBetweenPresents, element.stat, true);
-            output = output == 0 ? 0 : 1000.0 / output;
-            break;
         }
-        case PM_METRIC_APPLICATION_FPS:
-        {
-            std::vector<double> frame_times(swapChain.mCPUBusy.size());
-            for (size_t i = 0; i < swapChain.mCPUBusy.size(); ++i) {
-                frame_times[i] = swapChain.mCPUBusy[i] + swapChain.mCPUWait[i];
+    }
+
+    void ConcreteMiddleware::CalculateCombinedFpsMetrics(const PM_DYNAMIC_QUERY* pQuery, std::span<const uint32_t> processIds, uint8_t* pBlob)
+    {
+        for (auto& qe : pQuery->elements) {
+            if (qe.metric == PM_METRIC_SWAP_CHAIN_ADDRESS) {
+                reinterpret_cast<uint64_t&>(pBlob[qe.dataOffset]) = 0;
+                continue;
+            }
+            // the windows of a query all have the same backend, so sketches merge at their own accuracy
+            CombinedMetricWindow combined{ pQuery->sketchRelativeAccuracy.value_or(kCombinedSketchRelativeAccuracy) };
+            bool isStatistic = false;
+            bool invert = false;
+            bool toFps = false;
+            for (auto processId : processIds) {
+                auto it = queryWindows.find(std::pair(pQuery, processId));
+                if (it == queryWindows.end()) {
+                    continue;
+                }
+                for (auto& [address, swapChain] : it->second.swapChainData) {
+                    auto pWindow = GetFpsMetricWindow(swapChain, qe.metric, invert, toFps);
+                    if (!pWindow) {
+                        break;
+                    }
+                    isStatistic = true;
+                    combined.Add(*pWindow);
+                }
+            }
+            if (!isStatistic) {
+                continue;
+            }
+            auto& output = reinterpret_cast<double&>(pBlob[qe.dataOffset]);
+            output = CalculateStatistic(combined, qe.stat, invert);
+            if (toFps) {
+                output = output == 0 ? 0 : 1000.0 / output;
             }
-            output = CalculateStatistic(frame_times, element.stat);
-            output = output == 0 ? 0 : 1000.0 / output;
-            break;
-        }
-        case PM_METRIC_DISPLAYED_FPS:
-        {
-            output = CalculateStatistic(swapChain.mMsBetweenDisplayChange, element.stat, true);
-            output = output == 0 ? 0 : 1000.0 / output;
-            break;
-        }
-        case PM_METRIC_DROPPED_FRAMES:
-            output = CalculateStatistic(swapChain.mDropped, element.stat);
-            break;
-        case PM_METRIC_CLICK_TO_PHOTON_LATENCY:
-            output = CalculateStatistic(swapChain.mClickToPhotonLatency, element.stat);
-            break;
-        case PM_METRIC_ALL_INPUT_TO_PHOTON_LATENCY:
-            output = CalculateStatistic(swapChain.mAllInputToPhotonLatency, element.stat);
-            break;
-        case PM_METRIC_INSTRUMENTED_LATENCY:
-            output = CalculateStatistic(swapChain.mInstrumentedDisplayLatency, element.stat);
-            break;
-        case PM_METRIC_BETWEEN_PRESENTS:
-            output = CalculateStatistic(swapChain.mMsBetweenPresents, element.stat);
-            break;
-        case PM_METRIC_IN_PRESENT_API:
-            output = CalculateStatistic(swapChain.mMsInPresentApi, element.stat);
-            break;
-        case PM_METRIC_UNTIL_DISPLAYED:
-            output = CalculateStatistic(swapChain.mMsUntilDisplayed, element.stat);
-            break;
-        case PM_METRIC_BETWEEN_DISPLAY_CHANGE:
-            output = CalculateStatistic(swapChain.mMsBetweenDisplayChange, element.stat);
-            break;
-        case PM_METRIC_RENDER_PRESENT_LATENCY:
-            output = CalculateStatistic(swapChain.mMsUntilRenderComplete, element.stat);
-            break;
-        case PM_METRIC_BETWEEN_SIMULATION_START:
-            output = CalculateStatistic(swapChain.mMsBetweenSimStarts, element.stat);
-            break;
-        case PM_METRIC_PC_LATENCY:
-            output = CalculateStatistic(swapChain.mMsPcLatency, element.stat);
-            break;
-        case PM_METRIC_PRESENTED_FRAME_TIME:
-            output = CalculateStatistic(swapChain.mMsBetweenPresents, element.stat);
-            break;
-        case PM_METRIC_DISPLAYED_FRAME_TIME:
-            output = CalculateStatistic(swapChain.mMsBetweenDisplayChange, element.stat);
-            break;
-        default:
-            output = 0.;
-            break;
         }
     }
 
@@ -1581,115 +1945,38 @@ static void ReportMetrics(
         return;
     }
     
-    double ConcreteMiddleware::CalculateStatistic(std::vector<double>& inData, PM_STAT stat, bool invert) const
+    double ConcreteMiddleware::CalculateStatistic(const MetricWindow& inData, PM_STAT stat, bool invert) const
     {
-        if (inData.size() == 1) {
-            return inData[0];
-        }
-
-        if (inData.size() >= 1) {
-            switch (stat) {
-            case PM_STAT_NONE:
-                break;
-            case PM_STAT_AVG:
-            {
-                double sum = 0.0;
-                for (auto element : inData) {
-                    sum += element;
-                }
-                return sum / inData.size();
-            }
-            case PM_STAT_PERCENTILE_99: return CalculatePercentile(inData, 0.99, invert);
-            case PM_STAT_PERCENTILE_95: return CalculatePercentile(inData, 0.95, invert);
-            case PM_STAT_PERCENTILE_90: return CalculatePercentile(inData, 0.90, invert);
-            case PM_STAT_PERCENTILE_01: return CalculatePercentile(inData, 0.01, invert);
-            case PM_STAT_PERCENTILE_05: return CalculatePercentile(inData, 0.05, invert);
-            case PM_STAT_PERCENTILE_10: return CalculatePercentile(inData, 0.10, invert);
-            case PM_STAT_MAX:
-            {
-                double max = inData[0];
-                for (size_t i = 1; i < inData.size(); ++i) {
-                    if (invert) {
-                        max = std::min(max, inData[i]);
-                    } else {
-                        max = std::max(max, inData[i]);
-                    }
-                }
-                return max;
-            }
-            case PM_STAT_MIN:
-            {
-                double min = inData[0];
-                for (size_t i = 1; i < inData.size(); ++i) {
-                    if (invert) {
-                        min = std::max(min, inData[i]);
-                    }
-                    else {
-                        min = std::min(min, inData[i]);
-                    }
-                }
-                return min;
-            }
-            case PM_STAT_MID_POINT:
-            {
-                size_t middle_index = inData.size() / 2;
-                return inData[middle_index];
-            }
-            case PM_STAT_MID_LERP:
-                // TODO: Not yet implemented
-                break;
-            case PM_STAT_NEWEST_POINT:
-                // TODO: Not yet implemented
-                break;
-            case PM_STAT_OLDEST_POINT:
-                // TODO: Not yet implemented
-                break;
-            case PM_STAT_COUNT:
-                // TODO: Not yet implemented
-                break;
-            case PM_STAT_NON_ZERO_AVG:
-            {
-                double sum = 0.0;
-                size_t num = 0;
-                for (auto element : inData) {
-                    sum += element;
-                    num += element == 0.0 ? 0 : 1;
-                }
-                return num == 0 ? 0.0 : sum / num;
-            }
-            }
-        }
-
-        return 0.0;
+        return CalculateWindowStatistic(inData, stat, invert);
     }
 
-    // Calculate percentile using linear interpolation between the closet ranks
-    double ConcreteMiddleware::CalculatePercentile(std::vector<double>& inData, double percentile, bool invert) const
+    // Statistics that need the samples in arrival order or one by one (mid point, non-zero average) are not
+    // kept over combined windows and are 0
+    double ConcreteMiddleware::CalculateStatistic(const CombinedMetricWindow& inData, PM_STAT stat, bool invert) const
     {
-        if (invert) {
-            percentile = 1.0 - percentile;
+        if (inData.Empty()) {
+            return 0.0;
+        }
+
+        const auto percentile = [&](double p) { return inData.Percentile(invert ? 1.0 - p : p); };
+        switch (stat) {
+        case PM_STAT_AVG: return inData.Mean();
+        case PM_STAT_PERCENTILE_99: return percentile(0.99);
+        case PM_STAT_PERCENTILE_95: return percentile(0.95);
+        case PM_STAT_PERCENTILE_90: return percentile(0.90);
+        case PM_STAT_PERCENTILE_01: return percentile(0.01);
+        case PM_STAT_PERCENTILE_05: return percentile(0.05);
+        case PM_STAT_PERCENTILE_10: return percentile(0.10);
+        case PM_STAT_MAX: return invert ? inData.Min() : inData.Max();
+        case PM_STAT_MIN: return invert ? inData.Max() : inData.Min();
+        default: return 0.0;
         }
-        percentile = std::min(std::max(percentile, 0.), 1.);
-
-        double integral_part_as_double;
-        double fractpart =
-            modf(percentile * static_cast<double>(inData.size()),
-                &integral_part_as_double);
-
-        uint32_t idx = static_cast<uint32_t>(integral_part_as_double);
-        if (idx >= inData.size() - 1) {
-            return CalculateStatistic(inData, PM_STAT_MAX);
-        }
-
-        std::sort(inData.begin(), inData.end());
-        return inData[idx] + (fractpart * (inData[idx + 1] - inData[idx]));
     }
 
-    PmNsmFrameData* ConcreteMiddleware::GetFrameDataStart(StreamClient* client, uint64_t& index, uint64_t queryMetricsDataOffset, uint64_t& queryFrameDataDelta, double& window_sample_size_in_ms)
+    PmNsmFrameData* ConcreteMiddleware::GetFrameDataStart(StreamClient* client, uint64_t& frame_num, uint64_t queryMetricsDataOffset, uint64_t clientQpc, uint64_t& queryFrameDataDelta, double& window_sample_size_in_ms,
+        PmNsmFrameData& start)
     {
-
-        PmNsmFrameData* frame_data = nullptr;
-        index = 0;
+        frame_num = 0;
         if (client == nullptr) {
             return nullptr;
         }
@@ -1699,58 +1986,59 @@ static void ReportMetrics(
         if (!nsm_hdr->process_active) {
             return nullptr;
         }
+        auto ring = nsm_view->GetRingReader();
+        if (ring == nullptr) {
+            return nullptr;
+        }
 
-        index = client->GetLatestFrameIndex();
-        frame_data = client->ReadFrameByIdx(index, true);
-        if (frame_data == nullptr) {
-            index = 0;
+        // Frames are copied out of the ring, so that the service can't overwrite them while they
+        // are used
+        const auto num_frames_written = ring->GetNumFramesWritten();
+        if (num_frames_written == 0) {
+            return nullptr;
+        }
+        frame_num = num_frames_written - 1;
+        if (ring->CopyFrame(frame_num, start) != NsmFrameState::kReady) {
             return nullptr;
         }
 
         if (queryMetricsDataOffset == 0) {
             // Client has not specified a metric offset. Return back the most
             // most recent frame data
-            return frame_data;
+            return &start;
         }
 
-        LARGE_INTEGER client_qpc = {};
-        QueryPerformanceCounter(&client_qpc);
         uint64_t adjusted_qpc = GetAdjustedQpc(
-            client_qpc.QuadPart, frame_data->present_event.PresentStartTime,
+            clientQpc, start.present_event.PresentStartTime,
             queryMetricsDataOffset, client->GetQpcFrequency(), queryFrameDataDelta);
 
-        if (adjusted_qpc > frame_data->present_event.PresentStartTime) {
+        if (adjusted_qpc > start.present_event.PresentStartTime) {
             // Need to adjust the size of the window sample size
             double ms_adjustment =
-                QpcDeltaToMs(adjusted_qpc - frame_data->present_event.PresentStartTime,
+                QpcDeltaToMs(adjusted_qpc - start.present_event.PresentStartTime,
                     client->GetQpcFrequency());
             window_sample_size_in_ms = window_sample_size_in_ms - ms_adjustment;
             if (window_sample_size_in_ms <= 0.0) {
                 return nullptr;
             }
             pmlog_dbg("Adjusting dynamic stats window due to possible excursion").pmwatch(ms_adjustment);
+            return &start;
         }
-        else {
-            // Find the frame with the appropriate time based on the adjusted
-            // qpc
-            for (;;) {
 
-                if (DecrementIndex(nsm_view, index) == false) {
-                    // Increment index to match up with the frame_data read below
-                    index++;
-                    break;
-                }
-                frame_data = client->ReadFrameByIdx(index, true);
-                if (frame_data == nullptr) {
-                    return nullptr;
-                }
-                if (adjusted_qpc >= frame_data->present_event.PresentStartTime) {
-                    break;
-                }
-            }
+        // Skip to within a stride of the frame with the appropriate time using the ring's time
+        // index, and find the frame from there, in the frames that aged out of the ring if the
+        // frames in it all came after the adjusted qpc
+        std::optional<uint64_t> found_num;
+        if (FindFrameBefore(client, ring->SeekFrame(adjusted_qpc, num_frames_written) + 1, adjusted_qpc, start, found_num)) {
+            frame_num = *found_num;
+            return &start;
         }
-
-        return frame_data;
+        // Nothing was presented that early, start from the oldest frame
+        frame_num = ring->GetOldestFrame(ring->GetNumFramesWritten());
+        if (ring->CopyFrame(frame_num, start) != NsmFrameState::kReady) {
+            return nullptr;
+        }
+        return &start;
     }
 
     uint64_t ConcreteMiddleware::GetAdjustedQpc(uint64_t current_qpc, uint64_t frame_data_qpc, uint64_t queryMetricsOffset, LARGE_INTEGER frequency, uint64_t& queryFrameDataDelta) {
@@ -1772,200 +2060,101 @@ static void ReportMetrics(
             (queryFrameDataDelta + queryMetricsOffset);
     }
 
-    bool ConcreteMiddleware::DecrementIndex(NamedSharedMem* nsm_view, uint64_t& index) {
-
-        if (nsm_view == nullptr) {
+    bool ConcreteMiddleware::FindFrameBefore(StreamClient* client, uint64_t frame_num, uint64_t qpc, PmNsmFrameData& frame, std::optional<uint64_t>& found_num)
+    {
+        auto nsm_view = client->GetNamedSharedMemView();
+        auto ring = nsm_view->GetRingReader();
+        if (ring == nullptr) {
             return false;
         }
-
-        auto nsm_hdr = nsm_view->GetHeader();
-        if (!nsm_hdr->process_active) {
-            return false;
+        auto history = nsm_view->GetHistoryReader();
+        while (frame_num-- > 0) {
+            if (ring->CopyFrame(frame_num, frame) == NsmFrameState::kReady) {
+                if (frame.present_event.PresentStartTime <= qpc) {
+                    found_num = frame_num;
+                    return true;
+                }
+                continue;
+            }
+            // Past the frames still in the ring, search the history a block at a time
+            if (history == nullptr) {
+                return false;
+            }
+            uint64_t block_first_frame = 0;
+            const auto block = history->DecodeBlock(frame_num, block_first_frame);
+            if (!block) {
+                return false;
+            }
+            const auto begin = block->begin();
+            const auto end = begin + ptrdiff_t(frame_num - block_first_frame + 1);
+            const auto after = std::upper_bound(begin, end, qpc, [](uint64_t value, const PmNsmFrameData& f) {
+                return value < f.present_event.PresentStartTime;
+            });
+            if (after != begin) {
+                frame = *(after - 1);
+                found_num = block_first_frame + uint64_t(after - 1 - begin);
+                return true;
+            }
+            frame_num = block_first_frame;
         }
+        return false;
+    }
 
-        uint64_t current_max_entries =
-            (nsm_view->IsFull()) ? nsm_hdr->max_entries - 1 : nsm_hdr->tail_idx;
-        index = (index == 0) ? current_max_entries : index - 1;
-        if (index == nsm_hdr->head_idx) {
-            return false;
+    void ConcreteMiddleware::ReadFramesBefore(StreamClient* client, uint64_t frame_num, uint64_t end_qpc, uint64_t window_qpc,
+        std::vector<PmNsmFrameData*>& frames, std::deque<PmNsmFrameData>& frameCopies,
+        std::deque<std::shared_ptr<const std::vector<PmNsmFrameData>>>& historyBlocks, bool& reachedWindow)
+    {
+        auto nsm_view = client->GetNamedSharedMemView();
+        auto ring = nsm_view->GetRingReader();
+        if (ring == nullptr) {
+            return;
         }
 
-        return true;
+        auto history = nsm_view->GetHistoryReader();
+        uint64_t block_first_frame = 0;
+        // Frames are copied out of the ring while they are still there; past them, they are in the history
+        while (frame_num-- > 0) {
+            PmNsmFrameData* frame_data = nullptr;
+            PmNsmFrameData copy;
+            if (ring->CopyFrame(frame_num, copy) == NsmFrameState::kReady) {
+                frame_data = &frameCopies.emplace_back(copy);
+            }
+            else {
+                if (history == nullptr) {
+                    break;
+                }
+                if (historyBlocks.empty() || frame_num < block_first_frame) {
+                    auto block = history->DecodeBlock(frame_num, block_first_frame);
+                    if (!block) {
+                        break;
+                    }
+                    historyBlocks.push_back(std::move(block));
+                }
+                frame_data = const_cast<PmNsmFrameData*>(&(*historyBlocks.back())[frame_num - block_first_frame]);
+            }
+            if (frame_data->present_event.PresentStartTime <= end_qpc) {
+                break;
+            }
+            if (frame_data->present_event.PresentStartTime <= window_qpc) {
+                reachedWindow = true;
+                break;
+            }
+            frames.push_back(frame_data);
+        }
     }
 
-    bool ConcreteMiddleware::GetGpuMetricData(size_t telemetry_item_bit, PresentMonPowerTelemetryInfo& power_telemetry_info, std::unordered_map<PM_METRIC, MetricInfo>& metricInfo)
+    bool ConcreteMiddleware::GetGpuMetricData(size_t telemetry_item_bit, PresentMonPowerTelemetryInfo& power_telemetry_info, uint64_t timestamp, DynamicQueryWindow& window)
     {
-        bool validGpuMetric = true;
-        GpuTelemetryCapBits bit =
-            static_cast<GpuTelemetryCapBits>(telemetry_item_bit);
-        switch (bit) {
-        case GpuTelemetryCapBits::time_stamp:
-            // This is a valid telemetry cap bit but we do not produce metrics for
-            // it.
-            validGpuMetric = false;
-            break;
-        case GpuTelemetryCapBits::gpu_power:
-            metricInfo[PM_METRIC_GPU_POWER].data[0].emplace_back(power_telemetry_info.gpu_power_w);
-            break;
-        case GpuTelemetryCapBits::gpu_voltage:
-            metricInfo[PM_METRIC_GPU_VOLTAGE].data[0].emplace_back(power_telemetry_info.gpu_voltage_v);
-            break;
-        case GpuTelemetryCapBits::gpu_frequency:
-            metricInfo[PM_METRIC_GPU_FREQUENCY].data[0].emplace_back(power_telemetry_info.gpu_frequency_mhz);
-            break;
-        case GpuTelemetryCapBits::gpu_temperature:
-            metricInfo[PM_METRIC_GPU_TEMPERATURE].data[0].emplace_back(power_telemetry_info.gpu_temperature_c);
-            break;
-        case GpuTelemetryCapBits::gpu_utilization:
-            metricInfo[PM_METRIC_GPU_UTILIZATION].data[0].emplace_back(power_telemetry_info.gpu_utilization);
-            break;
-        case GpuTelemetryCapBits::gpu_render_compute_utilization:
-            metricInfo[PM_METRIC_GPU_RENDER_COMPUTE_UTILIZATION].data[0].emplace_back(power_telemetry_info.gpu_render_compute_utilization);
-            break;
-        case GpuTelemetryCapBits::gpu_media_utilization:
-            metricInfo[PM_METRIC_GPU_MEDIA_UTILIZATION].data[0].emplace_back(power_telemetry_info.gpu_media_utilization);
-            break;
-        case GpuTelemetryCapBits::vram_power:
-            metricInfo[PM_METRIC_GPU_MEM_POWER].data[0].emplace_back(power_telemetry_info.vram_power_w);
-            break;
-        case GpuTelemetryCapBits::vram_voltage:
-            metricInfo[PM_METRIC_GPU_MEM_VOLTAGE].data[0].emplace_back(power_telemetry_info.vram_voltage_v);
-            break;
-        case GpuTelemetryCapBits::vram_frequency:
-            metricInfo[PM_METRIC_GPU_MEM_FREQUENCY].data[0].emplace_back(power_telemetry_info.vram_frequency_mhz);
-            break;
-        case GpuTelemetryCapBits::vram_effective_frequency:
-            metricInfo[PM_METRIC_GPU_MEM_EFFECTIVE_FREQUENCY].data[0].emplace_back(power_telemetry_info.vram_effective_frequency_gbps);
-            break;
-        case GpuTelemetryCapBits::vram_temperature:
-            metricInfo[PM_METRIC_GPU_MEM_TEMPERATURE].data[0].emplace_back(power_telemetry_info.vram_temperature_c);
-            break;
-        case GpuTelemetryCapBits::fan_speed_0:
-            metricInfo[PM_METRIC_GPU_FAN_SPEED].data[0].emplace_back(power_telemetry_info.fan_speed_rpm[0]);
-            break;
-        case GpuTelemetryCapBits::fan_speed_1:
-            metricInfo[PM_METRIC_GPU_FAN_SPEED].data[1].emplace_back(power_telemetry_info.fan_speed_rpm[1]);
-            break;
-        case GpuTelemetryCapBits::fan_speed_2:
-            metricInfo[PM_METRIC_GPU_FAN_SPEED].data[2].emplace_back(power_telemetry_info.fan_speed_rpm[2]);
-            break;
-        case GpuTelemetryCapBits::fan_speed_3:
-            metricInfo[PM_METRIC_GPU_FAN_SPEED].data[3].emplace_back(power_telemetry_info.fan_speed_rpm[3]);
-            break;
-        case GpuTelemetryCapBits::fan_speed_4:
-            metricInfo[PM_METRIC_GPU_FAN_SPEED].data[4].emplace_back(power_telemetry_info.fan_speed_rpm[4]);
-            break;
-        case GpuTelemetryCapBits::max_fan_speed_0:
-            metricInfo[PM_METRIC_GPU_FAN_SPEED_PERCENT].data[0].emplace_back(
-                power_telemetry_info.fan_speed_rpm[0] / double(power_telemetry_info.max_fan_speed_rpm[0]));
-            break;
-        case GpuTelemetryCapBits::max_fan_speed_1:
-            metricInfo[PM_METRIC_GPU_FAN_SPEED_PERCENT].data[1].emplace_back(
-                power_telemetry_info.fan_speed_rpm[0] / double(power_telemetry_info.max_fan_speed_rpm[1]));
-            break;
-        case GpuTelemetryCapBits::max_fan_speed_2:
-            metricInfo[PM_METRIC_GPU_FAN_SPEED_PERCENT].data[2].emplace_back(
-                power_telemetry_info.fan_speed_rpm[0] / double(power_telemetry_info.max_fan_speed_rpm[2]));
-            break;
-        case GpuTelemetryCapBits::max_fan_speed_3:
-            metricInfo[PM_METRIC_GPU_FAN_SPEED_PERCENT].data[3].emplace_back(
-                power_telemetry_info.fan_speed_rpm[0] / double(power_telemetry_info.max_fan_speed_rpm[3]));
-            break;
-        case GpuTelemetryCapBits::max_fan_speed_4:
-            metricInfo[PM_METRIC_GPU_FAN_SPEED_PERCENT].data[4].emplace_back(
-                power_telemetry_info.fan_speed_rpm[0] / double(power_telemetry_info.max_fan_speed_rpm[4]));
-            break;
-        case GpuTelemetryCapBits::gpu_mem_used:
-            metricInfo[PM_METRIC_GPU_MEM_USED].data[0].emplace_back(static_cast<double>(power_telemetry_info.gpu_mem_used_b));
-            break;
-        case GpuTelemetryCapBits::gpu_mem_write_bandwidth:
-            metricInfo[PM_METRIC_GPU_MEM_WRITE_BANDWIDTH].data[0].emplace_back(power_telemetry_info.gpu_mem_write_bandwidth_bps);
-            break;
-        case GpuTelemetryCapBits::gpu_mem_read_bandwidth:
-            metricInfo[PM_METRIC_GPU_MEM_READ_BANDWIDTH].data[0].emplace_back(power_telemetry_info.gpu_mem_read_bandwidth_bps);
-            break;
-        case GpuTelemetryCapBits::gpu_power_limited:
-            metricInfo[PM_METRIC_GPU_POWER_LIMITED].data[0].emplace_back(power_telemetry_info.gpu_power_limited);
-            break;
-        case GpuTelemetryCapBits::gpu_temperature_limited:
-            metricInfo[PM_METRIC_GPU_TEMPERATURE_LIMITED].data[0].emplace_back(power_telemetry_info.gpu_temperature_limited);
-            break;
-        case GpuTelemetryCapBits::gpu_current_limited:
-            metricInfo[PM_METRIC_GPU_CURRENT_LIMITED].data[0].emplace_back(power_telemetry_info.gpu_current_limited);
-            break;
-        case GpuTelemetryCapBits::gpu_voltage_limited:
-            metricInfo[PM_METRIC_GPU_VOLTAGE_LIMITED].data[0].emplace_back(power_telemetry_info.gpu_voltage_limited);
-            break;
-        case GpuTelemetryCapBits::gpu_utilization_limited:
-            metricInfo[PM_METRIC_GPU_UTILIZATION_LIMITED].data[0].emplace_back(power_telemetry_info.gpu_utilization_limited);
-            break;
-        case GpuTelemetryCapBits::vram_power_limited:
-            metricInfo[PM_METRIC_GPU_MEM_POWER_LIMITED].data[0].emplace_back(power_telemetry_info.vram_power_limited);
-            break;
-        case GpuTelemetryCapBits::vram_temperature_limited:
-            metricInfo[PM_METRIC_GPU_MEM_TEMPERATURE_LIMITED].data[0].emplace_back(power_telemetry_info.vram_temperature_limited);
-            break;
-        case GpuTelemetryCapBits::vram_current_limited:
-            metricInfo[PM_METRIC_GPU_MEM_CURRENT_LIMITED].data[0].emplace_back(power_telemetry_info.vram_current_limited);
-            break;
-        case GpuTelemetryCapBits::vram_voltage_limited:
-            metricInfo[PM_METRIC_GPU_MEM_VOLTAGE_LIMITED].data[0].emplace_back(power_telemetry_info.vram_voltage_limited);
-            break;
-        case GpuTelemetryCapBits::vram_utilization_limited:
-            metricInfo[PM_METRIC_GPU_MEM_UTILIZATION_LIMITED].data[0].emplace_back(power_telemetry_info.vram_utilization_limited);
-            break;
-        case GpuTelemetryCapBits::gpu_effective_frequency:
-            metricInfo[PM_METRIC_GPU_EFFECTIVE_FREQUENCY].data[0].emplace_back(power_telemetry_info.gpu_effective_frequency_mhz);
-            break;
-        case GpuTelemetryCapBits::gpu_voltage_regulator_temperature:
-            metricInfo[PM_METRIC_GPU_VOLTAGE_REGULATOR_TEMPERATURE].data[0].emplace_back(power_telemetry_info.gpu_voltage_regulator_temperature_c);
-            break;
-        case GpuTelemetryCapBits::gpu_mem_effective_bandwidth:
-            metricInfo[PM_METRIC_GPU_MEM_EFFECTIVE_BANDWIDTH].data[0].emplace_back(power_telemetry_info.gpu_mem_effective_bandwidth_gbps);
-            break;
-        case GpuTelemetryCapBits::gpu_overvoltage_percent:
-            metricInfo[PM_METRIC_GPU_OVERVOLTAGE_PERCENT].data[0].emplace_back(power_telemetry_info.gpu_overvoltage_percent);
-            break;
-        case GpuTelemetryCapBits::gpu_temperature_percent:
-            metricInfo[PM_METRIC_GPU_TEMPERATURE_PERCENT].data[0].emplace_back(power_telemetry_info.gpu_temperature_percent);
-            break;
-        case GpuTelemetryCapBits::gpu_power_percent:
-            metricInfo[PM_METRIC_GPU_POWER_PERCENT].data[0].emplace_back(power_telemetry_info.gpu_power_percent);
-            break;
-        case GpuTelemetryCapBits::gpu_card_power:
-            metricInfo[PM_METRIC_GPU_CARD_POWER].data[0].emplace_back(power_telemetry_info.gpu_card_power_w);
-            break;
-        default:
-            validGpuMetric = false;
-            break;
-        }
-        return validGpuMetric;
+        return ForEachGpuTelemetrySample(telemetry_item_bit, power_telemetry_info, [&](PM_METRIC metric, uint32_t arrayIndex, double value) {
+            window.GetTelemetryWindow(metric, arrayIndex).Push(timestamp, value);
+        });
     }
 
-    bool ConcreteMiddleware::GetCpuMetricData(size_t telemetryBit, CpuTelemetryInfo& cpuTelemetry, std::unordered_map<PM_METRIC, MetricInfo>& metricInfo)
+    bool ConcreteMiddleware::GetCpuMetricData(size_t telemetryBit, CpuTelemetryInfo& cpuTelemetry, uint64_t timestamp, DynamicQueryWindow& window)
     {
-        bool validCpuMetric = true;
-        CpuTelemetryCapBits bit =
-            static_cast<CpuTelemetryCapBits>(telemetryBit);
-        switch (bit) {
-        case CpuTelemetryCapBits::cpu_utilization:
-            metricInfo[PM_METRIC_CPU_UTILIZATION].data[0].emplace_back(cpuTelemetry.cpu_utilization);
-            break;
-        case CpuTelemetryCapBits::cpu_power:
-            metricInfo[PM_METRIC_CPU_POWER].data[0].emplace_back(cpuTelemetry.cpu_power_w);
-            break;
-        case CpuTelemetryCapBits::cpu_temperature:
-            metricInfo[PM_METRIC_CPU_TEMPERATURE].data[0].emplace_back(cpuTelemetry.cpu_temperature);
-            break;
-        case CpuTelemetryCapBits::cpu_frequency:
-            metricInfo[PM_METRIC_CPU_FREQUENCY].data[0].emplace_back(cpuTelemetry.cpu_frequency);
-            break;
-        default:
-            validCpuMetric = false;
-            break;
-        }
-
-        return validCpuMetric;
+        return ForEachCpuTelemetrySample(telemetryBit, cpuTelemetry, [&](PM_METRIC metric, uint32_t arrayIndex, double value) {
+            window.GetTelemetryWindow(metric, arrayIndex).Push(timestamp, value);
+        });
     }
 
     void ConcreteMiddleware::SaveMetricCache(const PM_DYNAMIC_QUERY* pQuery, uint32_t processId, uint8_t* pBlob)
@@ -2001,22 +2190,21 @@ static void ReportMetrics(
     void ConcreteMiddleware::CalculateMetrics(const PM_DYNAMIC_QUERY* pQuery, uint32_t processId, uint8_t* pBlob, uint32_t* numSwapChains, LARGE_INTEGER qpcFrequency, std::unordered_map<uint64_t, fpsSwapChainData>& swapChainData, std::unordered_map<PM_METRIC, MetricInfo>& metricInfo)
     {
         // Find the swapchain with the most frame metrics
-        auto CalcGpuMemUtilization = [this, metricInfo](PM_STAT stat)
+        auto CalcGpuMemUtilization = [this, &metricInfo](PM_STAT stat)
             {
                 double output = 0.;
                 if (cachedGpuInfo[currentGpuInfoIndex].gpuMemorySize.has_value()) {
                     auto gpuMemSize = static_cast<double>(cachedGpuInfo[currentGpuInfoIndex].gpuMemorySize.value());
                     if (gpuMemSize != 0.)
                     {
-                        std::vector<double> memoryUtilization;
                         auto it = metricInfo.find(PM_METRIC_GPU_MEM_USED);
                         if (it != metricInfo.end()) {
-                            auto memUsed = it->second;
-                            auto memUsedVector = memUsed.data[0];
-                            for (auto memUsed : memUsedVector) {
-                                memoryUtilization.push_back(100. * (memUsed / gpuMemSize));
+                            auto memUsedIt = it->second.data.find(0);
+                            if (memUsedIt != it->second.data.end()) {
+                                // utilization is a positive scaling of memory used, so every
+                                // statistic can be taken on the memory used samples and scaled
+                                output = 100. * (CalculateStatistic(memUsedIt->second, stat) / gpuMemSize);
                             }
-                            output = CalculateStatistic(memoryUtilization, stat);
                         }
                     }
                 }
@@ -2028,7 +2216,7 @@ static void ReportMetrics(
         uint32_t currentSwapChainIndex = 0;
         for (auto& pair : swapChainData) {
             auto& swapChain = pair.second;
-            auto numFrames = (uint32_t)swapChain.mCPUBusy.size();
+            auto numFrames = (uint32_t)swapChain.mCPUBusy.Size();
             if (numFrames > maxSwapChainPresents)
             {
                 maxSwapChainPresents = numFrames;
@@ -2060,11 +2248,12 @@ static void ReportMetrics(
             // fps metric data. The first is if all of the frames are dropped.
             // The second is if in the requested sample window there are
             // no presents.
-            auto numFrames = (uint32_t)swapChain.mCPUBusy.size();
-            if ((swapChain.display_count <= 1) && (numFrames == 0)) {
+            auto numFrames = (uint32_t)swapChain.mCPUBusy.Size();
+            auto numDisplayed = (uint32_t)swapChain.mPresentedTimes.size();
+            if ((numDisplayed <= 1) && (numFrames == 0)) {
                 useCache = true;
                 pmlog_dbg("Filling cached data in dynamic metric poll")
-                    .pmwatch(numFrames).pmwatch(swapChain.display_count).diag();
+                    .pmwatch(numFrames).pmwatch(numDisplayed).diag();
                 break;
             }
 
@@ -2201,6 +2390,8 @@ static void ReportMetrics(
                 case PM_METRIC_GPU_TEMPERATURE_PERCENT:
                 case PM_METRIC_GPU_POWER_PERCENT:
                 case PM_METRIC_GPU_CARD_POWER:
+                case PM_METRIC_GPU_FRAME_ENERGY:
+                case PM_METRIC_GPU_FRAME_POWER:
                     CalculateGpuCpuMetric(metricInfo, qe, pBlob);
                     break;
                 case PM_METRIC_CPU_VENDOR:
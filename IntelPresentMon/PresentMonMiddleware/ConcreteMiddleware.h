@@ -4,11 +4,14 @@
 #include "../Interprocess/source/Interprocess.h"
 #include "../Streamer/StreamClient.h"
 #include <optional>
+#include <array>
+#include <deque>
 #include <string>
 #include <queue>
 #include "../CommonUtilities/Hash.h"
 #include "../CommonUtilities/Math.h"
 #include "FrameTimingData.h"
+#include "MetricWindow.h"
 
 namespace pmapi::intro
 {
@@ -94,32 +97,37 @@ namespace pmon::mid
         bool mIncludeFrameData = true;
 
         // IntelPresentMon specifics:
-        std::vector<double> mCPUBusy;
-        std::vector<double> mCPUWait;
-        std::vector<double> mGPULatency;
-        std::vector<double> mGPUBusy;
-        std::vector<double> mVideoBusy;
-        std::vector<double> mGPUWait;
-        std::vector<double> mDisplayLatency;
-        std::vector<double> mDisplayedTime;
-        std::vector<double> mAppDisplayedTime;
-		std::vector<double> mAnimationError;
-        std::vector<double> mClickToPhotonLatency;
-		std::vector<double> mAllInputToPhotonLatency;
-        std::vector<double> mDropped;
-		std::vector<double> mInstrumentedDisplayLatency;
-		std::vector<double> mMsBetweenPresents;
-        std::vector<double> mMsInPresentApi;
-        std::vector<double> mMsUntilDisplayed;
-        std::vector<double> mMsBetweenDisplayChange;
-		std::vector<double> mMsUntilRenderComplete;
-		std::vector<double> mMsBetweenSimStarts;
-		std::vector<double> mMsPcLatency;
-
-		std::vector<double> mInstrumentedSleep;
-		std::vector<double> mInstrumentedRenderLatency;
-		std::vector<double> mInstrumentedGpuLatency;
-		std::vector<double> mInstrumentedReadyTimeToDisplayLatency;
+        // Per-frame metric series, each sample stamped with the PresentStartTime of the present
+        // it was computed for.  A chain persists across polls of a dynamic query, so these are
+        // windows that new frames are pushed into and old frames are evicted from.
+        MetricWindow mCPUBusy;
+        MetricWindow mCPUWait;
+        MetricWindow mCPUFrameTime;         // mCPUBusy + mCPUWait
+        MetricWindow mGPULatency;
+        MetricWindow mGPUBusy;
+        MetricWindow mVideoBusy;
+        MetricWindow mGPUWait;
+        MetricWindow mGPUTime;              // mGPUBusy + mGPUWait
+        MetricWindow mDisplayLatency;
+        MetricWindow mDisplayedTime;
+        MetricWindow mAppDisplayedTime;
+		MetricWindow mAnimationError;
+        MetricWindow mClickToPhotonLatency;
+		MetricWindow mAllInputToPhotonLatency;
+        MetricWindow mDropped;
+		MetricWindow mInstrumentedDisplayLatency;
+		MetricWindow mMsBetweenPresents;
+        MetricWindow mMsInPresentApi;
+        MetricWindow mMsUntilDisplayed;
+        MetricWindow mMsBetweenDisplayChange;
+		MetricWindow mMsUntilRenderComplete;
+		MetricWindow mMsBetweenSimStarts;
+		MetricWindow mMsPcLatency;
+
+		MetricWindow mInstrumentedSleep;
+		MetricWindow mInstrumentedRenderLatency;
+		MetricWindow mInstrumentedGpuLatency;
+		MetricWindow mInstrumentedReadyTimeToDisplayLatency;
 
 		// QPC of last received input data that did not make it to the screen due 
 		// to the Present() being dropped
@@ -143,8 +151,17 @@ namespace pmon::mid
 		uint64_t display_0_screen_time = 0;       // The first presented frame's ScreenTime (qpc)
 		uint64_t mLastDisplayedSimStartTime = 0;  // The simulation start of the last displayed frame
 		uint32_t display_count = 0;               // The number of presented frames
+		std::deque<uint64_t> mPresentedTimes;     // PresentStartTime of the presented frames in the window
 		// QPC of the last simulation start time iregardless of whether it was displayed or not
 		uint64_t mLastSimStartTime = 0;
+
+		fpsSwapChainData() = default;
+		// Configure every metric window of the chain with the query's window options
+		explicit fpsSwapChainData(const MetricWindowOptions& options);
+		// Remove all metric samples for presents that started at or before qpc
+		void EvictThrough(uint64_t qpc);
+	private:
+		std::array<MetricWindow*, 27> GetMetricWindows_();
 	};
 
 	struct DeviceInfo
@@ -162,7 +179,33 @@ namespace pmon::mid
 	struct MetricInfo
 	{
 		// Map of array indices to associated data
-		std::unordered_map<uint32_t, std::vector<double>> data;
+		std::unordered_map<uint32_t, MetricWindow> data;
+	};
+
+	// Accumulated state of a dynamic query for one process.  Frames are fed into the swap chains
+	// and telemetry windows as they enter the query window and evicted as they leave it, so each
+	// poll only processes the frames that arrived since the previous one.
+	struct DynamicQueryWindow
+	{
+		std::unordered_map<uint64_t, fpsSwapChainData> swapChainData;
+		std::unordered_map<PM_METRIC, MetricInfo> metricInfo;
+		// backend and block size that new metric windows are created with
+		MetricWindowOptions options;
+		// PresentStartTime of the newest frame that has been fed into the window
+		uint64_t lastFrameQpc = 0;
+
+		// telemetry window for a metric array element, created with the window options on first use
+		MetricWindow& GetTelemetryWindow(PM_METRIC metric, uint32_t arrayIndex)
+		{
+			return metricInfo[metric].data.try_emplace(arrayIndex, options).first->second;
+		}
+
+		void Reset()
+		{
+			swapChainData.clear();
+			metricInfo.clear();
+			lastFrameQpc = 0;
+		}
 	};
 
 	class ConcreteMiddleware : public Middleware
@@ -176,32 +219,57 @@ namespace pmon::mid
 		PM_STATUS StopStreaming(uint32_t processId) override;
 		PM_STATUS SetTelemetryPollingPeriod(uint32_t deviceId, uint32_t timeMs) override;
 		PM_STATUS SetEtwFlushPeriod(std::optional<uint32_t> periodMs) override;
-		PM_DYNAMIC_QUERY* RegisterDynamicQuery(std::span<PM_QUERY_ELEMENT> queryElements, double windowSizeMs, double metricOffsetMs) override;
-		void FreeDynamicQuery(const PM_DYNAMIC_QUERY* pQuery) override {}
+		PM_DYNAMIC_QUERY* RegisterDynamicQuery(std::span<PM_QUERY_ELEMENT> queryElements, double windowSizeMs, double metricOffsetMs, const PM_DYNAMIC_QUERY_OPTIONS* pOptions) override;
+		void FreeDynamicQuery(const PM_DYNAMIC_QUERY* pQuery) override;
 		void PollDynamicQuery(const PM_DYNAMIC_QUERY* pQuery, uint32_t processId, uint8_t* pBlob, uint32_t* numSwapChains) override;
+		uint32_t PollDynamicQueryProcesses(const PM_DYNAMIC_QUERY* pQuery, std::optional<std::span<const uint32_t>> processIds,
+			uint32_t maxProcesses, uint8_t* pBlobs, uint32_t numSwapChains, PM_DYNAMIC_QUERY_PROCESS_RESULT* pResults, uint8_t* pCombinedBlob) override;
 		void PollStaticQuery(const PM_QUERY_ELEMENT& element, uint32_t processId, uint8_t* pBlob) override;
-		PM_FRAME_QUERY* RegisterFrameEventQuery(std::span<PM_QUERY_ELEMENT> queryElements, uint32_t& blobSize) override;
+		PM_FRAME_QUERY* RegisterFrameEventQuery(std::span<PM_QUERY_ELEMENT> queryElements, uint32_t& blobSize, const PM_FRAME_QUERY_OPTIONS* pOptions = nullptr) override;
 		void FreeFrameEventQuery(const PM_FRAME_QUERY* pQuery) override;
 		void ConsumeFrameEvents(const PM_FRAME_QUERY* pQuery, uint32_t processId, uint8_t* pBlob, uint32_t& numFrames) override;
+		uint32_t WaitForFrames(uint32_t processId, uint32_t minFrames, uint32_t timeoutMs) override;
 		void StopPlayback() override;
 	private:
-		PmNsmFrameData* GetFrameDataStart(StreamClient* client, uint64_t& index, uint64_t dataOffset, uint64_t& queryFrameDataDelta, double& windowSampleSizeMs);
+		// Make the adapter referenced by the query the active one
+		void SelectQueryAdapter(const PM_DYNAMIC_QUERY* pQuery);
+		// Poll one process for the client time point clientQpc; returns PM_STATUS_INVALID_PID, leaving the
+		// blob untouched, if the process is not tracked or has exited
+		PM_STATUS PollProcessDynamicQuery(const PM_DYNAMIC_QUERY* pQuery, uint32_t processId, uint64_t clientQpc, uint8_t* pBlob, uint32_t* numSwapChains);
+		// Find the frame a poll's window starts at, copy it to start and set its number in frame_num. If the
+		// metric offset puts it before the frames in the ring, it is looked for in the frames that aged out
+		// of the ring.
+		PmNsmFrameData* GetFrameDataStart(StreamClient* client, uint64_t& frame_num, uint64_t dataOffset, uint64_t clientQpc, uint64_t& queryFrameDataDelta, double& windowSampleSizeMs,
+			PmNsmFrameData& start);
 		uint64_t GetAdjustedQpc(uint64_t current_qpc, uint64_t frame_data_qpc, uint64_t queryMetricsOffset, LARGE_INTEGER frequency, uint64_t& queryFrameDataDelta);
-		bool DecrementIndex(NamedSharedMem* nsm_view, uint64_t& index);
+		// Find the newest frame before frame_num that started at or before qpc, from the ring while the
+		// frames are still there and from the compressed history after
+		bool FindFrameBefore(StreamClient* client, uint64_t frame_num, uint64_t qpc, PmNsmFrameData& frame, std::optional<uint64_t>& found_num);
+		// Walk back from frame_num until end_qpc or window_qpc is reached, copying the frames out of the
+		// ring while they are still there and decoding them from the compressed history after
+		void ReadFramesBefore(StreamClient* client, uint64_t frame_num, uint64_t end_qpc, uint64_t window_qpc,
+			std::vector<PmNsmFrameData*>& frames, std::deque<PmNsmFrameData>& frameCopies,
+			std::deque<std::shared_ptr<const std::vector<PmNsmFrameData>>>& historyBlocks, bool& reachedWindow);
 		PM_STATUS SetActiveGraphicsAdapter(uint32_t deviceId);
+		// Tell the service which telemetry the registered queries are calculated from, so that it samples only that
+		void UpdateTelemetryDemand();
 		void GetStaticGpuMetrics();
 
 		void CalculateFpsMetric(fpsSwapChainData& swapChain, const PM_QUERY_ELEMENT& element, uint8_t* pBlob, LARGE_INTEGER qpcFrequency);
+		// Overwrite the frame metric statistics in pBlob with ones over every swap chain of the processes' windows
+		void CalculateCombinedFpsMetrics(const PM_DYNAMIC_QUERY* pQuery, std::span<const uint32_t> processIds, uint8_t* pBlob);
 		void CalculateGpuCpuMetric(std::unordered_map<PM_METRIC, MetricInfo>& metricInfo, const PM_QUERY_ELEMENT& element, uint8_t* pBlob);
-		double CalculateStatistic(std::vector<double>& inData, PM_STAT stat, bool invert = false) const;
-		double CalculatePercentile(std::vector<double>& inData, double percentile, bool invert) const;
-		bool GetGpuMetricData(size_t telemetry_item_bit, PresentMonPowerTelemetryInfo& power_telemetry_info, std::unordered_map<PM_METRIC, MetricInfo>& metricInfo);
-		bool GetCpuMetricData(size_t telemetryBit, CpuTelemetryInfo& cpuTelemetry, std::unordered_map<PM_METRIC, MetricInfo>& metricInfo);
+		double CalculateStatistic(const MetricWindow& inData, PM_STAT stat, bool invert = false) const;
+		double CalculateStatistic(const CombinedMetricWindow& inData, PM_STAT stat, bool invert = false) const;
+		bool GetGpuMetricData(size_t telemetry_item_bit, PresentMonPowerTelemetryInfo& power_telemetry_info, uint64_t timestamp, DynamicQueryWindow& window);
+		bool GetCpuMetricData(size_t telemetryBit, CpuTelemetryInfo& cpuTelemetry, uint64_t timestamp, DynamicQueryWindow& window);
 		void GetStaticCpuMetrics();
 		std::string GetProcessName(uint32_t processId);
 		void CopyStaticMetricData(PM_METRIC metric, uint32_t deviceId, uint8_t* pBlob, uint64_t blobOffset, size_t sizeInBytes = 0);
 
 		void CalculateMetrics(const PM_DYNAMIC_QUERY* pQuery, uint32_t processId, uint8_t* pBlob, uint32_t* numSwapChains, LARGE_INTEGER qpcFrequency, std::unordered_map<uint64_t, fpsSwapChainData>& swapChainData, std::unordered_map<PM_METRIC, MetricInfo>& metricInfo);
+		// Fill the blob from the metric cache the service publishes for the process, if every computed metric of the query is in it
+		bool ReadSharedMetricCache(const SharedMetricCache& cache, const PM_DYNAMIC_QUERY* pQuery, uint64_t frameQpc, double windowSizeMs, uint8_t* pBlob);
 		void SaveMetricCache(const PM_DYNAMIC_QUERY* pQuery, uint32_t processId, uint8_t* pBlob);
 		void CopyMetricCacheToBlob(const PM_DYNAMIC_QUERY* pQuery, uint32_t processId, uint8_t* pBlob);
 
@@ -220,6 +288,12 @@ namespace pmon::mid
 		std::unordered_map<std::pair<const PM_DYNAMIC_QUERY*, uint32_t>, uint64_t> queryFrameDataDeltas;
 		// Dynamic query handle to cache data
 		std::unordered_map<std::pair<const PM_DYNAMIC_QUERY*, uint32_t>, std::unique_ptr<uint8_t[]>> cachedMetricDatas;
+		// Dynamic query handle to the query's sliding window of frame metrics
+		std::unordered_map<std::pair<const PM_DYNAMIC_QUERY*, uint32_t>, DynamicQueryWindow> queryWindows;
+		// Dynamic or frame query handle to the telemetry it is calculated from
+		std::unordered_map<const void*, std::pair<GpuTelemetryBitset, CpuTelemetryBitset>> queryTelemetryDemands;
+		// Telemetry demand last sent to the service
+		std::optional<std::pair<GpuTelemetryBitset, CpuTelemetryBitset>> sentTelemetryDemand;
 		std::vector<DeviceInfo> cachedGpuInfo;
 		std::vector<DeviceInfo> cachedCpuInfo;
 		uint32_t currentGpuInfoIndex = UINT32_MAX;
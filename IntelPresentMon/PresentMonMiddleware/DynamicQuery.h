@@ -2,6 +2,7 @@
 #include <vector>
 #include <bitset>
 #include <map>
+#include <optional>
 #include "../PresentMonAPI2/PresentMonAPI.h"
 #include "../ControlLib/CpuTelemetryInfo.h"
 #include "../ControlLib/PresentMonPowerTelemetry.h"
@@ -21,6 +22,8 @@ struct PM_DYNAMIC_QUERY
 	double windowSizeMs = 0;
 	double metricOffsetMs = 0.;
 	size_t queryCacheSize = 0;
+	// relative accuracy of the quantile sketches backing the metric windows (exact samples if empty)
+	std::optional<double> sketchRelativeAccuracy;
 	std::optional<uint32_t> cachedGpuInfoIndex;
 };
 
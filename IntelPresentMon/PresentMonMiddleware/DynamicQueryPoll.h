@@ -0,0 +1,51 @@
+#pragma once
+#include "../PresentMonAPI2/PresentMonAPI.h"
+#include "../CommonUtilities/Exception.h"
+#include "../CommonUtilities/log/Log.h"
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <span>
+
+namespace pmon::mid
+{
+	// Index of the cached adapter that has to be made active before polling a query that references
+	// queryAdapterIndex, or empty if the query references no adapter or the one at activeAdapterIndex
+	inline std::optional<uint32_t> GetQueryAdapterSwitch(std::optional<uint32_t> queryAdapterIndex, uint32_t activeAdapterIndex)
+	{
+		if (!queryAdapterIndex || *queryAdapterIndex == activeAdapterIndex) {
+			return {};
+		}
+		return queryAdapterIndex;
+	}
+
+	// Poll a dynamic query for each of processIds with pollProcess(processId, pBlob, pNumSwapChains), which returns
+	// the status of the poll. Each process gets numSwapChains blobs of blobSize bytes in pBlobs, packed in the order
+	// polled, and a result in pResults. A poll that throws is recorded with the status of the exception, and the
+	// processes after it are still polled. Returns the number of processes polled.
+	template<class F>
+	uint32_t PollDynamicQueryEachProcess(std::span<const uint32_t> processIds, uint32_t numSwapChains, size_t blobSize,
+		uint8_t* pBlobs, PM_DYNAMIC_QUERY_PROCESS_RESULT* pResults, F&& pollProcess)
+	{
+		const auto blobsStride = size_t(numSwapChains) * blobSize;
+		uint32_t numPolled = 0;
+		for (auto processId : processIds) {
+			auto& result = pResults[numPolled];
+			result.processId = processId;
+			result.numSwapChains = numSwapChains;
+			try {
+				result.status = pollProcess(processId, pBlobs + numPolled * blobsStride, &result.numSwapChains);
+			}
+			catch (...) {
+				result.status = util::GeneratePmStatus();
+				pmlog_error(util::ReportException(std::format("Failed to poll dynamic query for process {}", processId)))
+					.code(result.status).diag();
+			}
+			if (result.status != PM_STATUS_SUCCESS) {
+				result.numSwapChains = 0;
+			}
+			numPolled++;
+		}
+		return numPolled;
+	}
+}
@@ -9,28 +9,16 @@
 #include "../CommonUtilities/log/Log.h"
 #include "../CommonUtilities/Exception.h"
 #include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstring>
 #include <limits>
+#include <optional>
 
 using namespace pmon;
 using namespace pmon::util;
 using Context = PM_FRAME_QUERY::Context;
 
-namespace pmon::mid
-{
-	class GatherCommand_
-	{
-	public:
-		virtual ~GatherCommand_() = default;
-		virtual void Gather(Context& ctx, uint8_t* pDestBlob) const = 0;
-		virtual uint32_t GetBeginOffset() const = 0;
-		virtual uint32_t GetEndOffset() const = 0;
-		virtual uint32_t GetOutputOffset() const = 0;
-		uint32_t GetDataSize() const { return GetEndOffset() - GetOutputOffset(); }
-		uint32_t GetTotalSize() const { return GetEndOffset() - GetBeginOffset(); }
-	};
-}
-
 namespace
 {
 	double TimestampDeltaToMilliSeconds(uint64_t timestampDelta, double performanceCounterPeriodMs)
@@ -65,1238 +53,342 @@ namespace
 			return &PmNsmFrameData::cpu_telemetry;
 		}
 	}
+}
 
-	template<auto pMember>
-	class CopyGatherCommand_ : public mid::GatherCommand_
-	{
-		using Type = util::MemberPointerInfo<decltype(pMember)>::MemberType;
-	public:
-		CopyGatherCommand_(size_t nextAvailableByteOffset, uint16_t index = 0)
-			:
-			inputIndex_{ index }
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(Type));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			constexpr auto pSubstruct = GetSubstructurePointer<pMember>();
-			if constexpr (std::is_array_v<Type>) {
-				if constexpr (std::is_same_v<std::remove_extent_t<Type>, char>) {
-					const auto val = (ctx.pSourceFrameData->*pSubstruct.*pMember)[inputIndex_];
-					// TODO: only getting first character of application name. Hmmm.
-					strncpy_s(reinterpret_cast<char*>(&pDestBlob[outputOffset_]), 260, &val, _TRUNCATE);
-				}
-				else {
-					const auto val = (ctx.pSourceFrameData->*pSubstruct.*pMember)[inputIndex_];
-					reinterpret_cast<std::remove_const_t<decltype(val)>&>(pDestBlob[outputOffset_]) = val;
-				}
-			}
-			else {
-				const auto val = ctx.pSourceFrameData->*pSubstruct.*pMember;
-				reinterpret_cast<std::remove_const_t<decltype(val)>&>(pDestBlob[outputOffset_]) = val;
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(Type);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-		uint16_t inputIndex_;
-	};
-	class CopyGatherFrameTypeCommand_ : public mid::GatherCommand_
+namespace pmon::mid
+{
+	enum class GatherOpCode_ : uint8_t
 	{
-	public:
-		CopyGatherFrameTypeCommand_(size_t nextAvailableByteOffset, uint16_t index = 0)
-			:
-			inputIndex_{ index }
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(FrameType));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-            auto val = ctx.pSourceFrameData->present_event.Displayed_FrameType[ctx.sourceFrameDisplayIndex];
-			// Currently not reporting out not set or repeated frames.
-			if (val == FrameType::NotSet || val == FrameType::Repeated) {
-				val = FrameType::Application;
-			}
-            reinterpret_cast<std::remove_const_t<decltype(val)>&>(pDestBlob[outputOffset_]) = val;
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(FrameType);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-		uint16_t inputIndex_;
+		Copy1,
+		Copy4,
+		Copy8,
+		FrameType,
+		Dropped,
+		CpuStartQpc,
+		QpcDuration,
+		QpcDurationApp,
+		CpuStartTime,
+		PresentStartTime,
+		CpuFrameTime,
+		CpuDelta,
+		GpuTime,
+		GpuWait,
+		DisplayedTime,
+		DisplayLatency,
+		InstrumentedLatency,
+		BetweenDisplayChange,
+		UntilDisplayed,
+		AnimationError,
+		AnimationTime,
+		ClickToPhoton,
+		AllInputToPhoton,
+		BetweenPresents,
+		QpcDelta,
+		BetweenSimStarts,
+		PcLatency,
+		FlipDelay,
 	};
-	template<uint64_t PmNsmPresentEvent::* pMember, uint64_t PmNsmPresentEvent::* pAppPropagatedMember, bool usesAppIndex>
-	class QpcDurationGatherCommand_ : public pmon::mid::GatherCommand_
-	{
-	public:
-		QpcDurationGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-            if constexpr (usesAppIndex) {
-				if (ctx.sourceFrameDisplayIndex == ctx.appIndex) {
-					if (ctx.pSourceFrameData->present_event.*pAppPropagatedMember != 0) {
-						const auto val = ctx.performanceCounterPeriodMs * double(ctx.pSourceFrameData->present_event.*pAppPropagatedMember);
-						reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-						return;
-					}
-					else if (ctx.pSourceFrameData->present_event.*pMember != 0) {
-						const auto val = ctx.performanceCounterPeriodMs * double(ctx.pSourceFrameData->present_event.*pMember);
-						reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-						return;
-					}
-				}
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = 0.;
-			} else {
-				const auto val = ctx.pSourceFrameData->present_event.*pMember != 0 ? 
-					ctx.performanceCounterPeriodMs * double(ctx.pSourceFrameData->present_event.*pMember) : 0.;
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-			}
 
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	template<uint64_t PmNsmPresentEvent::* pFromMember, uint64_t PmNsmPresentEvent::* pBackupFromMember, uint64_t PmNsmPresentEvent::* pToMember>
-	class QpcDeltaGatherWithBackupCommand_ : public pmon::mid::GatherCommand_
-	{
-	public:
-		QpcDeltaGatherWithBackupCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			const auto qpcFrom = ctx.pSourceFrameData->present_event.*pFromMember;
-			const auto qpcBackupFrom = ctx.pSourceFrameData->present_event.*pBackupFromMember;
-            uint64_t qpcTo = 0;
-			if (ctx.pSourceFrameData->present_event.AppPropagatedGPUStartTime != 0) {
-                qpcTo = ctx.pSourceFrameData->present_event.AppPropagatedGPUStartTime;
-            }
-            else {
-                qpcTo = ctx.pSourceFrameData->present_event.*pToMember;
-			}
-			auto instrumentedStart = qpcFrom != 0 ? qpcFrom : qpcBackupFrom;
-			if (instrumentedStart != 0) {
-				if (ctx.sourceFrameDisplayIndex == ctx.appIndex) {
-					const auto val = TimestampDeltaToUnsignedMilliSeconds(instrumentedStart, qpcTo, ctx.performanceCounterPeriodMs);
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-				}
-				else {
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-						std::numeric_limits<double>::quiet_NaN();
-				}
-			}
-			else {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	template<uint64_t PmNsmPresentEvent::* pFromMember, uint64_t PmNsmPresentEvent::* pToMember, bool usesAppIndex>
-	class QpcDeltaGatherFromToCommand_ : public pmon::mid::GatherCommand_
-	{
-	public:
-		QpcDeltaGatherFromToCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			const auto qpcFrom = ctx.pSourceFrameData->present_event.*pFromMember;
-			const auto qpcTo = ctx.pSourceFrameData->present_event.*pToMember;
-			if (qpcFrom != 0 && qpcTo != 0) {
-                if constexpr (usesAppIndex) {
-                    if (ctx.sourceFrameDisplayIndex == ctx.appIndex) {
-                        const auto val = TimestampDeltaToUnsignedMilliSeconds(qpcFrom, qpcTo, ctx.performanceCounterPeriodMs);
-                        reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-                    }
-                    else {
-                        reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-                            std::numeric_limits<double>::quiet_NaN();
-                    }
-                }
-				else {
-					const auto val = TimestampDeltaToUnsignedMilliSeconds(qpcFrom, qpcTo, ctx.performanceCounterPeriodMs);
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-				}
-			}
-			else {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	template<uint64_t PmNsmPresentEvent::* pToMember>
-	class QpcDeltaGatherToCommand_ : public pmon::mid::GatherCommand_
-	{
-	public:
-		QpcDeltaGatherToCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			const auto qpcFrom = ctx.previousPresentStartQpc;
-			const auto qpcTo = ctx.pSourceFrameData->present_event.*pToMember;
-			if (qpcFrom != 0 && qpcTo != 0) {
-				const auto val = TimestampDeltaToUnsignedMilliSeconds(qpcFrom, qpcTo, ctx.performanceCounterPeriodMs);
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-			} else {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	class GpuTimeGatherCommand_ : public pmon::mid::GatherCommand_
-	{
-	public:
-		GpuTimeGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			if (ctx.sourceFrameDisplayIndex == ctx.appIndex) {
-                double gpuDuration = 0.;
-				if (ctx.pSourceFrameData->present_event.AppPropagatedGPUStartTime != 0) {
-                    gpuDuration = TimestampDeltaToUnsignedMilliSeconds(ctx.pSourceFrameData->present_event.AppPropagatedGPUStartTime,
-                        ctx.pSourceFrameData->present_event.AppPropagatedReadyTime, ctx.performanceCounterPeriodMs);
-                } else {
-                    gpuDuration = TimestampDeltaToUnsignedMilliSeconds(ctx.pSourceFrameData->present_event.GPUStartTime,
-                        ctx.pSourceFrameData->present_event.ReadyTime, ctx.performanceCounterPeriodMs);
-                }
-                double gpuBusy = 0.;
-                if (ctx.pSourceFrameData->present_event.AppPropagatedGPUDuration != 0) {
-                    gpuBusy = TimestampDeltaToMilliSeconds(ctx.pSourceFrameData->present_event.AppPropagatedGPUDuration,
-                        ctx.performanceCounterPeriodMs);
-                } else {
-                    gpuBusy = TimestampDeltaToMilliSeconds(ctx.pSourceFrameData->present_event.GPUDuration,
-                        ctx.performanceCounterPeriodMs);
-                }
-				const auto gpuWait = std::max(0., gpuDuration - gpuBusy);
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = gpuBusy + gpuWait;
-			}
-			else {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = 0.;
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	class ClickToPhotonGatherCommand_ : public pmon::mid::GatherCommand_
-	{
-	public:
-		ClickToPhotonGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			if (ctx.dropped) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-				return;
-			}
-			uint64_t start = ctx.pSourceFrameData->present_event.InputTime;
-			if (start == 0ull) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-				return;
-			}
-			if (ctx.sourceFrameDisplayIndex == ctx.appIndex) {
-				auto ScreenTime = ctx.pSourceFrameData->present_event.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex];
-				auto ii = ctx.frameTimingData.flipDelayDataMap.find(ctx.pSourceFrameData->present_event.FrameId);
-				if (ii != ctx.frameTimingData.flipDelayDataMap.end()) {
-					ScreenTime = ii->second.displayQpc;
-				}
-				const auto val = TimestampDeltaToUnsignedMilliSeconds(start,
-					ScreenTime, ctx.performanceCounterPeriodMs);
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-			}
-			else
-			{
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	class DroppedGatherCommand_ : public pmon::mid::GatherCommand_
-	{
-	public:
-		DroppedGatherCommand_(size_t nextAvailableByteOffset) : outputOffset_{ (uint32_t)nextAvailableByteOffset } {}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			reinterpret_cast<bool&>(pDestBlob[outputOffset_]) = ctx.dropped;
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(bool);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-	};
-	template<uint64_t PmNsmPresentEvent::* pEnd, bool calcPresentStartTime>
-	class StartDifferenceGatherCommand_ : public pmon::mid::GatherCommand_
-	{
-	public:
-		StartDifferenceGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			if constexpr (calcPresentStartTime) {
-				const auto qpcDuration = ctx.pSourceFrameData->present_event.*pEnd - ctx.qpcStart;
-				const auto val = ctx.performanceCounterPeriodMs * double(qpcDuration);
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-			} else {
-				const auto qpcDuration = ctx.cpuStart - ctx.qpcStart;
-				const auto val = ctx.performanceCounterPeriodMs * double(qpcDuration);
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	class CpuFrameQpcGatherCommand_ : public pmon::mid::GatherCommand_
-	{
-	public:
-		CpuFrameQpcGatherCommand_(size_t nextAvailableByteOffset) : outputOffset_{ (uint32_t)nextAvailableByteOffset } {}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			reinterpret_cast<uint64_t&>(pDestBlob[outputOffset_]) = ctx.cpuStart;
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(uint64_t);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-	};
-	template<uint64_t PmNsmPresentEvent::* pEnd, uint64_t PmNsmPresentEvent::* pPropagatedEnd, bool doDroppedCheck>
-	class CpuFrameQpcDifferenceGatherCommand_ : public pmon::mid::GatherCommand_
+	// an entry in a frame query's compiled op table: gathers one query element, with the frame
+	// data that it reads resolved to an offset or member pointers when the query is registered
+	struct GatherOp_
 	{
-	public:
-		CpuFrameQpcDifferenceGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			if constexpr (doDroppedCheck) {
-				if (ctx.dropped) {
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-						std::numeric_limits<double>::quiet_NaN();
-					return;
-				}
-			}
-			if (ctx.sourceFrameDisplayIndex == ctx.appIndex) {
-                if (ctx.pSourceFrameData->present_event.*pPropagatedEnd != 0) {
-					const auto val = TimestampDeltaToUnsignedMilliSeconds(ctx.cpuStart,
-						ctx.pSourceFrameData->present_event.*pPropagatedEnd, ctx.performanceCounterPeriodMs);
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-                } else {
-					const auto val = TimestampDeltaToUnsignedMilliSeconds(ctx.cpuStart,
-						ctx.pSourceFrameData->present_event.*pEnd, ctx.performanceCounterPeriodMs);
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-				}
-			}
-			else{
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = 0.;
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
+		GatherOpCode_ code;
+		uint32_t outputOffset;
+		// source of the copy ops, as a byte offset into PmNsmFrameData
+		uint32_t sourceOffset = 0;
+		// present event members read by the ops that are shared by several metrics
+		uint64_t PmNsmPresentEvent::* pMember = nullptr;
+		uint64_t PmNsmPresentEvent::* pAltMember = nullptr;
+		// distance between the outputs of consecutive frames: the blob size, or the element size
+		// when the output is columnar
+		uint32_t outputStride = 0;
 	};
-	template<uint64_t PmNsmPresentEvent::* pFrom>
-	class DisplayLatencyGatherFromCommand_ : public pmon::mid::GatherCommand_
-	{
-	public:
-		DisplayLatencyGatherFromCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			if (ctx.dropped) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-				return;
-			}
+}
 
-			// Calculate the current frame's displayed time 
-			auto ScreenTime = ctx.pSourceFrameData->present_event.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex];
-			auto ii = ctx.frameTimingData.flipDelayDataMap.find(ctx.pSourceFrameData->present_event.FrameId);
-			if (ii != ctx.frameTimingData.flipDelayDataMap.end()) {
-				ScreenTime = ii->second.displayQpc;
-			}
-			auto NextScreenTime = ctx.sourceFrameDisplayIndex == ctx.pSourceFrameData->present_event.DisplayedCount - 1
-				? ctx.nextDisplayedQpc
-				: ctx.pSourceFrameData->present_event.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex + 1];
-			const auto displayedTime = TimestampDeltaToUnsignedMilliSeconds(ScreenTime, NextScreenTime, ctx.performanceCounterPeriodMs);
+namespace
+{
+	using mid::GatherOp_;
+	using mid::GatherOpCode_;
+	using FrameRow = PM_FRAME_QUERY::FrameRow;
 
-			uint64_t startQpc = 0;
-			if (ctx.pSourceFrameData->present_event.*pFrom == 0 ||
-				displayedTime == 0) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-				return;
-			}
-			const auto val = TimestampDeltaToUnsignedMilliSeconds(ctx.pSourceFrameData->present_event.*pFrom,
-				ScreenTime,
-				ctx.performanceCounterPeriodMs);
-			reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-			return;
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
+	// FrameRow values that cost a lookup to resolve are only resolved for queries with ops using them,
+	// and ops that consume pending input need ResolveRow to clear it from the context
+	enum RowNeeds_ : uint32_t
+	{
+		NeedsScreenTime_ = 1 << 0,
+		NeedsDisplayedTime_ = 1 << 1,
+		ConsumesClick_ = 1 << 2,
+		ConsumesAllInput_ = 1 << 3,
 	};
-	template<bool isXellDisplayLatency, bool isBetweenDisplayChange>
-	class DisplayLatencyGatherCommand_ : public pmon::mid::GatherCommand_
+
+	uint32_t GetRowNeeds_(GatherOpCode_ code)
 	{
-	public:
-		DisplayLatencyGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
+		switch (code) {
+		case GatherOpCode_::DisplayedTime:
+		case GatherOpCode_::DisplayLatency:
+		case GatherOpCode_::InstrumentedLatency:
+		case GatherOpCode_::UntilDisplayed:
+		case GatherOpCode_::AnimationError:
+		case GatherOpCode_::AnimationTime:
+			return NeedsScreenTime_ | NeedsDisplayedTime_;
+		case GatherOpCode_::BetweenDisplayChange:
+		case GatherOpCode_::PcLatency:
+		case GatherOpCode_::FlipDelay:
+			return NeedsScreenTime_;
+		case GatherOpCode_::ClickToPhoton:
+			return NeedsScreenTime_ | ConsumesClick_;
+		case GatherOpCode_::AllInputToPhoton:
+			return NeedsScreenTime_ | ConsumesAllInput_;
+		default:
+			return 0;
 		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-            if (ctx.dropped) {
-                reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-                    std::numeric_limits<double>::quiet_NaN();
-                return;
-            }
+	}
 
-			// Calculate the current frame's displayed time 
-			auto ScreenTime = ctx.pSourceFrameData->present_event.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex];
-			auto ii = ctx.frameTimingData.flipDelayDataMap.find(ctx.pSourceFrameData->present_event.FrameId);
-			if (ii != ctx.frameTimingData.flipDelayDataMap.end()) {
-				ScreenTime = ii->second.displayQpc;
-			}
-			auto NextScreenTime = ctx.sourceFrameDisplayIndex == ctx.pSourceFrameData->present_event.DisplayedCount - 1
-				? ctx.nextDisplayedQpc
-				: ctx.pSourceFrameData->present_event.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex + 1];
-			const auto displayedTime = TimestampDeltaToUnsignedMilliSeconds(ScreenTime, NextScreenTime, ctx.performanceCounterPeriodMs);
+	template<class T> struct CopyElement_ { using Type = T; };
+	template<class T, size_t N> struct CopyElement_<T[N]> { using Type = T; };
+	template<class T, size_t N> struct CopyElement_<std::array<T, N>> { using Type = T; };
 
-			uint64_t startQpc = 0;
-			if constexpr (isXellDisplayLatency) {
-				if ((ctx.pSourceFrameData->present_event.AppSleepEndTime == 0 &&
-					 ctx.pSourceFrameData->present_event.AppSimStartTime == 0) ||
-					 displayedTime == 0) {
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-						std::numeric_limits<double>::quiet_NaN();
-					return;
-				}
-				const auto xellStartTime = ctx.pSourceFrameData->present_event.AppSleepEndTime != 0 ?
-					ctx.pSourceFrameData->present_event.AppSleepEndTime :
-					ctx.pSourceFrameData->present_event.AppSimStartTime;
-				const auto val = TimestampDeltaToUnsignedMilliSeconds(xellStartTime,
-					ScreenTime,
-					ctx.performanceCounterPeriodMs);
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-				return;
-            }
-			else if constexpr (isBetweenDisplayChange) {
-				if (ctx.previousDisplayedQpc == 0) {
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-						std::numeric_limits<double>::quiet_NaN();
-					return;
-				}
-				const auto val = TimestampDeltaToUnsignedMilliSeconds(ctx.previousDisplayedQpc,	ScreenTime,
-					ctx.performanceCounterPeriodMs);
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-				return;
-			} else {
-				if (displayedTime == 0) {
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-						std::numeric_limits<double>::quiet_NaN();
-					return;
-				}
-				const auto val = TimestampDeltaToUnsignedMilliSeconds(ctx.cpuStart, ScreenTime, 
-					ctx.performanceCounterPeriodMs);
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-				return;
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	class ReturnNanGatherCommand_ : public pmon::mid::GatherCommand_
+	const PmNsmFrameData& GetOffsetProbe_()
 	{
-	public:
-		ReturnNanGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-				std::numeric_limits<double>::quiet_NaN();
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	class DisplayDifferenceGatherCommand_ : public pmon::mid::GatherCommand_
-	{
-	public:
-		DisplayDifferenceGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			if (ctx.dropped) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-				return;
-			}
-			auto ScreenTime = ctx.pSourceFrameData->present_event.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex];
-			auto ii = ctx.frameTimingData.flipDelayDataMap.find(ctx.pSourceFrameData->present_event.FrameId);
-			if (ii != ctx.frameTimingData.flipDelayDataMap.end()) {
-				ScreenTime = ii->second.displayQpc;
-			}
-			auto NextScreenTime = ctx.sourceFrameDisplayIndex == ctx.pSourceFrameData->present_event.DisplayedCount - 1
-                ? ctx.nextDisplayedQpc
-                : ctx.pSourceFrameData->present_event.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex + 1];
-			const auto val = TimestampDeltaToUnsignedMilliSeconds(ScreenTime, NextScreenTime, ctx.performanceCounterPeriodMs);
-			if (val == 0.) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-			}
-			else {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	template<bool doDroppedCheck, bool doZeroCheck>
-	class AnimationErrorGatherCommand_ : public pmon::mid::GatherCommand_
-	{
-	public:
-		AnimationErrorGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t) util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			if constexpr (doDroppedCheck) {
-				if (ctx.dropped) {
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-						std::numeric_limits<double>::quiet_NaN();
-					return;
-				}
-			}
-			if constexpr (doZeroCheck) {
-				if (ctx.frameTimingData.lastDisplayedAppSimStartTime == 0 && ctx.lastDisplayedCpuStart == 0) {
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) = 
-						std::numeric_limits<double>::quiet_NaN();
-					return;
-				}
-			}
-			if (ctx.sourceFrameDisplayIndex == ctx.appIndex) {
-				auto ScreenTime = ctx.pSourceFrameData->present_event.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex];
-				auto ii = ctx.frameTimingData.flipDelayDataMap.find(ctx.pSourceFrameData->present_event.FrameId);
-				if (ii != ctx.frameTimingData.flipDelayDataMap.end()) {
-					ScreenTime = ii->second.displayQpc;
-				}
-				auto NextScreenTime = ctx.sourceFrameDisplayIndex == ctx.pSourceFrameData->present_event.DisplayedCount - 1
-					? ctx.nextDisplayedQpc
-					: ctx.pSourceFrameData->present_event.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex + 1];
-				const auto displayedTime = TimestampDeltaToUnsignedMilliSeconds(ScreenTime, NextScreenTime, ctx.performanceCounterPeriodMs);
-				if (displayedTime == 0.0) {
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-						std::numeric_limits<double>::quiet_NaN();
-					return;
-				}
-				auto PrevScreenTime = ctx.frameTimingData.lastDisplayedAppScreenTime;
-				// Next calculate the animation error. First calculate the simulation
-				// start time. Simulation start can be either an app provided sim start time via the provider or
-				// PCL stats or, if not present,the cpu start.
-				uint64_t simStartTime = 0;
-				if (ctx.frameTimingData.animationErrorSource == AnimationErrorSource::AppProvider && 
-					ctx.frameTimingData.lastDisplayedAppSimStartTime != 0) {
-					// If the app provider is the source of the animation error then use the app sim start time.
-					simStartTime = ctx.pSourceFrameData->present_event.AppSimStartTime;
-				}
-				else if (ctx.frameTimingData.animationErrorSource == AnimationErrorSource::PCLatency &&
-					ctx.frameTimingData.lastDisplayedAppSimStartTime != 0) {
-					// If the pcl latency is the source of the animation error then use the pcl sim start time.
-					simStartTime = ctx.pSourceFrameData->present_event.PclSimStartTime;
-				}
-				else if (ctx.frameTimingData.lastDisplayedAppSimStartTime == 0) {
-					// If the cpu start time is the source of the animation error then use the cpu start time.
-					simStartTime = ctx.cpuStart;
-				}
-				auto PrevSimStartTime = ctx.frameTimingData.lastDisplayedAppSimStartTime != 0 ?
-					ctx.frameTimingData.lastDisplayedAppSimStartTime :
-					ctx.lastDisplayedCpuStart;
-				// If the simulation start time is less than the last displated simulation start time it means
-				// we are transitioning to app provider events.
-				if (simStartTime > PrevSimStartTime) {
-					const auto val = TimestampDeltaToMilliSeconds(ScreenTime - PrevScreenTime,
-						simStartTime - PrevSimStartTime, ctx.performanceCounterPeriodMs);
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-				} else {
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) = std::numeric_limits<double>::quiet_NaN();
-					return;
-				}
-			}
-			else {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	class AnimationTimeGatherCommand_ : public pmon::mid::GatherCommand_
+		static const PmNsmFrameData probe{};
+		return probe;
+	}
+
+	template<auto pMember>
+	GatherOp_ MakeCopyOp_(const PM_QUERY_ELEMENT& q, uint32_t index = 0)
 	{
-	public:
-		AnimationTimeGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			if (ctx.dropped) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = std::numeric_limits<double>::quiet_NaN();
-				return;
-			}
+		using Type = util::MemberPointerInfo<decltype(pMember)>::MemberType;
+		using Element = CopyElement_<Type>::Type;
+		static_assert(sizeof(Element) == 1 || sizeof(Element) == 4 || sizeof(Element) == 8);
+		constexpr auto pSubstruct = GetSubstructurePointer<pMember>();
+		// offsetof doesn't take member pointers, so measure where the member is in a frame instead
+		const auto& probe = GetOffsetProbe_();
+		auto sourceOffset = uint32_t(reinterpret_cast<const uint8_t*>(&(probe.*pSubstruct.*pMember)) -
+			reinterpret_cast<const uint8_t*>(&probe));
+		if constexpr (!std::is_same_v<Element, Type>) {
+			sourceOffset += uint32_t(index * sizeof(Element));
+		}
+		constexpr auto code = sizeof(Element) == 1 ? GatherOpCode_::Copy1 :
+			sizeof(Element) == 4 ? GatherOpCode_::Copy4 : GatherOpCode_::Copy8;
+		return GatherOp_{ code, 0, sourceOffset };
+	}
 
-			// Calculate the current frame's displayed time 
-			
-			// Check to see if the current present is collapsed and if so use the correct display qpc.
-			auto ScreenTime = ctx.pSourceFrameData->present_event.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex];
-			auto ii = ctx.frameTimingData.flipDelayDataMap.find(ctx.pSourceFrameData->present_event.FrameId);
-			if (ii != ctx.frameTimingData.flipDelayDataMap.end()) {
-				ScreenTime = ii->second.displayQpc;
-			}
-			auto NextScreenTime = ctx.sourceFrameDisplayIndex == ctx.pSourceFrameData->present_event.DisplayedCount - 1
-				? ctx.nextDisplayedQpc
-				: ctx.pSourceFrameData->present_event.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex + 1];
-			const auto displayedTime = TimestampDeltaToUnsignedMilliSeconds(ScreenTime, NextScreenTime, ctx.performanceCounterPeriodMs);
-			if (ctx.sourceFrameDisplayIndex != ctx.appIndex ||
-				displayedTime == 0.0) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = std::numeric_limits<double>::quiet_NaN();
-				return;
-			}
-			const auto firstSimStartTime = ctx.frameTimingData.firstAppSimStartTime != 0 ?
-				ctx.frameTimingData.firstAppSimStartTime :
-				ctx.qpcStart;
-			uint64_t currentSimTime = 0;
-			if (ctx.frameTimingData.animationErrorSource == AnimationErrorSource::AppProvider) {
-				if (ctx.frameTimingData.lastDisplayedAppSimStartTime != 0) {
-					// If the app provider is the source of the animation error then use the app sim start time.
-					currentSimTime = ctx.pSourceFrameData->present_event.AppSimStartTime;
-				}
-				else {
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) = 0.;
-					return;
-				}
-			}
-			else if (ctx.frameTimingData.animationErrorSource == AnimationErrorSource::PCLatency) {
-				if (ctx.frameTimingData.lastDisplayedAppSimStartTime != 0) {
-					// If the pcl latency is the source of the animation error then use the pcl sim start time.
-					currentSimTime = ctx.pSourceFrameData->present_event.PclSimStartTime;
-				}
-				else {
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) = 0.;
-					return;
-				}
-			}
-			else if (ctx.frameTimingData.lastDisplayedAppSimStartTime == 0) {
-				// If the cpu start time is the source of the animation error then use the cpu start time.
-				currentSimTime = ctx.cpuStart;
-			}
-			const auto val = TimestampDeltaToUnsignedMilliSeconds(firstSimStartTime, currentSimTime, ctx.performanceCounterPeriodMs);
-			reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	class CpuFrameQpcFrameTimeCommand_ : public pmon::mid::GatherCommand_
+	GatherOp_ MakeOp_(GatherOpCode_ code, const PM_QUERY_ELEMENT& q,
+		uint64_t PmNsmPresentEvent::* pMember = nullptr, uint64_t PmNsmPresentEvent::* pAltMember = nullptr)
 	{
-	public:
-		CpuFrameQpcFrameTimeCommand_(size_t nextAvailableByteOffset) : outputOffset_{ (uint32_t)nextAvailableByteOffset } {}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			if (ctx.sourceFrameDisplayIndex == ctx.appIndex) {
-                double cpuBusy = 0.;
-				if (ctx.pSourceFrameData->present_event.AppPropagatedPresentStartTime != 0) {
-                    cpuBusy = TimestampDeltaToUnsignedMilliSeconds(ctx.cpuStart, ctx.pSourceFrameData->present_event.AppPropagatedPresentStartTime,
-						ctx.performanceCounterPeriodMs);
-                }
-                else {
-                    cpuBusy = TimestampDeltaToUnsignedMilliSeconds(ctx.cpuStart, ctx.pSourceFrameData->present_event.PresentStartTime,
-                        ctx.performanceCounterPeriodMs);
-				}
-                double cpuWait = 0.;
-				if (ctx.pSourceFrameData->present_event.AppPropagatedTimeInPresent != 0) {
-                    cpuWait = TimestampDeltaToMilliSeconds(ctx.pSourceFrameData->present_event.AppPropagatedTimeInPresent,
-                        ctx.performanceCounterPeriodMs);
-                }
-                else {
-                    cpuWait = TimestampDeltaToMilliSeconds(ctx.pSourceFrameData->present_event.TimeInPresent,
-                        ctx.performanceCounterPeriodMs);
-                }
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = cpuBusy + cpuWait;
-			}
-			else {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = 0.;
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(uint64_t);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-	};
-	class GpuWaitGatherCommand_ : public pmon::mid::GatherCommand_
+		return GatherOp_{ code, 0, 0, pMember, pAltMember };
+	}
+
+	// where an op's value goes in the blob: aligned to its type, except the cpu start qpc which
+	// has always been written wherever the previous element ended
+	struct OpLayout_
 	{
-	public:
-		GpuWaitGatherCommand_(size_t nextAvailableByteOffset) : outputOffset_{ (uint32_t)nextAvailableByteOffset } {}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			if (ctx.sourceFrameDisplayIndex == ctx.appIndex) {
-                double gpuDuration = 0.;
-                double gpuBusy = 0.;
-                if (ctx.pSourceFrameData->present_event.AppPropagatedGPUStartTime != 0) {
-                    gpuDuration = TimestampDeltaToUnsignedMilliSeconds(ctx.pSourceFrameData->present_event.AppPropagatedGPUStartTime,
-                        ctx.pSourceFrameData->present_event.AppPropagatedReadyTime, ctx.performanceCounterPeriodMs);
-					gpuBusy = TimestampDeltaToMilliSeconds(ctx.pSourceFrameData->present_event.AppPropagatedGPUDuration,
-						ctx.performanceCounterPeriodMs);
-                }
-                else {
-                    gpuDuration = TimestampDeltaToUnsignedMilliSeconds(ctx.pSourceFrameData->present_event.GPUStartTime,
-                        ctx.pSourceFrameData->present_event.ReadyTime, ctx.performanceCounterPeriodMs);
-					gpuBusy = TimestampDeltaToMilliSeconds(ctx.pSourceFrameData->present_event.GPUDuration,
-						ctx.performanceCounterPeriodMs);
-                }
-				const auto val = std::max(0., gpuDuration - gpuBusy);
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-			}
-			else {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = 0.;
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(uint64_t);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
+		uint32_t alignment;
+		uint32_t size;
 	};
-	template<uint64_t PmNsmPresentEvent::* pStart, bool doDroppedCheck, bool isMouseClick>
-	class InputLatencyGatherCommand_ : public pmon::mid::GatherCommand_
+	OpLayout_ GetOpLayout_(GatherOpCode_ code)
 	{
-	public:
-		InputLatencyGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
+		switch (code) {
+		case GatherOpCode_::Copy1:
+		case GatherOpCode_::Dropped:
+			return { alignof(bool), sizeof(bool) };
+		case GatherOpCode_::Copy4:
+			return { alignof(uint32_t), sizeof(uint32_t) };
+		case GatherOpCode_::Copy8:
+			return { alignof(uint64_t), sizeof(uint64_t) };
+		case GatherOpCode_::FrameType:
+			return { alignof(FrameType), sizeof(FrameType) };
+		case GatherOpCode_::CpuStartQpc:
+			return { 1, sizeof(uint64_t) };
+		default:
+			return { alignof(double), sizeof(double) };
 		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			if constexpr (doDroppedCheck) {
-				if (ctx.dropped) {
-					reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-						std::numeric_limits<double>::quiet_NaN();
-					return;
-				}
-			}
-
-			// Check to see if the current present is collapsed and if so use the correct display qpc.
-			uint64_t displayQpc = ctx.pSourceFrameData->present_event.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex];
-			auto ii = ctx.frameTimingData.flipDelayDataMap.find(ctx.pSourceFrameData->present_event.FrameId);
-			if (ii != ctx.frameTimingData.flipDelayDataMap.end()) {
-				displayQpc = ii->second.displayQpc;
-			}
-
-			double updatedInputTime = 0.;
-			double val = 0.;
-			if (ctx.sourceFrameDisplayIndex == ctx.appIndex) {
-				if (isMouseClick) {
-					updatedInputTime = ctx.lastReceivedNotDisplayedClickQpc == 0 ? 0. :
-						TimestampDeltaToUnsignedMilliSeconds(ctx.lastReceivedNotDisplayedClickQpc,
-							displayQpc,
-							ctx.performanceCounterPeriodMs);
-					val = ctx.pSourceFrameData->present_event.*pStart == 0 ? updatedInputTime :
-						TimestampDeltaToUnsignedMilliSeconds(ctx.pSourceFrameData->present_event.*pStart,
-							displayQpc,
-							ctx.performanceCounterPeriodMs);
-					ctx.lastReceivedNotDisplayedClickQpc = 0;
-				}
-				else {
-					updatedInputTime = ctx.lastReceivedNotDisplayedAllInputTime == 0 ? 0. :
-						TimestampDeltaToUnsignedMilliSeconds(ctx.lastReceivedNotDisplayedAllInputTime,
-							displayQpc,
-							ctx.performanceCounterPeriodMs);
-					val = ctx.pSourceFrameData->present_event.*pStart == 0 ? updatedInputTime :
-						TimestampDeltaToUnsignedMilliSeconds(ctx.pSourceFrameData->present_event.*pStart,
-							displayQpc,
-							ctx.performanceCounterPeriodMs);
-					ctx.lastReceivedNotDisplayedAllInputTime = 0;
-				}
-			}
+	}
 
-			if (val == 0.) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-			}
-			else {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	class PcLatencyGatherCommand_ : public pmon::mid::GatherCommand_
+	// compiles the element into its op; the op's output offset is set when the query is laid out
+	std::optional<GatherOp_> MapQueryElementToGatherOp_(const PM_QUERY_ELEMENT& q)
 	{
-	public:
-		PcLatencyGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			if (ctx.dropped) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-				return;
-			}
+		using Pre = PmNsmPresentEvent;
+		using Gpu = PresentMonPowerTelemetryInfo;
+		using Cpu = CpuTelemetryInfo;
+		using Op = GatherOpCode_;
 
-			double val = 0.;
-			auto simStartTime = ctx.pSourceFrameData->present_event.PclSimStartTime != 0 ?
-				ctx.pSourceFrameData->present_event.PclSimStartTime : 
-				ctx.frameTimingData.lastAppSimStartTime;
-			if (ctx.avgInput2Fs == 0. || simStartTime == 0) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-				return;
-			}
+		switch (q.metric) {
+		case PM_METRIC_APPLICATION:
+			return MakeCopyOp_<&Pre::application>(q);
+		case PM_METRIC_GPU_MEM_SIZE:
+			return MakeCopyOp_<&Gpu::gpu_mem_total_size_b>(q);
+		case PM_METRIC_GPU_MEM_MAX_BANDWIDTH:
+			return MakeCopyOp_<&Gpu::gpu_mem_max_bandwidth_bps>(q);
 
-			// Check to see if the current present is collapsed and if so use the correct display qpc.
-			uint64_t displayQpc = ctx.pSourceFrameData->present_event.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex];
-			auto ii = ctx.frameTimingData.flipDelayDataMap.find(ctx.pSourceFrameData->present_event.FrameId);
-			if (ii != ctx.frameTimingData.flipDelayDataMap.end()) {
-				displayQpc = ii->second.displayQpc;
-			}
+		case PM_METRIC_SWAP_CHAIN_ADDRESS:
+			return MakeCopyOp_<&Pre::SwapChainAddress>(q);
+		case PM_METRIC_GPU_BUSY:
+			return MakeOp_(Op::QpcDurationApp, q, &Pre::GPUDuration, &Pre::AppPropagatedGPUDuration);
+		case PM_METRIC_DROPPED_FRAMES:
+			return MakeOp_(Op::Dropped, q);
+		case PM_METRIC_PRESENT_MODE:
+			return MakeCopyOp_<&Pre::PresentMode>(q);
+		case PM_METRIC_PRESENT_RUNTIME:
+			return MakeCopyOp_<&Pre::Runtime>(q);
+		case PM_METRIC_CPU_START_QPC:
+			return MakeOp_(Op::CpuStartQpc, q);
+		case PM_METRIC_ALLOWS_TEARING:
+			return MakeCopyOp_<&Pre::SupportsTearing>(q);
+		case PM_METRIC_FRAME_TYPE:
+			return MakeOp_(Op::FrameType, q);
+		case PM_METRIC_SYNC_INTERVAL:
+			return MakeCopyOp_<&Pre::SyncInterval>(q);
 
-			val = ctx.avgInput2Fs +
-				TimestampDeltaToUnsignedMilliSeconds(simStartTime, 
-					displayQpc,
-					ctx.performanceCounterPeriodMs);
+		case PM_METRIC_GPU_POWER:
+			return MakeCopyOp_<&Gpu::gpu_power_w>(q);
+		case PM_METRIC_GPU_VOLTAGE:
+			return MakeCopyOp_<&Gpu::gpu_voltage_v>(q);
+		case PM_METRIC_GPU_FREQUENCY:
+			return MakeCopyOp_<&Gpu::gpu_frequency_mhz>(q);
+		case PM_METRIC_GPU_TEMPERATURE:
+			return MakeCopyOp_<&Gpu::gpu_temperature_c>(q);
+		case PM_METRIC_GPU_FAN_SPEED:
+			return MakeCopyOp_<&Gpu::fan_speed_rpm>(q, q.arrayIndex);
+		case PM_METRIC_GPU_UTILIZATION:
+			return MakeCopyOp_<&Gpu::gpu_utilization>(q);
+		case PM_METRIC_GPU_RENDER_COMPUTE_UTILIZATION:
+			return MakeCopyOp_<&Gpu::gpu_render_compute_utilization>(q);
+		case PM_METRIC_GPU_MEDIA_UTILIZATION:
+			return MakeCopyOp_<&Gpu::gpu_media_utilization>(q);
+		case PM_METRIC_GPU_MEM_POWER:
+			return MakeCopyOp_<&Gpu::vram_power_w>(q);
+		case PM_METRIC_GPU_MEM_VOLTAGE:
+			return MakeCopyOp_<&Gpu::vram_voltage_v>(q);
+		case PM_METRIC_GPU_MEM_FREQUENCY:
+			return MakeCopyOp_<&Gpu::vram_frequency_mhz>(q);
+		case PM_METRIC_GPU_MEM_EFFECTIVE_FREQUENCY:
+			return MakeCopyOp_<&Gpu::vram_effective_frequency_gbps>(q);
+		case PM_METRIC_GPU_MEM_TEMPERATURE:
+			return MakeCopyOp_<&Gpu::vram_temperature_c>(q);
+		case PM_METRIC_GPU_MEM_USED:
+			return MakeCopyOp_<&Gpu::gpu_mem_used_b>(q);
+		case PM_METRIC_GPU_MEM_WRITE_BANDWIDTH:
+			return MakeCopyOp_<&Gpu::gpu_mem_write_bandwidth_bps>(q);
+		case PM_METRIC_GPU_MEM_READ_BANDWIDTH:
+			return MakeCopyOp_<&Gpu::gpu_mem_read_bandwidth_bps>(q);
+		case PM_METRIC_GPU_POWER_LIMITED:
+			return MakeCopyOp_<&Gpu::gpu_power_limited>(q);
+		case PM_METRIC_GPU_TEMPERATURE_LIMITED:
+			return MakeCopyOp_<&Gpu::gpu_temperature_limited>(q);
+		case PM_METRIC_GPU_CURRENT_LIMITED:
+			return MakeCopyOp_<&Gpu::gpu_current_limited>(q);
+		case PM_METRIC_GPU_VOLTAGE_LIMITED:
+			return MakeCopyOp_<&Gpu::gpu_voltage_limited>(q);
+		case PM_METRIC_GPU_UTILIZATION_LIMITED:
+			return MakeCopyOp_<&Gpu::gpu_utilization_limited>(q);
+		case PM_METRIC_GPU_MEM_POWER_LIMITED:
+			return MakeCopyOp_<&Gpu::vram_power_limited>(q);
+		case PM_METRIC_GPU_MEM_TEMPERATURE_LIMITED:
+			return MakeCopyOp_<&Gpu::vram_temperature_limited>(q);
+		case PM_METRIC_GPU_MEM_CURRENT_LIMITED:
+			return MakeCopyOp_<&Gpu::vram_current_limited>(q);
+		case PM_METRIC_GPU_MEM_VOLTAGE_LIMITED:
+			return MakeCopyOp_<&Gpu::vram_voltage_limited>(q);
+		case PM_METRIC_GPU_MEM_UTILIZATION_LIMITED:
+			return MakeCopyOp_<&Gpu::vram_utilization_limited>(q);
+		case PM_METRIC_GPU_FRAME_ENERGY:
+			return MakeCopyOp_<&Gpu::gpu_frame_energy_j>(q);
+		case PM_METRIC_GPU_FRAME_POWER:
+			return MakeCopyOp_<&Gpu::gpu_frame_power_w>(q);
 
-			if (val == 0.) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-			}
-			else {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	class BetweenSimStartsGatherCommand_ : public pmon::mid::GatherCommand_
-	{
-	public:
-		BetweenSimStartsGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
-		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-			double val = 0.;
-			uint64_t currentSimStartTime = 0;
-			if (ctx.pSourceFrameData->present_event.PclSimStartTime != 0) {
-				currentSimStartTime = ctx.pSourceFrameData->present_event.PclSimStartTime;
-            } else if (ctx.pSourceFrameData->present_event.AppSimStartTime != 0) {
-				currentSimStartTime = ctx.pSourceFrameData->present_event.AppSimStartTime;
-            }
-
-			if (ctx.frameTimingData.lastAppSimStartTime == 0 || currentSimStartTime == 0) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-				return;
-			}
+		case PM_METRIC_CPU_UTILIZATION:
+			return MakeCopyOp_<&Cpu::cpu_utilization>(q);
+		case PM_METRIC_CPU_POWER:
+			return MakeCopyOp_<&Cpu::cpu_power_w>(q);
+		case PM_METRIC_CPU_TEMPERATURE:
+			return MakeCopyOp_<&Cpu::cpu_temperature>(q);
+		case PM_METRIC_CPU_FREQUENCY:
+			return MakeCopyOp_<&Cpu::cpu_frequency>(q);
 
-			val = TimestampDeltaToUnsignedMilliSeconds(
-				ctx.frameTimingData.lastAppSimStartTime, currentSimStartTime,
-				ctx.performanceCounterPeriodMs);
-
-			if (val == 0.) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-			}
-			else {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
+		case PM_METRIC_PRESENT_FLAGS:
+			return MakeCopyOp_<&Pre::PresentFlags>(q);
+		case PM_METRIC_CPU_START_TIME:
+			return MakeOp_(Op::CpuStartTime, q);
+		case PM_METRIC_CPU_FRAME_TIME:
+		case PM_METRIC_BETWEEN_APP_START:
+			return MakeOp_(Op::CpuFrameTime, q);
+		case PM_METRIC_CPU_BUSY:
+			return MakeOp_(Op::CpuDelta, q, &Pre::PresentStartTime, &Pre::AppPropagatedPresentStartTime);
+		case PM_METRIC_CPU_WAIT:
+			return MakeOp_(Op::QpcDurationApp, q, &Pre::TimeInPresent, &Pre::AppPropagatedTimeInPresent);
+		case PM_METRIC_GPU_TIME:
+			return MakeOp_(Op::GpuTime, q);
+		case PM_METRIC_GPU_WAIT:
+			return MakeOp_(Op::GpuWait, q);
+		case PM_METRIC_DISPLAYED_TIME:
+			return MakeOp_(Op::DisplayedTime, q);
+		case PM_METRIC_ANIMATION_ERROR:
+			return MakeOp_(Op::AnimationError, q);
+		case PM_METRIC_ANIMATION_TIME:
+			return MakeOp_(Op::AnimationTime, q);
+		case PM_METRIC_GPU_LATENCY:
+			return MakeOp_(Op::CpuDelta, q, &Pre::GPUStartTime, &Pre::AppPropagatedGPUStartTime);
+		case PM_METRIC_DISPLAY_LATENCY:
+			return MakeOp_(Op::DisplayLatency, q);
+		case PM_METRIC_CLICK_TO_PHOTON_LATENCY:
+			return MakeOp_(Op::ClickToPhoton, q);
+		case PM_METRIC_ALL_INPUT_TO_PHOTON_LATENCY:
+			return MakeOp_(Op::AllInputToPhoton, q);
+		case PM_METRIC_INSTRUMENTED_LATENCY:
+			return MakeOp_(Op::InstrumentedLatency, q);
+		case PM_METRIC_PRESENT_START_TIME:
+			return MakeOp_(Op::PresentStartTime, q, &Pre::PresentStartTime);
+		case PM_METRIC_PRESENT_START_QPC:
+			return MakeCopyOp_<&Pre::PresentStartTime>(q);
+		case PM_METRIC_IN_PRESENT_API:
+			return MakeOp_(Op::QpcDuration, q, &Pre::TimeInPresent);
+		case PM_METRIC_UNTIL_DISPLAYED:
+			return MakeOp_(Op::UntilDisplayed, q, &Pre::PresentStartTime);
+		case PM_METRIC_BETWEEN_DISPLAY_CHANGE:
+			return MakeOp_(Op::BetweenDisplayChange, q);
+		case PM_METRIC_BETWEEN_PRESENTS:
+			return MakeOp_(Op::BetweenPresents, q, &Pre::PresentStartTime);
+		case PM_METRIC_RENDER_PRESENT_LATENCY:
+			return MakeOp_(Op::QpcDelta, q, &Pre::PresentStartTime, &Pre::ReadyTime);
+		case PM_METRIC_BETWEEN_SIMULATION_START:
+			return MakeOp_(Op::BetweenSimStarts, q);
+		case PM_METRIC_PC_LATENCY:
+			return MakeOp_(Op::PcLatency, q);
+		case PM_METRIC_FLIP_DELAY:
+			return MakeOp_(Op::FlipDelay, q);
+		default:
+			pmlog_error("no gather op for metric").pmwatch((int)q.metric).diag();
+			return {};
 		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
-		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
-	class FlipDelayGatherCommand_ : public pmon::mid::GatherCommand_
+	}
+
+	template<size_t size>
+	void CopyColumn_(std::span<const FrameRow> rows, uint32_t sourceOffset, uint8_t* pDest, size_t stride)
 	{
-	public:
-		FlipDelayGatherCommand_(size_t nextAvailableByteOffset)
-		{
-			outputPaddingSize_ = (uint16_t)util::GetPadding(nextAvailableByteOffset, alignof(double));
-			outputOffset_ = uint32_t(nextAvailableByteOffset) + outputPaddingSize_;
+		for (auto& row : rows) {
+			std::memcpy(pDest, reinterpret_cast<const uint8_t*>(row.pSourceFrameData) + sourceOffset, size);
+			pDest += stride;
 		}
-		void Gather(Context& ctx, uint8_t* pDestBlob) const override
-		{
-
-			if (ctx.dropped) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-				return;
-			}
-
-            // Calculate the current frame's flip delay
-			uint64_t flipDelay = ctx.pSourceFrameData->present_event.FlipDelay;
-			auto ii = ctx.frameTimingData.flipDelayDataMap.find(ctx.pSourceFrameData->present_event.FrameId);
-			if (ii != ctx.frameTimingData.flipDelayDataMap.end()) {
-                flipDelay = ii->second.flipDelay;
-			}
-
-			double val = 0.;
-			val = TimestampDeltaToMilliSeconds(flipDelay, ctx.performanceCounterPeriodMs);
+	}
 
-			if (val == 0.) {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) =
-					std::numeric_limits<double>::quiet_NaN();
-			}
-			else {
-				reinterpret_cast<double&>(pDestBlob[outputOffset_]) = val;
-			}
-		}
-		uint32_t GetBeginOffset() const override
-		{
-			return outputOffset_ - outputPaddingSize_;
-		}
-		uint32_t GetEndOffset() const override
-		{
-			return outputOffset_ + alignof(double);
-		}
-		uint32_t GetOutputOffset() const override
-		{
-			return outputOffset_;
+	// the loop that each op is fused into: computes the op's value for every row of the batch and
+	// writes it to the row's output, stride bytes after the previous row's
+	template<typename T, typename F>
+	void GatherColumn_(std::span<const FrameRow> rows, uint8_t* pDest, size_t stride, F&& compute)
+	{
+		for (auto& row : rows) {
+			const T val = compute(row, row.pSourceFrameData->present_event);
+			std::memcpy(pDest, &val, sizeof(T));
+			pDest += stride;
 		}
-	private:
-		uint32_t outputOffset_;
-		uint16_t outputPaddingSize_;
-	};
+	}
 }
 
-PM_FRAME_QUERY::PM_FRAME_QUERY(std::span<PM_QUERY_ELEMENT> queryElements)
+PM_FRAME_QUERY::PM_FRAME_QUERY(std::span<PM_QUERY_ELEMENT> queryElements, uint32_t columnFrameCapacity)
+	:
+	columnFrameCapacity_{ columnFrameCapacity }
 {
 	// TODO: validation
 	//	only allow array index zero if not array type in nsm
@@ -1307,6 +399,7 @@ PM_FRAME_QUERY::PM_FRAME_QUERY(std::span<PM_QUERY_ELEMENT> queryElements)
 	
 	// we need to keep track of how many non-universal devices are specified
 	// current release: only 1 gpu device maybe be polled at a time
+	std::vector<PM_QUERY_ELEMENT*> opElements;
 	for (auto& q : queryElements) {
 		// validate that maximum 1 device (gpu) id is specified throughout the query
 		if (q.deviceId != 0) {
@@ -1319,190 +412,429 @@ PM_FRAME_QUERY::PM_FRAME_QUERY(std::span<PM_QUERY_ELEMENT> queryElements)
 				throw Except<Exception>("2 different non-universal devices in same query");
 			}
 		}
-		if (auto pElement = MapQueryElementToGatherCommand_(q, blobSize_)) {
-			gatherCommands_.push_back(std::move(pElement));
-			const auto& cmd = gatherCommands_.back();
-			q.dataSize = cmd->GetDataSize();
-			q.dataOffset = cmd->GetOutputOffset();
-			blobSize_ += cmd->GetTotalSize();
+		// compile the element into the op table, which is what gathers frames
+		if (auto op = MapQueryElementToGatherOp_(q)) {
+			const auto layout = GetOpLayout_(op->code);
+			const auto offset = blobSize_ + util::GetPadding(blobSize_, layout.alignment);
+			q.dataSize = layout.size;
+			q.dataOffset = offset;
+			op->outputOffset = uint32_t(offset);
+			blobSize_ = offset + layout.size;
+			rowNeeds_ |= GetRowNeeds_(op->code);
+			gatherOps_.push_back(*op);
+			opElements.push_back(&q);
+		}
+	}
+	if (!IsColumnar()) {
+		// make sure blobs are a multiple of 16 so that blobs in array always start 16-aligned
+		blobSize_ += util::GetPadding(blobSize_, 16);
+		for (auto& op : gatherOps_) {
+			op.outputStride = uint32_t(blobSize_);
+		}
+		return;
+	}
+	// columnar: each element gets an aligned array of a value per frame instead of a place in the blob
+	uint64_t outputSize = 0;
+	for (size_t i = 0; i < gatherOps_.size(); i++) {
+		auto& q = *opElements[i];
+		q.dataOffset = outputSize;
+		gatherOps_[i].outputOffset = uint32_t(outputSize);
+		gatherOps_[i].outputStride = uint32_t(q.dataSize);
+		outputSize += q.dataSize * columnFrameCapacity_;
+		outputSize += util::GetPadding(size_t(outputSize), PM_FRAME_QUERY_COLUMN_ALIGNMENT);
+		if (outputSize > std::numeric_limits<uint32_t>::max()) {
+			pmlog_error("Columnar frame query output too large").pmwatch(columnFrameCapacity_).diag();
+			throw Except<Exception>("Columnar frame query output exceeds 4GB");
 		}
 	}
-	// make sure blobs are a multiple of 16 so that blobs in array always start 16-aligned
-	blobSize_ += util::GetPadding(blobSize_, 16);
+	blobSize_ = size_t(outputSize);
 }
 
 PM_FRAME_QUERY::~PM_FRAME_QUERY() = default;
 
 void PM_FRAME_QUERY::GatherToBlob(Context& ctx, uint8_t* pDestBlob) const
 {
-	for (auto& cmd : gatherCommands_) {
-		cmd->Gather(ctx, pDestBlob);
-	}
+	FrameRow row;
+	ResolveRow(ctx, row);
+	GatherRowsToBlobs(ctx, std::span<const FrameRow>{ &row, 1 }, pDestBlob);
 }
 
-size_t PM_FRAME_QUERY::GetBlobSize() const
+void PM_FRAME_QUERY::ResolveRow(Context& ctx, FrameRow& row) const
 {
-	return blobSize_;
+	const auto& pe = ctx.pSourceFrameData->present_event;
+	row.pSourceFrameData = ctx.pSourceFrameData;
+	row.cpuStart = ctx.cpuStart;
+	row.previousPresentStartQpc = ctx.previousPresentStartQpc;
+	row.lastDisplayedCpuStart = ctx.lastDisplayedCpuStart;
+	row.previousDisplayedQpc = ctx.previousDisplayedQpc;
+	row.notDisplayedClickQpc = ctx.lastReceivedNotDisplayedClickQpc;
+	row.notDisplayedAllInputTime = ctx.lastReceivedNotDisplayedAllInputTime;
+	row.firstAppSimStartTime = ctx.frameTimingData.firstAppSimStartTime;
+	row.lastAppSimStartTime = ctx.frameTimingData.lastAppSimStartTime;
+	row.lastDisplayedAppSimStartTime = ctx.frameTimingData.lastDisplayedAppSimStartTime;
+	row.lastDisplayedAppScreenTime = ctx.frameTimingData.lastDisplayedAppScreenTime;
+	row.avgInput2Fs = ctx.avgInput2Fs;
+	row.animationErrorSource = ctx.frameTimingData.animationErrorSource;
+	row.sourceFrameDisplayIndex = ctx.sourceFrameDisplayIndex;
+	row.dropped = ctx.dropped;
+	row.isAppIndex = ctx.sourceFrameDisplayIndex == ctx.appIndex;
+
+	if (rowNeeds_ & NeedsScreenTime_) {
+		// Check to see if the current present is collapsed and if so use the correct display qpc and flip delay.
+		row.screenTime = pe.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex];
+		row.flipDelay = pe.FlipDelay;
+		auto ii = ctx.frameTimingData.flipDelayDataMap.find(pe.FrameId);
+		if (ii != ctx.frameTimingData.flipDelayDataMap.end()) {
+			row.screenTime = ii->second.displayQpc;
+			row.flipDelay = ii->second.flipDelay;
+		}
+	}
+	if (rowNeeds_ & NeedsDisplayedTime_) {
+		const auto nextScreenTime = ctx.sourceFrameDisplayIndex == pe.DisplayedCount - 1
+			? ctx.nextDisplayedQpc
+			: pe.Displayed_ScreenTime[ctx.sourceFrameDisplayIndex + 1];
+		row.displayedTime = TimestampDeltaToUnsignedMilliSeconds(row.screenTime, nextScreenTime, ctx.performanceCounterPeriodMs);
+	}
+	// the input latency metrics consume the pending input of non displayed frames
+	if (!row.dropped && row.isAppIndex) {
+		if (rowNeeds_ & ConsumesClick_) {
+			ctx.lastReceivedNotDisplayedClickQpc = 0;
+		}
+		if (rowNeeds_ & ConsumesAllInput_) {
+			ctx.lastReceivedNotDisplayedAllInputTime = 0;
+		}
+	}
 }
 
-std::optional<uint32_t> PM_FRAME_QUERY::GetReferencedDevice() const
+void PM_FRAME_QUERY::GatherRowsToBlobs(const Context& ctx, std::span<const FrameRow> rows, uint8_t* pDestBlobs, size_t firstFrame) const
 {
-	return referencedDevice_;
+	// every op makes a pass over the rows, so gather in chunks small enough that a chunk's frame
+	// data and blobs stay in cache for all of its passes
+	for (size_t i = 0; i < rows.size(); i += gatherBatchSize) {
+		GatherRowChunk_(ctx, rows.subspan(i, std::min(gatherBatchSize, rows.size() - i)), pDestBlobs, firstFrame + i);
+	}
 }
 
-std::unique_ptr<mid::GatherCommand_> PM_FRAME_QUERY::MapQueryElementToGatherCommand_(const PM_QUERY_ELEMENT& q, size_t pos)
+void PM_FRAME_QUERY::GatherRowChunk_(const Context& ctx, std::span<const FrameRow> rows, uint8_t* pDestBlobs, size_t firstFrame) const
 {
 	using Pre = PmNsmPresentEvent;
-	using Gpu = PresentMonPowerTelemetryInfo;
-	using Cpu = CpuTelemetryInfo;
+	constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+	const auto period = ctx.performanceCounterPeriodMs;
+	const auto qpcStart = ctx.qpcStart;
+	const auto ms = [period](uint64_t timestampDelta) {
+		return TimestampDeltaToMilliSeconds(timestampDelta, period);
+	};
+	const auto unsignedMs = [period](uint64_t timestampFrom, uint64_t timestampTo) {
+		return TimestampDeltaToUnsignedMilliSeconds(timestampFrom, timestampTo, period);
+	};
 
-	switch (q.metric) {
-	// temporary static metric lookup via nsm
-	// only implementing the ones used by appcef right now... others available in the future
-	// TODO: implement fill for all static OR drop support for filling static
-	case PM_METRIC_APPLICATION:
-		return std::make_unique<CopyGatherCommand_<&Pre::application>>(pos);
-	case PM_METRIC_GPU_MEM_SIZE:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_mem_total_size_b>>(pos);
-	case PM_METRIC_GPU_MEM_MAX_BANDWIDTH:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_mem_max_bandwidth_bps>>(pos);
+	for (auto& op : gatherOps_) {
+		const auto pDest = pDestBlobs + op.outputOffset + firstFrame * op.outputStride;
+		const auto pMember = op.pMember;
+		const auto pAltMember = op.pAltMember;
+		switch (op.code) {
+		case GatherOpCode_::Copy1:
+			CopyColumn_<1>(rows, op.sourceOffset, pDest, op.outputStride);
+			break;
+		case GatherOpCode_::Copy4:
+			CopyColumn_<4>(rows, op.sourceOffset, pDest, op.outputStride);
+			break;
+		case GatherOpCode_::Copy8:
+			CopyColumn_<8>(rows, op.sourceOffset, pDest, op.outputStride);
+			break;
+		case GatherOpCode_::FrameType:
+			GatherColumn_<FrameType>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				const auto val = pe.Displayed_FrameType[r.sourceFrameDisplayIndex];
+				// Currently not reporting out not set or repeated frames.
+				return val == FrameType::NotSet || val == FrameType::Repeated ? FrameType::Application : val;
+			});
+			break;
+		case GatherOpCode_::Dropped:
+			GatherColumn_<bool>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre&) {
+				return r.dropped;
+			});
+			break;
+		case GatherOpCode_::CpuStartQpc:
+			GatherColumn_<uint64_t>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre&) {
+				return r.cpuStart;
+			});
+			break;
+		case GatherOpCode_::QpcDuration:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow&, const Pre& pe) {
+				return pe.*pMember != 0 ? ms(pe.*pMember) : 0.;
+			});
+			break;
+		case GatherOpCode_::QpcDurationApp:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				if (r.isAppIndex) {
+					if (pe.*pAltMember != 0) {
+						return ms(pe.*pAltMember);
+					}
+					if (pe.*pMember != 0) {
+						return ms(pe.*pMember);
+					}
+				}
+				return 0.;
+			});
+			break;
+		case GatherOpCode_::CpuStartTime:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre&) {
+				return ms(r.cpuStart - qpcStart);
+			});
+			break;
+		case GatherOpCode_::PresentStartTime:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow&, const Pre& pe) {
+				return ms(pe.*pMember - qpcStart);
+			});
+			break;
+		case GatherOpCode_::CpuFrameTime:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				if (!r.isAppIndex) {
+					return 0.;
+				}
+				const auto cpuBusy = pe.AppPropagatedPresentStartTime != 0 ?
+					unsignedMs(r.cpuStart, pe.AppPropagatedPresentStartTime) :
+					unsignedMs(r.cpuStart, pe.PresentStartTime);
+				const auto cpuWait = pe.AppPropagatedTimeInPresent != 0 ?
+					ms(pe.AppPropagatedTimeInPresent) :
+					ms(pe.TimeInPresent);
+				return cpuBusy + cpuWait;
+			});
+			break;
+		case GatherOpCode_::CpuDelta:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				if (!r.isAppIndex) {
+					return 0.;
+				}
+				return pe.*pAltMember != 0 ?
+					unsignedMs(r.cpuStart, pe.*pAltMember) :
+					unsignedMs(r.cpuStart, pe.*pMember);
+			});
+			break;
+		case GatherOpCode_::GpuTime:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				if (!r.isAppIndex) {
+					return 0.;
+				}
+				const auto gpuDuration = pe.AppPropagatedGPUStartTime != 0 ?
+					unsignedMs(pe.AppPropagatedGPUStartTime, pe.AppPropagatedReadyTime) :
+					unsignedMs(pe.GPUStartTime, pe.ReadyTime);
+				const auto gpuBusy = pe.AppPropagatedGPUDuration != 0 ?
+					ms(pe.AppPropagatedGPUDuration) :
+					ms(pe.GPUDuration);
+				const auto gpuWait = std::max(0., gpuDuration - gpuBusy);
+				return gpuBusy + gpuWait;
+			});
+			break;
+		case GatherOpCode_::GpuWait:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				if (!r.isAppIndex) {
+					return 0.;
+				}
+				if (pe.AppPropagatedGPUStartTime != 0) {
+					return std::max(0., unsignedMs(pe.AppPropagatedGPUStartTime, pe.AppPropagatedReadyTime) -
+						ms(pe.AppPropagatedGPUDuration));
+				}
+				return std::max(0., unsignedMs(pe.GPUStartTime, pe.ReadyTime) - ms(pe.GPUDuration));
+			});
+			break;
+		case GatherOpCode_::DisplayedTime:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre&) {
+				return r.dropped || r.displayedTime == 0. ? nan : r.displayedTime;
+			});
+			break;
+		case GatherOpCode_::DisplayLatency:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre&) {
+				if (r.dropped || r.displayedTime == 0.) {
+					return nan;
+				}
+				return unsignedMs(r.cpuStart, r.screenTime);
+			});
+			break;
+		case GatherOpCode_::InstrumentedLatency:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				if (r.dropped || (pe.AppSleepEndTime == 0 && pe.AppSimStartTime == 0) || r.displayedTime == 0.) {
+					return nan;
+				}
+				const auto xellStartTime = pe.AppSleepEndTime != 0 ? pe.AppSleepEndTime : pe.AppSimStartTime;
+				return unsignedMs(xellStartTime, r.screenTime);
+			});
+			break;
+		case GatherOpCode_::BetweenDisplayChange:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre&) {
+				if (r.dropped || r.previousDisplayedQpc == 0) {
+					return nan;
+				}
+				return unsignedMs(r.previousDisplayedQpc, r.screenTime);
+			});
+			break;
+		case GatherOpCode_::UntilDisplayed:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				if (r.dropped || pe.*pMember == 0 || r.displayedTime == 0.) {
+					return nan;
+				}
+				return unsignedMs(pe.*pMember, r.screenTime);
+			});
+			break;
+		case GatherOpCode_::AnimationError:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				if (r.dropped || !r.isAppIndex || r.displayedTime == 0. ||
+					(r.lastDisplayedAppSimStartTime == 0 && r.lastDisplayedCpuStart == 0)) {
+					return nan;
+				}
+				// The simulation start can be either an app provided sim start time via the provider or
+				// PCL stats or, if not present, the cpu start.
+				uint64_t simStartTime = 0;
+				if (r.animationErrorSource == AnimationErrorSource::AppProvider && r.lastDisplayedAppSimStartTime != 0) {
+					simStartTime = pe.AppSimStartTime;
+				}
+				else if (r.animationErrorSource == AnimationErrorSource::PCLatency && r.lastDisplayedAppSimStartTime != 0) {
+					simStartTime = pe.PclSimStartTime;
+				}
+				else if (r.lastDisplayedAppSimStartTime == 0) {
+					simStartTime = r.cpuStart;
+				}
+				const auto prevSimStartTime = r.lastDisplayedAppSimStartTime != 0 ?
+					r.lastDisplayedAppSimStartTime : r.lastDisplayedCpuStart;
+				// If the simulation start time is less than the last displayed simulation start time it means
+				// we are transitioning to app provider events.
+				if (simStartTime <= prevSimStartTime) {
+					return nan;
+				}
+				return TimestampDeltaToMilliSeconds(r.screenTime - r.lastDisplayedAppScreenTime,
+					simStartTime - prevSimStartTime, period);
+			});
+			break;
+		case GatherOpCode_::AnimationTime:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				if (r.dropped || !r.isAppIndex || r.displayedTime == 0.) {
+					return nan;
+				}
+				const auto firstSimStartTime = r.firstAppSimStartTime != 0 ? r.firstAppSimStartTime : qpcStart;
+				uint64_t currentSimTime = 0;
+				if (r.animationErrorSource == AnimationErrorSource::AppProvider) {
+					if (r.lastDisplayedAppSimStartTime == 0) {
+						return 0.;
+					}
+					currentSimTime = pe.AppSimStartTime;
+				}
+				else if (r.animationErrorSource == AnimationErrorSource::PCLatency) {
+					if (r.lastDisplayedAppSimStartTime == 0) {
+						return 0.;
+					}
+					currentSimTime = pe.PclSimStartTime;
+				}
+				else if (r.lastDisplayedAppSimStartTime == 0) {
+					currentSimTime = r.cpuStart;
+				}
+				return unsignedMs(firstSimStartTime, currentSimTime);
+			});
+			break;
+		case GatherOpCode_::ClickToPhoton:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				if (r.dropped || !r.isAppIndex) {
+					return nan;
+				}
+				const auto updatedInputTime = r.notDisplayedClickQpc == 0 ? 0. :
+					unsignedMs(r.notDisplayedClickQpc, r.screenTime);
+				const auto val = pe.MouseClickTime == 0 ? updatedInputTime :
+					unsignedMs(pe.MouseClickTime, r.screenTime);
+				return val == 0. ? nan : val;
+			});
+			break;
+		case GatherOpCode_::AllInputToPhoton:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				if (r.dropped || !r.isAppIndex) {
+					return nan;
+				}
+				const auto updatedInputTime = r.notDisplayedAllInputTime == 0 ? 0. :
+					unsignedMs(r.notDisplayedAllInputTime, r.screenTime);
+				const auto val = pe.InputTime == 0 ? updatedInputTime :
+					unsignedMs(pe.InputTime, r.screenTime);
+				return val == 0. ? nan : val;
+			});
+			break;
+		case GatherOpCode_::BetweenPresents:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				if (r.previousPresentStartQpc == 0 || pe.*pMember == 0) {
+					return nan;
+				}
+				return unsignedMs(r.previousPresentStartQpc, pe.*pMember);
+			});
+			break;
+		case GatherOpCode_::QpcDelta:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow&, const Pre& pe) {
+				if (pe.*pMember == 0 || pe.*pAltMember == 0) {
+					return nan;
+				}
+				return unsignedMs(pe.*pMember, pe.*pAltMember);
+			});
+			break;
+		case GatherOpCode_::BetweenSimStarts:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				const auto currentSimStartTime = pe.PclSimStartTime != 0 ? pe.PclSimStartTime : pe.AppSimStartTime;
+				if (r.lastAppSimStartTime == 0 || currentSimStartTime == 0) {
+					return nan;
+				}
+				const auto val = unsignedMs(r.lastAppSimStartTime, currentSimStartTime);
+				return val == 0. ? nan : val;
+			});
+			break;
+		case GatherOpCode_::PcLatency:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre& pe) {
+				const auto simStartTime = pe.PclSimStartTime != 0 ? pe.PclSimStartTime : r.lastAppSimStartTime;
+				if (r.dropped || r.avgInput2Fs == 0. || simStartTime == 0) {
+					return nan;
+				}
+				const auto val = r.avgInput2Fs + unsignedMs(simStartTime, r.screenTime);
+				return val == 0. ? nan : val;
+			});
+			break;
+		case GatherOpCode_::FlipDelay:
+			GatherColumn_<double>(rows, pDest, op.outputStride, [&](const FrameRow& r, const Pre&) {
+				const auto val = ms(r.flipDelay);
+				return r.dropped || val == 0. ? nan : val;
+			});
+			break;
+		}
+	}
+}
 
-	case PM_METRIC_SWAP_CHAIN_ADDRESS:
-		return std::make_unique<CopyGatherCommand_<&Pre::SwapChainAddress>>(pos);
-	case PM_METRIC_GPU_BUSY:
-		return std::make_unique<QpcDurationGatherCommand_<&Pre::GPUDuration, &Pre::AppPropagatedGPUDuration, 1>>(pos);
-	case PM_METRIC_DROPPED_FRAMES:
-		return std::make_unique<DroppedGatherCommand_>(pos);
-	case PM_METRIC_PRESENT_MODE:
-		return std::make_unique<CopyGatherCommand_<&Pre::PresentMode>>(pos);
-	case PM_METRIC_PRESENT_RUNTIME:
-		return std::make_unique<CopyGatherCommand_<&Pre::Runtime>>(pos);
-	case PM_METRIC_CPU_START_QPC:
-		return std::make_unique<CpuFrameQpcGatherCommand_>(pos);
-	case PM_METRIC_ALLOWS_TEARING:
-		return std::make_unique<CopyGatherCommand_<&Pre::SupportsTearing>>(pos);
-	case PM_METRIC_FRAME_TYPE:
-		return std::make_unique<CopyGatherFrameTypeCommand_>(pos);
-	case PM_METRIC_SYNC_INTERVAL:
-		return std::make_unique<CopyGatherCommand_<&Pre::SyncInterval>>(pos);
+size_t PM_FRAME_QUERY::GetBlobSize() const
+{
+	return blobSize_;
+}
 
-	case PM_METRIC_GPU_POWER:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_power_w>>(pos);
-	case PM_METRIC_GPU_VOLTAGE:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_voltage_v>>(pos);
-	case PM_METRIC_GPU_FREQUENCY:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_frequency_mhz>>(pos);
-	case PM_METRIC_GPU_TEMPERATURE:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_temperature_c>>(pos);
-	case PM_METRIC_GPU_FAN_SPEED:
-		return std::make_unique<CopyGatherCommand_<&Gpu::fan_speed_rpm>>(pos, q.arrayIndex);
-	case PM_METRIC_GPU_UTILIZATION:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_utilization>>(pos);
-	case PM_METRIC_GPU_RENDER_COMPUTE_UTILIZATION:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_render_compute_utilization>>(pos);
-	case PM_METRIC_GPU_MEDIA_UTILIZATION:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_media_utilization>>(pos);
-	case PM_METRIC_GPU_MEM_POWER:
-		return std::make_unique<CopyGatherCommand_<&Gpu::vram_power_w>>(pos);
-	case PM_METRIC_GPU_MEM_VOLTAGE:
-		return std::make_unique<CopyGatherCommand_<&Gpu::vram_voltage_v>>(pos);
-	case PM_METRIC_GPU_MEM_FREQUENCY:
-		return std::make_unique<CopyGatherCommand_<&Gpu::vram_frequency_mhz>>(pos);
-	case PM_METRIC_GPU_MEM_EFFECTIVE_FREQUENCY:
-		return std::make_unique<CopyGatherCommand_<&Gpu::vram_effective_frequency_gbps>>(pos);
-	case PM_METRIC_GPU_MEM_TEMPERATURE:
-		return std::make_unique<CopyGatherCommand_<&Gpu::vram_temperature_c>>(pos);
-	case PM_METRIC_GPU_MEM_USED:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_mem_used_b>>(pos);
-	case PM_METRIC_GPU_MEM_WRITE_BANDWIDTH:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_mem_write_bandwidth_bps>>(pos);
-	case PM_METRIC_GPU_MEM_READ_BANDWIDTH:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_mem_read_bandwidth_bps>>(pos);
-	case PM_METRIC_GPU_POWER_LIMITED:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_power_limited>>(pos);
-	case PM_METRIC_GPU_TEMPERATURE_LIMITED:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_temperature_limited>>(pos);
-	case PM_METRIC_GPU_CURRENT_LIMITED:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_current_limited>>(pos);
-	case PM_METRIC_GPU_VOLTAGE_LIMITED:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_voltage_limited>>(pos);
-	case PM_METRIC_GPU_UTILIZATION_LIMITED:
-		return std::make_unique<CopyGatherCommand_<&Gpu::gpu_utilization_limited>>(pos);
-	case PM_METRIC_GPU_MEM_POWER_LIMITED:
-		return std::make_unique<CopyGatherCommand_<&Gpu::vram_power_limited>>(pos);
-	case PM_METRIC_GPU_MEM_TEMPERATURE_LIMITED:
-		return std::make_unique<CopyGatherCommand_<&Gpu::vram_temperature_limited>>(pos);
-	case PM_METRIC_GPU_MEM_CURRENT_LIMITED:
-		return std::make_unique<CopyGatherCommand_<&Gpu::vram_current_limited>>(pos);
-	case PM_METRIC_GPU_MEM_VOLTAGE_LIMITED:
-		return std::make_unique<CopyGatherCommand_<&Gpu::vram_voltage_limited>>(pos);
-	case PM_METRIC_GPU_MEM_UTILIZATION_LIMITED:
-		return std::make_unique<CopyGatherCommand_<&Gpu::vram_utilization_limited>>(pos);
+bool PM_FRAME_QUERY::IsColumnar() const
+{
+	return columnFrameCapacity_ != 0;
+}
 
-	case PM_METRIC_CPU_UTILIZATION:
-		return std::make_unique<CopyGatherCommand_<&Cpu::cpu_utilization>>(pos);
-	case PM_METRIC_CPU_POWER:
-		return std::make_unique<CopyGatherCommand_<&Cpu::cpu_power_w>>(pos);
-	case PM_METRIC_CPU_TEMPERATURE:
-		return std::make_unique<CopyGatherCommand_<&Cpu::cpu_temperature>>(pos);
-	case PM_METRIC_CPU_FREQUENCY:
-		return std::make_unique<CopyGatherCommand_<&Cpu::cpu_frequency>>(pos);
+uint32_t PM_FRAME_QUERY::GetColumnFrameCapacity() const
+{
+	return columnFrameCapacity_;
+}
+
+std::optional<uint32_t> PM_FRAME_QUERY::GetReferencedDevice() const
+{
+	return referencedDevice_;
+}
 
-	case PM_METRIC_PRESENT_FLAGS:
-		return std::make_unique<CopyGatherCommand_<&Pre::PresentFlags>>(pos);
-	case PM_METRIC_CPU_START_TIME:
-		return std::make_unique<StartDifferenceGatherCommand_<&Pre::PresentStartTime, 0>>(pos);
-	case PM_METRIC_CPU_FRAME_TIME:
-	case PM_METRIC_BETWEEN_APP_START:
-		return std::make_unique<CpuFrameQpcFrameTimeCommand_>(pos);
-	case PM_METRIC_CPU_BUSY:
-		return std::make_unique<CpuFrameQpcDifferenceGatherCommand_<&Pre::PresentStartTime, &Pre::AppPropagatedPresentStartTime, 0>>(pos);
-	case PM_METRIC_CPU_WAIT:
-		return std::make_unique<QpcDurationGatherCommand_<&Pre::TimeInPresent, &Pre::AppPropagatedTimeInPresent, 1>>(pos);
-	case PM_METRIC_GPU_TIME:
-		return std::make_unique<GpuTimeGatherCommand_>(pos);
-	case PM_METRIC_GPU_WAIT:
-		return std::make_unique<GpuWaitGatherCommand_>(pos);
-	case PM_METRIC_DISPLAYED_TIME:
-		return std::make_unique<DisplayDifferenceGatherCommand_>(pos);
-	case PM_METRIC_ANIMATION_ERROR:
-		return std::make_unique<AnimationErrorGatherCommand_<1,1>>(pos);
-	case PM_METRIC_ANIMATION_TIME:
-		return std::make_unique<AnimationTimeGatherCommand_>(pos);
-	case PM_METRIC_GPU_LATENCY:
-		return std::make_unique<CpuFrameQpcDifferenceGatherCommand_<&Pre::GPUStartTime, &Pre::AppPropagatedGPUStartTime, 0>>(pos);
-	case PM_METRIC_DISPLAY_LATENCY:
-		return std::make_unique<DisplayLatencyGatherCommand_<0,0>>(pos);
-	case PM_METRIC_CLICK_TO_PHOTON_LATENCY:
-		return std::make_unique<InputLatencyGatherCommand_<&Pre::MouseClickTime, 1, 1>>(pos);
-	case PM_METRIC_ALL_INPUT_TO_PHOTON_LATENCY:
-		return std::make_unique<InputLatencyGatherCommand_<&Pre::InputTime, 1, 0>>(pos);
-	case PM_METRIC_INSTRUMENTED_LATENCY:
-		return std::make_unique<DisplayLatencyGatherCommand_<1,0>>(pos);
-	case PM_METRIC_PRESENT_START_TIME:
-		return std::make_unique<StartDifferenceGatherCommand_<&Pre::PresentStartTime, 1>>(pos);
-	case PM_METRIC_PRESENT_START_QPC:
-		return std::make_unique<CopyGatherCommand_<&Pre::PresentStartTime>>(pos);
-    case PM_METRIC_IN_PRESENT_API:
-		return std::make_unique<QpcDurationGatherCommand_<&Pre::TimeInPresent, &Pre::TimeInPresent, 0>>(pos);
-    case PM_METRIC_UNTIL_DISPLAYED:
-        return std::make_unique<DisplayLatencyGatherFromCommand_<&Pre::PresentStartTime>>(pos);
-    case PM_METRIC_BETWEEN_DISPLAY_CHANGE:
-        return std::make_unique<DisplayLatencyGatherCommand_<0,1>>(pos);
-	case PM_METRIC_BETWEEN_PRESENTS:
-        return std::make_unique<QpcDeltaGatherToCommand_<&Pre::PresentStartTime>>(pos);
-	case PM_METRIC_RENDER_PRESENT_LATENCY:
-		return std::make_unique<QpcDeltaGatherFromToCommand_<&Pre::PresentStartTime, &Pre::ReadyTime, 0>>(pos);
-	case PM_METRIC_BETWEEN_SIMULATION_START:
-        return std::make_unique<BetweenSimStartsGatherCommand_>(pos);
-	case PM_METRIC_PC_LATENCY:
-        return std::make_unique<PcLatencyGatherCommand_>(pos);
-	case PM_METRIC_FLIP_DELAY:
-		return std::make_unique<FlipDelayGatherCommand_>(pos);
-	default:
-		pmlog_error("unknown metric id").pmwatch((int)q.metric).diag();
-		return {};
+std::vector<uint32_t> PM_FRAME_QUERY::GetSourceOffsets() const
+{
+	std::vector<uint32_t> offsets;
+	for (auto& op : gatherOps_) {
+		switch (op.code) {
+		case GatherOpCode_::Copy1:
+		case GatherOpCode_::Copy4:
+		case GatherOpCode_::Copy8:
+			offsets.push_back(op.sourceOffset);
+			break;
+		default:
+			break;
+		}
 	}
+	return offsets;
 }
 
 void PM_FRAME_QUERY::Context::UpdateSourceData(const PmNsmFrameData* pSourceFrameData_in,
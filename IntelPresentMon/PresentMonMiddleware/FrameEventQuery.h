@@ -13,7 +13,7 @@ namespace pmapi::intro
 
 namespace pmon::mid
 {
-	class GatherCommand_;
+	struct GatherOp_;
 }
 
 struct PM_FRAME_QUERY
@@ -67,12 +67,53 @@ public:
 		// Current input to frame start average
 		double avgInput2Fs{};
 	};
+	// values shared by the gather ops, resolved from the Context once per output frame
+	struct FrameRow
+	{
+		const PmNsmFrameData* pSourceFrameData = nullptr;
+		uint64_t cpuStart = 0;
+		uint64_t previousPresentStartQpc = 0;
+		uint64_t lastDisplayedCpuStart = 0;
+		uint64_t previousDisplayedQpc = 0;
+		// Screen time qpc and flip delay of this display, corrected for collapsed presents
+		uint64_t screenTime = 0;
+		uint64_t flipDelay = 0;
+		// Input qpcs of non displayed frames pending when this frame was resolved
+		uint64_t notDisplayedClickQpc = 0;
+		uint64_t notDisplayedAllInputTime = 0;
+		uint64_t firstAppSimStartTime = 0;
+		uint64_t lastAppSimStartTime = 0;
+		uint64_t lastDisplayedAppSimStartTime = 0;
+		uint64_t lastDisplayedAppScreenTime = 0;
+		// Time from this display until the next one
+		double displayedTime = 0.;
+		double avgInput2Fs = 0.;
+		AnimationErrorSource animationErrorSource = AnimationErrorSource::CpuStart;
+		uint32_t sourceFrameDisplayIndex = 0;
+		bool dropped = false;
+		bool isAppIndex = false;
+	};
 	// functions
-	PM_FRAME_QUERY(std::span<PM_QUERY_ELEMENT> queryElements);
+	// a non-zero columnFrameCapacity lays the output out as one array of that many values per query
+	// element (PM_FRAME_QUERY_LAYOUT_COLUMNS) instead of one blob per frame
+	PM_FRAME_QUERY(std::span<PM_QUERY_ELEMENT> queryElements, uint32_t columnFrameCapacity = 0);
 	~PM_FRAME_QUERY();
 	void GatherToBlob(Context& ctx, uint8_t* pDestBlob) const;
+	// resolve the context's current frame (at its current display index) for a later batched gather
+	void ResolveRow(Context& ctx, FrameRow& row) const;
+	// gather rows resolved from ctx into the output as frames firstFrame onward, one op at a time across
+	// a batch of rows; callers resolving many frames should gather every gatherBatchSize rows while the
+	// frames are hot
+	static constexpr size_t gatherBatchSize = 64;
+	void GatherRowsToBlobs(const Context& ctx, std::span<const FrameRow> rows, uint8_t* pDestBlobs, size_t firstFrame = 0) const;
+	// size of a frame's blob, or of the whole output for the columnar layout
 	size_t GetBlobSize() const;
+	bool IsColumnar() const;
+	uint32_t GetColumnFrameCapacity() const;
 	std::optional<uint32_t> GetReferencedDevice() const;
+	// offsets into PmNsmFrameData of the fields the query copies out of frames as they are (its other
+	// metrics are computed from present event fields), so that only those need to be read in
+	std::vector<uint32_t> GetSourceOffsets() const;
 
 	PM_FRAME_QUERY(const PM_FRAME_QUERY&) = delete;
 	PM_FRAME_QUERY& operator=(const PM_FRAME_QUERY&) = delete;
@@ -81,9 +122,12 @@ public:
 
 private:
 	// functions
-	std::unique_ptr<pmon::mid::GatherCommand_> MapQueryElementToGatherCommand_(const PM_QUERY_ELEMENT& q, size_t pos);
+	void GatherRowChunk_(const Context& ctx, std::span<const FrameRow> rows, uint8_t* pDestBlobs, size_t firstFrame) const;
 	// data
-	std::vector<std::unique_ptr<pmon::mid::GatherCommand_>> gatherCommands_;
+	std::vector<pmon::mid::GatherOp_> gatherOps_;
+	// which of the FrameRow values that need lookups the ops use (see RowNeeds_)
+	uint32_t rowNeeds_ = 0;
 	size_t blobSize_ = 0;
+	uint32_t columnFrameCapacity_ = 0;
 	std::optional<uint32_t> referencedDevice_;
 };
\ No newline at end of file
@@ -0,0 +1,165 @@
+#pragma once
+#include "../PresentMonAPI2/PresentMonAPI.h"
+#include "../CommonUtilities/WindowedOrderStatistic.h"
+#include "../CommonUtilities/QuantileSketch.h"
+#include <algorithm>
+#include <optional>
+#include <variant>
+
+namespace pmon::mid
+{
+	// selects how the samples of a dynamic query's metric windows are stored
+	struct MetricWindowOptions
+	{
+		// when set, windows keep quantile sketches with this relative accuracy instead of raw samples
+		std::optional<double> sketchRelativeAccuracy;
+		// duration (in qpc ticks) of the blocks that sketch windows are evicted by
+		uint64_t sketchBlockDuration = 1;
+	};
+
+	// sliding window of metric samples backed either by an exact order statistic over the raw
+	// samples or by a bounded-memory quantile sketch
+	//
+	// the sketch backend returns percentiles within the configured relative accuracy (at rank
+	// p * (n - 1) rather than the interpolated rank p * n), evicts in whole blocks, and resolves the
+	// mid point statistics to block boundaries since arrival order is not retained
+	class MetricWindow
+	{
+	public:
+		MetricWindow() = default;
+		explicit MetricWindow(const MetricWindowOptions& options)
+		{
+			if (options.sketchRelativeAccuracy) {
+				impl_.emplace<util::WindowedQuantileSketch>(*options.sketchRelativeAccuracy, options.sketchBlockDuration);
+			}
+		}
+
+		void Push(uint64_t timestamp, double value)
+		{
+			std::visit([=](auto& w) { w.Push(timestamp, value); }, impl_);
+		}
+		void AddToNewest(double delta)
+		{
+			std::visit([=](auto& w) { w.AddToNewest(delta); }, impl_);
+		}
+		void EvictThrough(uint64_t cutoff)
+		{
+			std::visit([=](auto& w) { w.EvictThrough(cutoff); }, impl_);
+		}
+		void Clear()
+		{
+			std::visit([](auto& w) { w.Clear(); }, impl_);
+		}
+
+		size_t Size() const { return std::visit([](auto& w) { return w.Size(); }, impl_); }
+		bool Empty() const { return std::visit([](auto& w) { return w.Empty(); }, impl_); }
+		bool IsSketch() const { return std::holds_alternative<util::WindowedQuantileSketch>(impl_); }
+
+		double Newest() const { return std::visit([](auto& w) { return w.Newest().value; }, impl_); }
+		double Min() const { return std::visit([](auto& w) { return w.Min(); }, impl_); }
+		double Max() const { return std::visit([](auto& w) { return w.Max(); }, impl_); }
+		double Mean() const { return std::visit([](auto& w) { return w.Mean(); }, impl_); }
+		double NonZeroMean() const { return std::visit([](auto& w) { return w.NonZeroMean(); }, impl_); }
+		double Percentile(double p) const { return std::visit([=](auto& w) { return w.Percentile(p); }, impl_); }
+		double MidPoint() const { return std::visit([](auto& w) { return w.MidPoint(); }, impl_); }
+		double MidLerp() const { return std::visit([](auto& w) { return w.MidLerp(); }, impl_); }
+
+		// merge the window's distribution into a sketch (of the same accuracy for sketch windows)
+		void AccumulateInto(util::QuantileSketch& sketch) const
+		{
+			if (auto pSketch = std::get_if<util::WindowedQuantileSketch>(&impl_)) {
+				pSketch->AccumulateInto(sketch);
+			}
+			else {
+				auto& exact = std::get<util::WindowedOrderStatistic>(impl_);
+				for (size_t i = 0; i < exact.Size(); i++) {
+					sketch.Add(exact[i].value);
+				}
+			}
+		}
+
+	private:
+		std::variant<util::WindowedOrderStatistic, util::WindowedQuantileSketch> impl_;
+	};
+
+	// statistic of a window as dynamic queries report it; invert is set for rates taken from intervals,
+	// whose percentiles and extremes come from the other end of the window
+	inline double CalculateWindowStatistic(const MetricWindow& window, PM_STAT stat, bool invert = false)
+	{
+		if (window.Size() == 1) {
+			return window.Newest();
+		}
+
+		if (window.Size() >= 1) {
+			const auto percentile = [&](double p) { return window.Percentile(invert ? 1.0 - p : p); };
+			switch (stat) {
+			case PM_STAT_NONE:
+				break;
+			case PM_STAT_AVG:
+				return window.Mean();
+			case PM_STAT_PERCENTILE_99: return percentile(0.99);
+			case PM_STAT_PERCENTILE_95: return percentile(0.95);
+			case PM_STAT_PERCENTILE_90: return percentile(0.90);
+			case PM_STAT_PERCENTILE_01: return percentile(0.01);
+			case PM_STAT_PERCENTILE_05: return percentile(0.05);
+			case PM_STAT_PERCENTILE_10: return percentile(0.10);
+			case PM_STAT_MAX:
+				return invert ? window.Min() : window.Max();
+			case PM_STAT_MIN:
+				return invert ? window.Max() : window.Min();
+			case PM_STAT_MID_POINT:
+				return window.MidPoint();
+			case PM_STAT_MID_LERP:
+				return window.MidLerp();
+			case PM_STAT_NEWEST_POINT:
+				// TODO: Not yet implemented
+				break;
+			case PM_STAT_OLDEST_POINT:
+				// TODO: Not yet implemented
+				break;
+			case PM_STAT_COUNT:
+				// TODO: Not yet implemented
+				break;
+			case PM_STAT_NON_ZERO_AVG:
+				return window.NonZeroMean();
+			}
+		}
+
+		return 0.0;
+	}
+
+	// statistics over the samples of several windows taken together, such as a metric over every swap
+	// chain of every process polled; percentiles come from the windows' distributions merged into one
+	// sketch, so they are within its relative accuracy even when the windows hold raw samples
+	class CombinedMetricWindow
+	{
+	public:
+		explicit CombinedMetricWindow(double relativeAccuracy) : sketch_{ relativeAccuracy } {}
+
+		void Add(const MetricWindow& window)
+		{
+			if (window.Empty()) {
+				return;
+			}
+			window.AccumulateInto(sketch_);
+			min_ = size_ == 0 ? window.Min() : std::min(min_, window.Min());
+			max_ = size_ == 0 ? window.Max() : std::max(max_, window.Max());
+			sum_ += window.Mean() * double(window.Size());
+			size_ += window.Size();
+		}
+
+		size_t Size() const { return size_; }
+		bool Empty() const { return size_ == 0; }
+		double Min() const { return min_; }
+		double Max() const { return max_; }
+		double Mean() const { return size_ == 0 ? 0. : sum_ / double(size_); }
+		double Percentile(double p) const { return sketch_.Quantile(p); }
+
+	private:
+		util::QuantileSketch sketch_;
+		size_t size_ = 0;
+		double sum_ = 0.;
+		double min_ = 0.;
+		double max_ = 0.;
+	};
+}
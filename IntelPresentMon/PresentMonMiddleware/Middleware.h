@@ -16,13 +16,18 @@ namespace pmon::mid
 		virtual PM_STATUS StopStreaming(uint32_t processId) = 0;
 		virtual PM_STATUS SetTelemetryPollingPeriod(uint32_t deviceId, uint32_t timeMs) = 0;
 		virtual PM_STATUS SetEtwFlushPeriod(std::optional<uint32_t> periodMs) = 0;
-		virtual PM_DYNAMIC_QUERY* RegisterDynamicQuery(std::span<PM_QUERY_ELEMENT> queryElements, double windowSizeMs, double metricOffsetMs) = 0;
+		virtual PM_DYNAMIC_QUERY* RegisterDynamicQuery(std::span<PM_QUERY_ELEMENT> queryElements, double windowSizeMs, double metricOffsetMs, const PM_DYNAMIC_QUERY_OPTIONS* pOptions = nullptr) = 0;
 		virtual void FreeDynamicQuery(const PM_DYNAMIC_QUERY* pQuery) = 0;
 		virtual void PollDynamicQuery(const PM_DYNAMIC_QUERY* pQuery, uint32_t processId, uint8_t* pBlob, uint32_t* numSwapChains) = 0;
+		// processIds empty polls every tracked process, up to maxProcesses; returns the number of processes polled
+		// pCombinedBlob, if not null, receives the frame statistics over every swap chain of the processes polled
+		virtual uint32_t PollDynamicQueryProcesses(const PM_DYNAMIC_QUERY* pQuery, std::optional<std::span<const uint32_t>> processIds,
+			uint32_t maxProcesses, uint8_t* pBlobs, uint32_t numSwapChains, PM_DYNAMIC_QUERY_PROCESS_RESULT* pResults, uint8_t* pCombinedBlob) = 0;
 		virtual void PollStaticQuery(const PM_QUERY_ELEMENT& element, uint32_t processId, uint8_t* pBlob) = 0;
-		virtual PM_FRAME_QUERY* RegisterFrameEventQuery(std::span<PM_QUERY_ELEMENT> queryElements, uint32_t& blobSize) = 0;
+		virtual PM_FRAME_QUERY* RegisterFrameEventQuery(std::span<PM_QUERY_ELEMENT> queryElements, uint32_t& blobSize, const PM_FRAME_QUERY_OPTIONS* pOptions = nullptr) = 0;
 		virtual void FreeFrameEventQuery(const PM_FRAME_QUERY* pQuery) = 0;
 		virtual void ConsumeFrameEvents(const PM_FRAME_QUERY* pQuery, uint32_t processId, uint8_t* pBlob, uint32_t& numFrames) = 0;
+		virtual uint32_t WaitForFrames(uint32_t processId, uint32_t minFrames, uint32_t timeoutMs) = 0;
 		virtual void StopPlayback() = 0;
 
 	};
@@ -14,6 +14,10 @@ namespace pmon::svc::acts
         UpdateTelemetryPeriod();
         stx.requestedEtwFlushPeriodMs.reset();
         UpdateEtwFlushPeriod();
+        // a session going away no longer uses any telemetry
+        stx.requestedGpuTelemetryCaps = GpuTelemetryBitset{};
+        stx.requestedCpuTelemetryCaps = CpuTelemetryBitset{};
+        UpdateTelemetryDemand();
     }
     void ActionExecutionContext::UpdateTelemetryPeriod() const
     {
@@ -39,4 +43,27 @@ namespace pmon::svc::acts
             throw util::Except<ipc::act::ActionExecutionError>(sta);
         }
     }
+    void ActionExecutionContext::UpdateTelemetryDemand() const
+    {
+        // gather demand across all sessions; a session that has not stated its demand (a client older
+        // than demand-driven sampling) might use any telemetry
+        std::optional<GpuTelemetryBitset> gpuDemand = GpuTelemetryBitset{};
+        std::optional<CpuTelemetryBitset> cpuDemand = CpuTelemetryBitset{};
+        for (auto& [id, stx] : *pSessionMap) {
+            if (gpuDemand && stx.requestedGpuTelemetryCaps) {
+                *gpuDemand |= *stx.requestedGpuTelemetryCaps;
+            }
+            else {
+                gpuDemand.reset();
+            }
+            if (cpuDemand && stx.requestedCpuTelemetryCaps) {
+                *cpuDemand |= *stx.requestedCpuTelemetryCaps;
+            }
+            else {
+                cpuDemand.reset();
+            }
+        }
+        // execute the setting on the service system
+        pPmon->SetTelemetryDemand(gpuDemand, cpuDemand);
+    }
 }
\ No newline at end of file
@@ -26,6 +26,9 @@ namespace pmon::svc::acts
         std::optional<uint32_t> requestedAdapterId;
         std::optional<uint32_t> requestedTelemetryPeriodMs;
         std::optional<uint32_t> requestedEtwFlushPeriodMs;
+        // telemetry the client's queries are calculated from; empty for clients that do not say
+        std::optional<GpuTelemetryBitset> requestedGpuTelemetryCaps;
+        std::optional<CpuTelemetryBitset> requestedCpuTelemetryCaps;
         std::string clientBuildId;
     };
 
@@ -44,5 +47,6 @@ namespace pmon::svc::acts
         void Dispose(SessionContextType& stx);
         void UpdateTelemetryPeriod() const;
         void UpdateEtwFlushPeriod() const;
+        void UpdateTelemetryDemand() const;
     };
 }
\ No newline at end of file
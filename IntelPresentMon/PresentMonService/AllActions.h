@@ -6,6 +6,7 @@
 #include "acts/OpenSession.h" 
 #include "acts/SelectAdapter.h" 
 #include "acts/SetEtwFlushPeriod.h" 
+#include "acts/SetTelemetryDemand.h" 
 #include "acts/SetTelemetryPeriod.h" 
 #include "acts/StartTracking.h" 
 #include "acts/StopPlayback.h" 
@@ -19,6 +19,13 @@ namespace clio
 		Option<std::string> controlPipe{ this, "--control-pipe", "", "Name of the named pipe to use for the client-service control channel" };
 		Option<std::string> nsmPrefix{ this, "--nsm-prefix", "", "Prefix to use when naming named shared memory segments created for frame data circular buffers" };
 		Option<std::string> introNsm{ this, "--intro-nsm", "", "Name of the NSM used for introspection data" };
+		Flag enableColumnarNsm{ this, "--enable-columnar-nsm", "Also publish frame data in a per-field columnar NSM alongside each frame data circular buffer" };
+		Option<int> nsmHistorySize{ this, "--nsm-history-size", 4, "Size in MB of the compressed history of aged out frames kept behind each frame data circular buffer (0 to disable)", CLI::NonNegativeNumber };
+		Option<int> slowTelemetryPeriod{ this, "--slow-telemetry-period", 1000, "Shortest period in ms at which slowly changing telemetry (fan speeds, memory size and bandwidth, power limits) is sampled", CLI::NonNegativeNumber };
+		Option<std::vector<std::string>> telemetryCapPeriods{ this, "--telemetry-cap-period", {}, "Period in ms at which a kind of telemetry is sampled regardless of the requested telemetry period, as cap=ms (for example gpu_power=1 or fan_speed_0=1000)" };
+		Option<int> fastPowerRate{ this, "--fast-power-rate", 1000, "Rate in Hz at which gpu power is sampled on a thread of its own while the per-frame gpu energy is queried (0 to disable)", CLI::NonNegativeNumber };
+		Flag interpolateTelemetry{ this, "--interpolate-telemetry", "Interpolate power telemetry between the samples around each frame's present instead of taking the nearest sample" };
+		Flag enableMetricCache{ this, "--enable-metric-cache", "Publish telemetry statistics of common window sizes alongside each frame data circular buffer so that clients of the process read them instead of computing them" };
 
 	private: Group gd_{ this, "Debugging", "Aids in debugging this tool" }; public:
 		Flag debug{ this, "--debug,-d", "Stall service by running in a loop after startup waiting for debugger to connect" };
@@ -40,6 +47,11 @@ namespace clio
 
 	private: Group gt_{ this, "Testing", "Automated testing features" }; public:
 		Flag enableTestControl{ this, "--enable-test-control", "Enable test control over stdio" };
+		Option<int> fakeAdapterCount{ this, "--fake-adapter-count", 0, "Number of graphics adapters of synthetic telemetry to provide in place of the real devices, along with a cpu of synthetic telemetry, for benchmarking without the hardware (0 to use the real devices)", CLI::NonNegativeNumber };
+		Option<std::vector<std::string>> fakeTelemetryWaveforms{ this, "--fake-telemetry-waveform", {}, "Waveform of a kind of synthetic telemetry, as cap=shape:offset,amplitude,frequency,noise with shape one of const, sine or square (for example gpu_power=sine:150,50,0.5,2)" };
+		Option<std::string> fakeTelemetryTrace{ this, "--fake-telemetry-trace", "", "CSV of recorded telemetry to replay as the synthetic telemetry, with a time column in seconds followed by a column for each cap replayed", CLI::ExistingFile };
+		Option<double> fakeTelemetrySpeed{ this, "--fake-telemetry-speed", 1., "Speed at which the recorded synthetic telemetry is replayed", CLI::PositiveNumber };
+		Option<int> fakeTelemetrySeed{ this, "--fake-telemetry-seed", 0, "Seed of the noise of the synthetic telemetry", CLI::NonNegativeNumber };
 
 		static constexpr const char* description = "Intel PresentMon service for frame and system performance measurement";
 		static constexpr const char* name = "PresentMonService.exe";
@@ -12,6 +12,7 @@ using namespace std::literals;
 MockPresentMonSession::MockPresentMonSession()
 {
     ResetEtwFlushPeriod();
+    interpolate_telemetry_ = clio::Options::Get().interpolateTelemetry;
 }
 
 bool MockPresentMonSession::IsTraceSessionActive() {
@@ -267,8 +268,9 @@ void MockPresentMonSession::AddPresents(
                 current_telemetry_adapter_id_ < current_adapters.size()) {
                 auto current_telemetry_adapter =
                     current_adapters.at(current_telemetry_adapter_id_).get();
-                if (auto data = current_telemetry_adapter->GetClosest(
-                    presentEvent->PresentStartTime)) {
+                if (auto data = interpolate_telemetry_ ?
+                    current_telemetry_adapter->GetInterpolated(presentEvent->PresentStartTime) :
+                    current_telemetry_adapter->GetClosest(presentEvent->PresentStartTime)) {
                     power_telemetry = *data;
                 }
                 gpu_telemetry_cap_bits = current_telemetry_adapter
@@ -280,7 +282,9 @@ void MockPresentMonSession::AddPresents(
         std::bitset<static_cast<size_t>(CpuTelemetryCapBits::cpu_telemetry_count)>
             cpu_telemetry_cap_bits = {};
         if (cpu_) {
-            if (auto data = cpu_->GetClosest(presentEvent->PresentStartTime)) {
+            if (auto data = interpolate_telemetry_ ?
+                cpu_->GetInterpolated(presentEvent->PresentStartTime) :
+                cpu_->GetClosest(presentEvent->PresentStartTime)) {
                 cpu_telemetry = *data;
             }
             cpu_telemetry_cap_bits = cpu_->GetCpuTelemetryCapBits();
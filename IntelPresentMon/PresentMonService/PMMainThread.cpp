@@ -6,8 +6,10 @@
 #include "PresentMon.h"
 #include "PowerTelemetryContainer.h"
 #include "..\ControlLib\WmiCpu.h"
+#include "..\ControlLib\FakeCpu.h"
 #include "..\PresentMonUtils\StringUtils.h"
 #include <filesystem>
+#include <fstream>
 #include "../Interprocess/source/Interprocess.h"
 #include "CliOptions.h"
 #include "GlobalIdentifiers.h"
@@ -15,6 +17,7 @@
 #include "../CommonUtilities/IntervalWaiter.h"
 #include "../CommonUtilities/PrecisionWaiter.h"
 #include "../CommonUtilities/win/Event.h"
+#include "../CommonUtilities/ref/WrapReflect.h"
 
 #include "../CommonUtilities/log/GlogShim.h"
 #include "testing/TestControl.h"
@@ -79,6 +82,106 @@ void EventFlushThreadEntry_(Service* const srv, PresentMon* const pm)
     }
 }
 
+// longest wait of the telemetry threads, so that new demand is picked up even when nothing is due
+constexpr double telemetryIdlePollPeriod = 0.25;
+
+// the minimum period of slowly changing telemetry, and the periods configured for specific telemetry
+void ConfigureTelemetryScheduling_(PresentMon& pm)
+{
+    auto& opt = clio::Options::Get();
+    auto& gpuScheduler = pm.GetGpuTelemetryScheduler();
+    auto& cpuScheduler = pm.GetCpuTelemetryScheduler();
+    const auto slowPeriod = *opt.slowTelemetryPeriod / 1000.;
+    for (auto cap : { GpuTelemetryCapBits::fan_speed_0, GpuTelemetryCapBits::fan_speed_1,
+        GpuTelemetryCapBits::fan_speed_2, GpuTelemetryCapBits::fan_speed_3, GpuTelemetryCapBits::fan_speed_4,
+        GpuTelemetryCapBits::max_fan_speed_0, GpuTelemetryCapBits::max_fan_speed_1,
+        GpuTelemetryCapBits::max_fan_speed_2, GpuTelemetryCapBits::max_fan_speed_3,
+        GpuTelemetryCapBits::max_fan_speed_4, GpuTelemetryCapBits::gpu_mem_size,
+        GpuTelemetryCapBits::gpu_mem_max_bandwidth, GpuTelemetryCapBits::gpu_sustained_power_limit }) {
+        gpuScheduler.SetMinimumPeriod(cap, slowPeriod);
+    }
+    cpuScheduler.SetMinimumPeriod(CpuTelemetryCapBits::cpu_power_limit, slowPeriod);
+
+    for (auto& capPeriod : *opt.telemetryCapPeriods) {
+        const auto split = capPeriod.find('=');
+        const auto name = capPeriod.substr(0, split);
+        double periodMs = 0.;
+        try {
+            periodMs = std::stod(capPeriod.substr(split == std::string::npos ? capPeriod.size() : split + 1));
+        }
+        catch (...) {}
+        if (periodMs <= 0.) {
+            pmlog_error("Bad telemetry cap period, expected cap=ms").pmwatch(capPeriod);
+            continue;
+        }
+        bool found = false;
+        for (size_t i = 0; i < size_t(GpuTelemetryCapBits::gpu_telemetry_count); i++) {
+            if (reflect::enum_name(GpuTelemetryCapBits(i)) == name) {
+                gpuScheduler.SetPeriod(GpuTelemetryCapBits(i), periodMs / 1000.);
+                found = true;
+            }
+        }
+        for (size_t i = 0; i < size_t(CpuTelemetryCapBits::cpu_telemetry_count); i++) {
+            if (reflect::enum_name(CpuTelemetryCapBits(i)) == name) {
+                cpuScheduler.SetPeriod(CpuTelemetryCapBits(i), periodMs / 1000.);
+                found = true;
+            }
+        }
+        if (!found) {
+            pmlog_error("Unknown telemetry cap in telemetry cap period").pmwatch(capPeriod);
+        }
+    }
+}
+
+// synthetic telemetry to generate in place of that of the devices, if any was asked for
+std::optional<pwr::fake::FakeTelemetryConfig> MakeFakeTelemetryConfig_()
+{
+    auto& opt = clio::Options::Get();
+    if (*opt.fakeAdapterCount <= 0) {
+        return {};
+    }
+    pwr::fake::FakeTelemetryConfig config{
+        .adapterCount = uint32_t(*opt.fakeAdapterCount),
+        .replaySpeed = *opt.fakeTelemetrySpeed,
+        .seed = uint32_t(*opt.fakeTelemetrySeed),
+    };
+    for (auto& capWaveform : *opt.fakeTelemetryWaveforms) {
+        const auto split = capWaveform.find('=');
+        const auto name = capWaveform.substr(0, split);
+        const auto waveform = split == std::string::npos ? std::nullopt :
+            pwr::fake::Waveform::Parse(std::string_view{ capWaveform }.substr(split + 1));
+        if (!waveform) {
+            pmlog_error("Bad fake telemetry waveform, expected cap=shape:offset,amplitude,frequency,noise")
+                .pmwatch(capWaveform);
+            continue;
+        }
+        const auto IsCap = [&]<class C>(C count) {
+            for (size_t i = 0; i < size_t(count); i++) {
+                if (reflect::enum_name(C(i)) == name) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        if (!IsCap(GpuTelemetryCapBits::gpu_telemetry_count) && !IsCap(CpuTelemetryCapBits::cpu_telemetry_count)) {
+            pmlog_error("Unknown telemetry cap in fake telemetry waveform").pmwatch(capWaveform);
+            continue;
+        }
+        config.waveforms.emplace_back(name, *waveform);
+    }
+    if (opt.fakeTelemetryTrace) {
+        std::ifstream file{ *opt.fakeTelemetryTrace };
+        if (auto trace = pwr::fake::TelemetryTrace::Load(file)) {
+            config.trace = std::make_shared<pwr::fake::TelemetryTrace>(std::move(*trace));
+        }
+        else {
+            pmlog_error("Bad fake telemetry trace, expected a CSV of time and cap columns")
+                .pmwatch(*opt.fakeTelemetryTrace);
+        }
+    }
+    return config;
+}
+
 void PowerTelemetryThreadEntry_(Service* const srv, PresentMon* const pm,
 	PowerTelemetryContainer* const ptc, ipc::ServiceComms* const pComms)
 {
@@ -108,6 +211,10 @@ void PowerTelemetryThreadEntry_(Service* const srv, PresentMon* const pm,
             // sample 2x here as workaround/kludge because Intel provider misreports 1st sample
             adapter->Sample();
             adapter->Sample();
+            // probe the fast power reading so that the per-frame energy is registered as available
+            if (*clio::Options::Get().fastPowerRate > 0) {
+                adapter->SampleFastPower();
+            }
             pComms->RegisterGpuDevice(adapter->GetVendor(), adapter->GetName(), adapter->GetPowerTelemetryCapBits());
         }
         pComms->FinalizeGpuDevices();
@@ -117,7 +224,10 @@ void PowerTelemetryThreadEntry_(Service* const srv, PresentMon* const pm,
 	// only start periodic polling when streaming starts
     // exit polling loop and this thread when service is stopping
     {
-        IntervalWaiter waiter{ 0.016 };
+        // sample only the telemetry that clients' queries use, each kind when it falls due
+        auto& scheduler = pm->GetGpuTelemetryScheduler();
+        PrecisionWaiter waiter;
+        QpcTimer timer;
         const HANDLE events[]{
           pm->GetStreamingStartHandle(),
           srv->GetServiceStopHandle(),
@@ -136,13 +246,18 @@ void PowerTelemetryThreadEntry_(Service* const srv, PresentMon* const pm,
                     // TODO: log error here or inside of repopulate
                     ptc->Repopulate();
                 }
-                for (auto& adapter : ptc->GetPowerTelemetryAdapters()) {
-                    adapter->Sample();
+                if (const auto due = scheduler.TakeDue(timer.Peek()); due.any()) {
+                    for (auto& adapter : ptc->GetPowerTelemetryAdapters()) {
+                        adapter->SampleDemanded(due);
+                    }
+                }
+                // wait for the next telemetry to fall due, and back off to the idle poll while none is demanded
+                const auto nextDue = scheduler.GetNextDue();
+                const auto wait = std::min(nextDue ? *nextDue - timer.Peek() : telemetryIdlePollPeriod,
+                    telemetryIdlePollPeriod);
+                if (wait > 0.) {
+                    waiter.Wait(wait);
                 }
-                // Convert from the ms to seconds as GetTelemetryPeriod returns back
-                // ms and SetInterval expects seconds.
-                waiter.SetInterval(pm->GetGpuTelemetryPeriod()/1000.);
-                waiter.Wait();
                 // go dormant if there are no active streams left
                 // TODO: consider race condition here if client stops and starts streams rapidly
                 if (pm->GetActiveStreams() == 0) {
@@ -153,15 +268,67 @@ void PowerTelemetryThreadEntry_(Service* const srv, PresentMon* const pm,
     }
 }
 
+// Samples gpu power at a high rate for the per-frame energy while a client queries it. Power is read on a
+// thread of its own so that the driver calls of the other telemetry do not delay it.
+void FastPowerThreadEntry_(Service* const srv, PresentMon* const pm, PowerTelemetryContainer* const ptc)
+{
+    if (srv == nullptr || pm == nullptr || ptc == nullptr) {
+        pmlog_error("Fast power thread started without service");
+        return;
+    }
+    const auto rate = *clio::Options::Get().fastPowerRate;
+    if (rate <= 0) {
+        return;
+    }
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+    // keep the spin of the precision wait to a tenth of the sampling period
+    const auto period = 1. / rate;
+    IntervalWaiter waiter{ period, std::min(PrecisionWaiter::standardWaitBuffer, period / 10.) };
+    PrecisionWaiter idleWaiter;
+
+    const HANDLE events[]{
+        pm->GetStreamingStartHandle(),
+        srv->GetServiceStopHandle(),
+    };
+    while (1) {
+        auto waitResult = WaitForMultipleObjects((DWORD)std::size(events), events, FALSE, INFINITE);
+        // if events[1] was signalled, that means service is stopping so exit thread
+        if ((waitResult - WAIT_OBJECT_0) == 1) {
+            return;
+        }
+        while (WaitForSingleObject(srv->GetServiceStopHandle(), 0) != WAIT_OBJECT_0) {
+            if (pm->IsFastPowerDemanded()) {
+                const auto adapters = ptc->GetPowerTelemetryAdapters();
+                for (auto& adapter : adapters) {
+                    adapter->SampleFastPower();
+                }
+                waiter.Wait();
+            }
+            else {
+                idleWaiter.Wait(telemetryIdlePollPeriod);
+            }
+            // go dormant if there are no active streams left
+            if (pm->GetActiveStreams() == 0) {
+                break;
+            }
+        }
+    }
+}
+
 void CpuTelemetryThreadEntry_(Service* const srv, PresentMon* const pm,
 	pwr::cpu::CpuTelemetry* const cpu)
 {
-    IntervalWaiter waiter{ 0.016 };
 	if (srv == nullptr || pm == nullptr) {
 		// TODO: log error on this condition
 		return;
 	}
 
+    // cpu telemetry is read in a single query, so it is sampled whole whenever any of it is due
+    auto& scheduler = pm->GetCpuTelemetryScheduler();
+    PrecisionWaiter waiter;
+    QpcTimer timer;
+
     const HANDLE events[] {
         pm->GetStreamingStartHandle(),
         srv->GetServiceStopHandle(),
@@ -174,11 +341,15 @@ void CpuTelemetryThreadEntry_(Service* const srv, PresentMon* const pm,
 			return;
 		}
 		while (WaitForSingleObject(srv->GetServiceStopHandle(), 0) != WAIT_OBJECT_0) {
-			cpu->Sample();
-            // Convert from the ms to seconds as GetTelemetryPeriod returns back
-            // ms and SetInterval expects seconds.
-            waiter.SetInterval(pm->GetGpuTelemetryPeriod() / 1000.);
-            waiter.Wait();
+            if (scheduler.TakeDue(timer.Peek()).any()) {
+                cpu->Sample();
+            }
+            const auto nextDue = scheduler.GetNextDue();
+            const auto wait = std::min(nextDue ? *nextDue - timer.Peek() : telemetryIdlePollPeriod,
+                telemetryIdlePollPeriod);
+            if (wait > 0.) {
+                waiter.Wait(wait);
+            }
 			// Get the number of currently active streams
 			auto num_active_streams = pm->GetActiveStreams();
 			if (num_active_streams == 0) {
@@ -200,6 +371,7 @@ void PresentMonMainThread(Service* const pSvc)
     // so that if an exception happens, it won't block during unwinding,
     // trying to join threads that are waiting for a stop signal
     std::jthread gpuTelemetryThread;
+    std::jthread fastPowerThread;
     std::jthread cpuTelemetryThread;
 
     try {
@@ -253,6 +425,11 @@ void PresentMonMainThread(Service* const pSvc)
 
         // Set the created power telemetry container 
         pm.SetPowerTelemetryContainer(&ptc);
+        ConfigureTelemetryScheduling_(pm);
+        const auto fakeTelemetryConfig = MakeFakeTelemetryConfig_();
+        if (fakeTelemetryConfig) {
+            ptc.SetFakeTelemetry(*fakeTelemetryConfig);
+        }
 
         // Start named pipe action RPC server (active threaded)
         auto pActionServer = std::make_unique<ActionServer>(pSvc, &pm, opt.controlPipe.AsOptional());
@@ -263,12 +440,23 @@ void PresentMonMainThread(Service* const pSvc)
         catch (...) {
             LOG(ERROR) << "failed creating gpu(power) telemetry thread" << std::endl;
         }
+        try {
+            fastPowerThread = std::jthread{ FastPowerThreadEntry_, pSvc, &pm, &ptc };
+        }
+        catch (...) {
+            LOG(ERROR) << "failed creating fast power thread" << std::endl;
+        }
 
         // Create CPU telemetry
         std::shared_ptr<pwr::cpu::CpuTelemetry> cpu;
         try {
-            // Try to use WMI for metrics sampling
-            cpu = std::make_shared<pwr::cpu::wmi::WmiCpu>();
+            if (fakeTelemetryConfig) {
+                cpu = std::make_shared<pwr::cpu::fake::FakeCpu>(*fakeTelemetryConfig);
+            }
+            else {
+                // Try to use WMI for metrics sampling
+                cpu = std::make_shared<pwr::cpu::wmi::WmiCpu>();
+            }
         }
         catch (const std::runtime_error& e) {
             LOG(ERROR) << "failed creating wmi cpu telemetry thread; Status: " << e.what() << std::endl;
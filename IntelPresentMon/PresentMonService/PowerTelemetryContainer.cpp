@@ -11,8 +11,11 @@ bool PowerTelemetryContainer::Repopulate() {
 		telemetry_providers_.clear();
 		telemetry_adapters_.clear();
 
-		// create providers
-		for (int iVendor = 0; iVendor < int(PM_DEVICE_VENDOR_UNKNOWN); iVendor++) {
+		// create providers; synthetic telemetry stands in for that of every vendor
+		if (fake_config_) {
+			telemetry_providers_.push_back(pwr::PowerTelemetryProviderFactory::MakeFake(*fake_config_));
+		}
+		for (int iVendor = 0; iVendor < int(PM_DEVICE_VENDOR_UNKNOWN) && !fake_config_; iVendor++) {
 			try {
 				if (auto pProvider = pwr::PowerTelemetryProviderFactory::Make(
 					PM_DEVICE_VENDOR(iVendor))) {
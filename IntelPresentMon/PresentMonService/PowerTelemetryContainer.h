@@ -10,7 +10,13 @@ class PowerTelemetryContainer {
     return telemetry_adapters_;
   }
   bool Repopulate();
+  // generate synthetic telemetry in place of that of the adapters from the
+  // next Repopulate on
+  void SetFakeTelemetry(pwr::fake::FakeTelemetryConfig config) {
+    fake_config_ = std::move(config);
+  }
  private:
+  std::optional<pwr::fake::FakeTelemetryConfig> fake_config_;
   std::vector<std::unique_ptr<pwr::PowerTelemetryProvider>> telemetry_providers_;
   std::vector<std::shared_ptr<pwr::PowerTelemetryAdapter>> telemetry_adapters_;
 };
\ No newline at end of file
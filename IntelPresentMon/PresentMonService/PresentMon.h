@@ -47,6 +47,23 @@ public:
 		// Only the real time trace sets ETW flush period
 		return pSession_->GetEtwFlushPeriod();
 	}
+	void SetTelemetryDemand(const std::optional<GpuTelemetryBitset>& gpuCaps,
+		const std::optional<CpuTelemetryBitset>& cpuCaps)
+	{
+		pSession_->SetTelemetryDemand(gpuCaps, cpuCaps);
+	}
+	pwr::GpuTelemetryScheduler& GetGpuTelemetryScheduler()
+	{
+		return pSession_->GetGpuTelemetryScheduler();
+	}
+	pwr::CpuTelemetryScheduler& GetCpuTelemetryScheduler()
+	{
+		return pSession_->GetCpuTelemetryScheduler();
+	}
+	bool IsFastPowerDemanded() const
+	{
+		return pSession_->IsFastPowerDemanded();
+	}
 	void SetCpu(const std::shared_ptr<pwr::cpu::CpuTelemetry>& pCpu)
 	{
 		// Only the real time trace uses the control libary interface
@@ -56,6 +56,8 @@ PM_STATUS PresentMonSession::SelectAdapter(uint32_t adapter_id) {
 PM_STATUS PresentMonSession::SetGpuTelemetryPeriod(std::optional<uint32_t> period_ms)
 {
     gpu_telemetry_period_ms_ = period_ms.value_or(default_gpu_telemetry_period_ms_);
+    gpu_telemetry_scheduler_.SetBasePeriod(gpu_telemetry_period_ms_ / 1000.);
+    cpu_telemetry_scheduler_.SetBasePeriod(gpu_telemetry_period_ms_ / 1000.);
     return PM_STATUS_SUCCESS;
 }
 
@@ -63,6 +65,33 @@ uint32_t PresentMonSession::GetGpuTelemetryPeriod() {
     return gpu_telemetry_period_ms_;
 }
 
+void PresentMonSession::SetTelemetryDemand(const std::optional<GpuTelemetryBitset>& gpu_caps,
+    const std::optional<CpuTelemetryBitset>& cpu_caps)
+{
+    // the per-frame energy is sampled by the fast power thread instead of at the scheduled periods; clients
+    // that do not state their demand predate it
+    auto scheduled_gpu_caps = gpu_caps;
+    fast_power_demanded_ = gpu_caps &&
+        gpu_caps->test(static_cast<size_t>(GpuTelemetryCapBits::gpu_frame_energy));
+    if (scheduled_gpu_caps) {
+        scheduled_gpu_caps->reset(static_cast<size_t>(GpuTelemetryCapBits::gpu_frame_energy));
+    }
+    gpu_telemetry_scheduler_.SetDemand(scheduled_gpu_caps);
+    cpu_telemetry_scheduler_.SetDemand(cpu_caps);
+}
+
+bool PresentMonSession::IsFastPowerDemanded() const {
+    return fast_power_demanded_;
+}
+
+pwr::GpuTelemetryScheduler& PresentMonSession::GetGpuTelemetryScheduler() {
+    return gpu_telemetry_scheduler_;
+}
+
+pwr::CpuTelemetryScheduler& PresentMonSession::GetCpuTelemetryScheduler() {
+    return cpu_telemetry_scheduler_;
+}
+
 PM_STATUS PresentMonSession::SetEtwFlushPeriod(std::optional<uint32_t> periodMs)
 {
     if (periodMs) {
@@ -10,6 +10,7 @@
 
 #include "../ControlLib/PowerTelemetryProvider.h"
 #include "../ControlLib/CpuTelemetry.h"
+#include "../ControlLib/TelemetryScheduler.h"
 #include "../Streamer/Streamer.h"
 #include "../../PresentData/PresentMonTraceConsumer.hpp"
 #include "../../PresentData/PresentMonTraceSession.hpp"
@@ -53,6 +54,13 @@ public:
     PM_STATUS SetEtwFlushPeriod(std::optional<uint32_t> periodMs);
     std::optional<uint32_t> GetEtwFlushPeriod();
     uint32_t GetGpuTelemetryPeriod();
+    // telemetry used by the clients, empty when a client might use any
+    void SetTelemetryDemand(const std::optional<GpuTelemetryBitset>& gpu_caps,
+        const std::optional<CpuTelemetryBitset>& cpu_caps);
+    pwr::GpuTelemetryScheduler& GetGpuTelemetryScheduler();
+    pwr::CpuTelemetryScheduler& GetCpuTelemetryScheduler();
+    // whether a client uses the per-frame gpu energy, which is sampled by the fast power thread
+    bool IsFastPowerDemanded() const;
     int GetActiveStreams();
     void SetPowerTelemetryContainer(PowerTelemetryContainer* ptc);
 
@@ -64,10 +72,16 @@ public:
     PowerTelemetryContainer* telemetry_container_ = nullptr;
 
     uint32_t current_telemetry_adapter_id_ = 0;
+    // interpolate telemetry at the present instead of taking the nearest sample
+    bool interpolate_telemetry_ = false;
 
     // Set the initial telemetry period to 16ms
     static constexpr uint32_t default_gpu_telemetry_period_ms_ = 16;
     uint32_t gpu_telemetry_period_ms_ = default_gpu_telemetry_period_ms_;
+    // when each kind of telemetry is sampled, at the telemetry period unless configured otherwise
+    pwr::GpuTelemetryScheduler gpu_telemetry_scheduler_{ default_gpu_telemetry_period_ms_ / 1000. };
+    pwr::CpuTelemetryScheduler cpu_telemetry_scheduler_{ default_gpu_telemetry_period_ms_ / 1000. };
+    std::atomic<bool> fast_power_demanded_ = false;
     // initial default etw flush period for realtime is 1000ms
     // realtime trace sessions always manually flush
     static constexpr uint32_t default_realtime_etw_flush_period_ms_ = 1000;
@@ -8,6 +8,8 @@
 #include "../CommonUtilities/Qpc.h"
 #include "../CommonUtilities/Exception.h"
 #include <shlwapi.h>
+#include <algorithm>
+#include <numeric>
 
 using namespace pmon;
 using namespace std::literals;
@@ -18,6 +20,7 @@ static const std::wstring kRealTimeSessionName = L"PMService";
 RealtimePresentMonSession::RealtimePresentMonSession()
 {
     ResetEtwFlushPeriod();
+    interpolate_telemetry_ = clio::Options::Get().interpolateTelemetry;
 }
 
 bool RealtimePresentMonSession::IsTraceSessionActive() {
@@ -233,7 +236,7 @@ void RealtimePresentMonSession::DequeueAnalyzedInfo(
 }
 
 void RealtimePresentMonSession::AddPresents(
-    std::vector<std::shared_ptr<PresentEvent>> const& presentEvents,
+    std::span<const std::shared_ptr<PresentEvent>> presentEvents,
     size_t* presentEventIndex, bool recording, bool checkStopQpc,
     uint64_t stopQpc, bool* hitStopQpc) {
     auto i = *presentEventIndex;
@@ -259,6 +262,7 @@ void RealtimePresentMonSession::AddPresents(
         }
     }
 
+    present_batch_.clear();
     for (auto n = presentEvents.size(); i < n; ++i) {
         auto& presentEvent = presentEvents[i];
         assert(presentEvent->IsCompleted);
@@ -280,34 +284,6 @@ void RealtimePresentMonSession::AddPresents(
             continue;
         }
 
-        PresentMonPowerTelemetryInfo power_telemetry = {};
-        std::bitset<static_cast<size_t>(GpuTelemetryCapBits::gpu_telemetry_count)>
-            gpu_telemetry_cap_bits = {};
-        if (telemetry_container_) {
-            auto current_adapters = telemetry_container_->GetPowerTelemetryAdapters();
-            if (current_adapters.size() != 0 &&
-                current_telemetry_adapter_id_ < current_adapters.size()) {
-                auto current_telemetry_adapter =
-                    current_adapters.at(current_telemetry_adapter_id_).get();
-                if (auto data = current_telemetry_adapter->GetClosest(
-                    presentEvent->PresentStartTime)) {
-                    power_telemetry = *data;
-                }
-                gpu_telemetry_cap_bits = current_telemetry_adapter
-                    ->GetPowerTelemetryCapBits();
-            }
-        }
-
-        CpuTelemetryInfo cpu_telemetry = {};
-        std::bitset<static_cast<size_t>(CpuTelemetryCapBits::cpu_telemetry_count)>
-            cpu_telemetry_cap_bits = {};
-        if (cpu_) {
-            if (auto data = cpu_->GetClosest(presentEvent->PresentStartTime)) {
-                cpu_telemetry = *data;
-            }
-            cpu_telemetry_cap_bits = cpu_->GetCpuTelemetryCapBits();
-        }
-
         auto result = processInfo->mSwapChain.emplace(
             presentEvent->SwapChainAddress, SwapChainData());
         auto chain = &result.first->second;
@@ -334,11 +310,11 @@ void RealtimePresentMonSession::AddPresents(
             }
         }
 
-        streamer_.ProcessPresentEvent(
-            presentEvent.get(), &power_telemetry, &cpu_telemetry,
+        // telemetry is attached to the whole batch at once below
+        present_batch_.push_back(StreamedPresent{
+            presentEvent.get(), nullptr, nullptr,
             chain->mLastPresentQPC, chain->mLastDisplayedPresentQPC,
-            processInfo->mModuleName, gpu_telemetry_cap_bits,
-            cpu_telemetry_cap_bits);
+            &processInfo->mModuleName });
 
         chain->mLastPresentQPC = presentEvent->PresentStartTime;
         if (presentEvent->FinalState == PresentResult::Presented) {
@@ -352,6 +328,80 @@ void RealtimePresentMonSession::AddPresents(
     }
 
     *presentEventIndex = i;
+    if (present_batch_.empty()) {
+        return;
+    }
+
+    std::bitset<static_cast<size_t>(GpuTelemetryCapBits::gpu_telemetry_count)>
+        gpu_telemetry_cap_bits = {};
+    if (telemetry_container_) {
+        auto current_adapters = telemetry_container_->GetPowerTelemetryAdapters();
+        if (current_adapters.size() != 0 &&
+            current_telemetry_adapter_id_ < current_adapters.size()) {
+            gpu_telemetry_cap_bits = current_adapters.at(current_telemetry_adapter_id_)
+                ->GetPowerTelemetryCapBits();
+        }
+    }
+    std::bitset<static_cast<size_t>(CpuTelemetryCapBits::cpu_telemetry_count)>
+        cpu_telemetry_cap_bits = {};
+    if (cpu_) {
+        cpu_telemetry_cap_bits = cpu_->GetCpuTelemetryCapBits();
+    }
+
+    AttachTelemetry();
+    streamer_.ProcessPresentEvents(present_batch_, gpu_telemetry_cap_bits,
+        cpu_telemetry_cap_bits);
+}
+
+void RealtimePresentMonSession::AttachTelemetry() {
+    const auto n = present_batch_.size();
+    auto QpcOf = [this](uint32_t i) {
+        return present_batch_[i].present_event->PresentStartTime;
+    };
+
+    // presents come out sorted per swap chain, so the batch is often sorted
+    // already; otherwise sort it by qpc to merge it with the histories
+    batch_order_.resize(n);
+    std::iota(batch_order_.begin(), batch_order_.end(), 0u);
+    if (!std::is_sorted(batch_order_.begin(), batch_order_.end(),
+        [&](uint32_t a, uint32_t b) { return QpcOf(a) < QpcOf(b); })) {
+        std::stable_sort(batch_order_.begin(), batch_order_.end(),
+            [&](uint32_t a, uint32_t b) { return QpcOf(a) < QpcOf(b); });
+    }
+    batch_qpcs_.resize(n);
+    for (size_t k = 0; k < n; ++k) {
+        batch_qpcs_[k] = QpcOf(batch_order_[k]);
+    }
+
+    batch_power_telemetry_.assign(n, PresentMonPowerTelemetryInfo{});
+    if (telemetry_container_) {
+        auto current_adapters = telemetry_container_->GetPowerTelemetryAdapters();
+        if (current_adapters.size() != 0 &&
+            current_telemetry_adapter_id_ < current_adapters.size()) {
+            auto& adapter = current_adapters.at(current_telemetry_adapter_id_);
+            adapter->GetTelemetry(batch_qpcs_, batch_power_telemetry_, interpolate_telemetry_);
+            // a frame's energy is integrated from the previous present of its swap chain to its own
+            if (fast_power_demanded_) {
+                for (size_t k = 0; k < n; ++k) {
+                    const auto& present = present_batch_[batch_order_[k]];
+                    if (auto frame = adapter->GetFrameEnergy(present.last_present_qpc, batch_qpcs_[k])) {
+                        batch_power_telemetry_[k].gpu_frame_energy_j = frame->energy_j;
+                        batch_power_telemetry_[k].gpu_frame_power_w = frame->power_w;
+                    }
+                }
+            }
+        }
+    }
+    batch_cpu_telemetry_.assign(n, CpuTelemetryInfo{});
+    if (cpu_) {
+        cpu_->GetTelemetry(batch_qpcs_, batch_cpu_telemetry_, interpolate_telemetry_);
+    }
+
+    for (size_t k = 0; k < n; ++k) {
+        auto& present = present_batch_[batch_order_[k]];
+        present.power_telemetry_info = &batch_power_telemetry_[k];
+        present.cpu_telemetry_info = &batch_cpu_telemetry_[k];
+    }
 }
 
 void RealtimePresentMonSession::ProcessEvents(
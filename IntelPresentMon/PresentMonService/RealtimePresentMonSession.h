@@ -29,10 +29,15 @@ private:
     void DequeueAnalyzedInfo(
         std::vector<ProcessEvent>* processEvents,
         std::vector<std::shared_ptr<PresentEvent>>* presentEvents);
+    // Streams the presents from *presentEventIndex on, up to stopQpc if
+    // checkStopQpc, as one batch (see AttachTelemetry)
     void AddPresents(
-        std::vector<std::shared_ptr<PresentEvent>> const& presentEvents,
+        std::span<const std::shared_ptr<PresentEvent>> presentEvents,
         size_t* presentEventIndex, bool recording, bool checkStopQpc,
         uint64_t stopQpc, bool* hitStopQpc);
+    // Attaches telemetry to every present of the batch, looked up in a single
+    // sweep of each telemetry history in qpc order
+    void AttachTelemetry();
     void ProcessEvents(
         std::vector<ProcessEvent>* processEvents,
         std::vector<std::shared_ptr<PresentEvent>>* presentEvents,
@@ -75,4 +80,12 @@ private:
     mutable std::mutex session_mutex_;
     mutable std::mutex process_mutex_;
     std::atomic<bool> session_active_{false};  // Lock-free session state for hot path queries
+
+    // Batch of presents being streamed by AddPresents, and their telemetry in
+    // qpc order, kept to reuse their storage. Only used by the output thread.
+    std::vector<StreamedPresent> present_batch_;
+    std::vector<uint32_t> batch_order_;
+    std::vector<uint64_t> batch_qpcs_;
+    std::vector<PresentMonPowerTelemetryInfo> batch_power_telemetry_;
+    std::vector<CpuTelemetryInfo> batch_cpu_telemetry_;
 };
\ No newline at end of file
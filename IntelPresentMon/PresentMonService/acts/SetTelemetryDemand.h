@@ -0,0 +1,59 @@
+#pragma once
+#include "../../Interprocess/source/act/ActionHelper.h"
+#include <format>
+#include <ranges>
+
+#define ACT_NAME SetTelemetryDemand
+#define ACT_EXEC_CTX ActionExecutionContext
+#define ACT_NS ::pmon::svc::acts
+#define ACT_TYPE AsyncActionBase_
+
+namespace pmon::svc::acts
+{
+	using namespace ipc::act;
+	namespace rn = std::ranges;
+	namespace vi = rn::views;
+
+	class ACT_NAME : public ACT_TYPE<ACT_NAME, ACT_EXEC_CTX>
+	{
+	public:
+		static constexpr const char* Identifier = STRINGIFY(ACT_NAME);
+		struct Params
+		{
+			// bit i is set when the client has a query calculated from the telemetry of cap bit i
+			// (GpuTelemetryCapBits / CpuTelemetryCapBits)
+			uint64_t gpuTelemetryCaps;
+			uint64_t cpuTelemetryCaps;
+
+			template<class A> void serialize(A& ar) {
+				ar(gpuTelemetryCaps, cpuTelemetryCaps);
+			}
+		};
+		struct Response {};
+	private:
+		friend class ACT_TYPE<ACT_NAME, ACT_EXEC_CTX>;
+		static Response Execute_(const ACT_EXEC_CTX& ctx, SessionContext& stx, Params&& in)
+		{
+			// set demand of this session
+			stx.requestedGpuTelemetryCaps = GpuTelemetryBitset{ in.gpuTelemetryCaps };
+			stx.requestedCpuTelemetryCaps = CpuTelemetryBitset{ in.cpuTelemetryCaps };
+			// update the service
+			ctx.UpdateTelemetryDemand();
+
+			pmlog_dbg(std::format("Telemetry demand of gpu caps {:#x} cpu caps {:#x} by client [{}]",
+				in.gpuTelemetryCaps, in.cpuTelemetryCaps, stx.remotePid));
+			return {};
+		}
+	};
+
+#ifdef PM_ASYNC_ACTION_REGISTRATION_
+	ACTION_REG();
+#endif
+}
+
+ACTION_TRAITS_DEF();
+
+#undef ACT_NAME
+#undef ACT_EXEC_CTX
+#undef ACT_NS
+#undef ACT_TYPE
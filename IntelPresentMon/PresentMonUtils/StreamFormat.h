@@ -24,6 +24,24 @@
  // never show up in present mon for StreamAll and ETL PIDs
 enum class StreamPidOverride : uint32_t { kStreamAllPid = 0, kEtlPid = 4 };
 
+// A client registered to read the frame ring. Readers that register hold back the
+// writer of a backpressured ring (see NsmRing.h).
+struct NsmRingReaderSlot
+{
+	uint64_t owner;       // id of the reader, 0 when the slot is free
+	uint64_t next_frame;  // number of the next frame the reader will consume
+};
+static constexpr size_t kMaxNsmRingReaders = 16;
+
+// A client waiting for frames. The writer signals the waiter's event once
+// num_frames_written reaches wake_frame (see NsmRing.h).
+struct NsmFrameWaiterSlot
+{
+	uint64_t owner;       // id of the waiter, 0 when the slot is free
+	uint64_t wake_frame;  // frame count to wake the waiter at, 0 when not waiting
+};
+static constexpr size_t kMaxNsmFrameWaiters = 8;
+
 struct NamedSharedMemoryHeader
 {
 	NamedSharedMemoryHeader()
@@ -35,7 +53,10 @@ struct NamedSharedMemoryHeader
 		num_frames_written(0),
 		head_idx(0),
 		tail_idx(0),
-		process_active(true) {}
+		process_active(true),
+		slot_seq_offset(0),
+		qpc_index_offset(0),
+		qpc_index_entries(0) {}
 	// start QPC time of the very first frame recorderd after PmStartStream
 	char application[MAX_PATH] = {};
 	uint64_t start_qpc;
@@ -57,6 +78,14 @@ struct NamedSharedMemoryHeader
 	bool isPlaybackRetimed = false;
 	bool isPlaybackBackpressured = false;
 	bool isPlaybackResetOldest = false;
+	// offset from the start of the buffer of the per-slot sequence numbers
+	uint64_t slot_seq_offset;
+	// offset from the start of the buffer of the sparse PresentStartTime index, and its entry count
+	// (0 if the ring has none)
+	uint64_t qpc_index_offset;
+	uint64_t qpc_index_entries;
+	NsmRingReaderSlot readers[kMaxNsmRingReaders] = {};
+	NsmFrameWaiterSlot waiters[kMaxNsmFrameWaiters] = {};
 };
 
 struct PmNsmPresentEvent
@@ -0,0 +1,354 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#include "ColumnarSharedMemory.h"
+#include <sddl.h>
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <utility>
+
+#include "../CommonUtilities/log/GlogShim.h"
+
+namespace {
+
+#define NSM_COLUMN_FIELD(field) \
+    NsmColumnField{ NSM_COLUMN_OFFSET(field), \
+        static_cast<uint32_t>(sizeof(std::declval<PmNsmFrameData&>().field)), #field }
+
+const NsmColumnField kColumnFields[] = {
+    NSM_COLUMN_FIELD(present_event.PresentStartTime),
+    NSM_COLUMN_FIELD(present_event.ProcessId),
+    NSM_COLUMN_FIELD(present_event.ThreadId),
+    NSM_COLUMN_FIELD(present_event.TimeInPresent),
+    NSM_COLUMN_FIELD(present_event.GPUStartTime),
+    NSM_COLUMN_FIELD(present_event.ReadyTime),
+    NSM_COLUMN_FIELD(present_event.GPUDuration),
+    NSM_COLUMN_FIELD(present_event.GPUVideoDuration),
+    NSM_COLUMN_FIELD(present_event.InputTime),
+    NSM_COLUMN_FIELD(present_event.MouseClickTime),
+    NSM_COLUMN_FIELD(present_event.AppPropagatedPresentStartTime),
+    NSM_COLUMN_FIELD(present_event.AppPropagatedTimeInPresent),
+    NSM_COLUMN_FIELD(present_event.AppPropagatedGPUStartTime),
+    NSM_COLUMN_FIELD(present_event.AppPropagatedReadyTime),
+    NSM_COLUMN_FIELD(present_event.AppPropagatedGPUDuration),
+    NSM_COLUMN_FIELD(present_event.AppPropagatedGPUVideoDuration),
+    NSM_COLUMN_FIELD(present_event.AppSleepStartTime),
+    NSM_COLUMN_FIELD(present_event.AppSleepEndTime),
+    NSM_COLUMN_FIELD(present_event.AppSimStartTime),
+    NSM_COLUMN_FIELD(present_event.AppSimEndTime),
+    NSM_COLUMN_FIELD(present_event.AppRenderSubmitStartTime),
+    NSM_COLUMN_FIELD(present_event.AppRenderSubmitEndTime),
+    NSM_COLUMN_FIELD(present_event.AppPresentStartTime),
+    NSM_COLUMN_FIELD(present_event.AppPresentEndTime),
+    NSM_COLUMN_FIELD(present_event.AppInputTime),
+    NSM_COLUMN_FIELD(present_event.AppInputType),
+    NSM_COLUMN_FIELD(present_event.PclInputPingTime),
+    NSM_COLUMN_FIELD(present_event.PclSimStartTime),
+    NSM_COLUMN_FIELD(present_event.FlipDelay),
+    NSM_COLUMN_FIELD(present_event.FlipToken),
+    NSM_COLUMN_FIELD(present_event.SwapChainAddress),
+    NSM_COLUMN_FIELD(present_event.SyncInterval),
+    NSM_COLUMN_FIELD(present_event.PresentFlags),
+    NSM_COLUMN_FIELD(present_event.Displayed_ScreenTime),
+    NSM_COLUMN_FIELD(present_event.Displayed_FrameType),
+    NSM_COLUMN_FIELD(present_event.DisplayedCount),
+    NSM_COLUMN_FIELD(present_event.CompositionSurfaceLuid),
+    NSM_COLUMN_FIELD(present_event.Win32KPresentCount),
+    NSM_COLUMN_FIELD(present_event.Win32KBindId),
+    NSM_COLUMN_FIELD(present_event.DxgkPresentHistoryToken),
+    NSM_COLUMN_FIELD(present_event.DxgkPresentHistoryTokenData),
+    NSM_COLUMN_FIELD(present_event.DxgkContext),
+    NSM_COLUMN_FIELD(present_event.Hwnd),
+    NSM_COLUMN_FIELD(present_event.QueueSubmitSequence),
+    NSM_COLUMN_FIELD(present_event.RingIndex),
+    NSM_COLUMN_FIELD(present_event.DestWidth),
+    NSM_COLUMN_FIELD(present_event.DestHeight),
+    NSM_COLUMN_FIELD(present_event.DriverThreadId),
+    NSM_COLUMN_FIELD(present_event.FrameId),
+    NSM_COLUMN_FIELD(present_event.Runtime),
+    NSM_COLUMN_FIELD(present_event.PresentMode),
+    NSM_COLUMN_FIELD(present_event.FinalState),
+    NSM_COLUMN_FIELD(present_event.InputType),
+    NSM_COLUMN_FIELD(present_event.FrameType),
+    NSM_COLUMN_FIELD(present_event.SupportsTearing),
+    NSM_COLUMN_FIELD(present_event.WaitForFlipEvent),
+    NSM_COLUMN_FIELD(present_event.WaitForMPOFlipEvent),
+    NSM_COLUMN_FIELD(present_event.SeenDxgkPresent),
+    NSM_COLUMN_FIELD(present_event.SeenWin32KEvents),
+    NSM_COLUMN_FIELD(present_event.SeenInFrameEvent),
+    NSM_COLUMN_FIELD(present_event.GpuFrameCompleted),
+    NSM_COLUMN_FIELD(present_event.IsCompleted),
+    NSM_COLUMN_FIELD(present_event.IsLost),
+    NSM_COLUMN_FIELD(present_event.PresentInDwmWaitingStruct),
+    NSM_COLUMN_FIELD(present_event.last_present_qpc),
+    NSM_COLUMN_FIELD(present_event.last_displayed_qpc),
+    NSM_COLUMN_FIELD(present_event.application),
+    NSM_COLUMN_FIELD(power_telemetry.qpc),
+    NSM_COLUMN_FIELD(power_telemetry.time_stamp),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_power_w),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_sustained_power_limit_w),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_voltage_v),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_frequency_mhz),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_temperature_c),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_utilization),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_render_compute_utilization),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_media_utilization),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_effective_frequency_mhz),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_voltage_regulator_temperature_c),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_mem_effective_bandwidth_gbps),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_overvoltage_percent),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_temperature_percent),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_power_percent),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_card_power_w),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_frame_energy_j),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_frame_power_w),
+    NSM_COLUMN_FIELD(power_telemetry.vram_power_w),
+    NSM_COLUMN_FIELD(power_telemetry.vram_voltage_v),
+    NSM_COLUMN_FIELD(power_telemetry.vram_frequency_mhz),
+    NSM_COLUMN_FIELD(power_telemetry.vram_effective_frequency_gbps),
+    NSM_COLUMN_FIELD(power_telemetry.vram_temperature_c),
+    NSM_COLUMN_FIELD(power_telemetry.fan_speed_rpm),
+    NSM_COLUMN_FIELD(power_telemetry.max_fan_speed_rpm),
+    NSM_COLUMN_FIELD(power_telemetry.psu),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_mem_total_size_b),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_mem_used_b),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_mem_max_bandwidth_bps),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_mem_write_bandwidth_bps),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_mem_read_bandwidth_bps),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_power_limited),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_temperature_limited),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_current_limited),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_voltage_limited),
+    NSM_COLUMN_FIELD(power_telemetry.gpu_utilization_limited),
+    NSM_COLUMN_FIELD(power_telemetry.vram_power_limited),
+    NSM_COLUMN_FIELD(power_telemetry.vram_temperature_limited),
+    NSM_COLUMN_FIELD(power_telemetry.vram_current_limited),
+    NSM_COLUMN_FIELD(power_telemetry.vram_voltage_limited),
+    NSM_COLUMN_FIELD(power_telemetry.vram_utilization_limited),
+    NSM_COLUMN_FIELD(cpu_telemetry.qpc),
+    NSM_COLUMN_FIELD(cpu_telemetry.cpu_utilization),
+    NSM_COLUMN_FIELD(cpu_telemetry.cpu_power_w),
+    NSM_COLUMN_FIELD(cpu_telemetry.cpu_power_limit_w),
+    NSM_COLUMN_FIELD(cpu_telemetry.cpu_temperature),
+    NSM_COLUMN_FIELD(cpu_telemetry.cpu_frequency),
+};
+
+#undef NSM_COLUMN_FIELD
+
+template<typename T, typename U = T>
+constexpr T align(T what, U to) {
+    return (what + to - 1) & ~(to - 1);
+}
+
+// Offset of the first column, which follows the header and schema
+uint64_t GetFirstColumnOffset(uint32_t column_count) {
+    return align(sizeof(NsmColumnarHeader) + column_count * sizeof(NsmColumnDescriptor), kNsmColumnAlignment);
+}
+
+}  // namespace
+
+std::span<const NsmColumnField> GetNsmColumnFields() {
+    return kColumnFields;
+}
+
+uint64_t ColumnarFrameWriter::GetRequiredSize(uint64_t capacity) {
+    uint64_t size = GetFirstColumnOffset((uint32_t)std::size(kColumnFields));
+    for (auto& field : kColumnFields) {
+        size = align(size + capacity * field.size, kNsmColumnAlignment);
+    }
+    return size;
+}
+
+ColumnarFrameWriter::ColumnarFrameWriter(void* block, uint64_t capacity)
+    : header_(static_cast<NsmColumnarHeader*>(block)) {
+    const auto column_count = (uint32_t)std::size(kColumnFields);
+    header_->magic = NSM_COLUMNAR_MAGIC;
+    header_->version = NSM_COLUMNAR_VERSION;
+    header_->column_count = column_count;
+    header_->row_size = sizeof(PmNsmFrameData);
+    header_->capacity = capacity;
+    header_->sequence.store(0, std::memory_order_relaxed);
+    header_->process_active = true;
+
+    auto descriptors = reinterpret_cast<NsmColumnDescriptor*>(header_ + 1);
+    uint64_t data_offset = GetFirstColumnOffset(column_count);
+    columns_.reserve(column_count);
+    for (uint32_t i = 0; i < column_count; i++) {
+        const auto& field = kColumnFields[i];
+        descriptors[i] = { field.source_offset, field.size, data_offset };
+        columns_.push_back({ field.source_offset, field.size, static_cast<uint8_t*>(block) + data_offset });
+        data_offset = align(data_offset + capacity * field.size, kNsmColumnAlignment);
+    }
+    header_->total_size = data_offset;
+}
+
+void ColumnarFrameWriter::WriteFrameData(const PmNsmFrameData& data) {
+    const auto row = header_->sequence.load(std::memory_order_relaxed);
+    // The slot being written belongs to the oldest row, which readers stop trusting as soon as they
+    // see the current sequence, so the column writes must not become visible before it
+    std::atomic_thread_fence(std::memory_order_release);
+    const auto slot = row % header_->capacity;
+    const auto source = reinterpret_cast<const uint8_t*>(&data);
+    for (auto& column : columns_) {
+        std::memcpy(column.data + slot * column.element_size, source + column.source_offset, column.element_size);
+    }
+    header_->sequence.store(row + 1, std::memory_order_release);
+}
+
+void ColumnarFrameWriter::NotifyProcessKilled() {
+    header_->process_active = false;
+}
+
+bool ColumnarFrameReader::Open(const void* header_block) {
+    header_ = static_cast<const NsmColumnarHeader*>(header_block);
+    descriptors_.clear();
+    column_data_.clear();
+    if (header_->magic != NSM_COLUMNAR_MAGIC || header_->version != NSM_COLUMNAR_VERSION ||
+        header_->row_size != sizeof(PmNsmFrameData) || header_->capacity == 0) {
+        LOG(ERROR) << "Not a compatible columnar frame stream.";
+        header_ = nullptr;
+        return false;
+    }
+    auto descriptors = reinterpret_cast<const NsmColumnDescriptor*>(header_ + 1);
+    descriptors_.assign(descriptors, descriptors + header_->column_count);
+    column_data_.resize(header_->column_count, nullptr);
+    return true;
+}
+
+void ColumnarFrameReader::AttachColumn(int column, const void* data) {
+    column_data_[column] = static_cast<const uint8_t*>(data);
+}
+
+void ColumnarFrameReader::AttachAllColumns(const void* block) {
+    for (int i = 0; i < GetColumnCount(); i++) {
+        AttachColumn(i, static_cast<const uint8_t*>(block) + descriptors_[i].data_offset);
+    }
+}
+
+int ColumnarFrameReader::FindColumn(uint32_t source_offset) const {
+    for (int i = 0; i < GetColumnCount(); i++) {
+        const auto& descriptor = descriptors_[i];
+        if (source_offset >= descriptor.source_offset &&
+            source_offset < descriptor.source_offset + descriptor.element_size) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ColumnarFrameReader::GatherRow(uint64_t row, PmNsmFrameData& frame) const {
+    const auto slot = row % header_->capacity;
+    const auto dest = reinterpret_cast<uint8_t*>(&frame);
+    for (size_t i = 0; i < descriptors_.size(); i++) {
+        if (const auto data = column_data_[i]) {
+            const auto& descriptor = descriptors_[i];
+            std::memcpy(dest + descriptor.source_offset, data + slot * descriptor.element_size,
+                descriptor.element_size);
+        }
+    }
+}
+
+ColumnarSharedMem::~ColumnarSharedMem() {
+    if (writer_) {
+        writer_->NotifyProcessKilled();
+        writer_.reset();
+    }
+    for (auto view : views_) {
+        UnmapViewOfFile(view);
+    }
+    if (mapfile_handle_ != NULL) {
+        CloseHandle(mapfile_handle_);
+    }
+}
+
+void* ColumnarSharedMem::MapView(DWORD access, uint64_t offset, uint64_t size) {
+    auto view = MapViewOfFile(mapfile_handle_, access,
+        DWORD(offset >> 32), DWORD(offset & 0xFFFFFFFF), (SIZE_T)size);
+    if (view == NULL) {
+        LOG(ERROR) << "Could not map view of columnar stream. Error code: " << GetLastError();
+        return nullptr;
+    }
+    views_.push_back(view);
+    return view;
+}
+
+bool ColumnarSharedMem::Create(std::string mapfile_name, uint64_t capacity) {
+    mapfile_name_ = std::move(mapfile_name);
+    const auto size = ColumnarFrameWriter::GetRequiredSize(capacity);
+
+    // same security as NamedSharedMem, so that the clients that can read one can read the other
+    SECURITY_ATTRIBUTES sa = { sizeof(sa) };
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(L"D:PNO_ACCESS_CONTROLS:(ML;;NW;;;LW)",
+        SDDL_REVISION_1, &sa.lpSecurityDescriptor, NULL)) {
+        LOG(ERROR) << "Failed to set security. Error code: " << GetLastError();
+        return false;
+    }
+    mapfile_handle_ = CreateFileMappingA(INVALID_HANDLE_VALUE, &sa, PAGE_READWRITE,
+        DWORD(size >> 32), DWORD(size & 0xFFFFFFFF), mapfile_name_.c_str());
+    LocalFree(sa.lpSecurityDescriptor);
+    if (mapfile_handle_ == NULL) {
+        LOG(ERROR) << "Could not create columnar stream mapping. Error code: " << GetLastError();
+        return false;
+    }
+
+    // a new paging file backed mapping is zero filled
+    const auto block = MapView(FILE_MAP_ALL_ACCESS, 0, size);
+    if (block == nullptr) {
+        return false;
+    }
+    writer_.emplace(block, capacity);
+    reader_.Open(block);
+    reader_.AttachAllColumns(block);
+    try {
+        LOG(INFO) << std::format("Columnar stream {} initialized with {} rows of {} columns.",
+            mapfile_name_, capacity, reader_.GetColumnCount());
+    } catch (...) {}
+    return true;
+}
+
+bool ColumnarSharedMem::Open(std::string mapfile_name, std::span<const uint32_t> source_offsets) {
+    mapfile_name_ = std::move(mapfile_name);
+    mapfile_handle_ = OpenFileMappingA(FILE_MAP_READ, FALSE, mapfile_name_.c_str());
+    if (mapfile_handle_ == NULL) {
+        // the service only publishes the stream when asked to (--enable-columnar-nsm)
+        LOG(INFO) << "Could not open columnar stream mapping. Error code: " << GetLastError();
+        return false;
+    }
+
+    // the header and schema are always within the first alignment unit
+    const auto header_block = MapView(FILE_MAP_READ, 0, kNsmColumnAlignment);
+    if (header_block == nullptr || !reader_.Open(header_block)) {
+        return false;
+    }
+
+    // map each requested column on its own, unless there is nothing to save by doing so
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    if (source_offsets.empty() || kNsmColumnAlignment % system_info.dwAllocationGranularity) {
+        const auto block = MapView(FILE_MAP_READ, 0,
+            static_cast<const NsmColumnarHeader*>(header_block)->total_size);
+        if (block == nullptr) {
+            return false;
+        }
+        reader_.AttachAllColumns(block);
+        return true;
+    }
+    for (auto source_offset : source_offsets) {
+        const auto column = reader_.FindColumn(source_offset);
+        if (column < 0) {
+            LOG(ERROR) << "Columnar stream does not publish field at offset " << source_offset;
+            return false;
+        }
+        if (reader_.IsColumnAttached(column)) {
+            continue;
+        }
+        const auto& descriptor = reader_.GetColumnDescriptor(column);
+        const auto data = MapView(FILE_MAP_READ, descriptor.data_offset,
+            reader_.GetCapacity() * descriptor.element_size);
+        if (data == nullptr) {
+            return false;
+        }
+        reader_.AttachColumn(column, data);
+    }
+    return true;
+}
@@ -0,0 +1,190 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../PresentMonUtils/StreamFormat.h"
+
+// -------------------------------------------------------------------------------------------------
+// Columnar frame stream
+//
+// An alternative layout of the frame data circular buffer, published by the service alongside
+// the NamedSharedMem ring. Instead of whole PmNsmFrameData records, every field is stored in its
+// own column ring, so a client only touches (and only needs to map) the fields it reads:
+//
+//     NsmColumnarHeader
+//     NsmColumnDescriptor                  (x column_count; the published schema)
+//     column data                          (x column_count; each on a kNsmColumnAlignment boundary)
+//
+// Row n of the stream is held in slot n % capacity of every column. The writer fills in a row's
+// slot in every column and then increments the shared sequence counter, so once sequence is
+// greater than n, row n is complete. While row n is being written, the slot of row n - capacity
+// is being overwritten, so of the rows written only [sequence - capacity + 1, sequence) can be
+// read. Readers read the sequence, read the rows they want (directly from the column data), and
+// then check with IsRowIntact() that the writer has not come around to the oldest of them.
+//
+// Columns are identified by the offset and size of their field in PmNsmFrameData (see
+// NSM_COLUMN_OFFSET), and a client looks up the fields it reads in the schema, so the set of
+// fields published can change without a version bump. Clients only open streams written with
+// their own PmNsmFrameData, as rows are gathered back into one. Values that apply to the whole
+// stream (start qpc, telemetry caps) stay in the NamedSharedMem header.
+
+#define NSM_COLUMNAR_MAGIC    0x4E434D50u // 'PMCN'
+#define NSM_COLUMNAR_VERSION  1u
+
+// Offset of a (possibly nested) field of PmNsmFrameData, e.g.
+// NSM_COLUMN_OFFSET(present_event.PresentStartTime)
+#define NSM_COLUMN_OFFSET(field) static_cast<uint32_t>(offsetof(PmNsmFrameData, field))
+
+// Columns start on the allocation granularity so that each one can be mapped on its own
+static const uint64_t kNsmColumnAlignment = 65536;
+// Suffix appended to the NamedSharedMem map file name to name the columnar stream
+static const std::string kColumnarSuffix = "_Columns";
+
+struct NsmColumnarHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t column_count;
+  uint32_t row_size;            // sizeof(PmNsmFrameData) of the writer
+  uint64_t capacity;            // rows per column ring
+  uint64_t total_size;          // bytes from the start of the header to the end of the last column
+  std::atomic<uint64_t> sequence;  // number of rows written
+  bool process_active;
+};
+
+struct NsmColumnDescriptor {
+  uint32_t source_offset;       // offset of the field in PmNsmFrameData
+  uint32_t element_size;        // size of the field
+  uint64_t data_offset;         // offset of the column's data from the start of the header
+};
+
+// A field of PmNsmFrameData that is published as a column
+struct NsmColumnField {
+  uint32_t source_offset;
+  uint32_t size;
+  const char* name;
+};
+
+// The fields published as columns, in column order
+std::span<const NsmColumnField> GetNsmColumnFields();
+
+// Lays out a columnar stream in a block of memory and appends frames to it. The block is usually
+// the view of a ColumnarSharedMem.
+class ColumnarFrameWriter {
+ public:
+  // Bytes needed for a stream of capacity rows
+  static uint64_t GetRequiredSize(uint64_t capacity);
+
+  // Initializes the header and schema in block, which must be at least GetRequiredSize(capacity)
+  // bytes and zero initialized
+  ColumnarFrameWriter(void* block, uint64_t capacity);
+  ColumnarFrameWriter(const ColumnarFrameWriter&) = delete;
+  ColumnarFrameWriter& operator=(const ColumnarFrameWriter&) = delete;
+
+  void WriteFrameData(const PmNsmFrameData& data);
+  void NotifyProcessKilled();
+  NsmColumnarHeader* GetHeader() { return header_; }
+
+ private:
+  struct Column {
+    uint32_t source_offset;
+    uint32_t element_size;
+    uint8_t* data;
+  };
+  NsmColumnarHeader* header_;
+  std::vector<Column> columns_;
+};
+
+// Reads rows of a columnar stream. Only the columns that have been attached can be read, and the
+// data returned points directly into the column rings, so copy it out (see GatherRow) before the
+// writer can come around to it.
+class ColumnarFrameReader {
+ public:
+  // Read the header and schema, which must be in header_block. Returns false if it does not hold
+  // a compatible columnar stream.
+  bool Open(const void* header_block);
+  // Attach a column's data (for example from a view that maps only that column)
+  void AttachColumn(int column, const void* data);
+  // Attach every column, when the whole stream is in block
+  void AttachAllColumns(const void* block);
+
+  // Index of the column holding the field at source_offset (see NSM_COLUMN_OFFSET), or -1 if the
+  // stream does not publish it. The offset may be anywhere in the field, e.g. an array element.
+  int FindColumn(uint32_t source_offset) const;
+  int GetColumnCount() const { return (int)descriptors_.size(); }
+  const NsmColumnDescriptor& GetColumnDescriptor(int column) const { return descriptors_[column]; }
+  bool IsColumnAttached(int column) const { return column_data_[column] != nullptr; }
+
+  uint64_t GetCapacity() const { return header_->capacity; }
+  bool IsProcessActive() const { return header_->process_active; }
+  // Number of rows written so far; rows before this are complete
+  uint64_t GetSequence() const { return header_->sequence.load(std::memory_order_acquire); }
+  // Oldest row that can be read when sequence rows have been written
+  uint64_t GetOldestReadableRow(uint64_t sequence) const {
+    return sequence >= header_->capacity ? sequence - header_->capacity + 1 : 0;
+  }
+  // Check, after reading, that rows from row on were not overwritten while they were being read
+  bool IsRowIntact(uint64_t row) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return row >= GetOldestReadableRow(GetSequence());
+  }
+
+  // The value of a column for a row. T must be the type of the column's field.
+  template<typename T>
+  const T& Get(int column, uint64_t row) const {
+    return reinterpret_cast<const T*>(column_data_[column])[row % header_->capacity];
+  }
+  // The values of a column for the rows in [first_row, end_row), up to where the ring wraps. The
+  // span is shorter than requested when the range wraps; read the rest starting from the end of
+  // the span.
+  template<typename T>
+  std::span<const T> GetRows(int column, uint64_t first_row, uint64_t end_row) const {
+    const auto slot = first_row % header_->capacity;
+    const auto count = (std::min)(end_row - first_row, header_->capacity - slot);
+    return { reinterpret_cast<const T*>(column_data_[column]) + slot, (size_t)count };
+  }
+
+  // Copy the attached columns of a row into their fields of frame; the other fields are left as
+  // they are. Check IsRowIntact(row) afterwards.
+  void GatherRow(uint64_t row, PmNsmFrameData& frame) const;
+
+ private:
+  const NsmColumnarHeader* header_ = nullptr;
+  std::vector<NsmColumnDescriptor> descriptors_;
+  std::vector<const uint8_t*> column_data_;
+};
+
+// The named shared memory that holds a columnar stream. The service creates it and writes frames
+// through GetWriter(); clients open it mapping only the columns they need.
+class ColumnarSharedMem {
+ public:
+  ColumnarSharedMem() = default;
+  ~ColumnarSharedMem();
+  ColumnarSharedMem(const ColumnarSharedMem&) = delete;
+  ColumnarSharedMem& operator=(const ColumnarSharedMem&) = delete;
+
+  // Server: create the stream with room for capacity rows
+  bool Create(std::string mapfile_name, uint64_t capacity);
+  // Client: open the stream, mapping the columns of the fields at source_offsets (or every column
+  // if source_offsets is empty)
+  bool Open(std::string mapfile_name, std::span<const uint32_t> source_offsets = {});
+
+  ColumnarFrameWriter* GetWriter() { return writer_ ? &*writer_ : nullptr; }
+  const ColumnarFrameReader& GetReader() const { return reader_; }
+  std::string GetMapFileName() const { return mapfile_name_; }
+
+ private:
+  void* MapView(DWORD access, uint64_t offset, uint64_t size);
+  std::string mapfile_name_;
+  HANDLE mapfile_handle_ = NULL;
+  std::vector<void*> views_;
+  std::optional<ColumnarFrameWriter> writer_;
+  ColumnarFrameReader reader_;
+};
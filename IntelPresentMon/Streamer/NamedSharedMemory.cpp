@@ -1,5 +1,6 @@
 // Copyright (C) 2022 Intel Corporation
 // SPDX-License-Identifier: MIT
+#include <algorithm>
 #include <format>
 #include "NamedSharedMemory.h"
 #include <sddl.h>
@@ -18,7 +19,6 @@ NamedSharedMem::NamedSharedMem()
       data_offset_base_(sizeof(NamedSharedMemoryHeader)),
       header_(NULL),
       buf_(NULL),
-      alloc_granularity_(0),
       refcount_(0),
       buf_created_(false),
       buf_size_(0){};
@@ -34,16 +34,10 @@ NamedSharedMem::NamedSharedMem(std::string mapfile_name, uint64_t buf_size,
       data_offset_base_(sizeof(NamedSharedMemoryHeader)),
       header_(NULL),
       buf_(NULL),
-      alloc_granularity_(0),
       refcount_(0),
       buf_created_(false),
       buf_size_(0) {
 
-    SYSTEM_INFO system_info;
-    GetSystemInfo(&system_info);
-    
-    alloc_granularity_ = system_info.dwAllocationGranularity;
-
     CreateSharedMem(std::move(mapfile_name), buf_size);
 
     header_->isPlayback = isPlayback;
@@ -123,9 +117,6 @@ HRESULT NamedSharedMem::CreateSharedMem(std::string mapfile_name, uint64_t buf_s
     // Populate header info
     memset(buf_, 0, buf_size);
 
-    UnmapViewOfFile(buf_);
-    buf_ = NULL;
-    
     // Always map header
     header_ = static_cast<NamedSharedMemoryHeader*>(MapViewOfFile(mapfile_handle_,   // handle to map object
         FILE_MAP_ALL_ACCESS, // write permission
@@ -139,7 +130,7 @@ HRESULT NamedSharedMem::CreateSharedMem(std::string mapfile_name, uint64_t buf_s
         return E_FAIL;
     }
 
-    header_->max_entries = (buf_size - sizeof(NamedSharedMemoryHeader)) / sizeof(PmNsmFrameData);
+    NsmRingWriter::InitializeLayout(header_, buf_size);
     header_->current_write_offset = data_offset_base_;
     header_->buf_size = buf_size;
     header_->process_active = true;
@@ -157,6 +148,10 @@ HRESULT NamedSharedMem::CreateSharedMem(std::string mapfile_name, uint64_t buf_s
       LOG(INFO) << "Shared mem initialized";
     }
 
+    // the service keeps the whole buffer mapped for writing frames
+    ring_writer_.emplace(header_, buf_);
+    CreateFrameWaiterEvents();
+
     refcount_++;
     buf_created_ = true;
     buf_size_ = buf_size;
@@ -215,82 +210,224 @@ void NamedSharedMem::OpenSharedMemView(std::string mapfile_name)
     if (buf_ == NULL) {
         OutputErrorLog("Could not map view of file. Error code: ",
                        GetLastError());
+        return;
+    }
+
+    ring_reader_.emplace(header_, buf_);
+
+    // The history is optional, so not finding it is not an error
+    history_handle_ = OpenFileMapping(FILE_MAP_READ, FALSE,
+        (mapfile_name + kHistorySuffix).c_str());
+    if (history_handle_ != NULL) {
+        history_buf_ = MapViewOfFile(history_handle_, FILE_MAP_READ, 0, 0, 0);
+        if (history_buf_ == NULL || !history_reader_.Open(history_buf_)) {
+            LOG(INFO) << "Could not open frame history of " << mapfile_name;
+        }
+    }
+
+    // Only the service writes to the metric cache
+    metric_cache_handle_ = OpenFileMapping(FILE_MAP_READ, FALSE,
+        (mapfile_name + kMetricCacheSuffix).c_str());
+    if (metric_cache_handle_ != NULL) {
+        metric_cache_buf_ = MapViewOfFile(metric_cache_handle_, FILE_MAP_READ, 0, 0, 0);
+        if (metric_cache_buf_ == NULL || !metric_cache_.Open(metric_cache_buf_)) {
+            LOG(INFO) << "Could not open metric cache of " << mapfile_name;
+        }
     }
 }
 
+void NamedSharedMem::CreateFrameWaiterEvents()
+{
+    SECURITY_ATTRIBUTES sa = { sizeof(sa) };
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(L"D:PNO_ACCESS_CONTROLS:(ML;;NW;;;LW)",
+        SDDL_REVISION_1, &sa.lpSecurityDescriptor, NULL))
+    {
+        OutputErrorLog("Failed to set security. Error code: ", GetLastError());
+        return;
+    }
+    // auto reset, so that a waiter consumes its wake up
+    for (size_t i = 0; i < kMaxNsmFrameWaiters; i++) {
+        const auto name = mapfile_name_ + kFrameWaiterSuffix + std::to_string(i);
+        waiter_events_[i] = CreateEventA(&sa, FALSE, FALSE, name.c_str());
+        if (waiter_events_[i] == NULL) {
+            OutputErrorLog("Could not create frame waiter event. Error code: ",
+                           GetLastError());
+        }
+    }
+    LocalFree(sa.lpSecurityDescriptor);
+}
 
-NamedSharedMem::~NamedSharedMem() {
-    if (buf_ != NULL) {
-        UnmapViewOfFile(buf_);
-        buf_ = NULL;
+HANDLE NamedSharedMem::GetFrameWaiterEvent(int waiter)
+{
+    if (waiter < 0 || waiter >= (int)kMaxNsmFrameWaiters) {
+        return NULL;
     }
+    if (waiter_events_[waiter] == NULL) {
+        const auto name = mapfile_name_ + kFrameWaiterSuffix + std::to_string(waiter);
+        waiter_events_[waiter] = OpenEventA(SYNCHRONIZE, FALSE, name.c_str());
+        if (waiter_events_[waiter] == NULL) {
+            OutputErrorLog("Could not open frame waiter event. Error code: ",
+                           GetLastError());
+        }
+    }
+    return waiter_events_[waiter];
+}
 
-    if (header_ != NULL) {
-        UnmapViewOfFile(header_);
-        header_ = NULL;
+HRESULT NamedSharedMem::CreateCompanionMapping(const std::string& suffix, uint64_t size,
+    HANDLE& handle, void*& view)
+{
+    SECURITY_ATTRIBUTES sa = { sizeof(sa) };
+    if (ConvertStringSecurityDescriptorToSecurityDescriptorW(L"D:PNO_ACCESS_CONTROLS:(ML;;NW;;;LW)",
+        SDDL_REVISION_1, &sa.lpSecurityDescriptor, NULL))
+    {
+        handle = CreateFileMappingA(
+            INVALID_HANDLE_VALUE,
+            &sa,
+            PAGE_READWRITE,
+            DWORD(size >> 32),
+            DWORD(size & 0xFFFFFFFF),
+            (mapfile_name_ + suffix).c_str());
+
+        LocalFree(sa.lpSecurityDescriptor);
+    }
+    else {
+        OutputErrorLog("Failed to set security. Error code: ", GetLastError());
+        return E_FAIL;
     }
 
-    if (mapfile_handle_ != NULL) {
-        CloseHandle(mapfile_handle_);
-        mapfile_handle_ = NULL;
+    if (handle == NULL) {
+        OutputErrorLog("Could not create file mapping object. Error code: ",
+                       GetLastError());
+        return E_FAIL;
     }
+
+    view = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (view == NULL) {
+        OutputErrorLog("Could not map view of file. Error code: ",
+                       GetLastError());
+        CloseHandle(handle);
+        handle = NULL;
+        return E_FAIL;
+    }
+
+    memset(view, 0, size);
+    return S_OK;
 }
 
-void NamedSharedMem::WriteFrameData(PmNsmFrameData* data) {
-    uint64_t data_size_bytes = sizeof(PmNsmFrameData);
+HRESULT NamedSharedMem::EnableHistory(uint64_t history_size)
+{
+    const auto block_count = NsmHistoryWriter::GetBlockCount(history_size);
+    if (!buf_created_ || history_writer_ || block_count == 0) {
+        return E_FAIL;
+    }
+    history_size = NsmHistoryWriter::GetRequiredSize(block_count);
+    if (FAILED(CreateCompanionMapping(kHistorySuffix, history_size, history_handle_, history_buf_))) {
+        return E_FAIL;
+    }
+    history_writer_.emplace(history_buf_, block_count);
 
-    uint64_t write_to_offset = header_->current_write_offset;
-    if (write_to_offset + data_size_bytes >= header_->buf_size) {
-        // not enough space, move to front of the buffer
-        write_to_offset = data_offset_base_;
+    try {
+      LOG(INFO) << std::format("Frame history initialized with size {} bytes.", history_size);
+    } catch (...) {
+      LOG(INFO) << "Frame history initialized";
     }
+    return S_OK;
+}
 
-    uint64_t map_offset = (write_to_offset / alloc_granularity_) * alloc_granularity_;
-    DWORD map_offset_low = map_offset & 0xFFFFFFFF;
-    DWORD map_offset_high = (map_offset & 0xFFFFFFFF00000000ULL) >> 32;
+HRESULT NamedSharedMem::EnableMetricCache()
+{
+    if (!buf_created_ || metric_cache_.IsOpen()) {
+        return E_FAIL;
+    }
+    const auto cache_size = SharedMetricCache::GetRequiredSize(kMetricCacheEntryCount);
+    if (FAILED(CreateCompanionMapping(kMetricCacheSuffix, cache_size, metric_cache_handle_, metric_cache_buf_))) {
+        return E_FAIL;
+    }
+    SharedMetricCache::Initialize(metric_cache_buf_, kMetricCacheEntryCount);
+    metric_cache_.Open(metric_cache_buf_);
+    metric_cache_writer_.emplace();
+    return S_OK;
+}
 
-    uint64_t in_map_offset = write_to_offset % alloc_granularity_;
 
-    SIZE_T num_bytes_to_map = ((in_map_offset + sizeof(PmNsmFrameData)) > alloc_granularity_) ? 2 * alloc_granularity_ : alloc_granularity_;
+NamedSharedMem::~NamedSharedMem() {
+    for (auto& event : waiter_events_) {
+        if (event != NULL) {
+            CloseHandle(event);
+            event = NULL;
+        }
+    }
 
-    num_bytes_to_map = num_bytes_to_map > header_->buf_size ? header_->buf_size
-                                                            : num_bytes_to_map;
+    if (metric_cache_buf_ != NULL) {
+        UnmapViewOfFile(metric_cache_buf_);
+        metric_cache_buf_ = NULL;
+    }
 
-    // Map data region
-    buf_ = static_cast<void*>(MapViewOfFile(mapfile_handle_,   // handle to map object
-        FILE_MAP_WRITE, // write permission
-        map_offset_high,
-        map_offset_low,
-        num_bytes_to_map));
+    if (metric_cache_handle_ != NULL) {
+        CloseHandle(metric_cache_handle_);
+        metric_cache_handle_ = NULL;
+    }
 
-    if (buf_ == NULL) {
-        OutputErrorLog("Could not map view of file. Error code: ",
-                       GetLastError());
-        return;
+    if (history_buf_ != NULL) {
+        UnmapViewOfFile(history_buf_);
+        history_buf_ = NULL;
     }
 
-    std::memcpy(static_cast<void*>(static_cast<char*>(buf_) + in_map_offset),
-        static_cast<void*>(data), sizeof(PmNsmFrameData));
+    if (history_handle_ != NULL) {
+        CloseHandle(history_handle_);
+        history_handle_ = NULL;
+    }
 
-    if (IsFull()) {
-      header_->head_idx = (header_->head_idx + 1) % header_->max_entries;
+    if (buf_ != NULL) {
+        UnmapViewOfFile(buf_);
+        buf_ = NULL;
     }
 
-    header_->tail_idx = (header_->tail_idx + 1) % header_->max_entries;
-    header_->current_write_offset = write_to_offset + sizeof(PmNsmFrameData);
-    header_->num_frames_written++;
+    if (header_ != NULL) {
+        UnmapViewOfFile(header_);
+        header_ = NULL;
+    }
+
+    if (mapfile_handle_ != NULL) {
+        CloseHandle(mapfile_handle_);
+        mapfile_handle_ = NULL;
+    }
+}
 
-    LARGE_INTEGER qpc;
-    QueryPerformanceCounter(&qpc);
-    //LOG(INFO) << data->present_event.ProcessId << "," << qpc.QuadPart
-    //          << "," << data->present_event.SwapChainAddress << "," 
-    //          << "," << data->present_event.PresentStartTime << ","
-    //          << (int)data->present_event.FinalState << ","
-    //          << data->present_event.ScreenTime << "," << header_->tail_idx
-    //          << "," << header_->head_idx << "," << header_->num_frames_written;
+void NamedSharedMem::WriteFrameData(PmNsmFrameData* data) {
+    WriteFrameData(std::span<const PmNsmFrameData>{ data, 1 });
+}
 
-    UnmapViewOfFile(buf_);
-    buf_ = NULL;
+void NamedSharedMem::WriteFrameData(std::span<const PmNsmFrameData> frames) {
+    if (!ring_writer_) {
+        return;
+    }
+    // a batch can't be longer than the ring holds
+    const auto max_batch = header_->max_entries - 1;
+    for (size_t start = 0; start < frames.size(); start += max_batch) {
+        const auto batch = frames.subspan(start, (std::min)(frames.size() - start, size_t(max_batch)));
+        if (metric_cache_writer_) {
+            metric_cache_writer_->WriteFrames(metric_cache_, batch, header_->gpuTelemetryCapBits,
+                header_->cpuTelemetryCapBits, header_->qpc_frequency);
+        }
+        if (history_writer_) {
+            for (uint64_t i = 0; i < batch.size(); i++) {
+                uint64_t frame_num = 0;
+                if (auto evicted = ring_writer_->GetFrameToOverwrite(frame_num, i)) {
+                    history_writer_->FoldFrame(frame_num, *evicted);
+                }
+            }
+        }
+        ring_writer_->WriteFrames(batch);
+    }
+    // wake the clients that were waiting for these frames
+    if (auto waiters = ring_writer_->TakeWaitersToWake()) {
+        for (size_t i = 0; i < kMaxNsmFrameWaiters; i++) {
+            if ((waiters & (1u << i)) && waiter_events_[i] != NULL) {
+                SetEvent(waiter_events_[i]);
+            }
+        }
+    }
 }
 
 // Pop the first frame and move the head_idx
@@ -309,11 +446,45 @@ bool NamedSharedMem::IsFull() {
         return false;
     }
 
-    if (((header_->tail_idx+1) % header_->max_entries) == (header_->head_idx)) {
-        return true;
+    if (!IsNsmRingFull(*header_)) {
+        return false;
     }
+    // a reader that exited without unregistering would hold the ring back
+    // for good
+    return ReclaimDeadRingReaders() == 0 || IsNsmRingFull(*header_);
+}
 
-    return false;
+uint32_t NamedSharedMem::ReclaimDeadRingReaders() {
+    if (header_ == nullptr) {
+        return 0;
+    }
+    const auto reclaimed = ReclaimDeadNsmRingReaders(*header_, &IsOwnerProcessAlive);
+    if (reclaimed > 0) {
+        LOG(INFO) << "Reclaimed " << reclaimed << " NSM reader slots of exited clients.";
+    }
+    return reclaimed;
+}
+
+uint32_t NamedSharedMem::ReclaimDeadFrameWaiters() {
+    if (header_ == nullptr) {
+        return 0;
+    }
+    const auto reclaimed = ReclaimDeadNsmFrameWaiters(*header_, &IsOwnerProcessAlive);
+    if (reclaimed > 0) {
+        LOG(INFO) << "Reclaimed " << reclaimed << " NSM waiter slots of exited clients.";
+    }
+    return reclaimed;
+}
+
+bool NamedSharedMem::IsOwnerProcessAlive(uint64_t owner) {
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)owner);
+    if (process == NULL) {
+        // a process that can't be opened for lack of access is still running
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    }
+    const bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return alive;
 }
 
 bool NamedSharedMem::IsEmpty() {
@@ -336,6 +507,12 @@ bool NamedSharedMem::HasUninitializedFrames()
 void NamedSharedMem::NotifyProcessKilled() {
   header_->process_active = false;
   FlushViewOfFile(header_, sizeof(NamedSharedMemoryHeader));
+  // waiting clients won't get any more frames
+  for (auto event : waiter_events_) {
+    if (event != NULL) {
+      SetEvent(event);
+    }
+  }
 }
 
 void NamedSharedMem::RecordFirstFrameTime(uint64_t start_qpc) {
@@ -1,12 +1,20 @@
 // Copyright (C) 2022 Intel Corporation
 // SPDX-License-Identifier: MIT
 #pragma once
+#include <optional>
+#include <span>
 #include <string>
 
 #include "../PresentMonUtils/StreamFormat.h"
+#include "NsmHistory.h"
+#include "NsmRing.h"
+#include "SharedMetricCache.h"
 
 static const uint64_t kBufSize = 65536 * 60;
 static const std::string kGlobalPrefix = "Global\\NamedSharedMem_";
+// Suffix appended to the map file name, followed by the waiter slot, to name
+// the events that wake clients waiting for frames
+static const std::string kFrameWaiterSuffix = "_FrameWaiter";
 
 class NamedSharedMem {
  public:
@@ -27,8 +35,18 @@ class NamedSharedMem {
   // sizeof(NamedSharedMemoryHeader)
   uint32_t GetBaseOffset() { return data_offset_base_; };
   void* GetBuffer() { return buf_; };
-  // Server only method to write frame data
+  // Server only method to write frame data. With a history, the frame it
+  // overwrites is folded into the history first.
   void WriteFrameData(PmNsmFrameData* data);
+  // Server only method to write a batch of frames with as few header
+  // updates as the ring allows, waking waiting clients once
+  void WriteFrameData(std::span<const PmNsmFrameData> frames);
+  // Server only method to keep a compressed history of up to history_size
+  // bytes behind the ring (see NsmHistory.h)
+  HRESULT EnableHistory(uint64_t history_size);
+  // Server only method to publish a metric cache of statistics of the frames
+  // written, for the clients of this stream (see SharedMetricCache.h)
+  HRESULT EnableMetricCache();
   // Server only method to write the telemetry bit caps to
   // the header
   void WriteTelemetryCapBits(
@@ -44,13 +62,40 @@ class NamedSharedMem {
   uint64_t GetNumServiceWrittenFrames();
   // Client method to open a view into the shared mem
   void OpenSharedMemView(std::string mapfile_name);
+  // Client access to the ring protocol, for reading frames and registering as a reader. Null
+  // until a view is opened.
+  NsmRingReader* GetRingReader() { return ring_reader_ ? &*ring_reader_ : nullptr; }
+  // Client access to the frames that aged out of the ring. Null if the
+  // service keeps no history for this stream.
+  const NsmHistoryReader* GetHistoryReader() {
+    return history_reader_.IsOpen() ? &history_reader_ : nullptr;
+  }
+  // Client access to the metric cache that the service publishes for the
+  // stream. Null if it does not publish one.
+  const SharedMetricCache* GetMetricCache() {
+    return metric_cache_.IsOpen() ? &metric_cache_ : nullptr;
+  }
+  // Client method to get the event that wakes the given waiter slot (see
+  // NsmRing.h). Null if it can't be opened.
+  HANDLE GetFrameWaiterEvent(int waiter);
   void NotifyProcessKilled();
   // TODO(jtseng2): header_ is client used only. Separate GetHeader() API from
   // server.
   const NamedSharedMemoryHeader* GetHeader() { return header_; };
-  // indicates whether the ring buffer has available write space
+  // indicates whether the ring buffer has available write space, taking
+  // registered readers into account (see NsmRing.h); the reader slots of
+  // clients that exited without unregistering are reclaimed when it is full
   // only meaninful in a backpressured (typically replay) scenario
   bool IsFull();
+  // Frees the reader slots of clients that exited without unregistering.
+  // Returns the number of slots freed.
+  uint32_t ReclaimDeadRingReaders();
+  // Frees the waiter slots of clients that exited without unregistering.
+  // Returns the number of slots freed.
+  uint32_t ReclaimDeadFrameWaiters();
+  // Whether the process with the id that owns a reader or waiter slot is
+  // still running
+  static bool IsOwnerProcessAlive(uint64_t owner);
   // indicates whether the ring buffer has any unconsumed frames
   // only meaninful in a backpressured (typically replay) scenario
   bool IsEmpty();
@@ -72,15 +117,28 @@ class NamedSharedMem {
  private:
   // Server method to create a shared mem in buf_size bytes
   HRESULT CreateSharedMem(std::string mapfile_name, uint64_t buf_size);
+  // Server method to create the events that wake waiting clients
+  void CreateFrameWaiterEvents();
+  // Server method to create and map a zeroed mapping named after this one
+  HRESULT CreateCompanionMapping(const std::string& suffix, uint64_t size,
+      HANDLE& handle, void*& view);
   void OutputErrorLog(const char* error_string, DWORD last_error);
   std::string mapfile_name_;
   HANDLE mapfile_handle_;
   uint32_t data_offset_base_;
   NamedSharedMemoryHeader* header_;
   void* buf_;
-  // allocation granularity obtained from GetSystemInfo. MapViewOfFile offset
-  // must be multiple of alloc_granularity
-  size_t alloc_granularity_;
+  std::optional<NsmRingWriter> ring_writer_;
+  std::optional<NsmRingReader> ring_reader_;
+  HANDLE history_handle_ = NULL;
+  void* history_buf_ = NULL;
+  std::optional<NsmHistoryWriter> history_writer_;
+  NsmHistoryReader history_reader_;
+  HANDLE metric_cache_handle_ = NULL;
+  void* metric_cache_buf_ = NULL;
+  SharedMetricCache metric_cache_;
+  std::optional<MetricCacheWriter> metric_cache_writer_;
+  HANDLE waiter_events_[kMaxNsmFrameWaiters] = {};
   int refcount_;
   bool buf_created_;
   uint64_t buf_size_;
@@ -0,0 +1,251 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#include "NsmHistory.h"
+#include <atomic>
+#include <cstring>
+
+namespace {
+
+static_assert(sizeof(PmNsmFrameData) % sizeof(uint64_t) == 0);
+constexpr size_t kWordCount = sizeof(PmNsmFrameData) / sizeof(uint64_t);
+constexpr size_t kGroupCount = (kWordCount + 7) / 8;
+constexpr size_t kGroupMaskSize = (kGroupCount + 7) / 8;
+constexpr size_t kMaxVarintSize = 10;
+
+uint64_t Load(const uint64_t& value, std::memory_order order) {
+    return std::atomic_ref<uint64_t>(const_cast<uint64_t&>(value)).load(order);
+}
+
+void Store(uint64_t& value, uint64_t desired, std::memory_order order) {
+    std::atomic_ref<uint64_t>(value).store(desired, order);
+}
+
+uint64_t GetWord(const PmNsmFrameData& frame, size_t word) {
+    uint64_t value;
+    std::memcpy(&value, reinterpret_cast<const uint8_t*>(&frame) + word * sizeof(uint64_t), sizeof(value));
+    return value;
+}
+
+void SetWord(PmNsmFrameData& frame, size_t word, uint64_t value) {
+    std::memcpy(reinterpret_cast<uint8_t*>(&frame) + word * sizeof(uint64_t), &value, sizeof(value));
+}
+
+uint8_t* PutVarint(uint8_t* out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = uint8_t(value) | 0x80;
+        value >>= 7;
+    }
+    *out++ = uint8_t(value);
+    return out;
+}
+
+const uint8_t* GetVarint(const uint8_t* in, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        const auto byte = *in++;
+        value |= uint64_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return in;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t ZigZag(uint64_t delta) {
+    return (delta << 1) ^ uint64_t(int64_t(delta) >> 63);
+}
+
+uint64_t UnZigZag(uint64_t value) {
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+uint64_t CompleteSeq(uint64_t block) {
+    return 2 * block + 2;
+}
+
+// Encoded frames follow the block header
+constexpr uint64_t kBlockDataSize = kNsmHistoryBlockSize - sizeof(NsmHistoryBlockHeader);
+
+}  // namespace
+
+size_t GetMaxEncodedNsmFrameSize() {
+    return kGroupMaskSize + kGroupCount + kWordCount * kMaxVarintSize;
+}
+
+size_t EncodeNsmFrame(const PmNsmFrameData& prev, const PmNsmFrameData& frame, uint8_t* out) {
+    uint8_t* group_mask = out;
+    std::memset(group_mask, 0, kGroupMaskSize);
+    uint8_t* pos = out + kGroupMaskSize;
+    for (size_t group = 0; group < kGroupCount; group++) {
+        uint8_t* word_mask = pos;
+        uint8_t* values = pos + 1;
+        uint8_t mask = 0;
+        for (size_t i = 0; i < 8 && group * 8 + i < kWordCount; i++) {
+            const auto word = group * 8 + i;
+            const auto delta = GetWord(frame, word) - GetWord(prev, word);
+            if (delta != 0) {
+                mask |= uint8_t(1 << i);
+                values = PutVarint(values, ZigZag(delta));
+            }
+        }
+        if (mask != 0) {
+            *word_mask = mask;
+            group_mask[group / 8] |= uint8_t(1 << (group % 8));
+            pos = values;
+        }
+    }
+    return size_t(pos - out);
+}
+
+size_t DecodeNsmFrame(const PmNsmFrameData& prev, const uint8_t* in, size_t size, PmNsmFrameData& frame) {
+    if (size < kGroupMaskSize) {
+        return 0;
+    }
+    const uint8_t* const end = in + size;
+    const uint8_t* group_mask = in;
+    const uint8_t* pos = in + kGroupMaskSize;
+    std::memcpy(&frame, &prev, sizeof(PmNsmFrameData));
+    for (size_t group = 0; group < kGroupCount; group++) {
+        if ((group_mask[group / 8] & (1 << (group % 8))) == 0) {
+            continue;
+        }
+        if (pos >= end) {
+            return 0;
+        }
+        const auto mask = *pos++;
+        for (size_t i = 0; i < 8; i++) {
+            if ((mask & (1 << i)) == 0) {
+                continue;
+            }
+            const auto word = group * 8 + i;
+            uint64_t value = 0;
+            if (word >= kWordCount || (pos = GetVarint(pos, end, value)) == nullptr) {
+                return 0;
+            }
+            SetWord(frame, word, GetWord(prev, word) + UnZigZag(value));
+        }
+    }
+    return size_t(pos - in);
+}
+
+uint64_t NsmHistoryWriter::GetBlockCount(uint64_t size) {
+    return size > sizeof(NsmHistoryHeader) ? (size - sizeof(NsmHistoryHeader)) / kNsmHistoryBlockSize : 0;
+}
+
+uint64_t NsmHistoryWriter::GetRequiredSize(uint64_t block_count) {
+    return sizeof(NsmHistoryHeader) + block_count * kNsmHistoryBlockSize;
+}
+
+NsmHistoryWriter::NsmHistoryWriter(void* block, uint64_t block_count)
+    : header_(static_cast<NsmHistoryHeader*>(block)),
+      blocks_(static_cast<uint8_t*>(block) + sizeof(NsmHistoryHeader)) {
+    header_->magic = NSM_HISTORY_MAGIC;
+    header_->version = NSM_HISTORY_VERSION;
+    header_->frame_size = sizeof(PmNsmFrameData);
+    header_->block_size = (uint32_t)kNsmHistoryBlockSize;
+    header_->block_count = block_count;
+    header_->blocks_started = 0;
+}
+
+void NsmHistoryWriter::StartBlock(uint64_t frame_num) {
+    const auto block = header_->blocks_started;
+    current_ = reinterpret_cast<NsmHistoryBlockHeader*>(blocks_ + (block % header_->block_count) * kNsmHistoryBlockSize);
+    // readers of the block that was in the slot see that it changed
+    Store(current_->seq, CompleteSeq(block) - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    current_->first_frame = frame_num;
+    current_->frame_count = 0;
+    current_->bytes_used = 0;
+    Store(current_->seq, CompleteSeq(block), std::memory_order_release);
+    Store(header_->blocks_started, block + 1, std::memory_order_release);
+    std::memset(&prev_, 0, sizeof(prev_));
+}
+
+void NsmHistoryWriter::FoldFrame(uint64_t frame_num, const PmNsmFrameData& frame) {
+    if (header_->block_count == 0) {
+        return;
+    }
+    if (current_ == nullptr || frame_num != next_frame_ ||
+        current_->bytes_used + GetMaxEncodedNsmFrameSize() > kBlockDataSize) {
+        StartBlock(frame_num);
+    }
+    auto data = reinterpret_cast<uint8_t*>(current_ + 1);
+    current_->bytes_used += EncodeNsmFrame(prev_, frame, data + current_->bytes_used);
+    Store(current_->frame_count, current_->frame_count + 1, std::memory_order_release);
+    std::memcpy(&prev_, &frame, sizeof(prev_));
+    next_frame_ = frame_num + 1;
+}
+
+bool NsmHistoryReader::Open(const void* block) {
+    header_ = static_cast<const NsmHistoryHeader*>(block);
+    decoded_ = {};
+    if (header_->magic != NSM_HISTORY_MAGIC || header_->version != NSM_HISTORY_VERSION ||
+        header_->frame_size != sizeof(PmNsmFrameData) || header_->block_size != kNsmHistoryBlockSize) {
+        header_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+const NsmHistoryBlockHeader* NsmHistoryReader::GetBlock(uint64_t block) const {
+    auto blocks = reinterpret_cast<const uint8_t*>(header_ + 1);
+    return reinterpret_cast<const NsmHistoryBlockHeader*>(blocks + (block % header_->block_count) * kNsmHistoryBlockSize);
+}
+
+std::shared_ptr<const std::vector<PmNsmFrameData>> NsmHistoryReader::DecodeBlock(uint64_t frame_num, uint64_t& first_frame) const {
+    if (header_ == nullptr || header_->block_count == 0) {
+        return nullptr;
+    }
+    const auto blocks_started = Load(header_->blocks_started, std::memory_order_acquire);
+    const auto oldest = blocks_started > header_->block_count ? blocks_started - header_->block_count : 0;
+    // newest first, as the frames wanted are usually the ones that aged out of the ring last
+    for (auto block = blocks_started; block-- > oldest;) {
+        const auto block_header = GetBlock(block);
+        const auto seq = Load(block_header->seq, std::memory_order_acquire);
+        if (seq != CompleteSeq(block)) {
+            return nullptr;
+        }
+        first_frame = block_header->first_frame;
+        if (frame_num < first_frame) {
+            continue;
+        }
+        const auto frame_count = Load(block_header->frame_count, std::memory_order_acquire);
+        if (frame_num >= first_frame + frame_count) {
+            return nullptr;
+        }
+        // carry on from the frames decoded before if this is the block decoded last; frames that
+        // were handed out must not move, so they are copied before being added to
+        if (!decoded_.frames || decoded_.block != block || decoded_.seq != seq) {
+            decoded_ = { block, seq, 0, std::make_shared<std::vector<PmNsmFrameData>>() };
+        }
+        else if (decoded_.frames->size() < frame_count && decoded_.frames.use_count() > 1) {
+            decoded_.frames = std::make_shared<std::vector<PmNsmFrameData>>(*decoded_.frames);
+        }
+        auto& frames = *decoded_.frames;
+        const auto decoded_count = frames.size();
+        frames.resize(frame_count);
+        auto data = reinterpret_cast<const uint8_t*>(block_header + 1);
+        size_t offset = decoded_.bytes_decoded;
+        PmNsmFrameData zero;
+        std::memset(&zero, 0, sizeof(zero));
+        for (uint64_t i = decoded_count; i < frame_count; i++) {
+            const auto used = DecodeNsmFrame(i == 0 ? zero : frames[i - 1], data + offset,
+                size_t(kBlockDataSize - offset), frames[i]);
+            if (used == 0) {
+                decoded_ = {};
+                return nullptr;
+            }
+            offset += used;
+            frames_decoded_++;
+        }
+        // the block must not have been reused while it was being decoded
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (Load(block_header->seq, std::memory_order_relaxed) != seq) {
+            decoded_ = {};
+            return nullptr;
+        }
+        decoded_.bytes_decoded = offset;
+        return decoded_.frames;
+    }
+    return nullptr;
+}
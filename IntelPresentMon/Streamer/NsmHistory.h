@@ -0,0 +1,120 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../PresentMonUtils/StreamFormat.h"
+
+// -------------------------------------------------------------------------------------------------
+// Compressed frame history
+//
+// Frames that age out of the NSM ring are folded into a much longer history, kept in a second
+// mapping named after the ring's with kHistorySuffix. The history is a ring of fixed size blocks:
+//
+//     NsmHistoryHeader
+//     block                                (x block_count; kNsmHistoryBlockSize bytes each)
+//         NsmHistoryBlockHeader
+//         encoded frames
+//
+// Each frame is encoded against the frame before it in its block (the first against all zeros),
+// eight bytes at a time. The words of the frame are grouped by eight; a bit per group says whether
+// any of its words changed, a byte per changed group says which ones, and each changed word is
+// stored as the zigzag varint of its difference from the previous frame's. QPC timestamps take a
+// few bytes that way, and everything that stays the same from one frame to the next (application
+// name, unsupported telemetry, telemetry between samples) takes nothing. Decoding gives back the
+// exact frames that were folded.
+//
+// Blocks are numbered in the order they are started, block b being in slot b % block_count. The
+// writer appends frames to the newest block and publishes its frame_count (with release ordering)
+// after each one, so readers can decode the block that is being filled. When a slot is reused, its
+// sequence number changes (2b + 1 while it is set up for block b, 2b + 2 after), which readers
+// check after decoding, as with the frame ring (see NsmRing.h).
+
+#define NSM_HISTORY_MAGIC    0x48534D50u // 'PMSH'
+#define NSM_HISTORY_VERSION  1u
+
+static const uint64_t kNsmHistoryBlockSize = 65536;
+// Suffix appended to the NamedSharedMem map file name to name its history
+static const std::string kHistorySuffix = "_History";
+
+struct NsmHistoryHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t frame_size;          // sizeof(PmNsmFrameData) of the writer
+  uint32_t block_size;
+  uint64_t block_count;
+  uint64_t blocks_started;      // number of blocks started so far
+};
+
+struct NsmHistoryBlockHeader {
+  uint64_t seq;                 // 2b + 2 while the slot holds block b
+  uint64_t first_frame;         // number of the first frame in the block
+  uint64_t frame_count;
+  uint64_t bytes_used;          // encoded bytes after the block header
+};
+
+// Upper bound of the encoded size of a frame
+size_t GetMaxEncodedNsmFrameSize();
+// Encode frame as changes from prev into out, which must have room for GetMaxEncodedNsmFrameSize()
+// bytes. Returns the number of bytes written.
+size_t EncodeNsmFrame(const PmNsmFrameData& prev, const PmNsmFrameData& frame, uint8_t* out);
+// Decode a frame encoded against prev. Returns the number of bytes read, or 0 if the data is not a
+// complete encoded frame.
+size_t DecodeNsmFrame(const PmNsmFrameData& prev, const uint8_t* in, size_t size, PmNsmFrameData& frame);
+
+// Folds frames into a history laid out in a block of memory, usually a view of the history mapping
+class NsmHistoryWriter {
+ public:
+  // Blocks that fit in size bytes, and the bytes needed for block_count blocks
+  static uint64_t GetBlockCount(uint64_t size);
+  static uint64_t GetRequiredSize(uint64_t block_count);
+
+  // Initializes the header in block, which must be GetRequiredSize(block_count) bytes and zero
+  // initialized
+  NsmHistoryWriter(void* block, uint64_t block_count);
+  NsmHistoryWriter(const NsmHistoryWriter&) = delete;
+  NsmHistoryWriter& operator=(const NsmHistoryWriter&) = delete;
+
+  // Append a frame; frames are expected in order of frame_num, a gap starts a new block
+  void FoldFrame(uint64_t frame_num, const PmNsmFrameData& frame);
+
+ private:
+  void StartBlock(uint64_t frame_num);
+  NsmHistoryHeader* header_;
+  uint8_t* blocks_;
+  NsmHistoryBlockHeader* current_ = nullptr;
+  uint64_t next_frame_ = 0;
+  PmNsmFrameData prev_;
+};
+
+// Decodes frames from a history. The block decoded last is kept, so that when it is asked for
+// again (typically the newest block, which the writer is still filling) only the frames folded
+// into it since are decoded.
+class NsmHistoryReader {
+ public:
+  // Returns false if block does not hold a compatible history
+  bool Open(const void* block);
+  bool IsOpen() const { return header_ != nullptr; }
+  // Decode the whole block holding frame_num, first_frame being the number of the first frame
+  // returned. Returns null if the frame is not (or no longer) in the history. The frames stay as
+  // they are for as long as the returned pointer is held.
+  std::shared_ptr<const std::vector<PmNsmFrameData>> DecodeBlock(uint64_t frame_num, uint64_t& first_frame) const;
+  // Number of frames decoded by this reader so far
+  uint64_t GetFramesDecoded() const { return frames_decoded_; }
+
+ private:
+  struct DecodedBlock {
+    uint64_t block = 0;
+    uint64_t seq = 0;           // seq of the slot when the block was decoded, 0 if none was
+    size_t bytes_decoded = 0;
+    std::shared_ptr<std::vector<PmNsmFrameData>> frames;
+  };
+  const NsmHistoryBlockHeader* GetBlock(uint64_t block) const;
+  const NsmHistoryHeader* header_ = nullptr;
+  mutable DecodedBlock decoded_;
+  mutable uint64_t frames_decoded_ = 0;
+};
@@ -0,0 +1,349 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#include "NsmRing.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace {
+
+// The shared fields are plain integers in the mapped memory, so they are accessed through
+// atomic_ref. Loads don't write, so read-only views can be loaded from as well.
+uint64_t Load(const uint64_t& value, std::memory_order order) {
+    return std::atomic_ref<uint64_t>(const_cast<uint64_t&>(value)).load(order);
+}
+
+void Store(uint64_t& value, uint64_t desired, std::memory_order order) {
+    std::atomic_ref<uint64_t>(value).store(desired, order);
+}
+
+// Owner of a slot while it is being reclaimed, so that it is not registered again until it is clear
+const uint64_t kReclaimingOwner = UINT64_MAX;
+
+uint64_t CompleteSeq(uint64_t frame_num) {
+    return 2 * frame_num + 2;
+}
+
+uint64_t AlignUp(uint64_t offset) {
+    return (offset + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+}
+
+uint64_t GetQpcIndexEntries(uint64_t max_entries) {
+    return max_entries != 0 ? max_entries / kNsmQpcIndexStride + 2 : 0;
+}
+
+}  // namespace
+
+bool GetSlowestNsmRingReader(const NamedSharedMemoryHeader& header, uint64_t& next_frame) {
+    bool found = false;
+    for (auto& reader : header.readers) {
+        if (Load(reader.owner, std::memory_order_acquire) == 0) {
+            continue;
+        }
+        const auto reader_next_frame = Load(reader.next_frame, std::memory_order_acquire);
+        next_frame = found ? (std::min)(next_frame, reader_next_frame) : reader_next_frame;
+        found = true;
+    }
+    return found;
+}
+
+bool IsNsmRingFull(const NamedSharedMemoryHeader& header) {
+    uint64_t slowest = 0;
+    if (GetSlowestNsmRingReader(header, slowest)) {
+        const auto num_frames_written = Load(header.num_frames_written, std::memory_order_acquire);
+        return num_frames_written - slowest >= header.max_entries - 1;
+    }
+    return ((header.tail_idx + 1) % header.max_entries) == header.head_idx;
+}
+
+uint32_t ReclaimDeadNsmRingReaders(NamedSharedMemoryHeader& header, NsmOwnerLivenessCheck is_owner_alive) {
+    uint32_t reclaimed = 0;
+    for (auto& reader : header.readers) {
+        auto owner = Load(reader.owner, std::memory_order_acquire);
+        if (owner == 0 || owner == kReclaimingOwner || is_owner_alive(owner)) {
+            continue;
+        }
+        // until the slot is clear, the writer still counts it as a reader, which only holds it back
+        if (std::atomic_ref<uint64_t>(reader.owner).compare_exchange_strong(owner, kReclaimingOwner,
+            std::memory_order_acq_rel)) {
+            Store(reader.next_frame, 0, std::memory_order_relaxed);
+            Store(reader.owner, 0, std::memory_order_release);
+            reclaimed++;
+        }
+    }
+    return reclaimed;
+}
+
+uint32_t ReclaimDeadNsmFrameWaiters(NamedSharedMemoryHeader& header, NsmOwnerLivenessCheck is_owner_alive) {
+    uint32_t reclaimed = 0;
+    for (auto& waiter : header.waiters) {
+        auto owner = Load(waiter.owner, std::memory_order_acquire);
+        if (owner == 0 || owner == kReclaimingOwner || is_owner_alive(owner)) {
+            continue;
+        }
+        if (std::atomic_ref<uint64_t>(waiter.owner).compare_exchange_strong(owner, kReclaimingOwner,
+            std::memory_order_acq_rel)) {
+            Store(waiter.wake_frame, 0, std::memory_order_relaxed);
+            Store(waiter.owner, 0, std::memory_order_release);
+            reclaimed++;
+        }
+    }
+    return reclaimed;
+}
+
+uint64_t NsmRingWriter::GetMaxEntries(uint64_t buf_size) {
+    // leave room for aligning the sequence numbers
+    const auto fixed = sizeof(NamedSharedMemoryHeader) + sizeof(uint64_t);
+    if (buf_size <= fixed) {
+        return 0;
+    }
+    // the index takes a fraction of a byte per frame, so this is only a few frames too many
+    auto max_entries = (buf_size - fixed) / (sizeof(PmNsmFrameData) + sizeof(uint64_t));
+    while (max_entries > 0 && GetRequiredSize(max_entries) > buf_size) {
+        max_entries--;
+    }
+    return max_entries;
+}
+
+uint64_t NsmRingWriter::GetRequiredSize(uint64_t max_entries) {
+    const auto slots_end = AlignUp(sizeof(NamedSharedMemoryHeader) + max_entries * sizeof(PmNsmFrameData));
+    return slots_end + max_entries * sizeof(uint64_t) + GetQpcIndexEntries(max_entries) * sizeof(NsmQpcIndexEntry);
+}
+
+void NsmRingWriter::InitializeLayout(NamedSharedMemoryHeader* header, uint64_t buf_size) {
+    header->max_entries = GetMaxEntries(buf_size);
+    const auto slots_end = sizeof(NamedSharedMemoryHeader) + header->max_entries * sizeof(PmNsmFrameData);
+    header->slot_seq_offset = AlignUp(slots_end);
+    header->qpc_index_offset = header->slot_seq_offset + header->max_entries * sizeof(uint64_t);
+    header->qpc_index_entries = GetQpcIndexEntries(header->max_entries);
+}
+
+NsmRingWriter::NsmRingWriter(NamedSharedMemoryHeader* header, void* buffer)
+    : header_(header),
+      slots_(reinterpret_cast<PmNsmFrameData*>(static_cast<char*>(buffer) + sizeof(NamedSharedMemoryHeader))),
+      slot_seqs_(reinterpret_cast<uint64_t*>(static_cast<char*>(buffer) + header->slot_seq_offset)),
+      qpc_index_(header->qpc_index_entries != 0 ?
+          reinterpret_cast<NsmQpcIndexEntry*>(static_cast<char*>(buffer) + header->qpc_index_offset) : nullptr) {}
+
+void NsmRingWriter::WriteFrameData(const PmNsmFrameData& data) {
+    WriteFrames({ &data, 1 });
+}
+
+void NsmRingWriter::WriteFrames(std::span<const PmNsmFrameData> frames) {
+    if (frames.empty()) {
+        return;
+    }
+    const auto max_entries = header_->max_entries;
+    const auto first_frame_num = header_->num_frames_written;
+
+    for (uint64_t i = 0; i < frames.size(); i++) {
+        const auto frame_num = first_frame_num + i;
+        const auto slot = frame_num % max_entries;
+
+        // Mark the slot as being written before touching it, so that a reader of the frame that was
+        // in it sees that it changed
+        Store(slot_seqs_[slot], CompleteSeq(frame_num) - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&slots_[slot], &frames[i], sizeof(PmNsmFrameData));
+        Store(slot_seqs_[slot], CompleteSeq(frame_num), std::memory_order_release);
+
+        if (qpc_index_ != nullptr && frame_num % kNsmQpcIndexStride == 0) {
+            const auto stride = frame_num / kNsmQpcIndexStride;
+            auto& entry = qpc_index_[stride % header_->qpc_index_entries];
+            Store(entry.tag, 0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            Store(entry.qpc, frames[i].present_event.PresentStartTime, std::memory_order_relaxed);
+            Store(entry.tag, stride + 1, std::memory_order_release);
+        }
+    }
+
+    const auto frame_num = first_frame_num + frames.size() - 1;
+    const auto slot = frame_num % max_entries;
+    uint64_t slowest = 0;
+    if (GetSlowestNsmRingReader(*header_, slowest)) {
+        // the head follows the slowest reader, but the ring never holds more than max_entries - 1
+        const auto oldest = frame_num + 2 > max_entries ? frame_num + 2 - max_entries : 0;
+        header_->head_idx = (std::max)(slowest, oldest) % max_entries;
+    } else if ((header_->tail_idx + max_entries - header_->head_idx) % max_entries + frames.size() >= max_entries) {
+        // drop the oldest frames that the batch pushes out
+        header_->head_idx = (slot + 2) % max_entries;
+    }
+    header_->tail_idx = (slot + 1) % max_entries;
+    header_->current_write_offset = sizeof(NamedSharedMemoryHeader) + (slot + 1) * sizeof(PmNsmFrameData);
+    Store(header_->num_frames_written, frame_num + 1, std::memory_order_release);
+}
+
+const PmNsmFrameData* NsmRingWriter::GetFrameToOverwrite(uint64_t& frame_num, uint64_t ahead) const {
+    const auto max_entries = header_->max_entries;
+    const auto num_frames_written = header_->num_frames_written + ahead;
+    if (num_frames_written < max_entries) {
+        return nullptr;
+    }
+    frame_num = num_frames_written - max_entries;
+    return &slots_[frame_num % max_entries];
+}
+
+uint32_t NsmRingWriter::TakeWaitersToWake() {
+    // pairs with the fence in ArmWaiter: the num_frames_written store above is ordered before the
+    // loads of wake_frame
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const auto num_frames_written = header_->num_frames_written;
+    uint32_t waiters = 0;
+    for (uint32_t i = 0; i < (uint32_t)kMaxNsmFrameWaiters; i++) {
+        auto wake_frame = Load(header_->waiters[i].wake_frame, std::memory_order_relaxed);
+        if (wake_frame == 0 || wake_frame > num_frames_written) {
+            continue;
+        }
+        // the waiter may disarm or rearm meanwhile; only wake it for the arming that was reached
+        if (std::atomic_ref<uint64_t>(header_->waiters[i].wake_frame).compare_exchange_strong(wake_frame, 0,
+            std::memory_order_relaxed)) {
+            waiters |= 1u << i;
+        }
+    }
+    return waiters;
+}
+
+NsmRingReader::NsmRingReader(NamedSharedMemoryHeader* header, const void* buffer)
+    : header_(header),
+      slots_(reinterpret_cast<const PmNsmFrameData*>(static_cast<const char*>(buffer) + sizeof(NamedSharedMemoryHeader))),
+      slot_seqs_(reinterpret_cast<const uint64_t*>(static_cast<const char*>(buffer) + header->slot_seq_offset)),
+      qpc_index_(header->qpc_index_entries != 0 ?
+          reinterpret_cast<const NsmQpcIndexEntry*>(static_cast<const char*>(buffer) + header->qpc_index_offset) : nullptr) {}
+
+uint64_t NsmRingReader::GetNumFramesWritten() const {
+    return Load(header_->num_frames_written, std::memory_order_acquire);
+}
+
+uint64_t NsmRingReader::GetOldestFrame(uint64_t num_frames_written) const {
+    return num_frames_written >= header_->max_entries ? num_frames_written - header_->max_entries + 1 : 0;
+}
+
+const PmNsmFrameData* NsmRingReader::GetFrame(uint64_t frame_num) const {
+    return &slots_[frame_num % header_->max_entries];
+}
+
+NsmFrameState NsmRingReader::GetFrameState(uint64_t frame_num) const {
+    const auto seq = Load(slot_seqs_[frame_num % header_->max_entries], std::memory_order_acquire);
+    if (seq == CompleteSeq(frame_num)) {
+        return NsmFrameState::kReady;
+    }
+    return seq < CompleteSeq(frame_num) ? NsmFrameState::kPending : NsmFrameState::kOverwritten;
+}
+
+bool NsmRingReader::IsFrameIntact(uint64_t frame_num) const {
+    // order the reads of the frame before the second look at the sequence number
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return Load(slot_seqs_[frame_num % header_->max_entries], std::memory_order_relaxed) ==
+        CompleteSeq(frame_num);
+}
+
+NsmFrameState NsmRingReader::CopyFrame(uint64_t frame_num, PmNsmFrameData& frame) const {
+    const auto state = GetFrameState(frame_num);
+    if (state != NsmFrameState::kReady) {
+        return state;
+    }
+    std::memcpy(&frame, GetFrame(frame_num), sizeof(PmNsmFrameData));
+    return IsFrameIntact(frame_num) ? NsmFrameState::kReady : NsmFrameState::kOverwritten;
+}
+
+bool NsmRingReader::GetStrideQpc(uint64_t stride, uint64_t& qpc) const {
+    const auto& entry = qpc_index_[stride % header_->qpc_index_entries];
+    if (Load(entry.tag, std::memory_order_acquire) != stride + 1) {
+        return false;
+    }
+    qpc = Load(entry.qpc, std::memory_order_relaxed);
+    // order the read of the time before the second look at the tag
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return Load(entry.tag, std::memory_order_relaxed) == stride + 1;
+}
+
+uint64_t NsmRingReader::SeekFrame(uint64_t qpc, uint64_t num_frames_written) const {
+    if (num_frames_written == 0) {
+        return 0;
+    }
+    const auto newest = num_frames_written - 1;
+    if (qpc_index_ == nullptr) {
+        return newest;
+    }
+    // find the first stride still in the ring that starts after qpc
+    const auto oldest = GetOldestFrame(num_frames_written);
+    auto first = (oldest + kNsmQpcIndexStride - 1) / kNsmQpcIndexStride;
+    auto last = newest / kNsmQpcIndexStride + 1;
+    while (first < last) {
+        const auto middle = first + (last - first) / 2;
+        uint64_t stride_qpc = 0;
+        if (!GetStrideQpc(middle, stride_qpc)) {
+            // the writer came around meanwhile
+            return newest;
+        }
+        if (stride_qpc > qpc) {
+            last = middle;
+        } else {
+            first = middle + 1;
+        }
+    }
+    const auto start = first * kNsmQpcIndexStride;
+    if (start > newest) {
+        return newest;
+    }
+    return start > oldest ? start - 1 : oldest;
+}
+
+int NsmRingReader::RegisterReader(uint64_t owner, uint64_t next_frame) {
+    for (int i = 0; i < (int)kMaxNsmRingReaders; i++) {
+        auto& reader = header_->readers[i];
+        uint64_t free_owner = 0;
+        if (std::atomic_ref<uint64_t>(reader.owner).compare_exchange_strong(free_owner, owner,
+            std::memory_order_acq_rel)) {
+            // until this store the writer sees next_frame 0 (see UnregisterReader), which only
+            // holds it back further
+            Store(reader.next_frame, next_frame, std::memory_order_release);
+            return i;
+        }
+    }
+    return -1;
+}
+
+uint64_t NsmRingReader::GetReaderPosition(int reader) const {
+    return Load(header_->readers[reader].next_frame, std::memory_order_acquire);
+}
+
+void NsmRingReader::SetReaderPosition(int reader, uint64_t next_frame) {
+    Store(header_->readers[reader].next_frame, next_frame, std::memory_order_release);
+}
+
+void NsmRingReader::UnregisterReader(int reader) {
+    Store(header_->readers[reader].next_frame, 0, std::memory_order_relaxed);
+    Store(header_->readers[reader].owner, 0, std::memory_order_release);
+}
+
+int NsmRingReader::RegisterWaiter(uint64_t owner) {
+    for (int i = 0; i < (int)kMaxNsmFrameWaiters; i++) {
+        uint64_t free_owner = 0;
+        if (std::atomic_ref<uint64_t>(header_->waiters[i].owner).compare_exchange_strong(free_owner, owner,
+            std::memory_order_acq_rel)) {
+            Store(header_->waiters[i].wake_frame, 0, std::memory_order_relaxed);
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool NsmRingReader::ArmWaiter(int waiter, uint64_t wake_frame) {
+    Store(header_->waiters[waiter].wake_frame, wake_frame, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (Load(header_->num_frames_written, std::memory_order_relaxed) >= wake_frame) {
+        DisarmWaiter(waiter);
+        return false;
+    }
+    return true;
+}
+
+void NsmRingReader::DisarmWaiter(int waiter) {
+    Store(header_->waiters[waiter].wake_frame, 0, std::memory_order_relaxed);
+}
+
+void NsmRingReader::UnregisterWaiter(int waiter) {
+    DisarmWaiter(waiter);
+    Store(header_->waiters[waiter].owner, 0, std::memory_order_release);
+}
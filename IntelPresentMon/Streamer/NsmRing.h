@@ -0,0 +1,163 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <cstdint>
+#include <span>
+
+#include "../PresentMonUtils/StreamFormat.h"
+
+// -------------------------------------------------------------------------------------------------
+// Frame ring protocol
+//
+// The NamedSharedMem buffer holds the header, the frame slots and a sequence number per slot:
+//
+//     NamedSharedMemoryHeader
+//     PmNsmFrameData                       (x max_entries; frame n is held in slot n % max_entries)
+//     uint64_t                             (x max_entries, at slot_seq_offset)
+//     NsmQpcIndexEntry                     (x qpc_index_entries, at qpc_index_offset)
+//
+// Frames are numbered from 0 in the order they are written. While the writer fills in frame n, the
+// sequence number of its slot is 2n + 1, and once the frame is complete it is 2n + 2. After that
+// num_frames_written is set to n + 1. Both are stored with release ordering after the data they
+// cover and loaded with acquire ordering, so:
+//  - a slot with sequence number 2n + 2 holds all of frame n
+//  - a reader that sees num_frames_written > n can read frame n (unless it was overwritten since)
+// A reader checks the sequence number of a frame's slot, reads the frame, and checks the sequence
+// number again (seqlock). If it changed, the writer came around while the frame was being read and
+// the data read may be torn. Readers never write to the frame slots, so any number of them can
+// trail the writer, each at its own pace, and each knows exactly which frames it lost.
+//
+// head_idx and tail_idx are still kept for the shared head (see Backpressure below), and to tell
+// whether the ring is empty.
+//
+// The writer may write several frames before updating the header, each frame's slot going through
+// the same sequence numbers; num_frames_written then moves past all of them at once.
+//
+// Backpressure: readers of a backpressured ring register in one of the header's reader slots and
+// publish the number of the next frame they will consume as they go. The ring is full when the
+// slowest registered reader is max_entries - 1 frames behind the writer. A client that does not
+// register dequeues by advancing head_idx, which only works with a single consumer. A reader that
+// exits without unregistering would hold the ring back for good, so the slots of owners that are no
+// longer running are reclaimed when the ring is full or no slot is free (the owner of a slot is the
+// id of the process that registered it, and the caller tells whether it is still running).
+//
+// Waiting: instead of polling for frames, a client can register in one of the header's waiter slots
+// and arm it with the frame count to be woken at (wake_frame). After each frame, the writer disarms
+// the waiters whose wake_frame has been reached and returns them, so that the owner of the ring can
+// signal their events. A waiter is woken once per arming however many frames are written, so a
+// client asking for n frames is woken at most once every n frames. Waiter slots of owners that are
+// no longer running are reclaimed like reader slots, when no slot is free. Arming stores wake_frame and
+// then checks num_frames_written, while the writer stores num_frames_written and then checks
+// wake_frame, both with a full fence in between, so either the waiter sees the frames or the
+// writer sees the waiter.
+//
+// Seeking by time: every kNsmQpcIndexStride frames, the writer records the PresentStartTime of the
+// frame in a small index (entry (n / kNsmQpcIndexStride) % qpc_index_entries for frame n), so that
+// the frame presented at a given time can be found by binary search over the index and a walk of
+// at most kNsmQpcIndexStride frames, instead of a walk from the newest frame. The index has two
+// entries more than the ring has strides, so an entry is only reused once the frames it covers
+// have left the ring. An entry is tagged with the number of its stride plus one: the writer clears
+// the tag, writes the time and then tags it, and readers check the tag before and after reading
+// the time. Index entries of frames still in the ring are only missing while being written.
+
+static const uint64_t kNsmQpcIndexStride = 64;
+
+struct NsmQpcIndexEntry {
+  uint64_t tag;     // number of the stride plus one, 0 while being written
+  uint64_t qpc;     // PresentStartTime of the first frame of the stride
+};
+
+enum class NsmFrameState {
+  kPending,       // not written yet
+  kReady,         // can be read
+  kOverwritten,   // lost, the writer has reused its slot
+};
+
+// Lowest next_frame of the registered readers; returns false if there are none
+bool GetSlowestNsmRingReader(const NamedSharedMemoryHeader& header, uint64_t& next_frame);
+// Whether the writer has to wait for readers before writing another frame (only meaningful in a
+// backpressured scenario)
+bool IsNsmRingFull(const NamedSharedMemoryHeader& header);
+// Whether the owner of a reader or waiter slot is still running
+using NsmOwnerLivenessCheck = bool (*)(uint64_t owner);
+// Free the reader slots whose owner is no longer running; returns the number of slots freed
+uint32_t ReclaimDeadNsmRingReaders(NamedSharedMemoryHeader& header, NsmOwnerLivenessCheck is_owner_alive);
+// Free the waiter slots whose owner is no longer running; returns the number of slots freed
+uint32_t ReclaimDeadNsmFrameWaiters(NamedSharedMemoryHeader& header, NsmOwnerLivenessCheck is_owner_alive);
+
+// Writes frames to the ring. There must only be one writer.
+class NsmRingWriter {
+ public:
+  // Number of frames that fit in a buffer of buf_size bytes (header included)
+  static uint64_t GetMaxEntries(uint64_t buf_size);
+  // Size of the buffer holding a ring of max_entries frames (header included)
+  static uint64_t GetRequiredSize(uint64_t max_entries);
+  // Sets up the ring in a zero initialized buffer of buf_size bytes
+  static void InitializeLayout(NamedSharedMemoryHeader* header, uint64_t buf_size);
+
+  // header and buffer may be separate views of the same memory
+  NsmRingWriter(NamedSharedMemoryHeader* header, void* buffer);
+  void WriteFrameData(const PmNsmFrameData& data);
+  // Writes a batch of at most max_entries - 1 frames and then updates the header once, so readers
+  // see num_frames_written move past the whole batch at once
+  void WriteFrames(std::span<const PmNsmFrameData> frames);
+  // Frame that writing the ahead-th next frame overwrites, and its number; null while the ring has
+  // not wrapped that far yet
+  const PmNsmFrameData* GetFrameToOverwrite(uint64_t& frame_num, uint64_t ahead = 0) const;
+  // Disarm the waiters whose wake_frame was reached by the frames written so far; returns them as
+  // a bit mask of waiter slots
+  uint32_t TakeWaitersToWake();
+
+ private:
+  NamedSharedMemoryHeader* header_;
+  PmNsmFrameData* slots_;
+  uint64_t* slot_seqs_;
+  NsmQpcIndexEntry* qpc_index_;
+};
+
+// Reads frames from the ring and manages the registration of a reader. Frames are read in place;
+// check IsFrameIntact() after using one, or use CopyFrame().
+class NsmRingReader {
+ public:
+  // header and buffer may be separate views of the same memory; only the header is written to
+  NsmRingReader(NamedSharedMemoryHeader* header, const void* buffer);
+
+  uint64_t GetNumFramesWritten() const;
+  // Oldest frame that was not (and is not being) overwritten when num_frames_written frames had
+  // been written
+  uint64_t GetOldestFrame(uint64_t num_frames_written) const;
+  const PmNsmFrameData* GetFrame(uint64_t frame_num) const;
+  NsmFrameState GetFrameState(uint64_t frame_num) const;
+  // Check, after reading a frame that was ready, that it was not overwritten while being read
+  bool IsFrameIntact(uint64_t frame_num) const;
+  // Copy out a frame if it can be read; the copy is only valid if kReady is returned
+  NsmFrameState CopyFrame(uint64_t frame_num, PmNsmFrameData& frame) const;
+  // Frame to start walking back from to find the newest frame presented at or before qpc, among the
+  // first num_frames_written frames: frames after it were presented after qpc, and the frame
+  // looked for is at most kNsmQpcIndexStride frames back. Assumes that PresentStartTime does not go
+  // backwards across strides. Returns num_frames_written - 1 if the ring has no index.
+  uint64_t SeekFrame(uint64_t qpc, uint64_t num_frames_written) const;
+
+  // Register a reader that will consume starting at next_frame. Returns the reader's slot, or -1
+  // if all are taken. owner must be non-zero.
+  int RegisterReader(uint64_t owner, uint64_t next_frame);
+  uint64_t GetReaderPosition(int reader) const;
+  void SetReaderPosition(int reader, uint64_t next_frame);
+  void UnregisterReader(int reader);
+
+  // Register a waiter. Returns the waiter's slot, or -1 if all are taken. owner must be non-zero.
+  int RegisterWaiter(uint64_t owner);
+  // Ask to be woken once num_frames_written reaches wake_frame. Returns false, without arming, if it
+  // already has.
+  bool ArmWaiter(int waiter, uint64_t wake_frame);
+  void DisarmWaiter(int waiter);
+  void UnregisterWaiter(int waiter);
+
+ private:
+  // PresentStartTime of the first frame of a stride, if its index entry is intact
+  bool GetStrideQpc(uint64_t stride, uint64_t& qpc) const;
+  NamedSharedMemoryHeader* header_;
+  const PmNsmFrameData* slots_;
+  const uint64_t* slot_seqs_;
+  const NsmQpcIndexEntry* qpc_index_;
+};
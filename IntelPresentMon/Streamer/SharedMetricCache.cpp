@@ -0,0 +1,166 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#include "SharedMetricCache.h"
+#include <atomic>
+#include <bit>
+#include <cstring>
+
+#include "../PresentMonUtils/QPCUtils.h"
+#include "TelemetryMetrics.h"
+
+namespace {
+
+static_assert(sizeof(MetricCacheKey) == 32);
+static_assert(sizeof(MetricCacheEntry) == 48);
+
+uint64_t Load(const uint64_t& value, std::memory_order order) {
+    return std::atomic_ref<uint64_t>(const_cast<uint64_t&>(value)).load(order);
+}
+
+// FNV-1a; the key has no padding, so all of its bytes are significant
+uint64_t HashKey(const MetricCacheKey& key) {
+    auto bytes = reinterpret_cast<const uint8_t*>(&key);
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(key); i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+}  // namespace
+
+uint64_t SharedMetricCache::GetRequiredSize(uint64_t entry_count) {
+    return sizeof(MetricCacheHeader) + entry_count * sizeof(MetricCacheEntry);
+}
+
+void SharedMetricCache::Initialize(void* block, uint64_t entry_count) {
+    auto header = static_cast<MetricCacheHeader*>(block);
+    header->magic = METRIC_CACHE_MAGIC;
+    header->version = METRIC_CACHE_VERSION;
+    header->entry_count = entry_count - entry_count % kMetricCacheWays;
+}
+
+bool SharedMetricCache::Open(void* block) {
+    header_ = static_cast<MetricCacheHeader*>(block);
+    if (header_->magic != METRIC_CACHE_MAGIC || header_->version != METRIC_CACHE_VERSION ||
+        header_->entry_count < kMetricCacheWays) {
+        header_ = nullptr;
+        return false;
+    }
+    entries_ = reinterpret_cast<MetricCacheEntry*>(header_ + 1);
+    return true;
+}
+
+MetricCacheEntry* SharedMetricCache::GetSet(const MetricCacheKey& key) const {
+    const auto set_count = header_->entry_count / kMetricCacheWays;
+    return entries_ + (HashKey(key) % set_count) * kMetricCacheWays;
+}
+
+bool SharedMetricCache::Lookup(const MetricCacheKey& key, uint64_t& value) const {
+    if (header_ == nullptr) {
+        return false;
+    }
+    auto set = GetSet(key);
+    for (uint64_t i = 0; i < kMetricCacheWays; i++) {
+        auto& entry = set[i];
+        const auto seq = Load(entry.seq, std::memory_order_acquire);
+        if (seq == 0 || (seq & 1) != 0) {
+            continue;
+        }
+        MetricCacheKey entry_key;
+        std::memcpy(&entry_key, &entry.key, sizeof(entry_key));
+        const auto entry_value = entry.value;
+        // order the reads of the entry before the second look at the sequence number
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (Load(entry.seq, std::memory_order_relaxed) != seq) {
+            continue;
+        }
+        if (std::memcmp(&entry_key, &key, sizeof(key)) == 0) {
+            value = entry_value;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SharedMetricCache::Store(const MetricCacheKey& key, uint64_t value) {
+    if (header_ == nullptr) {
+        return;
+    }
+    auto set = GetSet(key);
+    auto victim = &set[0];
+    for (uint64_t i = 0; i < kMetricCacheWays; i++) {
+        if (std::memcmp(&set[i].key, &key, sizeof(key)) == 0) {
+            victim = &set[i];
+            break;
+        }
+        if (set[i].key.frame_qpc < victim->key.frame_qpc) {
+            victim = &set[i];
+        }
+    }
+
+    // the service is the only writer, so the sequence number is only moved on for the readers
+    const auto seq = Load(victim->seq, std::memory_order_relaxed);
+    std::atomic_ref<uint64_t>(victim->seq).store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&victim->key, &key, sizeof(key));
+    victim->value = value;
+    std::atomic_ref<uint64_t>(victim->seq).store(seq + 2, std::memory_order_release);
+}
+
+void MetricCacheWriter::WriteFrames(SharedMetricCache& cache, std::span<const PmNsmFrameData> frames,
+    const GpuTelemetryBitset& gpu_telemetry_cap_bits,
+    const CpuTelemetryBitset& cpu_telemetry_cap_bits, LARGE_INTEGER qpc_frequency) {
+    if (frames.empty() || !cache.IsOpen()) {
+        return;
+    }
+    if (windows_.empty()) {
+        for (auto size_ms : kMetricCacheWindowSizesMs) {
+            windows_.push_back(Window{ .size_ms = size_ms });
+        }
+    }
+
+    for (auto& frame : frames) {
+        const auto timestamp = frame.present_event.PresentStartTime;
+        for (auto& window : windows_) {
+            const auto push = [&](PM_METRIC metric, uint32_t array_index, double value) {
+                window.metrics[{ metric, array_index }].Push(timestamp, value);
+            };
+            for (size_t i = 0; i < gpu_telemetry_cap_bits.size(); i++) {
+                if (gpu_telemetry_cap_bits[i]) {
+                    ForEachGpuTelemetrySample(i, frame.power_telemetry, push);
+                }
+            }
+            for (size_t i = 0; i < cpu_telemetry_cap_bits.size(); i++) {
+                if (cpu_telemetry_cap_bits[i]) {
+                    ForEachCpuTelemetrySample(i, frame.cpu_telemetry, push);
+                }
+            }
+        }
+    }
+
+    // the window of a poll covers the frames that started within its size before the newest one
+    const auto frame_qpc = frames.back().present_event.PresentStartTime;
+    for (auto& window : windows_) {
+        const auto window_qpc = SecondsDeltaToQpc(window.size_ms / 1000., qpc_frequency);
+        const auto end_qpc = frame_qpc > window_qpc ? frame_qpc - window_qpc : 0;
+        for (auto it = window.metrics.begin(); it != window.metrics.end();) {
+            it->second.EvictThrough(end_qpc);
+            if (it->second.Empty()) {
+                it = window.metrics.erase(it);
+                continue;
+            }
+            for (auto stat : kMetricCacheStats) {
+                const MetricCacheKey key{
+                    .frame_qpc = frame_qpc,
+                    .window_size = std::bit_cast<uint64_t>(window.size_ms),
+                    .metric = uint32_t(it->first.first),
+                    .stat = uint32_t(stat),
+                    .array_index = it->first.second,
+                };
+                cache.Store(key, std::bit_cast<uint64_t>(pmon::mid::CalculateWindowStatistic(it->second, stat)));
+            }
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,111 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../PresentMonUtils/StreamFormat.h"
+#include "../PresentMonMiddleware/MetricWindow.h"
+
+// -------------------------------------------------------------------------------------------------
+// Shared metric cache
+//
+// Clients of the same process poll dynamic queries over the same frames. When the service is started
+// with --enable-metric-cache, it creates a mapping next to each process's NamedSharedMem (named with
+// kMetricCacheSuffix) where it publishes rolling statistics of the frames it writes, for the common
+// window sizes in kMetricCacheWindowSizesMs, so that clients read them instead of computing them.
+//
+// Only the service writes to the cache, and only statistics that depend on nothing but the frames of
+// the window: those of the telemetry carried by the frames, over exact (not sketched) windows. Frame
+// metrics are computed by each client, as they depend on its swap chain state and on the PC latency
+// estimate it keeps. An entry is keyed on the newest frame of the window, the window size, and the
+// introspection metric and stat IDs and array index, so a client's metric offset only selects the
+// frame it looks up, and a hit is bit-identical to what the client would have computed itself.
+//
+// The table is split in sets of kMetricCacheWays entries, a key always going to the same set. Each
+// entry is guarded by a sequence number: the writer moves it from even to odd while it writes the
+// entry and on to the next even number once it is written. Readers check it before and after reading
+// the entry and ignore entries that changed meanwhile. Sequence number 0 is an entry never written.
+
+#define METRIC_CACHE_MAGIC    0x434D4D50u // 'PMMC'
+#define METRIC_CACHE_VERSION  2u
+
+static const uint64_t kMetricCacheEntryCount = 16384;
+static const uint64_t kMetricCacheWays = 4;
+// Suffix appended to the NamedSharedMem map file name to name its metric cache
+static const std::string kMetricCacheSuffix = "_MetricCache";
+// Window sizes (ms) the service publishes statistics for
+static const double kMetricCacheWindowSizesMs[] = { 500., 1000., 2000. };
+// Statistics published for each metric and window
+static const PM_STAT kMetricCacheStats[] = {
+    PM_STAT_AVG, PM_STAT_NON_ZERO_AVG, PM_STAT_MIN, PM_STAT_MAX, PM_STAT_MID_POINT, PM_STAT_MID_LERP,
+    PM_STAT_PERCENTILE_01, PM_STAT_PERCENTILE_05, PM_STAT_PERCENTILE_10, PM_STAT_PERCENTILE_90,
+    PM_STAT_PERCENTILE_95, PM_STAT_PERCENTILE_99,
+};
+
+struct MetricCacheKey {
+  uint64_t frame_qpc;           // PresentStartTime of the newest frame of the window
+  uint64_t window_size;         // bits of the window size in ms (double)
+  uint32_t metric;              // PM_METRIC
+  uint32_t stat;                // PM_STAT
+  uint32_t array_index;
+  uint32_t reserved;
+};
+
+struct MetricCacheEntry {
+  uint64_t seq;
+  MetricCacheKey key;
+  uint64_t value;               // bits of the statistic (double)
+};
+
+struct MetricCacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t entry_count;
+};
+
+// Access to a metric cache laid out in a block of memory, usually a view of the cache mapping
+class SharedMetricCache {
+ public:
+  static uint64_t GetRequiredSize(uint64_t entry_count);
+  // Sets up a cache of entry_count entries (a multiple of kMetricCacheWays) in a zero initialized
+  // block of GetRequiredSize(entry_count) bytes
+  static void Initialize(void* block, uint64_t entry_count);
+
+  // Returns false if block does not hold a compatible cache
+  bool Open(void* block);
+  bool IsOpen() const { return header_ != nullptr; }
+  bool Lookup(const MetricCacheKey& key, uint64_t& value) const;
+  // Server only. Replaces the entry with the same key, or else the entry of the set with the oldest
+  // frame.
+  void Store(const MetricCacheKey& key, uint64_t value);
+
+ private:
+  MetricCacheEntry* GetSet(const MetricCacheKey& key) const;
+  MetricCacheHeader* header_ = nullptr;
+  MetricCacheEntry* entries_ = nullptr;
+};
+
+// Server side computation of the cached statistics of a stream. The telemetry samples of the frames
+// written are fed into one window per size in kMetricCacheWindowSizesMs, the way the middleware feeds
+// the windows of a dynamic query (see TelemetryMetrics.h), and after each batch the statistics of
+// every window are stored for the newest frame of the batch.
+class MetricCacheWriter {
+ public:
+  // Frames must be given in the order they are written, before they are written to the ring, so
+  // that their statistics are published by the time clients see them
+  void WriteFrames(SharedMetricCache& cache, std::span<const PmNsmFrameData> frames,
+      const GpuTelemetryBitset& gpu_telemetry_cap_bits,
+      const CpuTelemetryBitset& cpu_telemetry_cap_bits, LARGE_INTEGER qpc_frequency);
+
+ private:
+  struct Window {
+    double size_ms = 0.;
+    std::map<std::pair<PM_METRIC, uint32_t>, pmon::mid::MetricWindow> metrics;
+  };
+  std::vector<Window> windows_;
+};
@@ -6,26 +6,34 @@
 
 #include "../CommonUtilities/log/GlogShim.h"
 
+#include <algorithm>
+#include <chrono>
+
 StreamClient::StreamClient()
     : initialized_(false),
-      next_dequeue_idx_(0),
       recording_frame_data_(false),
       current_dequeue_frame_num_(0) {}
 
 StreamClient::StreamClient(std::string mapfile_name, bool is_etl_stream_client)
-    : next_dequeue_idx_(0),
-      recording_frame_data_(false),
+    : recording_frame_data_(false),
       current_dequeue_frame_num_(0) {
   Initialize(std::move(mapfile_name));
 }
 
 StreamClient::~StreamClient() {
+  UnregisterFrameWaiter();
+  UnregisterRingReader();
 }
 
 void StreamClient::Initialize(std::string mapfile_name) {
+	UnregisterFrameWaiter();
+	UnregisterRingReader();
+	last_waited_frame_num_.reset();
 	shared_mem_view_ = std::make_unique<NamedSharedMem>();
 	shared_mem_view_->OpenSharedMemView(mapfile_name);
 	mapfile_name_ = std::move(mapfile_name);
+	columnar_view_.reset();
+	columnar_view_offsets_.reset();
 
 	// Query qpc frequency
     if (!QueryPerformanceFrequency(&qpcFrequency_)) {
@@ -36,32 +44,101 @@ void StreamClient::Initialize(std::string mapfile_name) {
 	LOG(INFO) << "Stream client initialized.";
 }
 
-void StreamClient::CloseSharedMemView() { shared_mem_view_.reset(nullptr); }
+void StreamClient::CloseSharedMemView() {
+  UnregisterFrameWaiter();
+  UnregisterRingReader();
+  columnar_view_.reset();
+  columnar_view_offsets_.reset();
+  shared_mem_view_.reset(nullptr);
+}
 
-PmNsmFrameData* StreamClient::ReadLatestFrame() {
-  PmNsmFrameData* data = nullptr;
+void StreamClient::UnregisterRingReader() {
+  if (ring_reader_slot_ >= 0 && shared_mem_view_ &&
+      shared_mem_view_->GetRingReader()) {
+    shared_mem_view_->GetRingReader()->UnregisterReader(ring_reader_slot_);
+  }
+  ring_reader_slot_ = -1;
+}
 
-  if (shared_mem_view_ == nullptr) {
-    LOG(ERROR)
-        << "Shared mem view is null. Initialze client with mapfile name.";
-    return data;
+void StreamClient::UnregisterFrameWaiter() {
+  if (frame_waiter_slot_ >= 0 && shared_mem_view_ &&
+      shared_mem_view_->GetRingReader()) {
+    shared_mem_view_->GetRingReader()->UnregisterWaiter(frame_waiter_slot_);
   }
+  frame_waiter_slot_ = -1;
+}
 
-  if (shared_mem_view_->IsEmpty()) {
-    LOG(INFO) << "Shared mem view is empty. start ETW tracing or wait for "
-                 "more data";
-    return data;
+uint64_t StreamClient::WaitForFrames(uint32_t min_frames, uint32_t timeout_ms) {
+  auto nsm_view = GetNamedSharedMemView();
+  if (nsm_view == nullptr || nsm_view->GetRingReader() == nullptr) {
+    return 0;
   }
+  auto ring = nsm_view->GetRingReader();
+  if (!last_waited_frame_num_) {
+    last_waited_frame_num_ = ring->GetNumFramesWritten();
+  }
+  const auto base = recording_frame_data_ ? current_dequeue_frame_num_ : *last_waited_frame_num_;
+  const auto wake_frame = base + (std::max)(min_frames, 1u);
 
-  uint64_t index = GetLatestFrameIndex();
+  if (frame_waiter_slot_ < 0) {
+    frame_waiter_slot_ = ring->RegisterWaiter(GetCurrentProcessId());
+    if (frame_waiter_slot_ < 0 && nsm_view->ReclaimDeadFrameWaiters() > 0) {
+      frame_waiter_slot_ = ring->RegisterWaiter(GetCurrentProcessId());
+    }
+  }
+  const HANDLE event = frame_waiter_slot_ >= 0 ?
+      nsm_view->GetFrameWaiterEvent(frame_waiter_slot_) : NULL;
+  if (event == NULL && !polling_for_frames_) {
+    pmlog_warn(frame_waiter_slot_ < 0 ?
+        "All NSM waiter slots are taken, waiting for frames by polling every 1ms" :
+        "NSM frame waiter event could not be opened, waiting for frames by polling every 1ms");
+  }
+  polling_for_frames_ = event == NULL;
+
+  // The event may have been left signaled by an earlier wait, so check again after every wake up
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (nsm_view->GetHeader()->process_active) {
+    if (event != NULL) {
+      if (!ring->ArmWaiter(frame_waiter_slot_, wake_frame)) {
+        break;
+      }
+    } else if (ring->GetNumFramesWritten() >= wake_frame) {
+      break;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      break;
+    }
+    const auto remaining = (DWORD)std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+    if (event != NULL) {
+      WaitForSingleObject(event, remaining);
+    } else {
+      Sleep((std::min)(remaining, DWORD(1)));
+    }
+  }
+  if (event != NULL) {
+    ring->DisarmWaiter(frame_waiter_slot_);
+  }
 
-  return ReadFrameByIdx(index, true);
+  const auto num_frames_written = ring->GetNumFramesWritten();
+  last_waited_frame_num_ = num_frames_written;
+  return num_frames_written > base ? num_frames_written - base : 0;
 }
 
-PmNsmFrameData* StreamClient::ReadFrameByIdx(uint64_t frame_idx, bool checked) {
-  PmNsmFrameData* data = nullptr;
-  uint64_t read_offset = 0;
+void StreamClient::DequeueFrames(uint64_t frame_count) {
+  auto nsm_view = GetNamedSharedMemView();
+  if (ring_reader_slot_ >= 0) {
+    auto ring = nsm_view->GetRingReader();
+    ring->SetReaderPosition(ring_reader_slot_,
+                            ring->GetReaderPosition(ring_reader_slot_) + frame_count);
+  } else {
+    for (uint64_t i = 0; i < frame_count; i++) {
+      nsm_view->DequeueFrameData();
+    }
+  }
+}
 
+PmNsmFrameData* StreamClient::ReadLatestFrame() {
   if (shared_mem_view_ == nullptr) {
     LOG(ERROR)
         << "Shared mem view is null. Initialze client with mapfile name.";
@@ -69,85 +146,28 @@ PmNsmFrameData* StreamClient::ReadFrameByIdx(uint64_t frame_idx, bool checked) {
   }
 
   if (shared_mem_view_->IsEmpty()) {
-      if (checked) {
-          pmlog_error("Trying to read from empty nsm ring").pmwatch(frame_idx);
-      }
+    LOG(INFO) << "Shared mem view is empty. start ETW tracing or wait for "
+                 "more data";
     return nullptr;
   }
 
-  auto p_header = shared_mem_view_->GetHeader();
-
-  if (!p_header->process_active) {
+  if (!shared_mem_view_->GetHeader()->process_active) {
     LOG(ERROR) << "Process is not active. Shared mem view to be destroyed.";
     CloseSharedMemView();
     return nullptr;
   }
 
-  if (frame_idx > p_header->max_entries - 1) {
-      pmlog_error("Bad out of bounds index in circular buffer").pmwatch(frame_idx);
-      return nullptr;
+  auto ring = shared_mem_view_->GetRingReader();
+  if (ring == nullptr) {
+    return nullptr;
   }
-
-  if (checked) {
-    // when ring is full, every frame is valid for reading
-    // in realtime usage (head not updated on read), this is always the case once the ring wraps once
-    if (!shared_mem_view_->IsFull()) {
-        bool invalid = false;
-        // when ring is not full, there are two cases (head before tail, or vice versa)
-        // head before tail (invalid range potentially non-contiguous/wrapping)
-        if (p_header->tail_idx > p_header->head_idx) {
-            if (frame_idx >= p_header->tail_idx || frame_idx < p_header->head_idx) {
-                invalid = true;
-            }
-        }
-        else { // tail before head (invalid range contiguous in middle)
-            if (frame_idx >= p_header->tail_idx && frame_idx < p_header->head_idx) {
-                invalid = true;
-            }
-        }
-        if (invalid) {
-            pmlog_error("Invalid frame idx").pmwatch(frame_idx);
-            return nullptr;
-        }
-    }
+  const auto num_frames_written = ring->GetNumFramesWritten();
+  if (num_frames_written == 0 ||
+      ring->CopyFrame(num_frames_written - 1, latest_frame_) != NsmFrameState::kReady) {
+    // the service came around to the frame while it was being copied
+    return nullptr;
   }
-
-  read_offset = frame_idx * sizeof(PmNsmFrameData) + shared_mem_view_->GetBaseOffset();
-
-  data = reinterpret_cast<PmNsmFrameData*>(
-      static_cast<char*>((shared_mem_view_->GetBuffer())) + read_offset);
-
-  return data;
-}
-
-void StreamClient::PeekNextFrames(const PmNsmFrameData** pNextFrame,
-                                  const PmNsmFrameData** pNextDisplayedFrame)
-{
-    *pNextFrame          = nullptr;
-    *pNextDisplayedFrame = nullptr;
-    if (recording_frame_data_) {
-        auto nsm_view = GetNamedSharedMemView();
-        auto nsm_hdr = nsm_view->GetHeader();
-        if (!nsm_hdr->process_active) {
-            // Service destroyed the named shared memory.
-            return;
-        }
-
-        uint64_t peekIndex{ next_dequeue_idx_ };
-        auto pTempFrameData = ReadFrameByIdx(peekIndex, false);
-        *pNextFrame = pTempFrameData;
-        while (pTempFrameData) {
-            if (pTempFrameData->present_event.FinalState == PresentResult::Presented &&
-                pTempFrameData->present_event.DisplayedCount > 0) {
-                *pNextDisplayedFrame = pTempFrameData;
-                return;
-            }
-            // advance to next frame with circular buffer wrapping behavior
-            peekIndex = (peekIndex + 1) % nsm_view->GetHeader()->max_entries;
-            pTempFrameData = ReadFrameByIdx(peekIndex, false);
-        }
-    }
-    return;
+  return &latest_frame_;
 }
 
 bool StreamClient::IsAppPresentedFrame(const PmNsmFrameData* frame) const {
@@ -174,122 +194,166 @@ bool StreamClient::IsAppDisplayedFrame(const PmNsmFrameData* frame) const {
             frame->present_event.Displayed_FrameType[lastDisplayedIndex] == FrameType::Application);
 }
 
-// Function to peek previous frames from the current frame
-void StreamClient::PeekPreviousFrames(const PmNsmFrameData** pFrameDataOfLastPresented,
-                                      const PmNsmFrameData** pFrameDataOfLastAppPresented,
-                                      const PmNsmFrameData** pFrameDataOfLastDisplayed,
-                                      const PmNsmFrameData** pFrameDataOfLastAppDisplayed,
-                                      const PmNsmFrameData** pFrameDataOfPreviousAppFrameOfLastAppDisplayed)
+bool StreamClient::IsAppFrame(const PmNsmFrameData* frame) const {
+    if (!frame || frame->present_event.DisplayedCount == 0) {
+        return frame != nullptr;
+    }
+    size_t lastDisplayedIndex = frame->present_event.DisplayedCount - 1;
+    return frame->present_event.Displayed_FrameType[lastDisplayedIndex] == FrameType::NotSet ||
+        frame->present_event.Displayed_FrameType[lastDisplayedIndex] == FrameType::Application;
+}
+
+bool StreamClient::OpenColumnarView(std::span<const uint32_t> source_offsets) {
+  if (columnar_view_offsets_ &&
+      std::ranges::equal(*columnar_view_offsets_, source_offsets)) {
+    return columnar_view_ != nullptr;
+  }
+  columnar_view_offsets_.emplace(source_offsets.begin(), source_offsets.end());
+  columnar_view_.reset();
+
+  // every present event field is needed to match frames up with their neighbors and resolve
+  // the computed metrics, on top of the fields the caller copies
+  std::vector<uint32_t> offsets;
+  const auto present_event_begin = NSM_COLUMN_OFFSET(present_event);
+  const auto present_event_end = present_event_begin + uint32_t(sizeof(PmNsmPresentEvent));
+  for (auto& field : GetNsmColumnFields()) {
+    if (field.source_offset >= present_event_begin && field.source_offset < present_event_end) {
+      offsets.push_back(field.source_offset);
+    }
+  }
+  offsets.insert(offsets.end(), source_offsets.begin(), source_offsets.end());
+
+  auto view = std::make_unique<ColumnarSharedMem>();
+  if (!view->Open(mapfile_name_ + kColumnarSuffix, offsets)) {
+    LOG(INFO) << "Columnar stream not available, copying frames out of the ring.";
+    return false;
+  }
+  columnar_view_ = std::move(view);
+  return true;
+}
+
+NsmFrameState StreamClient::CopyFrame(const NsmRingReader& ring, uint64_t frame_num,
+                                      PmNsmFrameData& frame) const {
+  if (columnar_view_ == nullptr) {
+    return ring.CopyFrame(frame_num, frame);
+  }
+  // The ring still decides which frames can be consumed. The service writes the row of a frame
+  // before the ring publishes the frame, and the columns hold twice what the ring does, so a
+  // frame that is ready has its row unless the columns came around to it meanwhile; the ring
+  // is the fallback then.
+  const auto state = ring.GetFrameState(frame_num);
+  if (state != NsmFrameState::kReady) {
+    return state;
+  }
+  const auto& reader = columnar_view_->GetReader();
+  if (frame_num < reader.GetSequence()) {
+    reader.GatherRow(frame_num, frame);
+    if (reader.IsRowIntact(frame_num)) {
+      return NsmFrameState::kReady;
+    }
+  }
+  return ring.CopyFrame(frame_num, frame);
+}
+
+void StreamClient::PeekPreviousFrames(const NsmRingReader& ring, uint64_t frame_num,
+                                      NsmFrameNeighbors& neighbors)
 {
-    *pFrameDataOfLastPresented         = nullptr;
-    *pFrameDataOfLastAppPresented      = nullptr;
-    *pFrameDataOfLastDisplayed         = nullptr;
-    *pFrameDataOfLastAppDisplayed      = nullptr;
-    *pFrameDataOfPreviousAppFrameOfLastAppDisplayed = nullptr;
-    if (recording_frame_data_) {
-        auto nsm_view = GetNamedSharedMemView();
-        auto nsm_hdr = nsm_view->GetHeader();
-        if (!nsm_hdr->process_active) {
-            // Service destroyed the named shared memory.
+    neighbors.pFrameDataOfLastPresented = nullptr;
+    neighbors.pFrameDataOfLastAppPresented = nullptr;
+    neighbors.pFrameDataOfLastDisplayed = nullptr;
+    neighbors.pFrameDataOfLastAppDisplayed = nullptr;
+    neighbors.pFrameDataOfPreviousAppFrameOfLastAppDisplayed = nullptr;
+
+    // Each frame is looked at in a copy, which is kept if it turns out to be one of the previous
+    // frames. The frames before the oldest one may be being overwritten, so the search ends there.
+    const auto oldest = ring.GetOldestFrame(ring.GetNumFramesWritten());
+    PmNsmFrameData frame = {};
+    while (frame_num-- > oldest) {
+        if (CopyFrame(ring, frame_num, frame) != NsmFrameState::kReady) {
+            return;
+        }
+        const PmNsmFrameData* pFrame = nullptr;
+        const auto keep = [&] {
+            if (pFrame == nullptr) {
+                pFrame = &neighbor_frames_.emplace_back(frame);
+            }
+            return pFrame;
+        };
+        if (neighbors.pFrameDataOfLastPresented == nullptr) {
+            // the frame right before
+            neighbors.pFrameDataOfLastPresented = keep();
+        }
+        if (neighbors.pFrameDataOfLastAppPresented == nullptr && IsAppFrame(&frame)) {
+            // This could point to the same frame as the last presented one above
+            neighbors.pFrameDataOfLastAppPresented = keep();
+        }
+        if (neighbors.pFrameDataOfLastDisplayed == nullptr && IsDisplayedFrame(&frame)) {
+            neighbors.pFrameDataOfLastDisplayed = keep();
+        }
+        if (neighbors.pFrameDataOfLastAppDisplayed == nullptr) {
+            if (IsAppDisplayedFrame(&frame)) {
+                neighbors.pFrameDataOfLastAppDisplayed = keep();
+            }
+        } else if (IsAppFrame(&frame)) {
+            // If we have found the last displayed app frame we now need to find the previously
+            // presented frame to determine the cpu start time. The frame does not need to be
+            // displayed but must be from the application
+            neighbors.pFrameDataOfPreviousAppFrameOfLastAppDisplayed = keep();
+        }
+        if (neighbors.pFrameDataOfLastAppPresented != nullptr &&
+            neighbors.pFrameDataOfLastDisplayed != nullptr &&
+            neighbors.pFrameDataOfPreviousAppFrameOfLastAppDisplayed != nullptr) {
+            // We have found all the frames we need to find. We can exit early.
             return;
         }
+    }
+}
 
-        // if nsm is not fully initialized, last frame to read is at idx 0, so stop condition is when we wrap to last idx
-        // otherwise, last frame to read is the one that follows the latest one (which is the oldest one, next one to be overwritten)
-        const auto stopIdx = nsm_view->HasUninitializedFrames() ? nsm_hdr->max_entries - 1 : this->GetLatestFrameIndex();
-        // here, peek index is starting at the frame which follows the current one
-        // this frame is guaranteed to be valid since peekNext call prior to this would exit early if it were not
-        uint64_t peekIndex{ next_dequeue_idx_ };
-        uint32_t numFramesTraversed = 0;
-        while (true) {
-            // seek back one frame with ring buffer cycling behavior
-            peekIndex = peekIndex == 0 ? (nsm_hdr->max_entries - 1) : (peekIndex - 1);
-            // exit when we hit stopIdx (which is the first frame encountered we should *not* use)
-            if (peekIndex == stopIdx) {
-                return;
+StreamClient::RingReaderStatus StreamClient::StartRecordingFrameData()
+{
+    auto nsm_view = GetNamedSharedMemView();
+    auto nsm_hdr = nsm_view->GetHeader();
+    auto ring = nsm_view->GetRingReader();
+    // Frames are dequeued by number from here on. The frames before the oldest one in the ring
+    // are lost if they were not dequeued by then.
+    recording_frame_data_ = true;
+    const auto num_frames_written = ring->GetNumFramesWritten();
+    const auto pending = (nsm_hdr->tail_idx + nsm_hdr->max_entries - nsm_hdr->head_idx) % nsm_hdr->max_entries;
+    const auto head_frame = (std::max)(num_frames_written - (std::min)(pending, num_frames_written),
+        ring->GetOldestFrame(num_frames_written));
+    if (nsm_hdr->isPlaybackResetOldest) {
+        // during playback it is desirable to start at the very first frame even if we start consuming late,
+        // so start from the head (oldest frame not dequeued yet)
+        current_dequeue_frame_num_ = head_frame;
+    }
+    else {
+        // at start or after overrun, reset to most recent frame data
+        current_dequeue_frame_num_ = num_frames_written;
+    }
+    if (nsm_hdr->isPlaybackBackpressured) {
+        // Register as a reader so that the service waits for this client (as well as any other
+        // clients of the stream) instead of a single shared head. The reader starts where the
+        // head is, and moves on by one frame for every frame dequeued, as the head would.
+        if (ring_reader_slot_ >= 0) {
+            ring->SetReaderPosition(ring_reader_slot_, head_frame);
+        }
+        else {
+            ring_reader_slot_ = ring->RegisterReader(GetCurrentProcessId(), head_frame);
+            if (ring_reader_slot_ < 0 && nsm_view->ReclaimDeadRingReaders() > 0) {
+                ring_reader_slot_ = ring->RegisterReader(GetCurrentProcessId(), head_frame);
             }
-            numFramesTraversed++;
-            // TODO: we can improve checking by independently enabling for forward and backward cases
-            auto pTempFrameData = ReadFrameByIdx(peekIndex, false);
-            // We need to traverse back two frames from the next_dequeue_idx to
-            // get to the start of the previous frames
-            if (numFramesTraversed > 1) {
-                if (pTempFrameData) {
-                    if (numFramesTraversed == 2) {
-                        // If we made it here we were able to go back two frames
-                        // from the current next_deque_index. This is the frame
-                        // data of the last presented frame before the current frame.
-                        *pFrameDataOfLastPresented = pTempFrameData;
-                    }
-                    if (*pFrameDataOfLastAppPresented == nullptr) {
-                        // If we haven't found the last app presented frame check to see if
-                        // the current one is presented. This could point to the same frame
-                        // as the last presented one above.
-                        auto displayedCount = pTempFrameData->present_event.DisplayedCount;
-                        if (displayedCount > 0) {
-                            if (pTempFrameData->present_event.Displayed_FrameType[displayedCount - 1] == FrameType::NotSet ||
-                                pTempFrameData->present_event.Displayed_FrameType[displayedCount - 1] == FrameType::Application) {
-                                *pFrameDataOfLastAppPresented = pTempFrameData;
-                            }
-                        } else {
-                            // If the displayed count is 0 we assume this is an app frame
-                            *pFrameDataOfLastAppPresented = pTempFrameData;
-                        }
-                    }
-                    if (*pFrameDataOfLastDisplayed == nullptr) {
-                        // If we haven't found the last displayed frame check to see if
-                        // the current one is presented. This could point to the same frame
-                        // as the last presented one above.
-                        if (pTempFrameData->present_event.FinalState == PresentResult::Presented &&
-                            pTempFrameData->present_event.DisplayedCount > 0) {
-                            *pFrameDataOfLastDisplayed = pTempFrameData;
-                        }
-                    }
-                    if (*pFrameDataOfLastAppDisplayed == nullptr) {
-                        // If we haven't found the last displayed app frame check to see if
-                        // the current one is presented. This could point to the same frame
-                        // as the last displayed frame above.
-                        if (pTempFrameData->present_event.DisplayedCount > 0) {
-                            size_t lastDisplayedIndex = pTempFrameData->present_event.DisplayedCount - 1;
-                            if (pTempFrameData->present_event.FinalState == PresentResult::Presented &&
-                                (pTempFrameData->present_event.Displayed_FrameType[lastDisplayedIndex] == FrameType::NotSet ||
-                                    pTempFrameData->present_event.Displayed_FrameType[lastDisplayedIndex] == FrameType::Application)) {
-                                *pFrameDataOfLastAppDisplayed = pTempFrameData;
-                            }
-                        }
-                    } else {
-                        // If we have found the last displayed app frame we now need to find the previously
-                        // presented frame to determine the cpu start time. The frame does not need to be
-                        // displayed but must be from the application
-                        if (pTempFrameData->present_event.DisplayedCount > 0) {
-                            size_t lastDisplayedIndex = pTempFrameData->present_event.DisplayedCount - 1;
-                            if (pTempFrameData->present_event.Displayed_FrameType[lastDisplayedIndex] == FrameType::NotSet ||
-                                pTempFrameData->present_event.Displayed_FrameType[lastDisplayedIndex] == FrameType::Application) {
-                                *pFrameDataOfPreviousAppFrameOfLastAppDisplayed = pTempFrameData;
-                            }
-                        } else {
-                            // If the displayed count is 0 we assume this is an app frame
-                            *pFrameDataOfPreviousAppFrameOfLastAppDisplayed = pTempFrameData;
-                        }
-                    }
-                    if (*pFrameDataOfLastPresented != nullptr &&
-                        *pFrameDataOfLastAppPresented != nullptr &&
-                        *pFrameDataOfLastDisplayed != nullptr &&
-                        *pFrameDataOfPreviousAppFrameOfLastAppDisplayed != nullptr &&
-                        *pFrameDataOfLastAppDisplayed != nullptr) {
-                        // We have found all the frames we need to find. We can exit early.
-                        return;
-                    }
-                }
-                else {
-                    // The read frame data is null.
-                    // TODO log this as the index is supposed to be valid!
-                    return;
-                }
+            if (ring_reader_slot_ < 0) {
+                pmlog_warn("All NSM reader slots are taken, dequeuing through the shared head; "
+                    "the service will not wait for this client if other clients read the stream");
             }
         }
+        ring_reader_status_ = ring_reader_slot_ >= 0 ?
+            RingReaderStatus::kRegistered : RingReaderStatus::kSharedHead;
     }
-    return;
+    else {
+        ring_reader_status_ = RingReaderStatus::kNotBackpressured;
+    }
+    return ring_reader_status_;
 }
 
 
@@ -309,8 +373,48 @@ PM_STATUS StreamClient::ConsumePtrToNextNsmFrameData(const PmNsmFrameData** pNsm
         return PM_STATUS::PM_STATUS_FAILURE;
     }
 
-    // nullify point so that if we exit early it will be null
-    *pNsmData = nullptr;
+    // nullify the pointers so that if we exit early they will be null
+    *pNsmData                                       = nullptr;
+    *pNextFrame                                     = nullptr;
+    *pFrameDataOfNextDisplayed                      = nullptr;
+    *pFrameDataOfLastPresented                      = nullptr;
+    *pFrameDataOfLastAppPresented                   = nullptr;
+    *pFrameDataOfLastDisplayed                      = nullptr;
+    *pFrameDataOfLastAppDisplayed                   = nullptr;
+    *pFrameDataOfPreviousAppFrameOfLastAppDisplayed = nullptr;
+
+    // A batch of one frame has the same neighbors as the frame consumed on its own
+    std::vector<NsmFrameNeighbors> batch;
+    const auto status = PeekNsmFrameBatch(batch, 1);
+    if (status != PM_STATUS::PM_STATUS_SUCCESS || batch.empty()) {
+        return status;
+    }
+    const auto& frame = batch.front();
+    *pNsmData                                       = frame.pFrameData;
+    *pNextFrame                                     = frame.pNextFrame;
+    *pFrameDataOfNextDisplayed                      = frame.pFrameDataOfNextDisplayed;
+    *pFrameDataOfLastPresented                      = frame.pFrameDataOfLastPresented;
+    *pFrameDataOfLastAppPresented                   = frame.pFrameDataOfLastAppPresented;
+    *pFrameDataOfLastDisplayed                      = frame.pFrameDataOfLastDisplayed;
+    *pFrameDataOfLastAppDisplayed                   = frame.pFrameDataOfLastAppDisplayed;
+    *pFrameDataOfPreviousAppFrameOfLastAppDisplayed = frame.pFrameDataOfPreviousAppFrameOfLastAppDisplayed;
+    CommitNsmFrameBatch(1);
+    return PM_STATUS::PM_STATUS_SUCCESS;
+}
+
+void StreamClient::RestartAfterLostFrames(uint64_t lost_frames)
+{
+    lost_frame_count_ += lost_frames;
+    pmlog_warn("NSM frames were overwritten before they could be consumed, restarting from the newest frame")
+        .pmwatch(lost_frames).pmwatch(lost_frame_count_);
+    recording_frame_data_ = false;
+}
+
+PM_STATUS StreamClient::PeekNsmFrameBatch(std::vector<NsmFrameNeighbors>& batch, size_t max_frames)
+{
+    batch.clear();
+    peeked_frames_.clear();
+    neighbor_frames_.clear();
 
     auto nsm_view = GetNamedSharedMemView();
     auto nsm_hdr = nsm_view->GetHeader();
@@ -318,92 +422,116 @@ PM_STATUS StreamClient::ConsumePtrToNextNsmFrameData(const PmNsmFrameData** pNsm
         // Service destroyed the named shared memory.
         return PM_STATUS::PM_STATUS_INVALID_PID;
     }
+    auto ring = nsm_view->GetRingReader();
+    if (ring == nullptr) {
+        return PM_STATUS::PM_STATUS_FAILURE;
+    }
 
     if (recording_frame_data_ == false) {
-        // Get the current number of frames written and set it as the current
-        // dequeue frame number. This will be used to track data overruns if
-        // the client does not read data fast enough.
-        recording_frame_data_ = true;
-        if (nsm_hdr->isPlaybackResetOldest) {
-            // during playback it is desirable to start at the very first frame even if we start consuming late
-            if (nsm_view->IsFull()) {
-                // if nsm is full, we have to dequeue all frames currently in the buffer
-                current_dequeue_frame_num_ = nsm_hdr->num_frames_written - nsm_hdr->max_entries;
-            }
-            else {
-                // if nsm is not full, then we must be in the initial state so set to zero (start from the beginning)
-                current_dequeue_frame_num_ = 0;
-            }
-            // always start from the head (oldest frame)
-            next_dequeue_idx_ = nsm_hdr->head_idx;
-        }
-        else {
-            // at start or after overrun, reset to most recent frame data
-            current_dequeue_frame_num_ = nsm_hdr->num_frames_written;
-            next_dequeue_idx_ = (nsm_hdr->tail_idx + 1) % nsm_hdr->max_entries;
-        }
+        StartRecordingFrameData();
     }
 
-    // Check to see if the number of pending read frames is greater
-    // than the maximum number of entries. If so we have lost frame
-    // data
-    uint64_t num_pending_frames = CheckPendingReadFrames();
-    if (num_pending_frames > nsm_hdr->max_entries) {
-        recording_frame_data_ = false;
+    // The frames before the oldest one in the ring have been (or are being) overwritten, so if
+    // the next frame to dequeue is one of them, the frames from it up to the oldest one are lost
+    const auto num_frames_written = ring->GetNumFramesWritten();
+    const auto oldest_frame = ring->GetOldestFrame(num_frames_written);
+    if (current_dequeue_frame_num_ < oldest_frame) {
+        RestartAfterLostFrames(oldest_frame - current_dequeue_frame_num_);
         return PM_STATUS::PM_STATUS_SUCCESS;
     }
-    else if (num_pending_frames < 2) {
-        // we need at least 2 pending frames to enable peek-ahead
+    // every frame consumed must be followed by at least one more pending frame
+    const auto num_pending_frames = num_frames_written - current_dequeue_frame_num_;
+    if (num_pending_frames < 2 || max_frames == 0) {
         return PM_STATUS::PM_STATUS_SUCCESS;
     }
 
-    // Set the rest of the incoming frame pointers in
-    // preparation for the various frame data peeks and
-    // reads
-    *pNextFrame                                     = nullptr;
-    *pFrameDataOfNextDisplayed                      = nullptr;
-    *pFrameDataOfLastPresented                      = nullptr;
-    *pFrameDataOfLastAppPresented                   = nullptr;
-    *pFrameDataOfLastDisplayed                      = nullptr;
-    *pFrameDataOfLastAppDisplayed                   = nullptr;
-    *pFrameDataOfPreviousAppFrameOfLastAppDisplayed = nullptr;
-
-    // First read the current frame. next_dequeue_idx_ sits
-    // at next frame we need to dequeue.
-    *pNsmData = ReadFrameByIdx(next_dequeue_idx_, true);
-    if (*pNsmData) {
-        // Good so far. Save off the queue index in case
-        // we need to reset
-        auto previous_dequeue_idx = next_dequeue_idx_;
-        // Increment the index to the next frame to dequeue as PeekNextDisplayedFrame expects
-        // the frame to be incremented. Can change this when done debugging so we don't have to
-        // reset the dequeue index.
-        next_dequeue_idx_ = (next_dequeue_idx_ + 1) % nsm_hdr->max_entries;
-        PeekNextFrames(pNextFrame, pFrameDataOfNextDisplayed);
-        if (*pFrameDataOfNextDisplayed == nullptr) {
-            // We were unable to get the next displayed frame. It might not have been displayed
-            // yet. Reset the next_dequeue_idx back to where we first started.
-            next_dequeue_idx_ = previous_dequeue_idx;
-            // Also reset the current and next frame data pointers
-            *pNsmData = nullptr;
-            *pNextFrame = nullptr;
+    // Copy out the frames of the batch and the frame after it, so that the service can't change
+    // them while they are used. The service overwrites frames in order, so if it came around to
+    // one of them meanwhile, all of the frames up to it are lost.
+    const auto frame_count = (size_t)std::min<uint64_t>({ max_frames, kMaxNsmFrameBatch, num_pending_frames - 1 });
+    peeked_frames_.resize(frame_count + 1);
+    for (size_t i = 0; i <= frame_count; i++) {
+        if (CopyFrame(*ring, current_dequeue_frame_num_ + i, peeked_frames_[i]) != NsmFrameState::kReady) {
+            peeked_frames_.clear();
+            RestartAfterLostFrames((std::max)(ring->GetOldestFrame(ring->GetNumFramesWritten()),
+                current_dequeue_frame_num_ + i + 1) - current_dequeue_frame_num_);
             return PM_STATUS::PM_STATUS_SUCCESS;
         }
-        PeekPreviousFrames(
-            pFrameDataOfLastPresented,
-            pFrameDataOfLastAppPresented,
-            pFrameDataOfLastDisplayed,
-            pFrameDataOfLastAppDisplayed,
-            pFrameDataOfPreviousAppFrameOfLastAppDisplayed);
-
-        current_dequeue_frame_num_++;
-        if (nsm_hdr->isPlaybackBackpressured) {
-            nsm_view->DequeueFrameData();
+    }
+
+    // Find the first displayed frame after the batch, then fill in the next
+    // displayed frames from the back of the batch to the front. Frames after the
+    // last displayed one stay pending until a later frame is displayed.
+    const PmNsmFrameData* pNextDisplayed = nullptr;
+    if (IsDisplayedFrame(&peeked_frames_[frame_count])) {
+        pNextDisplayed = &peeked_frames_[frame_count];
+    }
+    else {
+        PmNsmFrameData frame = {};
+        for (auto frame_num = current_dequeue_frame_num_ + frame_count + 1; frame_num < num_frames_written; frame_num++) {
+            if (CopyFrame(*ring, frame_num, frame) != NsmFrameState::kReady) {
+                // the frames before it were overwritten as well, which the next peek finds out
+                break;
+            }
+            if (IsDisplayedFrame(&frame)) {
+                pNextDisplayed = &neighbor_frames_.emplace_back(frame);
+                break;
+            }
+        }
+    }
+    batch.resize(frame_count);
+    for (size_t i = frame_count; i-- > 0;) {
+        auto& frame = batch[i];
+        frame.pFrameData = &peeked_frames_[i];
+        frame.pNextFrame = &peeked_frames_[i + 1];
+        frame.pFrameDataOfNextDisplayed = pNextDisplayed;
+        if (IsDisplayedFrame(frame.pFrameData)) {
+            pNextDisplayed = frame.pFrameData;
         }
+    }
+    while (!batch.empty() && batch.back().pFrameDataOfNextDisplayed == nullptr) {
+        batch.pop_back();
+    }
+    if (batch.empty()) {
         return PM_STATUS::PM_STATUS_SUCCESS;
     }
-    else {
-        return PM_STATUS::PM_STATUS_FAILURE;
+
+    // Only the first frame needs the backward scan. After that, each frame in turn
+    // becomes the last presented (and possibly last displayed, etc.) frame of the
+    // frames that follow it.
+    NsmFrameNeighbors previous;
+    PeekPreviousFrames(*ring, current_dequeue_frame_num_, previous);
+    for (auto& frame : batch) {
+        frame.pFrameDataOfLastPresented = previous.pFrameDataOfLastPresented;
+        frame.pFrameDataOfLastAppPresented = previous.pFrameDataOfLastAppPresented;
+        frame.pFrameDataOfLastDisplayed = previous.pFrameDataOfLastDisplayed;
+        frame.pFrameDataOfLastAppDisplayed = previous.pFrameDataOfLastAppDisplayed;
+        frame.pFrameDataOfPreviousAppFrameOfLastAppDisplayed = previous.pFrameDataOfPreviousAppFrameOfLastAppDisplayed;
+
+        const auto pFrame = frame.pFrameData;
+        previous.pFrameDataOfLastPresented = pFrame;
+        if (IsAppDisplayedFrame(pFrame)) {
+            // the previous app frame is the last app frame before this one
+            previous.pFrameDataOfPreviousAppFrameOfLastAppDisplayed = previous.pFrameDataOfLastAppPresented;
+            previous.pFrameDataOfLastAppDisplayed = pFrame;
+        }
+        if (IsAppFrame(pFrame)) {
+            previous.pFrameDataOfLastAppPresented = pFrame;
+        }
+        if (IsDisplayedFrame(pFrame)) {
+            previous.pFrameDataOfLastDisplayed = pFrame;
+        }
+    }
+    return PM_STATUS::PM_STATUS_SUCCESS;
+}
+
+void StreamClient::CommitNsmFrameBatch(size_t frame_count)
+{
+    auto nsm_view = GetNamedSharedMemView();
+    auto nsm_hdr = nsm_view->GetHeader();
+    current_dequeue_frame_num_ += frame_count;
+    if (nsm_hdr->isPlaybackBackpressured) {
+        DequeueFrames(frame_count);
     }
 }
 
@@ -737,23 +865,6 @@ uint64_t StreamClient::GetLatestFrameIndex() {
   }
 }
 
-// Calculate the number of frames written since the last dequue
-uint64_t StreamClient::CheckPendingReadFrames() {
-  uint64_t num_pending_read_frames = 0;
-
-  auto p_header = shared_mem_view_->GetHeader();
-  if (p_header->num_frames_written < current_dequeue_frame_num_) {
-    // Wrap case where p_header->num_frames_written has wrapped to zero
-    num_pending_read_frames = ULLONG_MAX - current_dequeue_frame_num_;
-    num_pending_read_frames += p_header->num_frames_written;
-  } else {
-    num_pending_read_frames =
-        p_header->num_frames_written - current_dequeue_frame_num_;
-  }
-
-  return num_pending_read_frames;
-}
-
 std::optional<
     std::bitset<static_cast<size_t>(GpuTelemetryCapBits::gpu_telemetry_count)>>
 StreamClient::GetGpuTelemetryCaps() {
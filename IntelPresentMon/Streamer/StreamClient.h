@@ -5,22 +5,37 @@
 #include <thread>
 #include <string>
 #include <map>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
 #include "../PresentMonUtils/StreamFormat.h"
 #include "../PresentMonUtils/LegacyAPIDefines.h"
 #include "NamedSharedMemory.h"
+#include "ColumnarSharedMemory.h"
 
 class StreamClient {
  public:
+  // How the client holds back the service on a backpressured stream
+  enum class RingReaderStatus {
+    kNotBackpressured,  // the stream is not backpressured
+    kRegistered,        // in a reader slot of its own
+    kSharedHead,        // through the shared head, as all reader slots are
+                        // taken; the service only waits for this client if
+                        // no other client reads the stream
+  };
+
   StreamClient();
   StreamClient(std::string mapfile_name, bool is_etl_stream_client);
   ~StreamClient();
 
   void Initialize(std::string mapfile_name);
   bool IsInitialized() { return initialized_; };
-  // Read the latest frame from shared memory.
+  // Copy the latest frame out of shared memory. The copy is kept until the next call.
   PmNsmFrameData* ReadLatestFrame();
-  PmNsmFrameData* ReadFrameByIdx(uint64_t frame_id, bool checked);
-  // Dequeue a frame of data from shared mem and update the last_read_idx (just get pointer to NsmData)
+  // Dequeue a frame of data from shared mem. The frames pointed to are copies that are kept until
+  // the next frame is consumed or peeked.
   PM_STATUS ConsumePtrToNextNsmFrameData(const PmNsmFrameData** pNsmData,
                                          const PmNsmFrameData** pNextFrame,
                                          const PmNsmFrameData** pFrameDataOfNextDisplayed,
@@ -29,6 +44,44 @@ class StreamClient {
                                          const PmNsmFrameData** pFrameDataOfLastDisplayed,
                                          const PmNsmFrameData** pFrameDataOfLastAppDisplayed,
                                          const PmNsmFrameData** pFrameDataOfPreviousAppFrameOfLastAppDisplayed);
+  // A pending frame along with the neighboring frames that ConsumePtrToNextNsmFrameData would
+  // return for it
+  struct NsmFrameNeighbors {
+    const PmNsmFrameData* pFrameData = nullptr;
+    const PmNsmFrameData* pNextFrame = nullptr;
+    const PmNsmFrameData* pFrameDataOfNextDisplayed = nullptr;
+    const PmNsmFrameData* pFrameDataOfLastPresented = nullptr;
+    const PmNsmFrameData* pFrameDataOfLastAppPresented = nullptr;
+    const PmNsmFrameData* pFrameDataOfLastDisplayed = nullptr;
+    const PmNsmFrameData* pFrameDataOfLastAppDisplayed = nullptr;
+    const PmNsmFrameData* pFrameDataOfPreviousAppFrameOfLastAppDisplayed = nullptr;
+  };
+  // Peek at up to max_frames of the pending frames that are ready to be consumed (i.e. are
+  // followed by a displayed frame), resolving the neighbors of all of them in one pass over
+  // the ring instead of scanning around each frame. Nothing is dequeued until
+  // CommitNsmFrameBatch is called with the number of frames that were used. The frames pointed
+  // to are copies that are kept until the next batch is peeked or frame consumed.
+  PM_STATUS PeekNsmFrameBatch(std::vector<NsmFrameNeighbors>& batch, size_t max_frames);
+  // Dequeue the first frame_count frames of the last peeked batch
+  void CommitNsmFrameBatch(size_t frame_count);
+  // Have the frames peeked from here on gathered from the columnar stream published alongside the
+  // ring (see --enable-columnar-nsm) instead of copied whole out of the ring. Only the present
+  // event columns, which the neighbors and metrics of frames are resolved from, and the columns of
+  // the fields at source_offsets are mapped and copied; the other fields of the copies are not to be
+  // relied on.
+  // Returns false, and frames keep being copied out of the ring, if the service does not publish
+  // the stream. Calling it again with the same offsets does nothing.
+  bool OpenColumnarView(std::span<const uint32_t> source_offsets);
+  // Block until min_frames frames are available or timeout_ms has passed, and
+  // return the number of frames available. Frames available are the frames
+  // pending consumption while recording frame data, otherwise the frames
+  // written since the previous wait returned (or since the first wait was
+  // made). Returns early if the process goes away.
+  uint64_t WaitForFrames(uint32_t min_frames, uint32_t timeout_ms);
+  // How the client dequeues frames, as of when it started reading them
+  RingReaderStatus GetRingReaderStatus() const { return ring_reader_status_; }
+  // Number of frames the service overwrote before this client could consume them
+  uint64_t GetLostFrameCount() const { return lost_frame_count_; }
   // Return the last frame id that holds valid data
   uint64_t GetLatestFrameIndex();
   NamedSharedMem* GetNamedSharedMemView() { return shared_mem_view_.get(); }
@@ -47,30 +100,66 @@ class StreamClient {
   GetCpuTelemetryCaps();
 
  private:
-  uint64_t CheckPendingReadFrames();
+  // Most frames copied out of the ring for one batch
+  static constexpr size_t kMaxNsmFrameBatch = 256;
+
+  // Set the dequeue position when starting to read frames or after an overrun
+  RingReaderStatus StartRecordingFrameData();
+  // Give up on the pending frames, the oldest of which the service has overwritten, and start
+  // over on the next frame read; lost_frames is at least how many were overwritten
+  void RestartAfterLostFrames(uint64_t lost_frames);
+  // Release the dequeued frames to the service (backpressured streams only)
+  void DequeueFrames(uint64_t frame_count);
+  void UnregisterRingReader();
+  void UnregisterFrameWaiter();
 
-  // Functions to peek at the next and previous frames
-  void PeekNextFrames(const PmNsmFrameData** pNextFrame,
-                      const PmNsmFrameData** pNextDisplayedFrame);
-  void PeekPreviousFrames(const PmNsmFrameData** pFrameDataOfLastPresented,
-                          const PmNsmFrameData** pFrameDataOfLastAppPresented,
-                          const PmNsmFrameData** pFrameDataOfLastDisplayed,
-                          const PmNsmFrameData** pFrameDataOfLastAppDisplayed,
-                          const PmNsmFrameData** pFrameDataOfPreviousAppFrameOfLastAppDisplayed);
+  // Copy a frame out of the columnar view if one is open, otherwise out of the ring; the copy is
+  // only valid if kReady is returned
+  NsmFrameState CopyFrame(const NsmRingReader& ring, uint64_t frame_num, PmNsmFrameData& frame) const;
+  // Copy the frames before frame_num that are its previous frames, back to the oldest frame in
+  // the ring, into neighbor_frames_
+  void PeekPreviousFrames(const NsmRingReader& ring, uint64_t frame_num,
+                          NsmFrameNeighbors& neighbors);
 
   // Helper functions evaluater various frame types
   bool IsAppPresentedFrame(const PmNsmFrameData* frame) const;
   bool IsDisplayedFrame(const PmNsmFrameData* frame) const;
   bool IsAppDisplayedFrame(const PmNsmFrameData* frame) const;
+  // App frame as used when looking for previous app frames, where frames that were not
+  // displayed are assumed to be from the application
+  bool IsAppFrame(const PmNsmFrameData* frame) const;
 
   // Shared memory view that the client opened into based on mapfile name
   std::unique_ptr<NamedSharedMem> shared_mem_view_;
   // mapfile name the client has for named shared memory
   std::string mapfile_name_;
+  // Columnar stream frames are gathered from, if one was opened, and the source offsets it was
+  // last asked to open with
+  std::unique_ptr<ColumnarSharedMem> columnar_view_;
+  std::optional<std::vector<uint32_t>> columnar_view_offsets_;
   // Last read offset from the shared_mem_view_
   bool initialized_;
   LARGE_INTEGER qpcFrequency_ = {};
-  uint64_t next_dequeue_idx_;
   bool recording_frame_data_;
+  // Number of the next frame to dequeue
   uint64_t current_dequeue_frame_num_;
+  uint64_t lost_frame_count_ = 0;
+  // Copies of the frames of the last peeked batch and the frame after it
+  std::vector<PmNsmFrameData> peeked_frames_;
+  // Copies of the other frames the last peeked batch points to; a deque so that they don't move
+  std::deque<PmNsmFrameData> neighbor_frames_;
+  // Copy of the frame returned by ReadLatestFrame
+  PmNsmFrameData latest_frame_ = {};
+  // Slot this client registered in to hold back the service on a backpressured
+  // stream, or -1 if not registered
+  int ring_reader_slot_ = -1;
+  RingReaderStatus ring_reader_status_ = RingReaderStatus::kNotBackpressured;
+  // Slot this client waits for frames in, or -1 if it has not waited yet or
+  // there was no free slot
+  int frame_waiter_slot_ = -1;
+  // Whether the previous wait for frames polled, for lack of a waiter slot or
+  // its event
+  bool polling_for_frames_ = false;
+  // Frame count when the previous wait for frames returned
+  std::optional<uint64_t> last_waited_frame_num_;
 };
\ No newline at end of file
@@ -34,6 +34,9 @@ Streamer::Streamer()
 {
     if (clio::Options::IsInitialized()) {
         mapfileNamePrefix_ = clio::Options::Get().nsmPrefix.AsOptional().value_or(mapfileNamePrefix_);
+        columnar_nsm_enabled_ = (bool)clio::Options::Get().enableColumnarNsm;
+        history_size_ = uint64_t(*clio::Options::Get().nsmHistorySize) * 1024 * 1024;
+        metric_cache_enabled_ = (bool)clio::Options::Get().enableMetricCache;
     }
 }
 
@@ -66,9 +69,18 @@ void Streamer::WriteFrameData(
     }
     shared_mem->WriteTelemetryCapBits(gpu_telemetry_cap_bits,
                                       cpu_telemetry_cap_bits);
+    // the columnar row goes first, so that a frame the ring publishes always has its row
+    WriteColumnarFrameData(process_id, *data);
     shared_mem->WriteFrameData(data);
 }
 
+void Streamer::WriteColumnarFrameData(uint32_t process_id, const PmNsmFrameData& data) {
+    auto iter = process_columnar_mem_map_.find(process_id);
+    if (iter != process_columnar_mem_map_.end()) {
+        iter->second->GetWriter()->WriteFrameData(data);
+    }
+}
+
 void Streamer::CopyFromPresentMonPresentEvent(
     PresentEvent* present_event, PmNsmPresentEvent* nsm_present_event) {
     if (present_event == nullptr || nsm_present_event == nullptr) {
@@ -169,73 +181,159 @@ void Streamer::ProcessPresentEvent(
         gpu_telemetry_cap_bits,
     std::bitset<static_cast<size_t>(CpuTelemetryCapBits::cpu_telemetry_count)>
         cpu_telemetry_cap_bits) {
-    uint32_t process_id = present_event->ProcessId;
+    const StreamedPresent present{
+        present_event, power_telemetry_info, cpu_telemetry_info,
+        last_present_qpc, last_displayed_qpc, &app_name };
+    ProcessPresentEvents({ &present, 1 }, gpu_telemetry_cap_bits,
+                         cpu_telemetry_cap_bits);
+}
 
+void Streamer::ProcessPresentEvents(
+    std::span<const StreamedPresent> presents,
+    std::bitset<static_cast<size_t>(GpuTelemetryCapBits::gpu_telemetry_count)>
+        gpu_telemetry_cap_bits,
+    std::bitset<static_cast<size_t>(CpuTelemetryCapBits::cpu_telemetry_count)>
+        cpu_telemetry_cap_bits) {
     // Lock the nsm mutex as stop streaming calls can occur at any time
     // and destroy the named shared memory during writing of frame data.
     std::lock_guard<std::mutex> lock(nsm_map_mutex_);
 
-    // Search for the requested process
-    auto iter = process_shared_mem_map_.find(process_id);
-    NamedSharedMem* process_nsm = nullptr;
-    if (iter != process_shared_mem_map_.end()) {
-      process_nsm = iter->second.get();
-      // Record start time if it's the first frame.
-      if (process_nsm->IsEmpty()) {
-          if (start_qpc_ && process_nsm->GetHeader()->isPlayback) {
-              process_nsm->RecordFirstFrameTime(start_qpc_);
-          }
-          else {
-              process_nsm->RecordFirstFrameTime(present_event->PresentStartTime);
-          }
-      }
-    }
-
-    // In addition search for the stream all process
+    // In addition to the process streams, search for the stream all process
     auto stream_all_iter = process_shared_mem_map_.find(
         (uint32_t)StreamPidOverride::kStreamAllPid);
     NamedSharedMem* stream_all_nsm = nullptr;
     if (stream_all_iter != process_shared_mem_map_.end()) {
       stream_all_nsm = stream_all_iter->second.get();
-      // Record start time if it's the first frame.
-      if (stream_all_nsm->IsEmpty()) {
-        if (start_qpc_ && stream_all_nsm->GetHeader()->isPlayback) {
-            stream_all_nsm->RecordFirstFrameTime(start_qpc_);
+    }
+
+    batch_frames_.clear();
+    batch_frame_nsms_.clear();
+    for (auto& present : presents) {
+      auto present_event = present.present_event;
+      // Search for the requested process
+      auto iter = process_shared_mem_map_.find(present_event->ProcessId);
+      NamedSharedMem* process_nsm = nullptr;
+      if (iter != process_shared_mem_map_.end()) {
+        process_nsm = iter->second.get();
+      }
+      if ((process_nsm == nullptr) && (stream_all_nsm == nullptr)) {
+        // process is not being monitored. Skip.
+        continue;
+      }
+
+      // Record start time if it's the first frame. The streams only get the
+      // frames of the batch at the end, so only look at their first one.
+      if (process_nsm &&
+          std::find(batch_frame_nsms_.begin(), batch_frame_nsms_.end(),
+                    process_nsm) == batch_frame_nsms_.end()) {
+        RecordFirstFrameTime(process_nsm, present_event->PresentStartTime);
+      }
+      if (stream_all_nsm && batch_frames_.empty()) {
+        RecordFirstFrameTime(stream_all_nsm, present_event->PresentStartTime);
+      }
+
+      auto& data = batch_frames_.emplace_back();
+      // Copy the passed in PresentEvent data into the PmNsmFrameData
+      // structure.
+      CopyFromPresentMonPresentEvent(present_event, &data.present_event);
+      // Now update the necessary qpcs and application name which
+      // reside AFTER the PresentEvent members and hence were not
+      // updated in the copy above.
+      data.present_event.last_present_qpc = present.last_present_qpc;
+      data.present_event.last_displayed_qpc = present.last_displayed_qpc;
+      auto appNameNarrow = pmon::util::str::ToNarrow(*present.app_name);
+      std::size_t length = appNameNarrow.copy(data.present_event.application, appNameNarrow.size());
+      data.present_event.application[length] = '\0';
+      // Now copy the power telemetry data
+      memcpy_s(&data.power_telemetry, sizeof(PresentMonPowerTelemetryInfo),
+               present.power_telemetry_info, sizeof(PresentMonPowerTelemetryInfo));
+      // Finally copy the cpu telemetry data
+      memcpy_s(&data.cpu_telemetry, sizeof(CpuTelemetryInfo), present.cpu_telemetry_info,
+               sizeof(CpuTelemetryInfo));
+      batch_frame_nsms_.push_back(process_nsm);
+    }
+    if (batch_frames_.empty()) {
+      return;
+    }
+
+    // Write each process stream its frames. The batch is usually all of one
+    // process and is written as is, otherwise each process's frames are
+    // gathered when its first frame comes up.
+    const auto first_nsm = batch_frame_nsms_.front();
+    if (std::all_of(batch_frame_nsms_.begin(), batch_frame_nsms_.end(),
+                    [first_nsm](auto nsm) { return nsm == first_nsm; })) {
+      if (first_nsm &&
+          !WriteStreamFrames(batch_frames_.front().present_event.ProcessId, first_nsm,
+                             batch_frames_, gpu_telemetry_cap_bits, cpu_telemetry_cap_bits)) {
+        return;
+      }
+    }
+    else {
+      for (size_t i = 0; i < batch_frames_.size(); i++) {
+        auto process_nsm = batch_frame_nsms_[i];
+        if (process_nsm == nullptr ||
+            std::find(batch_frame_nsms_.begin(), batch_frame_nsms_.begin() + i,
+                      process_nsm) != batch_frame_nsms_.begin() + i) {
+          continue;
+        }
+        stream_frames_.clear();
+        for (size_t j = i; j < batch_frames_.size(); j++) {
+          if (batch_frame_nsms_[j] == process_nsm) {
+            stream_frames_.push_back(batch_frames_[j]);
+          }
         }
-        else {
-            stream_all_nsm->RecordFirstFrameTime(present_event->PresentStartTime);
+        if (!WriteStreamFrames(batch_frames_[i].present_event.ProcessId, process_nsm,
+                               stream_frames_, gpu_telemetry_cap_bits, cpu_telemetry_cap_bits)) {
+          return;
         }
       }
     }
 
-    if ((process_nsm == nullptr) && (stream_all_nsm == nullptr)) {
-      // process is not being monitored. Skip.
+    if (stream_all_nsm) {
+      WriteStreamFrames((uint32_t)StreamPidOverride::kStreamAllPid, stream_all_nsm,
+                        batch_frames_, gpu_telemetry_cap_bits, cpu_telemetry_cap_bits);
+    }
+}
+
+void Streamer::RecordFirstFrameTime(NamedSharedMem* nsm, uint64_t present_start_time) {
+    if (!nsm->IsEmpty()) {
       return;
     }
+    if (start_qpc_ && nsm->GetHeader()->isPlayback) {
+      nsm->RecordFirstFrameTime(start_qpc_);
+    }
+    else {
+      nsm->RecordFirstFrameTime(present_start_time);
+    }
+}
+
+bool Streamer::WriteStreamFrames(
+    uint32_t process_id, NamedSharedMem* nsm,
+    std::span<const PmNsmFrameData> frames,
+    std::bitset<static_cast<size_t>(GpuTelemetryCapBits::gpu_telemetry_count)>
+        gpu_telemetry_cap_bits,
+    std::bitset<static_cast<size_t>(CpuTelemetryCapBits::cpu_telemetry_count)>
+        cpu_telemetry_cap_bits) {
+    nsm->WriteTelemetryCapBits(gpu_telemetry_cap_bits, cpu_telemetry_cap_bits);
+    auto pHdr = nsm->GetHeader();
+    if (!pHdr->isPlaybackBackpressured) {
+      // The columnar rows of a batch go before the ring publishes it, so that every frame in the
+      // ring has its row. Batches are at most as long as the ring's, which keeps the columns
+      // within a ring's length ahead of it.
+      const auto max_batch = size_t(pHdr->max_entries - 1);
+      for (size_t start = 0; start < frames.size(); start += max_batch) {
+        const auto batch = frames.subspan(start, (std::min)(frames.size() - start, max_batch));
+        for (auto& data : batch) {
+          WriteColumnarFrameData(process_id, data);
+        }
+        nsm->WriteFrameData(batch);
+      }
+      return true;
+    }
 
-    PmNsmFrameData data = {};
-    // Copy the passed in PresentEvent data into the PmNsmFrameData
-    // structure.
-    CopyFromPresentMonPresentEvent(present_event, &data.present_event);
-    // Now update the necessary qpcs and application name which
-    // reside AFTER the PresentEvent members and hence were not
-    // updated in the copy above.
-    data.present_event.last_present_qpc = last_present_qpc;
-    data.present_event.last_displayed_qpc = last_displayed_qpc;
-    auto appNameNarrow = pmon::util::str::ToNarrow(app_name);
-    std::size_t length = appNameNarrow.copy(data.present_event.application, appNameNarrow.size());
-    data.present_event.application[length] = '\0';
-    // Now copy the power telemetry data
-    memcpy_s(&data.power_telemetry, sizeof(PresentMonPowerTelemetryInfo),
-             power_telemetry_info, sizeof(PresentMonPowerTelemetryInfo));
-    // Finally copy the cpu telemetry data
-    memcpy_s(&data.cpu_telemetry, sizeof(CpuTelemetryInfo), cpu_telemetry_info,
-             sizeof(CpuTelemetryInfo));
-
-    if (process_nsm) {
-      auto pHdr = process_nsm->GetHeader();
+    for (auto& data : frames) {
       // block here if nsm is full and backpressure is enabled (only in playback modes)
-      if (pHdr->isPlaybackBackpressured && process_nsm->IsFull()) {
+      if (nsm->IsFull()) {
           const auto start = std::chrono::high_resolution_clock::now();
           do {
               const auto now = std::chrono::high_resolution_clock::now();
@@ -247,20 +345,14 @@ void Streamer::ProcessPresentEvent(
               if (time_elapsed >= kTimeoutLimitMs) {
                   LOG(ERROR) << "\nServer data write timed out.";
                   write_timedout_ = true;
-                  return;
+                  return false;
               }
-          } while (process_nsm->IsFull());
+          } while (nsm->IsFull());
       }
-      process_nsm->WriteTelemetryCapBits(gpu_telemetry_cap_bits,
-                                         cpu_telemetry_cap_bits);
-      process_nsm->WriteFrameData(&data);
-    }
-
-    if (stream_all_nsm) {
-      stream_all_nsm->WriteTelemetryCapBits(gpu_telemetry_cap_bits,
-                                            cpu_telemetry_cap_bits);
-      stream_all_nsm->WriteFrameData(&data);
+      WriteColumnarFrameData(process_id, data);
+      nsm->WriteFrameData(std::span<const PmNsmFrameData>{ &data, 1 });
     }
+    return true;
 }
 
 
@@ -331,6 +423,7 @@ bool Streamer::UpdateNSMAttachments(uint32_t process_id, int& ref_count) {
     } else {
       iter->second->NotifyProcessKilled();
       process_shared_mem_map_.erase(std::move(iter));
+      process_columnar_mem_map_.erase(process_id);
       ref_count = 0;
     }
     return true;
@@ -422,6 +515,7 @@ void Streamer::StopAllStreams() {
     it.second->NotifyProcessKilled();
   }
   process_shared_mem_map_.clear();
+  process_columnar_mem_map_.clear();
   client_map_.clear();
   write_timedout_ = false;
 }
@@ -446,6 +540,23 @@ bool Streamer::CreateNamedSharedMemory(DWORD process_id,
             isPlaybackBackpressured,
             isPlaybackResetOldest);
     if (nsm->IsNSMCreated()) {
+        if (columnar_nsm_enabled_) {
+            // Rows are written before the ring publishes their frames, so the columns can be up
+            // to a ring's length ahead of it; twice the ring's length keeps every frame in the
+            // ring in the columns
+            auto columnar = std::make_unique<ColumnarSharedMem>();
+            if (columnar->Create(nsm->GetMapFileName() + kColumnarSuffix, 2 * uint64_t(nsm->GetHeader()->max_entries))) {
+                process_columnar_mem_map_.emplace(process_id, std::move(columnar));
+            } else {
+                LOG(INFO) << "Unable to create columnar NSM for process id:" << process_id;
+            }
+        }
+        if (history_size_ > 0 && FAILED(nsm->EnableHistory(history_size_))) {
+            LOG(INFO) << "Unable to create frame history for process id:" << process_id;
+        }
+        if (metric_cache_enabled_ && FAILED(nsm->EnableMetricCache())) {
+            LOG(INFO) << "Unable to create metric cache for process id:" << process_id;
+        }
         process_shared_mem_map_.emplace(process_id, std::move(nsm));
         return true;
     } else {
@@ -7,10 +7,23 @@
 #include <string>
 #include <map>
 #include <set>
+#include <span>
+#include <vector>
 
 #include "../PresentMonUtils/StreamFormat.h"
 #include "gtest/gtest.h"
 #include "NamedSharedMemory.h"
+#include "ColumnarSharedMemory.h"
+
+// A present to stream, with the telemetry and swap chain state attached to it
+struct StreamedPresent {
+  PresentEvent* present_event;
+  const PresentMonPowerTelemetryInfo* power_telemetry_info;
+  const CpuTelemetryInfo* cpu_telemetry_info;
+  uint64_t last_present_qpc;
+  uint64_t last_displayed_qpc;
+  const std::wstring* app_name;
+};
 
 class Streamer {
  public:
@@ -42,6 +55,15 @@ class Streamer {
           gpu_telemetry_cap_bits,
       std::bitset<static_cast<size_t>(CpuTelemetryCapBits::cpu_telemetry_count)>
           cpu_telemetry_cap_bits);
+  // Stream a batch of presents, in the order they were dequeued. Each stream
+  // gets its frames of the batch written with a single update of its ring
+  // header (see NsmRingWriter::WriteFrames).
+  void ProcessPresentEvents(
+      std::span<const StreamedPresent> presents,
+      std::bitset<static_cast<size_t>(GpuTelemetryCapBits::gpu_telemetry_count)>
+          gpu_telemetry_cap_bits,
+      std::bitset<static_cast<size_t>(CpuTelemetryCapBits::cpu_telemetry_count)>
+          cpu_telemetry_cap_bits);
 
   void WriteFrameData(
       uint32_t process_id, PmNsmFrameData* data,
@@ -67,9 +89,32 @@ class Streamer {
   void CopyFromPresentMonPresentEvent(PresentEvent* present_event,
                                       PmNsmPresentEvent* nsm_present_event);
   bool UpdateNSMAttachments(uint32_t process_id, int& ref_count);
+  // Write a frame to the process's columnar stream, if it has one. Function assumes the NSM map
+  // mutex is held.
+  void WriteColumnarFrameData(uint32_t process_id, const PmNsmFrameData& data);
+  // Record the start time of a stream about to get its first frame. Function assumes the NSM map
+  // mutex is held.
+  void RecordFirstFrameTime(NamedSharedMem* nsm, uint64_t present_start_time);
+  // Write frames to a stream and its columnar stream, waiting for room frame by frame if the
+  // stream is backpressured. Returns false if that timed out. Function assumes the NSM map mutex
+  // is held.
+  bool WriteStreamFrames(
+      uint32_t process_id, NamedSharedMem* nsm,
+      std::span<const PmNsmFrameData> frames,
+      std::bitset<static_cast<size_t>(GpuTelemetryCapBits::gpu_telemetry_count)>
+          gpu_telemetry_cap_bits,
+      std::bitset<static_cast<size_t>(CpuTelemetryCapBits::cpu_telemetry_count)>
+          cpu_telemetry_cap_bits);
   std::string mapfileNamePrefix_;
   // Shared mem buffer map of process id and share mem handle
   std::map<DWORD, std::unique_ptr<NamedSharedMem>> process_shared_mem_map_;
+  // Columnar streams published alongside the shared mem buffers (see --enable-columnar-nsm)
+  std::map<DWORD, std::unique_ptr<ColumnarSharedMem>> process_columnar_mem_map_;
+  bool columnar_nsm_enabled_ = false;
+  // Size of the compressed history kept behind each shared mem buffer (see --nsm-history-size)
+  uint64_t history_size_ = 4 * 1024 * 1024;
+  // Whether shared mem buffers get a metric cache (see --enable-metric-cache)
+  bool metric_cache_enabled_ = false;
   std::multimap<uint32_t, uint32_t> client_map_;
   uint64_t shared_mem_size_;
   uint64_t start_qpc_;
@@ -79,4 +124,9 @@ class Streamer {
   // stop the trace session. 
   bool write_timedout_;
   mutable std::mutex nsm_map_mutex_;
+  // Frames of the batch being streamed and the process stream each goes to,
+  // kept to reuse their storage. Guarded by the NSM map mutex.
+  std::vector<PmNsmFrameData> batch_frames_;
+  std::vector<NamedSharedMem*> batch_frame_nsms_;
+  std::vector<PmNsmFrameData> stream_frames_;
 };
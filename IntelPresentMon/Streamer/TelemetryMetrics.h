@@ -0,0 +1,176 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "../PresentMonUtils/StreamFormat.h"
+
+// Metric samples carried by the telemetry of a frame. The middleware feeds them into the windows of
+// dynamic queries and the service into the windows of the metric cache (see SharedMetricCache.h),
+// so that both compute the same statistics.
+
+// Calls sample(metric, array_index, value) for each metric sample that the GPU telemetry item
+// telemetry_bit of a frame gives. Returns false if the item gives none.
+template <class F>
+bool ForEachGpuTelemetrySample(size_t telemetry_bit, const PresentMonPowerTelemetryInfo& info, F&& sample) {
+  switch (static_cast<GpuTelemetryCapBits>(telemetry_bit)) {
+    case GpuTelemetryCapBits::time_stamp:
+      // a valid telemetry cap bit, but no metric is produced for it
+      return false;
+    case GpuTelemetryCapBits::gpu_power:
+      sample(PM_METRIC_GPU_POWER, 0, info.gpu_power_w);
+      return true;
+    case GpuTelemetryCapBits::gpu_voltage:
+      sample(PM_METRIC_GPU_VOLTAGE, 0, info.gpu_voltage_v);
+      return true;
+    case GpuTelemetryCapBits::gpu_frequency:
+      sample(PM_METRIC_GPU_FREQUENCY, 0, info.gpu_frequency_mhz);
+      return true;
+    case GpuTelemetryCapBits::gpu_temperature:
+      sample(PM_METRIC_GPU_TEMPERATURE, 0, info.gpu_temperature_c);
+      return true;
+    case GpuTelemetryCapBits::gpu_utilization:
+      sample(PM_METRIC_GPU_UTILIZATION, 0, info.gpu_utilization);
+      return true;
+    case GpuTelemetryCapBits::gpu_render_compute_utilization:
+      sample(PM_METRIC_GPU_RENDER_COMPUTE_UTILIZATION, 0, info.gpu_render_compute_utilization);
+      return true;
+    case GpuTelemetryCapBits::gpu_media_utilization:
+      sample(PM_METRIC_GPU_MEDIA_UTILIZATION, 0, info.gpu_media_utilization);
+      return true;
+    case GpuTelemetryCapBits::vram_power:
+      sample(PM_METRIC_GPU_MEM_POWER, 0, info.vram_power_w);
+      return true;
+    case GpuTelemetryCapBits::vram_voltage:
+      sample(PM_METRIC_GPU_MEM_VOLTAGE, 0, info.vram_voltage_v);
+      return true;
+    case GpuTelemetryCapBits::vram_frequency:
+      sample(PM_METRIC_GPU_MEM_FREQUENCY, 0, info.vram_frequency_mhz);
+      return true;
+    case GpuTelemetryCapBits::vram_effective_frequency:
+      sample(PM_METRIC_GPU_MEM_EFFECTIVE_FREQUENCY, 0, info.vram_effective_frequency_gbps);
+      return true;
+    case GpuTelemetryCapBits::vram_temperature:
+      sample(PM_METRIC_GPU_MEM_TEMPERATURE, 0, info.vram_temperature_c);
+      return true;
+    case GpuTelemetryCapBits::fan_speed_0:
+      sample(PM_METRIC_GPU_FAN_SPEED, 0, info.fan_speed_rpm[0]);
+      return true;
+    case GpuTelemetryCapBits::fan_speed_1:
+      sample(PM_METRIC_GPU_FAN_SPEED, 1, info.fan_speed_rpm[1]);
+      return true;
+    case GpuTelemetryCapBits::fan_speed_2:
+      sample(PM_METRIC_GPU_FAN_SPEED, 2, info.fan_speed_rpm[2]);
+      return true;
+    case GpuTelemetryCapBits::fan_speed_3:
+      sample(PM_METRIC_GPU_FAN_SPEED, 3, info.fan_speed_rpm[3]);
+      return true;
+    case GpuTelemetryCapBits::fan_speed_4:
+      sample(PM_METRIC_GPU_FAN_SPEED, 4, info.fan_speed_rpm[4]);
+      return true;
+    case GpuTelemetryCapBits::max_fan_speed_0:
+      sample(PM_METRIC_GPU_FAN_SPEED_PERCENT, 0, info.fan_speed_rpm[0] / double(info.max_fan_speed_rpm[0]));
+      return true;
+    case GpuTelemetryCapBits::max_fan_speed_1:
+      sample(PM_METRIC_GPU_FAN_SPEED_PERCENT, 1, info.fan_speed_rpm[0] / double(info.max_fan_speed_rpm[1]));
+      return true;
+    case GpuTelemetryCapBits::max_fan_speed_2:
+      sample(PM_METRIC_GPU_FAN_SPEED_PERCENT, 2, info.fan_speed_rpm[0] / double(info.max_fan_speed_rpm[2]));
+      return true;
+    case GpuTelemetryCapBits::max_fan_speed_3:
+      sample(PM_METRIC_GPU_FAN_SPEED_PERCENT, 3, info.fan_speed_rpm[0] / double(info.max_fan_speed_rpm[3]));
+      return true;
+    case GpuTelemetryCapBits::max_fan_speed_4:
+      sample(PM_METRIC_GPU_FAN_SPEED_PERCENT, 4, info.fan_speed_rpm[0] / double(info.max_fan_speed_rpm[4]));
+      return true;
+    case GpuTelemetryCapBits::gpu_mem_used:
+      sample(PM_METRIC_GPU_MEM_USED, 0, static_cast<double>(info.gpu_mem_used_b));
+      return true;
+    case GpuTelemetryCapBits::gpu_mem_write_bandwidth:
+      sample(PM_METRIC_GPU_MEM_WRITE_BANDWIDTH, 0, info.gpu_mem_write_bandwidth_bps);
+      return true;
+    case GpuTelemetryCapBits::gpu_mem_read_bandwidth:
+      sample(PM_METRIC_GPU_MEM_READ_BANDWIDTH, 0, info.gpu_mem_read_bandwidth_bps);
+      return true;
+    case GpuTelemetryCapBits::gpu_power_limited:
+      sample(PM_METRIC_GPU_POWER_LIMITED, 0, info.gpu_power_limited);
+      return true;
+    case GpuTelemetryCapBits::gpu_temperature_limited:
+      sample(PM_METRIC_GPU_TEMPERATURE_LIMITED, 0, info.gpu_temperature_limited);
+      return true;
+    case GpuTelemetryCapBits::gpu_current_limited:
+      sample(PM_METRIC_GPU_CURRENT_LIMITED, 0, info.gpu_current_limited);
+      return true;
+    case GpuTelemetryCapBits::gpu_voltage_limited:
+      sample(PM_METRIC_GPU_VOLTAGE_LIMITED, 0, info.gpu_voltage_limited);
+      return true;
+    case GpuTelemetryCapBits::gpu_utilization_limited:
+      sample(PM_METRIC_GPU_UTILIZATION_LIMITED, 0, info.gpu_utilization_limited);
+      return true;
+    case GpuTelemetryCapBits::vram_power_limited:
+      sample(PM_METRIC_GPU_MEM_POWER_LIMITED, 0, info.vram_power_limited);
+      return true;
+    case GpuTelemetryCapBits::vram_temperature_limited:
+      sample(PM_METRIC_GPU_MEM_TEMPERATURE_LIMITED, 0, info.vram_temperature_limited);
+      return true;
+    case GpuTelemetryCapBits::vram_current_limited:
+      sample(PM_METRIC_GPU_MEM_CURRENT_LIMITED, 0, info.vram_current_limited);
+      return true;
+    case GpuTelemetryCapBits::vram_voltage_limited:
+      sample(PM_METRIC_GPU_MEM_VOLTAGE_LIMITED, 0, info.vram_voltage_limited);
+      return true;
+    case GpuTelemetryCapBits::vram_utilization_limited:
+      sample(PM_METRIC_GPU_MEM_UTILIZATION_LIMITED, 0, info.vram_utilization_limited);
+      return true;
+    case GpuTelemetryCapBits::gpu_effective_frequency:
+      sample(PM_METRIC_GPU_EFFECTIVE_FREQUENCY, 0, info.gpu_effective_frequency_mhz);
+      return true;
+    case GpuTelemetryCapBits::gpu_voltage_regulator_temperature:
+      sample(PM_METRIC_GPU_VOLTAGE_REGULATOR_TEMPERATURE, 0, info.gpu_voltage_regulator_temperature_c);
+      return true;
+    case GpuTelemetryCapBits::gpu_mem_effective_bandwidth:
+      sample(PM_METRIC_GPU_MEM_EFFECTIVE_BANDWIDTH, 0, info.gpu_mem_effective_bandwidth_gbps);
+      return true;
+    case GpuTelemetryCapBits::gpu_overvoltage_percent:
+      sample(PM_METRIC_GPU_OVERVOLTAGE_PERCENT, 0, info.gpu_overvoltage_percent);
+      return true;
+    case GpuTelemetryCapBits::gpu_temperature_percent:
+      sample(PM_METRIC_GPU_TEMPERATURE_PERCENT, 0, info.gpu_temperature_percent);
+      return true;
+    case GpuTelemetryCapBits::gpu_power_percent:
+      sample(PM_METRIC_GPU_POWER_PERCENT, 0, info.gpu_power_percent);
+      return true;
+    case GpuTelemetryCapBits::gpu_card_power:
+      sample(PM_METRIC_GPU_CARD_POWER, 0, info.gpu_card_power_w);
+      return true;
+    case GpuTelemetryCapBits::gpu_frame_energy:
+      sample(PM_METRIC_GPU_FRAME_ENERGY, 0, info.gpu_frame_energy_j);
+      sample(PM_METRIC_GPU_FRAME_POWER, 0, info.gpu_frame_power_w);
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Calls sample(metric, array_index, value) for each metric sample that the CPU telemetry item
+// telemetry_bit of a frame gives. Returns false if the item gives none.
+template <class F>
+bool ForEachCpuTelemetrySample(size_t telemetry_bit, const CpuTelemetryInfo& info, F&& sample) {
+  switch (static_cast<CpuTelemetryCapBits>(telemetry_bit)) {
+    case CpuTelemetryCapBits::cpu_utilization:
+      sample(PM_METRIC_CPU_UTILIZATION, 0, info.cpu_utilization);
+      return true;
+    case CpuTelemetryCapBits::cpu_power:
+      sample(PM_METRIC_CPU_POWER, 0, info.cpu_power_w);
+      return true;
+    case CpuTelemetryCapBits::cpu_temperature:
+      sample(PM_METRIC_CPU_TEMPERATURE, 0, info.cpu_temperature);
+      return true;
+    case CpuTelemetryCapBits::cpu_frequency:
+      sample(PM_METRIC_CPU_FREQUENCY, 0, info.cpu_frequency);
+      return true;
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,179 @@
+#include "gtest/gtest.h"
+#include "../../PresentData/CaptureFile.hpp"
+
+#include <Windows.h>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::wstring TempPath(wchar_t const* name)
+	{
+		wchar_t dir[MAX_PATH];
+		GetTempPathW(MAX_PATH, dir);
+		return std::wstring{ dir } + name;
+	}
+
+	std::vector<CaptureColumn> TestColumns()
+	{
+		return {
+			{ L"Application", CaptureColumnType::String, 0 },
+			{ L"SyncInterval", CaptureColumnType::Int32, 0 },
+			{ L"SwapChainAddress", CaptureColumnType::Hex64, 0 },
+			{ L"MsBetweenPresents", CaptureColumnType::Double, 4 },
+			{ L"CPUStartQPC", CaptureColumnType::UInt64, 0 },
+		};
+	}
+
+	void PushTestRow(CaptureFileWriter& writer, int i)
+	{
+		writer.PushString(i % 3 ? L"game.exe" : L"a_much_longer_process_name.exe");
+		writer.PushInteger(uint64_t(int64_t(i % 5 - 2)));
+		writer.PushInteger(0x1234'0000ull + i % 2);
+		writer.PushDouble(i % 7 ? i * 0.5 : std::numeric_limits<double>::quiet_NaN());
+		writer.PushInteger(1'000'000'000ull + i * 16'666ull);
+		writer.EndRow();
+	}
+
+	void ExpectTestRow(CaptureFileReader const& reader, uint32_t row, int i)
+	{
+		EXPECT_EQ(i % 3 ? L"game.exe" : L"a_much_longer_process_name.exe", reader.GetString(0, row));
+		EXPECT_EQ(int64_t(i % 5 - 2), int64_t(reader.GetInteger(1, row)));
+		EXPECT_EQ(0x1234'0000ull + i % 2, reader.GetInteger(2, row));
+		if (i % 7) {
+			EXPECT_EQ(i * 0.5, reader.GetDouble(3, row));
+		}
+		else {
+			EXPECT_TRUE(std::isnan(reader.GetDouble(3, row)));
+		}
+		EXPECT_EQ(1'000'000'000ull + i * 16'666ull, reader.GetInteger(4, row));
+	}
+}
+
+TEST(CaptureFile, RoundTripsRowsAcrossBlocks)
+{
+	const auto path = TempPath(L"pm-ult-capture.pmcap");
+	constexpr int rowCount = 10'000;
+	{
+		CaptureFileWriter writer;
+		ASSERT_TRUE(writer.Open(path.c_str(), TestColumns(), 10'000'000, 5, 6));
+		for (int i = 0; i < rowCount; i++) {
+			PushTestRow(writer, i);
+		}
+		writer.Close();
+	}
+
+	CaptureFileReader reader;
+	ASSERT_TRUE(reader.Open(path.c_str()));
+	EXPECT_EQ(10'000'000u, reader.GetHeader().TimestampFrequency);
+	ASSERT_EQ(5u, reader.GetColumns().size());
+	EXPECT_EQ(L"SwapChainAddress", reader.GetColumns()[2].Name);
+	EXPECT_EQ(CaptureColumnType::Double, reader.GetColumns()[3].Type);
+
+	int i = 0;
+	while (reader.ReadBlock()) {
+		for (uint32_t row = 0; row < reader.GetRowCount(); row++, i++) {
+			ExpectTestRow(reader, row, i);
+		}
+	}
+	EXPECT_EQ(rowCount, i);
+	reader.Close();
+	DeleteFileW(path.c_str());
+}
+
+TEST(CaptureFile, ReaderFollowsFileBeingWritten)
+{
+	const auto path = TempPath(L"pm-ult-capture-live.pmcap");
+	CaptureFileWriter writer;
+	ASSERT_TRUE(writer.Open(path.c_str(), TestColumns(), 10'000'000, 0, 0));
+
+	CaptureFileReader reader;
+	ASSERT_TRUE(reader.Open(path.c_str()));
+	EXPECT_FALSE(reader.ReadBlock());
+
+	for (int i = 0; i < 10; i++) {
+		PushTestRow(writer, i);
+	}
+	// rows are only visible once their block is written
+	EXPECT_FALSE(reader.ReadBlock());
+	writer.Flush();
+	ASSERT_TRUE(reader.ReadBlock());
+	ASSERT_EQ(10u, reader.GetRowCount());
+	ExpectTestRow(reader, 9, 9);
+
+	PushTestRow(writer, 10);
+	writer.Close();
+	ASSERT_TRUE(reader.ReadBlock());
+	ASSERT_EQ(1u, reader.GetRowCount());
+	ExpectTestRow(reader, 0, 10);
+	EXPECT_FALSE(reader.ReadBlock());
+	reader.Close();
+	DeleteFileW(path.c_str());
+}
+
+TEST(CaptureFile, TruncatedBlockIsNotRead)
+{
+	const auto path = TempPath(L"pm-ult-capture-truncated.pmcap");
+	{
+		CaptureFileWriter writer;
+		ASSERT_TRUE(writer.Open(path.c_str(), TestColumns(), 10'000'000, 0, 0));
+		PushTestRow(writer, 0);
+		writer.Flush();
+		PushTestRow(writer, 1);
+		writer.Close();
+	}
+	// simulate the writer being terminated part way through the last block
+	{
+		auto h = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+		ASSERT_NE(INVALID_HANDLE_VALUE, h);
+		LARGE_INTEGER size;
+		GetFileSizeEx(h, &size);
+		size.QuadPart -= 3;
+		SetFilePointerEx(h, size, nullptr, FILE_BEGIN);
+		SetEndOfFile(h);
+		CloseHandle(h);
+	}
+
+	CaptureFileReader reader;
+	ASSERT_TRUE(reader.Open(path.c_str()));
+	ASSERT_TRUE(reader.ReadBlock());
+	ExpectTestRow(reader, 0, 0);
+	EXPECT_FALSE(reader.ReadBlock());
+	reader.Close();
+	DeleteFileW(path.c_str());
+}
+
+TEST(CaptureFile, BlockLargerThanTheFileIsNotRead)
+{
+	const auto path = TempPath(L"pm-ult-capture-corrupt.pmcap");
+	{
+		CaptureFileWriter writer;
+		ASSERT_TRUE(writer.Open(path.c_str(), TestColumns(), 10'000'000, 0, 0));
+		PushTestRow(writer, 0);
+		EXPECT_TRUE(writer.Close());
+	}
+	// append a block header whose payload size is far larger than the rest of the file
+	{
+		CaptureBlockHeader header = {};
+		header.Magic = CAPTURE_BLOCK_MAGIC;
+		header.RowCount = 0xFFFFFFF0u;
+		header.PayloadSize = 0xFFFFFFF0u;
+		auto h = CreateFileW(path.c_str(), FILE_APPEND_DATA, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+		ASSERT_NE(INVALID_HANDLE_VALUE, h);
+		DWORD written = 0;
+		WriteFile(h, &header, sizeof(header), &written, nullptr);
+		CloseHandle(h);
+		ASSERT_EQ(sizeof(header), written);
+	}
+
+	CaptureFileReader reader;
+	ASSERT_TRUE(reader.Open(path.c_str()));
+	ASSERT_TRUE(reader.ReadBlock());
+	ExpectTestRow(reader, 0, 0);
+	EXPECT_FALSE(reader.ReadBlock());
+	EXPECT_EQ(0u, reader.GetRowCount());
+	reader.Close();
+	DeleteFileW(path.c_str());
+}
@@ -0,0 +1,205 @@
+#include "gtest/gtest.h"
+#include "../Streamer/ColumnarSharedMemory.h"
+
+#include <windows.h>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	PmNsmFrameData MakeColumnarTestFrame(uint64_t i)
+	{
+		PmNsmFrameData frame;
+		std::memset(&frame, 0, sizeof(frame));
+		frame.present_event.PresentStartTime = 1000 + i * 16;
+		frame.present_event.ProcessId = 42;
+		frame.present_event.SyncInterval = int32_t(i % 3);
+		frame.present_event.FinalState = (i % 4) ? PresentResult::Presented : PresentResult::Discarded;
+		frame.power_telemetry.gpu_power_w = 10.0 + double(i);
+		frame.cpu_telemetry.cpu_utilization = double(i) / 2.0;
+		return frame;
+	}
+
+	// Zero initialized block with room for a columnar stream
+	struct ColumnarTestBlock
+	{
+		explicit ColumnarTestBlock(uint64_t capacity)
+			:
+			storage(size_t(ColumnarFrameWriter::GetRequiredSize(capacity) / sizeof(uint64_t)) + 1)
+		{}
+		void* Get() { return storage.data(); }
+		std::vector<uint64_t> storage;
+	};
+}
+
+TEST(ColumnarFrameStreamTests, SchemaColumnsAreAlignedAndDisjoint)
+{
+	const uint64_t capacity = 64;
+	ColumnarTestBlock block{ capacity };
+	ColumnarFrameWriter writer{ block.Get(), capacity };
+	ColumnarFrameReader reader;
+	ASSERT_TRUE(reader.Open(block.Get()));
+
+	const auto fields = GetNsmColumnFields();
+	ASSERT_EQ(reader.GetColumnCount(), (int)fields.size());
+	uint64_t end_of_previous = 0;
+	for (int i = 0; i < reader.GetColumnCount(); i++) {
+		const auto& descriptor = reader.GetColumnDescriptor(i);
+		EXPECT_EQ(descriptor.source_offset, fields[i].source_offset);
+		EXPECT_EQ(descriptor.element_size, fields[i].size);
+		EXPECT_EQ(descriptor.data_offset % kNsmColumnAlignment, 0u);
+		EXPECT_GE(descriptor.data_offset, end_of_previous);
+		EXPECT_LE(descriptor.source_offset + descriptor.element_size, sizeof(PmNsmFrameData));
+		end_of_previous = descriptor.data_offset + capacity * descriptor.element_size;
+		EXPECT_EQ(reader.FindColumn(descriptor.source_offset), i);
+	}
+	EXPECT_LE(end_of_previous, writer.GetHeader()->total_size);
+	EXPECT_EQ(writer.GetHeader()->total_size, ColumnarFrameWriter::GetRequiredSize(capacity));
+	// an offset inside a field finds the field's column, as for an element of an array field
+	EXPECT_EQ(reader.FindColumn(NSM_COLUMN_OFFSET(present_event.PresentStartTime) + 1),
+		reader.FindColumn(NSM_COLUMN_OFFSET(present_event.PresentStartTime)));
+	EXPECT_EQ(reader.FindColumn(NSM_COLUMN_OFFSET(power_telemetry.fan_speed_rpm) + uint32_t(sizeof(double))),
+		reader.FindColumn(NSM_COLUMN_OFFSET(power_telemetry.fan_speed_rpm)));
+	EXPECT_EQ(reader.FindColumn(uint32_t(sizeof(PmNsmFrameData))), -1);
+}
+
+TEST(ColumnarFrameStreamTests, RowsMatchWrittenFrames)
+{
+	const uint64_t capacity = 64;
+	const uint64_t frame_count = 100;
+	ColumnarTestBlock block{ capacity };
+	ColumnarFrameWriter writer{ block.Get(), capacity };
+	ColumnarFrameReader reader;
+	ASSERT_TRUE(reader.Open(block.Get()));
+	reader.AttachAllColumns(block.Get());
+	EXPECT_EQ(reader.GetSequence(), 0u);
+	EXPECT_TRUE(reader.IsProcessActive());
+
+	for (uint64_t i = 0; i < frame_count; i++) {
+		writer.WriteFrameData(MakeColumnarTestFrame(i));
+	}
+
+	const auto sequence = reader.GetSequence();
+	ASSERT_EQ(sequence, frame_count);
+	const auto oldest = reader.GetOldestReadableRow(sequence);
+	EXPECT_EQ(oldest, frame_count - capacity + 1);
+
+	const auto start_col = reader.FindColumn(NSM_COLUMN_OFFSET(present_event.PresentStartTime));
+	const auto sync_col = reader.FindColumn(NSM_COLUMN_OFFSET(present_event.SyncInterval));
+	const auto state_col = reader.FindColumn(NSM_COLUMN_OFFSET(present_event.FinalState));
+	const auto power_col = reader.FindColumn(NSM_COLUMN_OFFSET(power_telemetry.gpu_power_w));
+	const auto util_col = reader.FindColumn(NSM_COLUMN_OFFSET(cpu_telemetry.cpu_utilization));
+	ASSERT_GE(start_col, 0);
+	ASSERT_GE(sync_col, 0);
+	ASSERT_GE(state_col, 0);
+	ASSERT_GE(power_col, 0);
+	ASSERT_GE(util_col, 0);
+
+	for (uint64_t row = oldest; row < sequence; row++) {
+		const auto expected = MakeColumnarTestFrame(row);
+		EXPECT_EQ(reader.Get<uint64_t>(start_col, row), expected.present_event.PresentStartTime);
+		EXPECT_EQ(reader.Get<int32_t>(sync_col, row), expected.present_event.SyncInterval);
+		EXPECT_EQ(reader.Get<PresentResult>(state_col, row), expected.present_event.FinalState);
+		EXPECT_EQ(reader.Get<double>(power_col, row), expected.power_telemetry.gpu_power_w);
+		EXPECT_EQ(reader.Get<double>(util_col, row), expected.cpu_telemetry.cpu_utilization);
+	}
+	EXPECT_TRUE(reader.IsRowIntact(oldest));
+
+	// reading a range in spans covers every row once, splitting where the ring wraps
+	uint64_t row = oldest;
+	int span_count = 0;
+	while (row < sequence) {
+		const auto starts = reader.GetRows<uint64_t>(start_col, row, sequence);
+		ASSERT_FALSE(starts.empty());
+		for (auto start : starts) {
+			EXPECT_EQ(start, MakeColumnarTestFrame(row++).present_event.PresentStartTime);
+		}
+		span_count++;
+	}
+	EXPECT_EQ(span_count, 2);
+
+	// once the writer comes around, rows read earlier are no longer intact
+	writer.WriteFrameData(MakeColumnarTestFrame(frame_count));
+	EXPECT_FALSE(reader.IsRowIntact(oldest));
+	EXPECT_TRUE(reader.IsRowIntact(oldest + 1));
+
+	writer.NotifyProcessKilled();
+	EXPECT_FALSE(reader.IsProcessActive());
+}
+
+TEST(ColumnarFrameStreamTests, GatherRowCopiesAttachedColumns)
+{
+	const uint64_t capacity = 16;
+	ColumnarTestBlock block{ capacity };
+	ColumnarFrameWriter writer{ block.Get(), capacity };
+	for (uint64_t i = 0; i < capacity + 3; i++) {
+		writer.WriteFrameData(MakeColumnarTestFrame(i));
+	}
+	ColumnarFrameReader reader;
+	ASSERT_TRUE(reader.Open(block.Get()));
+	const auto start_col = reader.FindColumn(NSM_COLUMN_OFFSET(present_event.PresentStartTime));
+	const auto power_col = reader.FindColumn(NSM_COLUMN_OFFSET(power_telemetry.gpu_power_w));
+	ASSERT_GE(start_col, 0);
+	ASSERT_GE(power_col, 0);
+	const auto base = static_cast<const uint8_t*>(block.Get());
+	reader.AttachColumn(start_col, base + reader.GetColumnDescriptor(start_col).data_offset);
+	reader.AttachColumn(power_col, base + reader.GetColumnDescriptor(power_col).data_offset);
+
+	// only the attached columns are copied in, at their fields
+	const uint64_t row = capacity + 1;
+	PmNsmFrameData frame = {};
+	reader.GatherRow(row, frame);
+	EXPECT_TRUE(reader.IsRowIntact(row));
+	const auto expected = MakeColumnarTestFrame(row);
+	EXPECT_EQ(frame.present_event.PresentStartTime, expected.present_event.PresentStartTime);
+	EXPECT_EQ(frame.power_telemetry.gpu_power_w, expected.power_telemetry.gpu_power_w);
+	EXPECT_EQ(frame.present_event.ProcessId, 0u);
+	EXPECT_EQ(frame.cpu_telemetry.cpu_utilization, 0.);
+}
+
+TEST(ColumnarFrameStreamTests, RejectsIncompatibleStream)
+{
+	ColumnarTestBlock block{ 8 };
+	ColumnarFrameWriter writer{ block.Get(), 8 };
+	writer.GetHeader()->version = NSM_COLUMNAR_VERSION + 1;
+	ColumnarFrameReader reader;
+	EXPECT_FALSE(reader.Open(block.Get()));
+}
+
+TEST(ColumnarFrameStreamTests, SharedMemMapsRequestedColumns)
+{
+	const std::string name = "Global\\ColumnarFrameStreamTest" + std::to_string(GetCurrentProcessId());
+	const uint64_t capacity = 500;
+	ColumnarSharedMem server;
+	ASSERT_TRUE(server.Create(name, capacity));
+	for (uint64_t i = 0; i < capacity / 2; i++) {
+		server.GetWriter()->WriteFrameData(MakeColumnarTestFrame(i));
+	}
+
+	const uint32_t offsets[] = {
+		NSM_COLUMN_OFFSET(present_event.PresentStartTime),
+		NSM_COLUMN_OFFSET(power_telemetry.gpu_power_w),
+	};
+	ColumnarSharedMem client;
+	ASSERT_TRUE(client.Open(name, offsets));
+	const auto& reader = client.GetReader();
+	const auto start_col = reader.FindColumn(offsets[0]);
+	const auto power_col = reader.FindColumn(offsets[1]);
+	ASSERT_TRUE(reader.IsColumnAttached(start_col));
+	ASSERT_TRUE(reader.IsColumnAttached(power_col));
+
+	const auto sequence = reader.GetSequence();
+	ASSERT_EQ(sequence, capacity / 2);
+	for (uint64_t row = reader.GetOldestReadableRow(sequence); row < sequence; row++) {
+		const auto expected = MakeColumnarTestFrame(row);
+		EXPECT_EQ(reader.Get<uint64_t>(start_col, row), expected.present_event.PresentStartTime);
+		EXPECT_EQ(reader.Get<double>(power_col, row), expected.power_telemetry.gpu_power_w);
+	}
+
+	// a field that is not part of the published schema cannot be requested
+	const uint32_t bad_offsets[] = { uint32_t(sizeof(PmNsmFrameData)) };
+	ColumnarSharedMem bad_client;
+	EXPECT_FALSE(bad_client.Open(name, bad_offsets));
+}
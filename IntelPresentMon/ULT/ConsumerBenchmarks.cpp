@@ -0,0 +1,313 @@
+#include "gtest/gtest.h"
+#include "ConsumerTestUtils.h"
+#include "../CommonUtilities/FlatHashMap.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	template<class F>
+	double MeasureSeconds(F&& f)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		f();
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Mimics how the consumer uses its present index tables: a small live set of keys, with each
+	// present inserting its key, being looked up a few times by subsequent events, and then erased.
+	template<class Map>
+	double MeasurePresentIndexChurn(const std::vector<uint64_t>& keys, uint32_t liveCount, uint32_t lookupsPerKey)
+	{
+		Map map;
+		auto present = std::make_shared<PresentEvent>();
+		size_t found = 0;
+		const auto seconds = MeasureSeconds([&] {
+			for (size_t i = 0; i < keys.size(); i++) {
+				map.emplace(keys[i], present);
+				for (uint32_t j = 0; j < lookupsPerKey; j++) {
+					found += map.find(keys[i - (i >= j ? j : 0)]) != map.end() ? 1 : 0;
+				}
+				if (i >= liveCount) {
+					map.erase(keys[i - liveCount]);
+				}
+			}
+		});
+		EXPECT_GT(found, 0u);
+		return seconds;
+	}
+
+	std::vector<DecodedEvent> ReadDecodedEvents(const wchar_t* path)
+	{
+		DecodedEventReader reader;
+		EXPECT_TRUE(reader.Open(path));
+		std::vector<DecodedEvent> events(4096);
+		for (size_t count = 0;;) {
+			const auto read = reader.Read(events.data() + count, events.size() - count);
+			if (read == 0) {
+				events.resize(count);
+				break;
+			}
+			count += read;
+			events.resize(count * 2);
+		}
+		return events;
+	}
+}
+
+// benchmarks time themselves and report to stdout, so they are left out of the default run; run them with
+// --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+TEST(ConsumerBenchmark, DISABLED_PresentEventAllocation)
+{
+	constexpr int iterations = 2'000'000;
+	constexpr int live = PMTraceConsumer::PRESENTEVENT_CIRCULAR_BUFFER_SIZE;
+	std::vector<std::shared_ptr<PresentEvent>> ring(live);
+
+	const auto heapSeconds = MeasureSeconds([&] {
+		for (int i = 0; i < iterations; i++) {
+			ring[i % live] = std::make_shared<PresentEvent>();
+		}
+	});
+	std::ranges::fill(ring, nullptr);
+
+	PresentEventPool pool{ live };
+	const auto poolSeconds = MeasureSeconds([&] {
+		for (int i = 0; i < iterations; i++) {
+			ring[i % live] = pool.Allocate();
+		}
+	});
+	std::ranges::fill(ring, nullptr);
+
+	std::cout << "PresentEvent allocations/sec: make_shared=" << iterations / heapSeconds
+		<< " pool=" << iterations / poolSeconds << std::endl;
+}
+
+TEST(ConsumerBenchmark, DISABLED_SyntheticLegacyFlipStream)
+{
+	constexpr uint32_t presentCount = 500'000;
+	for (uint32_t swapChains : { 1u, 8u }) {
+		PMTraceConsumer consumer;
+		SyntheticPresentStream stream{ consumer, swapChains };
+		size_t dequeued = 0;
+		const auto seconds = MeasureSeconds([&] { dequeued = stream.Run(presentCount); });
+		// the very first completion is discarded by design (see CompletePresent)
+		EXPECT_GE(dequeued, presentCount - swapChains - 1);
+		std::cout << "Synthetic stream (" << swapChains << " swapchains): "
+			<< presentCount * SyntheticPresentStream::eventsPerPresent / seconds << " events/sec" << std::endl;
+	}
+}
+
+// Consumer thread analyzing a synthetic stream while an output thread dequeues completed presents
+// into a fixed span, for realtime (drop on full), offline with backpressure (block on full), and
+// offline with backpressure disabled.
+TEST(ConsumerBenchmark, DISABLED_CompletedPresentHandoff)
+{
+	constexpr uint32_t presentCount = 500'000;
+	constexpr uint32_t swapChains = 4;
+	struct Mode
+	{
+		const char* name;
+		bool realtime;
+		bool disableBackpressure;
+	};
+	for (auto mode : { Mode{ "realtime", true, false }, Mode{ "offline", false, false },
+		Mode{ "offline no backpressure", false, true } }) {
+		PMTraceConsumer consumer{ 1024 };
+		consumer.mIsRealtimeSession = mode.realtime;
+		consumer.mDisableOfflineBackpressure = mode.disableBackpressure;
+		SyntheticPresentStream stream{ consumer, swapChains };
+
+		std::atomic<bool> producerDone = false;
+		size_t dequeued = 0;
+		uint64_t lastStart = 0;
+		bool ordered = true;
+		const auto seconds = MeasureSeconds([&] {
+			std::thread output{ [&] {
+				std::array<std::shared_ptr<PresentEvent>, 256> presents;
+				for (;;) {
+					const bool done = producerDone.load();
+					const auto count = consumer.DequeuePresentEvents(std::span(presents));
+					for (size_t i = 0; i < count; i++) {
+						// presents are from interleaved chains but complete in start order here
+						ordered = ordered && presents[i]->PresentStartTime > lastStart;
+						lastStart = presents[i]->PresentStartTime;
+						presents[i] = nullptr;
+					}
+					dequeued += count;
+					if (count == 0) {
+						if (done) {
+							break;
+						}
+						WaitForSingleObject(consumer.hEventsReadyEvent, 1);
+					}
+				}
+			} };
+			stream.Feed(presentCount);
+			producerDone = true;
+			output.join();
+		});
+
+		EXPECT_TRUE(ordered);
+		// the very first completion is discarded by design (see CompletePresent)
+		if (mode.realtime || mode.disableBackpressure) {
+			EXPECT_GE(dequeued + consumer.mNumOverflowedPresents, presentCount - swapChains - 1);
+		}
+		else {
+			EXPECT_EQ(0u, consumer.mNumOverflowedPresents);
+			EXPECT_GE(dequeued, presentCount - swapChains - 1);
+		}
+		std::cout << "Completed present handoff (" << mode.name << "): " << dequeued / seconds
+			<< " presents/sec, " << consumer.mNumOverflowedPresents << " dropped" << std::endl;
+	}
+}
+
+// The synthetic keys only approximate real ones.  Set PRESENTMON_DECODED_EVENTS to a file recorded
+// with PresentMon --record_decoded_events (e.g., while analyzing one of the gold ETLs) to also
+// measure with the keys, and the process and swap chain mix, of that capture.
+TEST(ConsumerBenchmark, DISABLED_PresentIndexLookup)
+{
+	using StdIndex = std::unordered_map<uint64_t, std::shared_ptr<PresentEvent>>;
+	using FlatIndex = pmon::util::FlatHashMap<uint64_t, std::shared_ptr<PresentEvent>>;
+	constexpr size_t keyCount = 2'000'000;
+	constexpr uint32_t liveCount = 32;
+	constexpr uint32_t lookupsPerKey = 4;
+
+	const auto measure = [&](const char* source, const char* name, const std::vector<uint64_t>& keys) {
+		if (keys.empty()) {
+			return;
+		}
+		// repeat the keys of a short capture so that both tables are measured over the same count
+		std::vector<uint64_t> repeated;
+		repeated.reserve(keyCount);
+		while (repeated.size() < keyCount) {
+			repeated.insert(repeated.end(), keys.begin(), keys.begin() + std::min(keys.size(), keyCount - repeated.size()));
+		}
+		const auto stdSeconds = MeasurePresentIndexChurn<StdIndex>(repeated, liveCount, lookupsPerKey);
+		const auto flatSeconds = MeasurePresentIndexChurn<FlatIndex>(repeated, liveCount, lookupsPerKey);
+		std::cout << "Present index churn (" << source << " " << name << " keys) ops/sec: unordered_map="
+			<< keyCount * (lookupsPerKey + 2) / stdSeconds << " FlatHashMap="
+			<< keyCount * (lookupsPerKey + 2) / flatSeconds << std::endl;
+	};
+
+	std::mt19937_64 rng{ 1 };
+	std::vector<uint64_t> threadIds(keyCount), submitSequences(keyCount), tokens(keyCount);
+	for (size_t i = 0; i < keyCount; i++) {
+		// a handful of render/driver threads
+		threadIds[i] = 4 * (1000 + rng() % 16);
+		// monotonically increasing per-queue sequence ids
+		submitSequences[i] = i + 1;
+		// kernel-pointer-like tokens: aligned and clustered in a high address range
+		tokens[i] = 0xFFFF'8000'0000'0000ull + (rng() % (1ull << 24)) * 64;
+	}
+	measure("synthetic", "thread id", threadIds);
+	measure("synthetic", "submit sequence", submitSequences);
+	measure("synthetic", "token", tokens);
+
+	if (auto path = _wgetenv(L"PRESENTMON_DECODED_EVENTS")) {
+		const auto captured = ReadDecodedEvents(path);
+		ASSERT_FALSE(captured.empty());
+		std::vector<uint64_t> capturedThreadIds, capturedProcessIds, capturedSwapChains, capturedSubmitSequences, capturedTokens;
+		for (auto const& e : captured) {
+			switch (e.Type) {
+			case DecodedEventType::RuntimePresentStart:
+				capturedThreadIds.push_back(e.ThreadId);
+				capturedProcessIds.push_back(e.ProcessId);
+				capturedSwapChains.push_back(e.RuntimePresentStart.SwapChainAddress);
+				break;
+			case DecodedEventType::DxgkQueueSubmit:
+				capturedSubmitSequences.push_back(e.DxgkQueuePacket.SubmitSequence);
+				break;
+			case DecodedEventType::DxgkPresentHistoryStart:
+				capturedTokens.push_back(e.DxgkPresentHistoryStart.Token);
+				break;
+			default:
+				break;
+			}
+		}
+		measure("capture", "thread id", capturedThreadIds);
+		measure("capture", "process id", capturedProcessIds);
+		measure("capture", "swap chain", capturedSwapChains);
+		measure("capture", "submit sequence", capturedSubmitSequences);
+		measure("capture", "token", capturedTokens);
+	}
+}
+
+// Set PRESENTMON_DECODED_EVENTS to a file recorded with PresentMon --record_decoded_events to also
+// measure replay throughput of a real capture.
+TEST(ConsumerBenchmark, DISABLED_DecodedEventReplay)
+{
+	const auto events = MakeDecodedLegacyFlipStream(500'000, 8);
+	PMTraceConsumer consumer;
+	size_t dequeued = 0;
+	const auto seconds = MeasureSeconds([&] { dequeued = ReplayAndDequeue(consumer, events); });
+	EXPECT_GT(dequeued, 0u);
+	std::cout << "Decoded event replay (synthetic): " << events.size() / seconds << " events/sec" << std::endl;
+
+	if (auto path = _wgetenv(L"PRESENTMON_DECODED_EVENTS")) {
+		const auto captured = ReadDecodedEvents(path);
+		ASSERT_FALSE(captured.empty());
+		PMTraceConsumer captureConsumer;
+		const auto captureSeconds = MeasureSeconds([&] { ReplayAndDequeue(captureConsumer, captured); });
+		std::cout << "Decoded event replay (capture): " << captured.size() / captureSeconds << " events/sec" << std::endl;
+	}
+}
+
+TEST(ConsumerBenchmark, DISABLED_EventMetadataDecode)
+{
+	constexpr int iterations = 2'000'000;
+	const auto queuePacket = MakeQueuePacketSchema();
+	const auto syncDPC = MakeSyncDPCMultiPlaneSchema();
+	auto queuePacketPayload = MakeQueuePacketPayload(1);
+	auto syncDPCPayload = MakeSyncDPCMultiPlanePayload(1);
+	auto queuePacketRecord = queuePacket.MakeRecord(queuePacketPayload);
+	auto syncDPCRecord = syncDPC.MakeRecord(syncDPCPayload);
+
+	for (bool compiled : { false, true }) {
+		EventMetadata metadata;
+		metadata.useCompiledLayouts_ = compiled;
+		queuePacket.Register(metadata);
+		syncDPC.Register(metadata);
+
+		uint64_t sum = 0;
+		const auto queuePacketSeconds = MeasureSeconds([&] {
+			for (int i = 0; i < iterations; i++) {
+				EventDataDesc desc[] = {
+					{ L"PacketType" },
+					{ L"SubmitSequence" },
+					{ L"hContext" },
+					{ L"bPresent" },
+				};
+				metadata.GetEventData(&queuePacketRecord, desc, _countof(desc));
+				sum += desc[1].GetData<uint32_t>();
+			}
+		});
+		const auto syncDPCSeconds = MeasureSeconds([&] {
+			for (int i = 0; i < iterations; i++) {
+				EventDataDesc desc[] = {
+					{ L"PlaneCount" },
+					{ L"ScannedPhysicalAddress" },
+					{ L"FlipEntryCount" },
+					{ L"FlipSubmitSequence" },
+				};
+				metadata.GetEventData(&syncDPCRecord, desc, _countof(desc));
+				sum += desc[2].GetData<uint32_t>();
+			}
+		});
+		EXPECT_EQ(2ull * iterations, sum);
+		std::cout << "GetEventData (" << (compiled ? "compiled layout" : "property walk") << ") events/sec: QueuePacket_Start="
+			<< iterations / queuePacketSeconds << " VSyncDPCMultiPlane_Info=" << iterations / syncDPCSeconds << std::endl;
+	}
+}
@@ -0,0 +1,141 @@
+#include "ConsumerTestUtils.h"
+
+#include <cstring>
+
+namespace
+{
+	template<class T>
+	void AppendPayload(std::vector<uint8_t>& payload, T value)
+	{
+		const auto offset = payload.size();
+		payload.resize(offset + sizeof(T));
+		memcpy(payload.data() + offset, &value, sizeof(T));
+	}
+}
+
+std::vector<DecodedEvent> MakeDecodedLegacyFlipStream(uint32_t presentCount, uint32_t swapChainCount, bool emitInput)
+{
+	std::vector<DecodedEvent> events;
+	events.reserve(size_t(presentCount) * SyntheticPresentStream::eventsPerPresent);
+	uint64_t qpc = 1'000'000;
+	for (uint32_t i = 0; i < presentCount; i++) {
+		const auto chain = i % swapChainCount;
+		const uint32_t pid = 1000 + chain;
+		const uint32_t tid = 5000 + chain;
+		const uint32_t submitSequence = i + 1;
+
+		if (emitInput && i % 4 == 0) {
+			auto ev = MakeDecodedEvent(DecodedEventType::Win32kInputDeviceRead, qpc += 10, 0, 0);
+			ev.Win32kInput.DeviceType = i % 8 == 0 ? 0 : 1;
+			events.push_back(ev);
+			ev = MakeDecodedEvent(DecodedEventType::Win32kRetrieveInputMessage, qpc, pid, tid);
+			ev.Win32kInput.Hwnd = 0x2000 + chain;
+			events.push_back(ev);
+		}
+
+		auto ev = MakeDecodedEvent(DecodedEventType::RuntimePresentStart, qpc += 10, pid, tid);
+		ev.RuntimePresentStart.SwapChainAddress = 0x1000 + chain;
+		ev.RuntimePresentStart.Runtime = (uint32_t)Runtime::DXGI;
+		ev.RuntimePresentStart.SyncInterval = 1;
+		events.push_back(ev);
+
+		ev = MakeDecodedEvent(DecodedEventType::DxgkFlip, qpc += 10, pid, tid);
+		ev.DxgkFlip.FlipInterval = 1;
+		events.push_back(ev);
+
+		ev = MakeDecodedEvent(DecodedEventType::DxgkQueueSubmit, qpc += 10, pid, tid);
+		ev.DxgkQueuePacket.hContext = 0xC0000 + chain;
+		ev.DxgkQueuePacket.SubmitSequence = submitSequence;
+		ev.DxgkQueuePacket.PacketType = (uint32_t)Microsoft_Windows_DxgKrnl::QueuePacketType::DXGKETW_MMIOFLIP_COMMAND_BUFFER;
+		events.push_back(ev);
+
+		ev = MakeDecodedEvent(DecodedEventType::RuntimePresentStop, qpc += 10, pid, tid);
+		ev.RuntimePresentStop.Runtime = (uint32_t)Runtime::DXGI;
+		events.push_back(ev);
+
+		ev = MakeDecodedEvent(DecodedEventType::DxgkMMIOFlip, qpc += 10, 0, 0);
+		ev.DxgkMMIOFlip.SubmitSequence = submitSequence;
+		events.push_back(ev);
+
+		ev = MakeDecodedEvent(DecodedEventType::DxgkSyncDPC, qpc += 10, 0, 0);
+		ev.DxgkSyncDPC.SubmitSequence = submitSequence;
+		events.push_back(ev);
+	}
+	return events;
+}
+
+size_t ReplayAndDequeue(PMTraceConsumer& consumer, const std::vector<DecodedEvent>& events, size_t dequeueInterval,
+	std::vector<std::shared_ptr<PresentEvent>>* pOut)
+{
+	std::vector<std::shared_ptr<PresentEvent>> presents;
+	size_t dequeued = 0;
+	const auto dequeue = [&] {
+		consumer.DequeuePresentEvents(presents);
+		dequeued += presents.size();
+		if (pOut) {
+			pOut->insert(pOut->end(), presents.begin(), presents.end());
+		}
+	};
+	for (size_t i = 0; i < events.size(); i++) {
+		consumer.HandleDecodedEvent(events[i]);
+		if (i % dequeueInterval == dequeueInterval - 1) {
+			dequeue();
+		}
+	}
+	dequeue();
+	return dequeued;
+}
+
+// Schema shaped like DxgKrnl QueuePacket_Start: every property has a fixed offset
+SyntheticEventSchema MakeQueuePacketSchema()
+{
+	SyntheticEventSchema schema{ 178 };
+	schema.Add(L"hContext", TDH_INTYPE_POINTER, 8)
+		.Add(L"PacketType", TDH_INTYPE_UINT32, 4)
+		.Add(L"SubmitSequence", TDH_INTYPE_UINT32, 4)
+		.Add(L"DmaBufferSize", TDH_INTYPE_UINT64, 8)
+		.Add(L"AllocationListSize", TDH_INTYPE_UINT32, 4)
+		.Add(L"PatchLocationListSize", TDH_INTYPE_UINT32, 4)
+		.Add(L"bPresent", TDH_INTYPE_BOOLEAN, 4)
+		.Add(L"hDmaBuffer", TDH_INTYPE_POINTER, 8);
+	return schema;
+}
+std::vector<uint8_t> MakeQueuePacketPayload(uint32_t submitSequence)
+{
+	std::vector<uint8_t> payload;
+	AppendPayload<uint64_t>(payload, 0xFFFF'C000'1234'0000ull);
+	AppendPayload<uint32_t>(payload, 4);
+	AppendPayload<uint32_t>(payload, submitSequence);
+	AppendPayload<uint64_t>(payload, 4096);
+	AppendPayload<uint32_t>(payload, 0);
+	AppendPayload<uint32_t>(payload, 0);
+	AppendPayload<uint32_t>(payload, 1);
+	AppendPayload<uint64_t>(payload, 0xFFFF'C000'5678'0000ull);
+	return payload;
+}
+
+// Schema shaped like DxgKrnl VSyncDPCMultiPlane_Info: arrays sized by count properties make
+// the offsets of later properties depend on the payload
+SyntheticEventSchema MakeSyncDPCMultiPlaneSchema()
+{
+	SyntheticEventSchema schema{ 273 };
+	schema.Add(L"pDxgAdapter", TDH_INTYPE_POINTER, 8)
+		.Add(L"VidPnTargetId", TDH_INTYPE_UINT32, 4)
+		.Add(L"PlaneCount", TDH_INTYPE_UINT32, 4)
+		.Add(L"ScannedPhysicalAddress", TDH_INTYPE_UINT64, 8, 2)
+		.Add(L"FlipEntryCount", TDH_INTYPE_UINT32, 4)
+		.Add(L"FlipSubmitSequence", TDH_INTYPE_UINT64, 8, 4);
+	return schema;
+}
+std::vector<uint8_t> MakeSyncDPCMultiPlanePayload(uint32_t submitSequence)
+{
+	std::vector<uint8_t> payload;
+	AppendPayload<uint64_t>(payload, 0xFFFF'C000'0000'1000ull);
+	AppendPayload<uint32_t>(payload, 1);
+	AppendPayload<uint32_t>(payload, 2);
+	AppendPayload<uint64_t>(payload, 0x1000);
+	AppendPayload<uint64_t>(payload, 0x2000);
+	AppendPayload<uint32_t>(payload, 1);
+	AppendPayload<uint64_t>(payload, (uint64_t)submitSequence << 32);
+	return payload;
+}
@@ -0,0 +1,187 @@
+#pragma once
+#include "../../PresentData/PresentMonTraceConsumer.hpp"
+#include "../../PresentData/ETW/Microsoft_Windows_DxgKrnl.h"
+#include "../../PresentData/ETW/Microsoft_Windows_EventMetadata.h"
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Synthetic event streams and ETW schemas shared by the consumer unit tests and ConsumerBenchmarks.cpp.
+
+// Drives PMTraceConsumer through the Hardware_Legacy_Flip event sequence (PresentStart, Flip,
+// QueueSubmit, PresentStop, MMIOFlip, VSyncDPC) for a number of interleaved swap chains,
+// dequeuing completed presents periodically like the output thread would.  With emitInput,
+// every fourth present is preceded by a Win32k input read and retrieve.
+class SyntheticPresentStream
+{
+public:
+	static constexpr uint32_t eventsPerPresent = 6;
+
+	SyntheticPresentStream(PMTraceConsumer& consumer, uint32_t swapChainCount, bool emitInput = false)
+		:
+		consumer_{ consumer },
+		swapChainCount_{ swapChainCount },
+		emitInput_{ emitInput }
+	{}
+	// returns number of presents dequeued; they are also appended to pOut if given
+	size_t Run(uint32_t presentCount, uint32_t dequeueInterval = 64,
+		std::vector<std::shared_ptr<PresentEvent>>* pOut = nullptr)
+	{
+		size_t dequeued = 0;
+		const auto dequeue = [&] {
+			consumer_.DequeuePresentEvents(presents_);
+			dequeued += presents_.size();
+			if (pOut) {
+				pOut->insert(pOut->end(), presents_.begin(), presents_.end());
+			}
+		};
+		for (uint32_t i = 0; i < presentCount; i++) {
+			EmitPresent_(i);
+			if (i % dequeueInterval == dequeueInterval - 1) {
+				dequeue();
+			}
+		}
+		dequeue();
+		presents_.clear();
+		return dequeued;
+	}
+	// emit events only, for when presents are dequeued by another thread
+	void Feed(uint32_t presentCount)
+	{
+		for (uint32_t i = 0; i < presentCount; i++) {
+			EmitPresent_(i);
+		}
+	}
+private:
+	void EmitPresent_(uint32_t i)
+	{
+		const auto chain = i % swapChainCount_;
+		const uint32_t pid = 1000 + chain;
+		const uint32_t tid = 5000 + chain;
+		const uint32_t submitSequence = ++submitSequence_;
+		const uint64_t hContext = 0xC0000 + chain;
+
+		if (emitInput_ && i % 4 == 0) {
+			consumer_.HandleWin32kInputDeviceRead(Tick_(), i % 8 == 0 ? 0 : 1);
+			consumer_.HandleWin32kRetrieveInputMessage(pid, 0x2000 + chain);
+		}
+		consumer_.RuntimePresentStart(Runtime::DXGI, Header_(pid, tid), 0x1000 + chain, 0, 1);
+		consumer_.HandleDxgkFlipInfo(Header_(pid, tid), 1, false);
+		consumer_.HandleDxgkQueueSubmit(Header_(pid, tid), hContext, submitSequence,
+			(uint32_t)Microsoft_Windows_DxgKrnl::QueuePacketType::DXGKETW_MMIOFLIP_COMMAND_BUFFER, false, false);
+		consumer_.RuntimePresentStop(Runtime::DXGI, Header_(pid, tid), 0);
+		consumer_.HandleDxgkMMIOFlip(Tick_(), submitSequence, 0);
+		consumer_.HandleDxgkSyncDPC(Tick_(), submitSequence);
+	}
+	uint64_t Tick_()
+	{
+		return qpc_ += 10;
+	}
+	DecodedEvent Header_(uint32_t pid, uint32_t tid)
+	{
+		return MakeDecodedEvent(DecodedEventType::None, Tick_(), pid, tid);
+	}
+	PMTraceConsumer& consumer_;
+	uint32_t swapChainCount_;
+	bool emitInput_;
+	uint32_t submitSequence_ = 0;
+	uint64_t qpc_ = 1'000'000;
+	std::vector<std::shared_ptr<PresentEvent>> presents_;
+};
+
+// Builds the same Hardware_Legacy_Flip sequence as SyntheticPresentStream, but as a
+// DecodedEvent stream that can be replayed or written to file.
+std::vector<DecodedEvent> MakeDecodedLegacyFlipStream(uint32_t presentCount, uint32_t swapChainCount, bool emitInput = false);
+
+// Replays events into consumer, dequeuing every dequeueInterval events and once at the end.  Returns the
+// number of presents dequeued; they are also appended to pOut if given.
+size_t ReplayAndDequeue(PMTraceConsumer& consumer, const std::vector<DecodedEvent>& events, size_t dequeueInterval = 64 * 6,
+	std::vector<std::shared_ptr<PresentEvent>>* pOut = nullptr);
+
+// Builds an ETW event schema (TRACE_EVENT_INFO) and a matching 64-bit event payload, like the
+// EventMetadata events and user data found in a recorded ETL.
+class SyntheticEventSchema
+{
+public:
+	SyntheticEventSchema(uint16_t eventId)
+	{
+		desc_.Id = eventId;
+		desc_.Version = 1;
+		desc_.Opcode = 1;
+	}
+	SyntheticEventSchema& Add(const wchar_t* name, USHORT inType, USHORT length, ULONG countPropertyIndex = ULONG_MAX)
+	{
+		props_.push_back({ name, inType, length, countPropertyIndex });
+		return *this;
+	}
+	// Deliver the schema to metadata as an EventMetadata::EventInfo event would
+	void Register(EventMetadata& metadata) const
+	{
+		const auto headerSize = offsetof(TRACE_EVENT_INFO, EventPropertyInfoArray) + props_.size() * sizeof(EVENT_PROPERTY_INFO);
+		std::vector<uint8_t> buffer(headerSize, 0);
+		for (auto& prop : props_) {
+			const auto nameOffset = buffer.size();
+			const auto nameBytes = (wcslen(prop.name) + 1) * sizeof(wchar_t);
+			buffer.resize(nameOffset + nameBytes);
+			memcpy(buffer.data() + nameOffset, prop.name, nameBytes);
+		}
+		auto tei = (TRACE_EVENT_INFO*)buffer.data();
+		tei->ProviderGuid = providerGuid_;
+		tei->EventDescriptor = desc_;
+		tei->DecodingSource = DecodingSourceXMLFile;
+		tei->PropertyCount = tei->TopLevelPropertyCount = (ULONG)props_.size();
+		size_t nameOffset = headerSize;
+		for (size_t i = 0; i < props_.size(); i++) {
+			auto& epi = tei->EventPropertyInfoArray[i];
+			epi.NameOffset = (ULONG)nameOffset;
+			epi.nonStructType.InType = props_[i].inType;
+			epi.length = props_[i].length;
+			epi.count = 1;
+			if (props_[i].countPropertyIndex != ULONG_MAX) {
+				epi.Flags = PropertyParamCount;
+				epi.countPropertyIndex = (USHORT)props_[i].countPropertyIndex;
+			}
+			nameOffset += (wcslen(props_[i].name) + 1) * sizeof(wchar_t);
+		}
+
+		EVENT_RECORD record{};
+		record.EventHeader.EventDescriptor.Opcode = Microsoft_Windows_EventMetadata::EventInfo::Opcode;
+		record.UserData = buffer.data();
+		record.UserDataLength = (USHORT)buffer.size();
+		metadata.AddMetadata(&record);
+	}
+	EVENT_RECORD MakeRecord(std::vector<uint8_t>& payload) const
+	{
+		EVENT_RECORD record{};
+		record.EventHeader.Flags = EVENT_HEADER_FLAG_64_BIT_HEADER;
+		record.EventHeader.ProviderId = providerGuid_;
+		record.EventHeader.EventDescriptor = desc_;
+		record.UserData = payload.data();
+		record.UserDataLength = (USHORT)payload.size();
+		return record;
+	}
+private:
+	struct Property
+	{
+		const wchar_t* name;
+		USHORT inType;
+		USHORT length;
+		ULONG countPropertyIndex;
+	};
+	GUID providerGuid_{ 0x802ec45a, 0x1e99, 0x4b83, { 0x99, 0x20, 0x87, 0xc9, 0x82, 0x77, 0xba, 0x9d } };
+	EVENT_DESCRIPTOR desc_{};
+	std::vector<Property> props_;
+};
+
+// Schema shaped like DxgKrnl QueuePacket_Start: every property has a fixed offset
+SyntheticEventSchema MakeQueuePacketSchema();
+std::vector<uint8_t> MakeQueuePacketPayload(uint32_t submitSequence);
+
+// Schema shaped like DxgKrnl VSyncDPCMultiPlane_Info: arrays sized by count properties make
+// the offsets of later properties depend on the payload
+SyntheticEventSchema MakeSyncDPCMultiPlaneSchema();
+std::vector<uint8_t> MakeSyncDPCMultiPlanePayload(uint32_t submitSequence);
@@ -0,0 +1,204 @@
+#include "gtest/gtest.h"
+#include "ConsumerTestUtils.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Every field of a dequeued present that event handling sets.  FrameId comes from a
+	// process-wide counter, so it is compared relative to the first present of each run.
+	void ExpectSamePresent(const PresentEvent& expected, const PresentEvent& actual,
+		uint32_t expectedFirstFrameId, uint32_t actualFirstFrameId)
+	{
+		EXPECT_EQ(expected.PresentStartTime, actual.PresentStartTime);
+		EXPECT_EQ(expected.ProcessId, actual.ProcessId);
+		EXPECT_EQ(expected.ThreadId, actual.ThreadId);
+		EXPECT_EQ(expected.TimeInPresent, actual.TimeInPresent);
+		EXPECT_EQ(expected.GPUStartTime, actual.GPUStartTime);
+		EXPECT_EQ(expected.ReadyTime, actual.ReadyTime);
+		EXPECT_EQ(expected.GPUDuration, actual.GPUDuration);
+		EXPECT_EQ(expected.GPUVideoDuration, actual.GPUVideoDuration);
+		EXPECT_EQ(expected.InputTime, actual.InputTime);
+		EXPECT_EQ(expected.MouseClickTime, actual.MouseClickTime);
+		EXPECT_EQ(expected.AppPropagatedPresentStartTime, actual.AppPropagatedPresentStartTime);
+		EXPECT_EQ(expected.AppPropagatedTimeInPresent, actual.AppPropagatedTimeInPresent);
+		EXPECT_EQ(expected.AppPropagatedGPUStartTime, actual.AppPropagatedGPUStartTime);
+		EXPECT_EQ(expected.AppPropagatedReadyTime, actual.AppPropagatedReadyTime);
+		EXPECT_EQ(expected.AppPropagatedGPUDuration, actual.AppPropagatedGPUDuration);
+		EXPECT_EQ(expected.AppPropagatedGPUVideoDuration, actual.AppPropagatedGPUVideoDuration);
+		EXPECT_EQ(expected.AppFrameId, actual.AppFrameId);
+		EXPECT_EQ(expected.AppSleepStartTime, actual.AppSleepStartTime);
+		EXPECT_EQ(expected.AppSleepEndTime, actual.AppSleepEndTime);
+		EXPECT_EQ(expected.AppSimStartTime, actual.AppSimStartTime);
+		EXPECT_EQ(expected.AppSimEndTime, actual.AppSimEndTime);
+		EXPECT_EQ(expected.AppRenderSubmitStartTime, actual.AppRenderSubmitStartTime);
+		EXPECT_EQ(expected.AppRenderSubmitEndTime, actual.AppRenderSubmitEndTime);
+		EXPECT_EQ(expected.AppPresentStartTime, actual.AppPresentStartTime);
+		EXPECT_EQ(expected.AppPresentEndTime, actual.AppPresentEndTime);
+		EXPECT_EQ(expected.AppInputSample, actual.AppInputSample);
+		EXPECT_EQ(expected.PclFrameId, actual.PclFrameId);
+		EXPECT_EQ(expected.PclSimStartTime, actual.PclSimStartTime);
+		EXPECT_EQ(expected.PclSimEndTime, actual.PclSimEndTime);
+		EXPECT_EQ(expected.PclRenderSubmitStartTime, actual.PclRenderSubmitStartTime);
+		EXPECT_EQ(expected.PclRenderSubmitEndTime, actual.PclRenderSubmitEndTime);
+		EXPECT_EQ(expected.PclPresentStartTime, actual.PclPresentStartTime);
+		EXPECT_EQ(expected.PclPresentEndTime, actual.PclPresentEndTime);
+		EXPECT_EQ(expected.PclInputPingTime, actual.PclInputPingTime);
+		EXPECT_EQ(expected.PclInputReceivedTime, actual.PclInputReceivedTime);
+		EXPECT_EQ(expected.SwapChainAddress, actual.SwapChainAddress);
+		EXPECT_EQ(expected.SyncInterval, actual.SyncInterval);
+		EXPECT_EQ(expected.PresentFlags, actual.PresentFlags);
+		ASSERT_EQ(expected.Displayed.size(), actual.Displayed.size());
+		for (size_t i = 0; i < expected.Displayed.size(); i++) {
+			EXPECT_EQ(expected.Displayed[i], actual.Displayed[i]);
+		}
+		EXPECT_EQ(expected.CompositionSurfaceLuid, actual.CompositionSurfaceLuid);
+		EXPECT_EQ(expected.Win32KPresentCount, actual.Win32KPresentCount);
+		EXPECT_EQ(expected.Win32KBindId, actual.Win32KBindId);
+		EXPECT_EQ(expected.DxgkPresentHistoryToken, actual.DxgkPresentHistoryToken);
+		EXPECT_EQ(expected.DxgkPresentHistoryTokenData, actual.DxgkPresentHistoryTokenData);
+		EXPECT_EQ(expected.DxgkContext, actual.DxgkContext);
+		EXPECT_EQ(expected.Hwnd, actual.Hwnd);
+		EXPECT_EQ(expected.QueueSubmitSequence, actual.QueueSubmitSequence);
+		EXPECT_EQ(expected.DestWidth, actual.DestWidth);
+		EXPECT_EQ(expected.DestHeight, actual.DestHeight);
+		EXPECT_EQ(expected.DriverThreadId, actual.DriverThreadId);
+		EXPECT_EQ(expected.FrameId - expectedFirstFrameId, actual.FrameId - actualFirstFrameId);
+		EXPECT_EQ(expected.Runtime, actual.Runtime);
+		EXPECT_EQ(expected.PresentMode, actual.PresentMode);
+		EXPECT_EQ(expected.FinalState, actual.FinalState);
+		EXPECT_EQ(expected.InputType, actual.InputType);
+		EXPECT_EQ(expected.SupportsTearing, actual.SupportsTearing);
+		EXPECT_EQ(expected.WaitForFlipEvent, actual.WaitForFlipEvent);
+		EXPECT_EQ(expected.WaitForMPOFlipEvent, actual.WaitForMPOFlipEvent);
+		EXPECT_EQ(expected.SeenDxgkPresent, actual.SeenDxgkPresent);
+		EXPECT_EQ(expected.SeenWin32KEvents, actual.SeenWin32KEvents);
+		EXPECT_EQ(expected.SeenInFrameEvent, actual.SeenInFrameEvent);
+		EXPECT_EQ(expected.GpuFrameCompleted, actual.GpuFrameCompleted);
+		EXPECT_EQ(expected.IsCompleted, actual.IsCompleted);
+		EXPECT_EQ(expected.IsLost, actual.IsLost);
+		EXPECT_EQ(expected.PresentFailed, actual.PresentFailed);
+		EXPECT_EQ(expected.IsHybridPresent, actual.IsHybridPresent);
+		EXPECT_EQ(expected.FlipDelay, actual.FlipDelay);
+		EXPECT_EQ(expected.FlipToken, actual.FlipToken);
+	}
+}
+
+TEST(DecodedEvent, ReplayMatchesDirectHandlers)
+{
+	constexpr uint32_t presentCount = 1000;
+	constexpr uint32_t swapChains = 4;
+
+	PMTraceConsumer direct;
+	direct.mTrackInput = true;
+	SyntheticPresentStream stream{ direct, swapChains, true };
+	std::vector<std::shared_ptr<PresentEvent>> directPresents;
+	stream.Run(presentCount, 64, &directPresents);
+
+	PMTraceConsumer replayed;
+	replayed.mTrackInput = true;
+	std::vector<std::shared_ptr<PresentEvent>> replayedPresents;
+	ReplayAndDequeue(replayed, MakeDecodedLegacyFlipStream(presentCount, swapChains, true), 64 * 6, &replayedPresents);
+
+	ASSERT_EQ(directPresents.size(), replayedPresents.size());
+	ASSERT_FALSE(directPresents.empty());
+	size_t withInput = 0;
+	for (size_t i = 0; i < directPresents.size(); i++) {
+		SCOPED_TRACE(i);
+		ExpectSamePresent(*directPresents[i], *replayedPresents[i],
+			directPresents.front()->FrameId, replayedPresents.front()->FrameId);
+		withInput += replayedPresents[i]->InputTime != 0;
+	}
+	EXPECT_EQ(presentCount / 4, withInput);
+}
+
+TEST(DecodedEvent, PresentsDequeueInCompletionOrder)
+{
+	PMTraceConsumer consumer;
+	std::vector<std::shared_ptr<PresentEvent>> presents;
+	ReplayAndDequeue(consumer, MakeDecodedLegacyFlipStream(1000, 4), 64 * 6, &presents);
+
+	ASSERT_FALSE(presents.empty());
+	for (size_t i = 1; i < presents.size(); i++) {
+		SCOPED_TRACE(i);
+		const auto& prev = *presents[i - 1];
+		const auto& next = *presents[i];
+		EXPECT_NE(0u, next.CompletionTime);
+		EXPECT_TRUE(prev.CompletionTime < next.CompletionTime ||
+			(prev.CompletionTime == next.CompletionTime && prev.CompletionSequence < next.CompletionSequence));
+	}
+}
+
+TEST(DecodedEvent, ProcessImageNameSpansRecords)
+{
+	const std::wstring longName = L"a-process-name-longer-than-two-image-name-records.exe";
+	ASSERT_GT(longName.size(), 2 * std::size(DecodedEvent{}.ProcessImageName.Chars));
+
+	std::vector<DecodedEvent> events;
+	auto ev = MakeDecodedEvent(DecodedEventType::ProcessStart, 100, 0, 0);
+	ev.Process.ProcessId = 1234;
+	ev.Process.ImageNameLength = (uint32_t)longName.size();
+	events.push_back(ev);
+	for (size_t i = 0; i < longName.size(); i += std::size(ev.ProcessImageName.Chars)) {
+		ev = MakeDecodedEvent(DecodedEventType::ProcessImageName, 100, 0, 0);
+		for (size_t j = 0; j < std::size(ev.ProcessImageName.Chars) && i + j < longName.size(); j++) {
+			ev.ProcessImageName.Chars[j] = (uint16_t)longName[i + j];
+		}
+		events.push_back(ev);
+	}
+	ev = MakeDecodedEvent(DecodedEventType::ProcessStart, 200, 0, 0);
+	ev.Process.ProcessId = 5678;
+	events.push_back(ev);
+	ev = MakeDecodedEvent(DecodedEventType::ProcessStop, 300, 0, 0);
+	ev.Process.ProcessId = 1234;
+	events.push_back(ev);
+
+	PMTraceConsumer consumer;
+	for (const auto& e : events) {
+		consumer.HandleDecodedEvent(e);
+	}
+	std::vector<ProcessEvent> processEvents;
+	consumer.DequeueProcessEvents(processEvents);
+	ASSERT_EQ(3u, processEvents.size());
+	EXPECT_TRUE(processEvents[0].IsStartEvent);
+	EXPECT_EQ(1234u, processEvents[0].ProcessId);
+	EXPECT_EQ(100u, processEvents[0].QpcTime);
+	EXPECT_EQ(longName, processEvents[0].ImageFileName);
+	EXPECT_TRUE(processEvents[1].IsStartEvent);
+	EXPECT_EQ(5678u, processEvents[1].ProcessId);
+	EXPECT_TRUE(processEvents[1].ImageFileName.empty());
+	EXPECT_FALSE(processEvents[2].IsStartEvent);
+	EXPECT_EQ(1234u, processEvents[2].ProcessId);
+}
+
+TEST(DecodedEvent, FileRoundTrip)
+{
+	const auto events = MakeDecodedLegacyFlipStream(10'000, 2);
+	const auto path = std::filesystem::temp_directory_path() / L"pmult-decoded-events.pmir";
+
+	{
+		DecodedEventWriter writer;
+		ASSERT_TRUE(writer.Open(path.c_str(), 10'000'000, 1'000'000, 0));
+		PMTraceConsumer recorder;
+		recorder.mDecodedEventRecorder = &writer;
+		ReplayAndDequeue(recorder, events);
+		writer.Close();
+		EXPECT_EQ(events.size(), writer.GetRecordCount());
+	}
+
+	DecodedEventReader reader;
+	ASSERT_TRUE(reader.Open(path.c_str()));
+	EXPECT_EQ(10'000'000u, reader.GetHeader().TimestampFrequency);
+	PMTraceConsumer replayed;
+	EXPECT_EQ(events.size(), ReplayDecodedEvents(&reader, &replayed));
+	reader.Close();
+
+	std::vector<std::shared_ptr<PresentEvent>> presents;
+	replayed.DequeuePresentEvents(presents);
+	EXPECT_GT(presents.size(), 0u);
+
+	std::filesystem::remove(path);
+}
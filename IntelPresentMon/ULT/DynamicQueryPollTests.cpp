@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "../PresentMonMiddleware/DynamicQueryPoll.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+using namespace pmon;
+
+namespace
+{
+	constexpr uint32_t numSwapChains = 2;
+	constexpr size_t blobSize = 8;
+
+	// polls a process by filling the blob of each of its swap chains with the low byte of its pid
+	PM_STATUS PollLiveProcess(uint32_t processId, uint8_t* pBlob, uint32_t* pNumSwapChains)
+	{
+		*pNumSwapChains = 1;
+		std::fill_n(pBlob, blobSize, uint8_t(processId));
+		return PM_STATUS_SUCCESS;
+	}
+}
+
+TEST(DynamicQueryPollTests, DeadProcessesDoNotStopThePollOfTheOthers)
+{
+	const std::vector<uint32_t> processIds{ 11, 22, 33, 44 };
+	std::vector<uint8_t> blobs(processIds.size() * numSwapChains * blobSize);
+	std::vector<PM_DYNAMIC_QUERY_PROCESS_RESULT> results(processIds.size());
+
+	// 22 has exited, and the stream of 33 fails while it is being polled
+	const auto numPolled = mid::PollDynamicQueryEachProcess(processIds, numSwapChains, blobSize,
+		blobs.data(), results.data(), [](uint32_t processId, uint8_t* pBlob, uint32_t* pNumSwapChains) {
+			if (processId == 22) {
+				return PM_STATUS_INVALID_PID;
+			}
+			if (processId == 33) {
+				throw std::runtime_error{ "stream went away" };
+			}
+			return PollLiveProcess(processId, pBlob, pNumSwapChains);
+		});
+
+	ASSERT_EQ(numPolled, 4u);
+	const PM_STATUS expectedStatus[]{ PM_STATUS_SUCCESS, PM_STATUS_INVALID_PID, PM_STATUS_FAILURE, PM_STATUS_SUCCESS };
+	for (size_t i = 0; i < processIds.size(); i++) {
+		EXPECT_EQ(results[i].processId, processIds[i]);
+		EXPECT_EQ(results[i].status, expectedStatus[i]);
+		EXPECT_EQ(results[i].numSwapChains, expectedStatus[i] == PM_STATUS_SUCCESS ? 1u : 0u);
+	}
+	// the live processes' blobs are where they are packed, whatever happened to the processes before them
+	EXPECT_EQ(blobs[0], 11);
+	EXPECT_EQ(blobs[3 * numSwapChains * blobSize], 44);
+	EXPECT_EQ(blobs[1 * numSwapChains * blobSize], 0);
+}
+
+TEST(DynamicQueryPollTests, QueryOnNonDefaultAdapterSwitchesToIt)
+{
+	// no adapter is active before the first poll
+	EXPECT_EQ(mid::GetQueryAdapterSwitch(1, UINT32_MAX), 1u);
+	// the default adapter is active
+	EXPECT_EQ(mid::GetQueryAdapterSwitch(1, 0), 1u);
+	// already on the adapter of the query
+	EXPECT_FALSE(mid::GetQueryAdapterSwitch(1, 1));
+	// a query that references no adapter keeps the active one
+	EXPECT_FALSE(mid::GetQueryAdapterSwitch({}, 0));
+}
@@ -0,0 +1,57 @@
+#include "gtest/gtest.h"
+#include "ConsumerTestUtils.h"
+
+TEST(EventMetadata, CompiledLayoutMatchesPropertyWalk)
+{
+	for (bool compiled : { false, true }) {
+		EventMetadata metadata;
+		metadata.useCompiledLayouts_ = compiled;
+		const auto queuePacket = MakeQueuePacketSchema();
+		const auto syncDPC = MakeSyncDPCMultiPlaneSchema();
+		queuePacket.Register(metadata);
+		syncDPC.Register(metadata);
+
+		// Decode twice so the second lookup uses the cached layout and query names
+		for (int pass = 0; pass < 2; pass++) {
+			auto payload = MakeQueuePacketPayload(77);
+			auto record = queuePacket.MakeRecord(payload);
+			EventDataDesc desc[] = {
+				{ L"PacketType" },
+				{ L"SubmitSequence" },
+				{ L"hContext" },
+				{ L"bPresent" },
+			};
+			metadata.GetEventData(&record, desc, _countof(desc));
+			EXPECT_EQ(4u, desc[0].GetData<uint32_t>());
+			EXPECT_EQ(77u, desc[1].GetData<uint32_t>());
+			EXPECT_EQ(0xFFFF'C000'1234'0000ull, desc[2].GetData<uint64_t>());
+			EXPECT_NE(0u, desc[2].status_ & PROP_STATUS_POINTER_SIZE);
+			EXPECT_TRUE(desc[3].GetData<BOOL>() != 0);
+
+			payload = MakeSyncDPCMultiPlanePayload(91);
+			record = syncDPC.MakeRecord(payload);
+			EventDataDesc mpoDesc[] = {
+				{ L"PlaneCount" },
+				{ L"ScannedPhysicalAddress" },
+				{ L"FlipEntryCount" },
+				{ L"FlipSubmitSequence" },
+			};
+			metadata.GetEventData(&record, mpoDesc, _countof(mpoDesc));
+			const auto planeCount = mpoDesc[0].GetData<uint32_t>();
+			ASSERT_EQ(2u, planeCount);
+			EXPECT_EQ(0x2000ull, mpoDesc[1].GetArray<uint64_t>(planeCount)[1]);
+			const auto flipEntryCount = mpoDesc[2].GetData<uint32_t>();
+			ASSERT_EQ(1u, flipEntryCount);
+			EXPECT_EQ(91u, (uint32_t)(mpoDesc[3].GetArray<uint64_t>(flipEntryCount)[0] >> 32));
+
+			uint32_t count = 2;
+			EventDataDesc missingDesc[] = {
+				{ L"VidPnTargetId" },
+				{ L"NotAProperty" },
+			};
+			metadata.GetEventData(&record, missingDesc, &count);
+			EXPECT_EQ(1u, count);
+			EXPECT_EQ(1u, missingDesc[0].GetData<uint32_t>());
+		}
+	}
+}
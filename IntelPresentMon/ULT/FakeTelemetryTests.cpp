@@ -0,0 +1,151 @@
+#include "gtest/gtest.h"
+#include "../ControlLib/FakeTelemetrySource.h"
+#include "../ControlLib/PresentMonPowerTelemetry.h"
+#include <array>
+#include <sstream>
+
+namespace
+{
+    using pwr::fake::Waveform;
+    using Shape = Waveform::Shape;
+    using Gpu = GpuTelemetryCapBits;
+    using Generator = pwr::fake::FakeTelemetryGenerator<PresentMonPowerTelemetryInfo, Gpu,
+        size_t(Gpu::gpu_telemetry_count)>;
+
+    const std::array<Generator::Field, 2> fields{ {
+        { Gpu::gpu_power, "gpu_power", { Shape::Sine, 100., 50., 1., 5. },
+            [](PresentMonPowerTelemetryInfo& i, double v) { i.gpu_power_w = v; } },
+        { Gpu::gpu_utilization, "gpu_utilization", { Shape::Square, 90., 20., 1. },
+            [](PresentMonPowerTelemetryInfo& i, double v) { i.gpu_utilization = v; }, 100. },
+    } };
+
+    std::optional<pwr::fake::TelemetryTrace> LoadTrace(const char* csv)
+    {
+        std::istringstream stream{ csv };
+        return pwr::fake::TelemetryTrace::Load(stream);
+    }
+}
+
+TEST(FakeTelemetry, waveformsFollowTheirShape)
+{
+    std::mt19937 rng;
+    const Waveform sine{ Shape::Sine, 10., 2., 0.5 };
+    EXPECT_NEAR(10., sine.Evaluate(0., rng), 1e-9);
+    EXPECT_NEAR(12., sine.Evaluate(0.5, rng), 1e-9);
+    EXPECT_NEAR(8., sine.Evaluate(1.5, rng), 1e-9);
+
+    // high for the first half of each cycle, low for the second
+    const Waveform square{ Shape::Square, 10., 2., 0.5 };
+    EXPECT_DOUBLE_EQ(12., square.Evaluate(0.2, rng));
+    EXPECT_DOUBLE_EQ(8., square.Evaluate(1.2, rng));
+    EXPECT_DOUBLE_EQ(12., square.Evaluate(2.2, rng));
+
+    const Waveform constant{ Shape::Constant, 7. };
+    EXPECT_DOUBLE_EQ(7., constant.Evaluate(123., rng));
+}
+
+TEST(FakeTelemetry, parsesWaveforms)
+{
+    const auto sine = Waveform::Parse("sine:150,50,0.5,2");
+    ASSERT_TRUE(sine);
+    EXPECT_EQ(Shape::Sine, sine->shape);
+    EXPECT_DOUBLE_EQ(150., sine->offset);
+    EXPECT_DOUBLE_EQ(50., sine->amplitude);
+    EXPECT_DOUBLE_EQ(0.5, sine->frequency);
+    EXPECT_DOUBLE_EQ(2., sine->noise);
+
+    // numbers left out are 0
+    const auto constant = Waveform::Parse("const:42");
+    ASSERT_TRUE(constant);
+    EXPECT_EQ(Shape::Constant, constant->shape);
+    EXPECT_DOUBLE_EQ(42., constant->offset);
+    EXPECT_DOUBLE_EQ(0., constant->noise);
+
+    EXPECT_FALSE(Waveform::Parse("triangle:1,2"));
+    EXPECT_FALSE(Waveform::Parse("sine:1,x"));
+    EXPECT_FALSE(Waveform::Parse("sine:1,2,3,4,5"));
+}
+
+TEST(FakeTelemetry, noiseIsRepeatableForASeed)
+{
+    const pwr::fake::FakeTelemetryConfig config{ .seed = 7 };
+    Generator first{ fields, config, 0 };
+    Generator again{ fields, config, 0 };
+    Generator other{ fields, config, 1 };
+    bool othersDiffer = false;
+    for (int i = 0; i < 100; i++) {
+        PresentMonPowerTelemetryInfo a{}, b{}, c{};
+        const auto caps = first.Generate(a, i * 0.01);
+        again.Generate(b, i * 0.01);
+        other.Generate(c, i * 0.01);
+        EXPECT_TRUE(caps.test(size_t(Gpu::gpu_power)));
+        EXPECT_TRUE(caps.test(size_t(Gpu::gpu_utilization)));
+        EXPECT_EQ(2u, caps.count());
+        EXPECT_EQ(a.gpu_power_w, b.gpu_power_w);
+        othersDiffer |= a.gpu_power_w != c.gpu_power_w;
+        // noise stays near the wave
+        EXPECT_NEAR(100. + 50. * std::sin(2. * std::numbers::pi * i * 0.01), a.gpu_power_w, 30.);
+    }
+    EXPECT_TRUE(othersDiffer);
+}
+
+TEST(FakeTelemetry, configuredWaveformsReplaceDefaultsAndAreClamped)
+{
+    pwr::fake::FakeTelemetryConfig config;
+    config.waveforms.emplace_back("gpu_power", Waveform{ Shape::Constant, 250. });
+    config.waveforms.emplace_back("gpu_utilization", Waveform{ Shape::Constant, 150. });
+    Generator generator{ fields, config, 0 };
+    PresentMonPowerTelemetryInfo info{};
+    generator.Generate(info, 3.);
+    EXPECT_DOUBLE_EQ(250., info.gpu_power_w);
+    EXPECT_DOUBLE_EQ(100., info.gpu_utilization);
+
+    std::mt19937 rng;
+    EXPECT_EQ(250., generator.GetValue(Gpu::gpu_power, 3., rng));
+    EXPECT_FALSE(generator.GetValue(Gpu::gpu_temperature, 3., rng));
+}
+
+TEST(FakeTelemetry, replaysTraceAtSpeed)
+{
+    auto trace = LoadTrace(
+        "time,gpu_power\n"
+        "10.0,100\n"
+        "10.5,200\n"
+        "11.0,300\n"
+        "12.0,100\n");
+    ASSERT_TRUE(trace);
+    EXPECT_DOUBLE_EQ(2., trace->GetDuration());
+    ASSERT_TRUE(trace->FindColumn("gpu_power"));
+    EXPECT_FALSE(trace->FindColumn("gpu_temperature"));
+
+    pwr::fake::FakeTelemetryConfig config{
+        .trace = std::make_shared<pwr::fake::TelemetryTrace>(std::move(*trace)),
+        .replaySpeed = 4.,
+    };
+    Generator generator{ fields, config, 0 };
+    PresentMonPowerTelemetryInfo info{};
+    // 4x speed puts 0.125 s at 0.5 s into the trace
+    generator.Generate(info, 0.125);
+    EXPECT_DOUBLE_EQ(200., info.gpu_power_w);
+    // interpolated between the rows, at 1.5 s into the trace
+    generator.Generate(info, 0.375);
+    EXPECT_DOUBLE_EQ(200., info.gpu_power_w);
+    // looped around to 0.25 s into the trace
+    generator.Generate(info, 0.5625);
+    EXPECT_DOUBLE_EQ(150., info.gpu_power_w);
+    // caps the trace does not hold keep to their waveforms, in real time
+    EXPECT_DOUBLE_EQ(70., info.gpu_utilization);
+}
+
+TEST(FakeTelemetry, malformedTracesAreRejected)
+{
+    EXPECT_FALSE(LoadTrace(""));
+    EXPECT_FALSE(LoadTrace("time,gpu_power\n"));
+    EXPECT_FALSE(LoadTrace("time\n0\n"));
+    EXPECT_FALSE(LoadTrace("time,gpu_power\n0,1\n1\n"));
+    EXPECT_FALSE(LoadTrace("time,gpu_power\n0,1\n1,x\n"));
+    // time going backwards
+    EXPECT_FALSE(LoadTrace("time,gpu_power\n1,1\n0,2\n"));
+    // windows line endings and blank lines are fine
+    EXPECT_TRUE(LoadTrace("time, gpu_power\r\n\r\n0, 1\r\n1, 2\r\n"));
+}
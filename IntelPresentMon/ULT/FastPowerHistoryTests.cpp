@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include "../ControlLib/FastPowerHistory.h"
+
+namespace
+{
+    // 10 MHz qpc, so that a 1 ms sampling interval is 10000 ticks
+    constexpr double qpcPeriod = 1e-7;
+    constexpr uint64_t ms = 10'000;
+
+    pwr::FastPowerReading Counter(double energyJ)
+    {
+        return pwr::FastPowerReading{ .energy_j = energyJ };
+    }
+
+    pwr::FastPowerReading Power(double powerW)
+    {
+        return pwr::FastPowerReading{ .power_w = powerW };
+    }
+}
+
+TEST(FastPowerHistory, integratesEnergyCounter)
+{
+    pwr::FastPowerHistory history{ 4096, qpcPeriod };
+    // 100 W is 0.1 J per ms
+    for (uint64_t i = 1; i <= 100; i++) {
+        history.Push(i * ms, Counter(1000. + 0.1 * double(i)));
+    }
+    const auto frame = history.GetFrameEnergy(10 * ms, 26 * ms);
+    ASSERT_TRUE(frame);
+    EXPECT_NEAR(1.6, frame->energy_j, 1e-6);
+    EXPECT_NEAR(100., frame->power_w, 1e-3);
+
+    // frames do not have to start or end on a sample
+    const auto between = history.GetFrameEnergy(10 * ms + ms / 2, 20 * ms + ms / 4);
+    ASSERT_TRUE(between);
+    EXPECT_NEAR(0.975, between->energy_j, 1e-6);
+    EXPECT_NEAR(100., between->power_w, 1e-3);
+}
+
+TEST(FastPowerHistory, integratesPowerReadings)
+{
+    pwr::FastPowerHistory history{ 4096, qpcPeriod };
+    // power ramping up by 1 W per ms, which the trapezoidal rule integrates exactly
+    for (uint64_t i = 0; i <= 100; i++) {
+        history.Push(i * ms, Power(double(i)));
+    }
+    // from 10 W to 30 W over 20 ms is 0.4 J
+    const auto frame = history.GetFrameEnergy(10 * ms, 30 * ms);
+    ASSERT_TRUE(frame);
+    EXPECT_NEAR(0.4, frame->energy_j, 1e-6);
+    EXPECT_NEAR(20., frame->power_w, 1e-3);
+}
+
+TEST(FastPowerHistory, resolvesPowerWithinAFrame)
+{
+    pwr::FastPowerHistory history{ 4096, qpcPeriod };
+    // a 5 ms excursion to 300 W in 50 W of idle
+    double energy = 0.;
+    for (uint64_t i = 1; i <= 100; i++) {
+        energy += (i > 40 && i <= 45 ? 300. : 50.) / 1000.;
+        history.Push(i * ms, Counter(energy));
+    }
+    const auto spike = history.GetFrameEnergy(34 * ms, 50 * ms);
+    const auto idle = history.GetFrameEnergy(50 * ms, 66 * ms);
+    ASSERT_TRUE(spike);
+    ASSERT_TRUE(idle);
+    EXPECT_NEAR(0.55 + 1.5, spike->energy_j, 1e-6);
+    EXPECT_NEAR(0.8, idle->energy_j, 1e-6);
+    EXPECT_NEAR(50., idle->power_w, 1e-3);
+}
+
+TEST(FastPowerHistory, spansOutsideTheHistoryHaveNoEnergy)
+{
+    // 16 samples
+    pwr::FastPowerHistory history{ 16, qpcPeriod };
+    EXPECT_FALSE(history.GetFrameEnergy(1 * ms, 2 * ms));
+    for (uint64_t i = 1; i <= 100; i++) {
+        history.Push(i * ms, Power(100.));
+    }
+    // aged out of the history
+    EXPECT_FALSE(history.GetFrameEnergy(50 * ms, 95 * ms));
+    // empty or reversed spans, and frames without a previous present
+    EXPECT_FALSE(history.GetFrameEnergy(95 * ms, 95 * ms));
+    EXPECT_FALSE(history.GetFrameEnergy(96 * ms, 95 * ms));
+    EXPECT_FALSE(history.GetFrameEnergy(0, 95 * ms));
+
+    // the newest power is held for a couple of sampling intervals past the newest sample
+    const auto held = history.GetFrameEnergy(96 * ms, 101 * ms + ms / 2);
+    ASSERT_TRUE(held);
+    EXPECT_NEAR(0.55, held->energy_j, 1e-6);
+    EXPECT_FALSE(history.GetFrameEnergy(96 * ms, 103 * ms));
+}
+
+TEST(FastPowerHistory, counterSteppingBackUsesNoEnergy)
+{
+    pwr::FastPowerHistory history{ 4096, qpcPeriod };
+    history.Push(1 * ms, Counter(10.));
+    history.Push(2 * ms, Counter(10.1));
+    // counter reset
+    history.Push(3 * ms, Counter(0.));
+    history.Push(4 * ms, Counter(0.1));
+    // out of order samples are dropped
+    history.Push(4 * ms, Counter(50.));
+    history.Push(3 * ms, Counter(50.));
+    const auto frame = history.GetFrameEnergy(1 * ms, 4 * ms);
+    ASSERT_TRUE(frame);
+    EXPECT_NEAR(0.2, frame->energy_j, 1e-6);
+}
@@ -0,0 +1,27 @@
+#include "gtest/gtest.h"
+#include "../CommonUtilities/FlatHashMap.h"
+
+#include <cstdint>
+
+TEST(FlatHashMap, EraseWhileIteratingVisitsEveryElement)
+{
+	pmon::util::FlatHashMap<uint64_t, int> map;
+	for (uint64_t i = 0; i < 1000; i++) {
+		map.emplace(i * 4096, int(i));
+	}
+	size_t erased = 0;
+	for (auto ii = map.begin(), ie = map.end(); ii != ie; ) {
+		if (ii->second % 3 == 0) {
+			ii = map.erase(ii);
+			erased++;
+		}
+		else {
+			++ii;
+		}
+	}
+	EXPECT_EQ(334u, erased);
+	EXPECT_EQ(666u, map.size());
+	for (uint64_t i = 0; i < 1000; i++) {
+		EXPECT_EQ(i % 3 != 0, map.contains(i * 4096));
+	}
+}
@@ -0,0 +1,431 @@
+#include "gtest/gtest.h"
+#include "FrameQueryReference.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr long long qpcFrequency = 10'000'000;
+	constexpr uint64_t qpcStart = 1'000'000;
+
+	template<typename F>
+	double MeasureSeconds(F&& f)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		f();
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// A present stream that takes the frame metrics down their different paths: dropped frames,
+	// frames displayed twice with a generated frame, collapsed presents with flip delay, input,
+	// and app provided then PC latency simulation starts.
+	std::vector<PmNsmFrameData> MakeFrames(size_t count)
+	{
+		std::mt19937_64 rng{ 7 };
+		std::uniform_int_distribution<uint64_t> jitter{ 0, 20'000 };
+		std::vector<PmNsmFrameData> frames(count);
+		uint64_t qpc = qpcStart;
+		for (size_t i = 0; i < count; i++) {
+			auto& pe = frames[i].present_event;
+			qpc += 150'000 + jitter(rng);
+			pe.PresentStartTime = qpc;
+			pe.TimeInPresent = 2'000 + jitter(rng) / 10;
+			pe.GPUStartTime = qpc - 60'000;
+			pe.ReadyTime = qpc + 30'000 + jitter(rng);
+			pe.GPUDuration = 50'000 + jitter(rng);
+			pe.FrameId = uint32_t(i + 1);
+			pe.SwapChainAddress = 0x1000;
+			pe.SyncInterval = 1;
+			pe.PresentFlags = 0x200;
+			pe.SupportsTearing = i % 2 == 0;
+			pe.Runtime = Runtime::DXGI;
+			pe.PresentMode = PresentMode::Hardware_Independent_Flip;
+			if (i % 7 == 3) {
+				pe.FinalState = PresentResult::Discarded;
+			}
+			else {
+				pe.FinalState = PresentResult::Presented;
+				auto screenTime = pe.ReadyTime + 40'000;
+				if (i % 13 == 0) {
+					// displayed after the next present, which is collapsed into this one
+					pe.FlipDelay = 5'000;
+					screenTime += 400'000;
+				}
+				if (i % 5 == 0) {
+					pe.Displayed_FrameType[0] = FrameType::Intel_XEFG;
+					pe.Displayed_ScreenTime[0] = screenTime;
+					pe.Displayed_FrameType[1] = FrameType::Application;
+					pe.Displayed_ScreenTime[1] = screenTime + 80'000;
+					pe.DisplayedCount = 2;
+				}
+				else {
+					pe.Displayed_FrameType[0] = FrameType::Application;
+					pe.Displayed_ScreenTime[0] = screenTime;
+					pe.DisplayedCount = 1;
+				}
+			}
+			if (i % 11 == 0) {
+				pe.MouseClickTime = qpc - 100'000;
+			}
+			if (i % 4 == 0) {
+				pe.InputTime = qpc - 120'000;
+			}
+			if (i >= count / 2) {
+				pe.PclSimStartTime = qpc - 90'000;
+				if (i % 3 == 0) {
+					pe.PclInputPingTime = qpc - 110'000;
+				}
+			}
+			else if (i >= count / 4) {
+				pe.AppSimStartTime = qpc - 80'000;
+				pe.AppSleepEndTime = qpc - 85'000;
+			}
+			auto& gpu = frames[i].power_telemetry;
+			gpu.gpu_power_w = 100. + double(i % 10);
+			gpu.gpu_frequency_mhz = 2'000. + double(i % 50);
+			gpu.gpu_temperature_c = 60. + double(i % 3);
+			gpu.gpu_utilization = double(i % 100);
+			gpu.gpu_mem_used_b = 1'000'000 + i;
+			gpu.fan_speed_rpm = { 1'000., 1'100., 1'200., 0., 0. };
+			gpu.gpu_power_limited = i % 9 == 0;
+			auto& cpu = frames[i].cpu_telemetry;
+			cpu.cpu_utilization = double(i % 100);
+			cpu.cpu_power_w = 45. + double(i % 7);
+			cpu.cpu_frequency = 4'000.;
+		}
+		return frames;
+	}
+
+	// Walks the frames the way the middleware consumes them from the NSM ring, calling gather for
+	// every output frame.
+	template<typename F>
+	void ConsumeFrames(const std::vector<PmNsmFrameData>& frames, PM_FRAME_QUERY::Context& ctx, F&& gather)
+	{
+		const auto isDisplayed = [](const PmNsmFrameData& f) {
+			return f.present_event.FinalState == PresentResult::Presented && f.present_event.DisplayedCount > 0;
+		};
+		std::vector<const PmNsmFrameData*> nextDisplayed(frames.size());
+		const PmNsmFrameData* pNext = nullptr;
+		for (size_t i = frames.size(); i-- > 0;) {
+			nextDisplayed[i] = pNext;
+			if (isDisplayed(frames[i])) {
+				pNext = &frames[i];
+			}
+		}
+		const PmNsmFrameData* pLastDisplayed = nullptr;
+		const PmNsmFrameData* pBeforeLastDisplayed = nullptr;
+		for (size_t i = 1; i < frames.size(); i++) {
+			const auto& frame = frames[i];
+			if (nextDisplayed[i]) {
+				ctx.UpdateSourceData(&frame, nextDisplayed[i], &frames[i - 1], &frames[i - 1],
+					pLastDisplayed, pLastDisplayed, pBeforeLastDisplayed);
+				if (ctx.dropped && frame.present_event.DisplayedCount == 0) {
+					gather(ctx);
+				}
+				else {
+					for (; ctx.sourceFrameDisplayIndex < frame.present_event.DisplayedCount; ctx.sourceFrameDisplayIndex++) {
+						ctx.avgInput2Fs = frame.present_event.PclSimStartTime != 0 ? 3.5 : 0.;
+						gather(ctx);
+					}
+				}
+			}
+			if (isDisplayed(frame)) {
+				pBeforeLastDisplayed = &frames[i - 1];
+				pLastDisplayed = &frame;
+			}
+		}
+	}
+
+	std::vector<PM_QUERY_ELEMENT> MakeQuery(std::initializer_list<PM_METRIC> metrics)
+	{
+		std::vector<PM_QUERY_ELEMENT> elements;
+		for (auto metric : metrics) {
+			elements.push_back(PM_QUERY_ELEMENT{ metric, PM_STAT_NONE, 0, 0 });
+		}
+		return elements;
+	}
+
+	// every metric gathered from frame data, other than the application name and fan speed whose
+	// gather commands write past the element
+	std::vector<PM_QUERY_ELEMENT> MakeAllMetricsQuery()
+	{
+		return MakeQuery({
+			PM_METRIC_SWAP_CHAIN_ADDRESS, PM_METRIC_PRESENT_RUNTIME, PM_METRIC_SYNC_INTERVAL, PM_METRIC_PRESENT_FLAGS,
+			PM_METRIC_DROPPED_FRAMES, PM_METRIC_ALLOWS_TEARING, PM_METRIC_PRESENT_MODE, PM_METRIC_FRAME_TYPE,
+			PM_METRIC_CPU_START_QPC, PM_METRIC_PRESENT_START_QPC, PM_METRIC_CPU_START_TIME, PM_METRIC_PRESENT_START_TIME,
+			PM_METRIC_BETWEEN_PRESENTS, PM_METRIC_IN_PRESENT_API, PM_METRIC_RENDER_PRESENT_LATENCY,
+			PM_METRIC_UNTIL_DISPLAYED, PM_METRIC_BETWEEN_DISPLAY_CHANGE, PM_METRIC_BETWEEN_SIMULATION_START,
+			PM_METRIC_CPU_FRAME_TIME, PM_METRIC_BETWEEN_APP_START, PM_METRIC_CPU_BUSY, PM_METRIC_CPU_WAIT,
+			PM_METRIC_GPU_LATENCY, PM_METRIC_GPU_TIME, PM_METRIC_GPU_BUSY, PM_METRIC_GPU_WAIT,
+			PM_METRIC_DISPLAYED_TIME, PM_METRIC_DISPLAY_LATENCY, PM_METRIC_ANIMATION_ERROR, PM_METRIC_ANIMATION_TIME,
+			PM_METRIC_CLICK_TO_PHOTON_LATENCY, PM_METRIC_ALL_INPUT_TO_PHOTON_LATENCY, PM_METRIC_INSTRUMENTED_LATENCY,
+			PM_METRIC_PC_LATENCY, PM_METRIC_FLIP_DELAY,
+			PM_METRIC_GPU_POWER, PM_METRIC_GPU_FREQUENCY, PM_METRIC_GPU_TEMPERATURE, PM_METRIC_GPU_UTILIZATION,
+			PM_METRIC_GPU_MEM_USED, PM_METRIC_GPU_POWER_LIMITED,
+			PM_METRIC_CPU_UTILIZATION, PM_METRIC_CPU_POWER, PM_METRIC_CPU_FREQUENCY,
+		});
+	}
+
+	std::vector<PM_QUERY_ELEMENT> MakeFrameTimesQuery()
+	{
+		return MakeQuery({
+			PM_METRIC_CPU_START_QPC, PM_METRIC_BETWEEN_PRESENTS, PM_METRIC_CPU_BUSY, PM_METRIC_CPU_WAIT,
+			PM_METRIC_GPU_BUSY, PM_METRIC_GPU_WAIT, PM_METRIC_DISPLAYED_TIME, PM_METRIC_DISPLAY_LATENCY,
+		});
+	}
+
+	std::unique_ptr<PM_FRAME_QUERY::Context> MakeContext(FrameTimingData& frameTimingData)
+	{
+		return std::make_unique<PM_FRAME_QUERY::Context>(qpcStart, qpcFrequency, frameTimingData);
+	}
+}
+
+TEST(FrameEventQuery, CompiledOpsMatchGatherCommands)
+{
+	const auto frames = MakeFrames(2'000);
+	auto elements = MakeAllMetricsQuery();
+	PM_FRAME_QUERY query{ elements };
+	const auto blobSize = query.GetBlobSize();
+	// the compiled query must lay the blob out the way the gather commands do
+	ReferenceFrameQuery referenceQuery{ elements };
+	ASSERT_EQ(referenceQuery.GetBlobSize(), blobSize);
+	ASSERT_EQ(elements.size(), referenceQuery.GetOutputOffsets().size());
+	for (size_t i = 0; i < elements.size(); i++) {
+		EXPECT_EQ(referenceQuery.GetOutputOffsets()[i], elements[i].dataOffset) << "metric " << elements[i].metric;
+		EXPECT_EQ(referenceQuery.GetDataSizes()[i], elements[i].dataSize) << "metric " << elements[i].metric;
+	}
+
+	FrameTimingData timing{};
+	std::vector<uint8_t> reference;
+	auto pRefCtx = MakeContext(timing);
+	ConsumeFrames(frames, *pRefCtx, [&](PM_FRAME_QUERY::Context& ctx) {
+		reference.resize(reference.size() + blobSize);
+		referenceQuery.GatherToBlob(ctx, reference.data() + reference.size() - blobSize);
+	});
+	const auto frameCount = reference.size() / blobSize;
+	ASSERT_GT(frameCount, frames.size());
+
+	// one frame at a time
+	std::vector<uint8_t> compiled(reference.size());
+	auto pCtx = MakeContext(timing);
+	size_t gathered = 0;
+	ConsumeFrames(frames, *pCtx, [&](PM_FRAME_QUERY::Context& ctx) {
+		query.GatherToBlob(ctx, compiled.data() + gathered++ * blobSize);
+	});
+	ASSERT_EQ(frameCount, gathered);
+
+	// resolved rows, gathered as a single batch
+	std::vector<uint8_t> batched(reference.size());
+	std::vector<PM_FRAME_QUERY::FrameRow> rows;
+	auto pBatchCtx = MakeContext(timing);
+	ConsumeFrames(frames, *pBatchCtx, [&](PM_FRAME_QUERY::Context& ctx) {
+		query.ResolveRow(ctx, rows.emplace_back());
+	});
+	ASSERT_EQ(frameCount, rows.size());
+	query.GatherRowsToBlobs(*pBatchCtx, rows, batched.data());
+
+	for (size_t i = 0; i < frameCount; i++) {
+		for (auto& q : elements) {
+			const auto offset = i * blobSize + q.dataOffset;
+			ASSERT_EQ(0, std::memcmp(&reference[offset], &compiled[offset], q.dataSize))
+				<< "frame " << i << " metric " << q.metric;
+			ASSERT_EQ(0, std::memcmp(&reference[offset], &batched[offset], q.dataSize))
+				<< "frame " << i << " metric " << q.metric;
+		}
+	}
+}
+
+TEST(FrameEventQuery, ColumnarOutputMatchesBlobs)
+{
+	const auto frames = MakeFrames(2'000);
+	auto blobElements = MakeAllMetricsQuery();
+	PM_FRAME_QUERY blobQuery{ blobElements };
+	const auto blobSize = blobQuery.GetBlobSize();
+
+	// capacity is not a multiple of anything so that the padding between columns is exercised
+	constexpr uint32_t capacity = 3'001;
+	auto columnElements = MakeAllMetricsQuery();
+	PM_FRAME_QUERY columnQuery{ columnElements, capacity };
+	ASSERT_TRUE(columnQuery.IsColumnar());
+	EXPECT_FALSE(blobQuery.IsColumnar());
+	EXPECT_EQ(capacity, columnQuery.GetColumnFrameCapacity());
+	for (size_t i = 0; i < columnElements.size(); i++) {
+		const auto& q = columnElements[i];
+		EXPECT_EQ(blobElements[i].dataSize, q.dataSize);
+		EXPECT_EQ(0u, q.dataOffset % PM_FRAME_QUERY_COLUMN_ALIGNMENT) << "metric " << q.metric;
+		EXPECT_LE(q.dataOffset + q.dataSize * capacity, columnQuery.GetBlobSize()) << "metric " << q.metric;
+		if (i > 0) {
+			EXPECT_GE(q.dataOffset, columnElements[i - 1].dataOffset + columnElements[i - 1].dataSize * capacity);
+		}
+	}
+
+	FrameTimingData timing{};
+	std::vector<PM_FRAME_QUERY::FrameRow> rows;
+	auto pCtx = MakeContext(timing);
+	ConsumeFrames(frames, *pCtx, [&](PM_FRAME_QUERY::Context& ctx) {
+		blobQuery.ResolveRow(ctx, rows.emplace_back());
+	});
+	ASSERT_LE(rows.size(), capacity);
+	std::vector<uint8_t> blobs(rows.size() * blobSize);
+	blobQuery.GatherRowsToBlobs(*pCtx, rows, blobs.data());
+	// in two parts, the way consume gathers batch after batch
+	std::vector<uint8_t> columns(columnQuery.GetBlobSize());
+	const auto split = rows.size() / 3;
+	columnQuery.GatherRowsToBlobs(*pCtx, std::span{ rows }.first(split), columns.data());
+	columnQuery.GatherRowsToBlobs(*pCtx, std::span{ rows }.subspan(split), columns.data(), split);
+
+	for (size_t i = 0; i < rows.size(); i++) {
+		for (size_t e = 0; e < columnElements.size(); e++) {
+			const auto& q = columnElements[e];
+			ASSERT_EQ(0, std::memcmp(&blobs[i * blobSize + blobElements[e].dataOffset],
+				&columns[q.dataOffset + i * q.dataSize], q.dataSize))
+				<< "frame " << i << " metric " << q.metric;
+		}
+	}
+}
+
+TEST(FrameEventQuery, FanSpeedCopiesIndexedElement)
+{
+	auto frames = MakeFrames(16);
+	auto elements = std::vector{ PM_QUERY_ELEMENT{ PM_METRIC_GPU_FAN_SPEED, PM_STAT_NONE, 0, 1 } };
+	PM_FRAME_QUERY query{ elements };
+	FrameTimingData timing{};
+	auto pCtx = MakeContext(timing);
+	std::vector<uint8_t> blob(query.GetBlobSize());
+	ConsumeFrames(frames, *pCtx, [&](PM_FRAME_QUERY::Context& ctx) {
+		query.GatherToBlob(ctx, blob.data());
+		double val;
+		std::memcpy(&val, &blob[elements[0].dataOffset], sizeof(val));
+		EXPECT_EQ(1'100., val);
+	});
+}
+
+TEST(FrameQueryBenchmark, DISABLED_CompiledGather)
+{
+	constexpr int passes = 50;
+	const auto frames = MakeFrames(4'096);
+	struct NamedQuery { const char* name; std::vector<PM_QUERY_ELEMENT> elements; };
+	NamedQuery queries[] = {
+		{ "frame times", MakeFrameTimesQuery() },
+		{ "all metrics", MakeAllMetricsQuery() },
+	};
+	for (auto& [name, elements] : queries) {
+		PM_FRAME_QUERY query{ elements };
+		ReferenceFrameQuery referenceQuery{ elements };
+		const auto blobSize = query.GetBlobSize();
+		std::vector<uint8_t> blobs(frames.size() * 2 * blobSize);
+		std::vector<PM_FRAME_QUERY::FrameRow> rows;
+		rows.reserve(PM_FRAME_QUERY::gatherBatchSize);
+		size_t frameCount = 0;
+
+		const auto referenceSeconds = MeasureSeconds([&] {
+			for (int pass = 0; pass < passes; pass++) {
+				FrameTimingData timing{};
+				auto pCtx = MakeContext(timing);
+				frameCount = 0;
+				ConsumeFrames(frames, *pCtx, [&](PM_FRAME_QUERY::Context& ctx) {
+					referenceQuery.GatherToBlob(ctx, blobs.data() + frameCount++ * blobSize);
+				});
+			}
+		});
+		const auto compiledSeconds = MeasureSeconds([&] {
+			for (int pass = 0; pass < passes; pass++) {
+				FrameTimingData timing{};
+				auto pCtx = MakeContext(timing);
+				frameCount = 0;
+				ConsumeFrames(frames, *pCtx, [&](PM_FRAME_QUERY::Context& ctx) {
+					query.GatherToBlob(ctx, blobs.data() + frameCount++ * blobSize);
+				});
+			}
+		});
+		const auto batchedSeconds = MeasureSeconds([&] {
+			for (int pass = 0; pass < passes; pass++) {
+				FrameTimingData timing{};
+				auto pCtx = MakeContext(timing);
+				// gather every batch as it fills, like ConcreteMiddleware::ConsumeFrameEvents does
+				auto pBlob = blobs.data();
+				const auto gatherRows = [&] {
+					query.GatherRowsToBlobs(*pCtx, rows, pBlob);
+					pBlob += rows.size() * blobSize;
+					rows.clear();
+				};
+				ConsumeFrames(frames, *pCtx, [&](PM_FRAME_QUERY::Context& ctx) {
+					query.ResolveRow(ctx, rows.emplace_back());
+					if (rows.size() >= PM_FRAME_QUERY::gatherBatchSize) {
+						gatherRows();
+					}
+				});
+				gatherRows();
+			}
+		});
+
+		const auto totalFrames = double(frameCount) * passes;
+		std::cout << "Frame query gather (" << name << ", " << elements.size() << " metrics) frames/sec: commands="
+			<< totalFrames / referenceSeconds << " compiled=" << totalFrames / compiledSeconds
+			<< " compiled batch=" << totalFrames / batchedSeconds << std::endl;
+	}
+}
+
+TEST(FrameQueryBenchmark, DISABLED_ColumnarReduction)
+{
+	// gather a batch of frame times and average each metric, as a plotting or statistics consumer would
+	constexpr int passes = 200;
+	const auto frames = MakeFrames(4'096);
+	FrameTimingData timing{};
+	std::vector<PM_FRAME_QUERY::FrameRow> rows;
+	auto pCtx = MakeContext(timing);
+	auto blobElements = MakeFrameTimesQuery();
+	PM_FRAME_QUERY blobQuery{ blobElements };
+	ConsumeFrames(frames, *pCtx, [&](PM_FRAME_QUERY::Context& ctx) {
+		blobQuery.ResolveRow(ctx, rows.emplace_back());
+	});
+	auto columnElements = MakeFrameTimesQuery();
+	PM_FRAME_QUERY columnQuery{ columnElements, uint32_t(rows.size()) };
+	const auto blobSize = blobQuery.GetBlobSize();
+	std::vector<uint8_t> blobs(rows.size() * blobSize);
+	std::vector<uint8_t> columns(columnQuery.GetBlobSize());
+
+	// the first element is the cpu start qpc, the rest are times in ms
+	std::vector<double> blobSums(blobElements.size());
+	std::vector<double> columnSums(columnElements.size());
+	const auto blobSeconds = MeasureSeconds([&] {
+		for (int pass = 0; pass < passes; pass++) {
+			blobQuery.GatherRowsToBlobs(*pCtx, rows, blobs.data());
+			// transpose each metric out of the blobs, then reduce it
+			std::vector<double> values(rows.size());
+			for (size_t e = 1; e < blobElements.size(); e++) {
+				for (size_t i = 0; i < rows.size(); i++) {
+					std::memcpy(&values[i], &blobs[i * blobSize + blobElements[e].dataOffset], sizeof(double));
+				}
+				double sum = 0.;
+				for (auto v : values) {
+					sum += v == v ? v : 0.;
+				}
+				blobSums[e] = sum;
+			}
+		}
+	});
+	const auto columnSeconds = MeasureSeconds([&] {
+		for (int pass = 0; pass < passes; pass++) {
+			columnQuery.GatherRowsToBlobs(*pCtx, rows, columns.data());
+			for (size_t e = 1; e < columnElements.size(); e++) {
+				const auto pValues = reinterpret_cast<const double*>(columns.data() + columnElements[e].dataOffset);
+				double sum = 0.;
+				for (size_t i = 0; i < rows.size(); i++) {
+					sum += pValues[i] == pValues[i] ? pValues[i] : 0.;
+				}
+				columnSums[e] = sum;
+			}
+		}
+	});
+
+	EXPECT_EQ(blobSums, columnSums);
+	const auto totalFrames = double(rows.size()) * passes;
+	std::cout << "Frame query gather and reduce (" << columnElements.size() << " metrics) frames/sec: blobs="
+		<< totalFrames / blobSeconds << " columns=" << totalFrames / columnSeconds << std::endl;
+}
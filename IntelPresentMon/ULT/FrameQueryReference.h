@@ -0,0 +1,35 @@
+#pragma once
+#include "../PresentMonMiddleware/FrameEventQuery.h"
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace pmon::mid
+{
+	class GatherCommand_;
+}
+
+// Gathers a frame query by running a virtual gather command per query element, the way frame
+// queries did before they were compiled into op tables.  It is much slower, and is kept here as the
+// reference that the compiled ops are tested and benchmarked against (blob layout only).
+class ReferenceFrameQuery
+{
+public:
+	ReferenceFrameQuery(std::span<const PM_QUERY_ELEMENT> queryElements);
+	~ReferenceFrameQuery();
+	void GatherToBlob(PM_FRAME_QUERY::Context& ctx, uint8_t* pDestBlob) const;
+	// where each element's value is written in the blob and how large it is, in query order
+	const std::vector<uint32_t>& GetOutputOffsets() const;
+	const std::vector<uint32_t>& GetDataSizes() const;
+	size_t GetBlobSize() const;
+
+	ReferenceFrameQuery(const ReferenceFrameQuery&) = delete;
+	ReferenceFrameQuery& operator=(const ReferenceFrameQuery&) = delete;
+
+private:
+	std::vector<std::unique_ptr<pmon::mid::GatherCommand_>> gatherCommands_;
+	std::vector<uint32_t> outputOffsets_;
+	std::vector<uint32_t> dataSizes_;
+	size_t blobSize_ = 0;
+};
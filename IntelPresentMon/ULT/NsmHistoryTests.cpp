@@ -0,0 +1,215 @@
+#include "gtest/gtest.h"
+#include "../Streamer/NsmHistory.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// A history in process memory, laid out the way NamedSharedMem lays out its mapping
+	struct InProcessHistory
+	{
+		explicit InProcessHistory(uint64_t block_count)
+			:
+			storage(size_t(NsmHistoryWriter::GetRequiredSize(block_count) / sizeof(uint64_t)), 0),
+			writer{ storage.data(), block_count }
+		{
+			EXPECT_TRUE(reader.Open(storage.data()));
+		}
+		std::vector<uint64_t> storage;
+		NsmHistoryWriter writer;
+		NsmHistoryReader reader;
+	};
+
+	// Roughly what a game presenting at ~144 fps looks like: timestamps move on by a jittery
+	// frame time, telemetry is sampled every few frames and the rest stays the same
+	PmNsmFrameData MakeFrame(uint64_t frame_num)
+	{
+		PmNsmFrameData frame;
+		std::memset(&frame, 0, sizeof(frame));
+		const uint64_t start = 1'000'000'000 + frame_num * 69'444 + (frame_num * 7919) % 2000;
+		auto& present = frame.present_event;
+		present.PresentStartTime = start;
+		present.ReadyTime = start + 40'000;
+		present.GPUStartTime = start + 5'000;
+		present.GPUDuration = 30'000 + (frame_num * 131) % 900;
+		present.TimeInPresent = 200 + frame_num % 50;
+		present.SwapChainAddress = 0x1F2E3D4C5B60;
+		present.ProcessId = 1234;
+		present.ThreadId = 5678;
+		present.FrameId = uint32_t(frame_num);
+		present.FinalState = PresentResult::Presented;
+		std::strcpy(present.application, "game.exe");
+		const uint64_t sample = frame_num / 4;
+		frame.power_telemetry.qpc = 1'000'000'000 + sample * 250'000;
+		frame.power_telemetry.gpu_power_w = 150.0 + double(sample % 17);
+		frame.power_telemetry.gpu_temperature_c = 70.0 + double(sample % 3);
+		frame.power_telemetry.gpu_utilization = 97.0 + double(sample % 5) * 0.5;
+		frame.cpu_telemetry.qpc = frame.power_telemetry.qpc;
+		frame.cpu_telemetry.cpu_utilization = 40.0 + double(sample % 11);
+		frame.cpu_telemetry.cpu_frequency = 4800.0;
+		return frame;
+	}
+
+	bool IsFrame(const PmNsmFrameData& frame, uint64_t frame_num)
+	{
+		const auto expected = MakeFrame(frame_num);
+		return std::memcmp(&frame, &expected, sizeof(frame)) == 0;
+	}
+}
+
+TEST(NsmHistoryTests, EncodedFramesDecodeExactly)
+{
+	PmNsmFrameData zero;
+	std::memset(&zero, 0, sizeof(zero));
+	std::vector<uint8_t> encoded(GetMaxEncodedNsmFrameSize());
+
+	// against nothing in common and against the previous frame, values going up and down
+	const auto first = MakeFrame(10);
+	const auto second = MakeFrame(11);
+	auto earlier = MakeFrame(11);
+	earlier.present_event.PresentStartTime -= 1'000'000;
+	earlier.power_telemetry.gpu_power_w = -1.0;
+	const std::pair<const PmNsmFrameData*, const PmNsmFrameData*> cases[] = {
+		{ &zero, &first }, { &first, &second }, { &second, &earlier }, { &first, &first },
+	};
+	for (auto [prev, frame] : cases) {
+		const auto size = EncodeNsmFrame(*prev, *frame, encoded.data());
+		ASSERT_GT(size, 0u);
+		ASSERT_LE(size, encoded.size());
+		PmNsmFrameData decoded;
+		EXPECT_EQ(DecodeNsmFrame(*prev, encoded.data(), size, decoded), size);
+		EXPECT_EQ(std::memcmp(&decoded, frame, sizeof(decoded)), 0);
+		// cut short, it is not a frame
+		if (size > 1) {
+			EXPECT_EQ(DecodeNsmFrame(*prev, encoded.data(), size - 1, decoded), 0u);
+		}
+	}
+
+	// worst case: every byte changes
+	PmNsmFrameData ones;
+	std::memset(&ones, 0xFF, sizeof(ones));
+	EXPECT_LE(EncodeNsmFrame(zero, ones, encoded.data()), GetMaxEncodedNsmFrameSize());
+}
+
+TEST(NsmHistoryTests, ReaderFindsFramesUntilTheirBlockIsReused)
+{
+	constexpr uint64_t kBlocks = 4;
+	InProcessHistory history{ kBlocks };
+	uint64_t first_frame = 0;
+
+	EXPECT_FALSE(history.reader.DecodeBlock(0, first_frame));
+
+	// frames are available as soon as they are folded, before their block is complete
+	history.writer.FoldFrame(100, MakeFrame(100));
+	auto frames = history.reader.DecodeBlock(100, first_frame);
+	ASSERT_TRUE(frames);
+	EXPECT_EQ(first_frame, 100u);
+	ASSERT_EQ(frames->size(), 1u);
+	EXPECT_TRUE(IsFrame((*frames)[0], 100));
+	EXPECT_FALSE(history.reader.DecodeBlock(99, first_frame));
+	EXPECT_FALSE(history.reader.DecodeBlock(101, first_frame));
+
+	// fill more blocks than the history holds
+	uint64_t next = 101;
+	while (next < 100'000) {
+		history.writer.FoldFrame(next, MakeFrame(next));
+		next++;
+	}
+	frames = history.reader.DecodeBlock(next - 1, first_frame);
+	ASSERT_TRUE(frames);
+	ASSERT_FALSE(frames->empty());
+	EXPECT_EQ(first_frame + frames->size(), next);
+	for (size_t i = 0; i < frames->size(); i++) {
+		EXPECT_TRUE(IsFrame((*frames)[i], first_frame + i)) << "frame " << first_frame + i;
+	}
+	EXPECT_FALSE(history.reader.DecodeBlock(100, first_frame));
+
+	// walk back through everything still held: frames are contiguous and intact
+	uint64_t oldest = next;
+	while (oldest > 0 && (frames = history.reader.DecodeBlock(oldest - 1, first_frame))) {
+		EXPECT_EQ(first_frame + frames->size(), oldest);
+		for (size_t i = 0; i < frames->size(); i++) {
+			EXPECT_TRUE(IsFrame((*frames)[i], first_frame + i)) << "frame " << first_frame + i;
+		}
+		oldest = first_frame;
+	}
+	EXPECT_GT(oldest, 100u);
+	EXPECT_GT(next - oldest, (kBlocks - 1) * kNsmHistoryBlockSize / sizeof(PmNsmFrameData));
+
+	// a gap in the frame numbers starts a new block
+	history.writer.FoldFrame(next + 10, MakeFrame(next + 10));
+	frames = history.reader.DecodeBlock(next + 10, first_frame);
+	ASSERT_TRUE(frames);
+	EXPECT_EQ(first_frame, next + 10);
+	EXPECT_EQ(frames->size(), 1u);
+	EXPECT_FALSE(history.reader.DecodeBlock(next + 5, first_frame));
+}
+
+TEST(NsmHistoryTests, ReaderDecodesOnlyFramesAddedToTheBlockDecodedLast)
+{
+	InProcessHistory history{ 2 };
+	uint64_t first_frame = 0;
+	for (uint64_t frame_num = 0; frame_num < 10; frame_num++) {
+		history.writer.FoldFrame(frame_num, MakeFrame(frame_num));
+	}
+	auto held = history.reader.DecodeBlock(0, first_frame);
+	ASSERT_TRUE(held);
+	ASSERT_EQ(held->size(), 10u);
+	EXPECT_EQ(history.reader.GetFramesDecoded(), 10u);
+
+	// decoding the block again decodes only the frames added to it since
+	for (uint64_t frame_num = 10; frame_num < 20; frame_num++) {
+		history.writer.FoldFrame(frame_num, MakeFrame(frame_num));
+	}
+	const auto frames = history.reader.DecodeBlock(15, first_frame);
+	ASSERT_TRUE(frames);
+	EXPECT_EQ(history.reader.GetFramesDecoded(), 20u);
+	EXPECT_EQ(first_frame, 0u);
+	ASSERT_EQ(frames->size(), 20u);
+	for (size_t i = 0; i < frames->size(); i++) {
+		EXPECT_TRUE(IsFrame((*frames)[i], i)) << "frame " << i;
+	}
+	// the frames handed out before stay as they were
+	EXPECT_EQ(held->size(), 10u);
+	EXPECT_TRUE(IsFrame((*held)[9], 9));
+	// and nothing is decoded when nothing was added
+	EXPECT_TRUE(history.reader.DecodeBlock(3, first_frame));
+	EXPECT_EQ(history.reader.GetFramesDecoded(), 20u);
+
+	// once the slot is reused (gaps start new blocks), the block is gone for good
+	history.writer.FoldFrame(100, MakeFrame(100));
+	history.writer.FoldFrame(200, MakeFrame(200));
+	EXPECT_FALSE(history.reader.DecodeBlock(15, first_frame));
+	EXPECT_TRUE(history.reader.DecodeBlock(200, first_frame));
+}
+
+TEST(NsmHistoryTests, HistoryIsFiveTimesSmallerThanTheRing)
+{
+	constexpr uint64_t kBlocks = 16;
+	InProcessHistory history{ kBlocks };
+	uint64_t frame_num = 0;
+	uint64_t first_frame = 0;
+	for (; frame_num < 1'000'000; frame_num++) {
+		history.writer.FoldFrame(frame_num, MakeFrame(frame_num));
+	}
+
+	uint64_t oldest = frame_num;
+	while (oldest > 0 && history.reader.DecodeBlock(oldest - 1, first_frame)) {
+		oldest = first_frame;
+	}
+	// the frames held take at least 5x the memory of the history in the ring
+	const auto held = frame_num - oldest;
+	const auto ring_bytes = held * (sizeof(PmNsmFrameData) + sizeof(uint64_t));
+	EXPECT_GE(ring_bytes, 5 * NsmHistoryWriter::GetRequiredSize(kBlocks)) << held << " frames held";
+}
+
+TEST(NsmHistoryTests, ReaderRejectsForeignMemory)
+{
+	std::vector<uint64_t> storage(1024, 0);
+	NsmHistoryReader reader;
+	EXPECT_FALSE(reader.Open(storage.data()));
+	EXPECT_FALSE(reader.IsOpen());
+	uint64_t first_frame = 0;
+	EXPECT_FALSE(reader.DecodeBlock(0, first_frame));
+}
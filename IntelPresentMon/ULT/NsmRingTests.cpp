@@ -0,0 +1,615 @@
+#include "gtest/gtest.h"
+#include "../Streamer/NsmRing.h"
+
+#include <windows.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// A ring in process memory, laid out the way NamedSharedMem lays out its mapping
+	struct InProcessRing
+	{
+		explicit InProcessRing(uint64_t max_entries)
+			:
+			buf_size(NsmRingWriter::GetRequiredSize(max_entries)),
+			storage(size_t(buf_size / sizeof(uint64_t)) + 1)
+		{
+			header = new (storage.data()) NamedSharedMemoryHeader{};
+			header->buf_size = buf_size;
+			NsmRingWriter::InitializeLayout(header, buf_size);
+		}
+		NsmRingWriter MakeWriter() { return { header, storage.data() }; }
+		NsmRingReader MakeReader() { return { header, storage.data() }; }
+		uint64_t buf_size;
+		std::vector<uint64_t> storage;
+		NamedSharedMemoryHeader* header;
+	};
+
+	// Every byte of the frame depends on the frame number, so a frame that was read while being
+	// overwritten does not match
+	PmNsmFrameData MakeStressFrame(uint64_t frame_num)
+	{
+		PmNsmFrameData frame;
+		std::memset(&frame, int(frame_num * 31 + 7) & 0xFF, sizeof(frame));
+		frame.present_event.PresentStartTime = frame_num;
+		frame.power_telemetry.qpc = frame_num;
+		frame.cpu_telemetry.qpc = frame_num;
+		return frame;
+	}
+
+	bool IsStressFrame(const PmNsmFrameData& frame, uint64_t frame_num)
+	{
+		const auto expected = MakeStressFrame(frame_num);
+		return std::memcmp(&frame, &expected, sizeof(frame)) == 0;
+	}
+
+	uint64_t NowNs()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	double GetThreadCpuMs()
+	{
+		FILETIME creation, exit, kernel, user;
+		GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+		const auto ticks = (uint64_t(kernel.dwHighDateTime) << 32 | kernel.dwLowDateTime) +
+			(uint64_t(user.dwHighDateTime) << 32 | user.dwLowDateTime);
+		return double(ticks) / 10'000.0;
+	}
+
+	// Walk back from the newest frame, or from where the index says, to the newest frame presented
+	// at or before qpc, the way GetFrameDataStart does; returns the frame and counts the frames read
+	uint64_t FindFrameAt(const NsmRingReader& reader, uint64_t qpc, bool seek, uint64_t& frames_read)
+	{
+		const auto num_frames_written = reader.GetNumFramesWritten();
+		const auto oldest = reader.GetOldestFrame(num_frames_written);
+		auto frame_num = seek ? reader.SeekFrame(qpc, num_frames_written) : num_frames_written - 1;
+		for (;;) {
+			frames_read++;
+			if (reader.GetFrame(frame_num)->present_event.PresentStartTime <= qpc || frame_num == oldest) {
+				return frame_num;
+			}
+			frame_num--;
+		}
+	}
+}
+
+TEST(NsmRingTests, FrameStatesFollowWriter)
+{
+	constexpr uint64_t kEntries = 8;
+	InProcessRing ring{ kEntries };
+	ASSERT_EQ(ring.header->max_entries, kEntries);
+	ASSERT_EQ(ring.header->slot_seq_offset % sizeof(uint64_t), 0u);
+	ASSERT_LE(ring.header->slot_seq_offset + kEntries * sizeof(uint64_t), ring.buf_size);
+	auto writer = ring.MakeWriter();
+	auto reader = ring.MakeReader();
+
+	EXPECT_EQ(reader.GetFrameState(0), NsmFrameState::kPending);
+	uint64_t evicted_num = 0;
+	for (uint64_t i = 0; i < 20; i++) {
+		// once the ring has wrapped, each write evicts the oldest frame
+		const auto evicted = writer.GetFrameToOverwrite(evicted_num);
+		if (i < kEntries) {
+			EXPECT_EQ(evicted, nullptr);
+		}
+		else {
+			ASSERT_NE(evicted, nullptr);
+			EXPECT_EQ(evicted_num, i - kEntries);
+			EXPECT_TRUE(IsStressFrame(*evicted, evicted_num));
+		}
+		writer.WriteFrameData(MakeStressFrame(i));
+	}
+	EXPECT_EQ(reader.GetNumFramesWritten(), 20u);
+	EXPECT_EQ(reader.GetOldestFrame(20), 13u);
+	EXPECT_EQ(reader.GetFrameState(11), NsmFrameState::kOverwritten);
+	EXPECT_EQ(reader.GetFrameState(12), NsmFrameState::kReady);
+	EXPECT_EQ(reader.GetFrameState(19), NsmFrameState::kReady);
+	EXPECT_EQ(reader.GetFrameState(20), NsmFrameState::kPending);
+	EXPECT_TRUE(IsStressFrame(*reader.GetFrame(19), 19));
+
+	// the head and tail indices move the same way as they always did
+	EXPECT_EQ(ring.header->tail_idx, 20 % kEntries);
+	EXPECT_EQ(ring.header->head_idx, (20 - (kEntries - 1)) % kEntries);
+
+	PmNsmFrameData frame;
+	EXPECT_EQ(reader.CopyFrame(15, frame), NsmFrameState::kReady);
+	EXPECT_TRUE(IsStressFrame(frame, 15));
+	EXPECT_EQ(reader.CopyFrame(3, frame), NsmFrameState::kOverwritten);
+
+	// a frame used in place is no longer intact once the writer has come around to its slot
+	ASSERT_EQ(reader.GetFrameState(19), NsmFrameState::kReady);
+	for (uint64_t i = 20; i < 20 + kEntries; i++) {
+		EXPECT_TRUE(reader.IsFrameIntact(19));
+		writer.WriteFrameData(MakeStressFrame(i));
+	}
+	EXPECT_FALSE(reader.IsFrameIntact(19));
+}
+
+TEST(NsmRingTests, SlowestRegisteredReaderHoldsBackWriter)
+{
+	constexpr uint64_t kEntries = 8;
+	InProcessRing ring{ kEntries };
+	auto writer = ring.MakeWriter();
+	auto reader = ring.MakeReader();
+
+	const auto fast = reader.RegisterReader(1, 0);
+	const auto slow = reader.RegisterReader(2, 0);
+	ASSERT_GE(fast, 0);
+	ASSERT_GE(slow, 0);
+	ASSERT_NE(fast, slow);
+
+	uint64_t written = 0;
+	while (!IsNsmRingFull(*ring.header)) {
+		writer.WriteFrameData(MakeStressFrame(written++));
+	}
+	EXPECT_EQ(written, kEntries - 1);
+
+	// the fast reader catching up doesn't help, the slow one does
+	reader.SetReaderPosition(fast, written);
+	EXPECT_TRUE(IsNsmRingFull(*ring.header));
+	reader.SetReaderPosition(slow, 3);
+	EXPECT_FALSE(IsNsmRingFull(*ring.header));
+	writer.WriteFrameData(MakeStressFrame(written++));
+	EXPECT_EQ(ring.header->head_idx, 3u);
+
+	// once the slow reader leaves, only the fast one counts
+	reader.UnregisterReader(slow);
+	uint64_t slowest = 0;
+	ASSERT_TRUE(GetSlowestNsmRingReader(*ring.header, slowest));
+	EXPECT_EQ(slowest, written - 1);
+	reader.UnregisterReader(fast);
+	EXPECT_FALSE(GetSlowestNsmRingReader(*ring.header, slowest));
+
+	// every slot can be taken, and no more
+	for (int i = 0; i < (int)kMaxNsmRingReaders; i++) {
+		EXPECT_GE(reader.RegisterReader(100 + i, 0), 0);
+	}
+	EXPECT_EQ(reader.RegisterReader(200, 0), -1);
+}
+
+TEST(NsmRingTests, DeadReadersAreReclaimed)
+{
+	constexpr uint64_t kEntries = 8;
+	InProcessRing ring{ kEntries };
+	auto writer = ring.MakeWriter();
+	auto reader = ring.MakeReader();
+
+	// owners with odd ids die without unregistering
+	const auto isAlive = [](uint64_t owner) { return owner % 2 == 0; };
+	std::vector<int> slots;
+	for (uint64_t owner = 1; owner <= kMaxNsmRingReaders; owner++) {
+		slots.push_back(reader.RegisterReader(owner, 0));
+		ASSERT_GE(slots.back(), 0);
+	}
+	EXPECT_EQ(reader.RegisterReader(100, 0), -1);
+
+	uint64_t written = 0;
+	while (!IsNsmRingFull(*ring.header)) {
+		writer.WriteFrameData(MakeStressFrame(written++));
+	}
+	// the live readers catching up doesn't help until the dead ones are gone
+	for (uint64_t owner = 2; owner <= kMaxNsmRingReaders; owner += 2) {
+		reader.SetReaderPosition(slots[owner - 1], written);
+	}
+	EXPECT_TRUE(IsNsmRingFull(*ring.header));
+	EXPECT_EQ(ReclaimDeadNsmRingReaders(*ring.header, isAlive), kMaxNsmRingReaders / 2);
+	EXPECT_FALSE(IsNsmRingFull(*ring.header));
+	EXPECT_EQ(ReclaimDeadNsmRingReaders(*ring.header, isAlive), 0u);
+
+	// the slots of the dead readers can be taken again
+	for (uint64_t owner = 1; owner <= kMaxNsmRingReaders; owner += 2) {
+		EXPECT_GE(reader.RegisterReader(100 + owner * 2, written), 0);
+	}
+	EXPECT_EQ(reader.RegisterReader(200, 0), -1);
+	EXPECT_FALSE(IsNsmRingFull(*ring.header));
+}
+
+TEST(NsmRingTests, StressBackpressuredReadersSeeEveryFrame)
+{
+	constexpr uint64_t kEntries = 64;
+	constexpr uint64_t kFrames = 20'000;
+	constexpr int kReaders = 4;
+	InProcessRing ring{ kEntries };
+	auto writer = ring.MakeWriter();
+
+	// register everyone before the writer starts so that no frame is written past a reader
+	std::vector<int> slots;
+	for (int i = 0; i < kReaders; i++) {
+		slots.push_back(ring.MakeReader().RegisterReader(i + 1, 0));
+		ASSERT_GE(slots.back(), 0);
+	}
+
+	std::atomic<bool> failed = false;
+	std::vector<std::thread> readers;
+	std::vector<uint64_t> frames_read(kReaders, 0);
+	for (int i = 0; i < kReaders; i++) {
+		readers.emplace_back([&, i] {
+			auto reader = ring.MakeReader();
+			PmNsmFrameData frame;
+			for (uint64_t next = 0; next < kFrames && !failed;) {
+				if (next >= reader.GetNumFramesWritten()) {
+					std::this_thread::yield();
+					continue;
+				}
+				if (reader.CopyFrame(next, frame) != NsmFrameState::kReady || !IsStressFrame(frame, next)) {
+					failed = true;
+					break;
+				}
+				reader.SetReaderPosition(slots[i], ++next);
+				frames_read[i]++;
+				// readers go at different paces
+				if (next % (i + 1) == 0) {
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+
+	for (uint64_t i = 0; i < kFrames && !failed; i++) {
+		while (IsNsmRingFull(*ring.header) && !failed) {
+			std::this_thread::yield();
+		}
+		writer.WriteFrameData(MakeStressFrame(i));
+	}
+	for (auto& reader : readers) {
+		reader.join();
+	}
+
+	EXPECT_FALSE(failed);
+	for (auto count : frames_read) {
+		EXPECT_EQ(count, kFrames);
+	}
+}
+
+TEST(NsmRingTests, StressLiveReadersDetectOverruns)
+{
+	constexpr uint64_t kEntries = 32;
+	constexpr uint64_t kFrames = 100'000;
+	constexpr int kReaders = 4;
+	InProcessRing ring{ kEntries };
+	auto writer = ring.MakeWriter();
+
+	std::vector<std::thread> readers;
+	std::vector<uint64_t> frames_read(kReaders, 0);
+	std::vector<uint64_t> frames_lost(kReaders, 0);
+	std::vector<uint64_t> bad_frames(kReaders, 0);
+	for (int i = 0; i < kReaders; i++) {
+		readers.emplace_back([&, i] {
+			auto reader = ring.MakeReader();
+			PmNsmFrameData frame;
+			uint64_t next = 0;
+			while (next < kFrames) {
+				const auto written = reader.GetNumFramesWritten();
+				if (next >= written) {
+					std::this_thread::yield();
+					continue;
+				}
+				const auto oldest = reader.GetOldestFrame(written);
+				if (next < oldest) {
+					frames_lost[i] += oldest - next;
+					next = oldest;
+				}
+				switch (reader.CopyFrame(next, frame)) {
+				case NsmFrameState::kReady:
+					if (!IsStressFrame(frame, next)) {
+						bad_frames[i]++;
+					}
+					frames_read[i]++;
+					next++;
+					break;
+				case NsmFrameState::kOverwritten:
+					// lost while reading it; catch up on the next pass
+					frames_lost[i]++;
+					next++;
+					break;
+				case NsmFrameState::kPending:
+					// frames below num_frames_written are always complete
+					bad_frames[i]++;
+					next++;
+					break;
+				}
+				// the higher readers are slower, so they fall behind and lose frames
+				for (int spin = 0; spin < i * 200; spin++) {
+					std::atomic_signal_fence(std::memory_order_seq_cst);
+				}
+			}
+		});
+	}
+
+	for (uint64_t i = 0; i < kFrames; i++) {
+		writer.WriteFrameData(MakeStressFrame(i));
+		// let the readers in now and then, so that they run alongside the writer even on few cores
+		if (i % 64 == 0) {
+			std::this_thread::yield();
+		}
+	}
+	for (auto& reader : readers) {
+		reader.join();
+	}
+
+	for (int i = 0; i < kReaders; i++) {
+		EXPECT_EQ(bad_frames[i], 0u) << "reader " << i;
+		// every frame is accounted for exactly once
+		EXPECT_EQ(frames_read[i] + frames_lost[i], kFrames) << "reader " << i;
+		EXPECT_GT(frames_read[i], 0u) << "reader " << i;
+	}
+}
+
+TEST(NsmRingTests, WaitersAreWokenOncePerArming)
+{
+	InProcessRing ring{ 8 };
+	auto writer = ring.MakeWriter();
+	auto reader = ring.MakeReader();
+
+	const auto waiter = reader.RegisterWaiter(1);
+	const auto other = reader.RegisterWaiter(2);
+	ASSERT_GE(waiter, 0);
+	ASSERT_GE(other, 0);
+	ASSERT_NE(waiter, other);
+
+	// waiting for 3 frames: nothing to wake until the third, and only once however many follow
+	ASSERT_TRUE(reader.ArmWaiter(waiter, 3));
+	writer.WriteFrameData(MakeStressFrame(0));
+	writer.WriteFrameData(MakeStressFrame(1));
+	EXPECT_EQ(writer.TakeWaitersToWake(), 0u);
+	writer.WriteFrameData(MakeStressFrame(2));
+	writer.WriteFrameData(MakeStressFrame(3));
+	EXPECT_EQ(writer.TakeWaitersToWake(), 1u << waiter);
+	writer.WriteFrameData(MakeStressFrame(4));
+	EXPECT_EQ(writer.TakeWaitersToWake(), 0u);
+
+	// arming for frames already written doesn't wait, and leaves nothing to wake
+	EXPECT_FALSE(reader.ArmWaiter(waiter, 5));
+	EXPECT_EQ(writer.TakeWaitersToWake(), 0u);
+
+	// both waiters reached by the same frame are woken together; a disarmed one is not
+	ASSERT_TRUE(reader.ArmWaiter(waiter, 6));
+	ASSERT_TRUE(reader.ArmWaiter(other, 6));
+	writer.WriteFrameData(MakeStressFrame(5));
+	EXPECT_EQ(writer.TakeWaitersToWake(), (1u << waiter) | (1u << other));
+	ASSERT_TRUE(reader.ArmWaiter(waiter, 7));
+	reader.DisarmWaiter(waiter);
+	writer.WriteFrameData(MakeStressFrame(6));
+	EXPECT_EQ(writer.TakeWaitersToWake(), 0u);
+
+	// every slot can be taken, and no more; unregistering frees a slot
+	reader.UnregisterWaiter(other);
+	for (int i = 0; i < (int)kMaxNsmFrameWaiters - 1; i++) {
+		EXPECT_GE(reader.RegisterWaiter(100 + i), 0);
+	}
+	EXPECT_EQ(reader.RegisterWaiter(200), -1);
+	reader.UnregisterWaiter(waiter);
+	EXPECT_EQ(reader.RegisterWaiter(200), waiter);
+}
+
+TEST(NsmRingTests, DeadWaitersAreReclaimed)
+{
+	InProcessRing ring{ 8 };
+	auto writer = ring.MakeWriter();
+	auto reader = ring.MakeReader();
+
+	// owners with odd ids die without unregistering, one of them while armed
+	const auto isAlive = [](uint64_t owner) { return owner % 2 == 0; };
+	std::vector<int> slots;
+	for (uint64_t owner = 1; owner <= kMaxNsmFrameWaiters; owner++) {
+		slots.push_back(reader.RegisterWaiter(owner));
+		ASSERT_GE(slots.back(), 0);
+	}
+	EXPECT_EQ(reader.RegisterWaiter(100), -1);
+	ASSERT_TRUE(reader.ArmWaiter(slots[0], 1));
+	ASSERT_TRUE(reader.ArmWaiter(slots[1], 1));
+
+	EXPECT_EQ(ReclaimDeadNsmFrameWaiters(*ring.header, isAlive), kMaxNsmFrameWaiters / 2);
+	EXPECT_EQ(ReclaimDeadNsmFrameWaiters(*ring.header, isAlive), 0u);
+
+	// only the live waiter is woken
+	writer.WriteFrameData(MakeStressFrame(0));
+	EXPECT_EQ(writer.TakeWaitersToWake(), 1u << slots[1]);
+
+	// the slots of the dead waiters can be taken again
+	for (uint64_t owner = 1; owner <= kMaxNsmFrameWaiters; owner += 2) {
+		EXPECT_GE(reader.RegisterWaiter(100 + owner * 2), 0);
+	}
+	EXPECT_EQ(reader.RegisterWaiter(200), -1);
+}
+
+TEST(NsmRingTests, SeekFindsFramesByTimeAcrossWraparound)
+{
+	constexpr uint64_t kEntries = 300;
+	InProcessRing ring{ kEntries };
+	ASSERT_EQ(ring.header->max_entries, kEntries);
+	ASSERT_GT(ring.header->qpc_index_entries, kEntries / kNsmQpcIndexStride);
+	ASSERT_LE(ring.header->qpc_index_offset + ring.header->qpc_index_entries * sizeof(NsmQpcIndexEntry), ring.buf_size);
+	auto writer = ring.MakeWriter();
+	auto reader = ring.MakeReader();
+	auto QpcOf = [](uint64_t frame_num) { return 1000 + frame_num * 10; };
+
+	EXPECT_EQ(reader.SeekFrame(5000, 0), 0u);
+	for (uint64_t i = 0; i < 2000; i++) {
+		auto frame = MakeStressFrame(i);
+		frame.present_event.PresentStartTime = QpcOf(i);
+		writer.WriteFrameData(frame);
+		if (i % 97 != 0) {
+			continue;
+		}
+		// every frame still in the ring is found, with or between its timestamps, from at most a
+		// stride above it
+		const auto oldest = reader.GetOldestFrame(i + 1);
+		for (uint64_t frame_num = oldest; frame_num <= i; frame_num++) {
+			for (uint64_t qpc : { QpcOf(frame_num), QpcOf(frame_num) + 5 }) {
+				const auto start = reader.SeekFrame(qpc, i + 1);
+				ASSERT_GE(start, frame_num) << "frame " << frame_num << " of " << i + 1;
+				ASSERT_LE(start, i);
+				ASSERT_LE(start - frame_num, kNsmQpcIndexStride);
+				uint64_t frames_read = 0;
+				EXPECT_EQ(FindFrameAt(reader, qpc, true, frames_read), frame_num);
+			}
+		}
+		// after the newest frame, and before the oldest
+		EXPECT_EQ(reader.SeekFrame(QpcOf(i + 10), i + 1), i);
+		EXPECT_LE(reader.SeekFrame(QpcOf(oldest) - 1, i + 1), oldest + kNsmQpcIndexStride);
+		uint64_t frames_read = 0;
+		EXPECT_EQ(FindFrameAt(reader, QpcOf(oldest) - 1, true, frames_read), oldest);
+	}
+
+	// a ring laid out without an index is walked from the newest frame
+	ring.header->qpc_index_entries = 0;
+	EXPECT_EQ(ring.MakeReader().SeekFrame(QpcOf(1800), 2000), 1999u);
+}
+
+TEST(NsmRingTests, BatchesLeaveTheRingAsSingleWritesDo)
+{
+	constexpr uint64_t kEntries = 16;
+	InProcessRing single_ring{ kEntries };
+	InProcessRing batch_ring{ kEntries };
+	auto single_writer = single_ring.MakeWriter();
+	auto batch_writer = batch_ring.MakeWriter();
+	auto reader = batch_ring.MakeReader();
+
+	std::vector<PmNsmFrameData> batch;
+	uint64_t frame_num = 0;
+	for (uint64_t batch_size = 1; frame_num < kEntries * 20; batch_size = batch_size % (kEntries - 1) + 1) {
+		batch.clear();
+		for (uint64_t i = 0; i < batch_size; i++, frame_num++) {
+			batch.push_back(MakeStressFrame(frame_num));
+			single_writer.WriteFrameData(batch.back());
+		}
+		batch_writer.WriteFrames(batch);
+		// frames, sequence numbers, qpc index and header all end up the same
+		ASSERT_EQ(0, std::memcmp(single_ring.storage.data(), batch_ring.storage.data(), size_t(single_ring.buf_size)))
+			<< "after frame " << frame_num;
+		EXPECT_EQ(frame_num, reader.GetNumFramesWritten());
+		for (uint64_t f = reader.GetOldestFrame(frame_num); f < frame_num; f++) {
+			PmNsmFrameData frame;
+			ASSERT_EQ(NsmFrameState::kReady, reader.CopyFrame(f, frame));
+			EXPECT_TRUE(IsStressFrame(frame, f));
+		}
+	}
+}
+
+TEST(NsmRingBenchmark, DISABLED_SeekVersusWalk)
+{
+	// a ring holding a minute at 144 fps, queried for windows starting up to 30 seconds back
+	constexpr uint64_t kEntries = 8192;
+	constexpr uint64_t kFrameQpc = 69'444;
+	constexpr uint64_t kQueries = 2000;
+	InProcessRing ring{ kEntries };
+	auto writer = ring.MakeWriter();
+	auto reader = ring.MakeReader();
+	for (uint64_t i = 0; i < kEntries * 3; i++) {
+		auto frame = MakeStressFrame(i);
+		frame.present_event.PresentStartTime = 1'000'000 + i * kFrameQpc + (i * 7919) % 2000;
+		writer.WriteFrameData(frame);
+	}
+	const auto newest_qpc = reader.GetFrame(kEntries * 3 - 1)->present_event.PresentStartTime;
+
+	for (bool seek : { false, true }) {
+		uint64_t frames_read = 0;
+		uint64_t checksum = 0;
+		const auto start_ns = NowNs();
+		for (uint64_t q = 0; q < kQueries; q++) {
+			const auto qpc = newest_qpc - (q * 104'729) % (kEntries / 2 * kFrameQpc);
+			checksum += FindFrameAt(reader, qpc, seek, frames_read);
+		}
+		const auto elapsed_ns = NowNs() - start_ns;
+		if (seek) {
+			EXPECT_LE(frames_read, kQueries * (kNsmQpcIndexStride + 1));
+		}
+		std::cout << "Window start (" << (seek ? "seek" : "walk") << "): " << double(elapsed_ns) / double(kQueries)
+			<< " ns per query, " << double(frames_read) / double(kQueries) << " frames read per query (checksum "
+			<< checksum << ")" << std::endl;
+	}
+}
+
+TEST(NsmRingBenchmark, DISABLED_WaitingVersusPolling)
+{
+	// frames arrive at roughly 500 fps; the consumer wants each one as soon as possible
+	constexpr uint64_t kFrames = 500;
+	constexpr auto kFramePeriod = std::chrono::microseconds(2000);
+	struct Mode
+	{
+		const char* name;
+		bool wait;
+		DWORD poll_sleep_ms;
+	};
+	for (auto mode : { Mode{ "wait", true, 0 }, Mode{ "poll 1ms", false, 1 }, Mode{ "poll spin", false, 0 } }) {
+		InProcessRing ring{ 64 };
+		auto writer = ring.MakeWriter();
+		auto reader = ring.MakeReader();
+		const auto event = CreateEventA(NULL, FALSE, FALSE, NULL);
+		ASSERT_NE(event, (HANDLE)NULL);
+		const auto waiter = reader.RegisterWaiter(1);
+		ASSERT_GE(waiter, 0);
+
+		uint64_t frames_seen = 0;
+		uint64_t wakeups = 0;
+		double latency_total_us = 0.0;
+		double latency_max_us = 0.0;
+		double cpu_ms = 0.0;
+		std::thread consumer{ [&] {
+			const auto cpu_start = GetThreadCpuMs();
+			uint64_t next = 0;
+			while (next < kFrames) {
+				if (mode.wait) {
+					if (reader.ArmWaiter(waiter, next + 1)) {
+						WaitForSingleObject(event, 100);
+						wakeups++;
+					}
+				}
+				else if (reader.GetNumFramesWritten() <= next) {
+					if (mode.poll_sleep_ms != 0) {
+						Sleep(mode.poll_sleep_ms);
+					}
+					else {
+						std::this_thread::yield();
+					}
+					wakeups++;
+					continue;
+				}
+				// the latency of the oldest frame not seen yet, the others arrived later
+				const auto written = reader.GetNumFramesWritten();
+				if (written > next) {
+					const auto latency_us = double(NowNs() - reader.GetFrame(next)->present_event.PresentStartTime) / 1000.0;
+					latency_total_us += latency_us;
+					latency_max_us = (std::max)(latency_max_us, latency_us);
+					frames_seen += written - next;
+					next = written;
+				}
+			}
+			reader.DisarmWaiter(waiter);
+			cpu_ms = GetThreadCpuMs() - cpu_start;
+		} };
+
+		auto due = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < kFrames; i++) {
+			due += kFramePeriod;
+			while (std::chrono::steady_clock::now() < due) {
+				std::this_thread::yield();
+			}
+			auto frame = MakeStressFrame(i);
+			frame.present_event.PresentStartTime = NowNs();
+			writer.WriteFrameData(frame);
+			if (writer.TakeWaitersToWake() & (1u << waiter)) {
+				SetEvent(event);
+			}
+		}
+		consumer.join();
+		CloseHandle(event);
+
+		EXPECT_EQ(frames_seen, kFrames);
+		if (mode.wait) {
+			// one wake up per frame at most: notifications are coalesced, never repeated
+			EXPECT_LE(wakeups, kFrames);
+		}
+		std::cout << "Frame notification (" << mode.name << "): " << latency_total_us / double(kFrames)
+			<< " us mean latency, " << latency_max_us << " us max, " << wakeups << " wake ups, "
+			<< cpu_ms << " ms CPU" << std::endl;
+	}
+}
@@ -0,0 +1,53 @@
+#include "gtest/gtest.h"
+#include "../../PresentData/PresentMonTraceConsumer.hpp"
+
+#include <memory>
+#include <vector>
+
+TEST(PresentEventPool, RecyclesReleasedSlots)
+{
+	PresentEventPool pool{ 8 };
+	std::vector<std::shared_ptr<PresentEvent>> events;
+	for (int i = 0; i < 8; i++) {
+		events.push_back(pool.Allocate());
+	}
+	EXPECT_EQ(1, pool.GetSlabCount());
+	const auto* pFirst = events.front().get();
+	events.clear();
+	// all slots were returned, so no new slab is needed and storage is reused
+	bool reused = false;
+	for (int i = 0; i < 8; i++) {
+		auto p = pool.Allocate();
+		reused = reused || p.get() == pFirst;
+		events.push_back(std::move(p));
+	}
+	EXPECT_EQ(1, pool.GetSlabCount());
+	EXPECT_TRUE(reused);
+	events.push_back(pool.Allocate());
+	EXPECT_EQ(2, pool.GetSlabCount());
+}
+
+TEST(PresentEventPool, EventsOutlivePool)
+{
+	std::shared_ptr<PresentEvent> survivor;
+	{
+		PresentEventPool pool{ 4 };
+		survivor = pool.Allocate();
+		survivor->Displayed.emplace_back(FrameType::Application, 1234ull);
+	}
+	ASSERT_EQ(1, survivor->Displayed.size());
+	EXPECT_EQ(1234ull, survivor->Displayed[0].second);
+	survivor.reset();
+}
+
+TEST(PresentEventPool, DisplayedStaysInlineForCommonCase)
+{
+	PresentEventPool pool{ 4 };
+	auto p = pool.Allocate();
+	p->Displayed.emplace_back(FrameType::Application, 10ull);
+	p->Displayed.emplace_back(FrameType::Intel_XEFG, 20ull);
+	EXPECT_TRUE(p->Displayed.is_inline());
+	p->PresentIds.emplace(1ull, 2ull);
+	EXPECT_FALSE(p->PresentIds.emplace(1ull, 3ull).second);
+	EXPECT_EQ(2ull, p->PresentIds.find(1ull)->second);
+}
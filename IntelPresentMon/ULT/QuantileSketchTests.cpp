@@ -0,0 +1,210 @@
+#include "gtest/gtest.h"
+#include "../CommonUtilities/QuantileSketch.h"
+#include "../PresentMonMiddleware/MetricWindow.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using pmon::util::QuantileSketch;
+using pmon::util::WindowedQuantileSketch;
+using pmon::mid::CombinedMetricWindow;
+using pmon::mid::MetricWindow;
+using pmon::mid::MetricWindowOptions;
+
+namespace
+{
+	// exact value at rank q * (n - 1), the rank definition used by the sketch
+	double RankValue(std::vector<double> values, double q)
+	{
+		std::sort(values.begin(), values.end());
+		return values[size_t(q * double(values.size() - 1))];
+	}
+}
+
+TEST(QuantileSketch, QuantilesWithinRelativeAccuracy)
+{
+	std::mt19937_64 rng{ 3 };
+	std::lognormal_distribution<double> frameTime{ 2., 0.6 };
+	for (double accuracy : { 0.01, 0.05 }) {
+		QuantileSketch sketch{ accuracy };
+		std::vector<double> values;
+		for (int i = 0; i < 50'000; i++) {
+			const auto v = frameTime(rng);
+			sketch.Add(v);
+			values.push_back(v);
+		}
+		ASSERT_EQ(values.size(), sketch.Count());
+		for (double q : { 0., 0.01, 0.05, 0.5, 0.9, 0.95, 0.99, 1. }) {
+			const auto exact = RankValue(values, q);
+			EXPECT_NEAR(exact, sketch.Quantile(q), exact * accuracy * 1.0001) << "q=" << q;
+		}
+	}
+}
+
+TEST(QuantileSketch, HandlesZeroAndNegativeValues)
+{
+	QuantileSketch sketch{ 0.01 };
+	std::vector<double> values;
+	for (int i = -100; i <= 100; i++) {
+		sketch.Add(double(i));
+		values.push_back(double(i));
+	}
+	for (double q : { 0., 0.1, 0.25, 0.5, 0.75, 0.9, 1. }) {
+		const auto exact = RankValue(values, q);
+		EXPECT_NEAR(exact, sketch.Quantile(q), std::abs(exact) * 0.0101) << "q=" << q;
+	}
+}
+
+TEST(QuantileSketch, MergeMatchesCombinedSketch)
+{
+	std::mt19937_64 rng{ 5 };
+	std::uniform_real_distribution<double> dist{ 1., 100. };
+	QuantileSketch a{ 0.02 }, b{ 0.02 }, combined{ 0.02 };
+	for (int i = 0; i < 10'000; i++) {
+		const auto v = dist(rng);
+		(i % 3 ? a : b).Add(v);
+		combined.Add(v);
+	}
+	a.Merge(b);
+	ASSERT_EQ(combined.Count(), a.Count());
+	for (double q : { 0., 0.01, 0.5, 0.99, 1. }) {
+		EXPECT_DOUBLE_EQ(combined.Quantile(q), a.Quantile(q));
+	}
+	EXPECT_THROW(a.Merge(QuantileSketch{ 0.01 }), std::invalid_argument);
+}
+
+TEST(QuantileSketch, RemoveUndoesAdd)
+{
+	QuantileSketch sketch{ 0.01 };
+	for (int i = 1; i <= 100; i++) {
+		sketch.Add(double(i));
+	}
+	for (int i = 51; i <= 100; i++) {
+		sketch.Remove(double(i));
+	}
+	ASSERT_EQ(50u, sketch.Count());
+	EXPECT_NEAR(50., sketch.Quantile(1.), 0.5);
+	EXPECT_NEAR(1., sketch.Quantile(0.), 0.01);
+}
+
+TEST(QuantileSketch, BucketCapKeepsUpperQuantilesAccurate)
+{
+	// 64 buckets cannot span 1e-6..1e6 at 1%, so the smallest magnitudes are collapsed
+	QuantileSketch sketch{ 0.01, 64 };
+	std::vector<double> values;
+	for (int e = -6; e <= 6; e++) {
+		for (int i = 1; i < 10; i++) {
+			const auto v = double(i) * std::pow(10., double(e));
+			sketch.Add(v);
+			values.push_back(v);
+		}
+	}
+	for (double q : { 0.99, 1. }) {
+		const auto exact = RankValue(values, q);
+		EXPECT_NEAR(exact, sketch.Quantile(q), exact * 0.0101);
+	}
+}
+
+TEST(WindowedQuantileSketch, TracksSlidingWindow)
+{
+	std::mt19937_64 rng{ 11 };
+	std::uniform_real_distribution<double> dist{ 2., 20. };
+	constexpr uint64_t window = 1000;
+	WindowedQuantileSketch sketch{ 0.01, window / 10 };
+	std::vector<std::pair<uint64_t, double>> samples;
+	for (uint64_t t = 1; t <= 10'000; t++) {
+		const auto v = dist(rng);
+		sketch.Push(t, v);
+		samples.push_back({ t, v });
+		if (t > window && t % 97 == 0) {
+			const auto cutoff = t - window;
+			sketch.EvictThrough(cutoff);
+			// whole blocks are evicted, so the sketch covers at most one block more than requested
+			std::vector<double> live;
+			for (auto& [ts, value] : samples) {
+				if (ts >= sketch.Oldest().timestamp) {
+					live.push_back(value);
+				}
+			}
+			ASSERT_EQ(live.size(), sketch.Size());
+			ASSERT_GE(sketch.Size(), window);
+			ASSERT_LE(sketch.Size(), window + window / 10);
+			for (double p : { 0.01, 0.5, 0.99 }) {
+				const auto exact = RankValue(live, p);
+				ASSERT_NEAR(exact, sketch.Percentile(p), exact * 0.0101);
+			}
+			ASSERT_EQ(*std::min_element(live.begin(), live.end()), sketch.Min());
+			ASSERT_EQ(*std::max_element(live.begin(), live.end()), sketch.Max());
+		}
+	}
+}
+
+TEST(WindowedQuantileSketch, AddToNewestAndAccumulate)
+{
+	WindowedQuantileSketch a{ 0.01, 10 }, b{ 0.01, 10 };
+	a.Push(1, 0.);
+	a.Push(2, 4.);
+	a.AddToNewest(4.);
+	EXPECT_DOUBLE_EQ(8., a.Newest().value);
+	EXPECT_DOUBLE_EQ(4., a.Mean());
+	EXPECT_DOUBLE_EQ(8., a.NonZeroMean());
+	EXPECT_NEAR(8., a.Percentile(1.), 0.08);
+	b.Push(25, 100.);
+	QuantileSketch all{ 0.01 };
+	a.AccumulateInto(all);
+	b.AccumulateInto(all);
+	EXPECT_EQ(3u, all.Count());
+	EXPECT_NEAR(100., all.Quantile(1.), 1.);
+	a.Clear();
+	EXPECT_TRUE(a.Empty());
+}
+
+TEST(CombinedMetricWindow, MatchesStatisticsOverAllSamples)
+{
+	std::mt19937_64 rng{ 5 };
+	std::lognormal_distribution<double> frameTime{ 2., 0.6 };
+	for (bool sketch : { false, true }) {
+		MetricWindowOptions options;
+		if (sketch) {
+			options.sketchRelativeAccuracy = 0.01;
+			options.sketchBlockDuration = 100;
+		}
+		// swap chains with different frame rates, like the ones of several processes
+		std::vector<MetricWindow> windows(3, MetricWindow{ options });
+		std::vector<double> values;
+		for (size_t w = 0; w < windows.size(); w++) {
+			for (uint64_t t = 1; t <= 1000 * (w + 1); t++) {
+				const auto v = frameTime(rng) * double(w + 1);
+				windows[w].Push(t, v);
+				values.push_back(v);
+			}
+		}
+		CombinedMetricWindow combined{ 0.01 };
+		for (auto& window : windows) {
+			combined.Add(window);
+		}
+		combined.Add(MetricWindow{ options });
+		ASSERT_EQ(values.size(), combined.Size());
+		double sum = 0.;
+		for (auto v : values) {
+			sum += v;
+		}
+		EXPECT_NEAR(sum / double(values.size()), combined.Mean(), 1e-9 * sum);
+		EXPECT_EQ(*std::min_element(values.begin(), values.end()), combined.Min());
+		EXPECT_EQ(*std::max_element(values.begin(), values.end()), combined.Max());
+		for (double p : { 0.01, 0.1, 0.5, 0.9, 0.99 }) {
+			const auto exact = RankValue(values, p);
+			EXPECT_NEAR(exact, combined.Percentile(p), exact * 0.0101);
+		}
+	}
+}
+
+TEST(CombinedMetricWindow, EmptyWhenNoWindowHasSamples)
+{
+	CombinedMetricWindow combined{ 0.01 };
+	combined.Add(MetricWindow{});
+	EXPECT_TRUE(combined.Empty());
+	EXPECT_EQ(0., combined.Mean());
+}
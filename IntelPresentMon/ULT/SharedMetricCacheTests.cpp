@@ -0,0 +1,211 @@
+#include "gtest/gtest.h"
+#include "../Streamer/SharedMetricCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// A cache in process memory, laid out the way NamedSharedMem lays out its mapping
+	struct InProcessCache
+	{
+		explicit InProcessCache(uint64_t entry_count)
+			:
+			storage(size_t(SharedMetricCache::GetRequiredSize(entry_count) / sizeof(uint64_t)), 0)
+		{
+			SharedMetricCache::Initialize(storage.data(), entry_count);
+		}
+		SharedMetricCache Open()
+		{
+			SharedMetricCache cache;
+			EXPECT_TRUE(cache.Open(storage.data()));
+			return cache;
+		}
+		std::vector<uint64_t> storage;
+	};
+
+	MetricCacheKey MakeKey(uint64_t frame_qpc, uint32_t metric)
+	{
+		return MetricCacheKey{
+			.frame_qpc = frame_qpc,
+			.window_size = 1000,
+			.metric = metric,
+			.stat = 1,
+			.array_index = 0,
+		};
+	}
+
+	// A frame with the given GPU power and CPU utilization telemetry
+	PmNsmFrameData MakeTelemetryFrame(uint64_t qpc, double gpu_power, double cpu_utilization)
+	{
+		PmNsmFrameData frame{};
+		frame.present_event.PresentStartTime = qpc;
+		frame.power_telemetry.gpu_power_w = gpu_power;
+		frame.cpu_telemetry.cpu_utilization = cpu_utilization;
+		return frame;
+	}
+}
+
+TEST(SharedMetricCacheTests, ValuesAreFoundByTheirWholeKey)
+{
+	InProcessCache storage{ 64 };
+	auto writer = storage.Open();
+	auto reader = storage.Open();
+	uint64_t value = 0;
+
+	const auto key = MakeKey(12345, 7);
+	EXPECT_FALSE(reader.Lookup(key, value));
+	writer.Store(key, 42);
+	ASSERT_TRUE(reader.Lookup(key, value));
+	EXPECT_EQ(value, 42u);
+
+	// a difference in any part of the key is a different value
+	auto other = key;
+	other.frame_qpc++;
+	EXPECT_FALSE(reader.Lookup(other, value));
+	other = key;
+	other.stat++;
+	EXPECT_FALSE(reader.Lookup(other, value));
+	other = key;
+	other.array_index++;
+	EXPECT_FALSE(reader.Lookup(other, value));
+
+	// storing again replaces the value in place
+	writer.Store(key, 43);
+	ASSERT_TRUE(reader.Lookup(key, value));
+	EXPECT_EQ(value, 43u);
+
+	// the memory must hold a cache to be opened
+	std::vector<uint64_t> foreign(64, 0);
+	SharedMetricCache cache;
+	EXPECT_FALSE(cache.Open(foreign.data()));
+	EXPECT_FALSE(cache.Lookup(key, value));
+}
+
+TEST(SharedMetricCacheTests, NewFramesEvictTheOldest)
+{
+	// a single set, so that every key competes for the same entries
+	InProcessCache storage{ kMetricCacheWays };
+	auto cache = storage.Open();
+	uint64_t value = 0;
+
+	for (uint64_t qpc = 1; qpc <= kMetricCacheWays; qpc++) {
+		cache.Store(MakeKey(qpc, 3), qpc);
+	}
+	for (uint64_t qpc = 1; qpc <= kMetricCacheWays; qpc++) {
+		EXPECT_TRUE(cache.Lookup(MakeKey(qpc, 3), value));
+	}
+	cache.Store(MakeKey(100, 3), 100);
+	EXPECT_FALSE(cache.Lookup(MakeKey(1, 3), value));
+	EXPECT_TRUE(cache.Lookup(MakeKey(2, 3), value));
+	EXPECT_TRUE(cache.Lookup(MakeKey(100, 3), value));
+
+	// an entry being written is not read
+	auto entries = reinterpret_cast<MetricCacheEntry*>(storage.storage.data() + sizeof(MetricCacheHeader) / sizeof(uint64_t));
+	for (uint64_t i = 0; i < kMetricCacheWays; i++) {
+		entries[i].seq |= 1;
+	}
+	EXPECT_FALSE(cache.Lookup(MakeKey(100, 3), value));
+}
+
+TEST(SharedMetricCacheTests, StressReadersNeverSeeTornEntries)
+{
+	constexpr int kReaders = 3;
+	constexpr uint64_t kPolls = 50'000;
+	constexpr uint32_t kMetrics = 8;
+	InProcessCache storage{ 16 };
+
+	auto ValueOf = [](const MetricCacheKey& key) { return key.frame_qpc * 1000 + key.metric; };
+
+	std::atomic<bool> done = false;
+	std::vector<uint64_t> bad(kReaders, 0);
+	std::vector<std::thread> readers;
+	for (int i = 0; i < kReaders; i++) {
+		readers.emplace_back([&, i] {
+			auto cache = storage.Open();
+			uint64_t poll = 0;
+			while (!done) {
+				const auto key = MakeKey(poll % kPolls, uint32_t(poll % kMetrics));
+				poll++;
+				uint64_t value = 0;
+				if (cache.Lookup(key, value) && value != ValueOf(key)) {
+					bad[i]++;
+				}
+			}
+		});
+	}
+	// the service is the only writer
+	auto cache = storage.Open();
+	for (uint64_t poll = 0; poll < kPolls; poll++) {
+		for (uint32_t metric = 0; metric < kMetrics; metric++) {
+			const auto key = MakeKey(poll, metric);
+			cache.Store(key, ValueOf(key));
+		}
+	}
+	done = true;
+	for (auto& reader : readers) {
+		reader.join();
+	}
+
+	for (int i = 0; i < kReaders; i++) {
+		EXPECT_EQ(bad[i], 0u) << "reader " << i;
+	}
+}
+
+TEST(SharedMetricCacheTests, WriterPublishesWhatTheMiddlewareComputes)
+{
+	InProcessCache storage{ kMetricCacheEntryCount };
+	auto cache = storage.Open();
+	MetricCacheWriter writer;
+	GpuTelemetryBitset gpuBits;
+	gpuBits.set(size_t(GpuTelemetryCapBits::gpu_power));
+	CpuTelemetryBitset cpuBits;
+	cpuBits.set(size_t(CpuTelemetryCapBits::cpu_utilization));
+	// 1 ms per qpc tick, a frame every 7 ms
+	const LARGE_INTEGER frequency{ .QuadPart = 1000 };
+
+	std::vector<PmNsmFrameData> frames;
+	for (uint64_t i = 1; i <= 1000; i++) {
+		frames.push_back(MakeTelemetryFrame(i * 7, double(i % 37), double((i * 13) % 101)));
+	}
+	// written in batches of varied size, as the service writes them
+	size_t written = 0;
+	for (size_t batch = 1; written < frames.size(); batch = batch % 9 + 1) {
+		const auto count = std::min(batch, frames.size() - written);
+		writer.WriteFrames(cache, std::span{ frames }.subspan(written, count), gpuBits, cpuBits, frequency);
+		written += count;
+
+		// the poll of a client whose window ends at the newest frame of the batch
+		const auto frameQpc = frames[written - 1].present_event.PresentStartTime;
+		for (auto windowMs : kMetricCacheWindowSizesMs) {
+			const auto endQpc = frameQpc > uint64_t(windowMs) ? frameQpc - uint64_t(windowMs) : 0;
+			pmon::mid::MetricWindow gpuPower, cpuUtilization;
+			for (size_t i = 0; i < written; i++) {
+				if (frames[i].present_event.PresentStartTime > endQpc) {
+					gpuPower.Push(frames[i].present_event.PresentStartTime, frames[i].power_telemetry.gpu_power_w);
+					cpuUtilization.Push(frames[i].present_event.PresentStartTime, frames[i].cpu_telemetry.cpu_utilization);
+				}
+			}
+			for (auto stat : kMetricCacheStats) {
+				for (auto [metric, window] : { std::pair{ PM_METRIC_GPU_POWER, &gpuPower }, std::pair{ PM_METRIC_CPU_UTILIZATION, &cpuUtilization } }) {
+					const MetricCacheKey key{
+						.frame_qpc = frameQpc,
+						.window_size = std::bit_cast<uint64_t>(windowMs),
+						.metric = uint32_t(metric),
+						.stat = uint32_t(stat),
+						.array_index = 0,
+					};
+					uint64_t value = 0;
+					ASSERT_TRUE(cache.Lookup(key, value)) << written;
+					ASSERT_EQ(std::bit_cast<uint64_t>(pmon::mid::CalculateWindowStatistic(*window, stat)), value)
+						<< "frames " << written << " window " << windowMs << " stat " << stat;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,148 @@
+#include "gtest/gtest.h"
+#include "ConsumerTestUtils.h"
+#include "../../PresentData/SpscRing.hpp"
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+TEST(SpscRing, StressPreservesOrderAcrossThreads)
+{
+	constexpr uint64_t itemCount = 2'000'000;
+	// small capacity so that the producer frequently finds the ring full and has to wait
+	SpscRing<uint64_t> ring{ 16 };
+	ASSERT_EQ(16u, ring.Capacity());
+
+	std::thread producer{ [&] {
+		std::mt19937 rng{ 1 };
+		for (uint64_t i = 1; i <= itemCount; i++) {
+			auto item = i;
+			if (rng() % 2) {
+				ring.PushWait(std::move(item));
+			}
+			else {
+				while (!ring.TryPush(std::move(item))) {
+					std::this_thread::yield();
+				}
+			}
+		}
+	} };
+
+	std::mt19937 rng{ 2 };
+	std::vector<uint64_t> batch(32);
+	uint64_t expected = 1;
+	while (expected <= itemCount) {
+		const auto count = ring.PopBatch(batch.data(), 1 + rng() % batch.size());
+		for (size_t i = 0; i < count; i++) {
+			ASSERT_EQ(expected, batch[i]);
+			expected++;
+		}
+		if (count == 0) {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	EXPECT_EQ(0u, ring.ReadableCount());
+}
+
+TEST(SpscRing, PoppedSlotsReleaseItems)
+{
+	SpscRing<std::shared_ptr<int>> ring{ 3 };
+	ASSERT_EQ(4u, ring.Capacity());
+	auto item = std::make_shared<int>(5);
+	std::weak_ptr<int> weak = item;
+	ASSERT_TRUE(ring.TryPush(std::move(item)));
+	for (int i = 0; i < 3; i++) {
+		ASSERT_TRUE(ring.TryPush(std::make_shared<int>(i)));
+	}
+	EXPECT_FALSE(ring.TryPush(std::make_shared<int>(9)));
+	std::shared_ptr<int> out[2];
+	ASSERT_EQ(2u, ring.PopBatch(out, 2));
+	EXPECT_EQ(5, *out[0]);
+	EXPECT_EQ(0, *out[1]);
+	out[0].reset();
+	// the ring must not retain a reference to a popped item
+	EXPECT_TRUE(weak.expired());
+	EXPECT_EQ(2u, ring.ReadableCount());
+}
+
+TEST(SpscRing, PushDropOldestDiscardsTheOldestItems)
+{
+	SpscRing<std::shared_ptr<int>> ring{ 4 };
+	auto oldest = std::make_shared<int>(0);
+	std::weak_ptr<int> weak = oldest;
+	EXPECT_FALSE(ring.PushDropOldest(std::move(oldest)));
+	for (int i = 1; i < 4; i++) {
+		EXPECT_FALSE(ring.PushDropOldest(std::make_shared<int>(i)));
+	}
+	EXPECT_TRUE(ring.PushDropOldest(std::make_shared<int>(4)));
+	EXPECT_TRUE(weak.expired());
+	EXPECT_TRUE(ring.PushDropOldest(std::make_shared<int>(5)));
+	EXPECT_EQ(4u, ring.ReadableCount());
+	std::shared_ptr<int> out[4];
+	ASSERT_EQ(4u, ring.PopBatch(out, 4));
+	for (int i = 0; i < 4; i++) {
+		EXPECT_EQ(i + 2, *out[i]);
+	}
+}
+
+TEST(SpscRing, PushDropOldestPreservesOrderAcrossThreads)
+{
+	constexpr uint64_t itemCount = 2'000'000;
+	SpscRing<uint64_t> ring{ 16 };
+	std::atomic<uint64_t> dropped = 0;
+
+	std::thread producer{ [&] {
+		uint64_t localDropped = 0;
+		for (uint64_t i = 1; i <= itemCount; i++) {
+			auto item = i;
+			localDropped += ring.PushDropOldest(std::move(item)) ? 1 : 0;
+		}
+		dropped = localDropped;
+	} };
+
+	std::mt19937 rng{ 3 };
+	std::vector<uint64_t> batch(32);
+	uint64_t last = 0;
+	uint64_t popped = 0;
+	while (last < itemCount) {
+		const auto count = ring.PopBatch(batch.data(), 1 + rng() % batch.size());
+		for (size_t i = 0; i < count; i++) {
+			ASSERT_LT(last, batch[i]);
+			last = batch[i];
+		}
+		popped += count;
+		if (count == 0) {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	EXPECT_EQ(itemCount, popped + dropped);
+}
+
+TEST(PMTraceConsumer, RealtimeOverflowDropsTheOldestPresents)
+{
+	PMTraceConsumer consumer{ 64 };
+	consumer.mIsRealtimeSession = true;
+	SyntheticPresentStream stream{ consumer, 1 };
+	std::vector<std::shared_ptr<PresentEvent>> presents;
+	constexpr uint32_t presentCount = 1000;
+	stream.Run(presentCount, presentCount, &presents);
+
+	// the same stream with room for all of its presents
+	PMTraceConsumer reference;
+	std::vector<std::shared_ptr<PresentEvent>> referencePresents;
+	SyntheticPresentStream{ reference, 1 }.Run(presentCount, presentCount, &referencePresents);
+	ASSERT_EQ(0u, reference.mNumOverflowedPresents);
+
+	EXPECT_EQ(referencePresents.size(), presents.size() + consumer.mNumOverflowedPresents);
+	ASSERT_EQ(consumer.mReadyPresents.Capacity(), presents.size());
+	// what's left is the newest presents, without a gap
+	EXPECT_EQ(referencePresents.back()->PresentStartTime, presents.back()->PresentStartTime);
+	const auto interval = presents[1]->PresentStartTime - presents[0]->PresentStartTime;
+	for (size_t i = 1; i < presents.size(); i++) {
+		EXPECT_EQ(interval, presents[i]->PresentStartTime - presents[i - 1]->PresentStartTime);
+	}
+}
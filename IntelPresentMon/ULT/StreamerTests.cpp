@@ -11,6 +11,7 @@
 #include <locale>
 #include <codecvt>
 #include <functional>
+#include <vector>
 #include <tlhelp32.h>
 
 #include "../CommonUtilities/log/GlogShim.h"
@@ -220,6 +221,50 @@ TEST_F(StreamerULT, ServerWriteData) {
 	SUCCEED();
 }
 
+TEST_F(StreamerULT, PresentBatchIsStreamedInOrder) {
+	DWORD proc_id = GetCurrentProcessId();
+	string mapfile_name;
+	GpuTelemetryBitset gpu_telemetry_cap_bits;
+	CpuTelemetryBitset cpu_telemetry_cap_bits;
+	gpu_telemetry_cap_bits.set();
+	streamer_.StartStreaming(proc_id, proc_id, mapfile_name, false, false, false, false, false);
+	ASSERT_FALSE(mapfile_name.empty());
+
+	// presents of the streamed process, with one of a process nobody streams in between
+	constexpr uint32_t kPresentCount = 100;
+	const std::wstring app_name = L"app.exe";
+	std::vector<PresentEvent> present_events(kPresentCount + 1);
+	std::vector<PresentMonPowerTelemetryInfo> power_telemetry(kPresentCount + 1);
+	std::vector<CpuTelemetryInfo> cpu_telemetry(kPresentCount + 1);
+	std::vector<StreamedPresent> presents;
+	for (uint32_t i = 0; i <= kPresentCount; i++) {
+		present_events[i].ProcessId = i == kPresentCount / 2 ? proc_id + 1 : proc_id;
+		present_events[i].PresentStartTime = 1000 + i;
+		present_events[i].FrameId = i;
+		power_telemetry[i].gpu_power_w = double(i);
+		cpu_telemetry[i].cpu_utilization = double(i);
+		presents.push_back({ &present_events[i], &power_telemetry[i], &cpu_telemetry[i], 999 + i, 0, &app_name });
+	}
+	streamer_.ProcessPresentEvents(presents, gpu_telemetry_cap_bits, cpu_telemetry_cap_bits);
+
+	StreamClient client(std::move(mapfile_name), false);
+	auto ring = client.GetNamedSharedMemView()->GetRingReader();
+	ASSERT_NE(ring, nullptr);
+	ASSERT_EQ(kPresentCount, ring->GetNumFramesWritten());
+	EXPECT_EQ(gpu_telemetry_cap_bits, client.GetNamedSharedMemView()->GetHeader()->gpuTelemetryCapBits);
+	for (uint64_t frame_num = 0; frame_num < kPresentCount; frame_num++) {
+		SCOPED_TRACE(frame_num);
+		const auto i = frame_num < kPresentCount / 2 ? frame_num : frame_num + 1;
+		PmNsmFrameData frame;
+		ASSERT_EQ(NsmFrameState::kReady, ring->CopyFrame(frame_num, frame));
+		EXPECT_EQ(i, frame.present_event.FrameId);
+		EXPECT_EQ(999 + i, frame.present_event.last_present_qpc);
+		EXPECT_EQ(double(i), frame.power_telemetry.gpu_power_w);
+		EXPECT_EQ(double(i), frame.cpu_telemetry.cpu_utilization);
+		EXPECT_STREQ("app.exe", frame.present_event.application);
+	}
+}
+
 TEST(NamedSharedMemoryTest, CreateNamedSharedMemory) {
   DWORD proc_id = GetCurrentProcessId();
   EXPECT_NE(proc_id, 0);
@@ -303,4 +348,183 @@ TEST_F(StreamerULT, ReadBeforeWrite) {
 	PmNsmFrameData* client_read_data = nullptr;
 	client_read_data = client.ReadLatestFrame();
 	EXPECT_EQ(client_read_data, nullptr);
-}
\ No newline at end of file
+}
+
+// Frames with dropped, undisplayed and frame generated (non-app) displays, with a stretch of only
+// generated displays every 256 frames so that the searches for previous app frames go a long way
+static PmNsmFrameData MakeNeighborTestFrame(uint32_t i) {
+	PmNsmFrameData data = {};
+	auto& pe = data.present_event;
+	pe.PresentStartTime = 1'000'000 + i * 10'000ull;
+	pe.ProcessId = GetCurrentProcessId();
+	pe.FrameId = i + 1;
+	if (i % 7 == 3) {
+		pe.FinalState = PresentResult::Discarded;
+	}
+	else {
+		pe.FinalState = PresentResult::Presented;
+		if (i % 11 == 5) {
+			// presented but never displayed
+		}
+		else if ((i / 64) % 4 == 2) {
+			pe.Displayed_FrameType[0] = FrameType::Intel_XEFG;
+			pe.DisplayedCount = 1;
+		}
+		else if (i % 5 == 0) {
+			pe.Displayed_FrameType[0] = FrameType::Intel_XEFG;
+			pe.Displayed_FrameType[1] = FrameType::Application;
+			pe.DisplayedCount = 2;
+		}
+		else {
+			pe.Displayed_FrameType[0] = i % 2 ? FrameType::Application : FrameType::NotSet;
+			pe.DisplayedCount = 1;
+		}
+	}
+	return data;
+}
+
+// Write frames to a playback stream that resets to the oldest frame, so that every client opened
+// on it starts consuming from the first frame. The last frame is displayed so that all of the
+// frames before it can be consumed.
+static string WriteNeighborTestFrames(Streamer& streamer, uint32_t frameCount) {
+	DWORD proc_id = GetCurrentProcessId();
+	string mapfile_name;
+	GpuTelemetryBitset gpu_telemetry_cap_bits;
+	CpuTelemetryBitset cpu_telemetry_cap_bits;
+	streamer.StartStreaming(proc_id, proc_id, mapfile_name, true, false, false, false, true);
+	for (uint32_t i = 0; i < frameCount; i++) {
+		auto data = MakeNeighborTestFrame(i);
+		if (i == frameCount - 1) {
+			data.present_event.FinalState = PresentResult::Presented;
+			data.present_event.Displayed_FrameType[0] = FrameType::Application;
+			data.present_event.DisplayedCount = 1;
+		}
+		streamer.WriteFrameData(proc_id, &data, gpu_telemetry_cap_bits, cpu_telemetry_cap_bits);
+	}
+	return mapfile_name;
+}
+
+// Ids of a consumed frame and its neighbors (0 for none). The frames are copies that the client
+// only keeps until the next frame is consumed or peeked, so they are compared by id.
+struct NeighborIds {
+	uint32_t frame, next, nextDisplayed, lastPresented, lastAppPresented, lastDisplayed, lastAppDisplayed,
+		previousAppFrameOfLastAppDisplayed;
+	bool operator==(const NeighborIds&) const = default;
+};
+
+static NeighborIds GetNeighborIds(const StreamClient::NsmFrameNeighbors& f) {
+	const auto id = [](const PmNsmFrameData* p) { return p ? p->present_event.FrameId : 0u; };
+	return { id(f.pFrameData), id(f.pNextFrame), id(f.pFrameDataOfNextDisplayed), id(f.pFrameDataOfLastPresented),
+		id(f.pFrameDataOfLastAppPresented), id(f.pFrameDataOfLastDisplayed), id(f.pFrameDataOfLastAppDisplayed),
+		id(f.pFrameDataOfPreviousAppFrameOfLastAppDisplayed) };
+}
+
+static std::vector<NeighborIds> ConsumeEachFrame(StreamClient& client) {
+	std::vector<NeighborIds> frames;
+	while (true) {
+		StreamClient::NsmFrameNeighbors f;
+		const auto status = client.ConsumePtrToNextNsmFrameData(&f.pFrameData, &f.pNextFrame,
+			&f.pFrameDataOfNextDisplayed, &f.pFrameDataOfLastPresented, &f.pFrameDataOfLastAppPresented,
+			&f.pFrameDataOfLastDisplayed, &f.pFrameDataOfLastAppDisplayed, &f.pFrameDataOfPreviousAppFrameOfLastAppDisplayed);
+		if (status != PM_STATUS::PM_STATUS_SUCCESS || !f.pFrameData) {
+			break;
+		}
+		frames.push_back(GetNeighborIds(f));
+	}
+	return frames;
+}
+
+static std::vector<NeighborIds> ConsumeFrameBatches(StreamClient& client, size_t batchSize) {
+	std::vector<NeighborIds> frames;
+	std::vector<StreamClient::NsmFrameNeighbors> batch;
+	while (client.PeekNsmFrameBatch(batch, batchSize) == PM_STATUS::PM_STATUS_SUCCESS && !batch.empty()) {
+		for (const auto& f : batch) {
+			frames.push_back(GetNeighborIds(f));
+		}
+		client.CommitNsmFrameBatch(batch.size());
+	}
+	return frames;
+}
+
+TEST_F(StreamerULT, FrameBatchMatchesPerFrameConsume) {
+	constexpr uint32_t kFrameCount = 1'000;
+	const auto mapfile_name = WriteNeighborTestFrames(streamer_, kFrameCount);
+	ASSERT_FALSE(mapfile_name.empty());
+
+	StreamClient per_frame_client(mapfile_name, false);
+	StreamClient batch_client(mapfile_name, false);
+	ASSERT_LT(kFrameCount, per_frame_client.GetNamedSharedMemView()->GetHeader()->max_entries);
+
+	const auto expected = ConsumeEachFrame(per_frame_client);
+	// an odd batch size so that batches start all over the frame pattern
+	const auto actual = ConsumeFrameBatches(batch_client, 37);
+	ASSERT_EQ(kFrameCount - 1, expected.size());
+	ASSERT_EQ(expected.size(), actual.size());
+
+	for (size_t i = 0; i < expected.size(); i++) {
+		SCOPED_TRACE(i);
+		EXPECT_EQ(expected[i].frame, actual[i].frame);
+		EXPECT_EQ(expected[i].next, actual[i].next);
+		EXPECT_EQ(expected[i].nextDisplayed, actual[i].nextDisplayed);
+		EXPECT_EQ(expected[i].lastPresented, actual[i].lastPresented);
+		EXPECT_EQ(expected[i].lastAppPresented, actual[i].lastAppPresented);
+		EXPECT_EQ(expected[i].lastDisplayed, actual[i].lastDisplayed);
+		EXPECT_EQ(expected[i].lastAppDisplayed, actual[i].lastAppDisplayed);
+		EXPECT_EQ(expected[i].previousAppFrameOfLastAppDisplayed, actual[i].previousAppFrameOfLastAppDisplayed);
+	}
+}
+
+TEST_F(StreamerULT, OverwrittenFramesAreReportedLost) {
+	const auto mapfile_name = WriteNeighborTestFrames(streamer_, 100);
+	ASSERT_FALSE(mapfile_name.empty());
+	StreamClient client(mapfile_name, false);
+	auto ring = client.GetNamedSharedMemView()->GetRingReader();
+	ASSERT_NE(ring, nullptr);
+
+	std::vector<StreamClient::NsmFrameNeighbors> batch;
+	ASSERT_EQ(PM_STATUS::PM_STATUS_SUCCESS, client.PeekNsmFrameBatch(batch, 10));
+	ASSERT_EQ(10u, batch.size());
+	EXPECT_EQ(1u, batch.front().pFrameData->present_event.FrameId);
+	client.CommitNsmFrameBatch(batch.size());
+
+	// the service comes all the way around the ring before the client peeks again
+	const auto max_entries = client.GetNamedSharedMemView()->GetHeader()->max_entries;
+	GpuTelemetryBitset gpu_telemetry_cap_bits;
+	CpuTelemetryBitset cpu_telemetry_cap_bits;
+	for (uint32_t i = 100; i < max_entries + 200; i++) {
+		auto data = MakeNeighborTestFrame(i);
+		streamer_.WriteFrameData(GetCurrentProcessId(), &data, gpu_telemetry_cap_bits, cpu_telemetry_cap_bits);
+	}
+	const auto oldest = ring->GetOldestFrame(ring->GetNumFramesWritten());
+	ASSERT_EQ(PM_STATUS::PM_STATUS_SUCCESS, client.PeekNsmFrameBatch(batch, 10));
+	EXPECT_TRUE(batch.empty());
+	EXPECT_EQ(oldest - 10, client.GetLostFrameCount());
+
+	// and the client starts over from the oldest frame of the stream, which has no previous frames left
+	ASSERT_EQ(PM_STATUS::PM_STATUS_SUCCESS, client.PeekNsmFrameBatch(batch, 10));
+	ASSERT_FALSE(batch.empty());
+	EXPECT_EQ(oldest + 1, batch.front().pFrameData->present_event.FrameId);
+	EXPECT_EQ(nullptr, batch.front().pFrameDataOfLastPresented);
+}
+
+TEST_F(StreamerULT, DISABLED_FrameBatchConsumeBenchmark) {
+	constexpr uint32_t kFrameCount = 1'000;
+	constexpr int kPasses = 20;
+	const auto mapfile_name = WriteNeighborTestFrames(streamer_, kFrameCount);
+	ASSERT_FALSE(mapfile_name.empty());
+
+	// each pass drains the backlog with a new client, which starts from the oldest frame
+	const auto measure = [&](auto&& consume) {
+		std::chrono::duration<double> total{};
+		for (int pass = 0; pass < kPasses; pass++) {
+			StreamClient client(mapfile_name, false);
+			const auto start = std::chrono::high_resolution_clock::now();
+			EXPECT_EQ(kFrameCount - 1, consume(client).size());
+			total += std::chrono::high_resolution_clock::now() - start;
+		}
+		return total.count() * 1e9 / (double(kFrameCount - 1) * kPasses);
+	};
+	const auto per_frame_ns = measure([](StreamClient& client) { return ConsumeEachFrame(client); });
+	const auto batch_ns = measure([](StreamClient& client) { return ConsumeFrameBatches(client, 1'024); });
+	std::cout << "NSM frame consume ns/frame: per frame=" << per_frame_ns << " batch=" << batch_ns << std::endl;
+}
@@ -1,9 +1,17 @@
 #include "gtest/gtest.h"
 #include "../ControlLib/TelemetryHistory.h"
+#include "../ControlLib/ConcurrentTelemetryHistory.h"
+#include "../ControlLib/PowerTelemetryAdapter.h"
 #include <algorithm>
 #include <iterator>
 #include <ranges>
 #include <functional>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 TEST(TelemetryHistory, iterationEmpty)
 {
@@ -107,4 +115,293 @@ TEST(TelemetryHistory, nearestCloseHigher)
     const auto nearest = hist.GetNearest(58);
     EXPECT_TRUE(bool(nearest));
     EXPECT_EQ(60, nearest->qpc);
-}
\ No newline at end of file
+}
+TEST(ConcurrentTelemetryHistory, nearestMatchesTelemetryHistory)
+{
+    // the oldest slot is kept free for the writer, so this holds the 3 newest samples
+    pwr::ConcurrentTelemetryHistory<PresentMonPowerTelemetryInfo> conc(4);
+    pwr::TelemetryHistory<PresentMonPowerTelemetryInfo> hist(3);
+    EXPECT_FALSE(bool(conc.GetNearest(10)));
+    for (uint64_t qpc = 10; qpc <= 70; qpc += 10) {
+        hist.Push({ .qpc = qpc });
+        conc.Push({ .qpc = qpc });
+    }
+    for (uint64_t qpc = 0; qpc <= 80; qpc++) {
+        const auto expected = hist.GetNearest(qpc);
+        const auto nearest = conc.GetNearest(qpc);
+        ASSERT_TRUE(bool(nearest));
+        EXPECT_EQ(expected->qpc, nearest->qpc) << "at " << qpc;
+    }
+    EXPECT_EQ(50, conc.GetNearest(0)->qpc);
+}
+
+TEST(ConcurrentTelemetryHistory, interpolatedBetweenSamples)
+{
+    pwr::ConcurrentTelemetryHistory<PresentMonPowerTelemetryInfo> hist(5);
+    hist.Push({ .qpc = 100, .gpu_power_w = 10., .gpu_temperature_c = 50., .fan_speed_rpm = { 1000. } });
+    hist.Push({ .qpc = 200, .gpu_power_w = 30., .gpu_temperature_c = 70., .fan_speed_rpm = { 2000. } });
+
+    const auto quarter = hist.GetInterpolated(125);
+    ASSERT_TRUE(bool(quarter));
+    EXPECT_EQ(125, quarter->qpc);
+    EXPECT_DOUBLE_EQ(15., quarter->gpu_power_w);
+    EXPECT_DOUBLE_EQ(55., quarter->gpu_temperature_c);
+    EXPECT_DOUBLE_EQ(1250., quarter->fan_speed_rpm[0]);
+
+    // exact hits and qpcs outside of the history give the samples themselves
+    EXPECT_DOUBLE_EQ(10., hist.GetInterpolated(100)->gpu_power_w);
+    EXPECT_DOUBLE_EQ(30., hist.GetInterpolated(200)->gpu_power_w);
+    EXPECT_DOUBLE_EQ(10., hist.GetInterpolated(50)->gpu_power_w);
+    EXPECT_EQ(200, hist.GetInterpolated(500)->qpc);
+}
+
+TEST(ConcurrentTelemetryHistory, interpolatedCpu)
+{
+    pwr::ConcurrentTelemetryHistory<CpuTelemetryInfo> hist(5);
+    hist.Push({ .qpc = 0, .cpu_utilization = 20., .cpu_power_w = 40. });
+    hist.Push({ .qpc = 10, .cpu_utilization = 60., .cpu_power_w = 80. });
+
+    const auto info = hist.GetInterpolated(5);
+    ASSERT_TRUE(bool(info));
+    EXPECT_DOUBLE_EQ(40., info->cpu_utilization);
+    EXPECT_DOUBLE_EQ(60., info->cpu_power_w);
+}
+
+TEST(ConcurrentTelemetryHistory, sweepMatchesLookups)
+{
+    pwr::ConcurrentTelemetryHistory<PresentMonPowerTelemetryInfo> hist(16);
+    std::vector<uint64_t> qpcs{ 1, 2, 3 };
+    std::vector<PresentMonPowerTelemetryInfo> infos(qpcs.size(), PresentMonPowerTelemetryInfo{ .qpc = 99 });
+    // an empty history leaves the infos alone
+    hist.GetNearest(qpcs, infos);
+    EXPECT_EQ(99, infos[0].qpc);
+
+    for (uint64_t qpc = 100; qpc <= 400; qpc += 10) {
+        hist.Push({ .qpc = qpc, .gpu_power_w = double(qpc) });
+    }
+    // ascending qpcs before, inside and after the history, with repeats
+    qpcs.clear();
+    for (uint64_t qpc = 0; qpc <= 500; qpc += 3) {
+        qpcs.push_back(qpc);
+        if (qpc % 5 == 0) {
+            qpcs.push_back(qpc);
+        }
+    }
+    infos.assign(qpcs.size(), {});
+    hist.GetNearest(qpcs, infos);
+    for (size_t i = 0; i < qpcs.size(); i++) {
+        EXPECT_EQ(hist.GetNearest(qpcs[i])->qpc, infos[i].qpc) << "at " << qpcs[i];
+    }
+    hist.GetInterpolated(qpcs, infos);
+    for (size_t i = 0; i < qpcs.size(); i++) {
+        EXPECT_DOUBLE_EQ(hist.GetInterpolated(qpcs[i])->gpu_power_w, infos[i].gpu_power_w) << "at " << qpcs[i];
+    }
+}
+
+TEST(ConcurrentTelemetryHistory, readersNeverSeeTornSamples)
+{
+    constexpr uint64_t sampleCount = 200'000;
+    constexpr int readerCount = 3;
+    // small enough that the writer laps the readers all the time
+    pwr::ConcurrentTelemetryHistory<PresentMonPowerTelemetryInfo> hist(8);
+
+    // every field of a sample is derived from its qpc, so a torn copy shows as a mismatch
+    auto MakeSample = [](uint64_t qpc) {
+        PresentMonPowerTelemetryInfo info{ .qpc = qpc, .gpu_power_w = double(qpc) };
+        info.fan_speed_rpm.fill(double(qpc));
+        info.vram_temperature_c = double(qpc);
+        return info;
+    };
+
+    std::atomic<bool> done = false;
+    std::vector<uint64_t> bad(readerCount, 0);
+    std::vector<uint64_t> found(readerCount, 0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < readerCount; i++) {
+        readers.emplace_back([&, i] {
+            uint64_t lookup = 0;
+            while (!done) {
+                const auto qpc = 10 * (lookup++ % sampleCount);
+                if (auto info = hist.GetNearest(qpc)) {
+                    found[i]++;
+                    if (info->gpu_power_w != double(info->qpc) || info->vram_temperature_c != double(info->qpc) ||
+                        info->fan_speed_rpm.back() != double(info->qpc)) {
+                        bad[i]++;
+                    }
+                }
+                if (auto info = hist.GetInterpolated(qpc + 5)) {
+                    // interpolated between two neighbors 10 apart, or clamped to one of them
+                    if (info->gpu_power_w != double(info->qpc) &&
+                        (info->gpu_power_w < double(info->qpc) - 5. || info->gpu_power_w > double(info->qpc) + 5.)) {
+                        bad[i]++;
+                    }
+                }
+            }
+        });
+    }
+    for (uint64_t i = 1; i <= sampleCount; i++) {
+        hist.Push(MakeSample(10 * i));
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    for (int i = 0; i < readerCount; i++) {
+        EXPECT_EQ(0u, bad[i]) << "reader " << i;
+    }
+}
+
+namespace
+{
+    // Adapters that only hold a history, filled by Sample() with synthetic telemetry, to compare the
+    // locked history the adapters used to keep with the concurrent one. Readers only contend with
+    // the sampler when they run on other cores, so the comparison means nothing on a single core.
+    class LockedHistoryAdapter : public pwr::PowerTelemetryAdapter
+    {
+    public:
+        bool Sample() noexcept override
+        {
+            std::lock_guard lock{ historyMutex };
+            history.Push({ .qpc = ++qpc, .gpu_power_w = double(qpc) });
+            return true;
+        }
+        std::optional<PresentMonPowerTelemetryInfo> GetClosest(uint64_t qpc) const noexcept override
+        {
+            std::lock_guard lock{ historyMutex };
+            return history.GetNearest(qpc);
+        }
+        std::optional<PresentMonPowerTelemetryInfo> GetInterpolated(uint64_t qpc) const noexcept override
+        {
+            return GetClosest(qpc);
+        }
+        PM_DEVICE_VENDOR GetVendor() const noexcept override { return PM_DEVICE_VENDOR_UNKNOWN; }
+        std::string GetName() const noexcept override { return "Locked"; }
+        uint64_t GetDedicatedVideoMemory() const noexcept override { return 0; }
+        uint64_t GetVideoMemoryMaxBandwidth() const noexcept override { return 0; }
+        double GetSustainedPowerLimit() const noexcept override { return 0.; }
+    private:
+        uint64_t qpc = 0;
+        mutable std::mutex historyMutex;
+        pwr::TelemetryHistory<PresentMonPowerTelemetryInfo> history{ defaultHistorySize };
+    };
+
+    class ConcurrentHistoryAdapter : public pwr::PowerTelemetryAdapter
+    {
+    public:
+        bool Sample() noexcept override
+        {
+            history.Push({ .qpc = ++qpc, .gpu_power_w = double(qpc) });
+            return true;
+        }
+        std::optional<PresentMonPowerTelemetryInfo> GetClosest(uint64_t qpc) const noexcept override
+        {
+            return history.GetNearest(qpc);
+        }
+        std::optional<PresentMonPowerTelemetryInfo> GetInterpolated(uint64_t qpc) const noexcept override
+        {
+            return history.GetInterpolated(qpc);
+        }
+        PM_DEVICE_VENDOR GetVendor() const noexcept override { return PM_DEVICE_VENDOR_UNKNOWN; }
+        std::string GetName() const noexcept override { return "Concurrent"; }
+        uint64_t GetDedicatedVideoMemory() const noexcept override { return 0; }
+        uint64_t GetVideoMemoryMaxBandwidth() const noexcept override { return 0; }
+        double GetSustainedPowerLimit() const noexcept override { return 0.; }
+    private:
+        uint64_t qpc = 0;
+        pwr::ConcurrentTelemetryHistory<PresentMonPowerTelemetryInfo> history{ defaultHistorySize };
+    };
+
+    // lookups per second of each of readerCount threads looking up recent telemetry while another
+    // thread samples every samplePeriod, the way frames of several processes are stamped
+    double MeasureLookupsUnderSampling(pwr::PowerTelemetryAdapter& adapter, int readerCount,
+        std::chrono::microseconds samplePeriod)
+    {
+        constexpr uint64_t lookupCount = 1'000'000;
+        for (size_t i = 0; i < pwr::PowerTelemetryAdapter::defaultHistorySize; i++) {
+            adapter.Sample();
+        }
+        std::atomic<uint64_t> sampleCount = pwr::PowerTelemetryAdapter::defaultHistorySize;
+        std::atomic<bool> done = false;
+        std::thread sampler{ [&] {
+            auto next = std::chrono::high_resolution_clock::now();
+            while (!done) {
+                next += samplePeriod;
+                while (std::chrono::high_resolution_clock::now() < next) {}
+                adapter.Sample();
+                sampleCount++;
+            }
+        } };
+        std::atomic<double> totalRate = 0.;
+        std::vector<std::thread> readers;
+        for (int r = 0; r < readerCount; r++) {
+            readers.emplace_back([&] {
+                double checksum = 0.;
+                const auto start = std::chrono::high_resolution_clock::now();
+                for (uint64_t i = 0; i < lookupCount; i++) {
+                    if (auto info = adapter.GetClosest(sampleCount - i % 100)) {
+                        checksum += info->gpu_power_w;
+                    }
+                }
+                const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+                EXPECT_GT(checksum, 0.);
+                totalRate = totalRate + double(lookupCount) / elapsed.count();
+            });
+        }
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        done = true;
+        sampler.join();
+        return totalRate / readerCount;
+    }
+}
+
+TEST(TelemetryHistoryBenchmark, DISABLED_LookupsUnderSampling)
+{
+    for (int readerCount : { 1, 4 }) {
+        for (auto samplePeriod : { std::chrono::microseconds{ 1000 }, std::chrono::microseconds{ 10 } }) {
+            LockedHistoryAdapter locked;
+            ConcurrentHistoryAdapter concurrent;
+            const auto lockedRate = MeasureLookupsUnderSampling(locked, readerCount, samplePeriod);
+            const auto concurrentRate = MeasureLookupsUnderSampling(concurrent, readerCount, samplePeriod);
+            std::cout << "Telemetry lookups/sec per reader (" << readerCount << " readers, sampling every "
+                << samplePeriod.count() << "us): locked=" << lockedRate << " concurrent=" << concurrentRate << std::endl;
+        }
+    }
+}
+
+TEST(TelemetryHistoryBenchmark, DISABLED_SweepVersusLookups)
+{
+    // a second of presents at 1000 fps against a history sampled every 4ms
+    constexpr uint64_t presentCount = 1000;
+    constexpr uint64_t batchCount = 2000;
+    pwr::ConcurrentTelemetryHistory<PresentMonPowerTelemetryInfo> hist(pwr::PowerTelemetryAdapter::defaultHistorySize);
+    for (uint64_t i = 0; i < pwr::PowerTelemetryAdapter::defaultHistorySize; i++) {
+        hist.Push({ .qpc = i * 40'000, .gpu_power_w = double(i) });
+    }
+    std::vector<uint64_t> qpcs(presentCount);
+    for (uint64_t i = 0; i < presentCount; i++) {
+        qpcs[i] = 200 * 40'000 + i * 10'000;
+    }
+    std::vector<PresentMonPowerTelemetryInfo> infos(presentCount);
+
+    double checksum = 0.;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint64_t b = 0; b < batchCount; b++) {
+        for (uint64_t i = 0; i < presentCount; i++) {
+            infos[i] = *hist.GetNearest(qpcs[i]);
+        }
+        checksum += infos.back().gpu_power_w;
+    }
+    const std::chrono::duration<double> lookupElapsed = std::chrono::high_resolution_clock::now() - start;
+    start = std::chrono::high_resolution_clock::now();
+    for (uint64_t b = 0; b < batchCount; b++) {
+        hist.GetNearest(qpcs, infos);
+        checksum += infos.back().gpu_power_w;
+    }
+    const std::chrono::duration<double> sweepElapsed = std::chrono::high_resolution_clock::now() - start;
+    EXPECT_GT(checksum, 0.);
+    std::cout << "Telemetry ns per present: lookups=" << lookupElapsed.count() * 1e9 / (batchCount * presentCount)
+        << " sweep=" << sweepElapsed.count() * 1e9 / (batchCount * presentCount) << std::endl;
+}
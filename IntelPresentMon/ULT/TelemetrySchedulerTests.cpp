@@ -0,0 +1,131 @@
+#include "gtest/gtest.h"
+#include "../ControlLib/TelemetryScheduler.h"
+#include <vector>
+
+namespace
+{
+    using Gpu = GpuTelemetryCapBits;
+
+    GpuTelemetryBitset MakeCaps(std::initializer_list<Gpu> caps)
+    {
+        GpuTelemetryBitset bits;
+        for (auto cap : caps) {
+            bits.set(size_t(cap));
+        }
+        return bits;
+    }
+
+    // runs the scheduler the way the telemetry thread does, waking when the next capability falls due,
+    // and counts the samples taken of each capability until time end
+    struct SchedulerRun
+    {
+        SchedulerRun(pwr::GpuTelemetryScheduler& scheduler, double end)
+        {
+            double now = 0.;
+            while (now < end) {
+                const auto due = scheduler.TakeDue(now);
+                if (due.any()) {
+                    wakes++;
+                }
+                for (size_t i = 0; i < due.size(); i++) {
+                    counts[i] += due[i] ? 1 : 0;
+                }
+                now = std::max(now, scheduler.GetNextDue().value_or(end));
+            }
+        }
+        std::vector<int> counts = std::vector<int>(size_t(Gpu::gpu_telemetry_count), 0);
+        int wakes = 0;
+    };
+}
+
+TEST(TelemetryScheduler, everythingIsDemandedUntilToldOtherwise)
+{
+    pwr::GpuTelemetryScheduler scheduler{ 0.016 };
+    EXPECT_TRUE(scheduler.TakeDue(0.).all());
+    EXPECT_TRUE(scheduler.TakeDue(0.001).none());
+    ASSERT_TRUE(scheduler.GetNextDue());
+    EXPECT_DOUBLE_EQ(0.016, *scheduler.GetNextDue());
+    EXPECT_TRUE(scheduler.TakeDue(0.016).all());
+}
+
+TEST(TelemetryScheduler, nothingIsSampledWithoutDemand)
+{
+    pwr::GpuTelemetryScheduler scheduler{ 0.016 };
+    scheduler.SetDemand(GpuTelemetryBitset{});
+    EXPECT_TRUE(scheduler.TakeDue(0.).none());
+    EXPECT_TRUE(scheduler.TakeDue(100.).none());
+    EXPECT_FALSE(scheduler.GetNextDue());
+
+    // a client that does not state its demand might use anything
+    scheduler.SetDemand(std::nullopt);
+    EXPECT_TRUE(scheduler.TakeDue(100.).all());
+}
+
+TEST(TelemetryScheduler, capsAreSampledAtTheirOwnPeriods)
+{
+    pwr::GpuTelemetryScheduler scheduler{ 0.016 };
+    scheduler.SetDemand(MakeCaps({ Gpu::gpu_power, Gpu::gpu_temperature, Gpu::fan_speed_0 }));
+    scheduler.SetPeriod(Gpu::gpu_power, 0.001);
+    scheduler.SetMinimumPeriod(Gpu::fan_speed_0, 1.);
+    EXPECT_DOUBLE_EQ(0.001, scheduler.GetPeriod(Gpu::gpu_power));
+    EXPECT_DOUBLE_EQ(0.016, scheduler.GetPeriod(Gpu::gpu_temperature));
+    EXPECT_DOUBLE_EQ(1., scheduler.GetPeriod(Gpu::fan_speed_0));
+
+    SchedulerRun run{ scheduler, 2. };
+    EXPECT_NEAR(2000, run.counts[size_t(Gpu::gpu_power)], 2);
+    EXPECT_NEAR(125, run.counts[size_t(Gpu::gpu_temperature)], 2);
+    EXPECT_NEAR(2, run.counts[size_t(Gpu::fan_speed_0)], 1);
+    EXPECT_EQ(0, run.counts[size_t(Gpu::gpu_frequency)]);
+
+    // the base period does not go below the minimum period, but a period of its own does
+    scheduler.SetBasePeriod(2.);
+    EXPECT_DOUBLE_EQ(2., scheduler.GetPeriod(Gpu::fan_speed_0));
+    EXPECT_DOUBLE_EQ(0.001, scheduler.GetPeriod(Gpu::gpu_power));
+    scheduler.SetPeriod(Gpu::fan_speed_0, 0.5);
+    EXPECT_DOUBLE_EQ(0.5, scheduler.GetPeriod(Gpu::fan_speed_0));
+    scheduler.SetPeriod(Gpu::gpu_power, std::nullopt);
+    EXPECT_DOUBLE_EQ(2., scheduler.GetPeriod(Gpu::gpu_power));
+}
+
+TEST(TelemetryScheduler, capsDueCloseTogetherAreTakenTogether)
+{
+    pwr::GpuTelemetryScheduler scheduler{ 0.016 };
+    scheduler.SetDemand(MakeCaps({ Gpu::gpu_power, Gpu::gpu_frequency }));
+    scheduler.SetPeriod(Gpu::gpu_frequency, 0.020);
+
+    // frequency comes along with power whenever it is due within a quarter of its period, and still
+    // keeps to its own rate
+    SchedulerRun run{ scheduler, 10. };
+    EXPECT_NEAR(625, run.counts[size_t(Gpu::gpu_power)], 2);
+    EXPECT_NEAR(500, run.counts[size_t(Gpu::gpu_frequency)], 2);
+    EXPECT_LT(run.wakes, 1000);
+}
+
+TEST(TelemetryScheduler, newDemandIsDueRightAway)
+{
+    pwr::GpuTelemetryScheduler scheduler{ 0.016 };
+    scheduler.SetDemand(MakeCaps({ Gpu::gpu_power }));
+    EXPECT_EQ(MakeCaps({ Gpu::gpu_power }), scheduler.TakeDue(1.));
+    scheduler.SetDemand(MakeCaps({ Gpu::gpu_power, Gpu::gpu_voltage }));
+    EXPECT_EQ(MakeCaps({ Gpu::gpu_voltage }), scheduler.TakeDue(1.001));
+    EXPECT_EQ(MakeCaps({ Gpu::gpu_power, Gpu::gpu_voltage }), scheduler.GetDemand());
+
+    // demand that is dropped and taken up again starts over as well
+    scheduler.SetDemand(MakeCaps({ Gpu::gpu_voltage }));
+    scheduler.SetDemand(MakeCaps({ Gpu::gpu_power, Gpu::gpu_voltage }));
+    EXPECT_EQ(MakeCaps({ Gpu::gpu_power }), scheduler.TakeDue(1.002));
+}
+
+TEST(TelemetryScheduler, lateCapsStartTheirCadenceOver)
+{
+    pwr::GpuTelemetryScheduler scheduler{ 0.010 };
+    scheduler.SetDemand(MakeCaps({ Gpu::gpu_power }));
+    EXPECT_TRUE(scheduler.TakeDue(0.).any());
+    // a little late keeps to the cadence
+    EXPECT_TRUE(scheduler.TakeDue(0.013).any());
+    EXPECT_DOUBLE_EQ(0.020, *scheduler.GetNextDue());
+    // more than a period late does not try to catch up
+    EXPECT_TRUE(scheduler.TakeDue(5.).any());
+    EXPECT_DOUBLE_EQ(5.010, *scheduler.GetNextDue());
+    EXPECT_TRUE(scheduler.TakeDue(5.001).none());
+}
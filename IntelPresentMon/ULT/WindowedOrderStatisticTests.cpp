@@ -0,0 +1,198 @@
+#include "gtest/gtest.h"
+#include "../CommonUtilities/WindowedOrderStatistic.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using pmon::util::WindowedOrderStatistic;
+
+namespace
+{
+	// reference for the percentile definition the middleware used before windows were incremental:
+	// sort, then interpolate between ranks floor(p * n) and floor(p * n) + 1
+	double ReferencePercentile(std::vector<double> values, double p)
+	{
+		std::sort(values.begin(), values.end());
+		double integral;
+		const double fract = std::modf(p * double(values.size()), &integral);
+		const auto idx = size_t(integral);
+		if (idx >= values.size() - 1) {
+			return values.back();
+		}
+		return values[idx] + fract * (values[idx + 1] - values[idx]);
+	}
+
+	std::vector<double> Values(const std::deque<WindowedOrderStatistic::Sample>& samples)
+	{
+		std::vector<double> values;
+		for (auto& s : samples) {
+			values.push_back(s.value);
+		}
+		return values;
+	}
+}
+
+TEST(WindowedOrderStatistic, MatchesSortedReferenceUnderChurn)
+{
+	std::mt19937_64 rng{ 7 };
+	WindowedOrderStatistic window;
+	std::deque<WindowedOrderStatistic::Sample> reference;
+	uint64_t timestamp = 0;
+
+	for (int i = 0; i < 20'000; i++) {
+		const auto op = rng() % 10;
+		if (op < 6) {
+			// quantized values so that ties are common
+			const double value = double(rng() % 64) * 0.25;
+			timestamp += rng() % 3;
+			window.Push(timestamp, value);
+			reference.push_back({ timestamp, value });
+		}
+		else if (op < 8) {
+			const uint64_t cutoff = timestamp > 40 ? timestamp - 40 : 0;
+			window.EvictThrough(cutoff);
+			while (!reference.empty() && reference.front().timestamp <= cutoff) {
+				reference.pop_front();
+			}
+		}
+		else if (op == 8 && !reference.empty()) {
+			const double delta = double(rng() % 5) - 2.;
+			window.AddToNewest(delta);
+			reference.back().value += delta;
+		}
+
+		ASSERT_EQ(reference.size(), window.Size());
+		if (reference.empty()) {
+			continue;
+		}
+		auto sorted = Values(reference);
+		std::sort(sorted.begin(), sorted.end());
+		for (size_t rank = 0; rank < sorted.size(); rank++) {
+			ASSERT_EQ(sorted[rank], window.Select(rank));
+		}
+		ASSERT_EQ(sorted.front(), window.Min());
+		ASSERT_EQ(sorted.back(), window.Max());
+		for (double p : { 0.01, 0.05, 0.10, 0.90, 0.95, 0.99 }) {
+			ASSERT_DOUBLE_EQ(ReferencePercentile(sorted, p), window.Percentile(p));
+		}
+		double sum = 0.;
+		for (auto v : sorted) {
+			sum += v;
+		}
+		ASSERT_NEAR(sum / double(sorted.size()), window.Mean(), 1e-9);
+		ASSERT_EQ(reference.front().value, window.Oldest().value);
+		ASSERT_EQ(reference.back().value, window.Newest().value);
+	}
+}
+
+TEST(WindowedOrderStatistic, MidLerpInterpolatesArrivalOrder)
+{
+	WindowedOrderStatistic window;
+	window.Push(1, 10.);
+	EXPECT_DOUBLE_EQ(10., window.MidLerp());
+	window.Push(2, 30.);
+	EXPECT_DOUBLE_EQ(20., window.MidLerp());
+	// the middle is taken in arrival order, not value order
+	window.Push(3, 0.);
+	EXPECT_DOUBLE_EQ(30., window.MidLerp());
+	window.Push(4, 100.);
+	EXPECT_DOUBLE_EQ(15., window.MidLerp());
+	window.EvictThrough(2);
+	EXPECT_DOUBLE_EQ(50., window.MidLerp());
+}
+
+TEST(WindowedOrderStatistic, NonZeroMeanAndClear)
+{
+	WindowedOrderStatistic window;
+	window.Push(1, 0.);
+	window.Push(1, 4.);
+	window.Push(2, 0.);
+	window.Push(2, 8.);
+	EXPECT_DOUBLE_EQ(3., window.Mean());
+	EXPECT_DOUBLE_EQ(6., window.NonZeroMean());
+	window.Clear();
+	EXPECT_TRUE(window.Empty());
+	EXPECT_DOUBLE_EQ(0., window.Mean());
+	EXPECT_DOUBLE_EQ(0., window.NonZeroMean());
+	// storage is recycled after clearing
+	window.Push(3, 5.);
+	EXPECT_DOUBLE_EQ(5., window.Max());
+	EXPECT_DOUBLE_EQ(5., window.Min());
+}
+
+TEST(WindowedOrderStatistic, CopiesAreIndependent)
+{
+	WindowedOrderStatistic a;
+	for (uint64_t i = 0; i < 100; i++) {
+		a.Push(i, double(99 - i));
+	}
+	auto b = a;
+	b.EvictThrough(49);
+	EXPECT_EQ(100u, a.Size());
+	EXPECT_EQ(50u, b.Size());
+	EXPECT_DOUBLE_EQ(99., a.Max());
+	EXPECT_DOUBLE_EQ(49., b.Max());
+}
+
+// models a dynamic query polled at 20 Hz over a 1 s window of 240 fps frames, computing 6 stats
+// per poll: re-gathering and sorting per stat versus advancing a persistent window
+TEST(MiddlewareBenchmark, DISABLED_WindowedPercentiles)
+{
+	constexpr int frameRate = 240;
+	constexpr int pollRate = 20;
+	constexpr int windowFrames = frameRate;
+	constexpr int polls = 20'000;
+	constexpr int framesPerPoll = frameRate / pollRate;
+	const double percentiles[] = { 0.01, 0.05, 0.10, 0.90, 0.95, 0.99 };
+
+	std::mt19937_64 rng{ 1 };
+	std::normal_distribution<double> frameTime{ 4.16, 0.5 };
+	std::vector<double> frames(size_t(polls * framesPerPoll + windowFrames));
+	for (auto& f : frames) {
+		f = frameTime(rng);
+	}
+
+	const auto measure = [](auto&& f) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		f();
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	double sortSum = 0.;
+	const auto sortSeconds = measure([&] {
+		std::vector<double> gathered;
+		for (int poll = 0; poll < polls; poll++) {
+			const auto end = size_t(poll * framesPerPoll + windowFrames);
+			for (double p : percentiles) {
+				gathered.assign(frames.begin() + (end - windowFrames), frames.begin() + end);
+				sortSum += ReferencePercentile(gathered, p);
+			}
+		}
+	});
+
+	double windowSum = 0.;
+	const auto windowSeconds = measure([&] {
+		WindowedOrderStatistic window;
+		size_t fed = 0;
+		for (int poll = 0; poll < polls; poll++) {
+			const auto end = size_t(poll * framesPerPoll + windowFrames);
+			// frame i is stamped i + 1 so that the window is the timestamps after end - windowFrames
+			for (; fed < end; fed++) {
+				window.Push(fed + 1, frames[fed]);
+			}
+			window.EvictThrough(end - windowFrames);
+			for (double p : percentiles) {
+				windowSum += window.Percentile(p);
+			}
+		}
+	});
+
+	EXPECT_NEAR(sortSum, windowSum, 1e-6 * std::abs(sortSum));
+	std::cout << "Windowed percentiles polls/sec: gather+sort=" << polls / sortSeconds
+		<< " incremental window=" << polls / windowSeconds << std::endl;
+}
@@ -0,0 +1,503 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#include "CaptureFile.hpp"
+
+#include <windows.h>
+#include <io.h>
+#include <share.h>
+#include <string.h>
+
+namespace {
+
+constexpr uint32_t CAPTURE_BLOCK_MAX_ROWS   = 4096;
+constexpr uint64_t CAPTURE_BLOCK_MAX_AGE_MS = 1000;
+
+enum CaptureColumnEncoding : uint8_t {
+    RAW_ENCODING,           // Fixed-width values
+    DELTA_VARINT_ENCODING,  // Zig-zag varint of the difference from the previous value
+};
+
+uint32_t GetFixedWidth(CaptureColumnType type)
+{
+    switch (type) {
+    case CaptureColumnType::String:
+    case CaptureColumnType::Int32:
+    case CaptureColumnType::UInt32: return 4;
+    default:                        return 8;
+    }
+}
+
+uint32_t Fnv1a(uint8_t const* data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void Append(std::vector<uint8_t>* buffer, void const* data, size_t size)
+{
+    auto p = (uint8_t const*) data;
+    buffer->insert(buffer->end(), p, p + size);
+}
+
+void AppendVarint(std::vector<uint8_t>* buffer, uint64_t value)
+{
+    while (value >= 0x80) {
+        buffer->push_back((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+    buffer->push_back((uint8_t) value);
+}
+
+size_t VarintSize(uint64_t value)
+{
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size += 1;
+    }
+    return size;
+}
+
+uint64_t ZigZag(uint64_t delta)
+{
+    return (delta << 1) ^ (uint64_t) ((int64_t) delta >> 63);
+}
+
+uint64_t UnZigZag(uint64_t value)
+{
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+// Bounds-checked reads from a block payload.
+struct PayloadReader {
+    uint8_t const* mData;
+    size_t mSize;
+    size_t mOffset = 0;
+
+    bool Read(void* data, size_t size)
+    {
+        if (mSize - mOffset < size) return false;
+        memcpy(data, mData + mOffset, size);
+        mOffset += size;
+        return true;
+    }
+
+    bool ReadVarint(uint64_t* value)
+    {
+        *value = 0;
+        for (uint32_t shift = 0; shift < 64; shift += 7) {
+            if (mOffset == mSize) return false;
+            auto b = mData[mOffset++];
+            *value |= (uint64_t) (b & 0x7f) << shift;
+            if ((b & 0x80) == 0) return true;
+        }
+        return false;
+    }
+};
+
+}
+
+CaptureFileWriter::~CaptureFileWriter()
+{
+    Close();
+}
+
+bool CaptureFileWriter::Open(
+    wchar_t const* path,
+    std::vector<CaptureColumn> const& columns,
+    uint64_t timestampFrequency,
+    uint64_t startTimestamp,
+    uint64_t startFileTime)
+{
+    Close();
+
+    // Allow other processes to read the file while it is being written.
+    mFile = _wfsopen(path, L"wb", _SH_DENYWR);
+    if (mFile == nullptr) {
+        return false;
+    }
+
+    CaptureFileHeader header = {};
+    header.Magic = CAPTURE_FILE_MAGIC;
+    header.Version = CAPTURE_FILE_VERSION;
+    header.ColumnCount = (uint32_t) columns.size();
+    header.TimestampFrequency = timestampFrequency;
+    header.StartTimestamp = startTimestamp;
+    header.StartFileTime = startFileTime;
+
+    mBlock.clear();
+    Append(&mBlock, &header, sizeof(header));
+    for (auto const& column : columns) {
+        CaptureColumnHeader columnHeader = {};
+        columnHeader.Type = (uint8_t) column.Type;
+        columnHeader.Precision = column.Precision;
+        columnHeader.NameLength = (uint16_t) column.Name.size();
+        Append(&mBlock, &columnHeader, sizeof(columnHeader));
+        Append(&mBlock, column.Name.data(), columnHeader.NameLength * sizeof(wchar_t));
+    }
+
+    if (fwrite(mBlock.data(), mBlock.size(), 1, mFile) != 1 || fflush(mFile) != 0) {
+        fclose(mFile);
+        mFile = nullptr;
+        return false;
+    }
+
+    mColumns = columns;
+    mValues.clear();
+    mValues.resize(columns.size());
+    for (auto& values : mValues) {
+        values.reserve(CAPTURE_BLOCK_MAX_ROWS);
+    }
+    mStringIndex.clear();
+    mNewStrings.clear();
+    mLastString.assign(columns.size(), { nullptr, 0 });
+    mRowCount = 0;
+    mBlockRowCount = 0;
+    mNextColumn = 0;
+    mWriteFailed = false;
+    return true;
+}
+
+void CaptureFileWriter::Push(uint64_t value)
+{
+    mValues[mNextColumn].push_back(value);
+    mNextColumn += 1;
+}
+
+void CaptureFileWriter::PushString(std::wstring_view value)
+{
+    // Most string columns repeat the previous row's value, so check that before looking up the
+    // string table.
+    auto& last = mLastString[mNextColumn];
+    if (last.first == nullptr || *last.first != value) {
+        auto ii = mStringIndex.find(std::wstring(value));
+        if (ii == mStringIndex.end()) {
+            ii = mStringIndex.emplace(value, (uint32_t) mStringIndex.size()).first;
+            mNewStrings.push_back(&ii->first);
+        }
+        last.first = &ii->first;
+        last.second = ii->second;
+    }
+    Push(last.second);
+}
+
+void CaptureFileWriter::PushDouble(double value)
+{
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    Push(bits);
+}
+
+void CaptureFileWriter::EndRow()
+{
+    mNextColumn = 0;
+    mRowCount += 1;
+    mBlockRowCount += 1;
+
+    auto tick = GetTickCount64();
+    if (mBlockRowCount == 1) {
+        mBlockStartTick = tick;
+    }
+    if (mBlockRowCount == CAPTURE_BLOCK_MAX_ROWS || tick - mBlockStartTick >= CAPTURE_BLOCK_MAX_AGE_MS) {
+        Flush();
+    }
+}
+
+bool CaptureFileWriter::Flush()
+{
+    if (mFile == nullptr || mBlockRowCount == 0) {
+        return !mWriteFailed;
+    }
+    if (mWriteFailed) {
+        ClearBlock();
+        return false;
+    }
+
+    mBlock.resize(sizeof(CaptureBlockHeader));
+
+    auto newStringCount = (uint32_t) mNewStrings.size();
+    Append(&mBlock, &newStringCount, sizeof(newStringCount));
+    for (auto s : mNewStrings) {
+        auto length = (uint32_t) s->size();
+        Append(&mBlock, &length, sizeof(length));
+        Append(&mBlock, s->data(), length * sizeof(wchar_t));
+    }
+
+    for (size_t i = 0, n = mColumns.size(); i < n; ++i) {
+        auto const& values = mValues[i];
+        auto width = GetFixedWidth(mColumns[i].Type);
+
+        // Use the delta encoding for integer columns if it is smaller.
+        auto encoding = RAW_ENCODING;
+        if (mColumns[i].Type != CaptureColumnType::Double) {
+            size_t deltaSize = 0;
+            uint64_t prev = 0;
+            for (auto value : values) {
+                deltaSize += VarintSize(ZigZag(value - prev));
+                prev = value;
+            }
+            if (deltaSize < values.size() * width) {
+                encoding = DELTA_VARINT_ENCODING;
+            }
+        }
+
+        mBlock.push_back(encoding);
+        auto sizeOffset = mBlock.size();
+        mBlock.resize(sizeOffset + sizeof(uint32_t));
+
+        if (encoding == DELTA_VARINT_ENCODING) {
+            uint64_t prev = 0;
+            for (auto value : values) {
+                AppendVarint(&mBlock, ZigZag(value - prev));
+                prev = value;
+            }
+        } else {
+            for (auto value : values) {
+                Append(&mBlock, &value, width);
+            }
+        }
+
+        auto columnSize = (uint32_t) (mBlock.size() - sizeOffset - sizeof(uint32_t));
+        memcpy(mBlock.data() + sizeOffset, &columnSize, sizeof(columnSize));
+    }
+
+    CaptureBlockHeader header = {};
+    header.Magic = CAPTURE_BLOCK_MAGIC;
+    header.RowCount = mBlockRowCount;
+    header.PayloadSize = (uint32_t) (mBlock.size() - sizeof(header));
+    header.Checksum = Fnv1a(mBlock.data() + sizeof(header), header.PayloadSize);
+    memcpy(mBlock.data(), &header, sizeof(header));
+
+    // Write the whole block at once and flush it, so that readers see either nothing or the
+    // complete block once the write finishes.  If part of a block was written, its checksum no
+    // longer matches and readers stop at the previous block; later blocks would not be reached,
+    // so they aren't written.
+    if (fwrite(mBlock.data(), mBlock.size(), 1, mFile) != 1 || fflush(mFile) != 0) {
+        mWriteFailed = true;
+    }
+
+    ClearBlock();
+    return !mWriteFailed;
+}
+
+void CaptureFileWriter::ClearBlock()
+{
+    for (auto& values : mValues) {
+        values.clear();
+    }
+    mNewStrings.clear();
+    mBlockRowCount = 0;
+}
+
+bool CaptureFileWriter::Close()
+{
+    auto ok = true;
+    if (mFile != nullptr) {
+        ok = Flush();
+        if (fclose(mFile) != 0) {
+            ok = false;
+        }
+        mFile = nullptr;
+    }
+    return ok;
+}
+
+CaptureFileReader::~CaptureFileReader()
+{
+    Close();
+}
+
+bool CaptureFileReader::Open(wchar_t const* path)
+{
+    Close();
+
+    mFile = _wfsopen(path, L"rb", _SH_DENYNO);
+    if (mFile == nullptr) {
+        return false;
+    }
+
+    if (fread(&mHeader, sizeof(mHeader), 1, mFile) != 1 ||
+        mHeader.Magic != CAPTURE_FILE_MAGIC ||
+        mHeader.Version != CAPTURE_FILE_VERSION ||
+        mHeader.ColumnCount > GetRemainingSize() / sizeof(CaptureColumnHeader)) {
+        Close();
+        return false;
+    }
+
+    mColumns.resize(mHeader.ColumnCount);
+    for (auto& column : mColumns) {
+        CaptureColumnHeader columnHeader = {};
+        if (fread(&columnHeader, sizeof(columnHeader), 1, mFile) != 1 ||
+            columnHeader.Type > (uint8_t) CaptureColumnType::LocalFileTime) {
+            Close();
+            return false;
+        }
+        column.Name.resize(columnHeader.NameLength);
+        if (columnHeader.NameLength > 0 &&
+            fread(column.Name.data(), columnHeader.NameLength * sizeof(wchar_t), 1, mFile) != 1) {
+            Close();
+            return false;
+        }
+        column.Type = (CaptureColumnType) columnHeader.Type;
+        column.Precision = columnHeader.Precision;
+    }
+
+    mValues.resize(mColumns.size());
+    return true;
+}
+
+void CaptureFileReader::Close()
+{
+    if (mFile != nullptr) {
+        fclose(mFile);
+        mFile = nullptr;
+    }
+    mHeader = {};
+    mColumns.clear();
+    mStrings.clear();
+    mValues.clear();
+    mRowCount = 0;
+}
+
+bool CaptureFileReader::ReadBlock()
+{
+    mRowCount = 0;
+    if (mFile == nullptr) {
+        return false;
+    }
+
+    // If the block isn't complete, return to its start so that it can be read once the writer
+    // finishes it.
+    auto blockOffset = _ftelli64(mFile);
+
+    // The payload size is checked against what is left of the file before allocating for it, so
+    // that a corrupt header can't cause a huge allocation.  A block that is still being written
+    // is also larger than the rest of the file.
+    CaptureBlockHeader header = {};
+    if (fread(&header, sizeof(header), 1, mFile) == 1 && header.Magic == CAPTURE_BLOCK_MAGIC &&
+        header.PayloadSize <= GetRemainingSize()) {
+        mPayload.resize(header.PayloadSize);
+        if ((header.PayloadSize == 0 || fread(mPayload.data(), header.PayloadSize, 1, mFile) == 1) &&
+            Fnv1a(mPayload.data(), mPayload.size()) == header.Checksum &&
+            DecodeBlock(header.RowCount)) {
+            return true;
+        }
+    }
+
+    clearerr(mFile);
+    _fseeki64(mFile, blockOffset, SEEK_SET);
+    return false;
+}
+
+uint64_t CaptureFileReader::GetRemainingSize()
+{
+    auto size = _filelengthi64(_fileno(mFile));
+    auto offset = _ftelli64(mFile);
+    return size > offset && offset >= 0 ? (uint64_t) (size - offset) : 0;
+}
+
+bool CaptureFileReader::DecodeBlock(uint32_t rowCount)
+{
+    // Every row takes at least a byte in each column.
+    if (!mColumns.empty() && rowCount > mPayload.size()) {
+        return false;
+    }
+
+    PayloadReader reader{ mPayload.data(), mPayload.size() };
+
+    auto stringCount = mStrings.size();
+
+    uint32_t newStringCount = 0;
+    if (!reader.Read(&newStringCount, sizeof(newStringCount))) {
+        return false;
+    }
+    for (uint32_t i = 0; i < newStringCount; ++i) {
+        uint32_t length = 0;
+        if (!reader.Read(&length, sizeof(length)) ||
+            length > (reader.mSize - reader.mOffset) / sizeof(wchar_t)) {
+            mStrings.resize(stringCount);
+            return false;
+        }
+        std::wstring s(length, L'\0');
+        reader.Read(s.data(), length * sizeof(wchar_t));
+        mStrings.emplace_back(std::move(s));
+    }
+
+    for (size_t i = 0, n = mColumns.size(); i < n; ++i) {
+        auto& values = mValues[i];
+        auto type = mColumns[i].Type;
+        auto width = GetFixedWidth(type);
+
+        uint8_t encoding = 0;
+        uint32_t columnSize = 0;
+        if (!reader.Read(&encoding, sizeof(encoding)) ||
+            !reader.Read(&columnSize, sizeof(columnSize)) ||
+            columnSize > reader.mSize - reader.mOffset) {
+            mStrings.resize(stringCount);
+            return false;
+        }
+
+        PayloadReader columnReader{ reader.mData + reader.mOffset, columnSize };
+        reader.mOffset += columnSize;
+
+        values.resize(rowCount);
+        uint64_t prev = 0;
+        for (auto& value : values) {
+            bool ok;
+            if (encoding == DELTA_VARINT_ENCODING) {
+                ok = columnReader.ReadVarint(&value);
+                value = prev + UnZigZag(value);
+                prev = value;
+            } else {
+                value = 0;
+                ok = encoding == RAW_ENCODING && columnReader.Read(&value, width);
+            }
+            if (!ok) {
+                mStrings.resize(stringCount);
+                return false;
+            }
+        }
+
+        // Int32 values are sign extended, and string indices must refer to a known string.
+        for (auto& value : values) {
+            if (type == CaptureColumnType::Int32) {
+                value = (uint64_t) (int64_t) (int32_t) value;
+            } else if (type == CaptureColumnType::String && value >= mStrings.size()) {
+                mStrings.resize(stringCount);
+                return false;
+            }
+        }
+    }
+
+    mRowCount = rowCount;
+    return true;
+}
+
+double CaptureFileReader::GetDouble(uint32_t column, uint32_t row) const
+{
+    double value = 0.0;
+    memcpy(&value, &mValues[column][row], sizeof(value));
+    return value;
+}
+
+std::wstring const& CaptureFileReader::GetString(uint32_t column, uint32_t row) const
+{
+    return mStrings[(size_t) mValues[column][row]];
+}
+
+bool IsCaptureFile(wchar_t const* path)
+{
+    auto fp = _wfsopen(path, L"rb", _SH_DENYNO);
+    if (fp == nullptr) {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    auto isCaptureFile = fread(&magic, sizeof(magic), 1, fp) == 1 && magic == CAPTURE_FILE_MAGIC;
+    fclose(fp);
+    return isCaptureFile;
+}
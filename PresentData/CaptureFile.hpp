@@ -0,0 +1,173 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// -------------------------------------------------------------------------------------------------
+// Capture files
+//
+// A capture file is a binary, column-oriented alternative to the CSV output: each row holds one
+// value per column, and every column has a fixed type.  The file is a CaptureFileHeader and the
+// column descriptors, followed by a sequence of self-contained blocks of rows:
+//
+//     CaptureFileHeader
+//     CaptureColumnHeader + Name[NameLength]          (x ColumnCount)
+//     CaptureBlockHeader + payload                    (repeated)
+//
+// A block's payload holds the strings first referenced by the block's rows (appended to the file's
+// string table), then each column's values stored contiguously.  Integer columns are delta/varint
+// encoded when that is smaller than their fixed width, so that slowly-changing values like
+// timestamps, process ids, and swap chain addresses mostly take a byte per row.
+//
+// The writer only ever appends whole blocks and flushes after each one, and each block carries a
+// checksum of its payload.  So, if the writer is terminated the file is still readable up to the
+// last complete block, and a reader can consume blocks while the file is still being written (see
+// CaptureFileReader::ReadBlock()).
+//
+// All values are stored little-endian.
+
+#define CAPTURE_FILE_MAGIC    0x50434D50u // 'PMCP'
+#define CAPTURE_FILE_VERSION  1u
+#define CAPTURE_BLOCK_MAGIC   0x4B4C4250u // 'PBLK'
+
+enum class CaptureColumnType : uint8_t {
+    String,         // Index into the string table (4 bytes)
+    Int32,
+    UInt32,
+    UInt64,
+    Hex64,          // UInt64 displayed as hexadecimal
+    Double,         // NaN represents no value (e.g., 'NA' in the CSV)
+    LocalFileTime,  // FILETIME in local time
+};
+
+struct CaptureColumn {
+    std::wstring Name;
+    CaptureColumnType Type;
+    uint8_t Precision;  // Number of decimal places to display (Double columns only)
+};
+
+struct CaptureFileHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t ColumnCount;
+    uint32_t Reserved;
+    uint64_t TimestampFrequency;    // QPC frequency of the captured timestamps
+    uint64_t StartTimestamp;        // Trace start timestamp
+    uint64_t StartFileTime;         // Trace start time (FILETIME)
+};
+
+struct CaptureColumnHeader {
+    uint8_t Type;                   // CaptureColumnType
+    uint8_t Precision;
+    uint16_t NameLength;            // Number of UTF-16 characters that follow
+};
+
+struct CaptureBlockHeader {
+    uint32_t Magic;
+    uint32_t RowCount;
+    uint32_t PayloadSize;           // Bytes that follow the header
+    uint32_t Checksum;              // FNV-1a hash of the payload
+};
+
+// CaptureFileWriter buffers rows and appends them to a capture file one block at a time.  A block
+// is written once it holds CAPTURE_BLOCK_MAX_ROWS rows, or when a row is added more than
+// CAPTURE_BLOCK_MAX_AGE_MS after the block's first row so that readers following a live capture
+// don't fall too far behind.
+class CaptureFileWriter {
+    FILE* mFile = nullptr;
+    std::vector<CaptureColumn> mColumns;
+    std::vector<std::vector<uint64_t>> mValues;  // [column][row]
+    std::unordered_map<std::wstring, uint32_t> mStringIndex;
+    std::vector<std::wstring const*> mNewStrings;
+    std::vector<std::pair<std::wstring const*, uint32_t>> mLastString;  // [column]
+    std::vector<uint8_t> mBlock;
+    uint64_t mBlockStartTick = 0;
+    uint64_t mRowCount = 0;
+    uint32_t mBlockRowCount = 0;
+    uint32_t mNextColumn = 0;
+    bool mWriteFailed = false;
+
+    void Push(uint64_t value);
+    void ClearBlock();
+
+public:
+    CaptureFileWriter() = default;
+    ~CaptureFileWriter();
+
+    CaptureFileWriter(const CaptureFileWriter&) = delete;
+    CaptureFileWriter& operator=(const CaptureFileWriter&) = delete;
+
+    // The file is opened so that it can be read by other processes while it is being written.
+    bool Open(wchar_t const* path, std::vector<CaptureColumn> const& columns,
+              uint64_t timestampFrequency, uint64_t startTimestamp, uint64_t startFileTime);
+
+    // Returns false if any block could not be written (see Flush()).
+    bool Close();
+
+    // Add the value of the next column to the current row; call EndRow() once every column's value
+    // has been added.  PushInteger() is used for all the integer types (including String columns'
+    // indices, though PushString() is usually more convenient).
+    void PushString(std::wstring_view value);
+    void PushInteger(uint64_t value) { Push(value); }
+    void PushDouble(double value);
+    void EndRow();
+
+    // Write any buffered rows as a block.  Returns false if the block could not be written (e.g.,
+    // because the disk is full).  Once a write has failed no further blocks are written, so that
+    // the file stays readable up to the last complete block, and subsequent rows are discarded.
+    bool Flush();
+
+    bool IsOpen() const { return mFile != nullptr; }
+    bool HasWriteFailed() const { return mWriteFailed; }
+    uint64_t GetRowCount() const { return mRowCount; }
+};
+
+// CaptureFileReader reads a capture file one block at a time.
+class CaptureFileReader {
+    FILE* mFile = nullptr;
+    CaptureFileHeader mHeader = {};
+    std::vector<CaptureColumn> mColumns;
+    std::vector<std::wstring> mStrings;
+    std::vector<std::vector<uint64_t>> mValues;  // [column][row] of the current block
+    std::vector<uint8_t> mPayload;
+    uint32_t mRowCount = 0;
+
+    bool DecodeBlock(uint32_t rowCount);
+    uint64_t GetRemainingSize();
+
+public:
+    CaptureFileReader() = default;
+    ~CaptureFileReader();
+
+    CaptureFileReader(const CaptureFileReader&) = delete;
+    CaptureFileReader& operator=(const CaptureFileReader&) = delete;
+
+    // Returns false if the file cannot be opened or is not a compatible capture file.
+    bool Open(wchar_t const* path);
+    void Close();
+
+    CaptureFileHeader const& GetHeader() const { return mHeader; }
+    std::vector<CaptureColumn> const& GetColumns() const { return mColumns; }
+
+    // Read the next block, replacing the current one.  Returns false if there is no complete block
+    // to read, either because the end of the file was reached or because the next block has not
+    // been completely written yet.  In the latter case, ReadBlock() can be called again later to
+    // continue from the same place.
+    bool ReadBlock();
+
+    // Access the current block's values.
+    uint32_t GetRowCount() const { return mRowCount; }
+    uint64_t GetInteger(uint32_t column, uint32_t row) const { return mValues[column][row]; }
+    double GetDouble(uint32_t column, uint32_t row) const;
+    std::wstring const& GetString(uint32_t column, uint32_t row) const;
+};
+
+// Returns true if the file at path starts with a capture file header.
+bool IsCaptureFile(wchar_t const* path);
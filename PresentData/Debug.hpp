@@ -2,10 +2,14 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 #include <stdint.h>
+#ifdef _WIN32
 #include "../IntelPresentMon/CommonUtilities/log/Log.h"
+#else
+#include <assert.h> // Replay-only builds have no logging; asserts go to assert()
+#endif
 
 #ifndef PRESENTMON_ENABLE_DEBUG_TRACE
-#ifdef NDEBUG
+#if defined(NDEBUG) || !defined(_WIN32)
 #define PRESENTMON_ENABLE_DEBUG_TRACE 0
 #else
 #define PRESENTMON_ENABLE_DEBUG_TRACE 1
@@ -44,7 +48,11 @@ void VerboseTraceEventImpl(PMTraceConsumer* pmConsumer, _EVENT_RECORD* eventReco
 // When PRESENTMON_ENABLE_DEBUG_TRACE==0, all of the the verbose trace infrastructure should
 // get optimized away.
 #define IsVerboseTraceEnabled() false
+#ifdef _WIN32
 #define DebugAssert(condition) !!(condition) || pmlog_warn("PresentData Assert Failed: "#condition)
+#else
+#define DebugAssert(condition) (assert(condition), true)
+#endif
 #define VerboseTraceBeforeModifyingPresent(p)
 #define VerboseTraceEvent(c, e, m)
 
@@ -0,0 +1,156 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#include "PresentMonTraceConsumer.hpp"
+#include "DecodedEvent.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+namespace {
+
+constexpr size_t DECODED_EVENT_BUFFER_SIZE = 4096; // records
+
+FILE* OpenDecodedEventFile(wchar_t const* path, bool write)
+{
+#ifdef _WIN32
+    FILE* fp = nullptr;
+    return _wfopen_s(&fp, path, write ? L"wb" : L"rb") == 0 ? fp : nullptr;
+#else
+    // Replay-only builds: convert the path using the current locale.
+    size_t n = wcstombs(nullptr, path, 0);
+    if (n == (size_t) -1) {
+        return nullptr;
+    }
+    std::string narrowPath(n, '\0');
+    wcstombs(narrowPath.data(), path, n + 1);
+    return fopen(narrowPath.c_str(), write ? "wb" : "rb");
+#endif
+}
+
+}
+
+DecodedEvent MakeDecodedEvent(DecodedEventType type, uint64_t timestamp, uint32_t processId, uint32_t threadId)
+{
+    DecodedEvent event;
+    memset(&event, 0, sizeof(event));
+    event.TimeStamp = timestamp;
+    event.ProcessId = processId;
+    event.ThreadId = threadId;
+    event.Type = type;
+    return event;
+}
+
+DecodedEventWriter::~DecodedEventWriter()
+{
+    Close();
+}
+
+bool DecodedEventWriter::Open(wchar_t const* path, uint64_t timestampFrequency, uint64_t startTimestamp, uint64_t startFileTime)
+{
+    Close();
+
+    mFile = OpenDecodedEventFile(path, true);
+    if (mFile == nullptr) {
+        return false;
+    }
+
+    DecodedEventFileHeader header = {};
+    header.Magic = DECODED_EVENT_FILE_MAGIC;
+    header.Version = DECODED_EVENT_FILE_VERSION;
+    header.RecordSize = sizeof(DecodedEvent);
+    header.TimestampFrequency = timestampFrequency;
+    header.StartTimestamp = startTimestamp;
+    header.StartFileTime = startFileTime;
+    if (fwrite(&header, sizeof(header), 1, mFile) != 1) {
+        fclose(mFile);
+        mFile = nullptr;
+        return false;
+    }
+
+    mBuffer.reserve(DECODED_EVENT_BUFFER_SIZE);
+    mRecordCount = 0;
+    return true;
+}
+
+void DecodedEventWriter::Write(DecodedEvent const& event)
+{
+    mBuffer.push_back(event);
+    if (mBuffer.size() == DECODED_EVENT_BUFFER_SIZE) {
+        Flush();
+    }
+}
+
+void DecodedEventWriter::Flush()
+{
+    if (mFile != nullptr && !mBuffer.empty()) {
+        mRecordCount += fwrite(mBuffer.data(), sizeof(DecodedEvent), mBuffer.size(), mFile);
+    }
+    mBuffer.clear();
+}
+
+void DecodedEventWriter::Close()
+{
+    if (mFile != nullptr) {
+        Flush();
+        fclose(mFile);
+        mFile = nullptr;
+    }
+}
+
+DecodedEventReader::~DecodedEventReader()
+{
+    Close();
+}
+
+bool DecodedEventReader::Open(wchar_t const* path)
+{
+    Close();
+
+    mFile = OpenDecodedEventFile(path, false);
+    if (mFile == nullptr) {
+        return false;
+    }
+
+    if (fread(&mHeader, sizeof(mHeader), 1, mFile) != 1 ||
+        mHeader.Magic != DECODED_EVENT_FILE_MAGIC ||
+        mHeader.Version != DECODED_EVENT_FILE_VERSION ||
+        mHeader.RecordSize != sizeof(DecodedEvent)) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void DecodedEventReader::Close()
+{
+    if (mFile != nullptr) {
+        fclose(mFile);
+        mFile = nullptr;
+    }
+    mHeader = {};
+}
+
+size_t DecodedEventReader::Read(DecodedEvent* events, size_t maxCount)
+{
+    return mFile == nullptr ? 0 : fread(events, sizeof(DecodedEvent), maxCount, mFile);
+}
+
+uint64_t ReplayDecodedEvents(DecodedEventReader* reader, PMTraceConsumer* pmConsumer)
+{
+    std::vector<DecodedEvent> events(DECODED_EVENT_BUFFER_SIZE);
+    uint64_t replayedCount = 0;
+    for (;;) {
+        auto count = reader->Read(events.data(), events.size());
+        if (count == 0) {
+            break;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            pmConsumer->HandleDecodedEvent(events[i]);
+        }
+        replayedCount += count;
+    }
+    return replayedCount;
+}
@@ -0,0 +1,354 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+struct PMTraceConsumer;
+
+// DecodedEvent is the intermediate representation of a provider event after TDH decoding: a
+// fixed-size POD record holding just the fields that the present-tracking state machine reads.
+//
+// Every PMTraceConsumer provider handler (process, D3D9, DXGI, DxgKrnl including the Win7 MOF
+// events, Win32K, DWM, Intel-PresentMon, NVIDIA display driver, and the PC latency TraceLogging
+// events) decodes each EVENT_RECORD into one or more DecodedEvents and then applies them with
+// PMTraceConsumer::HandleDecodedEvent(), so the tracking logic can be driven without ETW or TDH.
+// Events are decoded after the consumer's filtering (tracked process ids, mTrackDisplay,
+// mTrackGPU, mTrackInput, etc.), so a recorded stream reflects the configuration of the consumer
+// that recorded it.
+//
+// The layout only uses fixed-width fields with no Windows types and no pointers, so recorded
+// streams (see DecodedEventWriter) are independent of the platform/bitness that produced them.
+enum class DecodedEventType : uint16_t {
+    None = 0,
+
+    // Microsoft_Windows_D3D9 and Microsoft_Windows_DXGI
+    RuntimePresentStart,            // Present_Start, PresentMultiplaneOverlay_Start
+    RuntimePresentStop,             // Present_Stop, PresentMultiplaneOverlay_Stop
+    DxgiHybridPresentMode,          // SwapChain_Start, ResizeBuffers_Start
+
+    // Microsoft_Windows_DxgKrnl (and Win7 equivalents) used for display tracking
+    DxgkPresentHistoryStart,        // PresentHistory_Start, PresentHistoryDetailed_Start
+    DxgkPresentHistoryInfo,         // PresentHistory_Info
+    DxgkFlip,                       // Flip_Info
+    DxgkIndependentFlip,            // IndependentFlip_Info
+    DxgkFlipMPO,                    // FlipMultiPlaneOverlay_Info
+    DxgkQueueSubmit,                // QueuePacket_Start, QueuePacket_Start_2
+    DxgkQueueComplete,              // QueuePacket_Stop
+    DxgkMMIOFlip,                   // MMIOFlip_Info
+    DxgkMMIOFlipMPO,                // MMIOFlipMultiPlaneOverlay_Info
+    DxgkSyncDPC,                    // VSyncDPC_Info
+    DxgkSyncDPCMPO,                 // VSyncDPCMultiPlane_Info, HSyncDPCMultiPlane_Info (one per flip entry)
+    DxgkPresent,                    // Present_Info
+    DxgkBlt,                        // Blit_Info
+    DxgkBlitCancel,                 // BlitCancel_Info
+
+    // Microsoft_Windows_DxgKrnl used for frame type tracking
+    DxgkMMIOFlipMPO3,               // MMIOFlipMultiPlaneOverlay3_Info
+    DxgkMMIOFlipMPO3Plane,          // Continuation of DxgkMMIOFlipMPO3, one per plane
+
+    // Microsoft_Windows_DxgKrnl used for GPU tracking
+    DxgkRegisterDevice,             // Device_Start, Device_DCStart, AdapterAllocation_*
+    DxgkUnregisterDevice,           // Device_Stop
+    DxgkRegisterContext,            // Context_Start, Context_DCStart
+    DxgkUnregisterContext,          // Context_Stop
+    DxgkRegisterHwQueue,            // HwQueue_Start, HwQueue_DCStart
+    DxgkNodeMetadata,               // NodeMetadata_Info
+    DxgkDmaPacketStart,             // DmaPacket_Start
+    DxgkDmaPacketComplete,          // DmaPacket_Info
+
+    // Microsoft_Windows_Win32k
+    Win32kTokenCompositionSurfaceObject,    // TokenCompositionSurfaceObject_Info
+    Win32kTokenStateChanged,                // TokenStateChanged_Info
+
+    // Microsoft_Windows_Dwm_Core
+    DwmGetPresentHistory,           // MILEVENT_MEDIA_UCE_PROCESSPRESENTHISTORY_GetPresentHistory_Info
+    DwmSchedulePresentStart,        // SCHEDULE_PRESENT_Start
+    DwmFlipChain,                   // FlipChain_Pending, FlipChain_Complete, FlipChain_Dirty
+    DwmScheduleSurfaceUpdate,       // SCHEDULE_SURFACEUPDATE_Info
+
+    // Microsoft_Windows_Kernel_Process and NT_Process
+    ProcessStart,                   // ProcessStart_Start, NT_Process start/DC start
+    ProcessImageName,               // Continuation of ProcessStart holding part of the image name
+    ProcessStop,                    // ProcessStop_Stop, NT_Process end/DC end
+
+    // Microsoft_Windows_Win32k used for input tracking
+    Win32kInputDeviceRead,          // InputDeviceRead_Stop
+    Win32kRetrieveInputMessage,     // RetrieveInputMessage_Info
+    Win32kInputXformUpdate,         // OnInputXformUpdate_Info
+
+    // Intel_PresentMon
+    IntelPresentFrameType,          // PresentFrameType_Info
+    IntelFlipFrameType,             // FlipFrameType_Info
+    IntelAppTiming,                 // AppSleepStart_Info ... AppInputSample_Info
+
+    // NVIDIA display driver
+    NvidiaFlipRequest,              // FlipRequest
+
+    // PCLStats and ReflexStats TraceLogging events
+    PclMarker,                      // PCLStatsEvent, ReflexStatsEvent
+    PclInput,                       // PCLStatsInput, ReflexStatsInput
+    PclShutdown,                    // PCLStatsShutdown, ReflexStatsShutdown
+
+    Count
+};
+
+struct DecodedEvent {
+    uint64_t TimeStamp;
+    uint32_t ProcessId;
+    uint32_t ThreadId;
+    DecodedEventType Type;
+    uint16_t Reserved0;
+    uint32_t Reserved1;
+
+    struct RuntimePresentStartData {
+        uint64_t SwapChainAddress;
+        uint32_t Runtime;           // Runtime
+        uint32_t PresentFlags;      // DXGI_PRESENT_* flags
+        int32_t SyncInterval;
+    };
+    struct RuntimePresentStopData {
+        uint32_t Runtime;           // Runtime
+        uint32_t Result;
+    };
+    struct DxgiHybridPresentModeData {
+        uint64_t SwapChainAddress;
+        uint32_t HybridPresentMode;
+    };
+    struct DxgkPresentHistoryStartData {
+        uint64_t Token;
+        uint64_t TokenData;
+        uint32_t Model;             // Microsoft_Windows_DxgKrnl::PresentModel
+    };
+    struct DxgkTokenData {
+        uint64_t Token;
+    };
+    struct DxgkFlipData {
+        uint32_t FlipInterval;
+        uint8_t MMIOFlip;
+    };
+    struct DxgkIndependentFlipData {
+        uint32_t SubmitSequence;
+        uint32_t FlipInterval;
+    };
+    struct DxgkFlipMPOData {
+        uint32_t VidPnSourceId;
+        uint32_t LayerIndex;
+    };
+    struct DxgkQueuePacketData {
+        uint64_t hContext;
+        uint32_t SubmitSequence;
+        uint32_t PacketType;        // Microsoft_Windows_DxgKrnl::QueuePacketType
+        uint8_t Present;
+        uint8_t Win7;
+    };
+    struct DxgkMMIOFlipData {
+        uint32_t SubmitSequence;
+        uint32_t Flags;
+    };
+    struct DxgkMMIOFlipMPOData {
+        uint32_t SubmitSequence;
+        uint32_t FlipEntryStatusAfterFlip;  // Microsoft_Windows_DxgKrnl::FlipEntryStatus
+        uint8_t FlipEntryStatusAfterFlipValid;
+    };
+    struct DxgkMMIOFlipMPO3Data {
+        uint64_t PresentId;         // DxgkMMIOFlipMPO3Plane only
+        uint32_t LayerIndex;        // DxgkMMIOFlipMPO3Plane only
+        uint32_t VidPnSourceId;     // DxgkMMIOFlipMPO3 only
+        uint32_t FlipSubmitSequence; // DxgkMMIOFlipMPO3 only
+        uint32_t PlaneCount;        // DxgkMMIOFlipMPO3 only: number of DxgkMMIOFlipMPO3Plane records that follow
+    };
+    struct DxgkSyncDPCData {
+        uint32_t SubmitSequence;
+        uint8_t MultiPlane;
+    };
+    struct DxgkPresentData {
+        uint64_t Hwnd;
+    };
+    struct DxgkBltData {
+        uint64_t Hwnd;
+        uint8_t RedirectedPresent;
+    };
+    struct DxgkDeviceData {
+        uint64_t hDevice;
+        uint64_t pDxgAdapter;
+    };
+    struct DxgkContextData {
+        uint64_t hContext;
+        uint64_t hDevice;
+        uint32_t NodeOrdinal;
+        uint32_t ContextProcessId;  // 0 if the context was created before the trace started
+    };
+    struct DxgkHwQueueData {
+        uint64_t hContext;
+        uint64_t ParentDxgHwQueue;
+    };
+    struct DxgkNodeMetadataData {
+        uint64_t pDxgAdapter;
+        uint32_t NodeOrdinal;
+        uint32_t EngineType;        // Microsoft_Windows_DxgKrnl::DXGK_ENGINE
+    };
+    struct DxgkDmaPacketData {
+        uint64_t hContext;
+        uint32_t SequenceId;
+    };
+    struct Win32kTokenData {
+        uint64_t CompositionSurfaceLuid;
+        uint64_t PresentCount;
+        uint64_t BindId;
+        uint32_t DestWidth;         // TokenCompositionSurfaceObject_Info only
+        uint32_t DestHeight;        // TokenCompositionSurfaceObject_Info only
+        uint32_t NewState;          // TokenStateChanged_Info only (Microsoft_Windows_Win32k::TokenState)
+        uint8_t DestSizeValid;      // TokenCompositionSurfaceObject_Info only
+        uint8_t IndependentFlip;    // TokenStateChanged_Info with NewState == InFrame only
+    };
+    struct DwmFlipChainData {
+        uint64_t Hwnd;
+        uint32_t FlipChain;
+        uint32_t SerialNumber;
+    };
+    struct ProcessData {
+        uint32_t ProcessId;
+        uint32_t ImageNameLength;   // ProcessStart only: UTF-16 code units held by the ProcessImageName records that follow
+    };
+    struct ProcessImageNameData {
+        uint16_t Chars[20];         // UTF-16, the last record is padded with zeros
+    };
+    struct Win32kInputData {
+        uint64_t Hwnd;              // Win32kRetrieveInputMessage and Win32kInputXformUpdate only
+        uint64_t XformQPCTime;      // Win32kInputXformUpdate only
+        uint32_t DeviceType;        // Win32kInputDeviceRead only
+    };
+    struct IntelFrameTypeData {
+        uint64_t PresentId;         // IntelFlipFrameType only
+        uint32_t VidPnSourceId;     // IntelFlipFrameType only
+        uint32_t LayerIndex;        // IntelFlipFrameType only
+        uint32_t FrameId;           // IntelPresentFrameType only
+        uint32_t AppFrameId;        // IntelPresentFrameType only
+        uint8_t FrameType;          // Intel_PresentMon::FrameType
+    };
+    struct IntelAppTimingData {
+        uint32_t EventId;           // Intel_PresentMon event id (AppSleepStart_Info::Id, etc.)
+        uint32_t FrameId;
+        uint32_t InputType;         // AppInputSample_Info only (Intel_PresentMon::InputType)
+    };
+    struct NvidiaFlipRequestData {
+        uint64_t Alloc;
+        uint64_t Ts;
+        uint32_t VidPnSourceId;
+        uint32_t Token;
+    };
+    struct PclMarkerData {
+        uint32_t Marker;            // Nvidia_PCL::PCLMarker
+        uint32_t FrameId;
+    };
+
+    union {
+        RuntimePresentStartData     RuntimePresentStart;
+        RuntimePresentStopData      RuntimePresentStop;
+        DxgiHybridPresentModeData   DxgiHybridPresentMode;
+        DxgkPresentHistoryStartData DxgkPresentHistoryStart;
+        DxgkTokenData               DxgkPresentHistoryInfo;
+        DxgkFlipData                DxgkFlip;
+        DxgkIndependentFlipData     DxgkIndependentFlip;
+        DxgkFlipMPOData             DxgkFlipMPO;
+        DxgkQueuePacketData         DxgkQueuePacket;        // DxgkQueueSubmit and DxgkQueueComplete
+        DxgkMMIOFlipData            DxgkMMIOFlip;
+        DxgkMMIOFlipMPOData         DxgkMMIOFlipMPO;
+        DxgkMMIOFlipMPO3Data        DxgkMMIOFlipMPO3;       // DxgkMMIOFlipMPO3 and DxgkMMIOFlipMPO3Plane
+        DxgkSyncDPCData             DxgkSyncDPC;            // DxgkSyncDPC and DxgkSyncDPCMPO
+        DxgkPresentData             DxgkPresent;
+        DxgkBltData                 DxgkBlt;
+        DxgkDeviceData              DxgkDevice;             // DxgkRegisterDevice and DxgkUnregisterDevice
+        DxgkContextData             DxgkContext;            // DxgkRegisterContext and DxgkUnregisterContext
+        DxgkHwQueueData             DxgkHwQueue;
+        DxgkNodeMetadataData        DxgkNodeMetadata;
+        DxgkDmaPacketData           DxgkDmaPacket;          // DxgkDmaPacketStart and DxgkDmaPacketComplete
+        Win32kTokenData             Win32kToken;            // Win32kTokenCompositionSurfaceObject and Win32kTokenStateChanged
+        DwmFlipChainData            DwmFlipChain;
+        Win32kTokenData             DwmScheduleSurfaceUpdate;
+        ProcessData                 Process;                // ProcessStart and ProcessStop
+        ProcessImageNameData        ProcessImageName;
+        Win32kInputData             Win32kInput;            // Win32kInputDeviceRead, Win32kRetrieveInputMessage, and Win32kInputXformUpdate
+        IntelFrameTypeData          IntelFrameType;         // IntelPresentFrameType and IntelFlipFrameType
+        IntelAppTimingData          IntelAppTiming;
+        NvidiaFlipRequestData       NvidiaFlipRequest;
+        PclMarkerData               PclMarker;
+    };
+};
+
+static_assert(sizeof(DecodedEvent) == 64, "DecodedEvent is stored to file; update DECODED_EVENT_FILE_VERSION if its layout changes");
+
+// Initialize a DecodedEvent with all payload bytes zeroed, so that recorded files are
+// deterministic.
+DecodedEvent MakeDecodedEvent(DecodedEventType type, uint64_t timestamp, uint32_t processId, uint32_t threadId);
+
+// -------------------------------------------------------------------------------------------------
+// Decoded event files
+//
+// A decoded event file is a DecodedEventFileHeader followed by a packed array of little-endian
+// DecodedEvent records.
+
+#define DECODED_EVENT_FILE_MAGIC   0x52494D50u // 'PMIR'
+#define DECODED_EVENT_FILE_VERSION 3u
+
+struct DecodedEventFileHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t RecordSize;
+    uint32_t Reserved;
+    uint64_t TimestampFrequency;    // QPC frequency of the recorded timestamps (0 if unknown)
+    uint64_t StartTimestamp;        // Trace start timestamp (0 if unknown)
+    uint64_t StartFileTime;         // FILETIME of StartTimestamp (0 if unknown)
+};
+
+// DecodedEventWriter buffers records and writes them to a decoded event file.  It is used by
+// PMTraceConsumer (see mDecodedEventRecorder) on the consumer thread.
+class DecodedEventWriter {
+    FILE* mFile = nullptr;
+    std::vector<DecodedEvent> mBuffer;
+    uint64_t mRecordCount = 0;
+
+    void Flush();
+
+public:
+    DecodedEventWriter() = default;
+    ~DecodedEventWriter();
+
+    DecodedEventWriter(const DecodedEventWriter&) = delete;
+    DecodedEventWriter& operator=(const DecodedEventWriter&) = delete;
+
+    bool Open(wchar_t const* path, uint64_t timestampFrequency, uint64_t startTimestamp, uint64_t startFileTime);
+    void Write(DecodedEvent const& event);
+    void Close();
+
+    bool IsOpen() const { return mFile != nullptr; }
+    uint64_t GetRecordCount() const { return mRecordCount; }
+};
+
+class DecodedEventReader {
+    FILE* mFile = nullptr;
+    DecodedEventFileHeader mHeader = {};
+
+public:
+    DecodedEventReader() = default;
+    ~DecodedEventReader();
+
+    DecodedEventReader(const DecodedEventReader&) = delete;
+    DecodedEventReader& operator=(const DecodedEventReader&) = delete;
+
+    // Returns false if the file cannot be opened or is not a compatible decoded event file.
+    bool Open(wchar_t const* path);
+    void Close();
+
+    DecodedEventFileHeader const& GetHeader() const { return mHeader; }
+
+    // Read up to maxCount records, returning the number read (0 at end of file).
+    size_t Read(DecodedEvent* events, size_t maxCount);
+};
+
+// Apply every record of an open decoded event file to pmConsumer, in order, as if they were being
+// decoded from the original trace.  Returns the number of events replayed.
+uint64_t ReplayDecodedEvents(DecodedEventReader* reader, PMTraceConsumer* pmConsumer);
@@ -7,8 +7,10 @@
 
 namespace Intel_PresentMon {
 
+#ifdef _WIN32
 struct __declspec(uuid("{ECAA4712-4644-442F-B94C-A32F6CF8A499}")) GUID_STRUCT;
 static const auto GUID = __uuidof(GUID_STRUCT);
+#endif
 
 enum class Keyword : uint64_t {
     FrameTypes   = 0x1,
@@ -28,7 +30,7 @@ enum class Level : uint8_t {
     static uint8_t  const Level   = level_; \
     static uint8_t  const Opcode  = opcode_; \
     static uint16_t const Task    = task_; \
-    static Keyword  const Keyword = (Keyword) keyword_; \
+    static enum Keyword const Keyword = (enum Keyword) keyword_; \
 }
 
 EVENT_DESCRIPTOR_DECL(AppInputSample_Info, 0x003a, 0x00, 0x00, 0x04, 0x00, 0x003a, 0x0000000000000020);
@@ -66,7 +68,7 @@ enum class InputType : uint32_t {
 
 struct AppInputSample_Info_Props {
     uint32_t    FrameId;
-    InputType   InputType;
+    enum InputType InputType;
 };
 
 struct AppPresentEnd_Info_Props {
@@ -103,7 +105,7 @@ struct AppSleepStart_Info_Props {
 
 struct MeasuredInput_Info_Props {
     uint64_t    Time;
-    InputType   InputType;
+    enum InputType InputType;
 };
 
 struct MeasuredScreenChange_Info_Props {
@@ -114,17 +116,17 @@ struct FlipFrameType_Info_Props {
     uint32_t VidPnSourceId;
     uint32_t LayerIndex;
     uint64_t PresentId;
-    FrameType FrameType;
+    enum FrameType FrameType;
 };
 
 struct PresentFrameType_Info_Props {
     uint32_t    FrameId;
-    FrameType   FrameType;
+    enum FrameType FrameType;
 };
 
 struct PresentFrameType_Info_2_Props {
     uint32_t    FrameId;
-    FrameType   FrameType;
+    enum FrameType FrameType;
     uint32_t    AppFrameId;
 };
 
@@ -7,8 +7,10 @@
 
 namespace Microsoft_Windows_DxgKrnl {
 
+#ifdef _WIN32
 struct __declspec(uuid("{802EC45A-1E99-4B83-9920-87C98277BA9D}")) GUID_STRUCT;
 static const auto GUID = __uuidof(GUID_STRUCT);
+#endif
 
 enum class Keyword : uint64_t {
     Base                                  = 0x1,
@@ -74,7 +76,7 @@ enum class Channel : uint8_t {
     static uint8_t  const Level   = level_; \
     static uint8_t  const Opcode  = opcode_; \
     static uint16_t const Task    = task_; \
-    static Keyword  const Keyword = (Keyword) keyword_; \
+    static enum Keyword const Keyword = (enum Keyword) keyword_; \
 }
 
 EVENT_DESCRIPTOR_DECL(AdapterAllocation_DCStart      , 0x0023, 0x03, 0x11, 0x00, 0x03, 0x0015, 0x4000000000000040);
@@ -5,6 +5,7 @@
 namespace Microsoft_Windows_DxgKrnl {
 namespace Win7 {
 
+#ifdef _WIN32
 struct __declspec(uuid("{65cd4c8a-0848-4583-92a0-31c0fbaf00c0}")) GUID_STRUCT;
 struct __declspec(uuid("{069f67f2-c380-4a65-8a61-071cd4a87275}")) BLT_GUID_STRUCT;
 struct __declspec(uuid("{22412531-670b-4cd3-81d1-e709c154ae3d}")) FLIP_GUID_STRUCT;
@@ -19,6 +20,7 @@ static const auto PRESENTHISTORY_GUID = __uuidof(PRESENTHISTORY_GUID_STRUCT);
 static const auto QUEUEPACKET_GUID    = __uuidof(QUEUEPACKET_GUID_STRUCT);
 static const auto VSYNCDPC_GUID       = __uuidof(VSYNCDPC_GUID_STRUCT);
 static const auto MMIOFLIP_GUID       = __uuidof(MMIOFLIP_GUID_STRUCT);
+#endif
 
 typedef LARGE_INTEGER PHYSICAL_ADDRESS;
 
@@ -8,8 +8,10 @@
 
 namespace Microsoft_Windows_Kernel_Process {
 
+#ifdef _WIN32
 struct __declspec(uuid("{22FB2CD6-0E7B-422B-A0C7-2FAD1FD0E716}")) GUID_STRUCT;
 static const auto GUID = __uuidof(GUID_STRUCT);
+#endif
 
 enum class Keyword : uint64_t {
     WINEVENT_KEYWORD_PROCESS                          = 0x10,
@@ -42,7 +44,7 @@ enum class Channel : uint8_t {
     static uint8_t  const Level   = level_; \
     static uint8_t  const Opcode  = opcode_; \
     static uint16_t const Task    = task_; \
-    static Keyword  const Keyword = (Keyword) keyword_; \
+    static enum Keyword const Keyword = (enum Keyword) keyword_; \
 };
 
 EVENT_DESCRIPTOR_DECL(ProcessStart_Start, 0x0001, 0x03, 0x10, 0x04, 0x01, 0x0001, 0x8000000000000010)
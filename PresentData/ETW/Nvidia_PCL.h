@@ -8,8 +8,10 @@
 
 namespace Nvidia_PCL {
 
+#ifdef _WIN32
     struct __declspec(uuid("{0D216F06-82A6-4D49-BC4F-8F38AE56EFAB}")) GUID_STRUCT;
     static const auto GUID = __uuidof(GUID_STRUCT);
+#endif
 
     enum class PCLMarker : uint32_t {
         SimulationStart = 0,
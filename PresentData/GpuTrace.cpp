@@ -3,6 +3,7 @@
 
 #include "PresentMonTraceConsumer.hpp"
 
+#if PRESENTMON_ENABLE_DEBUG_TRACE
 namespace {
 
 void DebugPrintAccumulatedGpuTime(uint32_t processId, uint64_t accumulatedTime, uint64_t startTime, uint64_t endTime)
@@ -23,6 +24,9 @@ void DebugPrintAccumulatedGpuTime(uint32_t processId, uint64_t accumulatedTime,
 }
 
 }
+#else
+#define DebugPrintAccumulatedGpuTime(processId, accumulatedTime, startTime, endTime)
+#endif
 
 uint32_t GpuTrace::LookupPacketTraceProcessId(PacketTrace* packetTrace) const
 {
@@ -159,8 +163,12 @@ void GpuTrace::RegisterHwQueueContext(uint64_t hContext, uint64_t parentDxgHwQue
     node->mQueueCount = 0;
     node->mIsVideo = parentContext->mNode->mIsVideo;
 
+    // Inserting into mContexts may relocate the parent context, so read what
+    // we need from it first.
+    auto packetTrace = parentContext->mPacketTrace;
+
     auto hwQueueContext = &mContexts.emplace(parentDxgHwQueue, Context()).first->second;
-    hwQueueContext->mPacketTrace = parentContext->mPacketTrace;
+    hwQueueContext->mPacketTrace = packetTrace;
     hwQueueContext->mNode = node;
     hwQueueContext->mParentContext = hContext;
     hwQueueContext->mIsParentContext = false;
@@ -5,7 +5,8 @@
 #include <stdint.h>
 #include <unordered_map>
 
-#include "etw/Microsoft_Windows_DxgKrnl.h"
+#include "ETW/Microsoft_Windows_DxgKrnl.h"
+#include "../IntelPresentMon/CommonUtilities/FlatHashMap.h"
 
 struct PresentEvent;
 struct PMTraceConsumer;
@@ -53,9 +54,13 @@ class GpuTrace {
         PacketTrace mOtherEngines;
     };
 
-    std::unordered_map<uint64_t, std::unordered_map<uint32_t, Node> > mNodes;   // pDxgAdapter -> NodeOrdinal -> Node
-    std::unordered_map<uint64_t, uint64_t> mDevices;                            // hDevice -> pDxgAdapter
-    std::unordered_map<uint64_t, Context> mContexts;                            // hContext -> Context
+    // mContexts and mDevices are looked up for every queue/DMA packet event so
+    // they use flat tables.  Context::mNode and Context::mPacketTrace point
+    // into mNodes' inner maps and mProcessFrameInfo respectively, so those
+    // remain node-based to keep the pointers stable.
+    pmon::util::FlatHashMap<uint64_t, std::unordered_map<uint32_t, Node> > mNodes;  // pDxgAdapter -> NodeOrdinal -> Node
+    pmon::util::FlatHashMap<uint64_t, uint64_t> mDevices;                           // hDevice -> pDxgAdapter
+    pmon::util::FlatHashMap<uint64_t, Context> mContexts;                           // hContext -> Context
     std::unordered_map<uint32_t, ProcessFrameInfo> mProcessFrameInfo;           // ProcessID -> ProcessFrameInfo
     std::unordered_map<uint64_t, uint32_t> mPagingSequenceIds;                  // SequenceID -> ProcessID
 
@@ -14,56 +14,40 @@ NVTraceConsumer::~NVTraceConsumer()
     // Nothing to do
 }
 
-void NVTraceConsumer::HandleNvidiaDisplayDriverEvent(EVENT_RECORD* const pEventRecord, PMTraceConsumer* const pmConsumer)
+void NVTraceConsumer::HandleFlipRequest(uint64_t timestamp, uint32_t threadId, uint64_t alloc, uint32_t vidPnSourceId, uint64_t ts, uint32_t token)
 {
-    enum {
-        FlipRequest = 1
-    };
+    auto& lastFlipTime = mLastFlipTimeByHead[vidPnSourceId];
+    uint64_t proposedFlipTime = 0;
+    uint64_t delay = 0;
 
-    auto const& hdr = pEventRecord->EventHeader;
-    switch (hdr.EventDescriptor.Id) {
-    case FlipRequest: {
-        auto alloc = pmConsumer->mMetadata.GetEventData<uint64_t>(pEventRecord, L"alloc");
-        auto vidPnSourceId = pmConsumer->mMetadata.GetEventData<uint32_t>(pEventRecord, L"vidPnSourceId");
-        auto& lastFlipTime = mLastFlipTimeByHead[vidPnSourceId];
-        auto ts = pmConsumer->mMetadata.GetEventData<uint64_t>(pEventRecord, L"ts");
-        auto token = pmConsumer->mMetadata.GetEventData<uint32_t>(pEventRecord, L"token");
-        uint64_t proposedFlipTime = 0;
-        uint64_t delay = 0;
-
-        if (token == mLastFlipToken) {
-            return;
+    if (token == mLastFlipToken) {
+        return;
+    }
+    mLastFlipToken = token;
+
+    if (alloc == 0) {
+        assert(!delay);
+        assert(ts);
+        // proposedFlipTime in number of ticks
+        proposedFlipTime = ts;
+        auto t1 = timestamp;
+        if (proposedFlipTime >= t1) {
+            delay = proposedFlipTime - t1;
         }
-        mLastFlipToken = token;
-
-        if (alloc == 0) {
-            assert(!delay);
-            assert(ts);
-            // proposedFlipTime in number of ticks
-            proposedFlipTime = ts;
-            auto t1 = *(uint64_t*)&hdr.TimeStamp;
-            if (proposedFlipTime >= t1) {
-                delay = proposedFlipTime - t1;
-            }
 
-            if (proposedFlipTime && lastFlipTime && (proposedFlipTime < lastFlipTime)) {
-                delay = lastFlipTime - proposedFlipTime;
-                proposedFlipTime = lastFlipTime;
-            }
+        if (proposedFlipTime && lastFlipTime && (proposedFlipTime < lastFlipTime)) {
+            delay = lastFlipTime - proposedFlipTime;
+            proposedFlipTime = lastFlipTime;
         }
+    }
 
-        lastFlipTime = proposedFlipTime;
+    lastFlipTime = proposedFlipTime;
 
-        {
-            NvFlipRequest flipRequest;
-            flipRequest.FlipDelay = delay;
-            flipRequest.FlipToken = token;
-            mNvFlipRequestByThreadId.emplace(hdr.ThreadId, flipRequest);
-        }
-        break;
-    }
-    default:
-        break;
+    {
+        NvFlipRequest flipRequest;
+        flipRequest.FlipDelay = delay;
+        flipRequest.FlipToken = token;
+        mNvFlipRequestByThreadId.emplace(threadId, flipRequest);
     }
 }
 
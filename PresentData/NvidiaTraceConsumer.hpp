@@ -6,9 +6,15 @@
 #define NOMINMAX
 #endif
 
+#include <stdint.h>
 #include <unordered_map>
+#ifdef _WIN32
 #include <windows.h>
 #include <evntcons.h> // must include after windows.h
+#endif
+
+struct PMTraceConsumer;
+struct PresentEvent;
 
 struct NvFlipRequest {
     uint64_t FlipDelay;
@@ -30,7 +36,10 @@ struct NVTraceConsumer
     // vidPnSourceId -> flip qpcTime
     std::unordered_map<uint32_t, uint64_t> mLastFlipTimeByHead;
 
-    void HandleNvidiaDisplayDriverEvent(EVENT_RECORD* const pEventRecord, PMTraceConsumer* const pmConsumer);
+#ifdef _WIN32
+    void HandleNvidiaDisplayDriverEvent(EVENT_RECORD* const pEventRecord, PMTraceConsumer* const pmConsumer); // PresentMonTraceDecoder.cpp
+#endif
+    void HandleFlipRequest(uint64_t timestamp, uint32_t threadId, uint64_t alloc, uint32_t vidPnSourceId, uint64_t ts, uint32_t token);
     void ApplyFlipDelay(PresentEvent* present, uint32_t threadId);
 
     uint32_t mLastFlipToken = 0;
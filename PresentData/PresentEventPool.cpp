@@ -0,0 +1,76 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#include "PresentEventPool.hpp"
+#include "PresentMonTraceConsumer.hpp"
+
+#include <cstddef>
+
+namespace {
+
+constexpr size_t RoundUpToSlotAlignment(size_t size)
+{
+    constexpr auto alignment = alignof(std::max_align_t);
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+}
+
+void* PresentEventPool::Storage::AllocateSlot(size_t size)
+{
+    size = RoundUpToSlotAlignment(size);
+    if (mSlotSize == 0) {
+        mSlotSize = size;
+    } else if (mSlotSize != size) {
+        return nullptr;
+    }
+
+    if (mFree.empty()) {
+        // Reclaim everything that has been released since the last refill.
+        {
+            std::lock_guard<std::mutex> lock(mReturnedMutex);
+            mFree.swap(mReturned);
+        }
+
+        // If nothing has been released, carve out a new slab.
+        if (mFree.empty()) {
+            auto slab = std::make_unique<uint8_t[]>(mSlotSize * mSlotsPerSlab);
+            mFree.reserve(mSlotsPerSlab * (mSlabs.size() + 1));
+            for (uint32_t i = mSlotsPerSlab; i-- > 0; ) {
+                mFree.push_back(slab.get() + i * mSlotSize);
+            }
+            mSlabs.emplace_back(std::move(slab));
+        }
+    }
+
+    auto slot = mFree.back();
+    mFree.pop_back();
+    return slot;
+}
+
+bool PresentEventPool::Storage::ReleaseSlot(void* slot, size_t size)
+{
+    if (RoundUpToSlotAlignment(size) != mSlotSize) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mReturnedMutex);
+    mReturned.push_back(slot);
+    return true;
+}
+
+PresentEventPool::PresentEventPool(uint32_t slotsPerSlab)
+    : mStorage(std::make_shared<Storage>())
+{
+    mStorage->mSlotsPerSlab = slotsPerSlab == 0 ? 1 : slotsPerSlab;
+}
+
+std::shared_ptr<PresentEvent> PresentEventPool::Allocate()
+{
+    return std::allocate_shared<PresentEvent>(Allocator<PresentEvent>(mStorage));
+}
+
+size_t PresentEventPool::GetSlabCount() const
+{
+    return mStorage->mSlabs.size();
+}
@@ -0,0 +1,89 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+struct PresentEvent;
+
+// PresentEventPool provides slab-backed storage for the PresentEvents created by PMTraceConsumer.
+//
+// Every present observed by the consumer used to be a separate std::make_shared() allocation, which
+// at high frame rates (and with many swapchains) makes the general-purpose heap a noticeable cost on
+// the consumer thread.  Allocate() instead uses std::allocate_shared() with a pooling allocator, so
+// each PresentEvent and its shared_ptr control block occupy one fixed-size slot carved from a slab.
+//
+// A slot is recycled when the last reference to its PresentEvent is released.  That typically
+// happens on the output thread after DequeuePresentEvents(), so released slots are collected into
+// a mutex-protected return list and spliced back into the consumer thread's free list in bulk,
+// once the free list runs dry.  Slabs are sized to match the consumer's tracking ring so in steady
+// state no further slabs are needed.
+//
+// The pool storage is co-owned by every outstanding PresentEvent, so dequeued events may safely
+// outlive the PMTraceConsumer (and pool) that created them.
+class PresentEventPool {
+public:
+    struct Storage {
+        std::mutex mReturnedMutex;
+        std::vector<void*> mReturned;               // Slots released from any thread
+        std::vector<void*> mFree;                   // Slots available to the allocating thread
+        std::vector<std::unique_ptr<uint8_t[]>> mSlabs;
+        size_t mSlotSize = 0;                       // Fixed on the first allocation
+        uint32_t mSlotsPerSlab = 0;
+
+        void* AllocateSlot(size_t size);
+        bool ReleaseSlot(void* slot, size_t size);
+    };
+
+    // Minimal allocator used with std::allocate_shared(); anything other than a single
+    // slot-sized object is forwarded to the global heap.
+    template<typename T>
+    struct Allocator {
+        using value_type = T;
+
+        std::shared_ptr<Storage> mStorage;
+
+        explicit Allocator(std::shared_ptr<Storage> storage) noexcept : mStorage(std::move(storage)) {}
+        template<typename U>
+        Allocator(Allocator<U> const& other) noexcept : mStorage(other.mStorage) {}
+
+        T* allocate(size_t n)
+        {
+            if (n == 1) {
+                if (auto slot = mStorage->AllocateSlot(sizeof(T))) {
+                    return static_cast<T*>(slot);
+                }
+            }
+            return std::allocator<T>{}.allocate(n);
+        }
+        void deallocate(T* p, size_t n) noexcept
+        {
+            if (n != 1 || !mStorage->ReleaseSlot(p, sizeof(T))) {
+                std::allocator<T>{}.deallocate(p, n);
+            }
+        }
+
+        template<typename U>
+        bool operator==(Allocator<U> const& rhs) const noexcept { return mStorage == rhs.mStorage; }
+        template<typename U>
+        bool operator!=(Allocator<U> const& rhs) const noexcept { return mStorage != rhs.mStorage; }
+    };
+
+    explicit PresentEventPool(uint32_t slotsPerSlab);
+
+    PresentEventPool(const PresentEventPool&) = delete;
+    PresentEventPool& operator=(const PresentEventPool&) = delete;
+
+    // Create a new, default-constructed PresentEvent using pooled storage.  Must only be called
+    // from one thread (the consumer thread).
+    std::shared_ptr<PresentEvent> Allocate();
+
+    // Number of slabs that have been allocated so far (for diagnostics and benchmarking).
+    size_t GetSlabCount() const;
+
+private:
+    std::shared_ptr<Storage> mStorage;
+};
@@ -5,24 +5,32 @@
 #include "PresentMonTraceConsumer.hpp"
 
 #include "ETW/Intel_PresentMon.h"
-#include "ETW/Microsoft_Windows_D3D9.h"
-#include "ETW/Microsoft_Windows_Dwm_Core.h"
-#include "ETW/Microsoft_Windows_Dwm_Core_Win7.h"
 #include "ETW/Microsoft_Windows_DXGI.h"
 #include "ETW/Microsoft_Windows_DxgKrnl.h"
-#include "ETW/Microsoft_Windows_DxgKrnl_Win7.h"
-#include "ETW/Microsoft_Windows_EventMetadata.h"
-#include "ETW/Microsoft_Windows_Kernel_Process.h"
 #include "ETW/Microsoft_Windows_Win32k.h"
 #include "ETW/Nvidia_PCL.h"
 
 #include <algorithm>
 #include <assert.h>
-#include <d3d9.h>
-#include <dxgi.h>
+#include <iterator>
 #include <stdlib.h>
 #include <unordered_set>
 
+#ifdef _WIN32
+#include <d3d9.h>
+#include <dxgi.h>
+#else
+// The present flags and status codes that the present tracking checks (see d3d9.h, dxgi.h, and
+// winerror.h).
+#define FAILED(hr)                          (((int32_t) (hr)) < 0)
+#define S_PRESENT_OCCLUDED                  0x08760878U
+#define DXGI_PRESENT_TEST                   0x00000001U
+#define DXGI_PRESENT_DO_NOT_SEQUENCE        0x00000002U
+#define DXGI_STATUS_OCCLUDED                0x087A0001U
+#define DXGI_STATUS_NO_DESKTOP_ACCESS       0x087A0005U
+#define DXGI_STATUS_MODE_CHANGE_IN_PROGRESS 0x087A0008U
+#endif
+
 static uint32_t gNextFrameId = 1;
 
 static inline uint64_t GenerateVidPnLayerId(uint32_t vidPnSourceId, uint32_t layerIndex)
@@ -44,6 +52,17 @@ static inline FrameType ConvertPMPFrameTypeToFrameType(Intel_PresentMon::FrameTy
     return FrameType::Unspecified;
 }
 
+static inline InputDeviceType ConvertIntelProviderInputTypes(Intel_PresentMon::InputType ipmInputType)
+{
+    switch (ipmInputType) {
+    case Intel_PresentMon::InputType::Unspecified:   return InputDeviceType::Unknown;
+    case Intel_PresentMon::InputType::MouseClick:    return InputDeviceType::Mouse;
+    case Intel_PresentMon::InputType::KeyboardClick: return InputDeviceType::Keyboard;
+    }
+    DebugAssert(false);
+    return InputDeviceType::Unknown;
+}
+
 // Returns true if a ScreenTime has been set for this present.
 static inline bool HasScreenTime(std::shared_ptr<PresentEvent> const& p)
 {
@@ -242,120 +261,266 @@ PresentEvent::PresentEvent(uint32_t fid)
 PMTraceConsumer::PMTraceConsumer()
     : mTrackedPresents(PRESENTEVENT_CIRCULAR_BUFFER_SIZE)
     , mCompletedPresents(PRESENTEVENT_CIRCULAR_BUFFER_SIZE)
+    , mReadyPresents(PRESENTEVENT_CIRCULAR_BUFFER_SIZE)
     , mCircularBufferSize(PRESENTEVENT_CIRCULAR_BUFFER_SIZE)
+    , mPresentEventPool(PRESENTEVENT_CIRCULAR_BUFFER_SIZE)
     , mGpuTrace(this)
 {
+#ifdef _WIN32
     hEventsReadyEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+#endif
 }
 
 PMTraceConsumer::PMTraceConsumer(uint32_t circularBufferSize)
     : mTrackedPresents(circularBufferSize)
     , mCompletedPresents(circularBufferSize)
+    , mReadyPresents(circularBufferSize)
     , mCircularBufferSize(circularBufferSize)
+    , mPresentEventPool(circularBufferSize)
     , mGpuTrace(this)
 {
+#ifdef _WIN32
     hEventsReadyEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+#endif
 }
 
 PMTraceConsumer::~PMTraceConsumer()
 {
+#ifdef _WIN32
     if (hEventsReadyEvent && hEventsReadyEvent != INVALID_HANDLE_VALUE) {
         CloseHandle(hEventsReadyEvent);
     }
+#endif
 }
 
-void PMTraceConsumer::HandleD3D9Event(EVENT_RECORD* pEventRecord)
+void PMTraceConsumer::HandleDecodedEvent(DecodedEvent const& ev)
 {
-    auto const& hdr = pEventRecord->EventHeader;
-    switch (hdr.EventDescriptor.Id) {
-    case Microsoft_Windows_D3D9::Present_Start::Id:
-        if (IsProcessTrackedForFiltering(hdr.ProcessId)) {
-            EventDataDesc desc[] = {
-                { L"pSwapchain" },
-                { L"Flags" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto pSwapchain = desc[0].GetData<uint64_t>();
-            auto Flags      = desc[1].GetData<uint32_t>();
+    if (mDecodedEventRecorder != nullptr) {
+        mDecodedEventRecorder->Write(ev);
+    }
 
-            uint32_t dxgiPresentFlags = 0;
-            if (Flags & D3DPRESENT_DONOTFLIP)   dxgiPresentFlags |= DXGI_PRESENT_DO_NOT_SEQUENCE;
-            if (Flags & D3DPRESENT_DONOTWAIT)   dxgiPresentFlags |= DXGI_PRESENT_DO_NOT_WAIT;
-            if (Flags & D3DPRESENT_FLIPRESTART) dxgiPresentFlags |= DXGI_PRESENT_RESTART;
+    mCurrentEventTime = ev.TimeStamp;
 
-            int32_t syncInterval = -1;
-            if (Flags & D3DPRESENT_FORCEIMMEDIATE) {
-                syncInterval = 0;
-            }
+    switch (ev.Type) {
+    case DecodedEventType::RuntimePresentStart:
+        RuntimePresentStart((Runtime) ev.RuntimePresentStart.Runtime, ev, ev.RuntimePresentStart.SwapChainAddress,
+                            ev.RuntimePresentStart.PresentFlags, ev.RuntimePresentStart.SyncInterval);
+        break;
+    case DecodedEventType::RuntimePresentStop:
+        RuntimePresentStop((Runtime) ev.RuntimePresentStop.Runtime, ev, ev.RuntimePresentStop.Result);
+        break;
+    case DecodedEventType::DxgiHybridPresentMode:
+        HandleDxgiHybridPresentMode(ev.ProcessId, ev.DxgiHybridPresentMode.SwapChainAddress,
+                                    ev.DxgiHybridPresentMode.HybridPresentMode);
+        break;
 
-            RuntimePresentStart(Runtime::D3D9, hdr, pSwapchain, dxgiPresentFlags, syncInterval);
+    case DecodedEventType::DxgkPresentHistoryStart:
+        HandleDxgkPresentHistory(ev, ev.DxgkPresentHistoryStart.Token, ev.DxgkPresentHistoryStart.TokenData,
+                                 (Microsoft_Windows_DxgKrnl::PresentModel) ev.DxgkPresentHistoryStart.Model);
+        break;
+    case DecodedEventType::DxgkPresentHistoryInfo:
+        HandleDxgkPresentHistoryInfo(ev, ev.DxgkPresentHistoryInfo.Token);
+        break;
+    case DecodedEventType::DxgkFlip:
+        HandleDxgkFlipInfo(ev, ev.DxgkFlip.FlipInterval, ev.DxgkFlip.MMIOFlip != 0);
+        break;
+    case DecodedEventType::DxgkIndependentFlip:
+        HandleDxgkIndependentFlip(ev.DxgkIndependentFlip.SubmitSequence, ev.DxgkIndependentFlip.FlipInterval);
+        break;
+    case DecodedEventType::DxgkFlipMPO:
+        HandleDxgkFlipMPO(ev, ev.DxgkFlipMPO.VidPnSourceId, ev.DxgkFlipMPO.LayerIndex);
+        break;
+    case DecodedEventType::DxgkQueueSubmit:
+        HandleDxgkQueueSubmit(ev, ev.DxgkQueuePacket.hContext, ev.DxgkQueuePacket.SubmitSequence,
+                              ev.DxgkQueuePacket.PacketType, ev.DxgkQueuePacket.Present != 0, ev.DxgkQueuePacket.Win7 != 0);
+        break;
+    case DecodedEventType::DxgkQueueComplete:
+        HandleDxgkQueueComplete(ev.TimeStamp, ev.DxgkQueuePacket.hContext, ev.DxgkQueuePacket.SubmitSequence);
+        break;
+    case DecodedEventType::DxgkMMIOFlip:
+        HandleDxgkMMIOFlip(ev.TimeStamp, ev.DxgkMMIOFlip.SubmitSequence, ev.DxgkMMIOFlip.Flags);
+        break;
+    case DecodedEventType::DxgkMMIOFlipMPO:
+        HandleDxgkMMIOFlipMPO(ev, ev.DxgkMMIOFlipMPO.SubmitSequence, ev.DxgkMMIOFlipMPO.FlipEntryStatusAfterFlip,
+                              ev.DxgkMMIOFlipMPO.FlipEntryStatusAfterFlipValid != 0);
+        break;
+    case DecodedEventType::DxgkSyncDPC:
+        HandleDxgkSyncDPC(ev.TimeStamp, ev.DxgkSyncDPC.SubmitSequence);
+        break;
+    case DecodedEventType::DxgkSyncDPCMPO:
+        HandleDxgkSyncDPCMPO(ev.TimeStamp, ev.DxgkSyncDPC.SubmitSequence, ev.DxgkSyncDPC.MultiPlane != 0);
+        break;
+    case DecodedEventType::DxgkPresent:
+        HandleDxgkPresent(ev, ev.DxgkPresent.Hwnd);
+        break;
+    case DecodedEventType::DxgkBlt:
+        HandleDxgkBlt(ev, ev.DxgkBlt.Hwnd, ev.DxgkBlt.RedirectedPresent != 0);
+        break;
+    case DecodedEventType::DxgkBlitCancel:
+        HandleDxgkBlitCancel(ev);
+        break;
+
+    case DecodedEventType::DxgkMMIOFlipMPO3:
+        // Enable FlipFrameType events as we now know this system supports it.
+        mEnableFlipFrameTypeEvents = true;
+
+        // Lookup the present associated with this submit sequence
+        mPendingMMIOFlipMPO3Present = nullptr;
+        mPendingMMIOFlipMPO3VidPnSourceId = ev.DxgkMMIOFlipMPO3.VidPnSourceId;
+        mPendingMMIOFlipMPO3PlaneCount = ev.DxgkMMIOFlipMPO3.PlaneCount;
+        if (mPendingMMIOFlipMPO3PlaneCount > 0) {
+            mPendingMMIOFlipMPO3Present = FindPresentBySubmitSequence(ev.DxgkMMIOFlipMPO3.FlipSubmitSequence);
+            DebugAssert(mPendingMMIOFlipMPO3Present == nullptr || mPendingMMIOFlipMPO3Present->PresentIds.empty());
         }
         break;
-    case Microsoft_Windows_D3D9::Present_Stop::Id:
-        if (IsProcessTrackedForFiltering(hdr.ProcessId)) {
-            RuntimePresentStop(Runtime::D3D9, hdr, mMetadata.GetEventData<uint32_t>(pEventRecord, L"Result"));
+    case DecodedEventType::DxgkMMIOFlipMPO3Plane:
+        if (mPendingMMIOFlipMPO3PlaneCount > 0) {
+            HandleDxgkMMIOFlipMPO3Plane(mPendingMMIOFlipMPO3Present, mPendingMMIOFlipMPO3VidPnSourceId,
+                                        ev.DxgkMMIOFlipMPO3.LayerIndex, ev.DxgkMMIOFlipMPO3.PresentId);
+            if (--mPendingMMIOFlipMPO3PlaneCount == 0) {
+                mPendingMMIOFlipMPO3Present = nullptr;
+            }
         }
         break;
-    default:
-        assert(!mFilteredEvents); // Assert that filtering is working if expected
+
+    case DecodedEventType::DxgkRegisterDevice:
+        mGpuTrace.RegisterDevice(ev.DxgkDevice.hDevice, ev.DxgkDevice.pDxgAdapter);
+        break;
+    case DecodedEventType::DxgkUnregisterDevice:
+        mGpuTrace.UnregisterDevice(ev.DxgkDevice.hDevice);
+        break;
+    case DecodedEventType::DxgkRegisterContext:
+        mGpuTrace.RegisterContext(ev.DxgkContext.hContext, ev.DxgkContext.hDevice, ev.DxgkContext.NodeOrdinal,
+                                  ev.DxgkContext.ContextProcessId);
+        break;
+    case DecodedEventType::DxgkUnregisterContext:
+        mGpuTrace.UnregisterContext(ev.DxgkContext.hContext);
+        break;
+    case DecodedEventType::DxgkRegisterHwQueue:
+        mGpuTrace.RegisterHwQueueContext(ev.DxgkHwQueue.hContext, ev.DxgkHwQueue.ParentDxgHwQueue);
+        break;
+    case DecodedEventType::DxgkNodeMetadata:
+        mGpuTrace.SetEngineType(ev.DxgkNodeMetadata.pDxgAdapter, ev.DxgkNodeMetadata.NodeOrdinal,
+                                (Microsoft_Windows_DxgKrnl::DXGK_ENGINE) ev.DxgkNodeMetadata.EngineType);
+        break;
+    case DecodedEventType::DxgkDmaPacketStart:
+        mGpuTrace.EnqueueDmaPacket(ev.DxgkDmaPacket.hContext, ev.DxgkDmaPacket.SequenceId, ev.TimeStamp);
+        break;
+    case DecodedEventType::DxgkDmaPacketComplete:
+        mGpuTrace.CompleteDmaPacket(ev.DxgkDmaPacket.hContext, ev.DxgkDmaPacket.SequenceId, ev.TimeStamp);
         break;
-    }
-}
 
-void PMTraceConsumer::HandleDXGIEvent(EVENT_RECORD* pEventRecord)
-{
-    auto const& hdr = pEventRecord->EventHeader;
-    switch (hdr.EventDescriptor.Id) {
-    case Microsoft_Windows_DXGI::Present_Start::Id:
-    case Microsoft_Windows_DXGI::PresentMultiplaneOverlay_Start::Id:
-        if (IsProcessTrackedForFiltering(hdr.ProcessId)) {
-            EventDataDesc desc[] = {
-                { L"pIDXGISwapChain" },
-                { L"Flags" },
-                { L"SyncInterval" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto pSwapChain   = desc[0].GetData<uint64_t>();
-            auto Flags        = desc[1].GetData<uint32_t>();
-            auto SyncInterval = desc[2].GetData<int32_t>();
+    case DecodedEventType::Win32kTokenCompositionSurfaceObject:
+        HandleWin32kTokenCompositionSurfaceObject(ev, ev.Win32kToken.CompositionSurfaceLuid, ev.Win32kToken.PresentCount,
+                                                  ev.Win32kToken.BindId, ev.Win32kToken.DestSizeValid != 0,
+                                                  ev.Win32kToken.DestWidth, ev.Win32kToken.DestHeight);
+        break;
+    case DecodedEventType::Win32kTokenStateChanged:
+        HandleWin32kTokenStateChanged(ev.Win32kToken.CompositionSurfaceLuid, ev.Win32kToken.PresentCount,
+                                      ev.Win32kToken.BindId, ev.Win32kToken.NewState, ev.Win32kToken.IndependentFlip != 0);
+        break;
 
-            RuntimePresentStart(Runtime::DXGI, hdr, pSwapChain, Flags, SyncInterval);
-        }
+    case DecodedEventType::DwmGetPresentHistory:
+        HandleDwmGetPresentHistory();
+        break;
+    case DecodedEventType::DwmSchedulePresentStart:
+        DwmProcessId = ev.ProcessId;
+        DwmPresentThreadId = ev.ThreadId;
         break;
-    case Microsoft_Windows_DXGI::Present_Stop::Id:
-    case Microsoft_Windows_DXGI::PresentMultiplaneOverlay_Stop::Id:
-        if (IsProcessTrackedForFiltering(hdr.ProcessId)) {
-            RuntimePresentStop(Runtime::DXGI, hdr, mMetadata.GetEventData<uint32_t>(pEventRecord, L"Result"));
+    case DecodedEventType::DwmFlipChain:
+        HandleDwmFlipChain(ev.DwmFlipChain.FlipChain, ev.DwmFlipChain.SerialNumber, ev.DwmFlipChain.Hwnd);
+        break;
+    case DecodedEventType::DwmScheduleSurfaceUpdate:
+        HandleDwmScheduleSurfaceUpdate(ev.DwmScheduleSurfaceUpdate.CompositionSurfaceLuid,
+                                       ev.DwmScheduleSurfaceUpdate.PresentCount, ev.DwmScheduleSurfaceUpdate.BindId);
+        break;
+
+    case DecodedEventType::ProcessStart:
+        mPendingProcessStart = {};
+        mPendingProcessStart.QpcTime = ev.TimeStamp;
+        mPendingProcessStart.ProcessId = ev.Process.ProcessId;
+        mPendingProcessStart.IsStartEvent = true;
+        mPendingProcessImageNameLength = ev.Process.ImageNameLength;
+        if (mPendingProcessImageNameLength == 0) {
+            EnqueueProcessEvent(mPendingProcessStart);
         }
         break;
-    case Microsoft_Windows_DXGI::SwapChain_Start::Id:
-    case Microsoft_Windows_DXGI::ResizeBuffers_Start::Id:
-        if (mTrackHybridPresent) {
-            if (IsProcessTrackedForFiltering(hdr.ProcessId)) {
-                EventDataDesc desc[] = {
-                    { L"pIDXGISwapChain" },
-                    { L"HybridPresentMode" },
-                };
-                // Check to see if the event has both the pIDXGISwapChain and HybridPresentMode
-                // fields. If not do not process.
-                uint32_t descCount = _countof(desc);
-                mMetadata.GetEventData(pEventRecord, desc, &descCount);
-                if (descCount == _countof(desc)) {
-                    auto pSwapChain = desc[0].GetData<uint64_t>();
-                    auto hybridPresentMode = desc[1].GetData<uint32_t>();
-                    auto key = std::make_pair(hdr.ProcessId, pSwapChain);
-                    mHybridPresentModeBySwapChainPid[key] = hybridPresentMode;
-                }
+    case DecodedEventType::ProcessImageName:
+        if (mPendingProcessImageNameLength > 0) {
+            auto count = (uint32_t) std::size(ev.ProcessImageName.Chars);
+            if (count > mPendingProcessImageNameLength) {
+                count = mPendingProcessImageNameLength;
+            }
+            mPendingProcessStart.ImageFileName.append(ev.ProcessImageName.Chars, ev.ProcessImageName.Chars + count);
+            mPendingProcessImageNameLength -= count;
+            if (mPendingProcessImageNameLength == 0) {
+                EnqueueProcessEvent(mPendingProcessStart);
             }
         }
         break;
+    case DecodedEventType::ProcessStop: {
+        ProcessEvent event;
+        event.QpcTime = ev.TimeStamp;
+        event.ProcessId = ev.Process.ProcessId;
+        event.IsStartEvent = false;
+        EnqueueProcessEvent(event);
+        break;
+    }
+
+    case DecodedEventType::Win32kInputDeviceRead:
+        HandleWin32kInputDeviceRead(ev.TimeStamp, ev.Win32kInput.DeviceType);
+        break;
+    case DecodedEventType::Win32kRetrieveInputMessage:
+        HandleWin32kRetrieveInputMessage(ev.ProcessId, ev.Win32kInput.Hwnd);
+        break;
+    case DecodedEventType::Win32kInputXformUpdate:
+        HandleWin32kInputXformUpdate(ev.Win32kInput.Hwnd, ev.Win32kInput.XformQPCTime);
+        break;
+
+    case DecodedEventType::IntelPresentFrameType:
+        HandleIntelPresentFrameType(ev.ThreadId, ev.IntelFrameType.FrameId,
+                                    ConvertPMPFrameTypeToFrameType((Intel_PresentMon::FrameType) ev.IntelFrameType.FrameType),
+                                    ev.IntelFrameType.AppFrameId);
+        break;
+    case DecodedEventType::IntelFlipFrameType:
+        HandleIntelFlipFrameType(ev.TimeStamp, ev.IntelFrameType.VidPnSourceId, ev.IntelFrameType.LayerIndex,
+                                 ev.IntelFrameType.PresentId,
+                                 ConvertPMPFrameTypeToFrameType((Intel_PresentMon::FrameType) ev.IntelFrameType.FrameType));
+        break;
+    case DecodedEventType::IntelAppTiming:
+        SetAppTimingData(ev.TimeStamp, ev.ProcessId, ev.IntelAppTiming.EventId, ev.IntelAppTiming.FrameId,
+                         ConvertIntelProviderInputTypes((Intel_PresentMon::InputType) ev.IntelAppTiming.InputType));
+        break;
+
+    case DecodedEventType::NvidiaFlipRequest:
+        mNvTraceConsumer.HandleFlipRequest(ev.TimeStamp, ev.ThreadId, ev.NvidiaFlipRequest.Alloc,
+                                           ev.NvidiaFlipRequest.VidPnSourceId, ev.NvidiaFlipRequest.Ts,
+                                           ev.NvidiaFlipRequest.Token);
+        break;
+
+    case DecodedEventType::PclMarker:
+        HandlePclMarker(ev.TimeStamp, ev.ProcessId, ev.PclMarker.Marker, ev.PclMarker.FrameId);
+        break;
+    case DecodedEventType::PclInput:
+        HandlePclInput(ev.TimeStamp, ev.ProcessId);
+        break;
+    case DecodedEventType::PclShutdown:
+        HandlePclShutdown(ev.ProcessId);
+        break;
+
     default:
-        assert(!mFilteredEvents); // Assert that filtering is working if expected
+        DebugAssert(false);
         break;
     }
 }
 
-void PMTraceConsumer::HandleDxgkBlt(EVENT_HEADER const& hdr, uint64_t hwnd, bool redirectedPresent)
+void PMTraceConsumer::HandleDxgiHybridPresentMode(uint32_t processId, uint64_t swapChainAddress, uint32_t hybridPresentMode)
+{
+    auto key = std::make_pair(processId, swapChainAddress);
+    mHybridPresentModeBySwapChainPid[key] = hybridPresentMode;
+}
+
+void PMTraceConsumer::HandleDxgkBlt(DecodedEvent const& hdr, uint64_t hwnd, bool redirectedPresent)
 {
     // Lookup the in-progress present.  It should not have a known present mode
     // yet, so if it does we assume we looked up a present whose tracking was
@@ -395,7 +560,7 @@ void PMTraceConsumer::HandleDxgkBlt(EVENT_HEADER const& hdr, uint64_t hwnd, bool
 //     QueuePacket_Start SubmitSequence MMIOFLIP bPresent=1
 //     QueuePacket_Stop SubmitSequence
 //     PresentStop
-std::shared_ptr<PresentEvent> PMTraceConsumer::HandleDxgkFlip(EVENT_HEADER const& hdr)
+std::shared_ptr<PresentEvent> PMTraceConsumer::HandleDxgkFlip(DecodedEvent const& hdr)
 {
     // First, lookup the in-progress present on the same thread.
     //
@@ -446,10 +611,10 @@ std::shared_ptr<PresentEvent> PMTraceConsumer::HandleDxgkFlip(EVENT_HEADER const
             return nullptr;
         }
 
-        presentEvent = std::make_shared<PresentEvent>();
+        presentEvent = mPresentEventPool.Allocate();
 
         VerboseTraceBeforeModifyingPresent(presentEvent.get());
-        presentEvent->PresentStartTime = *(uint64_t*) &hdr.TimeStamp;
+        presentEvent->PresentStartTime = hdr.TimeStamp;
         presentEvent->ProcessId = hdr.ProcessId;
         presentEvent->ThreadId = hdr.ThreadId;
 
@@ -477,7 +642,7 @@ std::shared_ptr<PresentEvent> PMTraceConsumer::HandleDxgkFlip(EVENT_HEADER const
 }
 
 void PMTraceConsumer::HandleDxgkQueueSubmit(
-    EVENT_HEADER const& hdr,
+    DecodedEvent const& hdr,
     uint64_t hContext,
     uint32_t submitSequence,
     uint32_t packetType,
@@ -487,7 +652,7 @@ void PMTraceConsumer::HandleDxgkQueueSubmit(
     // Track GPU execution
     if (mTrackGPU) {
         bool isWaitPacket = packetType == (uint32_t) Microsoft_Windows_DxgKrnl::QueuePacketType::DXGKETW_WAIT_COMMAND_BUFFER;
-        mGpuTrace.EnqueueQueuePacket(hContext, submitSequence, hdr.ProcessId, hdr.TimeStamp.QuadPart, isWaitPacket);
+        mGpuTrace.EnqueueQueuePacket(hContext, submitSequence, hdr.ProcessId, hdr.TimeStamp, isWaitPacket);
     }
 
     // For blt presents on Win7, the only way to distinguish between DWM-off
@@ -512,9 +677,11 @@ void PMTraceConsumer::HandleDxgkQueueSubmit(
             }
 
             // We're done with DxgkContext tracking, if the present hasn't
-            // completed remove it from the tracking now.
+            // completed remove it from the tracking now.  CompletePresent()
+            // may have erased other entries, which can relocate this one, so
+            // erase by key rather than through eventIter.
             if (present->DxgkContext != 0) {
-                mPresentByDxgkContext.erase(eventIter);
+                mPresentByDxgkContext.erase(hContext);
                 present->DxgkContext = 0;
             }
         }
@@ -533,7 +700,7 @@ void PMTraceConsumer::HandleDxgkQueueSubmit(
 
             auto presentsBySubmitSequence = &mPresentBySubmitSequence[submitSequence];
             DebugAssert(presentsBySubmitSequence->find(hContext) == presentsBySubmitSequence->end());
-            (*presentsBySubmitSequence)[hContext] = present;
+            presentsBySubmitSequence->insert_or_assign(hContext, present);
 
             if (isWin7 && present->PresentMode == PresentMode::Hardware_Legacy_Copy_To_Front_Buffer) {
                 mPresentByDxgkContext[hContext] = present;
@@ -680,7 +847,7 @@ void PMTraceConsumer::HandleDxgkSyncDPC(uint64_t timestamp, uint32_t submitSeque
 // while DWM is on and gives us a token we can use to match with the
 // Microsoft_Windows_DxgKrnl::PresentHistory_Info event.
 void PMTraceConsumer::HandleDxgkPresentHistory(
-    EVENT_HEADER const& hdr,
+    DecodedEvent const& hdr,
     uint64_t token,
     uint64_t tokenData,
     Microsoft_Windows_DxgKrnl::PresentModel presentModel)
@@ -769,7 +936,7 @@ void PMTraceConsumer::HandleDxgkPresentHistory(
 
 // This event is emitted when a token is being handed off to DWM, and is a good
 // way to indicate a ready state.
-void PMTraceConsumer::HandleDxgkPresentHistoryInfo(EVENT_HEADER const& hdr, uint64_t token)
+void PMTraceConsumer::HandleDxgkPresentHistoryInfo(DecodedEvent const& hdr, uint64_t token)
 {
     auto eventIter = mPresentByDxgkPresentHistoryToken.find(token);
     if (eventIter == mPresentByDxgkPresentHistoryToken.end()) {
@@ -778,8 +945,8 @@ void PMTraceConsumer::HandleDxgkPresentHistoryInfo(EVENT_HEADER const& hdr, uint
 
     VerboseTraceBeforeModifyingPresent(eventIter->second.get());
     eventIter->second->ReadyTime = eventIter->second->ReadyTime == 0
-        ? hdr.TimeStamp.QuadPart
-        : std::min(eventIter->second->ReadyTime, (uint64_t) hdr.TimeStamp.QuadPart);
+        ? hdr.TimeStamp
+        : std::min(eventIter->second->ReadyTime, hdr.TimeStamp);
 
     // Neither Composed Composition Atlas or Win7 Flip has DWM events indicating intent
     // to present this frame.
@@ -801,694 +968,204 @@ void PMTraceConsumer::HandleDxgkPresentHistoryInfo(EVENT_HEADER const& hdr, uint
     mPresentByDxgkPresentHistoryToken.erase(eventIter);
 }
 
-void PMTraceConsumer::HandleDXGKEvent(EVENT_RECORD* pEventRecord)
+void PMTraceConsumer::HandleDxgkFlipInfo(DecodedEvent const& hdr, uint32_t flipInterval, bool mmioFlip)
 {
-    auto const& hdr = pEventRecord->EventHeader;
-
-    if (hdr.EventDescriptor.Id == Microsoft_Windows_DxgKrnl::PresentHistory_Start::Id ||
-       (hdr.EventDescriptor.Id == Microsoft_Windows_DxgKrnl::PresentHistoryDetailed_Start::Id && mTrackDisplay)) {
-        EventDataDesc desc[] = {
-            { L"Token" },
-            { L"Model" },
-            { L"TokenData" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-        auto Token     = desc[0].GetData<uint64_t>();
-        auto Model     = desc[1].GetData<Microsoft_Windows_DxgKrnl::PresentModel>();
-        auto TokenData = desc[2].GetData<uint64_t>();
+    auto p = HandleDxgkFlip(hdr);
+    if (p != nullptr) {
+        p->SyncInterval = flipInterval;
 
-        if (Model != Microsoft_Windows_DxgKrnl::PresentModel::D3DKMT_PM_REDIRECTED_GDI) {
-            HandleDxgkPresentHistory(hdr, Token, TokenData, Model);
+        if (mmioFlip) {
+            p->WaitForFlipEvent = true;
+        } else if (flipInterval == 0) {
+            p->SupportsTearing = true;
         }
-        return;
     }
+}
 
-    if (mTrackDisplay) {
-        switch (hdr.EventDescriptor.Id) {
-        case Microsoft_Windows_DxgKrnl::Flip_Info::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"FlipInterval" },
-                { L"MMIOFlip" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto FlipInterval = desc[0].GetData<uint32_t>();
-            auto MMIOFlip     = desc[1].GetData<BOOL>() != 0;
-
-            auto p = HandleDxgkFlip(hdr);
-            if (p != nullptr) {
-                p->SyncInterval = FlipInterval;
-
-                if (MMIOFlip) {
-                    p->WaitForFlipEvent = true;
-                } else if (FlipInterval == 0) {
-                    p->SupportsTearing = true;
-                }
-            }
-            return;
-        }
-        case Microsoft_Windows_DxgKrnl::IndependentFlip_Info::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"SubmitSequence" },
-                { L"FlipInterval" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto SubmitSequence = desc[0].GetData<uint32_t>();
-            auto FlipInterval   = desc[1].GetData<uint32_t>();
-
-            auto pEvent = FindPresentBySubmitSequence(SubmitSequence);
-            if (pEvent != nullptr) {
-                // We should not have already identified as hardware_composed - this
-                // can only be detected around Vsync/HsyncDPC time.
-                DebugAssert(pEvent->PresentMode != PresentMode::Hardware_Composed_Independent_Flip);
-
-                VerboseTraceBeforeModifyingPresent(pEvent.get());
-                pEvent->PresentMode = PresentMode::Hardware_Independent_Flip;
-                pEvent->SyncInterval = FlipInterval;
-            }
-            return;
-        }
-        case Microsoft_Windows_DxgKrnl::FlipMultiPlaneOverlay_Info::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"VidPnSourceId" },
-                { L"LayerIndex" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto VidPnSourceId = desc[0].GetData<uint32_t>();
-            auto LayerIndex    = desc[1].GetData<uint32_t>();
-
-            auto p = HandleDxgkFlip(hdr);
-            if (p != nullptr) {
-                p->WaitForFlipEvent    = true;
-                p->WaitForMPOFlipEvent = true;
-
-                if (p->SwapChainAddress == 0) {
-                    p->SwapChainAddress = GenerateVidPnLayerId(VidPnSourceId, LayerIndex);
-                }
-            }
-            return;
-        }
-        // QueuPacket_Start are used for render queue packets
-        // QueuPacket_Start_2 are used for monitor wait packets
-        // QueuPacket_Start_3 are used for monitor signal packets
-        case Microsoft_Windows_DxgKrnl::QueuePacket_Start::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"PacketType" },
-                { L"SubmitSequence" },
-                { L"hContext" },
-                { L"bPresent" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto PacketType     = desc[0].GetData<uint32_t>();
-            auto SubmitSequence = desc[1].GetData<uint32_t>();
-            auto hContext       = desc[2].GetData<uint64_t>();
-            auto bPresent       = desc[3].GetData<BOOL>() != 0;
-
-            HandleDxgkQueueSubmit(hdr, hContext, SubmitSequence, PacketType, bPresent, false);
-            return;
-        }
-        case Microsoft_Windows_DxgKrnl::QueuePacket_Start_2::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"hContext" },
-                { L"SubmitSequence" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto hContext       = desc[0].GetData<uint64_t>();
-            auto SubmitSequence = desc[1].GetData<uint32_t>();
-
-            uint32_t PacketType = (uint32_t) Microsoft_Windows_DxgKrnl::QueuePacketType::DXGKETW_WAIT_COMMAND_BUFFER;
-            bool bPresent = false;
-            HandleDxgkQueueSubmit(hdr, hContext, SubmitSequence, PacketType, bPresent, false);
-            return;
-        }
-        case Microsoft_Windows_DxgKrnl::QueuePacket_Stop::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"hContext" },
-                { L"SubmitSequence" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto hContext       = desc[0].GetData<uint64_t>();
-            auto SubmitSequence = desc[1].GetData<uint32_t>();
-
-            HandleDxgkQueueComplete(hdr.TimeStamp.QuadPart, hContext, SubmitSequence);
-            return;
-        }
-        case Microsoft_Windows_DxgKrnl::MMIOFlip_Info::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"FlipSubmitSequence" },
-                { L"Flags" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto FlipSubmitSequence = desc[0].GetData<uint32_t>();
-            auto Flags              = desc[1].GetData<uint32_t>();
-
-            HandleDxgkMMIOFlip(hdr.TimeStamp.QuadPart, FlipSubmitSequence, Flags);
-            return;
-        }
-        case Microsoft_Windows_DxgKrnl::MMIOFlipMultiPlaneOverlay_Info::Id:
-        {
-            auto flipEntryStatusAfterFlipValid = hdr.EventDescriptor.Version >= 2;
-            EventDataDesc desc[] = {
-                { L"FlipSubmitSequence" },
-                { L"FlipEntryStatusAfterFlip" }, // optional
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc) - (flipEntryStatusAfterFlipValid ? 0 : 1));
-            auto FlipSubmitSequence = desc[0].GetData<uint64_t>();
-
-            auto submitSequence = (uint32_t) (FlipSubmitSequence >> 32u);
-            auto present = FindPresentBySubmitSequence(submitSequence);
-            if (present != nullptr) {
-
-                // Apply Nvidia FlipDelay, if any, to the presentEvent
-                mNvTraceConsumer.ApplyFlipDelay(present.get(), hdr.ThreadId);
-
-                // Complete the GPU tracking for this frame.
-                //
-                // For some present modes (e.g., Hardware_Legacy_Flip) this may be
-                // the first event telling us the present is ready.
-                mGpuTrace.CompleteFrame(present.get(), hdr.TimeStamp.QuadPart);
-
-                // Check and handle the post-flip status if available.
-                if (flipEntryStatusAfterFlipValid) {
-                    auto FlipEntryStatusAfterFlip = desc[1].GetData<uint32_t>();
-
-                    // Nothing to do for FlipWaitVSync other than wait for the VSync events.
-                    if (FlipEntryStatusAfterFlip != (uint32_t) Microsoft_Windows_DxgKrnl::FlipEntryStatus::FlipWaitVSync) {
-
-                        // Any of the non-vsync status present modes can tear.
-                        VerboseTraceBeforeModifyingPresent(present.get());
-                        present->SupportsTearing = true;
+void PMTraceConsumer::HandleDxgkIndependentFlip(uint32_t submitSequence, uint32_t flipInterval)
+{
+    auto pEvent = FindPresentBySubmitSequence(submitSequence);
+    if (pEvent != nullptr) {
+        // We should not have already identified as hardware_composed - this
+        // can only be detected around Vsync/HsyncDPC time.
+        DebugAssert(pEvent->PresentMode != PresentMode::Hardware_Composed_Independent_Flip);
 
-                        // For FlipWaitVSync and FlipWaitHSync, we'll wait for the
-                        // corresponding ?SyncDPC event.  Otherwise we consider
-                        // this the present screen time.
-                        if (FlipEntryStatusAfterFlip != (uint32_t) Microsoft_Windows_DxgKrnl::FlipEntryStatus::FlipWaitHSync) {
+        VerboseTraceBeforeModifyingPresent(pEvent.get());
+        pEvent->PresentMode = PresentMode::Hardware_Independent_Flip;
+        pEvent->SyncInterval = flipInterval;
+    }
+}
 
-                            SetScreenTime(present, hdr.TimeStamp.QuadPart + present->FlipDelay);
+void PMTraceConsumer::HandleDxgkFlipMPO(DecodedEvent const& hdr, uint32_t vidPnSourceId, uint32_t layerIndex)
+{
+    auto p = HandleDxgkFlip(hdr);
+    if (p != nullptr) {
+        p->WaitForFlipEvent    = true;
+        p->WaitForMPOFlipEvent = true;
 
-                            if (present->PresentMode == PresentMode::Hardware_Legacy_Flip) {
-                                CompletePresent(present);
-                            }
-                        }
-                    }
-                }
-            }
-            return;
+        if (p->SwapChainAddress == 0) {
+            p->SwapChainAddress = GenerateVidPnLayerId(vidPnSourceId, layerIndex);
         }
+    }
+}
 
-        // VSyncDPC_Info only includes the FlipSubmitSequence for one layer.
-        //
-        // *SyncDPCMultiPlane_Info is sent afterward for non-legacy flip paths, and
-        // contains info on whether this vsync/hsync contains an overlay.  So, we
-        // avoid updating ScreenTime and FinalState with the second event, but
-        // update isMultiPlane with the correct information when we have them.
-        //
-        // On Windows >= 10.17134 HSyncDPCMultiPlane_Info is used when the
-        // associated display is connected to integrated graphics.
-        case Microsoft_Windows_DxgKrnl::VSyncDPC_Info::Id:
-        {
-            auto FlipFenceId = mMetadata.GetEventData<uint64_t>(pEventRecord, L"FlipFenceId");
-            if (FlipFenceId != 0) {
-                HandleDxgkSyncDPC(hdr.TimeStamp.QuadPart, (uint32_t)(FlipFenceId >> 32u));
-            }
-            return;
-        }
-        case Microsoft_Windows_DxgKrnl::VSyncDPCMultiPlane_Info::Id:
-        case Microsoft_Windows_DxgKrnl::HSyncDPCMultiPlane_Info::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"PlaneCount" },
-                { L"ScannedPhysicalAddress" },
-                { L"FlipEntryCount" },
-                { L"FlipSubmitSequence" },
-            };
-
-            // Name changed from "ScannedPhysicalAddress" to "PresentIdOrPhysicalAddress"
-            if (hdr.EventDescriptor.Id == Microsoft_Windows_DxgKrnl::VSyncDPCMultiPlane_Info::Id &&
-                hdr.EventDescriptor.Version >= 1) {
-                desc[1].name_ = L"PresentIdOrPhysicalAddress";
-            }
+void PMTraceConsumer::HandleDxgkMMIOFlipMPO(DecodedEvent const& hdr, uint32_t submitSequence, uint32_t flipEntryStatusAfterFlip, bool flipEntryStatusAfterFlipValid)
+{
+    auto present = FindPresentBySubmitSequence(submitSequence);
+    if (present != nullptr) {
 
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto PlaneCount         = desc[0].GetData<uint32_t>();
-            auto PlaneAddress       = desc[1].GetArray<uint64_t>(PlaneCount);
-            auto FlipEntryCount     = desc[2].GetData<uint32_t>();
-            auto FlipSubmitSequence = desc[3].GetArray<uint64_t>(FlipEntryCount);
-
-            if (FlipEntryCount > 0) {
-                // The number of active planes is determined by the number of
-                // non-zero addresses.  All we care about is if there are more
-                // than one or not.
-                bool isMultiPlane = false;
-                for (uint32_t i = 0, activePlaneCount = 0; i < PlaneCount; ++i) {
-                    if (PlaneAddress[i] != 0) {
-                        if (activePlaneCount == 1) {
-                            isMultiPlane = true;
-                            break;
-                        }
-                        activePlaneCount += 1;
-                    }
-                }
+        // Apply Nvidia FlipDelay, if any, to the presentEvent
+        mNvTraceConsumer.ApplyFlipDelay(present.get(), hdr.ThreadId);
 
-                for (uint32_t i = 0; i < FlipEntryCount; ++i) {
-                    if (FlipSubmitSequence[i] > 0) {
-                        auto submitSequence = (uint32_t)(FlipSubmitSequence[i] >> 32u);
-                        auto pEvent = FindPresentBySubmitSequence(submitSequence);
-                        if (pEvent != nullptr) {
-                            if (isMultiPlane &&
-                                (pEvent->PresentMode == PresentMode::Hardware_Independent_Flip || pEvent->PresentMode == PresentMode::Composed_Flip)) {
-                                VerboseTraceBeforeModifyingPresent(pEvent.get());
-                                pEvent->PresentMode = PresentMode::Hardware_Composed_Independent_Flip;
-                            }
+        // Complete the GPU tracking for this frame.
+        //
+        // For some present modes (e.g., Hardware_Legacy_Flip) this may be
+        // the first event telling us the present is ready.
+        mGpuTrace.CompleteFrame(present.get(), hdr.TimeStamp);
 
-                            // ScreenTime may have already been written by a preceding
-                            // VSyncDPC_Info event, which is more accurate, so don't
-                            // overwrite it in that case.
-                            if (pEvent->FinalState != PresentResult::Presented) {
-                                VerboseTraceBeforeModifyingPresent(pEvent.get());
-                                SetScreenTime(pEvent, hdr.TimeStamp.QuadPart);
-                            }
+        // Check and handle the post-flip status if available.
+        if (flipEntryStatusAfterFlipValid) {
 
-                            // Complete the present.
-                            CompletePresent(pEvent);
-                        }
-                    }
-                }
-            }
-            return;
-        }
-        case Microsoft_Windows_DxgKrnl::Present_Info::Id:
-        {
-            // This event is emitted at the end of the kernel present.
-            auto eventIter = mPresentByThreadId.find(hdr.ThreadId);
-            if (eventIter != mPresentByThreadId.end()) {
-                auto present = eventIter->second;
+            // Nothing to do for FlipWaitVSync other than wait for the VSync events.
+            if (flipEntryStatusAfterFlip != (uint32_t) Microsoft_Windows_DxgKrnl::FlipEntryStatus::FlipWaitVSync) {
 
-                // Store the fact we've seen this present.  This is used to improve
-                // tracking and to defer blt present completion until both Present_Info
-                // and present QueuePacket_Stop have been seen.
+                // Any of the non-vsync status present modes can tear.
                 VerboseTraceBeforeModifyingPresent(present.get());
-                present->SeenDxgkPresent = true;
+                present->SupportsTearing = true;
 
-                if (present->Hwnd == 0) {
-                    present->Hwnd = mMetadata.GetEventData<uint64_t>(pEventRecord, L"hWindow");
-                }
+                // For FlipWaitVSync and FlipWaitHSync, we'll wait for the
+                // corresponding ?SyncDPC event.  Otherwise we consider
+                // this the present screen time.
+                if (flipEntryStatusAfterFlip != (uint32_t) Microsoft_Windows_DxgKrnl::FlipEntryStatus::FlipWaitHSync) {
 
-                // If we are not expecting an API present end event, then this
-                // should be the last operation on this thread.  This can happen
-                // due to batched presents or non-instrumented present APIs (i.e.,
-                // not DXGI nor D3D9).
-                if (present->Runtime == Runtime::Other ||
-                    present->ThreadId != hdr.ThreadId) {
-                    mPresentByThreadId.erase(eventIter);
-                }
+                    SetScreenTime(present, hdr.TimeStamp + present->FlipDelay);
 
-                // If this is a deferred blit that's already seen QueuePacket_Stop,
-                // then complete it now.
-                if (present->PresentMode == PresentMode::Hardware_Legacy_Copy_To_Front_Buffer && HasScreenTime(present)) {
-                    CompletePresent(present);
+                    if (present->PresentMode == PresentMode::Hardware_Legacy_Flip) {
+                        CompletePresent(present);
+                    }
                 }
             }
-            return;
-        }
-        case Microsoft_Windows_DxgKrnl::PresentHistory_Info::Id:
-            HandleDxgkPresentHistoryInfo(hdr, mMetadata.GetEventData<uint64_t>(pEventRecord, L"Token"));
-            return;
-        case Microsoft_Windows_DxgKrnl::Blit_Info::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"hwnd" },
-                { L"bRedirectedPresent" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto hwnd               = desc[0].GetData<uint64_t>();
-            auto bRedirectedPresent = desc[1].GetData<uint32_t>() != 0;
-
-            HandleDxgkBlt(hdr, hwnd, bRedirectedPresent);
-            return;
-        }
-
-        // BlitCancel_Info indicates that DxgKrnl optimized a present blt away, and
-        // no further work was needed.
-        case Microsoft_Windows_DxgKrnl::BlitCancel_Info::Id:
-        {
-            auto present = FindPresentByThreadId(hdr.ThreadId);
-            if (present != nullptr) {
-                VerboseTraceBeforeModifyingPresent(present.get());
-                present->FinalState = PresentResult::Discarded;
-
-                CompletePresent(present);
-            }
-            return;
-        }
         }
     }
+}
 
-    if (mTrackGPU) {
-        switch (hdr.EventDescriptor.Id) {
-
-        // We need a mapping from hContext to GPU node.
-        //
-        // There's two ways I've tried to get this. One is to use
-        // Microsoft_Windows_DxgKrnl::SelectContext2_Info events which include
-        // all the required info (hContext, pDxgAdapter, and NodeOrdinal) but
-        // that event fires often leading to significant overhead.
-        //
-        // The current implementaiton requires a CAPTURE_STATE on start up to
-        // get all existing context/device events but after that the event
-        // overhead should be minimal.
-        case Microsoft_Windows_DxgKrnl::Device_DCStart::Id:
-        case Microsoft_Windows_DxgKrnl::Device_Start::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"pDxgAdapter" },
-                { L"hDevice" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto pDxgAdapter = desc[0].GetData<uint64_t>();
-            auto hDevice     = desc[1].GetData<uint64_t>();
-
-            mGpuTrace.RegisterDevice(hDevice, pDxgAdapter);
-            return;
-        }
-        // Sometimes a trace will miss a Device_Start, so we also check
-        // AdapterAllocation events (which also provide the pDxgAdapter-hDevice
-        // mapping).  These are not currently enabled for realtime collection.
-        case Microsoft_Windows_DxgKrnl::AdapterAllocation_Start::Id:
-        case Microsoft_Windows_DxgKrnl::AdapterAllocation_DCStart::Id:
-        case Microsoft_Windows_DxgKrnl::AdapterAllocation_Stop::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"pDxgAdapter" },
-                { L"hDevice" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto pDxgAdapter = desc[0].GetData<uint64_t>();
-            auto hDevice     = desc[1].GetData<uint64_t>();
-
-            if (hDevice != 0) {
-                mGpuTrace.RegisterDevice(hDevice, pDxgAdapter);
-            }
-            return;
-        }
-        case Microsoft_Windows_DxgKrnl::Device_Stop::Id:
-        {
-            auto hDevice = mMetadata.GetEventData<uint64_t>(pEventRecord, L"hDevice");
-
-            mGpuTrace.UnregisterDevice(hDevice);
-            return;
-        }
-        case Microsoft_Windows_DxgKrnl::Context_DCStart::Id:
-        case Microsoft_Windows_DxgKrnl::Context_Start::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"hContext" },
-                { L"hDevice" },
-                { L"NodeOrdinal" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto hContext    = desc[0].GetData<uint64_t>();
-            auto hDevice     = desc[1].GetData<uint64_t>();
-            auto NodeOrdinal = desc[2].GetData<uint32_t>();
-
-            // If this is a DCStart, then it was generated by xperf instead of
-            // the context's process.
-            uint32_t processId = hdr.EventDescriptor.Id == Microsoft_Windows_DxgKrnl::Context_DCStart::Id
-                ? 0
-                : hdr.ProcessId;
-
-            mGpuTrace.RegisterContext(hContext, hDevice, NodeOrdinal, processId);
-            return;
-        }
-        case Microsoft_Windows_DxgKrnl::Context_Stop::Id:
-            mGpuTrace.UnregisterContext(mMetadata.GetEventData<uint64_t>(pEventRecord, L"hContext"));
-            return;
-
-        case Microsoft_Windows_DxgKrnl::HwQueue_DCStart::Id:
-        case Microsoft_Windows_DxgKrnl::HwQueue_Start::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"hContext" },
-                { L"ParentDxgHwQueue" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto hContext        = desc[0].GetData<uint64_t>();
-            auto hHwQueueContext = desc[1].GetData<uint64_t>();
-
-            mGpuTrace.RegisterHwQueueContext(hContext, hHwQueueContext);
-            return;
-        }
-
-        case Microsoft_Windows_DxgKrnl::NodeMetadata_Info::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"pDxgAdapter" },
-                { L"NodeOrdinal" },
-                { L"EngineType" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto pDxgAdapter = desc[0].GetData<uint64_t>();
-            auto NodeOrdinal = desc[1].GetData<uint32_t>();
-            auto EngineType  = desc[2].GetData<Microsoft_Windows_DxgKrnl::DXGK_ENGINE>();
-
-            mGpuTrace.SetEngineType(pDxgAdapter, NodeOrdinal, EngineType);
-            return;
-        }
-
-        // DmaPacket_Start occurs when a packet is enqueued onto a node.
-        // 
-        // There are certain DMA packets that don't result in GPU work.
-        // Examples are preemption packets or notifications for
-        // VIDSCH_QUANTUM_EXPIRED.  These will have a sequence id of zero (also
-        // DmaBuffer will be null).
-        case Microsoft_Windows_DxgKrnl::DmaPacket_Start::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"hContext" },
-                { L"ulQueueSubmitSequence" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto hContext   = desc[0].GetData<uint64_t>();
-            auto SequenceId = desc[1].GetData<uint32_t>();
-
-            if (SequenceId != 0) {
-                mGpuTrace.EnqueueDmaPacket(hContext, SequenceId, hdr.TimeStamp.QuadPart);
-            }
-            return;
+// Handles one flip entry of a VSyncDPCMultiPlane_Info or HSyncDPCMultiPlane_Info event.
+void PMTraceConsumer::HandleDxgkSyncDPCMPO(uint64_t timestamp, uint32_t submitSequence, bool isMultiPlane)
+{
+    auto pEvent = FindPresentBySubmitSequence(submitSequence);
+    if (pEvent != nullptr) {
+        if (isMultiPlane &&
+            (pEvent->PresentMode == PresentMode::Hardware_Independent_Flip || pEvent->PresentMode == PresentMode::Composed_Flip)) {
+            VerboseTraceBeforeModifyingPresent(pEvent.get());
+            pEvent->PresentMode = PresentMode::Hardware_Composed_Independent_Flip;
         }
 
-        // DmaPacket_Info occurs on packet-related interrupts.  We could use
-        // DmaPacket_Stop here, but the DMA_COMPLETED interrupt is a tighter
-        // bound.
-        case Microsoft_Windows_DxgKrnl::DmaPacket_Info::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"hContext" },
-                { L"ulQueueSubmitSequence" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto hContext   = desc[0].GetData<uint64_t>();
-            auto SequenceId = desc[1].GetData<uint32_t>();
-
-            if (SequenceId != 0) {
-                mGpuTrace.CompleteDmaPacket(hContext, SequenceId, hdr.TimeStamp.QuadPart);
-            }
-            return;
-        }
+        // ScreenTime may have already been written by a preceding
+        // VSyncDPC_Info event, which is more accurate, so don't
+        // overwrite it in that case.
+        if (pEvent->FinalState != PresentResult::Presented) {
+            VerboseTraceBeforeModifyingPresent(pEvent.get());
+            SetScreenTime(pEvent, timestamp);
         }
-    }
-
-    if (mTrackFrameType) {
-        // MMIOFlipMultiPlaneOverlay3_Info is emitted immediately before MMIOFlipMultiPlaneOverlay_Info,
-        // on the same thread, with the same SubmitSequence, and includes the PresentId(s) that the
-        // driver uses to report flip completion.
-        //
-        // Version 8 is required for LayerIndex and FlipSubmitSequence.
-        if (hdr.EventDescriptor.Id == Microsoft_Windows_DxgKrnl::MMIOFlipMultiPlaneOverlay3_Info::Id) {
-            if (hdr.EventDescriptor.Version >= 8) {
-                // Enable FlipFrameType events as we now know this system supports it.
-                mEnableFlipFrameTypeEvents = true;
-
-                EventDataDesc desc[] = {
-                    { L"VidPnSourceId" },
-                    { L"PlaneCount" },
-                    { L"PresentId" },
-                    { L"LayerIndex" },
-                    { L"FlipSubmitSequence" },
-                };
-                mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-                auto VidPnSourceId      = desc[0].GetData<uint32_t>();
-                auto PlaneCount         = desc[1].GetData<uint32_t>();
-                auto PresentId          = desc[2].GetArray<uint64_t>(PlaneCount);
-                auto LayerIndex         = desc[3].GetArray<uint32_t>(PlaneCount);
-                auto FlipSubmitSequence = desc[4].GetData<uint32_t>();
-
-                // Lookup the present associated with this submit sequence
-                if (PlaneCount > 0) {
-                    auto present = FindPresentBySubmitSequence(FlipSubmitSequence);
-                    DebugAssert(present == nullptr || present->PresentIds.empty());
-
-                    for (uint32_t i = 0; i < PlaneCount; ++i) {
-
-                        // Mark any present already assigned to this VidPnLayer as they will not be
-                        // getting any more FlipFrameType events.
-                        auto vidPnLayerId = GenerateVidPnLayerId(VidPnSourceId, LayerIndex[i]);
-                        {
-                            auto ii = mPresentByVidPnLayerId.find(vidPnLayerId);
-                            if (ii != mPresentByVidPnLayerId.end()) {
-                                auto p2 = ii->second;
-                                p2->PresentIds.clear();
-                                mPresentByVidPnLayerId.erase(ii);
-
-                                VerboseTraceBeforeModifyingPresent(p2.get());
-                                p2->DoneWaitingForFlipFrameType = true;
-
-                                if (p2->WaitingForFlipFrameType) {
-                                    p2->WaitingForFlipFrameType = false;
-                                    StopTrackingPresent(p2);
-
-                                    for (auto p3 : p2->DependentPresents) {
-                                        VerboseTraceBeforeModifyingPresent(p3.get());
-                                        p3->WaitingForFlipFrameType = false;
-                                        StopTrackingPresent(p2);
-                                    }
-
-                                    UpdateReadyCount(true);
-                                }
-                                VerboseTraceBeforeModifyingPresent(nullptr);
-                            }
-                        }
 
-                        // If this submit sequence represents a present we are tracking, add
-                        // the present ids to it.
-                        if (present != nullptr) {
-                            VerboseTraceBeforeModifyingPresent(present.get());
-                            present->PresentIds.emplace(vidPnLayerId, PresentId[i]);
-                            mPresentByVidPnLayerId.emplace(vidPnLayerId, present);
-                        }
-
-                        // Apply any pending FlipFrameType events
-                        auto ii = mPendingFlipFrameTypeEvents.find(vidPnLayerId);
-                        if (ii != mPendingFlipFrameTypeEvents.end()) {
-                            if (present != nullptr && ii->second.PresentId == PresentId[i]) {
-                                ApplyFlipFrameType(present, ii->second.Timestamp, ii->second.FrameType);
-                            }
-                            mPendingFlipFrameTypeEvents.erase(ii);
-                        }
-                    }
-                }
-            }
-            return;
-        }
+        // Complete the present.
+        CompletePresent(pEvent);
     }
-
-    assert(!mFilteredEvents); // Assert that filtering is working if expected
-}
-
-
-void PMTraceConsumer::HandleNvidiaDisplayDriverEvent(EVENT_RECORD* pEventRecord)
-{
-    mNvTraceConsumer.HandleNvidiaDisplayDriverEvent(pEventRecord, this);
 }
 
-void PMTraceConsumer::HandleWin7DxgkBlt(EVENT_RECORD* pEventRecord)
+// This event is emitted at the end of the kernel present.
+void PMTraceConsumer::HandleDxgkPresent(DecodedEvent const& hdr, uint64_t hwnd)
 {
-    using namespace Microsoft_Windows_DxgKrnl::Win7;
+    auto eventIter = mPresentByThreadId.find(hdr.ThreadId);
+    if (eventIter != mPresentByThreadId.end()) {
+        auto present = eventIter->second;
 
-    auto pBltEvent = reinterpret_cast<DXGKETW_BLTEVENT*>(pEventRecord->UserData);
-    HandleDxgkBlt(
-        pEventRecord->EventHeader,
-        pBltEvent->hwnd,
-        pBltEvent->bRedirectedPresent != 0);
-}
+        // Store the fact we've seen this present.  This is used to improve
+        // tracking and to defer blt present completion until both Present_Info
+        // and present QueuePacket_Stop have been seen.
+        VerboseTraceBeforeModifyingPresent(present.get());
+        present->SeenDxgkPresent = true;
 
-void PMTraceConsumer::HandleWin7DxgkFlip(EVENT_RECORD* pEventRecord)
-{
-    using namespace Microsoft_Windows_DxgKrnl::Win7;
+        if (present->Hwnd == 0) {
+            present->Hwnd = hwnd;
+        }
 
-    auto pFlipEvent = reinterpret_cast<DXGKETW_FLIPEVENT*>(pEventRecord->UserData);
-    auto p = HandleDxgkFlip(pEventRecord->EventHeader);
-    if (p != nullptr) {
-        p->SyncInterval = pFlipEvent->FlipInterval;
+        // If we are not expecting an API present end event, then this
+        // should be the last operation on this thread.  This can happen
+        // due to batched presents or non-instrumented present APIs (i.e.,
+        // not DXGI nor D3D9).
+        if (present->Runtime == Runtime::Other ||
+            present->ThreadId != hdr.ThreadId) {
+            mPresentByThreadId.erase(eventIter);
+        }
 
-        if (pFlipEvent->MMIOFlip != 0) {
-            p->WaitForFlipEvent = true;
-        } else if (pFlipEvent->FlipInterval == 0) {
-            p->SupportsTearing = true;
+        // If this is a deferred blit that's already seen QueuePacket_Stop,
+        // then complete it now.
+        if (present->PresentMode == PresentMode::Hardware_Legacy_Copy_To_Front_Buffer && HasScreenTime(present)) {
+            CompletePresent(present);
         }
     }
 }
 
-void PMTraceConsumer::HandleWin7DxgkPresentHistory(EVENT_RECORD* pEventRecord)
+// BlitCancel_Info indicates that DxgKrnl optimized a present blt away, and
+// no further work was needed.
+void PMTraceConsumer::HandleDxgkBlitCancel(DecodedEvent const& hdr)
 {
-    using namespace Microsoft_Windows_DxgKrnl::Win7;
+    auto present = FindPresentByThreadId(hdr.ThreadId);
+    if (present != nullptr) {
+        VerboseTraceBeforeModifyingPresent(present.get());
+        present->FinalState = PresentResult::Discarded;
 
-    auto pPresentHistoryEvent = reinterpret_cast<DXGKETW_PRESENTHISTORYEVENT*>(pEventRecord->UserData);
-    if (pEventRecord->EventHeader.EventDescriptor.Opcode == EVENT_TRACE_TYPE_START) {
-        HandleDxgkPresentHistory(
-            pEventRecord->EventHeader,
-            pPresentHistoryEvent->Token,
-            0,
-            Microsoft_Windows_DxgKrnl::PresentModel::D3DKMT_PM_UNINITIALIZED);
-    } else if (pEventRecord->EventHeader.EventDescriptor.Opcode == EVENT_TRACE_TYPE_INFO) {
-        HandleDxgkPresentHistoryInfo(pEventRecord->EventHeader, pPresentHistoryEvent->Token);
+        CompletePresent(present);
     }
 }
 
-void PMTraceConsumer::HandleWin7DxgkQueuePacket(EVENT_RECORD* pEventRecord)
+void PMTraceConsumer::HandleDxgkMMIOFlipMPO3Plane(std::shared_ptr<PresentEvent> const& present, uint32_t vidPnSourceId, uint32_t layerIndex, uint64_t presentId)
 {
-    using namespace Microsoft_Windows_DxgKrnl::Win7;
+    // Mark any present already assigned to this VidPnLayer as they will not be
+    // getting any more FlipFrameType events.
+    auto vidPnLayerId = GenerateVidPnLayerId(vidPnSourceId, layerIndex);
+    {
+        auto ii = mPresentByVidPnLayerId.find(vidPnLayerId);
+        if (ii != mPresentByVidPnLayerId.end()) {
+            auto p2 = ii->second;
+            p2->PresentIds.clear();
+            mPresentByVidPnLayerId.erase(ii);
 
-    if (pEventRecord->EventHeader.EventDescriptor.Opcode == EVENT_TRACE_TYPE_START) {
-        auto pSubmitEvent = reinterpret_cast<DXGKETW_QUEUESUBMITEVENT*>(pEventRecord->UserData);
-        HandleDxgkQueueSubmit(
-            pEventRecord->EventHeader,
-            pSubmitEvent->hContext,
-            pSubmitEvent->SubmitSequence,
-            pSubmitEvent->PacketType,
-            pSubmitEvent->bPresent != 0,
-            true);
-    } else if (pEventRecord->EventHeader.EventDescriptor.Opcode == EVENT_TRACE_TYPE_STOP) {
-        auto pCompleteEvent = reinterpret_cast<DXGKETW_QUEUECOMPLETEEVENT*>(pEventRecord->UserData);
-        HandleDxgkQueueComplete(
-            pEventRecord->EventHeader.TimeStamp.QuadPart,
-            pCompleteEvent->hContext,
-            pCompleteEvent->SubmitSequence);
-    }
-}
+            VerboseTraceBeforeModifyingPresent(p2.get());
+            p2->DoneWaitingForFlipFrameType = true;
 
-void PMTraceConsumer::HandleWin7DxgkVSyncDPC(EVENT_RECORD* pEventRecord)
-{
-    using namespace Microsoft_Windows_DxgKrnl::Win7;
+            if (p2->WaitingForFlipFrameType) {
+                p2->WaitingForFlipFrameType = false;
+                StopTrackingPresent(p2);
 
-    auto pVSyncDPCEvent = reinterpret_cast<DXGKETW_SCHEDULER_VSYNC_DPC*>(pEventRecord->UserData);
+                for (auto const& p3 : p2->DependentPresents) {
+                    VerboseTraceBeforeModifyingPresent(p3.get());
+                    p3->WaitingForFlipFrameType = false;
+                    StopTrackingPresent(p2);
+                }
 
-    // Windows 7 does not support MultiPlaneOverlay.
-    HandleDxgkSyncDPC(pEventRecord->EventHeader.TimeStamp.QuadPart, (uint32_t)(pVSyncDPCEvent->FlipFenceId.QuadPart >> 32u));
-}
+                UpdateReadyCount();
+            }
+            VerboseTraceBeforeModifyingPresent(nullptr);
+        }
+    }
 
-void PMTraceConsumer::HandleWin7DxgkMMIOFlip(EVENT_RECORD* pEventRecord)
-{
-    using namespace Microsoft_Windows_DxgKrnl::Win7;
+    // If this submit sequence represents a present we are tracking, add
+    // the present ids to it.
+    if (present != nullptr) {
+        VerboseTraceBeforeModifyingPresent(present.get());
+        present->PresentIds.emplace(vidPnLayerId, presentId);
+        mPresentByVidPnLayerId.emplace(vidPnLayerId, present);
+    }
 
-    if (pEventRecord->EventHeader.Flags & EVENT_HEADER_FLAG_32_BIT_HEADER) {
-        auto pMMIOFlipEvent = reinterpret_cast<DXGKETW_SCHEDULER_MMIO_FLIP_32*>(pEventRecord->UserData);
-        HandleDxgkMMIOFlip(
-            pEventRecord->EventHeader.TimeStamp.QuadPart,
-            pMMIOFlipEvent->FlipSubmitSequence,
-            pMMIOFlipEvent->Flags);
-    } else {
-        auto pMMIOFlipEvent = reinterpret_cast<DXGKETW_SCHEDULER_MMIO_FLIP_64*>(pEventRecord->UserData);
-        HandleDxgkMMIOFlip(
-            pEventRecord->EventHeader.TimeStamp.QuadPart,
-            pMMIOFlipEvent->FlipSubmitSequence,
-            pMMIOFlipEvent->Flags);
+    // Apply any pending FlipFrameType events
+    auto ii = mPendingFlipFrameTypeEvents.find(vidPnLayerId);
+    if (ii != mPendingFlipFrameTypeEvents.end()) {
+        if (present != nullptr && ii->second.PresentId == presentId) {
+            ApplyFlipFrameType(present, ii->second.Timestamp, ii->second.FrameType);
+        }
+        mPendingFlipFrameTypeEvents.erase(ii);
     }
 }
 
@@ -1503,372 +1180,248 @@ std::size_t PMTraceConsumer::Win32KPresentHistoryTokenHash::operator()(PMTraceCo
     return std::hash<uint64_t>::operator()(h64);
 }
 
-void PMTraceConsumer::HandleWin32kEvent(EVENT_RECORD* pEventRecord)
-{
-    auto const& hdr = pEventRecord->EventHeader;
-
-    if (mTrackDisplay) {
-        switch (hdr.EventDescriptor.Id) {
-        case Microsoft_Windows_Win32k::TokenCompositionSurfaceObject_Info::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"CompositionSurfaceLuid" },
-                { L"PresentCount" },
-                { L"BindId" },
-                { L"DestWidth" },  // version >= 1
-                { L"DestHeight" }, // version >= 1
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc) - (hdr.EventDescriptor.Version == 0 ? 2 : 0));
-            auto CompositionSurfaceLuid = desc[0].GetData<uint64_t>();
-            auto PresentCount           = desc[1].GetData<uint64_t>();
-            auto BindId                 = desc[2].GetData<uint64_t>();
-
-            // Lookup the in-progress present.  It should not have seen any Win32K
-            // events yet, so if it has we assume we looked up a present whose
-            // tracking was lost.
-            std::shared_ptr<PresentEvent> present;
-            for (;;) {
-                present = FindOrCreatePresent(hdr);
-                if (present == nullptr) {
-                    return;
-                }
-
-                if (!present->SeenWin32KEvents) {
-                    break;
-                }
-
-                RemoveLostPresent(present);
-            }
-
-            present->PresentMode = PresentMode::Composed_Flip;
-            present->SeenWin32KEvents = true;
-
-            if (hdr.EventDescriptor.Version >= 1) {
-                present->DestWidth  = desc[3].GetData<uint32_t>();
-                present->DestHeight = desc[4].GetData<uint32_t>();
-            }
-
-            Win32KPresentHistoryToken key(CompositionSurfaceLuid, PresentCount, BindId);
-            DebugAssert(mPresentByWin32KPresentHistoryToken.find(key) == mPresentByWin32KPresentHistoryToken.end());
-            mPresentByWin32KPresentHistoryToken[key] = present;
-            present->CompositionSurfaceLuid = CompositionSurfaceLuid;
-            present->Win32KPresentCount = PresentCount;
-            present->Win32KBindId = BindId;
+void PMTraceConsumer::HandleWin32kTokenCompositionSurfaceObject(DecodedEvent const& hdr, uint64_t compositionSurfaceLuid,
+                                                                uint64_t presentCount, uint64_t bindId, bool destSizeValid,
+                                                                uint32_t destWidth, uint32_t destHeight)
+{
+    // Lookup the in-progress present.  It should not have seen any Win32K
+    // events yet, so if it has we assume we looked up a present whose
+    // tracking was lost.
+    std::shared_ptr<PresentEvent> present;
+    for (;;) {
+        present = FindOrCreatePresent(hdr);
+        if (present == nullptr) {
             return;
         }
 
-        case Microsoft_Windows_Win32k::TokenStateChanged_Info::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"CompositionSurfaceLuid" },
-                { L"PresentCount" },
-                { L"BindId" },
-                { L"NewState" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto CompositionSurfaceLuid = desc[0].GetData<uint64_t>();
-            auto PresentCount           = desc[1].GetData<uint32_t>();
-            auto BindId                 = desc[2].GetData<uint64_t>();
-            auto NewState               = desc[3].GetData<uint32_t>();
-
-            Win32KPresentHistoryToken key(CompositionSurfaceLuid, PresentCount, BindId);
-            auto eventIter = mPresentByWin32KPresentHistoryToken.find(key);
-            if (eventIter == mPresentByWin32KPresentHistoryToken.end()) {
-                return;
-            }
-            auto presentEvent = eventIter->second;
+        if (!present->SeenWin32KEvents) {
+            break;
+        }
 
-            switch (NewState) {
-            case (uint32_t) Microsoft_Windows_Win32k::TokenState::InFrame: // Composition is starting
-            {
-                VerboseTraceBeforeModifyingPresent(presentEvent.get());
-                presentEvent->SeenInFrameEvent = true;
+        RemoveLostPresent(present);
+    }
 
-                bool iFlip = mMetadata.GetEventData<BOOL>(pEventRecord, L"IndependentFlip") != 0;
-                if (iFlip && presentEvent->PresentMode == PresentMode::Composed_Flip) {
-                    presentEvent->PresentMode = PresentMode::Hardware_Independent_Flip;
-                }
+    present->PresentMode = PresentMode::Composed_Flip;
+    present->SeenWin32KEvents = true;
 
-                // We won't necessarily see a transition to Discarded for all
-                // presents so we check here instead: if we're compositing a newer
-                // present than the window's last known present, then the last
-                // known one will be discarded.
-                if (presentEvent->Hwnd) {
-                    auto hWndIter = mLastPresentByWindow.find(presentEvent->Hwnd);
-                    if (hWndIter == mLastPresentByWindow.end()) {
-                        mLastPresentByWindow.emplace(presentEvent->Hwnd, presentEvent);
-                    } else if (hWndIter->second != presentEvent) {
-                        auto prevPresent = hWndIter->second;
-                        hWndIter->second = presentEvent;
-
-                        // Even though we know it will be discarded at this point,
-                        // we keep tracking it through the composition steps
-                        // instead of completing it now, to ensure that the
-                        // collector will get presents from each swap chain in
-                        // order.
-                        //
-                        // That said, we do need to remove it from the submit
-                        // sequence id tracking to reduce the likelyhood of id
-                        // collisions during lookup for events that don't reference
-                        // a context.
-                        VerboseTraceBeforeModifyingPresent(prevPresent.get());
-						
-                        // In certain cases like when there are short bursts of presents, 
-                        // we get multiple back to back flips and token tracking thread 
-                        // ends up marking the first frame in the burst as dropped. 
-                        // To fix this issue, we mark the frame as discarded only if 
-                        // the frame already doesn’t have valid ScreenTime. 
-                        if (!HasScreenTime(prevPresent)) {
-                            prevPresent->FinalState = PresentResult::Discarded;
-                        }
+    if (destSizeValid) {
+        present->DestWidth  = destWidth;
+        present->DestHeight = destHeight;
+    }
 
-                        RemovePresentFromSubmitSequenceIdTracking(prevPresent);
-                    }
-                }
-                break;
-            }
+    Win32KPresentHistoryToken key(compositionSurfaceLuid, presentCount, bindId);
+    DebugAssert(mPresentByWin32KPresentHistoryToken.find(key) == mPresentByWin32KPresentHistoryToken.end());
+    mPresentByWin32KPresentHistoryToken[key] = present;
+    present->CompositionSurfaceLuid = compositionSurfaceLuid;
+    present->Win32KPresentCount = presentCount;
+    present->Win32KBindId = bindId;
+}
 
-            case (uint32_t) Microsoft_Windows_Win32k::TokenState::Confirmed: // Present has been submitted
-                // Handle DO_NOT_SEQUENCE presents, which may get marked as confirmed,
-                // if a frame was composed when this token was completed
-                if (presentEvent->FinalState == PresentResult::Unknown &&
-                    (presentEvent->PresentFlags & DXGI_PRESENT_DO_NOT_SEQUENCE) != 0) {
-                    VerboseTraceBeforeModifyingPresent(presentEvent.get());
-                    presentEvent->FinalState = PresentResult::Discarded;
-                    RemovePresentFromSubmitSequenceIdTracking(presentEvent);
-                }
-                if (presentEvent->Hwnd) {
-                    mLastPresentByWindow.erase(presentEvent->Hwnd);
-                }
-                break;
+void PMTraceConsumer::HandleWin32kTokenStateChanged(uint64_t compositionSurfaceLuid, uint64_t presentCount, uint64_t bindId,
+                                                    uint32_t newState, bool independentFlip)
+{
+    Win32KPresentHistoryToken key(compositionSurfaceLuid, presentCount, bindId);
+    auto eventIter = mPresentByWin32KPresentHistoryToken.find(key);
+    if (eventIter == mPresentByWin32KPresentHistoryToken.end()) {
+        return;
+    }
+    auto presentEvent = eventIter->second;
 
-            // Note: Going forward, TokenState::Retired events are no longer
-            // guaranteed to be sent at the end of a frame in multi-monitor
-            // scenarios.  Instead, we use DWM's present stats to understand the
-            // Composed Flip timeline.
-            case (uint32_t) Microsoft_Windows_Win32k::TokenState::Discarded: // Present has been discarded
-            {
-                // Nullptr as we don't want to report clearing the key in the verbose trace
-                VerboseTraceBeforeModifyingPresent(nullptr);
-                presentEvent->CompositionSurfaceLuid = 0;
-                presentEvent->Win32KPresentCount = 0;
-                presentEvent->Win32KBindId = 0;
-                mPresentByWin32KPresentHistoryToken.erase(eventIter);
-
-                if (!presentEvent->SeenInFrameEvent && presentEvent->FinalState == PresentResult::Unknown) {
-                    VerboseTraceBeforeModifyingPresent(presentEvent.get());
-                    presentEvent->FinalState = PresentResult::Discarded;
-                    CompletePresent(presentEvent);
-                } else if (presentEvent->PresentMode != PresentMode::Composed_Flip) {
-                    CompletePresent(presentEvent);
+    switch (newState) {
+    case (uint32_t) Microsoft_Windows_Win32k::TokenState::InFrame: // Composition is starting
+    {
+        VerboseTraceBeforeModifyingPresent(presentEvent.get());
+        presentEvent->SeenInFrameEvent = true;
+
+        if (independentFlip && presentEvent->PresentMode == PresentMode::Composed_Flip) {
+            presentEvent->PresentMode = PresentMode::Hardware_Independent_Flip;
+        }
+
+        // We won't necessarily see a transition to Discarded for all
+        // presents so we check here instead: if we're compositing a newer
+        // present than the window's last known present, then the last
+        // known one will be discarded.
+        if (presentEvent->Hwnd) {
+            auto hWndIter = mLastPresentByWindow.find(presentEvent->Hwnd);
+            if (hWndIter == mLastPresentByWindow.end()) {
+                mLastPresentByWindow.emplace(presentEvent->Hwnd, presentEvent);
+            } else if (hWndIter->second != presentEvent) {
+                auto prevPresent = hWndIter->second;
+                hWndIter->second = presentEvent;
+
+                // Even though we know it will be discarded at this point,
+                // we keep tracking it through the composition steps
+                // instead of completing it now, to ensure that the
+                // collector will get presents from each swap chain in
+                // order.
+                //
+                // That said, we do need to remove it from the submit
+                // sequence id tracking to reduce the likelyhood of id
+                // collisions during lookup for events that don't reference
+                // a context.
+                VerboseTraceBeforeModifyingPresent(prevPresent.get());
+				
+                // In certain cases like when there are short bursts of presents, 
+                // we get multiple back to back flips and token tracking thread 
+                // ends up marking the first frame in the burst as dropped. 
+                // To fix this issue, we mark the frame as discarded only if 
+                // the frame already doesn’t have valid ScreenTime. 
+                if (!HasScreenTime(prevPresent)) {
+                    prevPresent->FinalState = PresentResult::Discarded;
                 }
-                break;
-            }
+
+                RemovePresentFromSubmitSequenceIdTracking(prevPresent);
             }
-            return;
-        }
         }
+        break;
     }
 
-    if (mTrackInput) {
-        switch (hdr.EventDescriptor.Id) {
-        case Microsoft_Windows_Win32k::InputDeviceRead_Stop::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"DeviceType" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto DeviceType = desc[0].GetData<uint32_t>();
-
-            switch (DeviceType) {
-            case 0: mLastInputDeviceType = InputDeviceType::Mouse; break;
-            case 1: mLastInputDeviceType = InputDeviceType::Keyboard; break;
-            default: mLastInputDeviceType = InputDeviceType::Unknown; break;
-            }
-
-            mLastInputDeviceReadTime = hdr.TimeStamp.QuadPart;
-            return;
+    case (uint32_t) Microsoft_Windows_Win32k::TokenState::Confirmed: // Present has been submitted
+        // Handle DO_NOT_SEQUENCE presents, which may get marked as confirmed,
+        // if a frame was composed when this token was completed
+        if (presentEvent->FinalState == PresentResult::Unknown &&
+            (presentEvent->PresentFlags & DXGI_PRESENT_DO_NOT_SEQUENCE) != 0) {
+            VerboseTraceBeforeModifyingPresent(presentEvent.get());
+            presentEvent->FinalState = PresentResult::Discarded;
+            RemovePresentFromSubmitSequenceIdTracking(presentEvent);
+        }
+        if (presentEvent->Hwnd) {
+            mLastPresentByWindow.erase(presentEvent->Hwnd);
         }
+        break;
 
-        case Microsoft_Windows_Win32k::RetrieveInputMessage_Info::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"hwnd" }
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto hWnd = desc[0].GetData<uint64_t>();
-
-            auto ii = mRetrievedInput.find(hdr.ProcessId);
-            if (ii == mRetrievedInput.end()) {
-                InputData data = { mLastInputDeviceReadTime, 0, 0, mLastInputDeviceType, hWnd };
-                auto it = mReceivedMouseClickByHwnd.find(hWnd);
-                if (it != mReceivedMouseClickByHwnd.end()) {
-                    data.MouseClickTime = it->second.CurrentMouseClickTime;
-                    data.XFormTime = it->second.CurrentXFormTime;
-                    it->second.LastMouseClickTime = it->second.CurrentMouseClickTime;
-                    it->second.LastXFormTime = it->second.CurrentXFormTime;
-                }
-                mRetrievedInput.emplace(hdr.ProcessId, data);
-            } else {
-                if (ii->second.Time < mLastInputDeviceReadTime) {
-                    ii->second.Time = mLastInputDeviceReadTime;
-                    ii->second.Type = mLastInputDeviceType;
-                }
-                // We can recieve multiple RetrieveInputMessage_Info events
-                // before we receive an OnInputXformUpdate_Info event. Because
-                // of this if the last device input type was a mouse
-                // check to see if it was a mouse click and update if
-                // necessary
-                if (mLastInputDeviceType == InputDeviceType::Mouse) {
-                    auto it = mReceivedMouseClickByHwnd.find(hWnd);
-                    if (it != mReceivedMouseClickByHwnd.end()) {
-                        if (it->second.LastMouseClickTime < it->second.CurrentMouseClickTime) {
-                            ii->second.MouseClickTime = it->second.CurrentMouseClickTime;
-                            ii->second.XFormTime = it->second.CurrentXFormTime;
-                            it->second.LastMouseClickTime = it->second.CurrentMouseClickTime;
-                            it->second.LastXFormTime = it->second.CurrentXFormTime;
-                        }
-                    }
-                }
-            }
-            return;
+    // Note: Going forward, TokenState::Retired events are no longer
+    // guaranteed to be sent at the end of a frame in multi-monitor
+    // scenarios.  Instead, we use DWM's present stats to understand the
+    // Composed Flip timeline.
+    case (uint32_t) Microsoft_Windows_Win32k::TokenState::Discarded: // Present has been discarded
+    {
+        // Nullptr as we don't want to report clearing the key in the verbose trace
+        VerboseTraceBeforeModifyingPresent(nullptr);
+        presentEvent->CompositionSurfaceLuid = 0;
+        presentEvent->Win32KPresentCount = 0;
+        presentEvent->Win32KBindId = 0;
+        mPresentByWin32KPresentHistoryToken.erase(eventIter);
+
+        if (!presentEvent->SeenInFrameEvent && presentEvent->FinalState == PresentResult::Unknown) {
+            VerboseTraceBeforeModifyingPresent(presentEvent.get());
+            presentEvent->FinalState = PresentResult::Discarded;
+            CompletePresent(presentEvent);
+        } else if (presentEvent->PresentMode != PresentMode::Composed_Flip) {
+            CompletePresent(presentEvent);
         }
+        break;
+    }
+    }
+}
+
+void PMTraceConsumer::HandleWin32kInputDeviceRead(uint64_t timestamp, uint32_t deviceType)
+{
+    switch (deviceType) {
+    case 0: mLastInputDeviceType = InputDeviceType::Mouse; break;
+    case 1: mLastInputDeviceType = InputDeviceType::Keyboard; break;
+    default: mLastInputDeviceType = InputDeviceType::Unknown; break;
+    }
 
-        case Microsoft_Windows_Win32k::OnInputXformUpdate_Info::Id:
-        {
-            EventDataDesc desc[] = {
-                { L"Hwnd" },
-                { L"XformQPCTime"}
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto hWnd = desc[0].GetData<uint64_t>();
-            auto xFormQPCTime = desc[1].GetData<uint64_t>();
+    mLastInputDeviceReadTime = timestamp;
+}
 
+void PMTraceConsumer::HandleWin32kRetrieveInputMessage(uint32_t processId, uint64_t hWnd)
+{
+    auto ii = mRetrievedInput.find(processId);
+    if (ii == mRetrievedInput.end()) {
+        InputData data = { mLastInputDeviceReadTime, 0, 0, mLastInputDeviceType, hWnd };
+        auto it = mReceivedMouseClickByHwnd.find(hWnd);
+        if (it != mReceivedMouseClickByHwnd.end()) {
+            data.MouseClickTime = it->second.CurrentMouseClickTime;
+            data.XFormTime = it->second.CurrentXFormTime;
+            it->second.LastMouseClickTime = it->second.CurrentMouseClickTime;
+            it->second.LastXFormTime = it->second.CurrentXFormTime;
+        }
+        mRetrievedInput.emplace(processId, data);
+    } else {
+        if (ii->second.Time < mLastInputDeviceReadTime) {
+            ii->second.Time = mLastInputDeviceReadTime;
+            ii->second.Type = mLastInputDeviceType;
+        }
+        // We can recieve multiple RetrieveInputMessage_Info events
+        // before we receive an OnInputXformUpdate_Info event. Because
+        // of this if the last device input type was a mouse
+        // check to see if it was a mouse click and update if
+        // necessary
+        if (mLastInputDeviceType == InputDeviceType::Mouse) {
             auto it = mReceivedMouseClickByHwnd.find(hWnd);
             if (it != mReceivedMouseClickByHwnd.end()) {
-                if (it->second.LastMouseClickTime < mLastInputDeviceReadTime) {
-                    it->second.CurrentMouseClickTime = mLastInputDeviceReadTime;
-                    it->second.CurrentXFormTime = xFormQPCTime;
+                if (it->second.LastMouseClickTime < it->second.CurrentMouseClickTime) {
+                    ii->second.MouseClickTime = it->second.CurrentMouseClickTime;
+                    ii->second.XFormTime = it->second.CurrentXFormTime;
+                    it->second.LastMouseClickTime = it->second.CurrentMouseClickTime;
+                    it->second.LastXFormTime = it->second.CurrentXFormTime;
                 }
             }
-            else {
-                MouseClickData data = { mLastInputDeviceReadTime, xFormQPCTime , 0, 0 };
-                mReceivedMouseClickByHwnd.emplace(hWnd, data);
-            }
-
-            return;
-        }
-
         }
     }
-
-    assert(!mFilteredEvents); // Assert that filtering is working if expected
 }
 
-void PMTraceConsumer::HandleDWMEvent(EVENT_RECORD* pEventRecord)
+void PMTraceConsumer::HandleWin32kInputXformUpdate(uint64_t hWnd, uint64_t xFormQPCTime)
 {
-    auto const& hdr = pEventRecord->EventHeader;
-    switch (hdr.EventDescriptor.Id) {
-    case Microsoft_Windows_Dwm_Core::MILEVENT_MEDIA_UCE_PROCESSPRESENTHISTORY_GetPresentHistory_Info::Id:
-        // Move all the latest in-progress Composed_Copy from each window into
-        // mPresentsWaitingForDWM, to be attached to the next DWM present's
-        // DependentPresents.
-        for (auto& hWndPair : mLastPresentByWindow) {
-            auto& present = hWndPair.second;
-            if (present->PresentMode == PresentMode::Composed_Copy_GPU_GDI ||
-                present->PresentMode == PresentMode::Composed_Copy_CPU_GDI) {
-                VerboseTraceBeforeModifyingPresent(present.get());
-                mPresentsWaitingForDWM.emplace_back(present);
-                present->PresentInDwmWaitingStruct = true;
-            }
+    auto it = mReceivedMouseClickByHwnd.find(hWnd);
+    if (it != mReceivedMouseClickByHwnd.end()) {
+        if (it->second.LastMouseClickTime < mLastInputDeviceReadTime) {
+            it->second.CurrentMouseClickTime = mLastInputDeviceReadTime;
+            it->second.CurrentXFormTime = xFormQPCTime;
         }
-        mLastPresentByWindow.clear();
-        break;
-
-    case Microsoft_Windows_Dwm_Core::SCHEDULE_PRESENT_Start::Id:
-        DwmProcessId = hdr.ProcessId;
-        DwmPresentThreadId = hdr.ThreadId;
-        break;
+    }
+    else {
+        MouseClickData data = { mLastInputDeviceReadTime, xFormQPCTime , 0, 0 };
+        mReceivedMouseClickByHwnd.emplace(hWnd, data);
+    }
+}
 
-    // These events are only used for Composed_Copy_CPU_GDI presents.  They are
-    // used to identify when such presents are handed off to DWM. 
-    case Microsoft_Windows_Dwm_Core::FlipChain_Pending::Id:
-    case Microsoft_Windows_Dwm_Core::FlipChain_Complete::Id:
-    case Microsoft_Windows_Dwm_Core::FlipChain_Dirty::Id:
-    {
-        if (InlineIsEqualGUID(hdr.ProviderId, Microsoft_Windows_Dwm_Core::Win7::GUID)) {
-            break;
+void PMTraceConsumer::HandleDwmGetPresentHistory()
+{
+    // Move all the latest in-progress Composed_Copy from each window into
+    // mPresentsWaitingForDWM, to be attached to the next DWM present's
+    // DependentPresents.
+    for (auto& hWndPair : mLastPresentByWindow) {
+        auto& present = hWndPair.second;
+        if (present->PresentMode == PresentMode::Composed_Copy_GPU_GDI ||
+            present->PresentMode == PresentMode::Composed_Copy_CPU_GDI) {
+            VerboseTraceBeforeModifyingPresent(present.get());
+            mPresentsWaitingForDWM.emplace_back(present);
+            present->PresentInDwmWaitingStruct = true;
         }
+    }
+    mLastPresentByWindow.clear();
+}
 
-        // ulFlipChain and ulSerialNumber are expected to be uint32_t data, but
-        // on Windows 8.1 the event properties are specified as uint64_t.
-        auto GetU32FromU32OrU64 = [](EventDataDesc const& desc) {
-            if (desc.size_ == 4) {
-                return desc.GetData<uint32_t>();
-            } else {
-                auto u64 = desc.GetData<uint64_t>();
-                DebugAssert(u64 <= UINT32_MAX);
-                return (uint32_t) u64;
-            }
-        };
-
-        EventDataDesc desc[] = {
-            { L"ulFlipChain" },
-            { L"ulSerialNumber" },
-            { L"hwnd" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-        auto ulFlipChain    = GetU32FromU32OrU64(desc[0]);
-        auto ulSerialNumber = GetU32FromU32OrU64(desc[1]);
-        auto hwnd           = desc[2].GetData<uint64_t>();
-
-        // Lookup the present using the 64-bit token data from the PHT
-        // submission, which is actually two 32-bit data chunks corresponding
-        // to a flip chain id and present id.
-        auto tokenData = ((uint64_t) ulFlipChain << 32ull) | ulSerialNumber;
-        auto flipIter = mPresentByDxgkPresentHistoryTokenData.find(tokenData);
-        if (flipIter != mPresentByDxgkPresentHistoryTokenData.end()) {
-            auto present = flipIter->second;
+void PMTraceConsumer::HandleDwmFlipChain(uint32_t flipChain, uint32_t serialNumber, uint64_t hwnd)
+{
+    // Lookup the present using the 64-bit token data from the PHT
+    // submission, which is actually two 32-bit data chunks corresponding
+    // to a flip chain id and present id.
+    auto tokenData = ((uint64_t) flipChain << 32ull) | serialNumber;
+    auto flipIter = mPresentByDxgkPresentHistoryTokenData.find(tokenData);
+    if (flipIter != mPresentByDxgkPresentHistoryTokenData.end()) {
+        auto present = flipIter->second;
 
-            VerboseTraceBeforeModifyingPresent(present.get());
-            present->DxgkPresentHistoryTokenData = 0;
+        VerboseTraceBeforeModifyingPresent(present.get());
+        present->DxgkPresentHistoryTokenData = 0;
 
-            mLastPresentByWindow[hwnd] = present;
+        mLastPresentByWindow[hwnd] = present;
 
-            mPresentByDxgkPresentHistoryTokenData.erase(flipIter);
-        }
-        break;
-    }
-    case Microsoft_Windows_Dwm_Core::SCHEDULE_SURFACEUPDATE_Info::Id:
-    {
-        // On Windows 8.1 PresentCount is named
-        // OutOfFrameDirectFlipPresentCount, so we look up both allowing one to
-        // be optional and then check which one we found.
-        EventDataDesc desc[] = {
-            { L"luidSurface" },
-            { L"PresentCount" },
-            { L"OutOfFrameDirectFlipPresentCount" },
-            { L"bindId" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc), 1);
-        auto luidSurface  = desc[0].GetData<uint64_t>();
-        auto PresentCount = (desc[1].status_ & PROP_STATUS_FOUND) ? desc[1].GetData<uint64_t>()
-                                                                  : desc[2].GetData<uint64_t>();
-        auto bindId       = desc[3].GetData<uint64_t>();
-
-        Win32KPresentHistoryToken key(luidSurface, PresentCount, bindId);
-        auto eventIter = mPresentByWin32KPresentHistoryToken.find(key);
-        if (eventIter != mPresentByWin32KPresentHistoryToken.end() && eventIter->second->SeenInFrameEvent) {
-            VerboseTraceBeforeModifyingPresent(eventIter->second.get());
-            mPresentsWaitingForDWM.emplace_back(eventIter->second);
-            eventIter->second->PresentInDwmWaitingStruct = true;
-        }
-        break;
+        mPresentByDxgkPresentHistoryTokenData.erase(flipIter);
     }
-    default:
-        assert(!mFilteredEvents || // Assert that filtering is working if expected
-               hdr.ProviderId == Microsoft_Windows_Dwm_Core::Win7::GUID);
-        break;
+}
+
+void PMTraceConsumer::HandleDwmScheduleSurfaceUpdate(uint64_t luidSurface, uint64_t presentCount, uint64_t bindId)
+{
+    Win32KPresentHistoryToken key(luidSurface, presentCount, bindId);
+    auto eventIter = mPresentByWin32KPresentHistoryToken.find(key);
+    if (eventIter != mPresentByWin32KPresentHistoryToken.end() && eventIter->second->SeenInFrameEvent) {
+        VerboseTraceBeforeModifyingPresent(eventIter->second.get());
+        mPresentsWaitingForDWM.emplace_back(eventIter->second);
+        eventIter->second->PresentInDwmWaitingStruct = true;
     }
 }
 
@@ -2046,7 +1599,7 @@ void PMTraceConsumer::RemoveLostPresent(std::shared_ptr<PresentEvent> p)
             }
 
             // Make ready for dequeue
-            UpdateReadyCount(true);
+            UpdateReadyCount();
         }
         // If not waiting for Present_Stop, it should already be cleaned up properly
     }
@@ -2121,7 +1674,7 @@ void PMTraceConsumer::CompletePresent(std::shared_ptr<PresentEvent> const& p)
     // DependentPresents list.
     if (!p->DependentPresents.empty()) {
         if (p->IsLost) {
-            for (auto p2 : p->DependentPresents) {
+            for (auto const& p2 : p->DependentPresents) {
                 VerboseTraceBeforeModifyingPresent(p2.get());
                 p2->IsLost = true;
             }
@@ -2236,10 +1789,6 @@ void PMTraceConsumer::CompletePresent(std::shared_ptr<PresentEvent> const& p)
     // Remove the present from tracking structures.
     StopTrackingPresent(p);
 
-    // lock mutex across this sequence:
-    // 0) Merge present 1) add present to completed 2) update ready count 3) clear out stale deferred frames
-    std::unique_lock<std::mutex> lock(mPresentEventMutex);
-
     // If the present has a PresentFrameType, propagate the QPC data.
     // TODO -> Ascii art
     auto present = p;
@@ -2247,7 +1796,7 @@ void PMTraceConsumer::CompletePresent(std::shared_ptr<PresentEvent> const& p)
     auto appFrameId = p->AppFrameId;
     auto processId = p->ProcessId;
     if (present->WaitingForFrameId) {
-        for (uint32_t i = mReadyCount; i < mCompletedCount; ++i) {
+        for (uint32_t i = 0; i < mCompletedCount; ++i) {
             auto const& p2 = mCompletedPresents[GetRingIndex(mCompletedIndex + i)];
             if (p2->WaitingForFrameId && p2->ProcessId == present->ProcessId) {
                 VerboseTraceBeforeModifyingPresent(p2.get());
@@ -2302,29 +1851,18 @@ void PMTraceConsumer::CompletePresent(std::shared_ptr<PresentEvent> const& p)
     // Add the present to the completed list
     if (present != nullptr) {
         uint32_t index;
-        // if completed buffer is full
+        // if completed buffer is full (i.e., full of deferred presents, since ready presents are
+        // handed off to mReadyPresents as soon as they become ready)
         if (mCompletedCount == mCircularBufferSize) {
-            // if we are in offline ETL processing mode, block instead of overwriting events
-            // unless either A) the buffer is full of non-ready events or B) backpressure disabled via CLI option
-            if (!mIsRealtimeSession && mReadyCount != 0 && !mDisableOfflineBackpressure) {
-                mCompletedRingCondition.wait(lock, [this] { return mCompletedCount < mCircularBufferSize; });
-                index = GetRingIndex(mCompletedIndex + mCompletedCount);
-                mCompletedCount++;
-            }
-            // Completed present overflow routine (when not blocking):
+            // Completed present overflow routine:
             // If the completed list is full, throw away the oldest completed present, if it IsLost; or this
             // present, if it IsLost; or the oldest completed present.
-            else {
-                if (!mCompletedPresents[mCompletedIndex]->IsLost && present->IsLost) {
-                    return;
-                }
-                index = mCompletedIndex;
-                mCompletedIndex = GetRingIndex(mCompletedIndex + 1);
-                if (mReadyCount > 0) {
-                    mReadyCount--;
-                }
-                mNumOverflowedPresents++;
+            if (!mCompletedPresents[mCompletedIndex]->IsLost && present->IsLost) {
+                return;
             }
+            index = mCompletedIndex;
+            mCompletedIndex = GetRingIndex(mCompletedIndex + 1);
+            mNumOverflowedPresents++;
             // otherwise, completed buffer still has available space
         }
         else {
@@ -2332,11 +1870,17 @@ void PMTraceConsumer::CompletePresent(std::shared_ptr<PresentEvent> const& p)
             mCompletedCount++;
         }
         // place the present in the completed presents ring buffer
+        if (mCurrentEventTime != mLastCompletionTime) {
+            mLastCompletionTime = mCurrentEventTime;
+            mNextCompletionSequence = 0;
+        }
+        present->CompletionTime = mCurrentEventTime;
+        present->CompletionSequence = mNextCompletionSequence++;
         mCompletedPresents[index] = present;
     }
 
-    // Update the ready count (do not lock mutex in this function, already locked)
-    UpdateReadyCount(false);
+    // Hand off any presents that are no longer deferred
+    UpdateReadyCount();
 
     // clear out stale deferred frames
     // It's possible for a deferred condition to never be cleared.  e.g., a process' last present
@@ -2344,7 +1888,7 @@ void PMTraceConsumer::CompletePresent(std::shared_ptr<PresentEvent> const& p)
     // subsequent presents from other processes from being dequeued until the ring buffer wraps and
     // forces it out, which is likely longer than we want to wait.  So we check here if there is 
     // a stuck deferred present and clear the deferral if it gets too old.
-    if (mReadyCount == 0 && mCompletedCount > 0) {
+    if (mCompletedCount > 0) {
         auto const& deferredPresent = mCompletedPresents[mCompletedIndex];
         if (presentStartTime >= deferredPresent->PresentStartTime &&
             presentStartTime - deferredPresent->PresentStartTime > mDeferralTimeLimit) {
@@ -2355,7 +1899,7 @@ void PMTraceConsumer::CompletePresent(std::shared_ptr<PresentEvent> const& p)
             }
             deferredPresent->WaitingForFlipFrameType = false;
             StopTrackingPresent(deferredPresent);
-            UpdateReadyCount(false);
+            UpdateReadyCount();
         }
     }
 
@@ -2378,26 +1922,36 @@ void PMTraceConsumer::CompletePresent(std::shared_ptr<PresentEvent> const& p)
     }
 }
 
-void PMTraceConsumer::UpdateReadyCount(bool useLock)
+void PMTraceConsumer::UpdateReadyCount()
 {
+    // Move the oldest completed presents into mReadyPresents until one is found that is still
+    // deferred.  Once handed off, a present is no longer modified by the consumer thread.
     bool newPresentsReady = false;
-    {
-        std::unique_lock<std::mutex> lck{ mPresentEventMutex, std::defer_lock }; 
-        if (useLock) {
-            lck.lock();
+    bool blockWhenFull = !mIsRealtimeSession && !mDisableOfflineBackpressure;
+    for (; mCompletedCount > 0; --mCompletedCount) {
+        auto& p = mCompletedPresents[mCompletedIndex];
+        if (p->WaitingForPresentStop ||
+            p->WaitingForFlipFrameType ||
+            p->WaitingForFrameId) {
+            break;
         }
-        else {
-            assert(!lck.try_lock());
-        }    
-        for (; mReadyCount < mCompletedCount; ++mReadyCount) {
+        if (blockWhenFull) {
+            // In offline ETL processing mode, block instead of dropping events.  Wake the output
+            // thread first so it can drain the presents already handed off.
+            if (newPresentsReady) {
+                SignalEventsReady();
+                newPresentsReady = false;
+            }
+            mReadyPresents.PushWait(std::move(p));
             newPresentsReady = true;
-            auto const& p = mCompletedPresents[GetRingIndex(mCompletedIndex + mReadyCount)];
-            if (p->WaitingForPresentStop ||
-                p->WaitingForFlipFrameType ||
-                p->WaitingForFrameId) {
-                break;
+        } else {
+            // If the user isn't dequeuing fast enough, the oldest present is dropped
+            if (mReadyPresents.PushDropOldest(std::move(p))) {
+                mNumOverflowedPresents++;
             }
+            newPresentsReady = true;
         }
+        mCompletedIndex = GetRingIndex(mCompletedIndex + 1);
     }
     if (newPresentsReady) {
         SignalEventsReady();
@@ -2422,7 +1976,7 @@ std::shared_ptr<PresentEvent> PMTraceConsumer::FindPresentByThreadId(uint32_t th
     return ii == mPresentByThreadId.end() ? std::shared_ptr<PresentEvent>() : ii->second;
 }
 
-std::shared_ptr<PresentEvent> PMTraceConsumer::FindOrCreatePresent(EVENT_HEADER const& hdr)
+std::shared_ptr<PresentEvent> PMTraceConsumer::FindOrCreatePresent(DecodedEvent const& hdr)
 {
     // First, we check if there is an in-progress present that was last
     // operated on from this same thread.
@@ -2464,10 +2018,10 @@ std::shared_ptr<PresentEvent> PMTraceConsumer::FindOrCreatePresent(EVENT_HEADER
     // D3D9) in which case a DxgKrnl event will be the first present-related
     // event we ever see.
     if (IsProcessTrackedForFiltering(hdr.ProcessId)) {
-        present = std::make_shared<PresentEvent>();
+        present = mPresentEventPool.Allocate();
 
         VerboseTraceBeforeModifyingPresent(present.get());
-        present->PresentStartTime = *(uint64_t*) &hdr.TimeStamp;
+        present->PresentStartTime = hdr.TimeStamp;
         present->ProcessId = hdr.ProcessId;
         present->ThreadId = hdr.ThreadId;
 
@@ -2482,7 +2036,7 @@ std::shared_ptr<PresentEvent> PMTraceConsumer::FindOrCreatePresent(EVENT_HEADER
 }
 
 void PMTraceConsumer::TrackPresent(
-    std::shared_ptr<PresentEvent> present,
+    std::shared_ptr<PresentEvent> const& present,
     OrderedPresents* presentsByThisProcess)
 {
     // If there is an existing present that hasn't completed by the time the
@@ -2518,7 +2072,7 @@ void PMTraceConsumer::TrackPresent(
     }
 }
 
-void PMTraceConsumer::RuntimePresentStart(Runtime runtime, EVENT_HEADER const& hdr, uint64_t swapchainAddr,
+void PMTraceConsumer::RuntimePresentStart(Runtime runtime, DecodedEvent const& hdr, uint64_t swapchainAddr,
                                           uint32_t dxgiPresentFlags, int32_t syncInterval)
 {
     // Ignore PRESENT_TEST as it doesn't present, it's used to check if you're
@@ -2527,10 +2081,10 @@ void PMTraceConsumer::RuntimePresentStart(Runtime runtime, EVENT_HEADER const& h
         return;
     }
 
-    auto present = std::make_shared<PresentEvent>();
+    auto present = mPresentEventPool.Allocate();
 
     VerboseTraceBeforeModifyingPresent(present.get());
-    present->PresentStartTime = *(uint64_t*) &hdr.TimeStamp;
+    present->PresentStartTime = hdr.TimeStamp;
     present->ProcessId = hdr.ProcessId;
     present->ThreadId = hdr.ThreadId;
     present->Runtime = runtime;
@@ -2556,7 +2110,7 @@ void PMTraceConsumer::RuntimePresentStart(Runtime runtime, EVENT_HEADER const& h
 // No TRACK_PRESENT instrumentation here because each runtime Present::Start
 // event is instrumented and we assume we'll see the corresponding Stop event
 // for any completed present.
-void PMTraceConsumer::RuntimePresentStop(Runtime runtime, EVENT_HEADER const& hdr, uint32_t result)
+void PMTraceConsumer::RuntimePresentStop(Runtime runtime, DecodedEvent const& hdr, uint32_t result)
 {
     // Present_Start and Present_Stop happen on the same thread, so Lookup the PresentEvent
     // most-recently operated on by the same thread.  If there is none, ignore this event.
@@ -2611,7 +2165,7 @@ void PMTraceConsumer::RuntimePresentStop(Runtime runtime, EVENT_HEADER const& hd
     // Set the runtime and Present_Stop time.
     VerboseTraceBeforeModifyingPresent(present.get());
     present->Runtime = runtime;
-    present->TimeInPresent = *(uint64_t*) &hdr.TimeStamp - present->PresentStartTime;
+    present->TimeInPresent = hdr.TimeStamp - present->PresentStartTime;
 
     // If this present completed early and was deferred until the Present_Stop, then no more
     // analysis is needed; we just clear the deferral.
@@ -2620,7 +2174,7 @@ void PMTraceConsumer::RuntimePresentStop(Runtime runtime, EVENT_HEADER const& hd
         present->WaitingForPresentStop = false;
 
         mPresentByThreadId.erase(eventIter);
-        UpdateReadyCount(true);
+        UpdateReadyCount();
         return;
     }
 
@@ -2673,71 +2227,8 @@ void PMTraceConsumer::RuntimePresentStop(Runtime runtime, EVENT_HEADER const& hd
     mPresentByThreadId.erase(eventIter);
 }
 
-void PMTraceConsumer::HandleProcessEvent(EVENT_RECORD* pEventRecord)
+void PMTraceConsumer::EnqueueProcessEvent(ProcessEvent const& event)
 {
-    auto const& hdr = pEventRecord->EventHeader;
-
-    ProcessEvent event;
-    event.QpcTime = hdr.TimeStamp.QuadPart;
-
-    if (hdr.ProviderId == Microsoft_Windows_Kernel_Process::GUID) {
-        switch (hdr.EventDescriptor.Id) {
-        case Microsoft_Windows_Kernel_Process::ProcessStart_Start::Id: {
-            EventDataDesc desc[] = {
-                { L"ProcessID" },
-                { L"ImageName" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            event.ProcessId     = desc[0].GetData<uint32_t>();
-            auto ImageName      = desc[1].GetData<std::wstring>();
-            event.IsStartEvent  = true;
-
-            // When run as-administrator, ImageName will be a fully-qualified path.
-            // e.g.: \Device\HarddiskVolume...\...\Proces.exe.  We prune off everything other than
-            // the filename here to be consistent.
-            size_t start = ImageName.find_last_of(L'\\') + 1;
-            event.ImageFileName = ImageName.c_str() + start;
-            break;
-        }
-        case Microsoft_Windows_Kernel_Process::ProcessStop_Stop::Id: {
-            EventDataDesc desc[] = {
-                { L"ProcessID" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            event.ProcessId    = desc[0].GetData<uint32_t>();
-            event.IsStartEvent = false;
-
-            break;
-        }
-        default:
-            assert(!mFilteredEvents); // Assert that filtering is working if expected
-            return;
-        }
-    } else { // hdr.ProviderId == NT_Process::GUID
-        if (hdr.EventDescriptor.Opcode == EVENT_TRACE_TYPE_START ||
-            hdr.EventDescriptor.Opcode == EVENT_TRACE_TYPE_DC_START) {
-            EventDataDesc desc[] = {
-                { L"ProcessId" },
-                { L"ImageFileName" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            event.ProcessId     = desc[0].GetData<uint32_t>();
-            std::string str     = desc[1].GetData<std::string>();
-            event.ImageFileName = std::wstring(str.begin(), str.end());
-            event.IsStartEvent  = true;
-        } else if (hdr.EventDescriptor.Opcode == EVENT_TRACE_TYPE_END||
-                   hdr.EventDescriptor.Opcode == EVENT_TRACE_TYPE_DC_END) {
-            EventDataDesc desc[] = {
-                { L"ProcessId" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            event.ProcessId    = desc[0].GetData<uint32_t>();
-            event.IsStartEvent = false;
-        } else {
-            return;
-        }
-    }
-
     {
         std::lock_guard<std::mutex> lock(mProcessEventMutex);
         mProcessEvents.emplace_back(event);
@@ -2745,29 +2236,45 @@ void PMTraceConsumer::HandleProcessEvent(EVENT_RECORD* pEventRecord)
     SignalEventsReady();
 }
 
-InputDeviceType ConvertIntelProviderInputTypes(Intel_PresentMon::InputType ipmInputType) {
-    switch (ipmInputType) {
-    case Intel_PresentMon::InputType::Unspecified:   return InputDeviceType::Unknown;
-    case Intel_PresentMon::InputType::MouseClick:    return InputDeviceType::Mouse;
-    case Intel_PresentMon::InputType::KeyboardClick: return InputDeviceType::Keyboard;
-    }
-    DebugAssert(false);
-    return InputDeviceType::Unknown;
+void PMTraceConsumer::HandleIntelPresentFrameType(uint32_t threadId, uint32_t frameId, FrameType frameType, uint32_t appFrameId)
+{
+    auto event = &mPendingPresentFrameTypeEvents[threadId];
+    event->FrameId = frameId;
+    event->FrameType = frameType;
+    event->AppFrameId = appFrameId;
 }
 
-void PMTraceConsumer::SetAppTimingData(const EVENT_RECORD* pEventRecord) {
-    auto timestamp = pEventRecord->EventHeader.TimeStamp.QuadPart;
-    auto processId = pEventRecord->EventHeader.ProcessId;
+void PMTraceConsumer::HandleIntelFlipFrameType(uint64_t timestamp, uint32_t vidPnSourceId, uint32_t layerIndex, uint64_t presentId, FrameType frameType)
+{
+    // Look up the present associated with this (VidPnSourceId, LayerIndex, PresentId).
+    //
+    // It is possible to see the FlipFrameType event before the MMIOFlipMultiPlaneOverlay3_Info
+    // event, in which case the lookup will fail.  In this case we deferr application of the
+    // FlipFrameType until we see the MMIOFlipMultiPlaneOverlay3_Info event.
+    auto vidPnLayerId = GenerateVidPnLayerId(vidPnSourceId, layerIndex);
+    auto ii = mPresentByVidPnLayerId.find(vidPnLayerId);
+    if (ii == mPresentByVidPnLayerId.end()) {
+        DeferFlipFrameType(vidPnLayerId, presentId, timestamp, frameType);
+        return;
+    }
+
+    auto present = ii->second;
+    auto jj = present->PresentIds.find(vidPnLayerId);
+    if (jj == present->PresentIds.end() || jj->second != presentId) {
+        DeferFlipFrameType(vidPnLayerId, presentId, timestamp, frameType);
+    } else {
+        ApplyFlipFrameType(present, timestamp, frameType);
+    }
+}
 
+void PMTraceConsumer::SetAppTimingData(uint64_t timestamp, uint32_t processId, uint32_t eventId, uint32_t frameId, InputDeviceType inputType) {
     if (processId == DwmProcessId) {
         return;
     }
 
-    switch (pEventRecord->EventHeader.EventDescriptor.Id) {
+    switch (eventId) {
     case Intel_PresentMon::AppSleepStart_Info::Id: {
-        DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::AppSleepStart_Info_Props));
-        auto props = (Intel_PresentMon::AppSleepStart_Info_Props*)pEventRecord->UserData;
-        auto key = std::make_pair(props->FrameId, processId);
+        auto key = std::make_pair(frameId, processId);
         auto ii = mPresentByAppFrameId.find(key);
         if (ii != mPresentByAppFrameId.end()) {
             DebugAssert(ii->second->ProcessId == processId);
@@ -2780,16 +2287,14 @@ void PMTraceConsumer::SetAppTimingData(const EVENT_RECORD* pEventRecord) {
                 AppTimingData data;
                 data.AppSleepStartTime = timestamp;
                 data.ProcessId = processId;
-                data.FrameId = props->FrameId;
+                data.FrameId = frameId;
                 mAppTimingDataByAppFrameId.emplace(key, data);
             }
         }
     }
     break;
     case Intel_PresentMon::AppSleepEnd_Info::Id: {
-        DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::AppSleepEnd_Info_Props));
-        auto props = (Intel_PresentMon::AppSleepEnd_Info_Props*)pEventRecord->UserData;
-        auto key = std::make_pair(props->FrameId, processId);
+        auto key = std::make_pair(frameId, processId);
         auto ii = mPresentByAppFrameId.find(key);
         if (ii != mPresentByAppFrameId.end()) {
             DebugAssert(ii->second->ProcessId == processId);
@@ -2802,16 +2307,14 @@ void PMTraceConsumer::SetAppTimingData(const EVENT_RECORD* pEventRecord) {
                 AppTimingData data;
                 data.AppSleepEndTime = timestamp;
                 data.ProcessId = processId;
-                data.FrameId = props->FrameId;
+                data.FrameId = frameId;
                 mAppTimingDataByAppFrameId.emplace(key, data);
             }
         }
     }
     break;
     case Intel_PresentMon::AppSimulationStart_Info::Id: {
-        DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::AppSimulationStart_Info_Props));
-        auto props = (Intel_PresentMon::AppSimulationStart_Info_Props*)pEventRecord->UserData;
-        auto key = std::make_pair(props->FrameId, processId);
+        auto key = std::make_pair(frameId, processId);
         auto ii = mPresentByAppFrameId.find(key);
         if (ii != mPresentByAppFrameId.end()) {
             DebugAssert(ii->second->ProcessId == processId);
@@ -2824,16 +2327,14 @@ void PMTraceConsumer::SetAppTimingData(const EVENT_RECORD* pEventRecord) {
                 AppTimingData data;
                 data.AppSimStartTime = timestamp;
                 data.ProcessId = processId;
-                data.FrameId = props->FrameId;
+                data.FrameId = frameId;
                 mAppTimingDataByAppFrameId.emplace(key, data);
             }
         }
     }
     break;
     case Intel_PresentMon::AppSimulationEnd_Info::Id: {
-        DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::AppSimulationEnd_Info_Props));
-        auto props = (Intel_PresentMon::AppSimulationEnd_Info_Props*)pEventRecord->UserData;
-        auto key = std::make_pair(props->FrameId, processId);
+        auto key = std::make_pair(frameId, processId);
         auto ii = mPresentByAppFrameId.find(key);
         if (ii != mPresentByAppFrameId.end()) {
             DebugAssert(ii->second->ProcessId == processId);
@@ -2846,16 +2347,14 @@ void PMTraceConsumer::SetAppTimingData(const EVENT_RECORD* pEventRecord) {
                 AppTimingData data;
                 data.AppSimEndTime = timestamp;
                 data.ProcessId = processId;
-                data.FrameId = props->FrameId;
+                data.FrameId = frameId;
                 mAppTimingDataByAppFrameId.emplace(key, data);
             }
         }
     }
     break;
     case Intel_PresentMon::AppRenderSubmitStart_Info::Id: {
-        DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::AppRenderSubmitStart_Info_Props));
-        auto props = (Intel_PresentMon::AppRenderSubmitStart_Info_Props*)pEventRecord->UserData;
-        auto key = std::make_pair(props->FrameId, processId);
+        auto key = std::make_pair(frameId, processId);
         auto ii = mPresentByAppFrameId.find(key);
         if (ii != mPresentByAppFrameId.end()) {
             DebugAssert(ii->second->ProcessId == processId);
@@ -2868,16 +2367,14 @@ void PMTraceConsumer::SetAppTimingData(const EVENT_RECORD* pEventRecord) {
                 AppTimingData data;
                 data.AppRenderSubmitStartTime = timestamp;
                 data.ProcessId = processId;
-                data.FrameId = props->FrameId;
+                data.FrameId = frameId;
                 mAppTimingDataByAppFrameId.emplace(key, data);
             }
         }
     }
     break;
     case Intel_PresentMon::AppRenderSubmitEnd_Info::Id: {
-        DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::AppRenderSubmitEnd_Info_Props));
-        auto props = (Intel_PresentMon::AppRenderSubmitEnd_Info_Props*)pEventRecord->UserData;
-        auto key = std::make_pair(props->FrameId, processId);
+        auto key = std::make_pair(frameId, processId);
         auto ii = mPresentByAppFrameId.find(key);
         if (ii != mPresentByAppFrameId.end()) {
             DebugAssert(ii->second->ProcessId == processId);
@@ -2890,16 +2387,14 @@ void PMTraceConsumer::SetAppTimingData(const EVENT_RECORD* pEventRecord) {
                 AppTimingData data;
                 data.AppRenderSubmitEndTime = timestamp;
                 data.ProcessId = processId;
-                data.FrameId = props->FrameId;
+                data.FrameId = frameId;
                 mAppTimingDataByAppFrameId.emplace(key, data);
             }
         }
     }
     break;
     case Intel_PresentMon::AppPresentStart_Info::Id: {
-        DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::AppPresentStart_Info_Props));
-        auto props = (Intel_PresentMon::AppPresentStart_Info_Props*)pEventRecord->UserData;
-        auto key = std::make_pair(props->FrameId, processId);
+        auto key = std::make_pair(frameId, processId);
         auto ii = mPresentByAppFrameId.find(key);
         if (ii != mPresentByAppFrameId.end()) {
             DebugAssert(ii->second->ProcessId == processId);
@@ -2912,16 +2407,14 @@ void PMTraceConsumer::SetAppTimingData(const EVENT_RECORD* pEventRecord) {
                 AppTimingData data;
                 data.AppPresentStartTime = timestamp;
                 data.ProcessId = processId;
-                data.FrameId = props->FrameId;
+                data.FrameId = frameId;
                 mAppTimingDataByAppFrameId.emplace(key, data);
             }
         }
     }
     break;
     case Intel_PresentMon::AppPresentEnd_Info::Id: {
-        DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::AppPresentEnd_Info_Props));
-        auto props = (Intel_PresentMon::AppPresentEnd_Info_Props*)pEventRecord->UserData;
-        auto key = std::make_pair(props->FrameId, processId);
+        auto key = std::make_pair(frameId, processId);
         auto ii = mPresentByAppFrameId.find(key);
         if (ii != mPresentByAppFrameId.end()) {
             DebugAssert(ii->second->ProcessId == processId);
@@ -2934,32 +2427,30 @@ void PMTraceConsumer::SetAppTimingData(const EVENT_RECORD* pEventRecord) {
                 AppTimingData data;
                 data.AppPresentEndTime = timestamp;
                 data.ProcessId = processId;
-                data.FrameId = props->FrameId;
+                data.FrameId = frameId;
                 mAppTimingDataByAppFrameId.emplace(key, data);
             }
         }
     }
     break;
     case Intel_PresentMon::AppInputSample_Info::Id: {
-        //DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::AppInputSample_Info_Props));
-        auto props = (Intel_PresentMon::AppInputSample_Info_Props*)pEventRecord->UserData;
-        auto key = std::make_pair(props->FrameId, processId);
+        auto key = std::make_pair(frameId, processId);
         auto ii = mPresentByAppFrameId.find(key);
         if (ii != mPresentByAppFrameId.end()) {
             DebugAssert(ii->second->ProcessId == processId);
             ii->second->AppInputSample.first = timestamp;
-            ii->second->AppInputSample.second = ConvertIntelProviderInputTypes(props->InputType);
+            ii->second->AppInputSample.second = inputType;
         } else {
             auto ij = mAppTimingDataByAppFrameId.find(key);
             if (ij != mAppTimingDataByAppFrameId.end()) {
                 ij->second.AppInputSample.first = timestamp;
-                ij->second.AppInputSample.second = ConvertIntelProviderInputTypes(props->InputType);
+                ij->second.AppInputSample.second = inputType;
             } else {
                 AppTimingData data;
                 data.ProcessId = processId;
-                data.FrameId = props->FrameId;
+                data.FrameId = frameId;
                 data.AppInputSample.first = timestamp;
-                data.AppInputSample.second = ConvertIntelProviderInputTypes(props->InputType);
+                data.AppInputSample.second = inputType;
                 mAppTimingDataByAppFrameId.emplace(key, data);
             }
         }
@@ -2968,308 +2459,156 @@ void PMTraceConsumer::SetAppTimingData(const EVENT_RECORD* pEventRecord) {
     }
 }
 
-void PMTraceConsumer::HandleIntelPresentMonEvent(EVENT_RECORD* pEventRecord)
+void PMTraceConsumer::HandlePclMarker(uint64_t timestamp, uint32_t processId, uint32_t marker, uint32_t frameId)
 {
-    if (mTrackFrameType) {
-        switch (pEventRecord->EventHeader.EventDescriptor.Id) {
-        case Intel_PresentMon::PresentFrameType_Info::Id: {
-            if (pEventRecord->EventHeader.EventDescriptor.Version == 0) {
-                DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::PresentFrameType_Info_Props));
-
-                auto props = (Intel_PresentMon::PresentFrameType_Info_Props*)pEventRecord->UserData;
-                auto event = &mPendingPresentFrameTypeEvents[pEventRecord->EventHeader.ThreadId];
-                event->FrameId = props->FrameId;
-                event->FrameType = ConvertPMPFrameTypeToFrameType(props->FrameType);
-                event->AppFrameId = 0;
-            } else if (pEventRecord->EventHeader.EventDescriptor.Version == 1) {
-                DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::PresentFrameType_Info_2_Props));
-
-                auto props = (Intel_PresentMon::PresentFrameType_Info_2_Props*)pEventRecord->UserData;
-                auto event = &mPendingPresentFrameTypeEvents[pEventRecord->EventHeader.ThreadId];
-                event->FrameId = props->FrameId;
-                event->FrameType = ConvertPMPFrameTypeToFrameType(props->FrameType);
-                event->AppFrameId = props->AppFrameId;
-            } else {
-                // Unknown version
-            }
-        }
-        return;
-        case Intel_PresentMon::FlipFrameType_Info::Id:
-            if (mEnableFlipFrameTypeEvents) {
-                DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::FlipFrameType_Info_Props));
-
-                auto props = (Intel_PresentMon::FlipFrameType_Info_Props*) pEventRecord->UserData;
-                auto timestamp = pEventRecord->EventHeader.TimeStamp.QuadPart;
-                auto frameType = ConvertPMPFrameTypeToFrameType(props->FrameType);
-
-                // Look up the present associated with this (VidPnSourceId, LayerIndex, PresentId).
-                //
-                // It is possible to see the FlipFrameType event before the MMIOFlipMultiPlaneOverlay3_Info
-                // event, in which case the lookup will fail.  In this case we deferr application of the
-                // FlipFrameType until we see the MMIOFlipMultiPlaneOverlay3_Info event.
-                auto vidPnLayerId = GenerateVidPnLayerId(props->VidPnSourceId, props->LayerIndex);
-                auto ii = mPresentByVidPnLayerId.find(vidPnLayerId);
-                if (ii == mPresentByVidPnLayerId.end()) {
-                    DeferFlipFrameType(vidPnLayerId, props->PresentId, timestamp, frameType);
-                    return;
-                }
-
-                auto present = ii->second;
-                auto jj = present->PresentIds.find(vidPnLayerId);
-                if (jj == present->PresentIds.end() || jj->second != props->PresentId) {
-                    DeferFlipFrameType(vidPnLayerId, props->PresentId, timestamp, frameType);
-                } else {
-                    ApplyFlipFrameType(present, timestamp, frameType);
-                }
-        }
-        return;
+    switch ((Nvidia_PCL::PCLMarker) marker) {
+    case Nvidia_PCL::PCLMarker::SimulationStart: {
+        auto key = std::make_pair(frameId, processId);
+        auto ij = mPclTimingDataByPclFrameId.find(key);
+        if (ij != mPclTimingDataByPclFrameId.end()) {
+            ij->second.PclSimStartTime = timestamp;
+        } else {
+            AppTimingData data;
+            data.PclSimStartTime = timestamp;
+            data.ProcessId = processId;
+            data.FrameId = frameId;
+            mPclTimingDataByPclFrameId.emplace(key, data);
         }
     }
-
-    if (mTrackPMMeasurements) {
-        switch (pEventRecord->EventHeader.EventDescriptor.Id) {
-        case Intel_PresentMon::MeasuredInput_Info::Id: {
-            EventDataDesc desc[] = {
-                { L"InputType" },
-                { L"Time" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto InputType = desc[0].GetData<uint8_t>();
-            auto Time      = desc[1].GetData<uint64_t>();
-
-            (void) InputType, Time;
-            // TODO
-
-        }   return;
-
-        case Intel_PresentMon::MeasuredScreenChange_Info::Id: {
-            EventDataDesc desc[] = {
-                { L"Time" },
-            };
-            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-            auto Time = desc[0].GetData<uint64_t>();
-
-            (void) Time;
-            // TODO
-
-        }   return;
+    break;
+    case Nvidia_PCL::PCLMarker::SimulationEnd: {
+        auto key = std::make_pair(frameId, processId);
+        auto ij = mPclTimingDataByPclFrameId.find(key);
+        if (ij != mPclTimingDataByPclFrameId.end()) {
+            ij->second.PclSimEndTime = timestamp;
+        } else {
+            AppTimingData data;
+            data.PclSimEndTime = timestamp;
+            data.ProcessId = processId;
+            data.FrameId = frameId;
+            mPclTimingDataByPclFrameId.emplace(key, data);
         }
     }
-
-
-    if (mTrackAppTiming) {
-        SetAppTimingData(pEventRecord);
-        return;
+    break;
+    case Nvidia_PCL::PCLMarker::RenderSubmitStart: {
+        auto key = std::make_pair(frameId, processId);
+        auto ij = mPclTimingDataByPclFrameId.find(key);
+        if (ij != mPclTimingDataByPclFrameId.end()) {
+            ij->second.PclRenderSubmitStartTime = timestamp;
+        } else {
+            AppTimingData data;
+            data.PclRenderSubmitStartTime = timestamp;
+            data.ProcessId = processId;
+            data.FrameId = frameId;
+            mPclTimingDataByPclFrameId.emplace(key, data);
+        }
     }
-
-    assert(!mFilteredEvents); // Assert that filtering is working if expected
-}
-
-void PMTraceConsumer::HandleTraceLoggingEvent(EVENT_RECORD* pEventRecord)
-{
-    if (mTrackPcLatency) {
-        HandlePclEvent(pEventRecord);
+    break;
+    case Nvidia_PCL::PCLMarker::RenderSubmitEnd: {
+        auto key = std::make_pair(frameId, processId);
+        auto ij = mPclTimingDataByPclFrameId.find(key);
+        if (ij != mPclTimingDataByPclFrameId.end()) {
+            ij->second.PclRenderSubmitEndTime = timestamp;
+        } else {
+            AppTimingData data;
+            data.PclRenderSubmitEndTime = timestamp;
+            data.ProcessId = processId;
+            data.FrameId = frameId;
+            mPclTimingDataByPclFrameId.emplace(key, data);
+        }
     }
-}
-
-void PMTraceConsumer::HandlePclEvent(EVENT_RECORD* pEventRecord)
-{
-    try {
-        if (!mTraceLoggingDecoder.DecodeTraceLoggingEventRecord(pEventRecord)) {
-            pmlog_dbg("Failed to decode trace logging event"); // too spammy?
-            return;
+    break;
+    case Nvidia_PCL::PCLMarker::PresentStart: {
+        auto key = std::make_pair(frameId, processId);
+        auto ij = mPclTimingDataByPclFrameId.find(key);
+        if (ij != mPclTimingDataByPclFrameId.end()) {
+            ij->second.PclPresentStartTime = timestamp;
+        } else {
+            AppTimingData data;
+            data.PclPresentStartTime = timestamp;
+            data.ProcessId = processId;
+            data.FrameId = frameId;
+            mPclTimingDataByPclFrameId.emplace(key, data);
         }
-
-        auto eventName = mTraceLoggingDecoder.GetEventName();
-        if (!eventName.has_value()) {
-            pmlog_warn("Could not get trace logging event name");
-            return;
+    }
+    break;
+    case Nvidia_PCL::PCLMarker::PresentEnd: {
+        auto key = std::make_pair(frameId, processId);
+        auto ij = mPclTimingDataByPclFrameId.find(key);
+        if (ij != mPclTimingDataByPclFrameId.end()) {
+            ij->second.PclPresentEndTime = timestamp;
+        } else {
+            AppTimingData data;
+            data.PclPresentEndTime = timestamp;
+            data.ProcessId = processId;
+            data.FrameId = frameId;
+            mPclTimingDataByPclFrameId.emplace(key, data);
         }
-
-        if (eventName.has_value()) {
-            if (eventName.value() == L"PCLStatsInit" ||
-                eventName.value() == L"ReflexStatsInit") {
-                pmlog_info("Received init event: " + pmon::util::str::ToNarrow(*eventName));
+    }
+    break;
+    case Nvidia_PCL::PCLMarker::PCLLatencyPing: {
+        auto key = std::make_pair(frameId, processId);
+        auto ij = mPclTimingDataByPclFrameId.find(key);
+        if (ij != mPclTimingDataByPclFrameId.end()) {
+            ij->second.PclInputReceivedTime = timestamp;
+            ij->second.PclInputPingTime = mLatestPingTimestampByProcessId[processId];
+            if (mLatestPingTimestampByProcessId[processId] != 0) {
+                ij->second.PclInputPingTime = mLatestPingTimestampByProcessId[processId];
+                mLatestPingTimestampByProcessId[processId] = 0;
             }
-            else if (eventName.value() == L"PCLStatsEvent" || 
-                     eventName.value() == L"ReflexStatsEvent") {
-                auto marker = (Nvidia_PCL::PCLMarker)mTraceLoggingDecoder.GetNumericPropertyValue<uint32_t>(L"Marker");
-                auto frameId = (uint32_t)mTraceLoggingDecoder.GetNumericPropertyValue<uint64_t>(L"FrameID");
-                switch (marker) {
-                case Nvidia_PCL::PCLMarker::SimulationStart: {
-                    auto processId = pEventRecord->EventHeader.ProcessId;
-                    auto timestamp = pEventRecord->EventHeader.TimeStamp.QuadPart;
-                    auto key = std::make_pair(frameId, processId);
-                    auto ij = mPclTimingDataByPclFrameId.find(key);
-                    if (ij != mPclTimingDataByPclFrameId.end()) {
-                        ij->second.PclSimStartTime = timestamp;
-                    } else {
-                        AppTimingData data;
-                        data.PclSimStartTime = timestamp;
-                        data.ProcessId = processId;
-                        data.FrameId = frameId;
-                        mPclTimingDataByPclFrameId.emplace(key, data);
-                    }
-                }
-                break;
-                case Nvidia_PCL::PCLMarker::SimulationEnd: {
-                    auto processId = pEventRecord->EventHeader.ProcessId;
-                    auto timestamp = pEventRecord->EventHeader.TimeStamp.QuadPart;
-                    auto key = std::make_pair(frameId, processId);
-                    auto ij = mPclTimingDataByPclFrameId.find(key);
-                    if (ij != mPclTimingDataByPclFrameId.end()) {
-                        ij->second.PclSimEndTime = timestamp;
-                    } else {
-                        AppTimingData data;
-                        data.PclSimEndTime = timestamp;
-                        data.ProcessId = processId;
-                        data.FrameId = frameId;
-                        mPclTimingDataByPclFrameId.emplace(key, data);
-                    }
-                }
-                break;
-                case Nvidia_PCL::PCLMarker::RenderSubmitStart: {
-                    auto processId = pEventRecord->EventHeader.ProcessId;
-                    auto timestamp = pEventRecord->EventHeader.TimeStamp.QuadPart;
-                    auto key = std::make_pair(frameId, processId);
-                    auto ij = mPclTimingDataByPclFrameId.find(key);
-                    if (ij != mPclTimingDataByPclFrameId.end()) {
-                        ij->second.PclRenderSubmitStartTime = timestamp;
-                    } else {
-                        AppTimingData data;
-                        data.PclRenderSubmitStartTime = timestamp;
-                        data.ProcessId = processId;
-                        data.FrameId = frameId;
-                        mPclTimingDataByPclFrameId.emplace(key, data);
-                    }
-                }
-                break;
-                case Nvidia_PCL::PCLMarker::RenderSubmitEnd: {
-                    auto processId = pEventRecord->EventHeader.ProcessId;
-                    auto timestamp = pEventRecord->EventHeader.TimeStamp.QuadPart;
-                    auto key = std::make_pair(frameId, processId);
-                    auto ij = mPclTimingDataByPclFrameId.find(key);
-                    if (ij != mPclTimingDataByPclFrameId.end()) {
-                        ij->second.PclRenderSubmitEndTime = timestamp;
-                    } else {
-                        AppTimingData data;
-                        data.PclRenderSubmitEndTime = timestamp;
-                        data.ProcessId = processId;
-                        data.FrameId = frameId;
-                        mPclTimingDataByPclFrameId.emplace(key, data);
-                    }
-                }
-                break;
-                case Nvidia_PCL::PCLMarker::PresentStart: {
-                    auto processId = pEventRecord->EventHeader.ProcessId;
-                    auto timestamp = pEventRecord->EventHeader.TimeStamp.QuadPart;
-                    auto key = std::make_pair(frameId, processId);
-                    auto ij = mPclTimingDataByPclFrameId.find(key);
-                    if (ij != mPclTimingDataByPclFrameId.end()) {
-                        ij->second.PclPresentStartTime = timestamp;
-                    } else {
-                        AppTimingData data;
-                        data.PclPresentStartTime = timestamp;
-                        data.ProcessId = processId;
-                        data.FrameId = frameId;
-                        mPclTimingDataByPclFrameId.emplace(key, data);
-                    }
-                }
-                break;
-                case Nvidia_PCL::PCLMarker::PresentEnd: {
-                    auto processId = pEventRecord->EventHeader.ProcessId;
-                    auto timestamp = pEventRecord->EventHeader.TimeStamp.QuadPart;
-                    auto key = std::make_pair(frameId, processId);
-                    auto ij = mPclTimingDataByPclFrameId.find(key);
-                    if (ij != mPclTimingDataByPclFrameId.end()) {
-                        ij->second.PclPresentEndTime = timestamp;
-                    } else {
-                        AppTimingData data;
-                        data.PclPresentEndTime = timestamp;
-                        data.ProcessId = processId;
-                        data.FrameId = frameId;
-                        mPclTimingDataByPclFrameId.emplace(key, data);
-                    }
-                }
-                break;
-                case Nvidia_PCL::PCLMarker::PCLLatencyPing: {
-                    auto processId = pEventRecord->EventHeader.ProcessId;
-                    auto timestamp = pEventRecord->EventHeader.TimeStamp.QuadPart;
-                    auto key = std::make_pair(frameId, processId);
-                    auto ij = mPclTimingDataByPclFrameId.find(key);
-                    if (ij != mPclTimingDataByPclFrameId.end()) {
-                        ij->second.PclInputReceivedTime = timestamp;
-                        ij->second.PclInputPingTime = mLatestPingTimestampByProcessId[processId];
-                        if (mLatestPingTimestampByProcessId[processId] != 0) {
-                            ij->second.PclInputPingTime = mLatestPingTimestampByProcessId[processId];
-                            mLatestPingTimestampByProcessId[processId] = 0;
-                        }
-                    } else {
-                        AppTimingData data;
-                        data.PclInputReceivedTime = timestamp;
-                        if (mLatestPingTimestampByProcessId[processId] != 0) {
-                            data.PclInputPingTime = mLatestPingTimestampByProcessId[processId];
-                            mLatestPingTimestampByProcessId[processId] = 0;
-                        }
-                        data.ProcessId = processId;
-                        mPclTimingDataByPclFrameId.emplace(key, data);
-                    }
-                }
-                break;
-                case Nvidia_PCL::PCLMarker::OutOfBandPresentStart: {
-                    auto processId = pEventRecord->EventHeader.ProcessId;
-                    auto timestamp = pEventRecord->EventHeader.TimeStamp.QuadPart;
-                    // If we receive an out of band present start, we will use it
-                    // to attach the pcl timing data to the present
-                    mUsingOutOfBoundPresentStart = true;
-                    auto key = std::make_pair(frameId, processId);
-                    // We do not track the out of band present in the same way as the other markers.
-                    // We only use it in an attempt to attach the pcl timing data to the present
-                    auto ij = mPclTimingDataByPclFrameId.find(key);
-                    if (ij != mPclTimingDataByPclFrameId.end()) {
-                        if (ij->second.PclOutOfBandPresentStartTime == 0) {
-                            ij->second.PclOutOfBandPresentStartTime = timestamp;
-                        }
-                    }
-                    else {
-                        AppTimingData data;
-                        data.PclOutOfBandPresentStartTime = timestamp;
-                        data.ProcessId = processId;
-                        data.FrameId = frameId;
-                        mPclTimingDataByPclFrameId.emplace(key, data);
-                    }
-
-                }
-                break;
-                }
-            } else if (eventName.value() == L"PCLStatsInput" ||
-                       eventName.value() == L"ReflexStatsInput") {
-                auto processId = pEventRecord->EventHeader.ProcessId;
-                auto timestamp = pEventRecord->EventHeader.TimeStamp.QuadPart;
-                mLatestPingTimestampByProcessId[processId] = timestamp;
-
-            } else if (eventName.value() == L"PCLStatsShutdown" ||
-                       eventName.value() == L"ReflexStatsShutdown") {
-                // PCL stats is shutting down for this process. Remove
-                // all PCL tracking structure for this process id. 
-                pmlog_info("Shutting down PCL stats tracking");
-                auto processId = pEventRecord->EventHeader.ProcessId;
-                std::erase_if(mPclTimingDataByPclFrameId, [processId](const auto& p) {
-                    return p.first.second == processId; });
-                std::erase_if(mLatestPingTimestampByProcessId, [processId](const auto& p) {
-                    return p.first == processId; });
-
+        } else {
+            AppTimingData data;
+            data.PclInputReceivedTime = timestamp;
+            if (mLatestPingTimestampByProcessId[processId] != 0) {
+                data.PclInputPingTime = mLatestPingTimestampByProcessId[processId];
+                mLatestPingTimestampByProcessId[processId] = 0;
             }
-            else {
-                // unhandled trace event => ignore
+            data.ProcessId = processId;
+            mPclTimingDataByPclFrameId.emplace(key, data);
+        }
+    }
+    break;
+    case Nvidia_PCL::PCLMarker::OutOfBandPresentStart: {
+        // If we receive an out of band present start, we will use it
+        // to attach the pcl timing data to the present
+        mUsingOutOfBoundPresentStart = true;
+        auto key = std::make_pair(frameId, processId);
+        // We do not track the out of band present in the same way as the other markers.
+        // We only use it in an attempt to attach the pcl timing data to the present
+        auto ij = mPclTimingDataByPclFrameId.find(key);
+        if (ij != mPclTimingDataByPclFrameId.end()) {
+            if (ij->second.PclOutOfBandPresentStartTime == 0) {
+                ij->second.PclOutOfBandPresentStartTime = timestamp;
             }
         }
+        else {
+            AppTimingData data;
+            data.PclOutOfBandPresentStartTime = timestamp;
+            data.ProcessId = processId;
+            data.FrameId = frameId;
+            mPclTimingDataByPclFrameId.emplace(key, data);
+        }
+
     }
-    catch (...) {
-        pmlog_error(pmon::util::ReportException());
+    break;
     }
 }
 
+void PMTraceConsumer::HandlePclInput(uint64_t timestamp, uint32_t processId)
+{
+    mLatestPingTimestampByProcessId[processId] = timestamp;
+}
+
+void PMTraceConsumer::HandlePclShutdown(uint32_t processId)
+{
+    // PCL stats is shutting down for this process. Remove
+    // all PCL tracking structure for this process id. 
+    std::erase_if(mPclTimingDataByPclFrameId, [processId](const auto& p) {
+        return p.first.second == processId; });
+    std::erase_if(mLatestPingTimestampByProcessId, [processId](const auto& p) {
+        return p.first == processId; });
+}
+
 void PMTraceConsumer::DeferFlipFrameType(
     uint64_t vidPnLayerId,
     uint64_t presentId,
@@ -3292,7 +2631,7 @@ void PMTraceConsumer::ApplyFlipFrameType(
 {
     DebugAssert(frameType != FrameType::NotSet);
 
-    for (auto p2 : present->DependentPresents) {
+    for (auto const& p2 : present->DependentPresents) {
         if (p2->FinalState != PresentResult::Discarded) {
             VerboseTraceBeforeModifyingPresent(p2.get());
             SetScreenTime(p2, timestamp, frameType);
@@ -3321,12 +2660,9 @@ void PMTraceConsumer::ApplyPresentFrameType(
 // TODO: consider separating process and present events, would reduce unneccessary mutex locking
 void PMTraceConsumer::SignalEventsReady()
 {
+#ifdef _WIN32
     SetEvent(hEventsReadyEvent);
-}
-
-void PMTraceConsumer::HandleMetadataEvent(EVENT_RECORD* pEventRecord)
-{
-    mMetadata.AddMetadata(pEventRecord);
+#endif
 }
 
 void PMTraceConsumer::AddTrackedProcessForFiltering(uint32_t processID)
@@ -3367,22 +2703,51 @@ void PMTraceConsumer::DequeueProcessEvents(std::vector<ProcessEvent>& outProcess
 void PMTraceConsumer::DequeuePresentEvents(std::vector<std::shared_ptr<PresentEvent>>& outPresentEvents)
 {
     outPresentEvents.clear();
-    {
-        std::lock_guard<std::mutex> lock(mPresentEventMutex);
-        if (mReadyCount > 0) {
-            outPresentEvents.resize(mReadyCount, nullptr);
-            for (uint32_t i = 0; i < mReadyCount; ++i) {
-                std::swap(outPresentEvents[i], mCompletedPresents[mCompletedIndex]);
-                mCompletedIndex = GetRingIndex(mCompletedIndex + 1);
-            }
+    outPresentEvents.resize(mReadyPresents.ReadableCount());
+    outPresentEvents.resize(DequeuePresentEvents(std::span(outPresentEvents)));
+}
 
-            mCompletedCount -= mReadyCount;
-            mReadyCount = 0;
-        }
-    }
-    if (!mIsRealtimeSession && !mDisableOfflineBackpressure) {
-        mCompletedRingCondition.notify_one();
-    }
+size_t PMTraceConsumer::DequeuePresentEvents(std::span<std::shared_ptr<PresentEvent>> outPresentEvents)
+{
+    return mReadyPresents.PopBatch(outPresentEvents.data(), outPresentEvents.size());
+}
+
+size_t PMTraceConsumer::HashTrackedPresents() const
+{
+    using pmon::util::hash::HashCombine;
+
+    // The present hashes are summed so that the result doesn't depend on where in the rings the
+    // presents are stored.
+    auto hashPresent = [](PresentEvent const& p) {
+        size_t h = std::hash<uint64_t>{}(p.PresentStartTime);
+        h = HashCombine(h, std::hash<uint64_t>{}(p.SwapChainAddress));
+        h = HashCombine(h, std::hash<uint32_t>{}(p.ProcessId));
+        h = HashCombine(h, std::hash<uint32_t>{}(p.ThreadId));
+        h = HashCombine(h, std::hash<uint32_t>{}((uint32_t) p.PresentMode));
+        h = HashCombine(h, std::hash<uint32_t>{}((uint32_t) p.FinalState));
+        h = HashCombine(h, std::hash<uint64_t>{}(p.ReadyTime));
+        h = HashCombine(h, std::hash<size_t>{}(p.Displayed.size()));
+        h = HashCombine(h, std::hash<uint64_t>{}(p.CompletionTime));
+        h = HashCombine(h, std::hash<uint32_t>{}(p.CompletionSequence));
+        h = HashCombine(h, std::hash<bool>{}(p.IsCompleted));
+        h = HashCombine(h, std::hash<bool>{}(p.IsLost));
+        return h;
+    };
+
+    size_t count = 0;
+    size_t sum = 0;
+    for (auto const& p : mTrackedPresents) {
+        if (p != nullptr) {
+            sum += hashPresent(*p);
+            count += 1;
+        }
+    }
+    for (uint32_t i = 0; i < mCompletedCount; ++i) {
+        sum += hashPresent(*mCompletedPresents[GetRingIndex(mCompletedIndex + i)]);
+        count += 1;
+    }
+
+    return HashCombine(std::hash<size_t>{}(count), sum);
 }
 AppTimingData* PMTraceConsumer::ExtractAppTimingData(
     std::unordered_map<std::pair<uint32_t, uint32_t>, AppTimingData, PairHash<uint32_t, uint32_t>>& timingDataByFrameId,
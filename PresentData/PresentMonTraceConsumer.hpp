@@ -18,16 +18,29 @@
 #include <unordered_map>
 #include <vector>
 #include <set>
+#include <span>
 #include <unordered_set>
+#include <functional>
+
+// Only the ETW decoding (see PresentMonTraceDecoder.cpp) needs Windows; the present tracking
+// state machine is driven by DecodedEvents and builds anywhere, e.g. to replay a recording.
+#ifdef _WIN32
 #include <windows.h>
 #include <evntcons.h> // must include after windows.h
-#include <functional>
+#endif
 
 #include "Debug.hpp"
+#include "DecodedEvent.hpp"
 #include "GpuTrace.hpp"
+#ifdef _WIN32
 #include "TraceConsumer.hpp"
+#endif
 #include "NvidiaTraceConsumer.hpp"
+#include "PresentEventPool.hpp"
+#include "SpscRing.hpp"
+#include "../IntelPresentMon/CommonUtilities/FlatHashMap.h"
 #include "../IntelPresentMon/CommonUtilities/Hash.h"
+#include "../IntelPresentMon/CommonUtilities/InlineVector.h"
 
 // PresentMode represents the different paths a present can take on windows.
 //
@@ -149,14 +162,14 @@ struct MouseClickData {
 
 struct PresentFrameTypeEvent {
     uint32_t FrameId = 0;
-    FrameType FrameType = FrameType::NotSet;
+    enum FrameType FrameType = FrameType::NotSet;
     uint32_t AppFrameId = 0;
 };
 
 struct FlipFrameTypeEvent {
     uint64_t PresentId;
     uint64_t Timestamp;
-    FrameType FrameType;
+    enum FrameType FrameType;
 };
 
 // Structure used to track application provided timing information 
@@ -243,8 +256,9 @@ struct PresentEvent {
     int32_t SyncInterval;
     uint32_t PresentFlags;
 
-    // (FrameType, DisplayedQPC) for each time the frame was displayed
-    std::vector<std::pair<FrameType, uint64_t>> Displayed;
+    // (FrameType, DisplayedQPC) for each time the frame was displayed.  Most presents are displayed
+    // at most a few times, so the storage is inline to avoid a heap allocation per present.
+    pmon::util::InlineVector<std::pair<FrameType, uint64_t>, 4> Displayed;
 
     // Keys used to index into PMTraceConsumer's tracking data structures:
     uint64_t CompositionSurfaceLuid;      // mPresentByWin32KPresentHistoryToken
@@ -256,7 +270,7 @@ struct PresentEvent {
     uint64_t Hwnd;                        // mLastPresentByWindow
     uint32_t QueueSubmitSequence;         // mPresentBySubmitSequence
     uint32_t RingIndex;                   // mTrackedPresents and mCompletedPresents
-    std::unordered_map<uint64_t, uint64_t> PresentIds; // mPresentByVidPnLayerId
+    pmon::util::InlineMap<uint64_t, uint64_t, 2> PresentIds; // mPresentByVidPnLayerId (VidPnLayerId -> PresentId)
     // Note: the following index tracking structures as well but are defined elsewhere:
     //       ProcessId                 -> mOrderedPresentsByProcessId
     //       ThreadId, DriverThreadId  -> mPresentByThreadId
@@ -273,8 +287,8 @@ struct PresentEvent {
 
     uint32_t FrameId;           // ID for the logical frame that this Present is associated with.
 
-    Runtime Runtime;            // Whether PresentStart originated from D3D9, DXGI, or DXGK.
-    PresentMode PresentMode;
+    enum Runtime Runtime;       // Whether PresentStart originated from D3D9, DXGI, or DXGK.
+    enum PresentMode PresentMode;
     PresentResult FinalState;
     InputDeviceType InputType;
     bool SupportsTearing;
@@ -313,6 +327,11 @@ struct PresentEvent {
     uint64_t FlipDelay = 0;
     uint32_t FlipToken = 0;
 
+    // Position of the present in the order presents are dequeued: the timestamp of the event that
+    // completed it, and its order among the presents completed by events with that timestamp.
+    uint64_t CompletionTime = 0;
+    uint32_t CompletionSequence = 0;
+
     PresentEvent();
     PresentEvent(uint32_t fid);
 private:
@@ -368,9 +387,20 @@ struct PMTraceConsumer
     //
     // PresentEvents from each swapchain are ordered by their PresentStart time, but presents from
     // separate swapchains may appear out of order.
+    //
+    // DequeuePresentEvents() must only be called from a single thread at a time.  The span overload
+    // dequeues at most outPresentEvents.size() presents into caller-owned storage and returns the
+    // number written.
 
     void DequeueProcessEvents(std::vector<ProcessEvent>& outProcessEvents);
     void DequeuePresentEvents(std::vector<std::shared_ptr<PresentEvent>>& outPresentEvents);
+    size_t DequeuePresentEvents(std::span<std::shared_ptr<PresentEvent>> outPresentEvents);
+
+    // Returns a hash of the presents the consumer is tracking (the in-progress presents, and the
+    // completed presents that are still deferred), independent of the order they are stored in.
+    // Two consumers with the same hash have the same presents left to complete.  This must be
+    // called from the consumer thread.
+    size_t HashTrackedPresents() const;
 
 
     // -------------------------------------------------------------------------------------------
@@ -381,18 +411,19 @@ struct PMTraceConsumer
     std::vector<ProcessEvent> mProcessEvents;
     std::vector<std::shared_ptr<PresentEvent>> mTrackedPresents;
     std::vector<std::shared_ptr<PresentEvent>> mCompletedPresents;
+    SpscRing<std::shared_ptr<PresentEvent>> mReadyPresents;
     uint32_t mNextFreeRingIndex = 0;    // The index of mTrackedPresents to use when creating the next present.
     uint32_t mCompletedIndex = 0;       // The index of mCompletedPresents of the oldest completed present.
     uint32_t mCompletedCount = 0;       // The total number of presents in mCompletedPresents.
-    uint32_t mReadyCount = 0;           // The number of presents in mCompletedPresents, starting at mCompletedIndex, that are ready to be dequeued.
     uint32_t mNumOverflowedPresents = 0; // The number of presents that have been lost due to the ring buffer wrapping.
     uint32_t mCircularBufferSize = 0;   // The size of the ring buffers for presents.
 
-    // Mutexs to protect consumer/dequeue access from different threads:
+    // Slab storage that all PresentEvents are allocated from (see PresentEventPool.hpp).
+    PresentEventPool mPresentEventPool;
+
+    // Mutex to protect consumer/dequeue access to mProcessEvents from different threads:
     std::mutex mProcessEventMutex;
-    std::mutex mPresentEventMutex;
-    // condition variable to signal when output ring space becomes available, used for backpressure in offline mode
-    std::condition_variable mCompletedRingCondition;
+#ifdef _WIN32
     // event used to signal when new events are available for dequeing
     HANDLE hEventsReadyEvent;
 
@@ -401,6 +432,7 @@ struct PMTraceConsumer
 
     // TraceLoggingContext decodes trace logging events and allows for easy property retrieval.
     TraceLoggingContext mTraceLoggingDecoder;
+#endif
 
     // Limit tracking to specified processes
     std::set<uint32_t> mTrackedProcessFilter;
@@ -410,6 +442,12 @@ struct PMTraceConsumer
     // providers have started and it's safe to start tracking presents.
     bool mHasCompletedAPresent = false;
 
+    // Timestamp of the event being handled, and the number of presents completed so far by events
+    // with that timestamp.  Used to set PresentEvent::CompletionTime/CompletionSequence.
+    uint64_t mCurrentEventTime = 0;
+    uint64_t mLastCompletionTime = 0;
+    uint32_t mNextCompletionSequence = 0;
+
     // Store the DWM process id, and the last DWM thread id to have started a present.  This is
     // needed to determine if a flip event is coming from DWM, but can also be useful for targetting
     // non-DWM processes.
@@ -432,8 +470,13 @@ struct PMTraceConsumer
     // is the index of the element to use when creating the next present.
     //
     // Once presents are completed, they are moved into the mCompletedPresents ring buffer.
-    // mCompletedIndex and mCompletedCount specify a list of presents are ready to be dequeued by
-    // the user.
+    // mCompletedIndex and mCompletedCount specify the completed presents that are still deferred
+    // waiting for data (mCompletedPresents is only accessed by the consumer thread).  Once the
+    // oldest completed presents are no longer deferred they are handed off to the user through the
+    // mReadyPresents single-producer/single-consumer ring, which DequeuePresentEvents() reads
+    // without locking.  In offline analysis the consumer thread blocks while mReadyPresents is full
+    // (unless mDisableOfflineBackpressure), otherwise the oldest present in mReadyPresents is
+    // dropped to make room.
     //
     // mPresentByThreadId stores the in-progress present that was last operated on by each thread.
     // This is used to look up the right present for event sequences that are known to execute on
@@ -486,21 +529,30 @@ struct PMTraceConsumer
         }
     };
 
-    std::unordered_map<uint32_t, std::shared_ptr<PresentEvent>> mPresentByThreadId;                     // ThreadId -> PresentEvent
+    // Typically there is exactly one present per submit sequence id, so the per-hContext presents
+    // are stored inline in the mPresentBySubmitSequence entry.
+    using PresentsByContext = pmon::util::InlineMap<uint64_t, std::shared_ptr<PresentEvent>, 1>;
+
+    // The present lookup tables below are on the hot path of nearly every event, and see an insert
+    // and erase per present, so they use flat open-addressing tables rather than
+    // std::unordered_map.  Note that erasing from a FlatHashMap may relocate other entries, so
+    // iterators into these tables must not be held across calls that can stop tracking a present.
+    template<typename K, typename Hash = std::hash<K>>
+    using PresentIndex = pmon::util::FlatHashMap<K, std::shared_ptr<PresentEvent>, Hash>;
+
+    PresentIndex<uint32_t>                                      mPresentByThreadId;                     // ThreadId -> PresentEvent
     std::unordered_map<uint32_t, OrderedPresents>               mOrderedPresentsByProcessId;            // ProcessId -> ordered PresentStartTime -> PresentEvent
-    std::unordered_map<uint32_t, std::unordered_map<uint64_t, std::shared_ptr<PresentEvent>>>
-                                                                mPresentBySubmitSequence;               // SubmitSequenceId -> hContext -> PresentEvent
-    std::unordered_map<Win32KPresentHistoryToken, std::shared_ptr<PresentEvent>,
-                       Win32KPresentHistoryTokenHash>           mPresentByWin32KPresentHistoryToken;    // Win32KPresentHistoryToken -> PresentEvent
-    std::unordered_map<uint64_t, std::shared_ptr<PresentEvent>> mPresentByDxgkPresentHistoryToken;      // DxgkPresentHistoryToken -> PresentEvent
-    std::unordered_map<uint64_t, std::shared_ptr<PresentEvent>> mPresentByDxgkPresentHistoryTokenData;  // DxgkPresentHistoryTokenData -> PresentEvent
-    std::unordered_map<uint64_t, std::shared_ptr<PresentEvent>> mPresentByDxgkContext;                  // DxgkContex -> PresentEvent
-    std::unordered_map<uint64_t, std::shared_ptr<PresentEvent>> mPresentByVidPnLayerId;                 // VidPnLayerId -> PresentEvent
-    std::unordered_map<uint64_t, std::shared_ptr<PresentEvent>> mLastPresentByWindow;                   // HWND -> PresentEvent
+    pmon::util::FlatHashMap<uint32_t, PresentsByContext>        mPresentBySubmitSequence;               // SubmitSequenceId -> hContext -> PresentEvent
+    PresentIndex<Win32KPresentHistoryToken,
+                 Win32KPresentHistoryTokenHash>                 mPresentByWin32KPresentHistoryToken;    // Win32KPresentHistoryToken -> PresentEvent
+    PresentIndex<uint64_t>                                      mPresentByDxgkPresentHistoryToken;      // DxgkPresentHistoryToken -> PresentEvent
+    PresentIndex<uint64_t>                                      mPresentByDxgkPresentHistoryTokenData;  // DxgkPresentHistoryTokenData -> PresentEvent
+    PresentIndex<uint64_t>                                      mPresentByDxgkContext;                  // DxgkContex -> PresentEvent
+    PresentIndex<uint64_t>                                      mPresentByVidPnLayerId;                 // VidPnLayerId -> PresentEvent
+    PresentIndex<uint64_t>                                      mLastPresentByWindow;                   // HWND -> PresentEvent
     std::unordered_map<uint64_t, MouseClickData>                mReceivedMouseClickByHwnd;              // HWND -> MouseClickData
-    std::unordered_map<std::pair<uint32_t, uint32_t>, 
-                       std::shared_ptr<PresentEvent>,
-                       PairHash<uint32_t, uint32_t>>            mPresentByAppFrameId;                   // Intel provider app frame id -> PresentEvent
+    PresentIndex<std::pair<uint32_t, uint32_t>,
+                 PairHash<uint32_t, uint32_t>>                  mPresentByAppFrameId;                   // Intel provider app frame id -> PresentEvent
     std::unordered_map<std::pair<uint32_t, uint32_t>,
                        AppTimingData,
                        PairHash<uint32_t, uint32_t>>            mAppTimingDataByAppFrameId;             // Intel provider app frame id -> AppTimingData
@@ -547,6 +599,21 @@ struct PMTraceConsumer
     // Trace consumer that handles events coming from Nvidia DisplayDriver
     NVTraceConsumer mNvTraceConsumer;
 
+    // If non-null, every DecodedEvent applied by HandleDecodedEvent() is also written to
+    // mDecodedEventRecorder so that the session can later be replayed without ETW (see
+    // ReplayDecodedEvents()).  The writer is owned by the caller and is only accessed from the
+    // consumer thread.
+    DecodedEventWriter* mDecodedEventRecorder = nullptr;
+
+    // Events that are decoded into a leading DecodedEvent followed by continuation records
+    // (ProcessStart + ProcessImageName, DxgkMMIOFlipMPO3 + DxgkMMIOFlipMPO3Plane) are assembled here
+    // until the last continuation record has been applied.
+    ProcessEvent mPendingProcessStart;
+    uint32_t mPendingProcessImageNameLength = 0;
+    std::shared_ptr<PresentEvent> mPendingMMIOFlipMPO3Present;
+    uint32_t mPendingMMIOFlipMPO3VidPnSourceId = 0;
+    uint32_t mPendingMMIOFlipMPO3PlaneCount = 0;
+
     // -------------------------------------------------------------------------------------------
     // Functions for decoding ETW and analysing process and present events.
 
@@ -559,15 +626,45 @@ struct PMTraceConsumer
     PMTraceConsumer(PMTraceConsumer&&) = delete;
     PMTraceConsumer& operator=(PMTraceConsumer&&) = delete;
 
-    void HandleDxgkBlt(EVENT_HEADER const& hdr, uint64_t hwnd, bool redirectedPresent);
-    std::shared_ptr<PresentEvent> HandleDxgkFlip(EVENT_HEADER const& hdr);
-    void HandleDxgkQueueSubmit(EVENT_HEADER const& hdr, uint64_t hContext, uint32_t submitSequence, uint32_t packetType, bool isPresentPacket, bool isWin7);
+    void HandleDxgkBlt(DecodedEvent const& hdr, uint64_t hwnd, bool redirectedPresent);
+    std::shared_ptr<PresentEvent> HandleDxgkFlip(DecodedEvent const& hdr);
+    void HandleDxgkQueueSubmit(DecodedEvent const& hdr, uint64_t hContext, uint32_t submitSequence, uint32_t packetType, bool isPresentPacket, bool isWin7);
     void HandleDxgkQueueComplete(uint64_t timestamp, uint64_t hContext, uint32_t submitSequence);
     void HandleDxgkMMIOFlip(uint64_t timestamp, uint32_t submitSequence, uint32_t flags);
     void HandleDxgkSyncDPC(uint64_t timestamp, uint32_t submitSequence);
-    void HandleDxgkPresentHistory(EVENT_HEADER const& hdr, uint64_t token, uint64_t tokenData, Microsoft_Windows_DxgKrnl::PresentModel presentModel);
-    void HandleDxgkPresentHistoryInfo(EVENT_HEADER const& hdr, uint64_t token);
-
+    void HandleDxgkPresentHistory(DecodedEvent const& hdr, uint64_t token, uint64_t tokenData, Microsoft_Windows_DxgKrnl::PresentModel presentModel);
+    void HandleDxgkPresentHistoryInfo(DecodedEvent const& hdr, uint64_t token);
+    void HandleDxgkFlipInfo(DecodedEvent const& hdr, uint32_t flipInterval, bool mmioFlip);
+    void HandleDxgkIndependentFlip(uint32_t submitSequence, uint32_t flipInterval);
+    void HandleDxgkFlipMPO(DecodedEvent const& hdr, uint32_t vidPnSourceId, uint32_t layerIndex);
+    void HandleDxgkMMIOFlipMPO(DecodedEvent const& hdr, uint32_t submitSequence, uint32_t flipEntryStatusAfterFlip, bool flipEntryStatusAfterFlipValid);
+    void HandleDxgkSyncDPCMPO(uint64_t timestamp, uint32_t submitSequence, bool isMultiPlane);
+    void HandleDxgkPresent(DecodedEvent const& hdr, uint64_t hwnd);
+    void HandleDxgkBlitCancel(DecodedEvent const& hdr);
+    void HandleWin32kTokenCompositionSurfaceObject(DecodedEvent const& hdr, uint64_t compositionSurfaceLuid, uint64_t presentCount, uint64_t bindId, bool destSizeValid, uint32_t destWidth, uint32_t destHeight);
+    void HandleWin32kTokenStateChanged(uint64_t compositionSurfaceLuid, uint64_t presentCount, uint64_t bindId, uint32_t newState, bool independentFlip);
+    void HandleDwmGetPresentHistory();
+    void HandleDwmFlipChain(uint32_t flipChain, uint32_t serialNumber, uint64_t hwnd);
+    void HandleDwmScheduleSurfaceUpdate(uint64_t luidSurface, uint64_t presentCount, uint64_t bindId);
+    void HandleDxgiHybridPresentMode(uint32_t processId, uint64_t swapChainAddress, uint32_t hybridPresentMode);
+    void HandleDxgkMMIOFlipMPO3Plane(std::shared_ptr<PresentEvent> const& present, uint32_t vidPnSourceId, uint32_t layerIndex, uint64_t presentId);
+    void HandleWin32kInputDeviceRead(uint64_t timestamp, uint32_t deviceType);
+    void HandleWin32kRetrieveInputMessage(uint32_t processId, uint64_t hWnd);
+    void HandleWin32kInputXformUpdate(uint64_t hWnd, uint64_t xFormQPCTime);
+    void HandleIntelPresentFrameType(uint32_t threadId, uint32_t frameId, FrameType frameType, uint32_t appFrameId);
+    void HandleIntelFlipFrameType(uint64_t timestamp, uint32_t vidPnSourceId, uint32_t layerIndex, uint64_t presentId, FrameType frameType);
+    void HandlePclMarker(uint64_t timestamp, uint32_t processId, uint32_t marker, uint32_t frameId);
+    void HandlePclInput(uint64_t timestamp, uint32_t processId);
+    void HandlePclShutdown(uint32_t processId);
+    void EnqueueProcessEvent(ProcessEvent const& event);
+
+    // Apply one decoded provider event to the present-tracking state.  The Handle*Event() functions
+    // below (see PresentMonTraceDecoder.cpp) decode EVENT_RECORDs into DecodedEvents and call this;
+    // it can also be driven directly (e.g., by ReplayDecodedEvents()).  The helpers above only read
+    // the TimeStamp, ProcessId, and ThreadId of the DecodedEvent they are passed.
+    void HandleDecodedEvent(DecodedEvent const& ev);
+
+#ifdef _WIN32
     void HandleProcessEvent(EVENT_RECORD* pEventRecord);
     void HandleDXGIEvent(EVENT_RECORD* pEventRecord);
     void HandleD3D9Event(EVENT_RECORD* pEventRecord);
@@ -586,28 +683,28 @@ struct PMTraceConsumer
     void HandleWin7DxgkQueuePacket(EVENT_RECORD* pEventRecord);
     void HandleWin7DxgkVSyncDPC(EVENT_RECORD* pEventRecord);
     void HandleWin7DxgkMMIOFlip(EVENT_RECORD* pEventRecord);
-
+#endif
 
     void SetThreadPresent(uint32_t threadId, std::shared_ptr<PresentEvent> const& present);
     std::shared_ptr<PresentEvent> FindPresentByThreadId(uint32_t threadId);
     std::shared_ptr<PresentEvent> FindPresentBySubmitSequence(uint32_t submitSequence);
-    std::shared_ptr<PresentEvent> FindOrCreatePresent(EVENT_HEADER const& hdr);
+    std::shared_ptr<PresentEvent> FindOrCreatePresent(DecodedEvent const& hdr);
 
-    void TrackPresent(std::shared_ptr<PresentEvent> present, OrderedPresents* presentsByThisProcess);
+    void TrackPresent(std::shared_ptr<PresentEvent> const& present, OrderedPresents* presentsByThisProcess);
     void StopTrackingPresent(std::shared_ptr<PresentEvent> const& present);
     void RemovePresentFromSubmitSequenceIdTracking(std::shared_ptr<PresentEvent> const& present);
 
-    void RuntimePresentStart(Runtime runtime, EVENT_HEADER const& hdr, uint64_t swapchainAddr, uint32_t dxgiPresentFlags, int32_t syncInterval);
-    void RuntimePresentStop(Runtime runtime, EVENT_HEADER const& hdr, uint32_t result);
+    void RuntimePresentStart(Runtime runtime, DecodedEvent const& hdr, uint64_t swapchainAddr, uint32_t dxgiPresentFlags, int32_t syncInterval);
+    void RuntimePresentStop(Runtime runtime, DecodedEvent const& hdr, uint32_t result);
     void CompletePresent(std::shared_ptr<PresentEvent> const& present);
     void RemoveLostPresent(std::shared_ptr<PresentEvent> present);
 
-    void UpdateReadyCount(bool useLock);
+    void UpdateReadyCount();
 
     void DeferFlipFrameType(uint64_t vidPnLayerId, uint64_t presentId, uint64_t timestamp, FrameType frameType);
     void ApplyFlipFrameType(std::shared_ptr<PresentEvent> const& present, uint64_t timestamp, FrameType frameType);
     void ApplyPresentFrameType(std::shared_ptr<PresentEvent> const& present);
-    void SetAppTimingData(const EVENT_RECORD* pEventRecord);
+    void SetAppTimingData(uint64_t timestamp, uint32_t processId, uint32_t eventId, uint32_t frameId, InputDeviceType inputType);
 
     void SignalEventsReady();
     
@@ -617,7 +714,7 @@ struct PMTraceConsumer
     bool IsApplicationPresent(std::shared_ptr<PresentEvent> const& present);
     void SetAppTimingDataAsComplete(uint32_t processId, uint32_t appFrameId);
 
-    inline uint32_t GetRingIndex(uint32_t index)
+    inline uint32_t GetRingIndex(uint32_t index) const
     {
         return index % mCircularBufferSize;
     }
@@ -0,0 +1,1141 @@
+// Copyright (C) 2017-2024 Intel Corporation
+// Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved
+// SPDX-License-Identifier: MIT
+
+// ETW decoding for PMTraceConsumer: each provider handler reads the EVENT_RECORD through TDH and
+// applies it as one or more DecodedEvents (see PresentMonTraceConsumer.cpp for the
+// present-tracking state machine that consumes them).  This is the only part of the consumer that
+// needs ETW, so it is left out of builds that only replay decoded events.
+
+#include "PresentMonTraceConsumer.hpp"
+
+#include "ETW/Intel_PresentMon.h"
+#include "ETW/Microsoft_Windows_D3D9.h"
+#include "ETW/Microsoft_Windows_Dwm_Core.h"
+#include "ETW/Microsoft_Windows_Dwm_Core_Win7.h"
+#include "ETW/Microsoft_Windows_DXGI.h"
+#include "ETW/Microsoft_Windows_DxgKrnl.h"
+#include "ETW/Microsoft_Windows_DxgKrnl_Win7.h"
+#include "ETW/Microsoft_Windows_EventMetadata.h"
+#include "ETW/Microsoft_Windows_Kernel_Process.h"
+#include "ETW/Microsoft_Windows_Win32k.h"
+#include "ETW/Nvidia_PCL.h"
+
+#include <assert.h>
+#include <d3d9.h>
+#include <dxgi.h>
+
+static inline DecodedEvent MakeDecodedEvent(DecodedEventType type, EVENT_HEADER const& hdr)
+{
+    return MakeDecodedEvent(type, (uint64_t) hdr.TimeStamp.QuadPart, hdr.ProcessId, hdr.ThreadId);
+}
+
+void PMTraceConsumer::HandleD3D9Event(EVENT_RECORD* pEventRecord)
+{
+    auto const& hdr = pEventRecord->EventHeader;
+    switch (hdr.EventDescriptor.Id) {
+    case Microsoft_Windows_D3D9::Present_Start::Id:
+        if (IsProcessTrackedForFiltering(hdr.ProcessId)) {
+            EventDataDesc desc[] = {
+                { L"pSwapchain" },
+                { L"Flags" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+            auto pSwapchain = desc[0].GetData<uint64_t>();
+            auto Flags      = desc[1].GetData<uint32_t>();
+
+            uint32_t dxgiPresentFlags = 0;
+            if (Flags & D3DPRESENT_DONOTFLIP)   dxgiPresentFlags |= DXGI_PRESENT_DO_NOT_SEQUENCE;
+            if (Flags & D3DPRESENT_DONOTWAIT)   dxgiPresentFlags |= DXGI_PRESENT_DO_NOT_WAIT;
+            if (Flags & D3DPRESENT_FLIPRESTART) dxgiPresentFlags |= DXGI_PRESENT_RESTART;
+
+            int32_t syncInterval = -1;
+            if (Flags & D3DPRESENT_FORCEIMMEDIATE) {
+                syncInterval = 0;
+            }
+
+            auto ev = MakeDecodedEvent(DecodedEventType::RuntimePresentStart, hdr);
+            ev.RuntimePresentStart.SwapChainAddress = pSwapchain;
+            ev.RuntimePresentStart.Runtime = (uint32_t) Runtime::D3D9;
+            ev.RuntimePresentStart.PresentFlags = dxgiPresentFlags;
+            ev.RuntimePresentStart.SyncInterval = syncInterval;
+            HandleDecodedEvent(ev);
+        }
+        break;
+    case Microsoft_Windows_D3D9::Present_Stop::Id:
+        if (IsProcessTrackedForFiltering(hdr.ProcessId)) {
+            auto ev = MakeDecodedEvent(DecodedEventType::RuntimePresentStop, hdr);
+            ev.RuntimePresentStop.Runtime = (uint32_t) Runtime::D3D9;
+            ev.RuntimePresentStop.Result = mMetadata.GetEventData<uint32_t>(pEventRecord, L"Result");
+            HandleDecodedEvent(ev);
+        }
+        break;
+    default:
+        assert(!mFilteredEvents); // Assert that filtering is working if expected
+        break;
+    }
+}
+
+void PMTraceConsumer::HandleDXGIEvent(EVENT_RECORD* pEventRecord)
+{
+    auto const& hdr = pEventRecord->EventHeader;
+    switch (hdr.EventDescriptor.Id) {
+    case Microsoft_Windows_DXGI::Present_Start::Id:
+    case Microsoft_Windows_DXGI::PresentMultiplaneOverlay_Start::Id:
+        if (IsProcessTrackedForFiltering(hdr.ProcessId)) {
+            EventDataDesc desc[] = {
+                { L"pIDXGISwapChain" },
+                { L"Flags" },
+                { L"SyncInterval" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+            auto ev = MakeDecodedEvent(DecodedEventType::RuntimePresentStart, hdr);
+            ev.RuntimePresentStart.SwapChainAddress = desc[0].GetData<uint64_t>();
+            ev.RuntimePresentStart.Runtime = (uint32_t) Runtime::DXGI;
+            ev.RuntimePresentStart.PresentFlags = desc[1].GetData<uint32_t>();
+            ev.RuntimePresentStart.SyncInterval = desc[2].GetData<int32_t>();
+            HandleDecodedEvent(ev);
+        }
+        break;
+    case Microsoft_Windows_DXGI::Present_Stop::Id:
+    case Microsoft_Windows_DXGI::PresentMultiplaneOverlay_Stop::Id:
+        if (IsProcessTrackedForFiltering(hdr.ProcessId)) {
+            auto ev = MakeDecodedEvent(DecodedEventType::RuntimePresentStop, hdr);
+            ev.RuntimePresentStop.Runtime = (uint32_t) Runtime::DXGI;
+            ev.RuntimePresentStop.Result = mMetadata.GetEventData<uint32_t>(pEventRecord, L"Result");
+            HandleDecodedEvent(ev);
+        }
+        break;
+    case Microsoft_Windows_DXGI::SwapChain_Start::Id:
+    case Microsoft_Windows_DXGI::ResizeBuffers_Start::Id:
+        if (mTrackHybridPresent) {
+            if (IsProcessTrackedForFiltering(hdr.ProcessId)) {
+                EventDataDesc desc[] = {
+                    { L"pIDXGISwapChain" },
+                    { L"HybridPresentMode" },
+                };
+                // Check to see if the event has both the pIDXGISwapChain and HybridPresentMode
+                // fields. If not do not process.
+                uint32_t descCount = _countof(desc);
+                mMetadata.GetEventData(pEventRecord, desc, &descCount);
+                if (descCount == _countof(desc)) {
+                    auto ev = MakeDecodedEvent(DecodedEventType::DxgiHybridPresentMode, hdr);
+                    ev.DxgiHybridPresentMode.SwapChainAddress  = desc[0].GetData<uint64_t>();
+                    ev.DxgiHybridPresentMode.HybridPresentMode = desc[1].GetData<uint32_t>();
+                    HandleDecodedEvent(ev);
+                }
+            }
+        }
+        break;
+    default:
+        assert(!mFilteredEvents); // Assert that filtering is working if expected
+        break;
+    }
+}
+
+void PMTraceConsumer::HandleDXGKEvent(EVENT_RECORD* pEventRecord)
+{
+    auto const& hdr = pEventRecord->EventHeader;
+
+    if (hdr.EventDescriptor.Id == Microsoft_Windows_DxgKrnl::PresentHistory_Start::Id ||
+       (hdr.EventDescriptor.Id == Microsoft_Windows_DxgKrnl::PresentHistoryDetailed_Start::Id && mTrackDisplay)) {
+        EventDataDesc desc[] = {
+            { L"Token" },
+            { L"Model" },
+            { L"TokenData" },
+        };
+        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+        auto Token     = desc[0].GetData<uint64_t>();
+        auto Model     = desc[1].GetData<Microsoft_Windows_DxgKrnl::PresentModel>();
+        auto TokenData = desc[2].GetData<uint64_t>();
+
+        if (Model != Microsoft_Windows_DxgKrnl::PresentModel::D3DKMT_PM_REDIRECTED_GDI) {
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkPresentHistoryStart, hdr);
+            ev.DxgkPresentHistoryStart.Token = Token;
+            ev.DxgkPresentHistoryStart.TokenData = TokenData;
+            ev.DxgkPresentHistoryStart.Model = (uint32_t) Model;
+            HandleDecodedEvent(ev);
+        }
+        return;
+    }
+
+    if (mTrackDisplay) {
+        switch (hdr.EventDescriptor.Id) {
+        case Microsoft_Windows_DxgKrnl::Flip_Info::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"FlipInterval" },
+                { L"MMIOFlip" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkFlip, hdr);
+            ev.DxgkFlip.FlipInterval = desc[0].GetData<uint32_t>();
+            ev.DxgkFlip.MMIOFlip     = desc[1].GetData<BOOL>() != 0;
+            HandleDecodedEvent(ev);
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::IndependentFlip_Info::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"SubmitSequence" },
+                { L"FlipInterval" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkIndependentFlip, hdr);
+            ev.DxgkIndependentFlip.SubmitSequence = desc[0].GetData<uint32_t>();
+            ev.DxgkIndependentFlip.FlipInterval   = desc[1].GetData<uint32_t>();
+            HandleDecodedEvent(ev);
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::FlipMultiPlaneOverlay_Info::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"VidPnSourceId" },
+                { L"LayerIndex" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkFlipMPO, hdr);
+            ev.DxgkFlipMPO.VidPnSourceId = desc[0].GetData<uint32_t>();
+            ev.DxgkFlipMPO.LayerIndex    = desc[1].GetData<uint32_t>();
+            HandleDecodedEvent(ev);
+            return;
+        }
+        // QueuPacket_Start are used for render queue packets
+        // QueuPacket_Start_2 are used for monitor wait packets
+        // QueuPacket_Start_3 are used for monitor signal packets
+        case Microsoft_Windows_DxgKrnl::QueuePacket_Start::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"PacketType" },
+                { L"SubmitSequence" },
+                { L"hContext" },
+                { L"bPresent" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkQueueSubmit, hdr);
+            ev.DxgkQueuePacket.PacketType     = desc[0].GetData<uint32_t>();
+            ev.DxgkQueuePacket.SubmitSequence = desc[1].GetData<uint32_t>();
+            ev.DxgkQueuePacket.hContext       = desc[2].GetData<uint64_t>();
+            ev.DxgkQueuePacket.Present        = desc[3].GetData<BOOL>() != 0;
+            HandleDecodedEvent(ev);
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::QueuePacket_Start_2::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"hContext" },
+                { L"SubmitSequence" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkQueueSubmit, hdr);
+            ev.DxgkQueuePacket.hContext       = desc[0].GetData<uint64_t>();
+            ev.DxgkQueuePacket.SubmitSequence = desc[1].GetData<uint32_t>();
+            ev.DxgkQueuePacket.PacketType     = (uint32_t) Microsoft_Windows_DxgKrnl::QueuePacketType::DXGKETW_WAIT_COMMAND_BUFFER;
+            HandleDecodedEvent(ev);
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::QueuePacket_Stop::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"hContext" },
+                { L"SubmitSequence" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkQueueComplete, hdr);
+            ev.DxgkQueuePacket.hContext       = desc[0].GetData<uint64_t>();
+            ev.DxgkQueuePacket.SubmitSequence = desc[1].GetData<uint32_t>();
+            HandleDecodedEvent(ev);
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::MMIOFlip_Info::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"FlipSubmitSequence" },
+                { L"Flags" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkMMIOFlip, hdr);
+            ev.DxgkMMIOFlip.SubmitSequence = desc[0].GetData<uint32_t>();
+            ev.DxgkMMIOFlip.Flags          = desc[1].GetData<uint32_t>();
+            HandleDecodedEvent(ev);
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::MMIOFlipMultiPlaneOverlay_Info::Id:
+        {
+            auto flipEntryStatusAfterFlipValid = hdr.EventDescriptor.Version >= 2;
+            EventDataDesc desc[] = {
+                { L"FlipSubmitSequence" },
+                { L"FlipEntryStatusAfterFlip" }, // optional
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc) - (flipEntryStatusAfterFlipValid ? 0 : 1));
+            auto FlipSubmitSequence = desc[0].GetData<uint64_t>();
+
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkMMIOFlipMPO, hdr);
+            ev.DxgkMMIOFlipMPO.SubmitSequence = (uint32_t) (FlipSubmitSequence >> 32u);
+            ev.DxgkMMIOFlipMPO.FlipEntryStatusAfterFlipValid = flipEntryStatusAfterFlipValid;
+            if (flipEntryStatusAfterFlipValid) {
+                ev.DxgkMMIOFlipMPO.FlipEntryStatusAfterFlip = desc[1].GetData<uint32_t>();
+            }
+            HandleDecodedEvent(ev);
+            return;
+        }
+
+        // VSyncDPC_Info only includes the FlipSubmitSequence for one layer.
+        //
+        // *SyncDPCMultiPlane_Info is sent afterward for non-legacy flip paths, and
+        // contains info on whether this vsync/hsync contains an overlay.  So, we
+        // avoid updating ScreenTime and FinalState with the second event, but
+        // update isMultiPlane with the correct information when we have them.
+        //
+        // On Windows >= 10.17134 HSyncDPCMultiPlane_Info is used when the
+        // associated display is connected to integrated graphics.
+        case Microsoft_Windows_DxgKrnl::VSyncDPC_Info::Id:
+        {
+            auto FlipFenceId = mMetadata.GetEventData<uint64_t>(pEventRecord, L"FlipFenceId");
+            if (FlipFenceId != 0) {
+                auto ev = MakeDecodedEvent(DecodedEventType::DxgkSyncDPC, hdr);
+                ev.DxgkSyncDPC.SubmitSequence = (uint32_t)(FlipFenceId >> 32u);
+                HandleDecodedEvent(ev);
+            }
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::VSyncDPCMultiPlane_Info::Id:
+        case Microsoft_Windows_DxgKrnl::HSyncDPCMultiPlane_Info::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"PlaneCount" },
+                { L"ScannedPhysicalAddress" },
+                { L"FlipEntryCount" },
+                { L"FlipSubmitSequence" },
+            };
+
+            // Name changed from "ScannedPhysicalAddress" to "PresentIdOrPhysicalAddress"
+            if (hdr.EventDescriptor.Id == Microsoft_Windows_DxgKrnl::VSyncDPCMultiPlane_Info::Id &&
+                hdr.EventDescriptor.Version >= 1) {
+                desc[1].name_ = L"PresentIdOrPhysicalAddress";
+            }
+
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+            auto PlaneCount         = desc[0].GetData<uint32_t>();
+            auto PlaneAddress       = desc[1].GetArray<uint64_t>(PlaneCount);
+            auto FlipEntryCount     = desc[2].GetData<uint32_t>();
+            auto FlipSubmitSequence = desc[3].GetArray<uint64_t>(FlipEntryCount);
+
+            if (FlipEntryCount > 0) {
+                // The number of active planes is determined by the number of
+                // non-zero addresses.  All we care about is if there are more
+                // than one or not.
+                bool isMultiPlane = false;
+                for (uint32_t i = 0, activePlaneCount = 0; i < PlaneCount; ++i) {
+                    if (PlaneAddress[i] != 0) {
+                        if (activePlaneCount == 1) {
+                            isMultiPlane = true;
+                            break;
+                        }
+                        activePlaneCount += 1;
+                    }
+                }
+
+                // Each flip entry is handled independently, so they are
+                // decoded into separate events.
+                for (uint32_t i = 0; i < FlipEntryCount; ++i) {
+                    if (FlipSubmitSequence[i] > 0) {
+                        auto ev = MakeDecodedEvent(DecodedEventType::DxgkSyncDPCMPO, hdr);
+                        ev.DxgkSyncDPC.SubmitSequence = (uint32_t)(FlipSubmitSequence[i] >> 32u);
+                        ev.DxgkSyncDPC.MultiPlane = isMultiPlane;
+                        HandleDecodedEvent(ev);
+                    }
+                }
+            }
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::Present_Info::Id:
+        {
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkPresent, hdr);
+            ev.DxgkPresent.Hwnd = mMetadata.GetEventData<uint64_t>(pEventRecord, L"hWindow");
+            HandleDecodedEvent(ev);
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::PresentHistory_Info::Id:
+        {
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkPresentHistoryInfo, hdr);
+            ev.DxgkPresentHistoryInfo.Token = mMetadata.GetEventData<uint64_t>(pEventRecord, L"Token");
+            HandleDecodedEvent(ev);
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::Blit_Info::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"hwnd" },
+                { L"bRedirectedPresent" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkBlt, hdr);
+            ev.DxgkBlt.Hwnd              = desc[0].GetData<uint64_t>();
+            ev.DxgkBlt.RedirectedPresent = desc[1].GetData<uint32_t>() != 0;
+            HandleDecodedEvent(ev);
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::BlitCancel_Info::Id:
+            HandleDecodedEvent(MakeDecodedEvent(DecodedEventType::DxgkBlitCancel, hdr));
+            return;
+        }
+    }
+
+    if (mTrackGPU) {
+        switch (hdr.EventDescriptor.Id) {
+
+        // We need a mapping from hContext to GPU node.
+        //
+        // There's two ways I've tried to get this. One is to use
+        // Microsoft_Windows_DxgKrnl::SelectContext2_Info events which include
+        // all the required info (hContext, pDxgAdapter, and NodeOrdinal) but
+        // that event fires often leading to significant overhead.
+        //
+        // The current implementaiton requires a CAPTURE_STATE on start up to
+        // get all existing context/device events but after that the event
+        // overhead should be minimal.
+        case Microsoft_Windows_DxgKrnl::Device_DCStart::Id:
+        case Microsoft_Windows_DxgKrnl::Device_Start::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"pDxgAdapter" },
+                { L"hDevice" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkRegisterDevice, hdr);
+            ev.DxgkDevice.pDxgAdapter = desc[0].GetData<uint64_t>();
+            ev.DxgkDevice.hDevice     = desc[1].GetData<uint64_t>();
+            HandleDecodedEvent(ev);
+            return;
+        }
+        // Sometimes a trace will miss a Device_Start, so we also check
+        // AdapterAllocation events (which also provide the pDxgAdapter-hDevice
+        // mapping).  These are not currently enabled for realtime collection.
+        case Microsoft_Windows_DxgKrnl::AdapterAllocation_Start::Id:
+        case Microsoft_Windows_DxgKrnl::AdapterAllocation_DCStart::Id:
+        case Microsoft_Windows_DxgKrnl::AdapterAllocation_Stop::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"pDxgAdapter" },
+                { L"hDevice" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+            auto pDxgAdapter = desc[0].GetData<uint64_t>();
+            auto hDevice     = desc[1].GetData<uint64_t>();
+
+            if (hDevice != 0) {
+                auto ev = MakeDecodedEvent(DecodedEventType::DxgkRegisterDevice, hdr);
+                ev.DxgkDevice.pDxgAdapter = pDxgAdapter;
+                ev.DxgkDevice.hDevice     = hDevice;
+                HandleDecodedEvent(ev);
+            }
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::Device_Stop::Id:
+        {
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkUnregisterDevice, hdr);
+            ev.DxgkDevice.hDevice = mMetadata.GetEventData<uint64_t>(pEventRecord, L"hDevice");
+            HandleDecodedEvent(ev);
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::Context_DCStart::Id:
+        case Microsoft_Windows_DxgKrnl::Context_Start::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"hContext" },
+                { L"hDevice" },
+                { L"NodeOrdinal" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkRegisterContext, hdr);
+            ev.DxgkContext.hContext    = desc[0].GetData<uint64_t>();
+            ev.DxgkContext.hDevice     = desc[1].GetData<uint64_t>();
+            ev.DxgkContext.NodeOrdinal = desc[2].GetData<uint32_t>();
+
+            // If this is a DCStart, then it was generated by xperf instead of
+            // the context's process.
+            ev.DxgkContext.ContextProcessId = hdr.EventDescriptor.Id == Microsoft_Windows_DxgKrnl::Context_DCStart::Id
+                ? 0
+                : hdr.ProcessId;
+
+            HandleDecodedEvent(ev);
+            return;
+        }
+        case Microsoft_Windows_DxgKrnl::Context_Stop::Id:
+        {
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkUnregisterContext, hdr);
+            ev.DxgkContext.hContext = mMetadata.GetEventData<uint64_t>(pEventRecord, L"hContext");
+            HandleDecodedEvent(ev);
+            return;
+        }
+
+        case Microsoft_Windows_DxgKrnl::HwQueue_DCStart::Id:
+        case Microsoft_Windows_DxgKrnl::HwQueue_Start::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"hContext" },
+                { L"ParentDxgHwQueue" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkRegisterHwQueue, hdr);
+            ev.DxgkHwQueue.hContext         = desc[0].GetData<uint64_t>();
+            ev.DxgkHwQueue.ParentDxgHwQueue = desc[1].GetData<uint64_t>();
+            HandleDecodedEvent(ev);
+            return;
+        }
+
+        case Microsoft_Windows_DxgKrnl::NodeMetadata_Info::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"pDxgAdapter" },
+                { L"NodeOrdinal" },
+                { L"EngineType" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::DxgkNodeMetadata, hdr);
+            ev.DxgkNodeMetadata.pDxgAdapter = desc[0].GetData<uint64_t>();
+            ev.DxgkNodeMetadata.NodeOrdinal = desc[1].GetData<uint32_t>();
+            ev.DxgkNodeMetadata.EngineType  = (uint32_t) desc[2].GetData<Microsoft_Windows_DxgKrnl::DXGK_ENGINE>();
+            HandleDecodedEvent(ev);
+            return;
+        }
+
+        // DmaPacket_Start occurs when a packet is enqueued onto a node.
+        // 
+        // There are certain DMA packets that don't result in GPU work.
+        // Examples are preemption packets or notifications for
+        // VIDSCH_QUANTUM_EXPIRED.  These will have a sequence id of zero (also
+        // DmaBuffer will be null).
+        //
+        // DmaPacket_Info occurs on packet-related interrupts.  We could use
+        // DmaPacket_Stop here, but the DMA_COMPLETED interrupt is a tighter
+        // bound.
+        case Microsoft_Windows_DxgKrnl::DmaPacket_Start::Id:
+        case Microsoft_Windows_DxgKrnl::DmaPacket_Info::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"hContext" },
+                { L"ulQueueSubmitSequence" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+            auto hContext   = desc[0].GetData<uint64_t>();
+            auto SequenceId = desc[1].GetData<uint32_t>();
+
+            if (SequenceId != 0) {
+                auto ev = MakeDecodedEvent(hdr.EventDescriptor.Id == Microsoft_Windows_DxgKrnl::DmaPacket_Start::Id
+                                           ? DecodedEventType::DxgkDmaPacketStart
+                                           : DecodedEventType::DxgkDmaPacketComplete, hdr);
+                ev.DxgkDmaPacket.hContext   = hContext;
+                ev.DxgkDmaPacket.SequenceId = SequenceId;
+                HandleDecodedEvent(ev);
+            }
+            return;
+        }
+        }
+    }
+
+    if (mTrackFrameType) {
+        // MMIOFlipMultiPlaneOverlay3_Info is emitted immediately before MMIOFlipMultiPlaneOverlay_Info,
+        // on the same thread, with the same SubmitSequence, and includes the PresentId(s) that the
+        // driver uses to report flip completion.
+        //
+        // Version 8 is required for LayerIndex and FlipSubmitSequence.
+        if (hdr.EventDescriptor.Id == Microsoft_Windows_DxgKrnl::MMIOFlipMultiPlaneOverlay3_Info::Id) {
+            if (hdr.EventDescriptor.Version >= 8) {
+                EventDataDesc desc[] = {
+                    { L"VidPnSourceId" },
+                    { L"PlaneCount" },
+                    { L"PresentId" },
+                    { L"LayerIndex" },
+                    { L"FlipSubmitSequence" },
+                };
+                mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+                auto PlaneCount = desc[1].GetData<uint32_t>();
+                auto PresentId  = desc[2].GetArray<uint64_t>(PlaneCount);
+                auto LayerIndex = desc[3].GetArray<uint32_t>(PlaneCount);
+
+                // The per-plane arrays follow the DxgkMMIOFlipMPO3 record as one
+                // DxgkMMIOFlipMPO3Plane record per plane.
+                auto ev = MakeDecodedEvent(DecodedEventType::DxgkMMIOFlipMPO3, hdr);
+                ev.DxgkMMIOFlipMPO3.VidPnSourceId      = desc[0].GetData<uint32_t>();
+                ev.DxgkMMIOFlipMPO3.FlipSubmitSequence = desc[4].GetData<uint32_t>();
+                ev.DxgkMMIOFlipMPO3.PlaneCount         = PlaneCount;
+                HandleDecodedEvent(ev);
+
+                for (uint32_t i = 0; i < PlaneCount; ++i) {
+                    ev = MakeDecodedEvent(DecodedEventType::DxgkMMIOFlipMPO3Plane, hdr);
+                    ev.DxgkMMIOFlipMPO3.PresentId  = PresentId[i];
+                    ev.DxgkMMIOFlipMPO3.LayerIndex = LayerIndex[i];
+                    HandleDecodedEvent(ev);
+                }
+            }
+            return;
+        }
+    }
+
+    assert(!mFilteredEvents); // Assert that filtering is working if expected
+}
+
+void PMTraceConsumer::HandleNvidiaDisplayDriverEvent(EVENT_RECORD* pEventRecord)
+{
+    mNvTraceConsumer.HandleNvidiaDisplayDriverEvent(pEventRecord, this);
+}
+
+void PMTraceConsumer::HandleWin7DxgkBlt(EVENT_RECORD* pEventRecord)
+{
+    using namespace Microsoft_Windows_DxgKrnl::Win7;
+
+    auto pBltEvent = reinterpret_cast<DXGKETW_BLTEVENT*>(pEventRecord->UserData);
+    auto ev = MakeDecodedEvent(DecodedEventType::DxgkBlt, pEventRecord->EventHeader);
+    ev.DxgkBlt.Hwnd              = pBltEvent->hwnd;
+    ev.DxgkBlt.RedirectedPresent = pBltEvent->bRedirectedPresent != 0;
+    HandleDecodedEvent(ev);
+}
+
+void PMTraceConsumer::HandleWin7DxgkFlip(EVENT_RECORD* pEventRecord)
+{
+    using namespace Microsoft_Windows_DxgKrnl::Win7;
+
+    auto pFlipEvent = reinterpret_cast<DXGKETW_FLIPEVENT*>(pEventRecord->UserData);
+    auto ev = MakeDecodedEvent(DecodedEventType::DxgkFlip, pEventRecord->EventHeader);
+    ev.DxgkFlip.FlipInterval = pFlipEvent->FlipInterval;
+    ev.DxgkFlip.MMIOFlip     = pFlipEvent->MMIOFlip != 0;
+    HandleDecodedEvent(ev);
+}
+
+void PMTraceConsumer::HandleWin7DxgkPresentHistory(EVENT_RECORD* pEventRecord)
+{
+    using namespace Microsoft_Windows_DxgKrnl::Win7;
+
+    auto pPresentHistoryEvent = reinterpret_cast<DXGKETW_PRESENTHISTORYEVENT*>(pEventRecord->UserData);
+    if (pEventRecord->EventHeader.EventDescriptor.Opcode == EVENT_TRACE_TYPE_START) {
+        auto ev = MakeDecodedEvent(DecodedEventType::DxgkPresentHistoryStart, pEventRecord->EventHeader);
+        ev.DxgkPresentHistoryStart.Token     = pPresentHistoryEvent->Token;
+        ev.DxgkPresentHistoryStart.TokenData = 0;
+        ev.DxgkPresentHistoryStart.Model     = (uint32_t) Microsoft_Windows_DxgKrnl::PresentModel::D3DKMT_PM_UNINITIALIZED;
+        HandleDecodedEvent(ev);
+    } else if (pEventRecord->EventHeader.EventDescriptor.Opcode == EVENT_TRACE_TYPE_INFO) {
+        auto ev = MakeDecodedEvent(DecodedEventType::DxgkPresentHistoryInfo, pEventRecord->EventHeader);
+        ev.DxgkPresentHistoryInfo.Token = pPresentHistoryEvent->Token;
+        HandleDecodedEvent(ev);
+    }
+}
+
+void PMTraceConsumer::HandleWin7DxgkQueuePacket(EVENT_RECORD* pEventRecord)
+{
+    using namespace Microsoft_Windows_DxgKrnl::Win7;
+
+    if (pEventRecord->EventHeader.EventDescriptor.Opcode == EVENT_TRACE_TYPE_START) {
+        auto pSubmitEvent = reinterpret_cast<DXGKETW_QUEUESUBMITEVENT*>(pEventRecord->UserData);
+        auto ev = MakeDecodedEvent(DecodedEventType::DxgkQueueSubmit, pEventRecord->EventHeader);
+        ev.DxgkQueuePacket.hContext       = pSubmitEvent->hContext;
+        ev.DxgkQueuePacket.SubmitSequence = pSubmitEvent->SubmitSequence;
+        ev.DxgkQueuePacket.PacketType     = pSubmitEvent->PacketType;
+        ev.DxgkQueuePacket.Present        = pSubmitEvent->bPresent != 0;
+        ev.DxgkQueuePacket.Win7           = true;
+        HandleDecodedEvent(ev);
+    } else if (pEventRecord->EventHeader.EventDescriptor.Opcode == EVENT_TRACE_TYPE_STOP) {
+        auto pCompleteEvent = reinterpret_cast<DXGKETW_QUEUECOMPLETEEVENT*>(pEventRecord->UserData);
+        auto ev = MakeDecodedEvent(DecodedEventType::DxgkQueueComplete, pEventRecord->EventHeader);
+        ev.DxgkQueuePacket.hContext       = pCompleteEvent->hContext;
+        ev.DxgkQueuePacket.SubmitSequence = pCompleteEvent->SubmitSequence;
+        ev.DxgkQueuePacket.Win7           = true;
+        HandleDecodedEvent(ev);
+    }
+}
+
+void PMTraceConsumer::HandleWin7DxgkVSyncDPC(EVENT_RECORD* pEventRecord)
+{
+    using namespace Microsoft_Windows_DxgKrnl::Win7;
+
+    auto pVSyncDPCEvent = reinterpret_cast<DXGKETW_SCHEDULER_VSYNC_DPC*>(pEventRecord->UserData);
+
+    // Windows 7 does not support MultiPlaneOverlay.
+    auto ev = MakeDecodedEvent(DecodedEventType::DxgkSyncDPC, pEventRecord->EventHeader);
+    ev.DxgkSyncDPC.SubmitSequence = (uint32_t)(pVSyncDPCEvent->FlipFenceId.QuadPart >> 32u);
+    HandleDecodedEvent(ev);
+}
+
+void PMTraceConsumer::HandleWin7DxgkMMIOFlip(EVENT_RECORD* pEventRecord)
+{
+    using namespace Microsoft_Windows_DxgKrnl::Win7;
+
+    auto ev = MakeDecodedEvent(DecodedEventType::DxgkMMIOFlip, pEventRecord->EventHeader);
+    if (pEventRecord->EventHeader.Flags & EVENT_HEADER_FLAG_32_BIT_HEADER) {
+        auto pMMIOFlipEvent = reinterpret_cast<DXGKETW_SCHEDULER_MMIO_FLIP_32*>(pEventRecord->UserData);
+        ev.DxgkMMIOFlip.SubmitSequence = pMMIOFlipEvent->FlipSubmitSequence;
+        ev.DxgkMMIOFlip.Flags          = pMMIOFlipEvent->Flags;
+    } else {
+        auto pMMIOFlipEvent = reinterpret_cast<DXGKETW_SCHEDULER_MMIO_FLIP_64*>(pEventRecord->UserData);
+        ev.DxgkMMIOFlip.SubmitSequence = pMMIOFlipEvent->FlipSubmitSequence;
+        ev.DxgkMMIOFlip.Flags          = pMMIOFlipEvent->Flags;
+    }
+    HandleDecodedEvent(ev);
+}
+
+void PMTraceConsumer::HandleWin32kEvent(EVENT_RECORD* pEventRecord)
+{
+    auto const& hdr = pEventRecord->EventHeader;
+
+    if (mTrackDisplay) {
+        switch (hdr.EventDescriptor.Id) {
+        case Microsoft_Windows_Win32k::TokenCompositionSurfaceObject_Info::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"CompositionSurfaceLuid" },
+                { L"PresentCount" },
+                { L"BindId" },
+                { L"DestWidth" },  // version >= 1
+                { L"DestHeight" }, // version >= 1
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc) - (hdr.EventDescriptor.Version == 0 ? 2 : 0));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::Win32kTokenCompositionSurfaceObject, hdr);
+            ev.Win32kToken.CompositionSurfaceLuid = desc[0].GetData<uint64_t>();
+            ev.Win32kToken.PresentCount           = desc[1].GetData<uint64_t>();
+            ev.Win32kToken.BindId                 = desc[2].GetData<uint64_t>();
+            if (hdr.EventDescriptor.Version >= 1) {
+                ev.Win32kToken.DestSizeValid = true;
+                ev.Win32kToken.DestWidth     = desc[3].GetData<uint32_t>();
+                ev.Win32kToken.DestHeight    = desc[4].GetData<uint32_t>();
+            }
+            HandleDecodedEvent(ev);
+            return;
+        }
+
+        case Microsoft_Windows_Win32k::TokenStateChanged_Info::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"CompositionSurfaceLuid" },
+                { L"PresentCount" },
+                { L"BindId" },
+                { L"NewState" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::Win32kTokenStateChanged, hdr);
+            ev.Win32kToken.CompositionSurfaceLuid = desc[0].GetData<uint64_t>();
+            ev.Win32kToken.PresentCount           = desc[1].GetData<uint32_t>();
+            ev.Win32kToken.BindId                 = desc[2].GetData<uint64_t>();
+            ev.Win32kToken.NewState               = desc[3].GetData<uint32_t>();
+            if (ev.Win32kToken.NewState == (uint32_t) Microsoft_Windows_Win32k::TokenState::InFrame) {
+                ev.Win32kToken.IndependentFlip = mMetadata.GetEventData<BOOL>(pEventRecord, L"IndependentFlip") != 0;
+            }
+            HandleDecodedEvent(ev);
+            return;
+        }
+        }
+    }
+
+    if (mTrackInput) {
+        switch (hdr.EventDescriptor.Id) {
+        case Microsoft_Windows_Win32k::InputDeviceRead_Stop::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"DeviceType" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::Win32kInputDeviceRead, hdr);
+            ev.Win32kInput.DeviceType = desc[0].GetData<uint32_t>();
+            HandleDecodedEvent(ev);
+            return;
+        }
+
+        case Microsoft_Windows_Win32k::RetrieveInputMessage_Info::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"hwnd" }
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::Win32kRetrieveInputMessage, hdr);
+            ev.Win32kInput.Hwnd = desc[0].GetData<uint64_t>();
+            HandleDecodedEvent(ev);
+            return;
+        }
+
+        case Microsoft_Windows_Win32k::OnInputXformUpdate_Info::Id:
+        {
+            EventDataDesc desc[] = {
+                { L"Hwnd" },
+                { L"XformQPCTime"}
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+            auto ev = MakeDecodedEvent(DecodedEventType::Win32kInputXformUpdate, hdr);
+            ev.Win32kInput.Hwnd         = desc[0].GetData<uint64_t>();
+            ev.Win32kInput.XformQPCTime = desc[1].GetData<uint64_t>();
+            HandleDecodedEvent(ev);
+            return;
+        }
+
+        }
+    }
+
+    assert(!mFilteredEvents); // Assert that filtering is working if expected
+}
+
+void PMTraceConsumer::HandleDWMEvent(EVENT_RECORD* pEventRecord)
+{
+    auto const& hdr = pEventRecord->EventHeader;
+    switch (hdr.EventDescriptor.Id) {
+    case Microsoft_Windows_Dwm_Core::MILEVENT_MEDIA_UCE_PROCESSPRESENTHISTORY_GetPresentHistory_Info::Id:
+        HandleDecodedEvent(MakeDecodedEvent(DecodedEventType::DwmGetPresentHistory, hdr));
+        break;
+
+    case Microsoft_Windows_Dwm_Core::SCHEDULE_PRESENT_Start::Id:
+        HandleDecodedEvent(MakeDecodedEvent(DecodedEventType::DwmSchedulePresentStart, hdr));
+        break;
+
+    // These events are only used for Composed_Copy_CPU_GDI presents.  They are
+    // used to identify when such presents are handed off to DWM. 
+    case Microsoft_Windows_Dwm_Core::FlipChain_Pending::Id:
+    case Microsoft_Windows_Dwm_Core::FlipChain_Complete::Id:
+    case Microsoft_Windows_Dwm_Core::FlipChain_Dirty::Id:
+    {
+        if (InlineIsEqualGUID(hdr.ProviderId, Microsoft_Windows_Dwm_Core::Win7::GUID)) {
+            break;
+        }
+
+        // ulFlipChain and ulSerialNumber are expected to be uint32_t data, but
+        // on Windows 8.1 the event properties are specified as uint64_t.
+        auto GetU32FromU32OrU64 = [](EventDataDesc const& desc) {
+            if (desc.size_ == 4) {
+                return desc.GetData<uint32_t>();
+            } else {
+                auto u64 = desc.GetData<uint64_t>();
+                DebugAssert(u64 <= UINT32_MAX);
+                return (uint32_t) u64;
+            }
+        };
+
+        EventDataDesc desc[] = {
+            { L"ulFlipChain" },
+            { L"ulSerialNumber" },
+            { L"hwnd" },
+        };
+        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+
+        auto ev = MakeDecodedEvent(DecodedEventType::DwmFlipChain, hdr);
+        ev.DwmFlipChain.FlipChain    = GetU32FromU32OrU64(desc[0]);
+        ev.DwmFlipChain.SerialNumber = GetU32FromU32OrU64(desc[1]);
+        ev.DwmFlipChain.Hwnd         = desc[2].GetData<uint64_t>();
+        HandleDecodedEvent(ev);
+        break;
+    }
+    case Microsoft_Windows_Dwm_Core::SCHEDULE_SURFACEUPDATE_Info::Id:
+    {
+        // On Windows 8.1 PresentCount is named
+        // OutOfFrameDirectFlipPresentCount, so we look up both allowing one to
+        // be optional and then check which one we found.
+        EventDataDesc desc[] = {
+            { L"luidSurface" },
+            { L"PresentCount" },
+            { L"OutOfFrameDirectFlipPresentCount" },
+            { L"bindId" },
+        };
+        mMetadata.GetEventData(pEventRecord, desc, _countof(desc), 1);
+
+        auto ev = MakeDecodedEvent(DecodedEventType::DwmScheduleSurfaceUpdate, hdr);
+        ev.DwmScheduleSurfaceUpdate.CompositionSurfaceLuid = desc[0].GetData<uint64_t>();
+        ev.DwmScheduleSurfaceUpdate.PresentCount           = (desc[1].status_ & PROP_STATUS_FOUND) ? desc[1].GetData<uint64_t>()
+                                                                                                   : desc[2].GetData<uint64_t>();
+        ev.DwmScheduleSurfaceUpdate.BindId                 = desc[3].GetData<uint64_t>();
+        HandleDecodedEvent(ev);
+        break;
+    }
+    default:
+        assert(!mFilteredEvents || // Assert that filtering is working if expected
+               hdr.ProviderId == Microsoft_Windows_Dwm_Core::Win7::GUID);
+        break;
+    }
+}
+
+void PMTraceConsumer::HandleProcessEvent(EVENT_RECORD* pEventRecord)
+{
+    auto const& hdr = pEventRecord->EventHeader;
+
+    ProcessEvent event;
+
+    if (hdr.ProviderId == Microsoft_Windows_Kernel_Process::GUID) {
+        switch (hdr.EventDescriptor.Id) {
+        case Microsoft_Windows_Kernel_Process::ProcessStart_Start::Id: {
+            EventDataDesc desc[] = {
+                { L"ProcessID" },
+                { L"ImageName" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+            event.ProcessId     = desc[0].GetData<uint32_t>();
+            auto ImageName      = desc[1].GetData<std::wstring>();
+            event.IsStartEvent  = true;
+
+            // When run as-administrator, ImageName will be a fully-qualified path.
+            // e.g.: \Device\HarddiskVolume...\...\Proces.exe.  We prune off everything other than
+            // the filename here to be consistent.
+            size_t start = ImageName.find_last_of(L'\\') + 1;
+            event.ImageFileName = ImageName.c_str() + start;
+            break;
+        }
+        case Microsoft_Windows_Kernel_Process::ProcessStop_Stop::Id: {
+            EventDataDesc desc[] = {
+                { L"ProcessID" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+            event.ProcessId    = desc[0].GetData<uint32_t>();
+            event.IsStartEvent = false;
+
+            break;
+        }
+        default:
+            assert(!mFilteredEvents); // Assert that filtering is working if expected
+            return;
+        }
+    } else { // hdr.ProviderId == NT_Process::GUID
+        if (hdr.EventDescriptor.Opcode == EVENT_TRACE_TYPE_START ||
+            hdr.EventDescriptor.Opcode == EVENT_TRACE_TYPE_DC_START) {
+            EventDataDesc desc[] = {
+                { L"ProcessId" },
+                { L"ImageFileName" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+            event.ProcessId     = desc[0].GetData<uint32_t>();
+            std::string str     = desc[1].GetData<std::string>();
+            event.ImageFileName = std::wstring(str.begin(), str.end());
+            event.IsStartEvent  = true;
+        } else if (hdr.EventDescriptor.Opcode == EVENT_TRACE_TYPE_END||
+                   hdr.EventDescriptor.Opcode == EVENT_TRACE_TYPE_DC_END) {
+            EventDataDesc desc[] = {
+                { L"ProcessId" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+            event.ProcessId    = desc[0].GetData<uint32_t>();
+            event.IsStartEvent = false;
+        } else {
+            return;
+        }
+    }
+
+    if (!event.IsStartEvent) {
+        auto ev = MakeDecodedEvent(DecodedEventType::ProcessStop, hdr);
+        ev.Process.ProcessId = event.ProcessId;
+        HandleDecodedEvent(ev);
+        return;
+    }
+
+    // The image name does not fit into the ProcessStart record, so it follows in as many
+    // ProcessImageName records as it needs.
+    auto ev = MakeDecodedEvent(DecodedEventType::ProcessStart, hdr);
+    ev.Process.ProcessId       = event.ProcessId;
+    ev.Process.ImageNameLength = (uint32_t) event.ImageFileName.size();
+    HandleDecodedEvent(ev);
+
+    size_t const charsPerRecord = _countof(ev.ProcessImageName.Chars);
+    for (size_t i = 0; i < event.ImageFileName.size(); i += charsPerRecord) {
+        ev = MakeDecodedEvent(DecodedEventType::ProcessImageName, hdr);
+        for (size_t j = 0; j < charsPerRecord && i + j < event.ImageFileName.size(); ++j) {
+            ev.ProcessImageName.Chars[j] = (uint16_t) event.ImageFileName[i + j];
+        }
+        HandleDecodedEvent(ev);
+    }
+}
+
+void PMTraceConsumer::HandleIntelPresentMonEvent(EVENT_RECORD* pEventRecord)
+{
+    if (mTrackFrameType) {
+        switch (pEventRecord->EventHeader.EventDescriptor.Id) {
+        case Intel_PresentMon::PresentFrameType_Info::Id: {
+            if (pEventRecord->EventHeader.EventDescriptor.Version == 0) {
+                DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::PresentFrameType_Info_Props));
+
+                auto props = (Intel_PresentMon::PresentFrameType_Info_Props*)pEventRecord->UserData;
+                auto ev = MakeDecodedEvent(DecodedEventType::IntelPresentFrameType, pEventRecord->EventHeader);
+                ev.IntelFrameType.FrameId    = props->FrameId;
+                ev.IntelFrameType.FrameType  = (uint8_t) props->FrameType;
+                ev.IntelFrameType.AppFrameId = 0;
+                HandleDecodedEvent(ev);
+            } else if (pEventRecord->EventHeader.EventDescriptor.Version == 1) {
+                DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::PresentFrameType_Info_2_Props));
+
+                auto props = (Intel_PresentMon::PresentFrameType_Info_2_Props*)pEventRecord->UserData;
+                auto ev = MakeDecodedEvent(DecodedEventType::IntelPresentFrameType, pEventRecord->EventHeader);
+                ev.IntelFrameType.FrameId    = props->FrameId;
+                ev.IntelFrameType.FrameType  = (uint8_t) props->FrameType;
+                ev.IntelFrameType.AppFrameId = props->AppFrameId;
+                HandleDecodedEvent(ev);
+            } else {
+                // Unknown version
+            }
+        }
+        return;
+        case Intel_PresentMon::FlipFrameType_Info::Id:
+            if (mEnableFlipFrameTypeEvents) {
+                DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::FlipFrameType_Info_Props));
+
+                auto props = (Intel_PresentMon::FlipFrameType_Info_Props*) pEventRecord->UserData;
+                auto ev = MakeDecodedEvent(DecodedEventType::IntelFlipFrameType, pEventRecord->EventHeader);
+                ev.IntelFrameType.PresentId     = props->PresentId;
+                ev.IntelFrameType.VidPnSourceId = props->VidPnSourceId;
+                ev.IntelFrameType.LayerIndex    = props->LayerIndex;
+                ev.IntelFrameType.FrameType     = (uint8_t) props->FrameType;
+                HandleDecodedEvent(ev);
+            }
+            return;
+        }
+    }
+
+    if (mTrackPMMeasurements) {
+        switch (pEventRecord->EventHeader.EventDescriptor.Id) {
+        case Intel_PresentMon::MeasuredInput_Info::Id: {
+            EventDataDesc desc[] = {
+                { L"InputType" },
+                { L"Time" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+            auto InputType = desc[0].GetData<uint8_t>();
+            auto Time      = desc[1].GetData<uint64_t>();
+
+            (void) InputType, Time;
+            // TODO
+
+        }   return;
+
+        case Intel_PresentMon::MeasuredScreenChange_Info::Id: {
+            EventDataDesc desc[] = {
+                { L"Time" },
+            };
+            mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
+            auto Time = desc[0].GetData<uint64_t>();
+
+            (void) Time;
+            // TODO
+
+        }   return;
+        }
+    }
+
+
+    if (mTrackAppTiming) {
+        auto ev = MakeDecodedEvent(DecodedEventType::IntelAppTiming, pEventRecord->EventHeader);
+        ev.IntelAppTiming.EventId = pEventRecord->EventHeader.EventDescriptor.Id;
+        switch (ev.IntelAppTiming.EventId) {
+        case Intel_PresentMon::AppInputSample_Info::Id: {
+            //DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::AppInputSample_Info_Props));
+            auto props = (Intel_PresentMon::AppInputSample_Info_Props*) pEventRecord->UserData;
+            ev.IntelAppTiming.FrameId   = props->FrameId;
+            ev.IntelAppTiming.InputType = (uint32_t) props->InputType;
+            break;
+        }
+        case Intel_PresentMon::AppSleepStart_Info::Id:
+        case Intel_PresentMon::AppSleepEnd_Info::Id:
+        case Intel_PresentMon::AppSimulationStart_Info::Id:
+        case Intel_PresentMon::AppSimulationEnd_Info::Id:
+        case Intel_PresentMon::AppRenderSubmitStart_Info::Id:
+        case Intel_PresentMon::AppRenderSubmitEnd_Info::Id:
+        case Intel_PresentMon::AppPresentStart_Info::Id:
+        case Intel_PresentMon::AppPresentEnd_Info::Id:
+            // All of these events only carry the FrameId
+            DebugAssert(pEventRecord->UserDataLength == sizeof(Intel_PresentMon::AppSleepStart_Info_Props));
+            ev.IntelAppTiming.FrameId = ((Intel_PresentMon::AppSleepStart_Info_Props*) pEventRecord->UserData)->FrameId;
+            break;
+        default:
+            return;
+        }
+        HandleDecodedEvent(ev);
+        return;
+    }
+
+    assert(!mFilteredEvents); // Assert that filtering is working if expected
+}
+
+void PMTraceConsumer::HandleTraceLoggingEvent(EVENT_RECORD* pEventRecord)
+{
+    if (mTrackPcLatency) {
+        HandlePclEvent(pEventRecord);
+    }
+}
+
+void PMTraceConsumer::HandlePclEvent(EVENT_RECORD* pEventRecord)
+{
+    try {
+        if (!mTraceLoggingDecoder.DecodeTraceLoggingEventRecord(pEventRecord)) {
+            pmlog_dbg("Failed to decode trace logging event"); // too spammy?
+            return;
+        }
+
+        auto eventName = mTraceLoggingDecoder.GetEventName();
+        if (!eventName.has_value()) {
+            pmlog_warn("Could not get trace logging event name");
+            return;
+        }
+
+        if (eventName.has_value()) {
+            if (eventName.value() == L"PCLStatsInit" ||
+                eventName.value() == L"ReflexStatsInit") {
+                pmlog_info("Received init event: " + pmon::util::str::ToNarrow(*eventName));
+            }
+            else if (eventName.value() == L"PCLStatsEvent" || 
+                     eventName.value() == L"ReflexStatsEvent") {
+                auto ev = MakeDecodedEvent(DecodedEventType::PclMarker, pEventRecord->EventHeader);
+                ev.PclMarker.Marker  = mTraceLoggingDecoder.GetNumericPropertyValue<uint32_t>(L"Marker");
+                ev.PclMarker.FrameId = (uint32_t)mTraceLoggingDecoder.GetNumericPropertyValue<uint64_t>(L"FrameID");
+                HandleDecodedEvent(ev);
+            } else if (eventName.value() == L"PCLStatsInput" ||
+                       eventName.value() == L"ReflexStatsInput") {
+                HandleDecodedEvent(MakeDecodedEvent(DecodedEventType::PclInput, pEventRecord->EventHeader));
+
+            } else if (eventName.value() == L"PCLStatsShutdown" ||
+                       eventName.value() == L"ReflexStatsShutdown") {
+                pmlog_info("Shutting down PCL stats tracking");
+                HandleDecodedEvent(MakeDecodedEvent(DecodedEventType::PclShutdown, pEventRecord->EventHeader));
+
+            }
+            else {
+                // unhandled trace event => ignore
+            }
+        }
+    }
+    catch (...) {
+        pmlog_error(pmon::util::ReportException());
+    }
+}
+
+void PMTraceConsumer::HandleMetadataEvent(EVENT_RECORD* pEventRecord)
+{
+    mMetadata.AddMetadata(pEventRecord);
+}
+
+void NVTraceConsumer::HandleNvidiaDisplayDriverEvent(EVENT_RECORD* const pEventRecord, PMTraceConsumer* const pmConsumer)
+{
+    enum {
+        FlipRequest = 1
+    };
+
+    auto const& hdr = pEventRecord->EventHeader;
+    switch (hdr.EventDescriptor.Id) {
+    case FlipRequest: {
+        auto ev = MakeDecodedEvent(DecodedEventType::NvidiaFlipRequest, (uint64_t) hdr.TimeStamp.QuadPart, hdr.ProcessId, hdr.ThreadId);
+        ev.NvidiaFlipRequest.Alloc         = pmConsumer->mMetadata.GetEventData<uint64_t>(pEventRecord, L"alloc");
+        ev.NvidiaFlipRequest.VidPnSourceId = pmConsumer->mMetadata.GetEventData<uint32_t>(pEventRecord, L"vidPnSourceId");
+        ev.NvidiaFlipRequest.Ts            = pmConsumer->mMetadata.GetEventData<uint64_t>(pEventRecord, L"ts");
+        ev.NvidiaFlipRequest.Token         = pmConsumer->mMetadata.GetEventData<uint32_t>(pEventRecord, L"token");
+        pmConsumer->HandleDecodedEvent(ev);
+        break;
+    }
+    default:
+        break;
+    }
+}
@@ -292,6 +292,39 @@ void DisableProviders(TRACEHANDLE sessionHandle)
     status = EnableTraceEx2(sessionHandle, &NvidiaDisplayDriver_Events::GUID,       EVENT_CONTROL_CODE_DISABLE_PROVIDER, 0, 0, 0, 0, nullptr);
 }
 
+// Events that must be handled even before the ETL time window, since the
+// consumer state they set up is needed for events inside the window.  These
+// are the stateful events ETLTrimmer keeps when trimming by time range, plus
+// the other DxgKrnl events the consumer uses to map devices and nodes.
+bool IsStatefulEtlEvent(EVENT_HEADER const& hdr)
+{
+    if (hdr.ProviderId == NT_Process::GUID ||
+        hdr.ProviderId == Microsoft_Windows_Kernel_Process::GUID ||
+        hdr.ProviderId == Microsoft_Windows_EventMetadata::GUID) {
+        return true;
+    }
+
+    if (hdr.ProviderId == Microsoft_Windows_DxgKrnl::GUID) {
+        switch (hdr.EventDescriptor.Id) {
+        case Microsoft_Windows_DxgKrnl::AdapterAllocation_DCStart::Id:
+        case Microsoft_Windows_DxgKrnl::AdapterAllocation_Start::Id:
+        case Microsoft_Windows_DxgKrnl::AdapterAllocation_Stop::Id:
+        case Microsoft_Windows_DxgKrnl::Context_DCStart::Id:
+        case Microsoft_Windows_DxgKrnl::Context_Start::Id:
+        case Microsoft_Windows_DxgKrnl::Context_Stop::Id:
+        case Microsoft_Windows_DxgKrnl::Device_DCStart::Id:
+        case Microsoft_Windows_DxgKrnl::Device_Start::Id:
+        case Microsoft_Windows_DxgKrnl::Device_Stop::Id:
+        case Microsoft_Windows_DxgKrnl::HwQueue_DCStart::Id:
+        case Microsoft_Windows_DxgKrnl::HwQueue_Start::Id:
+        case Microsoft_Windows_DxgKrnl::NodeMetadata_Info::Id:
+            return true;
+        }
+    }
+
+    return false;
+}
+
 template<
     bool IS_REALTIME_SESSION,
     bool TRACK_DISPLAY,
@@ -331,6 +364,29 @@ void CALLBACK EventRecordCallback(EVENT_RECORD* pEventRecord)
                 pEventRecord->EventHeader.TimeStamp.QuadPart = adjustedTimestamp;
             }
         }
+
+        if (session->mEtlWindowBegin != 0 || session->mEtlWindowEnd != UINT64_MAX) {
+            auto t = (uint64_t) (hdr.TimeStamp.QuadPart - session->mStartTimestamp.QuadPart);
+            if (t >= session->mEtlWindowEnd) {
+                session->mContinueProcessingBuffers = FALSE;
+                return;
+            }
+            if (t < session->mEtlWindowBegin) {
+                // If the stateful events before the window were handled
+                // from mEtlStatefulEvents, skip them here.
+                if (session->mEtlStatefulEventsHandled || !IsStatefulEtlEvent(hdr)) {
+                    return;
+                }
+            } else {
+                auto checkpointCount = session->mEtlCheckpointCount.load(std::memory_order_relaxed);
+                while (checkpointCount < session->mEtlCheckpointTimes.size() &&
+                       t >= session->mEtlCheckpointTimes[checkpointCount]) {
+                    session->mEtlCheckpointHashes[checkpointCount] = session->mPMConsumer->HashTrackedPresents();
+                    checkpointCount += 1;
+                    session->mEtlCheckpointCount.store(checkpointCount, std::memory_order_release);
+                }
+            }
+        }
     }
 
     VerboseTraceEvent(session->mPMConsumer, pEventRecord, &session->mPMConsumer->mMetadata);
@@ -460,6 +516,44 @@ ULONG CALLBACK BufferCallback(EVENT_TRACE_LOGFILE* pLogFile)
     return session->mContinueProcessingBuffers; // TRUE = continue processing events, FALSE = return out of ProcessTrace()
 }
 
+void CALLBACK FirstEventRecordCallback(EVENT_RECORD* pEventRecord)
+{
+    auto firstTimestamp = (LARGE_INTEGER*) pEventRecord->UserContext;
+    if (firstTimestamp->QuadPart == 0) {
+        *firstTimestamp = pEventRecord->EventHeader.TimeStamp;
+    }
+}
+
+ULONG CALLBACK FirstBufferCallback(EVENT_TRACE_LOGFILE* pLogFile)
+{
+    (void) pLogFile;
+    return FALSE;
+}
+
+// Returns the time of the first event in the ETL as a FILETIME, like the
+// log file header times, or 0 if it can't be read.  Only the first buffer
+// is processed.
+LONGLONG GetEtlFirstEventFileTime(wchar_t const* etlPath)
+{
+    LARGE_INTEGER firstTimestamp = {};
+
+    EVENT_TRACE_LOGFILEW traceProps = {};
+    traceProps.LogFileName = (wchar_t*) etlPath;
+    traceProps.ProcessTraceMode = PROCESS_TRACE_MODE_EVENT_RECORD; // Without RAW_TIMESTAMP, timestamps are FILETIMEs
+    traceProps.EventRecordCallback = &FirstEventRecordCallback;
+    traceProps.BufferCallback = &FirstBufferCallback;
+    traceProps.Context = &firstTimestamp;
+
+    auto traceHandle = OpenTraceW(&traceProps);
+    if (traceHandle == INVALID_PROCESSTRACE_HANDLE) {
+        return 0;
+    }
+    ProcessTrace(&traceHandle, 1, NULL, NULL);
+    CloseTrace(traceHandle);
+
+    return firstTimestamp.QuadPart;
+}
+
 }
 
 ULONG PMTraceSession::Start(
@@ -471,6 +565,8 @@ ULONG PMTraceSession::Start(
     assert(mTraceHandle == INVALID_PROCESSTRACE_HANDLE);
     mStartTimestamp.QuadPart = 0;
     mContinueProcessingBuffers = TRUE;
+    mEtlStatefulEventsHandled = false;
+    mEtlCheckpointCount = 0;
     mIsRealtimeSession = etlPath == nullptr;
     mPMConsumer->mIsRealtimeSession = mIsRealtimeSession;
 
@@ -514,12 +610,13 @@ ULONG PMTraceSession::Start(
         traceProps.BufferCallback = &BufferCallback;
     }
 
-    traceProps.EventRecordCallback = GetEventRecordCallback(
+    mEventRecordCallback = GetEventRecordCallback(
         mIsRealtimeSession,            // IS_REALTIME_SESSION
         mPMConsumer->mTrackDisplay,    // TRACK_DISPLAY
         mPMConsumer->mTrackInput,      // TRACK_INPUT
         mPMConsumer->mTrackFrameType || mPMConsumer->mTrackPMMeasurements || mPMConsumer->mTrackAppTiming, // TRACK_PRESENTMON
         mPMConsumer->mTrackPcLatency); // TRACK_PC_LATENCY
+    traceProps.EventRecordCallback = mEventRecordCallback;
 
     mTraceHandle = OpenTraceW(&traceProps);
     if (mTraceHandle == INVALID_PROCESSTRACE_HANDLE) {
@@ -568,6 +665,20 @@ ULONG PMTraceSession::Start(
         SystemTimeToFileTime(&lst, (FILETIME*) &mStartFileTime);
         // The above conversion stops at milliseconds, so copy the rest over too
         mStartFileTime += traceProps.LogfileHeader.StartTime.QuadPart % 10000;
+
+        // The header start/end times are FILETIMEs (100ns units).  Measure the
+        // duration from the first event, which mEtlWindowBegin/End are
+        // relative to, since the log can start well before its first event.
+        auto etlStartTime = traceProps.LogfileHeader.StartTime.QuadPart;
+        auto firstEventTime = GetEtlFirstEventFileTime(etlPath);
+        mEtlFirstEventFileTime = firstEventTime;
+        if (firstEventTime > etlStartTime) {
+            etlStartTime = firstEventTime;
+        }
+        auto duration100ns = traceProps.LogfileHeader.EndTime.QuadPart - etlStartTime;
+        mEtlDuration = duration100ns > 0
+            ? (uint64_t) ((double) duration100ns * mTimestampFrequency.QuadPart / 10000000.0)
+            : 0;
     }
 
     InitializeTimestampInfo(&mStartTimestamp, mTimestampFrequency);
@@ -614,6 +725,160 @@ void PMTraceSession::Stop()
     }
 }
 
+ULONG PMTraceSession::ProcessEtl()
+{
+    if (mEtlStatefulEvents == nullptr || mEtlWindowBegin == 0) {
+        return ProcessTrace(&mTraceHandle, 1, NULL, NULL);
+    }
+
+    // Handle the stateful events before the window, with the same timestamp
+    // base as if they were read from the ETL.
+    std::vector<EVENT_RECORD const*> statefulEvents;
+    uint64_t firstTimestamp = 0;
+    if (!mEtlStatefulEvents->WaitForEventsBefore(mEtlWindowBegin, &statefulEvents, &firstTimestamp)) {
+        return ERROR_CANCELLED;
+    }
+
+    mStartTimestamp.QuadPart = (LONGLONG) firstTimestamp;
+    for (auto e : statefulEvents) {
+        if (!mContinueProcessingBuffers) {
+            return ERROR_CANCELLED;
+        }
+        auto eventRecord = *e;
+        eventRecord.UserContext = this;
+        mEventRecordCallback(&eventRecord);
+    }
+    mEtlStatefulEventsHandled = true;
+
+    // Start reading the ETL at the window.  ProcessTrace() takes a FILETIME
+    // start, so start a little before the window in case of rounding; the
+    // events before the window are skipped by the EventRecordCallback.
+    if (mEtlFirstEventFileTime == 0) {
+        return ProcessTrace(&mTraceHandle, 1, NULL, NULL);
+    }
+    auto windowBegin100ns = (int64_t) ((double) mEtlWindowBegin * 10000000.0 / mTimestampFrequency.QuadPart);
+    ULARGE_INTEGER startTime = {};
+    startTime.QuadPart = (ULONGLONG) std::max<int64_t>(mEtlFirstEventFileTime + windowBegin100ns - 10000, 0);
+    FILETIME startFileTime = {};
+    startFileTime.dwLowDateTime  = startTime.LowPart;
+    startFileTime.dwHighDateTime = startTime.HighPart;
+    return ProcessTrace(&mTraceHandle, 1, &startFileTime, NULL);
+}
+
+void CALLBACK EtlStatefulEvents::EventRecordCallback(EVENT_RECORD* pEventRecord)
+{
+    auto statefulEvents = (EtlStatefulEvents*) pEventRecord->UserContext;
+    auto const& hdr = pEventRecord->EventHeader;
+
+    auto timestamp = (uint64_t) hdr.TimeStamp.QuadPart;
+    if (statefulEvents->mFirstTimestamp == 0) {
+        statefulEvents->mFirstTimestamp = timestamp;
+    }
+
+    auto t = timestamp - statefulEvents->mFirstTimestamp;
+    if (t >= statefulEvents->mEnd) {
+        statefulEvents->mReachedEnd = true;
+        return;
+    }
+
+    std::unique_ptr<Event> e;
+    if (IsStatefulEtlEvent(hdr)) {
+        e = std::make_unique<Event>();
+        e->mRecord = *pEventRecord;
+        e->mRecord.UserContext = nullptr;
+        e->mUserData.assign((uint8_t const*) pEventRecord->UserData,
+                            (uint8_t const*) pEventRecord->UserData + pEventRecord->UserDataLength);
+        e->mRecord.UserData = e->mUserData.data();
+        e->mExtendedData.assign(pEventRecord->ExtendedData, pEventRecord->ExtendedData + pEventRecord->ExtendedDataCount);
+        e->mExtendedDataItems.resize(pEventRecord->ExtendedDataCount);
+        for (USHORT i = 0; i < pEventRecord->ExtendedDataCount; ++i) {
+            auto const& item = pEventRecord->ExtendedData[i];
+            e->mExtendedDataItems[i].assign((uint8_t const*) item.DataPtr, (uint8_t const*) item.DataPtr + item.DataSize);
+            e->mExtendedData[i].DataPtr = (ULONGLONG) e->mExtendedDataItems[i].data();
+        }
+        e->mRecord.ExtendedData = e->mExtendedData.data();
+    }
+
+    // Stateful events are rare, so publish the time read through only with
+    // them or every so often rather than locking for every event.
+    statefulEvents->mUnpublishedEventCount += 1;
+    if (e != nullptr || statefulEvents->mUnpublishedEventCount == 4096) {
+        statefulEvents->mUnpublishedEventCount = 0;
+
+        std::lock_guard<std::mutex> lock(statefulEvents->mMutex);
+        if (e != nullptr) {
+            statefulEvents->mEvents.emplace_back(std::move(e));
+        }
+        statefulEvents->mReadThrough = t;
+        statefulEvents->mReadCondition.notify_all();
+    }
+}
+
+ULONG CALLBACK EtlStatefulEvents::BufferCallback(EVENT_TRACE_LOGFILEW* pLogFile)
+{
+    auto statefulEvents = (EtlStatefulEvents*) pLogFile->Context;
+    return statefulEvents->mReachedEnd || statefulEvents->mCancelled ? FALSE : TRUE;
+}
+
+ULONG EtlStatefulEvents::Read(wchar_t const* etlPath, uint64_t end)
+{
+    mEnd = end;
+
+    EVENT_TRACE_LOGFILEW traceProps = {};
+    traceProps.LogFileName = (wchar_t*) etlPath;
+    traceProps.ProcessTraceMode = PROCESS_TRACE_MODE_EVENT_RECORD | PROCESS_TRACE_MODE_RAW_TIMESTAMP;
+    traceProps.EventRecordCallback = &EventRecordCallback;
+    traceProps.BufferCallback = &BufferCallback;
+    traceProps.Context = this;
+
+    ULONG status = ERROR_SUCCESS;
+    auto traceHandle = OpenTraceW(&traceProps);
+    if (traceHandle == INVALID_PROCESSTRACE_HANDLE) {
+        status = GetLastError();
+    } else {
+        ProcessTrace(&traceHandle, 1, NULL, NULL);
+        CloseTrace(traceHandle);
+    }
+
+    // Unless reading failed or was cancelled, all the events before end have
+    // been read (whether or not the ETL reached end).
+    std::lock_guard<std::mutex> lock(mMutex);
+    mReadThrough = UINT64_MAX;
+    mFailed = status != ERROR_SUCCESS || mCancelled;
+    mReadCondition.notify_all();
+    return status;
+}
+
+void EtlStatefulEvents::Cancel()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCancelled = true;
+    mReadCondition.notify_all();
+}
+
+bool EtlStatefulEvents::WaitForEventsBefore(
+    uint64_t time,
+    std::vector<EVENT_RECORD const*>* events,
+    uint64_t* firstTimestamp)
+{
+    // Events are read in time order, so once an event at or after time has
+    // been read all the events before it have been.
+    std::unique_lock<std::mutex> lock(mMutex);
+    mReadCondition.wait(lock, [&]() { return mReadThrough >= time || mFailed || mCancelled; });
+    if (mFailed || mCancelled) {
+        return false;
+    }
+
+    for (auto const& e : mEvents) {
+        if ((uint64_t) e->mRecord.EventHeader.TimeStamp.QuadPart - mFirstTimestamp >= time) {
+            break;
+        }
+        events->push_back(&e->mRecord);
+    }
+    *firstTimestamp = mFirstTimestamp;
+    return true;
+}
+
 ULONG StopNamedTraceSession(wchar_t const* sessionName)
 {
     TraceProperties sessionProps = {};
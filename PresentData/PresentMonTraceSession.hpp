@@ -3,8 +3,54 @@
 // SPDX-License-Identifier: MIT
 #include "../IntelPresentMon/CommonUtilities/PrecisionWaiter.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 struct PMTraceConsumer;
 
+// The events of an ETL that set up state the consumer needs for later events
+// (see mEtlWindowBegin below), read in one pass and shared by the sessions
+// that analyze time windows of the ETL.  A session with a window that starts
+// later in the ETL handles these events and then starts reading the ETL at
+// its window, instead of reading the ETL from the start.
+class EtlStatefulEvents {
+public:
+    // Read the stateful events before end (relative to the first event in the
+    // ETL).  This blocks until they are read, the ETL ends, or Cancel() is
+    // called, but the events can be used as they are read.
+    ULONG Read(wchar_t const* etlPath, uint64_t end);
+    void Cancel();
+
+    // Wait until the stateful events before time have been read and return
+    // them, in order.  Returns false if reading failed or was cancelled.
+    bool WaitForEventsBefore(uint64_t time, std::vector<EVENT_RECORD const*>* events, uint64_t* firstTimestamp);
+
+private:
+    struct Event {
+        EVENT_RECORD mRecord;
+        std::vector<uint8_t> mUserData;
+        std::vector<EVENT_HEADER_EXTENDED_DATA_ITEM> mExtendedData;
+        std::vector<std::vector<uint8_t>> mExtendedDataItems;
+    };
+
+    static void CALLBACK EventRecordCallback(EVENT_RECORD* pEventRecord);
+    static ULONG CALLBACK BufferCallback(EVENT_TRACE_LOGFILEW* pLogFile);
+
+    std::mutex mMutex;
+    std::condition_variable mReadCondition;
+    std::vector<std::unique_ptr<Event>> mEvents;
+    uint64_t mFirstTimestamp = 0;
+    uint64_t mEnd = 0;
+    uint64_t mReadThrough = 0;          // A time (relative to the first event) before which all the events have been read
+    uint32_t mUnpublishedEventCount = 0;
+    bool mReachedEnd = false;
+    bool mFailed = false;
+    std::atomic<bool> mCancelled = false;
+};
+
 struct PMTraceSession {
     enum TimestampType {
         TIMESTAMP_TYPE_QPC = 1,
@@ -35,12 +81,50 @@ struct PMTraceSession {
     ULONG mNumEventsLost = 0;
     ULONG mNumBuffersLost = 0;
 
+    // Duration of the ETL from its first event to the end time in its header,
+    // in timestamp ticks (0 if unknown or not processing an ETL).
+    uint64_t mEtlDuration = 0;
+
+    // Optional time window of an ETL to analyze, relative to the first event
+    // in the ETL.  This is used to analyze time shards of one ETL in parallel.
+    // Events before the window are skipped except for the ones that set up
+    // state the consumer needs for later events (process and graphics
+    // device/context lifetime, and event metadata), and processing stops at
+    // the first event past the window.  Not supported with ETL event pacing.
+    uint64_t mEtlWindowBegin = 0;
+    uint64_t mEtlWindowEnd = UINT64_MAX;
+
+    // Optional stateful events of the ETL, read separately.  If set, the
+    // stateful events before mEtlWindowBegin are taken from here and
+    // ProcessEtl() starts reading the ETL at the window.
+    EtlStatefulEvents* mEtlStatefulEvents = nullptr;
+
+    // Optional times in the ETL window, relative to the first event and in
+    // increasing order, at which to record a hash of the consumer's tracked
+    // presents (see PMTraceConsumer::HashTrackedPresents()).  The hash for
+    // each time is taken before handling the first event at or after it, and
+    // is written to mEtlCheckpointHashes[i] before mEtlCheckpointCount is
+    // incremented past i, so that other threads can read the hashes while the
+    // ETL is being processed.
+    std::vector<uint64_t> mEtlCheckpointTimes;
+    std::vector<size_t> mEtlCheckpointHashes;
+    std::atomic<size_t> mEtlCheckpointCount = 0;
+
     bool mIsRealtimeSession = false;
 
     ULONG Start(wchar_t const* etlPath,      // If nullptr, start a live/realtime tracing session
                 wchar_t const* sessionName); // Required session name
     void Stop();
 
+    // Process the events of the ETL opened by Start(), blocking until they
+    // are all processed or Stop() is called.
+    ULONG ProcessEtl();
+
+    // Internal state used by ProcessEtl().
+    PEVENT_RECORD_CALLBACK mEventRecordCallback = nullptr;
+    int64_t mEtlFirstEventFileTime = 0;
+    bool mEtlStatefulEventsHandled = false;
+
     double TimestampDeltaToMilliSeconds(uint64_t timestampDelta) const;
     double TimestampDeltaToMilliSeconds(uint64_t timestampFrom, uint64_t timestampTo) const;
     double TimestampDeltaToUnsignedMilliSeconds(uint64_t timestampFrom, uint64_t timestampTo) const;
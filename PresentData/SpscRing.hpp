@@ -0,0 +1,162 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// SpscRing is a bounded queue for handing items from exactly one producer thread to exactly one
+// consumer thread without locks.
+//
+// TryPush() and PopBatch() don't take locks: the producer writes mHead, the consumer claims the
+// items it pops by advancing mClaimed and frees their slots by advancing mTail, and each side
+// keeps a cached copy of the other side's index, so the shared cache lines are only touched when
+// the cached view says the ring is full/empty.  The indices live on separate cache lines to avoid
+// false sharing between the two threads.
+//
+// PushWait() is for producers that must not drop items (e.g., offline ETL analysis with
+// backpressure): it spins briefly, yielding, and then blocks on mTail until the consumer frees
+// space.  The consumer only issues a wake-up when the producer has announced that it is blocked.
+//
+// PushDropOldest() is for producers that would rather lose the oldest items than the newest
+// (e.g., realtime analysis): when the ring is full, the producer claims the oldest item itself
+// and discards it.  It can only do so while no PopBatch() is in progress; otherwise it yields
+// until that pop frees its slots.
+//
+// Popped slots are moved-from, so the ring does not keep items (e.g., shared_ptrs) alive after
+// they've been handed off.
+template<typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t minCapacity)
+    {
+        size_t capacity = 1;
+        while (capacity < minCapacity) {
+            capacity <<= 1;
+        }
+        mSlots.resize(capacity);
+        mMask = capacity - 1;
+    }
+
+    SpscRing(SpscRing const&) = delete;
+    SpscRing& operator=(SpscRing const&) = delete;
+
+    size_t Capacity() const { return mSlots.size(); }
+
+    // Producer: returns false if the ring is full.
+    bool TryPush(T&& item)
+    {
+        auto head = mHead.load(std::memory_order_relaxed);
+        if (head - mCachedTail == mSlots.size()) {
+            mCachedTail = mTail.load(std::memory_order_acquire);
+            if (head - mCachedTail == mSlots.size()) {
+                return false;
+            }
+        }
+        mSlots[head & mMask] = std::move(item);
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer: push, discarding the oldest item if the ring is full.  Returns true if an item
+    // was discarded.
+    bool PushDropOldest(T&& item)
+    {
+        bool dropped = false;
+        while (!TryPush(std::move(item))) {
+            // Claiming the oldest item only succeeds if the consumer has no claim outstanding,
+            // i.e., if mClaimed still equals mTail.
+            auto tail = mTail.load(std::memory_order_acquire);
+            auto claimed = tail;
+            if (mClaimed.compare_exchange_strong(claimed, tail + 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                mSlots[tail & mMask] = T{};
+                mTail.store(tail + 1, std::memory_order_release);
+                dropped = true;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        return dropped;
+    }
+
+    // Producer: push, spinning and then blocking while the ring is full.
+    void PushWait(T&& item)
+    {
+        for (uint32_t spin = 0; !TryPush(std::move(item)); ++spin) {
+            if (spin < SPIN_COUNT) {
+                std::this_thread::yield();
+                continue;
+            }
+            // Announce the wait before re-checking, so that either the re-check sees the
+            // consumer's progress or the consumer sees the announcement and notifies.
+            auto tail = mTail.load(std::memory_order_seq_cst);
+            mProducerWaiting.store(true, std::memory_order_seq_cst);
+            if (mHead.load(std::memory_order_relaxed) - mTail.load(std::memory_order_seq_cst) == mSlots.size()) {
+                mTail.wait(tail, std::memory_order_seq_cst);
+            }
+            mProducerWaiting.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // Consumer: move up to maxCount of the oldest items into out, returning the number moved.
+    size_t PopBatch(T* out, size_t maxCount)
+    {
+        // Claim the items first, so that PushDropOldest() can't discard them while they're read.
+        auto claimed = mClaimed.load(std::memory_order_acquire);
+        size_t count;
+        do {
+            if (mCachedHead <= claimed) {
+                mCachedHead = mHead.load(std::memory_order_acquire);
+            }
+            count = (size_t) (mCachedHead - claimed);
+            if (count > maxCount) {
+                count = maxCount;
+            }
+            if (count == 0) {
+                return 0;
+            }
+        } while (!mClaimed.compare_exchange_weak(claimed, claimed + count, std::memory_order_acq_rel, std::memory_order_acquire));
+
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = std::move(mSlots[(claimed + i) & mMask]);
+        }
+        // An item the producer has just discarded may not have been freed yet.
+        while (mTail.load(std::memory_order_acquire) != claimed) {
+            std::this_thread::yield();
+        }
+        mTail.store(claimed + count, std::memory_order_seq_cst);
+        if (mProducerWaiting.load(std::memory_order_seq_cst)) {
+            mTail.notify_one();
+        }
+        return count;
+    }
+
+    // Consumer: the number of items available to PopBatch() (more may arrive concurrently).
+    size_t ReadableCount()
+    {
+        mCachedHead = mHead.load(std::memory_order_acquire);
+        return (size_t) (mCachedHead - mClaimed.load(std::memory_order_acquire));
+    }
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    static constexpr uint32_t SPIN_COUNT = 64;
+
+    std::vector<T> mSlots;
+    size_t mMask = 0;
+
+    // Producer-owned
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> mHead = 0; // Index of the next slot to write
+    uint64_t mCachedTail = 0;                                  // Producer's last observed mTail
+
+    // Consumer-owned (the producer only advances them in PushDropOldest())
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> mClaimed = 0; // Index of the next item to read
+    std::atomic<uint64_t> mTail = 0;                              // Index of the next slot to free
+    uint64_t mCachedHead = 0;                                     // Consumer's last observed mHead
+
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> mProducerWaiting = false;
+};
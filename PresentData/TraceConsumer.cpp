@@ -147,6 +147,56 @@ uint32_t GetPropertyDataOffset(TRACE_EVENT_INFO const& tei, EVENT_RECORD const&
     return offset;
 }
 
+// Whether the size and position of the properties following this one can be determined from the
+// metadata alone.
+bool IsFixedLayoutProperty(EVENT_PROPERTY_INFO const& epi)
+{
+    if (epi.Flags & (PropertyStruct | PropertyParamCount | PropertyParamLength)) {
+        return false;
+    }
+
+    switch (epi.nonStructType.InType) {
+    case TDH_INTYPE_UNICODESTRING:
+    case TDH_INTYPE_ANSISTRING:
+        return epi.length != 0;
+    case TDH_INTYPE_SID:
+    case TDH_INTYPE_WBEMSID:
+        return false;
+    }
+
+    return true;
+}
+
+void CompileEventLayout(TRACE_EVENT_INFO const& tei, EVENT_RECORD const& eventRecord, EventLayout* layout)
+{
+    layout->properties_.clear();
+    layout->compiled_ = true;
+    layout->complete_ = false;
+    layout->tailOffset_ = 0;
+
+    for (uint32_t i = 0; i < tei.TopLevelPropertyCount; ++i) {
+        auto const& epi = tei.EventPropertyInfoArray[i];
+        if (!IsFixedLayoutProperty(epi)) {
+            return;
+        }
+
+        auto info = GetPropertyInfo(tei, eventRecord, i, layout->tailOffset_);
+
+        EventPropertyLayout prop;
+        prop.name_      = TEI_PROPERTY_NAME(&tei, &epi);
+        prop.queryName_ = nullptr;
+        prop.offset_    = layout->tailOffset_;
+        prop.size_      = info.size_;
+        prop.count_     = info.count_;
+        prop.status_    = info.status_ | PROP_STATUS_FOUND;
+        layout->properties_.push_back(prop);
+
+        layout->tailOffset_ += info.size_ * info.count_;
+    }
+
+    layout->complete_ = true;
+}
+
 }
 
 size_t EventMetadataKeyHash::operator()(EventMetadataKey const& key) const
@@ -179,7 +229,10 @@ void EventMetadata::AddMetadata(EVENT_RECORD* eventRecord)
         EventMetadataKey key;
         key.guid_ = tei->ProviderGuid;
         key.desc_ = tei->EventDescriptor;
-        metadata_[key].assign(userData, userData + eventRecord->UserDataLength);
+        auto& entry = metadata_[key];
+        entry.tei_.assign(userData, userData + eventRecord->UserDataLength);
+        entry.layout_[0] = EventLayout();
+        entry.layout_[1] = EventLayout();
     }
 }
 
@@ -216,21 +269,40 @@ uint32_t EventMetadata::GetEventDataWithCount(EVENT_RECORD* eventRecord, EventDa
         ULONG bufferSize = 0;
         auto status = TdhGetEventInformation(eventRecord, 0, nullptr, nullptr, &bufferSize);
         if (status == ERROR_INSUFFICIENT_BUFFER) {
-            ii = metadata_.emplace(key, std::vector<uint8_t>(bufferSize, 0)).first;
+            ii = metadata_.emplace(key, EventMetadataEntry()).first;
+            ii->second.tei_.resize(bufferSize, 0);
 
-            status = TdhGetEventInformation(eventRecord, 0, nullptr, (TRACE_EVENT_INFO*) ii->second.data(), &bufferSize);
+            status = TdhGetEventInformation(eventRecord, 0, nullptr, (TRACE_EVENT_INFO*) ii->second.tei_.data(), &bufferSize);
             assert(status == ERROR_SUCCESS);
         } else {
             // No schema registered with system, nor ETL-embedded metadata.
-            ii = metadata_.emplace(key, std::vector<uint8_t>(sizeof(TRACE_EVENT_INFO), 0)).first;
+            ii = metadata_.emplace(key, EventMetadataEntry()).first;
+            ii->second.tei_.resize(sizeof(TRACE_EVENT_INFO), 0);
             assert(false);
         }
-}
+    }
 
-    auto tei = (TRACE_EVENT_INFO*) ii->second.data();
+    auto tei = (TRACE_EVENT_INFO*) ii->second.tei_.data();
 
-    // Lookup properties in metadata
+    // Lookup properties using the compiled layout first, and only walk the
+    // properties that follow the fixed-layout ones if needed.
     uint32_t foundCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t firstOffset = 0;
+    if (useCompiledLayouts_) {
+        auto layout = &ii->second.layout_[(eventRecord->EventHeader.Flags & EVENT_HEADER_FLAG_64_BIT_HEADER) ? 1 : 0];
+        if (!layout->compiled_) {
+            CompileEventLayout(*tei, *eventRecord, layout);
+        }
+
+        foundCount = GetEventDataFromLayout(eventRecord, layout, desc, descCount);
+        if (foundCount == descCount || layout->complete_) {
+            return foundCount;
+        }
+
+        firstIndex = (uint32_t) layout->properties_.size();
+        firstOffset = layout->tailOffset_;
+    }
 
 #if 0 /* Helper to see all property names while debugging */
     std::vector<wchar_t const*> props(tei->TopLevelPropertyCount, nullptr);
@@ -239,7 +311,7 @@ uint32_t EventMetadata::GetEventDataWithCount(EVENT_RECORD* eventRecord, EventDa
     }
 #endif
 
-    for (uint32_t i = 0, offset = 0; i < tei->TopLevelPropertyCount; ++i) {
+    for (uint32_t i = firstIndex, offset = firstOffset; i < tei->TopLevelPropertyCount; ++i) {
         auto info = GetPropertyInfo(*tei, *eventRecord, i, offset);
 
         auto propName = TEI_PROPERTY_NAME(tei, &tei->EventPropertyInfoArray[i]);
@@ -265,6 +337,46 @@ uint32_t EventMetadata::GetEventDataWithCount(EVENT_RECORD* eventRecord, EventDa
     return foundCount;
 }
 
+uint32_t EventMetadata::GetEventDataFromLayout(EVENT_RECORD* eventRecord, EventLayout* layout, EventDataDesc* desc, uint32_t descCount)
+{
+    uint32_t foundCount = 0;
+    for (uint32_t j = 0; j < descCount; ++j) {
+        if (desc[j].status_ != PROP_STATUS_NOT_FOUND) {
+            continue;
+        }
+
+        // Callers use string literals for the names, so most lookups match
+        // the name pointer from a previous lookup without any string compares.
+        EventPropertyLayout* match = nullptr;
+        for (auto& prop : layout->properties_) {
+            if (prop.queryName_ == desc[j].name_) {
+                match = &prop;
+                break;
+            }
+        }
+        if (match == nullptr) {
+            for (auto& prop : layout->properties_) {
+                if (wcscmp(prop.name_, desc[j].name_) == 0) {
+                    prop.queryName_ = desc[j].name_;
+                    match = &prop;
+                    break;
+                }
+            }
+            if (match == nullptr) {
+                continue;
+            }
+        }
+
+        desc[j].data_   = (void*) ((uintptr_t) eventRecord->UserData + match->offset_);
+        desc[j].size_   = match->size_;
+        desc[j].count_  = match->count_;
+        desc[j].status_ = match->status_;
+        foundCount += 1;
+    }
+
+    return foundCount;
+}
+
 namespace {
 
 template <typename T>
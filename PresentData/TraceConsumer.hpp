@@ -30,7 +30,7 @@ enum PropertyStatus {
 };
 
 struct EventDataDesc {
-    wchar_t const* name_;   // Property name
+    wchar_t const* name_;   // Property name (must have static storage duration, e.g., a string literal)
     void* data_;            // OUT pointer to property data
     uint32_t size_;         // OUT size of a property data element
     uint32_t count_;        // OUT number of elements (if it's an array property)
@@ -67,8 +67,38 @@ template<> std::wstring EventDataDesc::GetData<std::wstring>() const;
 // specialization for bool because it is actually stored as uint32_t
 template<> bool EventDataDesc::GetData<bool>() const;
 
+// EventLayout is a compiled form of an event's TRACE_EVENT_INFO, built the first time the event is
+// decoded.  Top-level properties are listed in order until the first one whose size or position
+// depends on the event payload (e.g., a null-terminated string or an array with a count property);
+// those properties are resolved to fixed offsets so looking them up does not require walking the
+// TRACE_EVENT_INFO.  Properties after that are looked up with the full walk.
+//
+// Layouts are compiled separately for 32- and 64-bit event headers because the size of pointer
+// properties differs.
+struct EventPropertyLayout {
+    wchar_t const* name_;       // Property name, stored in the TRACE_EVENT_INFO
+    wchar_t const* queryName_;  // Last EventDataDesc::name_ pointer that matched this property
+    uint32_t offset_;
+    uint32_t size_;
+    uint32_t count_;
+    uint32_t status_;
+};
+
+struct EventLayout {
+    std::vector<EventPropertyLayout> properties_;
+    uint32_t tailOffset_ = 0;   // Offset of the first property not in properties_
+    bool compiled_ = false;
+    bool complete_ = false;     // true if properties_ includes every top-level property
+};
+
+struct EventMetadataEntry {
+    std::vector<uint8_t> tei_;  // TRACE_EVENT_INFO
+    EventLayout layout_[2];     // [0] for 32-bit event headers, [1] for 64-bit event headers
+};
+
 struct EventMetadata {
-    std::unordered_map<EventMetadataKey, std::vector<uint8_t>, EventMetadataKeyHash, EventMetadataKeyEqual> metadata_;
+    std::unordered_map<EventMetadataKey, EventMetadataEntry, EventMetadataKeyHash, EventMetadataKeyEqual> metadata_;
+    bool useCompiledLayouts_ = true;
 
     void AddMetadata(EVENT_RECORD* eventRecord);
     void GetEventData(EVENT_RECORD* eventRecord, EventDataDesc* desc, uint32_t descCount, uint32_t optionalCount=0);
@@ -83,4 +113,5 @@ struct EventMetadata {
 
 private:
     uint32_t GetEventDataWithCount(EVENT_RECORD* eventRecord, EventDataDesc* desc, uint32_t descCount);
+    uint32_t GetEventDataFromLayout(EVENT_RECORD* eventRecord, EventLayout* layout, EventDataDesc* desc, uint32_t descCount);
 };
@@ -0,0 +1,423 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#include "PresentMon.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <thread>
+
+// --etl_batch analyzes a list of ETL files on a bounded pool of worker threads.
+// Each worker takes the next unprocessed ETL, analyzes it with its own
+// PMTraceConsumer and PMTraceSession, and writes that ETL's CSV(s) using the
+// regular output path (see RunBatchOutput() in OutputThread.cpp).  When all
+// the ETLs are done, a summary CSV with one row per ETL plus the batch totals
+// is written and the per-worker throughput is reported.
+//
+// Event metadata obtained from TDH is shared between workers: each worker
+// publishes the TRACE_EVENT_INFOs it looked up when it finishes an ETL, and
+// seeds the consumer of its next ETL with everything published so far.  The
+// compiled property layouts point into the owning entry's TRACE_EVENT_INFO so
+// they are not shared; each consumer compiles its own.
+
+namespace {
+
+struct BatchJob {
+    std::wstring mEtlPath;
+    std::wstring mCsvPath;
+
+    // Results
+    ULONG mStatus = ERROR_SUCCESS;
+    bool mStarted = false;
+    bool mCancelled = false;
+    uint64_t mFileSize = 0;
+    uint64_t mPresentCount = 0;
+    uint32_t mNumOverflowedPresents = 0;
+    ULONG mNumEventsLost = 0;
+    ULONG mNumBuffersLost = 0;
+    double mAnalysisSeconds = 0.0;
+    uint32_t mWorkerIndex = 0;
+};
+
+struct BatchWorkerStats {
+    uint32_t mJobCount = 0;
+    uint64_t mPresentCount = 0;
+    uint64_t mBytes = 0;
+    double mBusySeconds = 0.0;
+};
+
+std::vector<BatchJob> gJobs;
+std::atomic<size_t> gNextJob = 0;
+std::atomic<size_t> gCompletedJobCount = 0;
+std::atomic<bool> gCancel = false;
+
+// Sessions currently being processed, so that CTRL+C can stop them.
+std::mutex gActiveSessionsMutex;
+std::set<PMTraceSession*> gActiveSessions;
+
+// TRACE_EVENT_INFOs published by finished workers.
+std::mutex gSharedMetadataMutex;
+EventMetadata gSharedMetadata;
+
+std::mutex gConsoleMutex;
+
+// Returns the file name without any directory or extension.
+std::wstring GetFileStem(std::wstring const& path)
+{
+    auto i = path.find_last_of(L"/\\");
+    auto name = i == std::wstring::npos ? path : path.substr(i + 1);
+    auto j = name.find_last_of(L'.');
+    return j == std::wstring::npos ? name : name.substr(0, j);
+}
+
+bool IsEtlPath(std::wstring const& path)
+{
+    return path.size() >= 4 && _wcsicmp(path.c_str() + path.size() - 4, L".etl") == 0;
+}
+
+// Collect the ETLs to analyze: every *.etl in a directory (sorted by name), a
+// single .etl, or the paths listed one per line in a text file (empty lines
+// and lines starting with '#' are ignored).
+bool CollectEtlFiles(wchar_t const* batchPath, std::vector<std::wstring>* etlPaths)
+{
+    auto attributes = GetFileAttributesW(batchPath);
+    if (attributes == INVALID_FILE_ATTRIBUTES) {
+        PrintError(L"error: --etl_batch path not found: %s\n", batchPath);
+        return false;
+    }
+
+    if (attributes & FILE_ATTRIBUTE_DIRECTORY) {
+        std::wstring dir = batchPath;
+        if (!dir.empty() && dir.back() != L'\\' && dir.back() != L'/') {
+            dir += L'\\';
+        }
+
+        WIN32_FIND_DATAW findData = {};
+        auto h = FindFirstFileW((dir + L"*.etl").c_str(), &findData);
+        if (h != INVALID_HANDLE_VALUE) {
+            do {
+                if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+                    etlPaths->emplace_back(dir + findData.cFileName);
+                }
+            } while (FindNextFileW(h, &findData));
+            FindClose(h);
+        }
+
+        std::sort(etlPaths->begin(), etlPaths->end());
+    } else if (IsEtlPath(batchPath)) {
+        etlPaths->emplace_back(batchPath);
+    } else {
+        std::wifstream list(batchPath);
+        for (std::wstring line; std::getline(list, line); ) {
+            auto first = line.find_first_not_of(L" \t\"");
+            auto last = line.find_last_not_of(L" \t\"\r");
+            if (first == std::wstring::npos || line[first] == L'#') {
+                continue;
+            }
+            etlPaths->emplace_back(line.substr(first, last - first + 1));
+        }
+    }
+
+    if (etlPaths->empty()) {
+        PrintError(L"error: no ETL files found for --etl_batch %s\n", batchPath);
+        return false;
+    }
+
+    return true;
+}
+
+// Each ETL's CSV is named after the ETL, with a numeric suffix if several ETLs
+// in the batch have the same name.
+void AssignCsvPaths(std::wstring const& outputDir)
+{
+    std::set<std::wstring> usedNames;
+    for (auto& job : gJobs) {
+        auto name = GetFileStem(job.mEtlPath);
+
+        auto uniqueName = name;
+        for (uint32_t i = 2; !usedNames.emplace(uniqueName).second; ++i) {
+            uniqueName = name + L"-" + std::to_wstring(i);
+        }
+
+        job.mCsvPath = outputDir + uniqueName + (GetCommandLineArgs().mBinaryOutput ? L".pmcap" : L".csv");
+    }
+}
+
+void SeedMetadata(EventMetadata* metadata)
+{
+    std::lock_guard<std::mutex> lock(gSharedMetadataMutex);
+    for (auto const& pair : gSharedMetadata.metadata_) {
+        metadata->metadata_.emplace(pair.first, EventMetadataEntry{ pair.second.tei_ });
+    }
+}
+
+void PublishMetadata(EventMetadata const& metadata)
+{
+    std::lock_guard<std::mutex> lock(gSharedMetadataMutex);
+    for (auto const& pair : metadata.metadata_) {
+        if (gSharedMetadata.metadata_.find(pair.first) == gSharedMetadata.metadata_.end()) {
+            gSharedMetadata.metadata_.emplace(pair.first, EventMetadataEntry{ pair.second.tei_ });
+        }
+    }
+}
+
+void AnalyzeEtl(CommandLineArgs const& batchArgs, BatchJob* job)
+{
+    WIN32_FILE_ATTRIBUTE_DATA fileData = {};
+    if (GetFileAttributesExW(job->mEtlPath.c_str(), GetFileExInfoStandard, &fileData)) {
+        job->mFileSize = ((uint64_t) fileData.nFileSizeHigh << 32) | fileData.nFileSizeLow;
+    }
+
+    // The output for this ETL uses a copy of the arguments that targets its
+    // ETL and CSV.
+    auto args = batchArgs;
+    args.mEtlFileName = job->mEtlPath.c_str();
+    args.mOutputCsvFileName = job->mCsvPath.c_str();
+    args.mConsoleOutput = ConsoleOutput::None;
+
+    PMTraceConsumer pmConsumer(
+        args.mPresentEventCircularBufferSize != 0
+        ? args.mPresentEventCircularBufferSize
+        : PMTraceConsumer::PRESENTEVENT_CIRCULAR_BUFFER_SIZE);
+    ConfigureConsumer(args, &pmConsumer);
+    SeedMetadata(&pmConsumer.mMetadata);
+
+    PMTraceSession pmSession;
+    pmSession.mPMConsumer = &pmConsumer;
+    job->mStatus = pmSession.Start(args.mEtlFileName, args.mSessionName);
+    if (job->mStatus != ERROR_SUCCESS) {
+        return;
+    }
+
+    if (pmConsumer.mDeferralTimeLimit == 0) {
+        pmConsumer.mDeferralTimeLimit = pmSession.mTimestampFrequency.QuadPart * 2;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(gActiveSessionsMutex);
+        if (gCancel) {
+            pmSession.mContinueProcessingBuffers = FALSE;
+        }
+        gActiveSessions.emplace(&pmSession);
+    }
+
+    // ProcessTrace() runs on a helper thread while this thread processes the
+    // output, as the consumer may block waiting for the output to catch up.
+    std::atomic<bool> traceDone = false;
+    std::thread traceThread([&]() {
+        SetThreadDescription(GetCurrentThread(), L"PresentMon Batch Consumer Thread");
+        ProcessTrace(&pmSession.mTraceHandle, 1, NULL, NULL);
+        traceDone = true;
+    });
+
+    SetThreadCommandLineArgs(&args);
+    job->mPresentCount = RunBatchOutput(pmSession, traceDone);
+    SetThreadCommandLineArgs(nullptr);
+
+    traceThread.join();
+
+    {
+        std::lock_guard<std::mutex> lock(gActiveSessionsMutex);
+        gActiveSessions.erase(&pmSession);
+        job->mCancelled = pmSession.mContinueProcessingBuffers == FALSE;
+    }
+
+    pmSession.Stop();
+
+    job->mNumOverflowedPresents = pmConsumer.mNumOverflowedPresents;
+    job->mNumEventsLost = pmSession.mNumEventsLost;
+    job->mNumBuffersLost = pmSession.mNumBuffersLost;
+
+    PublishMetadata(pmConsumer.mMetadata);
+}
+
+void BatchWorker(CommandLineArgs const* batchArgs, uint32_t workerIndex, BatchWorkerStats* stats)
+{
+    SetThreadDescription(GetCurrentThread(), L"PresentMon Batch Worker Thread");
+
+    while (!gCancel) {
+        auto jobIndex = gNextJob.fetch_add(1);
+        if (jobIndex >= gJobs.size()) {
+            break;
+        }
+
+        auto job = &gJobs[jobIndex];
+        job->mStarted = true;
+        job->mWorkerIndex = workerIndex;
+
+        auto t0 = std::chrono::steady_clock::now();
+        AnalyzeEtl(*batchArgs, job);
+        job->mAnalysisSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        stats->mJobCount += 1;
+        stats->mPresentCount += job->mPresentCount;
+        stats->mBytes += job->mFileSize;
+        stats->mBusySeconds += job->mAnalysisSeconds;
+
+        auto completedCount = gCompletedJobCount.fetch_add(1) + 1;
+        std::lock_guard<std::mutex> lock(gConsoleMutex);
+        if (job->mStatus != ERROR_SUCCESS) {
+            PrintError(L"[%zu/%zu] %s: failed to open (error %lu)\n", completedCount, gJobs.size(),
+                       job->mEtlPath.c_str(), job->mStatus);
+        } else {
+            wprintf(L"[%zu/%zu] %s: %llu presents in %.2f s%s\n", completedCount, gJobs.size(),
+                    job->mEtlPath.c_str(), job->mPresentCount, job->mAnalysisSeconds,
+                    job->mCancelled ? L" (cancelled)" : L"");
+        }
+    }
+}
+
+BOOL CALLBACK HandleBatchCtrlEvent(DWORD ctrlType)
+{
+    (void) ctrlType;
+
+    // Stop handing out ETLs and stop the ones in progress; the workers then
+    // finish their output and the summary is still written.
+    gCancel = true;
+    std::lock_guard<std::mutex> lock(gActiveSessionsMutex);
+    for (auto pmSession : gActiveSessions) {
+        pmSession->mContinueProcessingBuffers = FALSE;
+    }
+    return TRUE;
+}
+
+char const* JobStatusToString(BatchJob const& job)
+{
+    return !job.mStarted                ? "Skipped"   :
+           job.mStatus != ERROR_SUCCESS ? "Failed"    :
+           job.mCancelled               ? "Cancelled"
+                                        : "Complete";
+}
+
+bool WriteSummaryCsv(std::wstring const& path, double wallSeconds)
+{
+    FILE* fp = nullptr;
+    if (_wfopen_s(&fp, path.c_str(), L"w,ccs=UTF-8")) {
+        return false;
+    }
+
+    fwprintf(fp, L"EtlFile,CsvFile,Status,Worker,SizeMB,Presents,OverflowedPresents,EventsLost,BuffersLost,AnalysisSeconds,PresentsPerSecond\n");
+
+    uint64_t totalBytes = 0;
+    uint64_t totalPresents = 0;
+    uint64_t totalOverflowed = 0;
+    uint64_t totalEventsLost = 0;
+    uint64_t totalBuffersLost = 0;
+    size_t failedCount = 0;
+    for (auto const& job : gJobs) {
+        fwprintf(fp, L"%s,%s,%hs,%u,%.3lf,%llu,%u,%lu,%lu,%.3lf,%.1lf\n",
+                 job.mEtlPath.c_str(),
+                 job.mCsvPath.c_str(),
+                 JobStatusToString(job),
+                 job.mWorkerIndex,
+                 job.mFileSize / (1024.0 * 1024.0),
+                 job.mPresentCount,
+                 job.mNumOverflowedPresents,
+                 job.mNumEventsLost,
+                 job.mNumBuffersLost,
+                 job.mAnalysisSeconds,
+                 job.mAnalysisSeconds > 0.0 ? job.mPresentCount / job.mAnalysisSeconds : 0.0);
+
+        totalBytes       += job.mFileSize;
+        totalPresents    += job.mPresentCount;
+        totalOverflowed  += job.mNumOverflowedPresents;
+        totalEventsLost  += job.mNumEventsLost;
+        totalBuffersLost += job.mNumBuffersLost;
+        failedCount      += job.mStatus != ERROR_SUCCESS ? 1 : 0;
+    }
+
+    fwprintf(fp, L"<Total>,,%zu failed,,%.3lf,%llu,%llu,%llu,%llu,%.3lf,%.1lf\n",
+             failedCount,
+             totalBytes / (1024.0 * 1024.0),
+             totalPresents,
+             totalOverflowed,
+             totalEventsLost,
+             totalBuffersLost,
+             wallSeconds,
+             wallSeconds > 0.0 ? totalPresents / wallSeconds : 0.0);
+
+    fclose(fp);
+    return true;
+}
+
+}
+
+int RunBatchAnalysis()
+{
+    auto const& args = GetCommandLineArgs();
+
+    std::vector<std::wstring> etlPaths;
+    if (!CollectEtlFiles(args.mEtlBatchPath, &etlPaths)) {
+        return 1;
+    }
+
+    std::wstring outputDir;
+    if (args.mBatchOutputDir != nullptr) {
+        outputDir = args.mBatchOutputDir;
+        if (!outputDir.empty() && outputDir.back() != L'\\' && outputDir.back() != L'/') {
+            outputDir += L'\\';
+        }
+        CreateDirectoryW(outputDir.c_str(), nullptr);
+    }
+
+    gJobs.resize(etlPaths.size());
+    for (size_t i = 0, n = etlPaths.size(); i < n; ++i) {
+        gJobs[i].mEtlPath = std::move(etlPaths[i]);
+    }
+    AssignCsvPaths(outputDir);
+
+    uint32_t workerCount = args.mBatchWorkerCount != 0
+        ? args.mBatchWorkerCount
+        : std::max(1u, std::thread::hardware_concurrency());
+    workerCount = (uint32_t) std::min<size_t>(workerCount, gJobs.size());
+
+    wprintf(L"Analyzing %zu ETL files with %u workers.\n", gJobs.size(), workerCount);
+
+    SetConsoleCtrlHandler(HandleBatchCtrlEvent, TRUE);
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<BatchWorkerStats> workerStats(workerCount);
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back(BatchWorker, &args, i, &workerStats[i]);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    auto wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    SetConsoleCtrlHandler(HandleBatchCtrlEvent, FALSE);
+
+    // Report per-worker throughput.
+    uint64_t totalPresents = 0;
+    uint64_t totalBytes = 0;
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        auto const& stats = workerStats[i];
+        wprintf(L"worker %u: %u ETLs, %llu presents, %.1lf MB in %.2lf s (%.1lf presents/s, %.1lf MB/s, %.0lf%% busy)\n",
+                i, stats.mJobCount, stats.mPresentCount, stats.mBytes / (1024.0 * 1024.0), stats.mBusySeconds,
+                stats.mBusySeconds > 0.0 ? stats.mPresentCount / stats.mBusySeconds : 0.0,
+                stats.mBusySeconds > 0.0 ? stats.mBytes / (1024.0 * 1024.0) / stats.mBusySeconds : 0.0,
+                wallSeconds > 0.0 ? 100.0 * stats.mBusySeconds / wallSeconds : 0.0);
+        totalPresents += stats.mPresentCount;
+        totalBytes += stats.mBytes;
+    }
+    wprintf(L"total: %llu presents, %.1lf MB in %.2lf s (%.1lf presents/s, %.1lf MB/s)\n",
+            totalPresents, totalBytes / (1024.0 * 1024.0), wallSeconds,
+            wallSeconds > 0.0 ? totalPresents / wallSeconds : 0.0,
+            wallSeconds > 0.0 ? totalBytes / (1024.0 * 1024.0) / wallSeconds : 0.0);
+
+    auto summaryPath = outputDir + L"PresentMon-BatchSummary.csv";
+    if (!WriteSummaryCsv(summaryPath, wallSeconds)) {
+        PrintError(L"error: failed to write batch summary: %s\n", summaryPath.c_str());
+        return 1;
+    }
+
+    auto failed = std::any_of(gJobs.begin(), gJobs.end(), [](BatchJob const& job) { return job.mStatus != ERROR_SUCCESS; });
+    return failed || gCancel ? 1 : 0;
+}
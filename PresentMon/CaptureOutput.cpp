@@ -0,0 +1,330 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#include "PresentMon.hpp"
+#include "../PresentData/CaptureFile.hpp"
+
+#include <float.h>
+#include <limits>
+#include <string.h>
+
+// --binary_output writes the same columns as the CSV output into a capture file
+// (see ../PresentData/CaptureFile.hpp), without formatting any values as text.
+// Tools/pm_convert_csv converts a capture file into the CSV that would have
+// been written without --binary_output, so the columns below must be kept
+// consistent with WriteCsvHeader<FrameMetrics>() and WriteCsvRow<FrameMetrics>().
+//
+// Time columns in milliseconds or seconds are stored as doubles, --qpc_time
+// columns are stored as QPC values, and --date_time columns are stored as local
+// FILETIMEs.
+
+static thread_local CaptureFileWriter* gGlobalOutputCapture = nullptr;
+
+namespace {
+
+double NaIfZero(double value)
+{
+    return value == 0.0 ? std::numeric_limits<double>::quiet_NaN() : value;
+}
+
+// The strings for the runtime, present mode, etc. are static, so keep a wide
+// copy of each rather than converting them for every row.
+std::wstring_view ToWide(char const* s)
+{
+    static thread_local std::unordered_map<char const*, std::wstring> wideStrings;
+    auto ii = wideStrings.find(s);
+    if (ii == wideStrings.end()) {
+        ii = wideStrings.emplace(s, std::wstring(s, s + strlen(s))).first;
+    }
+    return ii->second;
+}
+
+uint64_t TimestampToLocalFileTime(PMTraceSession const& pmSession, uint64_t timestamp)
+{
+    SYSTEMTIME st = {};
+    uint64_t ns = 0;
+    pmSession.TimestampToLocalSystemTime(timestamp, &st, &ns);
+
+    uint64_t fileTime = 0;
+    SystemTimeToFileTime(&st, (FILETIME*) &fileTime);
+    return fileTime + (ns % 1000000) / 100;
+}
+
+void GetCaptureColumns(std::vector<CaptureColumn>* columns)
+{
+    auto const& args = GetCommandLineArgs();
+
+    auto add = [&](wchar_t const* name, CaptureColumnType type, uint8_t precision = 0) {
+        columns->push_back({ name, type, precision });
+    };
+    auto addMs = [&](wchar_t const* name) {
+        add(name, CaptureColumnType::Double, 4);
+    };
+    auto addMsFull = [&](wchar_t const* name) {
+        add(name, CaptureColumnType::Double, DBL_DIG - 1);
+    };
+
+    add(L"Application", CaptureColumnType::String);
+    add(L"ProcessID", CaptureColumnType::Int32);
+    add(L"SwapChainAddress", CaptureColumnType::Hex64);
+    add(L"PresentRuntime", CaptureColumnType::String);
+    add(L"SyncInterval", CaptureColumnType::Int32);
+    add(L"PresentFlags", CaptureColumnType::Int32);
+    if (args.mTrackDisplay) {
+        add(L"AllowsTearing", CaptureColumnType::Int32);
+        add(L"PresentMode", CaptureColumnType::String);
+    }
+    if (args.mTrackFrameType) {
+        add(L"FrameType", CaptureColumnType::String);
+    }
+    if (args.mTrackHybridPresent) {
+        add(L"HybridPresent", CaptureColumnType::Int32);
+    }
+    if (args.mUseV2Metrics == false) {
+        switch (args.mTimeUnit) {
+        case TimeUnit::MilliSeconds:    addMs(L"TimeInMs"); break;
+        case TimeUnit::QPC:             add(L"TimeInQPC", CaptureColumnType::UInt64); break;
+        case TimeUnit::DateTime:        add(L"TimeInDateTime", CaptureColumnType::LocalFileTime); break;
+        case TimeUnit::QPCMilliSeconds: addMs(L"TimeInSeconds"); break;
+        default:                        addMsFull(L"TimeInSeconds"); break;
+        }
+
+        addMs(L"MsBetweenSimulationStart");
+        addMsFull(L"MsBetweenPresents");
+        if (args.mTrackDisplay) {
+            addMsFull(L"MsBetweenDisplayChange");
+        }
+        addMsFull(L"MsInPresentAPI");
+        addMsFull(L"MsRenderPresentLatency");
+        if (args.mTrackDisplay) {
+            addMs(L"MsUntilDisplayed");
+            if (args.mTrackPcLatency) {
+                addMs(L"MsPCLatency");
+            }
+        }
+    }
+
+    auto v2 = args.mUseV2Metrics;
+    switch (args.mTimeUnit) {
+    case TimeUnit::MilliSeconds:    addMs(v2 ? L"CPUStartTime" : L"CPUStartTimeInMs"); break;
+    case TimeUnit::QPC:             add(L"CPUStartQPC", CaptureColumnType::UInt64); break;
+    case TimeUnit::QPCMilliSeconds: addMs(v2 ? L"CPUStartQPCTime" : L"CPUStartQPCTimeInMs"); break;
+    case TimeUnit::DateTime:        add(L"CPUStartDateTime", CaptureColumnType::LocalFileTime); break;
+    default:                        addMs(v2 ? L"CPUStartTime" : L"CPUStartTimeInSeconds"); break;
+    }
+    addMs(v2 ? L"FrameTime" : L"MsBetweenAppStart");
+    addMs(v2 ? L"CPUBusy"   : L"MsCPUBusy");
+    addMs(v2 ? L"CPUWait"   : L"MsCPUWait");
+    if (args.mTrackGPU) {
+        addMs(v2 ? L"GPULatency" : L"MsGPULatency");
+        addMs(v2 ? L"GPUTime"    : L"MsGPUTime");
+        addMs(v2 ? L"GPUBusy"    : L"MsGPUBusy");
+        addMs(v2 ? L"GPUWait"    : L"MsGPUWait");
+    }
+    if (args.mTrackGPUVideo) {
+        addMs(v2 ? L"VideoBusy" : L"MsVideoBusy");
+    }
+    if (args.mTrackDisplay) {
+        if (v2) {
+            addMs(L"DisplayLatency");
+            addMs(L"DisplayedTime");
+        }
+        addMs(v2 ? L"AnimationError" : L"MsAnimationError");
+        addMs(L"AnimationTime");
+        addMs(L"MsFlipDelay");
+    }
+    if (args.mTrackInput) {
+        addMs(v2 ? L"AllInputToPhotonLatency" : L"MsAllInputToPhotonLatency");
+        addMs(v2 ? L"ClickToPhotonLatency"    : L"MsClickToPhotonLatency");
+    }
+    if (args.mTrackAppTiming) {
+        addMs(v2 ? L"InstrumentedLatency" : L"MsInstrumentedLatency");
+    }
+    if (args.mWriteDisplayTime) {
+        addMs(L"DisplayTimeAbs");
+    }
+    if (args.mWriteFrameId) {
+        add(L"FrameId", CaptureColumnType::UInt32);
+        if (args.mTrackAppTiming) {
+            add(L"AppFrameId", CaptureColumnType::UInt32);
+        }
+        if (args.mTrackPcLatency) {
+            add(L"PCLFrameId", CaptureColumnType::UInt32);
+        }
+    }
+}
+
+void PushTime(CaptureFileWriter* writer, PMTraceSession const& pmSession, uint64_t timestamp, bool relativeToStart)
+{
+    switch (GetCommandLineArgs().mTimeUnit) {
+    case TimeUnit::QPC:             writer->PushInteger(timestamp); break;
+    case TimeUnit::DateTime:        writer->PushInteger(TimestampToLocalFileTime(pmSession, timestamp)); break;
+    case TimeUnit::QPCMilliSeconds: writer->PushDouble(relativeToStart ? pmSession.TimestampToMilliSeconds(timestamp)
+                                                                       : pmSession.TimestampDeltaToMilliSeconds(timestamp)); break;
+    case TimeUnit::MilliSeconds:    writer->PushDouble(pmSession.TimestampToMilliSeconds(timestamp)); break;
+    default:                        writer->PushDouble(0.001 * pmSession.TimestampToMilliSeconds(timestamp)); break;
+    }
+}
+
+void WriteCaptureRow(
+    CaptureFileWriter* writer,
+    PMTraceSession const& pmSession,
+    ProcessInfo const& processInfo,
+    PresentEvent const& p,
+    FrameMetrics const& metrics)
+{
+    auto const& args = GetCommandLineArgs();
+
+    writer->PushString(processInfo.mModuleName);
+    writer->PushInteger((int32_t) p.ProcessId);
+    writer->PushInteger(p.SwapChainAddress);
+    writer->PushString(ToWide(RuntimeToString(p.Runtime)));
+    writer->PushInteger((int64_t) p.SyncInterval);
+    writer->PushInteger((int32_t) p.PresentFlags);
+    if (args.mTrackDisplay) {
+        writer->PushInteger(p.SupportsTearing);
+        writer->PushString(ToWide(PresentModeToString(p.PresentMode)));
+    }
+    if (args.mTrackFrameType) {
+        writer->PushString(ToWide(FrameTypeToString(metrics.mFrameType)));
+    }
+    if (args.mTrackHybridPresent) {
+        writer->PushInteger(p.IsHybridPresent);
+    }
+
+    if (args.mUseV2Metrics == false) {
+        PushTime(writer, pmSession, metrics.mTimeInSeconds, true);
+        writer->PushDouble(NaIfZero(metrics.mMsBetweenSimStarts));
+        writer->PushDouble(metrics.mMsBetweenPresents);
+        if (args.mTrackDisplay) {
+            writer->PushDouble(NaIfZero(metrics.mMsBetweenDisplayChange));
+        }
+        writer->PushDouble(metrics.mMsInPresentApi);
+        writer->PushDouble(metrics.mMsUntilRenderComplete);
+        if (args.mTrackDisplay) {
+            writer->PushDouble(NaIfZero(metrics.mMsUntilDisplayed));
+            if (args.mTrackPcLatency) {
+                writer->PushDouble(NaIfZero(metrics.mMsPcLatency));
+            }
+        }
+    }
+
+    PushTime(writer, pmSession, metrics.mCPUStart, false);
+    writer->PushDouble(metrics.mMsCPUBusy + metrics.mMsCPUWait);
+    writer->PushDouble(metrics.mMsCPUBusy);
+    writer->PushDouble(metrics.mMsCPUWait);
+    if (args.mTrackGPU) {
+        writer->PushDouble(metrics.mMsGPULatency);
+        writer->PushDouble(metrics.mMsGPUBusy + metrics.mMsGPUWait);
+        writer->PushDouble(metrics.mMsGPUBusy);
+        writer->PushDouble(metrics.mMsGPUWait);
+    }
+    if (args.mTrackGPUVideo) {
+        writer->PushDouble(metrics.mMsVideoBusy);
+    }
+    if (args.mTrackDisplay) {
+        if (args.mUseV2Metrics) {
+            auto displayed = metrics.mMsDisplayedTime != 0.0;
+            writer->PushDouble(displayed ? metrics.mMsDisplayLatency : std::numeric_limits<double>::quiet_NaN());
+            writer->PushDouble(displayed ? metrics.mMsDisplayedTime  : std::numeric_limits<double>::quiet_NaN());
+        }
+        writer->PushDouble(metrics.mMsAnimationError.value_or(std::numeric_limits<double>::quiet_NaN()));
+        writer->PushDouble(metrics.mAnimationTime.value_or(std::numeric_limits<double>::quiet_NaN()));
+        writer->PushDouble(NaIfZero(metrics.mMsFlipDelay));
+    }
+    if (args.mTrackInput) {
+        writer->PushDouble(NaIfZero(metrics.mMsAllInputPhotonLatency));
+        writer->PushDouble(NaIfZero(metrics.mMsClickToPhotonLatency));
+    }
+    if (args.mTrackAppTiming) {
+        writer->PushDouble(NaIfZero(metrics.mMsInstrumentedLatency));
+    }
+    if (args.mWriteDisplayTime) {
+        writer->PushDouble(metrics.mScreenTime == 0 ? std::numeric_limits<double>::quiet_NaN()
+                                                    : pmSession.TimestampToMilliSeconds(metrics.mScreenTime));
+    }
+    if (args.mWriteFrameId) {
+        writer->PushInteger(p.FrameId);
+        if (args.mTrackAppTiming) {
+            writer->PushInteger(p.AppFrameId);
+        }
+        if (args.mTrackPcLatency) {
+            writer->PushInteger(p.PclFrameId);
+        }
+    }
+    writer->EndRow();
+}
+
+void PrintCaptureWriteError()
+{
+    PrintError(L"error: failed to write to the binary output file; it ends at the last block written.\n");
+}
+
+void CloseCapture(CaptureFileWriter** writer)
+{
+    if (*writer != nullptr) {
+        // A failure while writing rows has already been reported.
+        auto alreadyFailed = (*writer)->HasWriteFailed();
+        if (!(*writer)->Close() && !alreadyFailed) {
+            PrintCaptureWriteError();
+        }
+        delete *writer;
+        *writer = nullptr;
+    }
+}
+
+}
+
+void UpdateCapture(
+    PMTraceSession const& pmSession,
+    ProcessInfo* processInfo,
+    PresentEvent const& p,
+    FrameMetrics const& metrics)
+{
+    auto const& args = GetCommandLineArgs();
+
+    // Don't output dropped frames (if requested).
+    if (args.mExcludeDropped && p.FinalState != PresentResult::Presented) {
+        return;
+    }
+
+    // Get/create file
+    auto writer = args.mMultiCsv
+        ? &processInfo->mOutputCapture
+        : &gGlobalOutputCapture;
+
+    if (*writer == nullptr) {
+        wchar_t path[MAX_PATH];
+        GenerateFilename(path, processInfo->mModuleName, p.ProcessId);
+
+        std::vector<CaptureColumn> columns;
+        GetCaptureColumns(&columns);
+
+        *writer = new CaptureFileWriter;
+        if (!(*writer)->Open(path, columns, pmSession.mTimestampFrequency.QuadPart, pmSession.mStartTimestamp.QuadPart,
+                             pmSession.mStartFileTime)) {
+            delete *writer;
+            *writer = nullptr;
+            return;
+        }
+    }
+
+    // Once a write fails the file is left as it is, rather than being reopened and overwritten.
+    if ((*writer)->HasWriteFailed()) {
+        return;
+    }
+    WriteCaptureRow(*writer, pmSession, *processInfo, p, metrics);
+    if ((*writer)->HasWriteFailed()) {
+        PrintCaptureWriteError();
+    }
+}
+
+void CloseMultiCapture(ProcessInfo* processInfo)
+{
+    CloseCapture(&processInfo->mOutputCapture);
+}
+
+void CloseGlobalCapture()
+{
+    CloseCapture(&gGlobalOutputCapture);
+}
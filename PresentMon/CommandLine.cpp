@@ -134,6 +134,11 @@ KeyNameCode const HOTKEY_KEYS[] = {
 
 CommandLineArgs gCommandLineArgs;
 
+// Batch analysis workers each run the output processing with their own copy of the arguments
+// (e.g., a different --etl_file and --output_file), which GetCommandLineArgs() returns on that
+// thread.
+thread_local CommandLineArgs const* gThreadCommandLineArgs = nullptr;
+
 size_t GetConsoleWidth()
 {
     CONSOLE_SCREEN_BUFFER_INFO info = {};
@@ -262,6 +267,8 @@ void PrintUsage()
         LR"(--exclude name)",      LR"(Do not record processes with the specified exe name. This argument can be repeated to exclude multiple processes.)",
         LR"(--process_id id)",     LR"(Only record the process with the specified process ID.)",
         LR"(--etl_file path)",     LR"(Analyze an ETW trace log file instead of the actively running processes.)",
+        LR"(--etl_batch path)",    LR"(Analyze every ETW trace log file in the specified directory, or listed one per line in the specified text file, in parallel. A CSV is written for each ETL along with a summary CSV for the batch.)",
+        LR"(--replay_decoded_events path)", LR"(Analyze a file written by --record_decoded_events instead of the actively running processes. No ETW trace session is used.)",
 
         LR"(--Output Options)", nullptr,
         LR"(--output_file path)", LR"(Write CSV output to the specified path.)",
@@ -275,6 +282,9 @@ void PrintUsage()
         LR"(--exclude_dropped)",  LR"(Exclude frames that were not displayed to the screen from the CSV output.)",
         LR"(--v1_metrics)",       LR"(Output a CSV using PresentMon 1.x metrics.)",
         LR"(--v2_metrics)",       LR"(Output a CSV using PresentMon 2.x metrics.)",
+        LR"(--binary_output)",    LR"(Write the output in a binary capture format instead of CSV, which is faster to write and smaller. Use Tools/pm_convert_csv to convert a capture into CSV.)",
+        LR"(--record_decoded_events path)", LR"(Write the decoded present-tracking events to the specified path, so that the analysis can be replayed without ETW.)",
+        LR"(--batch_output_dir path)",      LR"(When using --etl_batch, write the per-ETL and summary CSVs to the specified directory instead of the current directory.)",
 
         LR"(--Recording Options)", nullptr,
         LR"(--hotkey key)",       LR"(Use the specified key press to start and stop recording. 'key' is of the form MODIFIER+KEY, e.g., "ALT+SHIFT+F11".)",
@@ -293,6 +303,8 @@ void PrintUsage()
         LR"(--restart_as_admin)",           LR"(If not running with elevated privilege, restart and request to be run as administrator.)",
         LR"(--terminate_on_proc_exit)",     LR"(Terminate PresentMon when all the target processes have exited.)",
         LR"(--terminate_after_timed)",      LR"(When using --timed, terminate PresentMon after the timed capture completes.)",
+        LR"(--etl_shards count)",          LR"(When using --etl_file, split the ETL into the specified number of time ranges and analyze them in parallel. Each shard hands off to the next where both track the same presents, which matches analyzing the whole ETL at once unless a present stays in flight across a whole shard overlap.)",
+        LR"(--batch_workers count)",        LR"(When using --etl_batch, analyze at most the specified number of ETL files at the same time. The default is the number of logical processors.)",
 
         LR"(--Beta Options)", nullptr,
         LR"(--track_frame_type)",      LR"(Track the type of each displayed frame; requires application and/or driver instrumentation using Intel-PresentMon provider.)",
@@ -369,7 +381,12 @@ void PrintHotkeyError()
 
 CommandLineArgs const& GetCommandLineArgs()
 {
-    return gCommandLineArgs;
+    return gThreadCommandLineArgs != nullptr ? *gThreadCommandLineArgs : gCommandLineArgs;
+}
+
+void SetThreadCommandLineArgs(CommandLineArgs const* args)
+{
+    gThreadCommandLineArgs = args;
 }
 
 bool ParseCommandLine(int argc, wchar_t** argv)
@@ -380,6 +397,10 @@ bool ParseCommandLine(int argc, wchar_t** argv)
     args->mExcludeProcessNames.clear();
     args->mOutputCsvFileName = nullptr;
     args->mEtlFileName = nullptr;
+    args->mDecodedEventsFileName = nullptr;
+    args->mReplayDecodedEventsFileName = nullptr;
+    args->mEtlBatchPath = nullptr;
+    args->mBatchOutputDir = nullptr;
     args->mSessionName = L"PresentMon";
     args->mTargetPid = 0;
     args->mDelay = 0;
@@ -387,6 +408,8 @@ bool ParseCommandLine(int argc, wchar_t** argv)
     args->mHotkeyModifiers = MOD_NOREPEAT;
     args->mHotkeyVirtualKeyCode = 0;
     args->mPresentEventCircularBufferSize = 0;
+    args->mBatchWorkerCount = 0;
+    args->mEtlShardCount = 0;
     args->mConsoleOutput = ConsoleOutput::Statistics;
     args->mTrackDisplay = true;
     args->mTrackInput = true;
@@ -411,6 +434,7 @@ bool ParseCommandLine(int argc, wchar_t** argv)
     args->mWriteFrameId = false;
     args->mWriteDisplayTime = false;
     args->mDisableOfflineBackpressure = false;
+    args->mBinaryOutput = false;
 
     bool sessionNameSet  = false;
     bool csvOutputStdout = false;
@@ -432,6 +456,8 @@ bool ParseCommandLine(int argc, wchar_t** argv)
         else if (ParseArg(argv[i], L"exclude"))      { if (ParseValue(argv, argc, &i, &args->mExcludeProcessNames)) continue; }
         else if (ParseArg(argv[i], L"process_id"))   { if (ParseValue(argv, argc, &i, &args->mTargetPid))           continue; }
         else if (ParseArg(argv[i], L"etl_file"))     { if (ParseValue(argv, argc, &i, &args->mEtlFileName))         continue; }
+        else if (ParseArg(argv[i], L"etl_batch"))    { if (ParseValue(argv, argc, &i, &args->mEtlBatchPath))        continue; }
+        else if (ParseArg(argv[i], L"replay_decoded_events")) { if (ParseValue(argv, argc, &i, &args->mReplayDecodedEventsFileName)) continue; }
 
         // Output options:
         else if (ParseArg(argv[i], L"output_file"))      { if (ParseValue(argv, argc, &i, &args->mOutputCsvFileName)) continue; }
@@ -445,6 +471,9 @@ bool ParseCommandLine(int argc, wchar_t** argv)
         else if (ParseArg(argv[i], L"exclude_dropped"))  { args->mExcludeDropped = true;                              continue; }
         else if (ParseArg(argv[i], L"v1_metrics"))       { args->mUseV1Metrics   = true;                              continue; }
         else if (ParseArg(argv[i], L"v2_metrics"))       { args->mUseV2Metrics   = true;                              continue; }
+        else if (ParseArg(argv[i], L"binary_output"))    { args->mBinaryOutput   = true;                              continue; }
+        else if (ParseArg(argv[i], L"record_decoded_events")) { if (ParseValue(argv, argc, &i, &args->mDecodedEventsFileName)) continue; }
+        else if (ParseArg(argv[i], L"batch_output_dir"))      { if (ParseValue(argv, argc, &i, &args->mBatchOutputDir))        continue; }
 
         // Recording options:
         else if (ParseArg(argv[i], L"hotkey"))           { if (ParseValue(argv, argc, &i) && AssignHotkey(argv[i], args)) continue; }
@@ -464,6 +493,8 @@ bool ParseCommandLine(int argc, wchar_t** argv)
         else if (ParseArg(argv[i], L"terminate_on_proc_exit"))     { args->mTerminateOnProcExit      = true; continue; }
         else if (ParseArg(argv[i], L"terminate_after_timed"))      { args->mTerminateAfterTimer      = true; continue; }
         else if (ParseArg(argv[i], L"set_circular_buffer_size"))   { if (ParseValue(argv, argc, &i, &args->mPresentEventCircularBufferSize)) { continue; } }
+        else if (ParseArg(argv[i], L"batch_workers"))              { if (ParseValue(argv, argc, &i, &args->mBatchWorkerCount)) continue; }
+        else if (ParseArg(argv[i], L"etl_shards"))                 { if (ParseValue(argv, argc, &i, &args->mEtlShardCount))    continue; }
 
         // Beta options:
         else if (ParseArg(argv[i], L"track_frame_type"))      { args->mTrackFrameType      = true; continue; }
@@ -520,6 +551,72 @@ bool ParseCommandLine(int argc, wchar_t** argv)
         }
     }
 
+    // --etl_batch analyzes each ETL separately, so it can't be combined with a single --etl_file,
+    // and each ETL gets its own CSV so --output_file and --output_stdout don't apply.  Options
+    // that only make sense for an interactive capture are ignored.
+    if (args->mEtlBatchPath != nullptr) {
+        if (args->mEtlFileName != nullptr) {
+            PrintError(L"error: --etl_file and --etl_batch cannot be used together.\n");
+            return false;
+        }
+
+        if (args->mOutputCsvFileName != nullptr || csvOutputStdout || args->mDecodedEventsFileName != nullptr ||
+            args->mHotkeySupport || args->mDelay != 0 || args->mStartTimer || args->mTerminateOnProcExit) {
+            PrintWarning(L"warning: ignoring options that do not apply to --etl_batch:");
+            if (args->mOutputCsvFileName != nullptr)     { args->mOutputCsvFileName     = nullptr; PrintWarning(L" --output_file"); }
+            if (csvOutputStdout)                         { csvOutputStdout              = false;   PrintWarning(L" --output_stdout"); }
+            if (args->mDecodedEventsFileName != nullptr) { args->mDecodedEventsFileName = nullptr; PrintWarning(L" --record_decoded_events"); }
+            if (args->mHotkeySupport)                    { args->mHotkeySupport         = false;   PrintWarning(L" --hotkey"); }
+            if (args->mDelay != 0)                       { args->mDelay                 = 0;       PrintWarning(L" --delay"); }
+            if (args->mStartTimer)                       { args->mStartTimer            = false;   PrintWarning(L" --timed"); }
+            if (args->mTerminateOnProcExit)              { args->mTerminateOnProcExit   = false;   PrintWarning(L" --terminate_on_proc_exit"); }
+            PrintWarning(L"\n");
+        }
+
+        args->mConsoleOutput = ConsoleOutput::Simple;
+    } else if (args->mBatchOutputDir != nullptr || args->mBatchWorkerCount != 0) {
+        PrintWarning(L"warning: ignoring --batch_output_dir and --batch_workers since --etl_batch was not used.\n");
+    }
+
+    // --replay_decoded_events analyzes a previously recorded analysis, so it can't be combined
+    // with another capture target.  Options that only make sense for an interactive capture are
+    // ignored.
+    if (args->mReplayDecodedEventsFileName != nullptr) {
+        if (args->mEtlFileName != nullptr || args->mEtlBatchPath != nullptr) {
+            PrintError(L"error: --replay_decoded_events cannot be used with --etl_file or --etl_batch.\n");
+            return false;
+        }
+
+        if (args->mDecodedEventsFileName != nullptr || args->mHotkeySupport || args->mDelay != 0 || args->mStartTimer ||
+            args->mTerminateOnProcExit) {
+            PrintWarning(L"warning: ignoring options that do not apply to --replay_decoded_events:");
+            if (args->mDecodedEventsFileName != nullptr) { args->mDecodedEventsFileName = nullptr; PrintWarning(L" --record_decoded_events"); }
+            if (args->mHotkeySupport)                    { args->mHotkeySupport         = false;   PrintWarning(L" --hotkey"); }
+            if (args->mDelay != 0)                       { args->mDelay                 = 0;       PrintWarning(L" --delay"); }
+            if (args->mStartTimer)                       { args->mStartTimer            = false;   PrintWarning(L" --timed"); }
+            if (args->mTerminateOnProcExit)              { args->mTerminateOnProcExit   = false;   PrintWarning(L" --terminate_on_proc_exit"); }
+            PrintWarning(L"\n");
+        }
+
+        args->mConsoleOutput = ConsoleOutput::Simple;
+    }
+
+    // --etl_shards only applies to a single --etl_file, and each shard has its
+    // own consumer so the consumer's decoded events can't be recorded.  Shards
+    // rely on offline backpressure to wait for their turn to be output.
+    if (args->mEtlShardCount > 1) {
+        if (args->mEtlFileName == nullptr) {
+            PrintWarning(L"warning: ignoring --etl_shards since --etl_file was not used.\n");
+            args->mEtlShardCount = 0;
+        } else if (args->mDecodedEventsFileName != nullptr) {
+            PrintWarning(L"warning: ignoring --etl_shards due to --record_decoded_events.\n");
+            args->mEtlShardCount = 0;
+        } else if (args->mDisableOfflineBackpressure) {
+            PrintWarning(L"warning: ignoring --disable_offline_backpressure due to --etl_shards.\n");
+            args->mDisableOfflineBackpressure = false;
+        }
+    }
+
     // Ensure only one of --output_file --output_stdout --no_csv.
     if (csvOutputNone + csvOutputStdout + (args->mOutputCsvFileName != nullptr) > 1) {
         PrintWarning(L"warning: only one of the following options may be used:");
@@ -534,19 +631,21 @@ bool ParseCommandLine(int argc, wchar_t** argv)
     }
 
     // Ignore CSV-only options when --no_csv is used
-    if (csvOutputNone && (qpcTime || qpcmsTime || dtTime || args->mMultiCsv || args->mHotkeySupport)) {
+    if (csvOutputNone && (qpcTime || qpcmsTime || dtTime || args->mMultiCsv || args->mHotkeySupport || args->mBinaryOutput)) {
         PrintWarning(L"warning: ignoring CSV-related options due to --no_csv:");
         if (qpcTime)              { qpcTime              = false; PrintWarning(L" --qpc_time"); }
         if (qpcmsTime)            { qpcmsTime            = false; PrintWarning(L" --qpc_time_ms"); }
         if (dtTime)               { dtTime               = false; PrintWarning(L" --date_time"); }
         if (args->mMultiCsv)      { args->mMultiCsv      = false; PrintWarning(L" --multi_csv"); }
         if (args->mHotkeySupport) { args->mHotkeySupport = false; PrintWarning(L" --hotkey"); }
+        if (args->mBinaryOutput)  { args->mBinaryOutput  = false; PrintWarning(L" --binary_output"); }
         PrintWarning(L"\n");
     }
 
     // If we're outputting CSV to stdout, we can't use it for console output.
     //
-    // Also ignore --multi_csv since it only applies to file output.
+    // Also ignore --multi_csv and --binary_output since they only apply to
+    // file output.
     if (csvOutputStdout) {
         args->mConsoleOutput = ConsoleOutput::None;
 
@@ -554,6 +653,10 @@ bool ParseCommandLine(int argc, wchar_t** argv)
             PrintWarning(L"warning: ignoring --multi_csv due to --output_stdout.\n");
             args->mMultiCsv = false;
         }
+        if (args->mBinaryOutput) {
+            PrintWarning(L"warning: ignoring --binary_output due to --output_stdout.\n");
+            args->mBinaryOutput = false;
+        }
     }
 
     // Ignore --track_gpu_video if --no_track_gpu used
@@ -588,6 +691,13 @@ bool ParseCommandLine(int argc, wchar_t** argv)
         PrintWarning(L"warning: ignoring --v1_metrics due to --v2_metrics.\n");
         args->mUseV1Metrics = false;
     }
+
+    // The binary capture format does not support the 1.x metrics.
+    if (args->mBinaryOutput && args->mUseV1Metrics) {
+        PrintWarning(L"warning: ignoring --binary_output due to --v1_metrics.\n");
+        args->mBinaryOutput = false;
+    }
+
     // Enable verbose trace if requested, and disable Full or Simple console output
     #if PRESENTMON_ENABLE_DEBUG_TRACE
     if (verboseTrace) {
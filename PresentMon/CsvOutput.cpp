@@ -4,8 +4,9 @@
 
 #include "PresentMon.hpp"
 
-static FILE* gGlobalOutputCsv = nullptr;
-static uint32_t gRecordingCount = 1;
+// Thread-local so that each --etl_batch worker writes its own CSV.
+static thread_local FILE* gGlobalOutputCsv = nullptr;
+static thread_local uint32_t gRecordingCount = 1;
 
 void IncrementRecordingCount()
 {
@@ -83,7 +84,7 @@ with `-INDEX` appended to the file name.
 If `-include_mixed_reality` is used, a second CSV file will be generated with
 `_WMR` appended to the filename containing the WMR data.
 */
-static void GenerateFilename(wchar_t* path, std::wstring const& processName, uint32_t processId)
+void GenerateFilename(wchar_t* path, std::wstring const& processName, uint32_t processId)
 {
     auto const& args = GetCommandLineArgs();
 
@@ -109,7 +110,7 @@ static void GenerateFilename(wchar_t* path, std::wstring const& processName, uin
         time_t time_now = time(NULL);
         localtime_s(&tm, &time_now);
         ADD_TO_PATH(L"PresentMon-%4d-%02d-%02dT%02d%02d%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
-        wcscpy_s(ext, L".csv");
+        wcscpy_s(ext, args.mBinaryOutput ? L".pmcap" : L".csv");
     }
 
     // Append -PROCESSNAME if applicable.
@@ -663,6 +664,11 @@ void UpdateCsv(PMTraceSession const& pmSession, ProcessInfo* processInfo, Presen
 
 void UpdateCsv(PMTraceSession const& pmSession, ProcessInfo* processInfo, PresentEvent const& p, FrameMetrics const& metrics)
 {
+    if (GetCommandLineArgs().mBinaryOutput) {
+        UpdateCapture(pmSession, processInfo, p, metrics);
+        return;
+    }
+
     UpdateCsvT(pmSession, processInfo, p, metrics);
 }
 
@@ -679,10 +685,12 @@ static void CloseCsv(FILE** fp)
 void CloseMultiCsv(ProcessInfo* processInfo)
 {
     CloseCsv(&processInfo->mOutputCsv);
+    CloseMultiCapture(processInfo);
 }
 
 void CloseGlobalCsv()
 {
     CloseCsv(&gGlobalOutputCsv);
+    CloseGlobalCapture();
 }
 
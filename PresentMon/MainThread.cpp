@@ -191,6 +191,24 @@ void ExitMainThread()
     PostMessage(gWnd, WM_QUIT, 0, 0);
 }
 
+void ConfigureConsumer(CommandLineArgs const& args, PMTraceConsumer* pmConsumer)
+{
+    pmConsumer->mTrackDisplay               = args.mTrackDisplay;
+    pmConsumer->mTrackGPU                   = args.mTrackGPU;
+    pmConsumer->mTrackGPUVideo              = args.mTrackGPUVideo;
+    pmConsumer->mTrackInput                 = args.mTrackInput;
+    pmConsumer->mTrackFrameType             = args.mTrackFrameType;
+    pmConsumer->mTrackPMMeasurements        = args.mTrackPMMeasurements;
+    pmConsumer->mTrackAppTiming             = args.mTrackAppTiming;
+    pmConsumer->mTrackHybridPresent         = args.mTrackHybridPresent;
+    pmConsumer->mDisableOfflineBackpressure = args.mDisableOfflineBackpressure;
+    pmConsumer->mTrackPcLatency             = args.mTrackPcLatency;
+    if (args.mTargetPid != 0) {
+        pmConsumer->mFilteredProcessIds = true;
+        pmConsumer->AddTrackedProcessForFiltering(args.mTargetPid);
+    }
+}
+
 int wmain(int argc, wchar_t** argv)
 {
     // Load system DLLs
@@ -226,6 +244,21 @@ int wmain(int argc, wchar_t** argv)
         return 7;
     }
 
+    // --etl_batch analyzes the ETLs on a pool of workers and doesn't need the trace session,
+    // elevation, or recording control below.
+    if (args.mEtlBatchPath != nullptr) {
+        auto result = RunBatchAnalysis();
+        FinalizeConsole();
+        return result;
+    }
+
+    // --replay_decoded_events doesn't use ETW at all.
+    if (args.mReplayDecodedEventsFileName != nullptr) {
+        auto result = RunDecodedEventReplay();
+        FinalizeConsole();
+        return result;
+    }
+
     // Attempt to elevate process privilege if necessary.
     //
     // If we are processing an ETL file we don't need elevated privilege, but
@@ -283,20 +316,7 @@ int wmain(int argc, wchar_t** argv)
         ? args.mPresentEventCircularBufferSize
         : PMTraceConsumer::PRESENTEVENT_CIRCULAR_BUFFER_SIZE);
 
-    pmConsumer.mTrackDisplay               = args.mTrackDisplay;
-    pmConsumer.mTrackGPU                   = args.mTrackGPU;
-    pmConsumer.mTrackGPUVideo              = args.mTrackGPUVideo;
-    pmConsumer.mTrackInput                 = args.mTrackInput;
-    pmConsumer.mTrackFrameType             = args.mTrackFrameType;
-    pmConsumer.mTrackPMMeasurements        = args.mTrackPMMeasurements;
-    pmConsumer.mTrackAppTiming             = args.mTrackAppTiming;
-    pmConsumer.mTrackHybridPresent         = args.mTrackHybridPresent;
-    pmConsumer.mDisableOfflineBackpressure = args.mDisableOfflineBackpressure;
-    pmConsumer.mTrackPcLatency             = args.mTrackPcLatency;
-    if (args.mTargetPid != 0) {
-        pmConsumer.mFilteredProcessIds = true;
-        pmConsumer.AddTrackedProcessForFiltering(args.mTargetPid);
-    }
+    ConfigureConsumer(args, &pmConsumer);
 
     // Start the ETW trace session.
     PMTraceSession pmSession;
@@ -360,8 +380,24 @@ int wmain(int argc, wchar_t** argv)
         pmConsumer.mDeferralTimeLimit = pmSession.mTimestampFrequency.QuadPart * 2;
     }
 
-    // Start the consumer and output threads
-    StartConsumerThread(pmSession.mTraceHandle);
+    // If requested, record the decoded events applied by the consumer.
+    DecodedEventWriter decodedEventRecorder;
+    if (args.mDecodedEventsFileName != nullptr) {
+        if (decodedEventRecorder.Open(args.mDecodedEventsFileName, pmSession.mTimestampFrequency.QuadPart,
+                                      pmSession.mStartTimestamp.QuadPart, pmSession.mStartFileTime)) {
+            pmConsumer.mDecodedEventRecorder = &decodedEventRecorder;
+        } else {
+            PrintWarning(L"warning: failed to open --record_decoded_events file.\n");
+        }
+    }
+
+    // Start the consumer and output threads.  With --etl_shards, pmSession
+    // analyzes the first shard and the others get their own sessions.
+    if (args.mEtlShardCount > 1) {
+        StartShardedAnalysis(&pmSession);
+    } else {
+        StartConsumerThread(pmSession.mTraceHandle);
+    }
     StartOutputThread(pmSession);
 
     // If the user wants to use the scroll lock key as an indicator of when
@@ -403,8 +439,18 @@ int wmain(int argc, wchar_t** argv)
 
     // Wait for the consumer and output threads to end (which are using the
     // consumers).
-    WaitForConsumerThreadToExit();
-    StopOutputThread();
+    uint32_t numOverflowedPresents = 0;
+    if (args.mEtlShardCount > 1) {
+        StopShardedAnalysis();
+        WaitForShardedAnalysisToExit();
+        StopOutputThread();
+        numOverflowedPresents = FinalizeShardedAnalysis();
+    } else {
+        WaitForConsumerThreadToExit();
+        StopOutputThread();
+    }
+    numOverflowedPresents += pmConsumer.mNumOverflowedPresents;
+    decodedEventRecorder.Close();
 
     // Output warning if events were lost.
     if (pmSession.mNumBuffersLost > 0) {
@@ -413,9 +459,9 @@ int wmain(int argc, wchar_t** argv)
     if (pmSession.mNumEventsLost > 0) {
         PrintWarning(L"warning: %lu ETW events were lost.\n", pmSession.mNumEventsLost);
     }
-    if (pmConsumer.mNumOverflowedPresents > 0) {
+    if (numOverflowedPresents > 0) {
         PrintWarning(L"warning: %lu overflowed present events detected. This could be due to a high-fps application.\n",
-                     pmConsumer.mNumOverflowedPresents);
+                     numOverflowedPresents);
         PrintWarning(L"         Consider increasing the present event circular buffer size to a value larger\n");
         PrintWarning(L"         than the default of 2048, e.g., --set_circular_buffer_size 4096.\n");
 
@@ -10,7 +10,7 @@
 #include <thread>
 
 static std::thread gThread;
-static bool gQuit = false;
+static std::atomic<bool> gQuit = false;
 
 #include <iostream>
 #include <set>
@@ -82,9 +82,12 @@ static bool CopyRecordingToggleHistory(std::vector<uint64_t>* recordingToggleHis
 // whenever we notice an event with a new process id.  If it's a target
 // process, we obtain a handle to the process, and periodically check it to see
 // if it has exited.
+//
+// The process state is thread-local so that each --etl_batch worker tracks the
+// processes of its own ETL.
 
-static std::unordered_map<uint32_t, ProcessInfo> gProcesses;
-static uint32_t gTargetProcessCount = 0;
+static thread_local std::unordered_map<uint32_t, ProcessInfo> gProcesses;
+static thread_local uint32_t gTargetProcessCount = 0;
 
 // Removes any directory and extension, and converts the remaining name to
 // lower case.
@@ -170,6 +173,7 @@ static void ProcessProcessEvent(
         info->mHandle          = NULL;
         info->mModuleName      = processEvent.ImageFileName;
         info->mOutputCsv       = nullptr;
+        info->mOutputCapture   = nullptr;
         info->mIsTargetProcess = IsTargetProcess(processEvent.ProcessId, processEvent.ImageFileName);
 
         if (info->mIsTargetProcess) {
@@ -185,12 +189,9 @@ static void ProcessProcessEvent(
 }
 
 static void UpdateProcessEvents(
-    PMTraceConsumer* pmConsumer,
+    std::vector<ProcessEvent>& newProcessEvents,
     std::vector<ProcessEvent>* processEvents)
 {
-    std::vector<ProcessEvent> newProcessEvents;
-    pmConsumer->DequeueProcessEvents(newProcessEvents);
-
     if (!newProcessEvents.empty()) {
         processEvents->insert(processEvents->end(), newProcessEvents.begin(), newProcessEvents.end());
         newProcessEvents.clear();
@@ -898,6 +899,7 @@ static bool GetPresentProcessInfo(
         ProcessInfo info;
         QueryProcessName(presentEvent->ProcessId, &info);
         info.mOutputCsv       = nullptr;
+        info.mOutputCapture   = nullptr;
         info.mIsTargetProcess = IsTargetProcess(presentEvent->ProcessId, info.mModuleName);
         if (info.mIsTargetProcess) {
             gTargetProcessCount += 1;
@@ -1049,10 +1051,15 @@ static void ProcessEvents(
     }
 }
 
-void Output(PMTraceSession const* pmSession)
+// Dequeue and process the consumer's events until quit is set, then close all
+// CSVs.  If alwaysRecording is set the MainThread recording state is not used
+// (e.g., for --etl_batch workers).  Returns the number of presents dequeued.
+static uint64_t ProcessOutput(
+    PMTraceSession const& pmSession,
+    std::atomic<bool> const& quitFlag,
+    bool alwaysRecording,
+    DWORD pollIntervalMs)
 {
-    SetThreadDescription(GetCurrentThread(), L"PresentMon Output Thread");
-
     auto const& args = GetCommandLineArgs();
 
     // Structures to track processes and statistics from recorded events.
@@ -1061,24 +1068,34 @@ void Output(PMTraceSession const* pmSession)
     std::vector<std::shared_ptr<PresentEvent>> presentEvents;
     processEvents.reserve(128);
     presentEvents.reserve(1024);
+    uint64_t presentCount = 0;
 
     for (;;) {
-        // Read gQuit here, but then check it after processing queued events.
-        // This ensures that we call Dequeue*() at least once after
+        // Read the quit flag here, but then check it after processing queued
+        // events.  This ensures that we call Dequeue*() at least once after
         // events have stopped being collected so that all events are included.
-        auto quit = gQuit;
+        auto quit = quitFlag.load();
 
         // Copy recording toggle history from MainThread
-        bool currentRecordingState = CopyRecordingToggleHistory(&recordingToggleHistory);
-
-        // Copy process events, present events, and lost present events from ConsumerThread.
-        UpdateProcessEvents(pmSession->mPMConsumer, &processEvents);
-        pmSession->mPMConsumer->DequeuePresentEvents(presentEvents);
+        bool currentRecordingState = alwaysRecording || CopyRecordingToggleHistory(&recordingToggleHistory);
+
+        // Copy process events, present events, and lost present events from ConsumerThread
+        // (or the ETL shards, merged in order).  Process events are dequeued first so that
+        // they are available for any dequeued present that follows them.
+        std::vector<ProcessEvent> newProcessEvents;
+        if (args.mEtlShardCount > 1) {
+            DequeueShardedEvents(&newProcessEvents, &presentEvents);
+        } else {
+            pmSession.mPMConsumer->DequeueProcessEvents(newProcessEvents);
+            pmSession.mPMConsumer->DequeuePresentEvents(presentEvents);
+        }
+        UpdateProcessEvents(newProcessEvents, &processEvents);
 
         // Process all the collected events, and update the various tracking
         // and statistics data structures.
         if (!presentEvents.empty()) {
-            ProcessEvents(*pmSession, presentEvents, &processEvents, &recordingToggleHistory, currentRecordingState);
+            presentCount += presentEvents.size();
+            ProcessEvents(pmSession, presentEvents, &processEvents, &recordingToggleHistory, currentRecordingState);
             presentEvents.clear();
         }
 
@@ -1118,7 +1135,7 @@ void Output(PMTraceSession const* pmSession)
         }
 
         // Sleep to reduce overhead.
-        Sleep(100);
+        Sleep(pollIntervalMs);
     }
 
     // Close all CSV and process handles
@@ -1132,11 +1149,31 @@ void Output(PMTraceSession const* pmSession)
     CloseGlobalCsv();
 
     gProcesses.clear();
+    gTargetProcessCount = 0;
+
+    return presentCount;
+}
+
+static void Output(PMTraceSession const* pmSession)
+{
+    SetThreadDescription(GetCurrentThread(), L"PresentMon Output Thread");
+
+    // When analyzing ETL shards, poll more often so that the shards aren't
+    // held up by backpressure while waiting for their output to be merged.
+    auto const& args = GetCommandLineArgs();
+    ProcessOutput(*pmSession, gQuit, false, args.mEtlShardCount > 1 ? 1 : 100);
 
     gRecordingToggleHistory.clear();
     gRecordingToggleHistory.shrink_to_fit();
 }
 
+uint64_t RunBatchOutput(PMTraceSession const& pmSession, std::atomic<bool> const& traceDone)
+{
+    // The ETL is read as fast as possible, so poll more often than the
+    // realtime output to keep the consumer from blocking on backpressure.
+    return ProcessOutput(pmSession, traceDone, true, 1);
+}
+
 void StartOutputThread(PMTraceSession const& pmSession)
 {
     InitializeCriticalSection(&gRecordingToggleCS);
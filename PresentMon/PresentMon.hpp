@@ -25,11 +25,26 @@ PresentMon Architecture:
 The trace session and ETW analysis is always running, but whether or not
 collected data is written to the CSV file(s) is controlled by a recording state
 which is controlled from MainThread based on user input or timer.
+
+When --etl_batch is used, MainThread instead hands a list of ETL files to a
+pool of batch workers (BatchAnalysis.cpp).  Each worker analyzes one ETL at a
+time with its own PMTraceConsumer, running ProcessTrace() on a helper thread
+and the output processing on the worker thread itself.  The output state
+(tracked processes, open CSVs, and the effective command line arguments) is
+thread-local so workers do not share it.
+
+When --etl_shards is used, the --etl_file is split into time shards that are
+analyzed in parallel, each by its own PMTraceConsumer (ShardedAnalysis.cpp).
+Each shard also analyzes an overlap before and after the time range it owns,
+and OutputThread merges the shards in the order presents complete, handing off
+from one shard to the next where both complete the same present, so the output
+matches a serial analysis.
 */
 
 #include "../PresentData/PresentMonTraceConsumer.hpp"
 #include "../PresentData/PresentMonTraceSession.hpp"
 
+#include <atomic>
 #include <unordered_map>
 #include <queue>
 #include <optional>
@@ -68,6 +83,10 @@ struct CommandLineArgs {
     std::vector<std::wstring> mExcludeProcessNames;
     const wchar_t *mOutputCsvFileName;
     const wchar_t *mEtlFileName;
+    const wchar_t *mDecodedEventsFileName;
+    const wchar_t *mReplayDecodedEventsFileName;
+    const wchar_t *mEtlBatchPath;
+    const wchar_t *mBatchOutputDir;
     const wchar_t *mSessionName;
     UINT mTargetPid;
     UINT mDelay;
@@ -75,6 +94,8 @@ struct CommandLineArgs {
     UINT mHotkeyModifiers;
     UINT mHotkeyVirtualKeyCode;
     UINT mPresentEventCircularBufferSize;
+    UINT mBatchWorkerCount;
+    UINT mEtlShardCount;
     TimeUnit mTimeUnit;
     CSVOutput mCSVOutput;
     ConsoleOutput mConsoleOutput;
@@ -102,6 +123,7 @@ struct CommandLineArgs {
     bool mWriteFrameId;
     bool mWriteDisplayTime;
     bool mDisableOfflineBackpressure;
+    bool mBinaryOutput;
 };
 
 // Metrics computed per-frame.  Duration and Latency metrics are in milliseconds.
@@ -229,17 +251,27 @@ struct SwapChainData {
     uint64_t mLastDisplayedFlipDelay = 0;
 };
 
+class CaptureFileWriter;
+
 struct ProcessInfo {
     std::wstring mModuleName;
     std::unordered_map<uint64_t, SwapChainData> mSwapChain;
     HANDLE mHandle;
     FILE* mOutputCsv;
+    CaptureFileWriter* mOutputCapture;
     bool mIsTargetProcess;
 };
 
+// BatchAnalysis.cpp:
+int RunBatchAnalysis();
+
+// ReplayAnalysis.cpp:
+int RunDecodedEventReplay();
+
 // CommandLine.cpp:
 bool ParseCommandLine(int argc, wchar_t** argv);
 CommandLineArgs const& GetCommandLineArgs();
+void SetThreadCommandLineArgs(CommandLineArgs const* args);
 void PrintHotkeyError();
 
 // Console.cpp:
@@ -254,6 +286,11 @@ void UpdateConsole(uint32_t processId, ProcessInfo const& processInfo);
 int PrintWarning(wchar_t const* format, ...);
 int PrintError(wchar_t const* format, ...);
 
+// CaptureOutput.cpp:
+void UpdateCapture(PMTraceSession const& pmSession, ProcessInfo* processInfo, PresentEvent const& p, FrameMetrics const& metrics);
+void CloseMultiCapture(ProcessInfo* processInfo);
+void CloseGlobalCapture();
+
 // ConsumerThread.cpp:
 void StartConsumerThread(TRACEHANDLE traceHandle);
 void WaitForConsumerThreadToExit();
@@ -264,18 +301,29 @@ void CloseMultiCsv(ProcessInfo* processInfo);
 void CloseGlobalCsv();
 const char* PresentModeToString(PresentMode mode);
 const char* RuntimeToString(Runtime rt);
+const char* FrameTypeToString(FrameType ft);
+void GenerateFilename(wchar_t* path, std::wstring const& processName, uint32_t processId);
 void UpdateCsv(PMTraceSession const& pmSession, ProcessInfo* processInfo, PresentEvent const& p, FrameMetrics const& metrics);
 void UpdateCsv(PMTraceSession const& pmSession, ProcessInfo* processInfo, PresentEvent const& p, FrameMetrics1 const& metrics);
 
 // MainThread.cpp:
 void ExitMainThread();
+void ConfigureConsumer(CommandLineArgs const& args, PMTraceConsumer* pmConsumer);
 
 // OutputThread.cpp:
 void StartOutputThread(PMTraceSession const& pmSession);
 void StopOutputThread();
+uint64_t RunBatchOutput(PMTraceSession const& pmSession, std::atomic<bool> const& traceDone);
 void SetOutputRecordingState(bool record);
 void CanonicalizeProcessName(std::wstring* path);
 
+// ShardedAnalysis.cpp:
+void StartShardedAnalysis(PMTraceSession* pmSession);
+void StopShardedAnalysis();
+void WaitForShardedAnalysisToExit();
+uint32_t FinalizeShardedAnalysis();
+void DequeueShardedEvents(std::vector<ProcessEvent>* processEvents, std::vector<std::shared_ptr<PresentEvent>>* presentEvents);
+
 // Privilege.cpp:
 bool InPerfLogUsersGroup();
 bool EnableDebugPrivilege();
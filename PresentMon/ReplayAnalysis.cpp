@@ -0,0 +1,75 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#include "PresentMon.hpp"
+
+#include <thread>
+
+// --replay_decoded_events re-runs the analysis of a file written by
+// --record_decoded_events.  The recorded events are applied to a
+// PMTraceConsumer in order, as if they were being decoded from the original
+// trace, and the output is written using the regular offline output path
+// (see RunBatchOutput() in OutputThread.cpp).  No ETW session is started;
+// PMTraceSession only provides the timestamp information from the file
+// header to the output.
+
+int RunDecodedEventReplay()
+{
+    auto const& replayArgs = GetCommandLineArgs();
+
+    DecodedEventReader reader;
+    if (!reader.Open(replayArgs.mReplayDecodedEventsFileName)) {
+        PrintError(L"error: failed to open --replay_decoded_events file: %s\n", replayArgs.mReplayDecodedEventsFileName);
+        return 1;
+    }
+
+    auto const& header = reader.GetHeader();
+    if (header.TimestampFrequency == 0) {
+        PrintError(L"error: --replay_decoded_events file has no timestamp frequency: %s\n", replayArgs.mReplayDecodedEventsFileName);
+        return 1;
+    }
+
+    // The output treats the replay like an ETL: the output uses a copy of the
+    // arguments that names the replayed file as the ETL.
+    auto args = replayArgs;
+    args.mEtlFileName = replayArgs.mReplayDecodedEventsFileName;
+
+    PMTraceConsumer pmConsumer(
+        args.mPresentEventCircularBufferSize != 0
+        ? args.mPresentEventCircularBufferSize
+        : PMTraceConsumer::PRESENTEVENT_CIRCULAR_BUFFER_SIZE);
+    ConfigureConsumer(args, &pmConsumer);
+    pmConsumer.mIsRealtimeSession = false;
+    if (pmConsumer.mDeferralTimeLimit == 0) {
+        pmConsumer.mDeferralTimeLimit = header.TimestampFrequency * 2;
+    }
+
+    PMTraceSession pmSession;
+    pmSession.mPMConsumer = &pmConsumer;
+    pmSession.mStartTimestamp.QuadPart = (LONGLONG) header.StartTimestamp;
+    pmSession.mTimestampFrequency.QuadPart = (LONGLONG) header.TimestampFrequency;
+    pmSession.mStartFileTime = header.StartFileTime;
+
+    // The replay runs on a helper thread while this thread processes the
+    // output, as the consumer may block waiting for the output to catch up.
+    std::atomic<bool> replayDone = false;
+    uint64_t eventCount = 0;
+    std::thread replayThread([&]() {
+        SetThreadDescription(GetCurrentThread(), L"PresentMon Replay Thread");
+        eventCount = ReplayDecodedEvents(&reader, &pmConsumer);
+        replayDone = true;
+    });
+
+    SetThreadCommandLineArgs(&args);
+    auto presentCount = RunBatchOutput(pmSession, replayDone);
+    SetThreadCommandLineArgs(nullptr);
+
+    replayThread.join();
+    reader.Close();
+
+    if (args.mConsoleOutput != ConsoleOutput::None) {
+        wprintf(L"%s: replayed %llu events, %llu presents\n", args.mReplayDecodedEventsFileName, eventCount, presentCount);
+    }
+
+    return 0;
+}
@@ -0,0 +1,389 @@
+// Copyright (C) 2025 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#include "PresentMon.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <thread>
+
+// --etl_shards splits the --etl_file into time shards that are analyzed in
+// parallel.  Each shard owns a contiguous time range of the ETL, measured from
+// the first event.
+//
+// The consumer hands off presents in the order they were completed, which is
+// recorded in each present as its CompletionTime (the timestamp of the event
+// that completed it) and CompletionSequence.  That is the serial order of the
+// output, so presents are owned by the shard whose range contains their
+// CompletionTime.  Process events are owned by QpcTime.
+//
+// A shard can't simply analyze the events in its range: presents started
+// before the range can complete inside it, presents started inside the range
+// can complete after it, and the consumer needs state (processes, graphics
+// devices/contexts) set up by events anywhere before it.  So each shard:
+//
+//  - handles the stateful events from the start of the ETL (see
+//    IsStatefulEtlEvent() in PresentMonTraceSession.cpp), which are read once
+//    for all the shards by a separate pass (EtlStatefulEvents) so that each
+//    shard only reads the ETL from its window,
+//  - fully analyzes from one overlap before its range, and
+//  - continues for one overlap past its range, so that presents it owns are
+//    completed (or given up on) the same as in a serial analysis.
+//
+// The overlap is twice the consumer's mDeferralTimeLimit, which bounds how
+// long a present can stay in flight before the consumer stops waiting on it.
+//
+// Each shard's presents are already in serial order, so the output thread
+// merges the shards by taking what shard 0 owns, then shard 1, etc.  Later
+// shards are drained as they go and what they own is held until their turn,
+// up to kMaxPendingPresents; past that, a shard is left to block on its
+// consumer's backpressure until its turn.
+//
+// At each boundary, the next shard doesn't necessarily agree with a serial
+// analysis: it didn't see the start of presents that were in flight at the
+// start of its window, so it can complete them differently or not at all.
+// The previous shard did see them, and continues through the overlap after
+// the boundary.  To find where the next shard agrees, both shards record a
+// hash of their tracked presents (PMTraceConsumer::HashTrackedPresents()) at
+// kBoundaryCheckpointCount checkpoints spread over the overlap after the
+// boundary.  The merge hands off at the first checkpoint where the hashes
+// match: from there both consumers have the same presents left to complete,
+// so the next shard completes them as the previous one (and so a serial
+// analysis) would.  The previous shard's presents completed before the
+// checkpoint are output, and the next shard's are dropped.  If the hashes
+// never match (e.g., a present stays in flight through the whole overlap)
+// the merge hands off at the end of the previous shard's window, and the
+// output can differ from a serial analysis around that boundary.
+//
+// The first shard uses the MainThread's session and consumer; the others are
+// created here.
+
+namespace {
+
+// The number of checkpoints in the overlap after each boundary.
+constexpr uint32_t kBoundaryCheckpointCount = 64;
+
+// The number of presents a shard can complete ahead of its turn before it is
+// left to block.
+constexpr size_t kMaxPendingPresents = 65536;
+
+struct Shard {
+    PMTraceSession* mSession = nullptr;
+    std::unique_ptr<PMTraceSession> mOwnedSession;
+    std::unique_ptr<PMTraceConsumer> mOwnedConsumer;
+
+    // The owned time range, relative to the first event in the ETL.
+    uint64_t mOwnedBegin = 0;
+    uint64_t mOwnedEnd = UINT64_MAX;
+
+    // The index into mSession->mEtlCheckpointTimes of the checkpoints after
+    // mOwnedBegin and after mOwnedEnd.
+    size_t mBeginCheckpoint = 0;
+    size_t mEndCheckpoint = 0;
+
+    // Presents completed before this time are not output from this shard.
+    // This is mOwnedBegin until the hand off from the previous shard.
+    uint64_t mPresentsBegin = 0;
+
+    std::thread mThread;
+    std::atomic<bool> mTraceDone = false;
+
+    // Whether everything the shard produced has been dequeued.  Only accessed
+    // by the output thread.
+    bool mDequeuedAll = false;
+
+    // Owned events dequeued but not yet merged, and presents completed after
+    // the owned range (which are used to reconcile the boundary with the next
+    // shard).  Only accessed by the output thread.
+    std::vector<ProcessEvent> mPendingProcessEvents;
+    std::deque<std::shared_ptr<PresentEvent>> mPendingPresentEvents;
+};
+
+std::vector<std::unique_ptr<Shard>> gShards;
+std::atomic<size_t> gRunningShardCount = 0;
+size_t gMergeShardIndex = 0;
+
+EtlStatefulEvents gEtlStatefulEvents;
+std::thread gEtlStatefulEventsThread;
+
+void Consume(Shard* shard)
+{
+    SetThreadDescription(GetCurrentThread(), L"PresentMon Shard Consumer Thread");
+
+    shard->mSession->ProcessEtl();
+
+    shard->mTraceDone = true;
+
+    // Signal MainThread to exit once all shards are analyzed.
+    if (gRunningShardCount.fetch_sub(1) == 1) {
+        ExitMainThread();
+    }
+}
+
+// Absolute timestamp of a time relative to the first event in the ETL.
+uint64_t GetEtlTimestamp(Shard const* shard, uint64_t t)
+{
+    return t == UINT64_MAX ? UINT64_MAX : (uint64_t) shard->mSession->mStartTimestamp.QuadPart + t;
+}
+
+// The number of checkpoints the shard's session has recorded.
+size_t GetCheckpointCount(Shard const* shard)
+{
+    return shard->mSession->mEtlCheckpointCount.load(std::memory_order_acquire);
+}
+
+// Move the process events that shard owns, and the presents completed from
+// mPresentsBegin, from its consumer into its pending lists.
+void DequeueShardEvents(Shard* shard)
+{
+    auto begin = GetEtlTimestamp(shard, shard->mOwnedBegin);
+    auto end   = GetEtlTimestamp(shard, shard->mOwnedEnd);
+    auto presentsBegin = GetEtlTimestamp(shard, shard->mPresentsBegin);
+
+    std::vector<ProcessEvent> processEvents;
+    shard->mSession->mPMConsumer->DequeueProcessEvents(processEvents);
+    for (auto& e : processEvents) {
+        if (e.QpcTime >= begin && e.QpcTime < end) {
+            shard->mPendingProcessEvents.emplace_back(std::move(e));
+        }
+    }
+
+    std::vector<std::shared_ptr<PresentEvent>> presentEvents;
+    shard->mSession->mPMConsumer->DequeuePresentEvents(presentEvents);
+    for (auto& p : presentEvents) {
+        if (p->CompletionTime >= presentsBegin) {
+            shard->mPendingPresentEvents.emplace_back(std::move(p));
+        }
+    }
+}
+
+// Output the pending presents of shard completed before time.
+void OutputPresentsCompletedBefore(
+    Shard* shard,
+    uint64_t time,
+    std::vector<std::shared_ptr<PresentEvent>>* presentEvents)
+{
+    auto& pending = shard->mPendingPresentEvents;
+    while (!pending.empty() && pending.front()->CompletionTime < time) {
+        presentEvents->emplace_back(std::move(pending.front()));
+        pending.pop_front();
+    }
+}
+
+// Hand off from the finished shard prev to the next shard at the first
+// checkpoint after their boundary where they track the same presents,
+// outputting prev's presents completed before it.
+void ReconcileShardBoundary(
+    Shard* prev,
+    Shard* next,
+    std::vector<std::shared_ptr<PresentEvent>>* presentEvents)
+{
+    auto prevSession = prev->mSession;
+    auto nextSession = next->mSession;
+    auto prevCount = GetCheckpointCount(prev);
+    auto nextCount = GetCheckpointCount(next);
+
+    auto handOffTime = prevSession->mEtlWindowEnd;
+    for (uint32_t i = 0; i < kBoundaryCheckpointCount; ++i) {
+        auto prevIndex = prev->mEndCheckpoint + i;
+        auto nextIndex = next->mBeginCheckpoint + i;
+        if (prevIndex >= prevCount || nextIndex >= nextCount) {
+            break;
+        }
+        if (prevSession->mEtlCheckpointHashes[prevIndex] == nextSession->mEtlCheckpointHashes[nextIndex]) {
+            handOffTime = prevSession->mEtlCheckpointTimes[prevIndex];
+            break;
+        }
+    }
+
+    OutputPresentsCompletedBefore(prev, GetEtlTimestamp(prev, handOffTime), presentEvents);
+    prev->mPendingPresentEvents.clear();
+
+    next->mPresentsBegin = handOffTime;
+    auto& nextPending = next->mPendingPresentEvents;
+    while (!nextPending.empty() && nextPending.front()->CompletionTime < GetEtlTimestamp(next, handOffTime)) {
+        nextPending.pop_front();
+    }
+}
+
+}
+
+void StartShardedAnalysis(PMTraceSession* pmSession)
+{
+    auto const& args = GetCommandLineArgs();
+
+    uint32_t shardCount = args.mEtlShardCount;
+    if (pmSession->mEtlDuration == 0) {
+        PrintWarning(L"warning: the --etl_file duration is unknown; analyzing it without --etl_shards.\n");
+        shardCount = 1;
+    }
+
+    // Each boundary's checkpoints must be in the owned range of the shard
+    // before it, so shards can't be shorter than the overlap.
+    auto overlap = 2 * pmSession->mPMConsumer->mDeferralTimeLimit;
+    if (shardCount > 1 && pmSession->mEtlDuration / shardCount < overlap) {
+        auto maxShardCount = (uint32_t) std::max<uint64_t>(pmSession->mEtlDuration / overlap, 1);
+        PrintWarning(L"warning: the --etl_file is too short for %u shards; using %u.\n", shardCount, maxShardCount);
+        shardCount = maxShardCount;
+    }
+    auto shardDuration = pmSession->mEtlDuration / shardCount;
+
+    for (uint32_t i = 0; i < shardCount; ++i) {
+        auto shard = std::make_unique<Shard>();
+        shard->mOwnedBegin = i * shardDuration;
+        shard->mOwnedEnd   = i + 1 == shardCount ? UINT64_MAX : (i + 1) * shardDuration;
+
+        if (i == 0) {
+            shard->mSession = pmSession;
+        } else {
+            shard->mOwnedConsumer = std::make_unique<PMTraceConsumer>(
+                args.mPresentEventCircularBufferSize != 0
+                ? args.mPresentEventCircularBufferSize
+                : PMTraceConsumer::PRESENTEVENT_CIRCULAR_BUFFER_SIZE);
+            ConfigureConsumer(args, shard->mOwnedConsumer.get());
+            shard->mOwnedConsumer->mDeferralTimeLimit = pmSession->mPMConsumer->mDeferralTimeLimit;
+
+            shard->mOwnedSession = std::make_unique<PMTraceSession>();
+            shard->mOwnedSession->mPMConsumer = shard->mOwnedConsumer.get();
+            auto status = shard->mOwnedSession->Start(args.mEtlFileName, args.mSessionName);
+            if (status != ERROR_SUCCESS) {
+                // Continue with the shards we have, with the last one
+                // extended to the end of the ETL.
+                PrintWarning(L"warning: failed to open --etl_file for shard %u (error %lu); using %u shards.\n", i, status, i);
+                gShards.back()->mOwnedEnd = UINT64_MAX;
+                break;
+            }
+
+            shard->mSession = shard->mOwnedSession.get();
+        }
+
+        gShards.emplace_back(std::move(shard));
+    }
+
+    // Set each shard's analysis window to its owned range extended by the
+    // overlap, and its checkpoints over the overlap after each of its
+    // boundaries (not needed for a single shard).
+    if (gShards.size() > 1) {
+        for (auto& shard : gShards) {
+            auto session = shard->mSession;
+            session->mEtlWindowBegin = shard->mOwnedBegin > overlap ? shard->mOwnedBegin - overlap : 0;
+            session->mEtlWindowEnd   = shard->mOwnedEnd == UINT64_MAX ? UINT64_MAX : shard->mOwnedEnd + overlap;
+            session->mEtlStatefulEvents = &gEtlStatefulEvents;
+
+            auto addCheckpoints = [&](uint64_t boundary) {
+                for (uint32_t i = 0; i < kBoundaryCheckpointCount; ++i) {
+                    session->mEtlCheckpointTimes.push_back(boundary + overlap * i / kBoundaryCheckpointCount);
+                }
+            };
+            if (shard->mOwnedBegin != 0) {
+                shard->mBeginCheckpoint = session->mEtlCheckpointTimes.size();
+                addCheckpoints(shard->mOwnedBegin);
+            }
+            if (shard->mOwnedEnd != UINT64_MAX) {
+                shard->mEndCheckpoint = session->mEtlCheckpointTimes.size();
+                addCheckpoints(shard->mOwnedEnd);
+            }
+            session->mEtlCheckpointHashes.resize(session->mEtlCheckpointTimes.size());
+
+            shard->mPresentsBegin = shard->mOwnedBegin;
+        }
+
+        // Read the stateful events for all the windows after the first.
+        gEtlStatefulEventsThread = std::thread([statefulEventsEnd = gShards.back()->mSession->mEtlWindowBegin]() {
+            SetThreadDescription(GetCurrentThread(), L"PresentMon Shard Stateful Event Thread");
+            gEtlStatefulEvents.Read(GetCommandLineArgs().mEtlFileName, statefulEventsEnd);
+        });
+    }
+
+    gMergeShardIndex = 0;
+    gRunningShardCount = gShards.size();
+    for (auto& shard : gShards) {
+        shard->mThread = std::thread(Consume, shard.get());
+    }
+}
+
+void StopShardedAnalysis()
+{
+    gEtlStatefulEvents.Cancel();
+
+    // The first shard's session is stopped by MainThread.
+    for (size_t i = 1, n = gShards.size(); i < n; ++i) {
+        gShards[i]->mSession->Stop();
+    }
+}
+
+void WaitForShardedAnalysisToExit()
+{
+    if (gEtlStatefulEventsThread.joinable()) {
+        gEtlStatefulEventsThread.join();
+    }
+    for (auto& shard : gShards) {
+        if (shard->mThread.joinable()) {
+            shard->mThread.join();
+        }
+    }
+}
+
+uint32_t FinalizeShardedAnalysis()
+{
+    // Returns the overflowed presents of the shards other than the first,
+    // whose consumer is owned by MainThread.
+    uint32_t numOverflowedPresents = 0;
+    for (size_t i = 1, n = gShards.size(); i < n; ++i) {
+        numOverflowedPresents += gShards[i]->mOwnedConsumer->mNumOverflowedPresents;
+    }
+
+    gShards.clear();
+    return numOverflowedPresents;
+}
+
+void DequeueShardedEvents(
+    std::vector<ProcessEvent>* processEvents,
+    std::vector<std::shared_ptr<PresentEvent>>* presentEvents)
+{
+    for (size_t i = gMergeShardIndex, n = gShards.size(); i < n; ++i) {
+        auto shard = gShards[i].get();
+
+        // Stop dequeuing from a later shard once it has kMaxPendingPresents
+        // waiting, so that it blocks on its consumer's backpressure.  It is
+        // dequeued until it records the checkpoints after its begin
+        // boundary though, since the merge waits on them; until then its
+        // pending presents are limited to the ones completed in the overlap.
+        if (i != gMergeShardIndex &&
+            shard->mPendingPresentEvents.size() >= kMaxPendingPresents &&
+            GetCheckpointCount(shard) >= shard->mBeginCheckpoint + kBoundaryCheckpointCount) {
+            continue;
+        }
+
+        // Read mTraceDone before dequeuing so that, if it is set, everything
+        // the shard produced has been dequeued.
+        shard->mDequeuedAll = shard->mTraceDone.load();
+
+        DequeueShardEvents(shard);
+    }
+
+    // Output the events of the shard whose turn it is, and move on to the
+    // next shard once this one is complete and the next one has recorded its
+    // checkpoints for their boundary.
+    for (size_t n = gShards.size(); gMergeShardIndex < n; ++gMergeShardIndex) {
+        auto shard = gShards[gMergeShardIndex].get();
+
+        processEvents->insert(processEvents->end(), shard->mPendingProcessEvents.begin(), shard->mPendingProcessEvents.end());
+        shard->mPendingProcessEvents.clear();
+        OutputPresentsCompletedBefore(shard, GetEtlTimestamp(shard, shard->mOwnedEnd), presentEvents);
+
+        if (!shard->mDequeuedAll) {
+            break;
+        }
+
+        if (gMergeShardIndex + 1 < n) {
+            auto next = gShards[gMergeShardIndex + 1].get();
+            if (!next->mDequeuedAll && GetCheckpointCount(next) < next->mBeginCheckpoint + kBoundaryCheckpointCount) {
+                break;
+            }
+
+            ReconcileShardBoundary(shard, next, presentEvents);
+        }
+    }
+}
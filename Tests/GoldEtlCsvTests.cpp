@@ -9,6 +9,8 @@ struct TestArgs {
     std::wstring etl_;
     std::wstring goldCsv_;
     std::wstring testCsv_;
+    uint32_t shardCount_ = 0;
+    bool replay_ = false;
 };
 
 class Tests : public ::testing::Test, TestArgs {
@@ -33,12 +35,37 @@ public:
             return;
         }
 
+        // If testing the replay, first record the ETL's decoded events and
+        // then generate the CSV from the recording instead of the ETL.
+        std::wstring decodedEventsPath;
+        if (replay_) {
+            decodedEventsPath = testCsv_.substr(0, testCsv_.size() - 4) + L".pmir";
+            DeleteFile(decodedEventsPath.c_str());
+
+            PresentMon pmRecord;
+            pmRecord.Add(L"--stop_existing_session");
+            pmRecord.AddEtlPath(etl_);
+            pmRecord.Add((L"--record_decoded_events \"" + decodedEventsPath + L"\"").c_str());
+            for (auto param : goldCsv.params_) {
+                pmRecord.Add(param);
+            }
+            pmRecord.PMSTART();
+            pmRecord.PMEXITED();
+        }
+
         // Generate command line, querying gold CSV to try and match expected
         // data.
         PresentMon pm;
-        pm.Add(L"--stop_existing_session");
-        pm.AddEtlPath(etl_);
+        if (replay_) {
+            pm.Add((L"--replay_decoded_events \"" + decodedEventsPath + L"\"").c_str());
+        } else {
+            pm.Add(L"--stop_existing_session");
+            pm.AddEtlPath(etl_);
+        }
         pm.AddCsvPath(testCsv_);
+        if (shardCount_ > 1) {
+            pm.Add((L"--etl_shards " + std::to_wstring(shardCount_)).c_str());
+        }
         for (auto param : goldCsv.params_) {
             pm.Add(param);
         }
@@ -198,6 +225,26 @@ void AddGoldEtlCsvTests(
                                 "GoldEtlCsvTests", name.c_str(), nullptr, nullptr, __FILE__, __LINE__,
                                 [=]() -> ::testing::Test* { return new Tests(std::move(args)); });
 
+                            // Also check that analyzing the ETL in time shards
+                            // produces the same output.
+                            TestArgs shardedArgs = args;
+                            shardedArgs.testCsv_ = outDir_ + L"sharded\\" + fileName;
+                            shardedArgs.shardCount_ = 4;
+
+                            ::testing::RegisterTest(
+                                "GoldEtlCsvShardedTests", name.c_str(), nullptr, nullptr, __FILE__, __LINE__,
+                                [=]() -> ::testing::Test* { return new Tests(std::move(shardedArgs)); });
+
+                            // Also check that replaying the recorded decoded
+                            // events, without ETW, produces the same output.
+                            TestArgs replayArgs = args;
+                            replayArgs.testCsv_ = outDir_ + L"replay\\" + fileName;
+                            replayArgs.replay_ = true;
+
+                            ::testing::RegisterTest(
+                                "GoldEtlCsvReplayTests", name.c_str(), nullptr, nullptr, __FILE__, __LINE__,
+                                [=]() -> ::testing::Test* { return new Tests(std::move(replayArgs)); });
+
                             csvCount += 1;
                         }
                     } while (FindNextFile(csvh, &csvff) != 0);
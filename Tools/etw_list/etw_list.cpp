@@ -994,8 +994,10 @@ int wmain(
             "\n"
             "namespace %ls {\n"
             "\n"
+            "#ifdef _WIN32\n"
             "struct __declspec(uuid(\"%ls\")) GUID_STRUCT;\n"
-            "static const auto GUID = __uuidof(GUID_STRUCT);\n",
+            "static const auto GUID = __uuidof(GUID_STRUCT);\n"
+            "#endif\n",
             CppCondition(provider.name_).c_str(),
             provider.guidStr_.c_str());
 
@@ -1098,8 +1100,8 @@ int wmain(
                         "    static %s const Keyword = %skeyword_; \\\n"
                         "}\n"
                         "\n",
-                        showKeywords ? "Keyword " : "uint64_t",
-                        showKeywords ? "(Keyword) " : "");
+                        showKeywords ? "enum Keyword" : "uint64_t",
+                        showKeywords ? "(enum Keyword) " : "");
 
                     for (auto const& event : events) {
                         printf("EVENT_DESCRIPTOR_DECL(%-*ls, 0x%04x, 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%04x, 0x%016llx);\n",
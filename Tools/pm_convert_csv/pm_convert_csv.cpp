@@ -1,8 +1,14 @@
 // Copyright (C) 2017-2024 Intel Corporation
 // SPDX-License-Identifier: MIT
 
+#include "../../PresentData/CaptureFile.hpp"
+
+#include <windows.h>
 #include <array>
+#include <cmath>
+#include <fcntl.h>
 #include <fstream>
+#include <io.h>
 #include <stdio.h>
 #include <string>
 #include <sstream>
@@ -245,11 +251,75 @@ void ReportMetrics(Options const& opts, SwapChainData* chain, PresentEvent const
     chain->mNextCPUFrameTimeIsValid = true;
 }
 
+// Write a PresentMon capture file (see --binary_output) as the CSV that
+// PresentMon would have written without --binary_output.
+int ConvertCaptureFile(wchar_t const* path)
+{
+    CaptureFileReader reader;
+    if (!reader.Open(path)) {
+        fprintf(stderr, "error: failed to open capture file: %ls\n", path);
+        return 2;
+    }
+
+    // Write UTF-8, as PresentMon does for CSV files.
+    _setmode(_fileno(stdout), _O_U8TEXT);
+
+    auto const& columns = reader.GetColumns();
+    for (size_t i = 0, n = columns.size(); i < n; ++i) {
+        wprintf(L"%s%s", i == 0 ? L"" : L",", columns[i].Name.c_str());
+    }
+    wprintf(L"\n");
+
+    // Only complete blocks are read, so a capture that is still being
+    // recorded (or was interrupted) converts up to its last complete block.
+    while (reader.ReadBlock()) {
+        for (uint32_t row = 0, rowCount = reader.GetRowCount(); row < rowCount; ++row) {
+            for (uint32_t i = 0, n = (uint32_t) columns.size(); i < n; ++i) {
+                if (i > 0) {
+                    wprintf(L",");
+                }
+                switch (columns[i].Type) {
+                case CaptureColumnType::String: wprintf(L"%s", reader.GetString(i, row).c_str()); break;
+                case CaptureColumnType::Int32:  wprintf(L"%d", (int32_t) reader.GetInteger(i, row)); break;
+                case CaptureColumnType::UInt32: wprintf(L"%u", (uint32_t) reader.GetInteger(i, row)); break;
+                case CaptureColumnType::UInt64: wprintf(L"%llu", reader.GetInteger(i, row)); break;
+                case CaptureColumnType::Hex64:  wprintf(L"0x%llX", reader.GetInteger(i, row)); break;
+                case CaptureColumnType::Double: {
+                    auto value = reader.GetDouble(i, row);
+                    if (std::isnan(value)) {
+                        wprintf(L"NA");
+                    } else {
+                        wprintf(L"%.*lf", columns[i].Precision, value);
+                    }
+                }   break;
+                case CaptureColumnType::LocalFileTime: {
+                    auto fileTime = reader.GetInteger(i, row);
+                    SYSTEMTIME st = {};
+                    FileTimeToSystemTime((FILETIME const*) &fileTime, &st);
+                    wprintf(L"%u-%u-%u %u:%02u:%02u.%09llu", st.wYear,
+                                                             st.wMonth,
+                                                             st.wDay,
+                                                             st.wHour,
+                                                             st.wMinute,
+                                                             st.wSecond,
+                                                             (fileTime % 10000000) * 100);
+                }   break;
+                }
+            }
+            wprintf(L"\n");
+        }
+    }
+
+    return 0;
+}
+
 void usage()
 {
     fprintf(stderr,
-        "Convert a PresentMon v1.x CSV file into v2.0 CSV file.\n"
-        "usage: pm_convert_csv.exe path_to_input.csv\n");
+        "Convert a PresentMon v1.x CSV file into v2.0 CSV file, or a PresentMon\n"
+        "capture file (see --binary_output) into a CSV file.\n"
+        "usage: pm_convert_csv.exe path_to_input.csv\n"
+        "       pm_convert_csv.exe path_to_input.pmcap\n");
 }
 
 }
@@ -263,6 +333,10 @@ int wmain(
         return 1;
     }
 
+    if (IsCaptureFile(argv[1])) {
+        return ConvertCaptureFile(argv[1]);
+    }
+
     std::wifstream file(argv[1]);
     if (!file.is_open()) {
         fprintf(stderr, "error: failed to open input file: %ls\n", argv[1]);